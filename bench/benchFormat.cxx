@@ -0,0 +1,302 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchFormat.cxx
+ */
+
+#include "fofimodel.h"
+#include "jsonwriter.h"
+#include "printout.h"
+#include "textwriter.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "fakesource.h"
+#include "testingutil.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+namespace fofi
+{
+namespace bench
+{
+
+using testing::FakeSource;
+
+static constexpr int32_t s_nTotDirs = 100;
+
+/* How the text results were written before TextWriter. */
+void printActionStream(std::ostream& oOut, const FofiModel::ActionData& oAction, int64_t nDurationUsec)
+{
+	oOut << "        " << Util::getTimeString(oAction.m_nTimeUsec, nDurationUsec) << " "
+			<< ((oAction.m_eAction == INotifierSource::FOFI_ACTION_CREATE) ? "Create" : "Modify") << '\n';
+}
+void printResultStream(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+						, bool bDetail, int64_t nDurationUsec)
+{
+	const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
+	if (! bDetail) {
+		oOut << "C" << (oResult.m_bInconsistent ? "?" : " ")
+				<< Glib::filename_to_utf8(Util::getPathFromDirAndName(sParentPath, oFofiModel.getWatchedResultName(oResult)))
+				<< ((oResult.m_bIsDir && (sParentPath != "/")) ? "/" : "") << '\n';
+		return; //--------------------------------------------------------------
+	}
+	oOut << "File: " << Glib::filename_to_utf8(Util::getPathFromDirAndName(sParentPath, oFofiModel.getWatchedResultName(oResult)))
+			<< ((oResult.m_bIsDir && (sParentPath != "/")) ? "/" : "") << '\n';
+	oOut << "    Status: " << "Created" << (oResult.m_bInconsistent ? " (inconsistent)" : "") << '\n';
+	oOut << "      Actions:" << '\n';
+	for (const auto& oAction : oResult.m_aActions) {
+		printActionStream(oOut, oAction, nDurationUsec);
+	}
+}
+/* How the json results were written before JsonWriter::pathValue() and timeValue(). */
+void printResultJSonStrings(JsonWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+							, bool bDetail, int64_t nDurationUsec)
+{
+	const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
+	oWriter.beginObject();
+	if (bDetail) {
+		oWriter.key("Actions");
+		oWriter.beginArray();
+		for (const auto& oAction : oResult.m_aActions) {
+			oWriter.beginObject();
+			oWriter.key("Action");
+			oWriter.value((oAction.m_eAction == INotifierSource::FOFI_ACTION_CREATE) ? "Create" : "Modify");
+			oWriter.key("Time");
+			oWriter.value(Util::getTimeString(oAction.m_nTimeUsec, nDurationUsec));
+			oWriter.endObject();
+		}
+		oWriter.endArray();
+	}
+	oWriter.key("Dir");
+	oWriter.value(oResult.m_bIsDir);
+	oWriter.key("Inconsistent");
+	oWriter.value(oResult.m_bInconsistent);
+	oWriter.key("Path");
+	oWriter.fileNameValue(Util::getPathFromDirAndName(sParentPath, oFofiModel.getWatchedResultName(oResult)));
+	oWriter.key("Status");
+	oWriter.value("Created");
+	oWriter.endObject();
+}
+
+/* Discards what is written, counting the bytes and the lines. */
+class CountingStreamBuf : public std::streambuf
+{
+public:
+	int64_t m_nTotBytes = 0;
+	int64_t m_nTotLines = 0;
+protected:
+	int_type overflow(int_type nC) override
+	{
+		if (! traits_type::eq_int_type(nC, traits_type::eof())) {
+			++m_nTotBytes;
+			if (traits_type::to_char_type(nC) == '\n') {
+				++m_nTotLines;
+			}
+		}
+		return traits_type::not_eof(nC);
+	}
+	std::streamsize xsputn(const char_type* p0S, std::streamsize nCount) override
+	{
+		m_nTotBytes += nCount;
+		const char_type* const p0End = p0S + nCount;
+		while ((p0S = static_cast<const char_type*>(std::memchr(p0S, '\n', p0End - p0S))) != nullptr) {
+			++m_nTotLines;
+			++p0S;
+		}
+		return nCount;
+	}
+};
+
+/* Discards what is written, computing a hash to compare outputs without keeping them. */
+class HashingStreamBuf : public std::streambuf
+{
+public:
+	uint64_t m_nHash = 14695981039346656037ULL;
+protected:
+	int_type overflow(int_type nC) override
+	{
+		if (! traits_type::eq_int_type(nC, traits_type::eof())) {
+			const char_type c = traits_type::to_char_type(nC);
+			xsputn(&c, 1);
+		}
+		return traits_type::not_eof(nC);
+	}
+	std::streamsize xsputn(const char_type* p0S, std::streamsize nCount) override
+	{
+		// FNV-1a
+		for (std::streamsize nIdx = 0; nIdx < nCount; ++nIdx) {
+			m_nHash = (m_nHash ^ static_cast<unsigned char>(p0S[nIdx])) * 1099511628211ULL;
+		}
+		return nCount;
+	}
+};
+
+using WriteFunction = std::function<void(std::ostream& oOut, bool bDetail)>;
+
+uint64_t getOutputHash(const WriteFunction& oWrite, bool bDetail)
+{
+	HashingStreamBuf oHashingBuf;
+	std::ostream oOut(&oHashingBuf);
+	oWrite(oOut, bDetail);
+	return oHashingBuf.m_nHash;
+}
+
+void benchWrite(const std::string& sTitle, const WriteFunction& oWrite, bool bDetail)
+{
+	CountingStreamBuf oCountingBuf;
+	std::ostream oNull(&oCountingBuf);
+	const int64_t nStartUsec = Util::getNowTimeMicroseconds();
+	oWrite(oNull, bDetail);
+	const int64_t nUsec = Util::getNowTimeMicroseconds() - nStartUsec;
+	const int64_t nTotLines = std::max<int64_t>(1, oCountingBuf.m_nTotLines);
+	std::cout << "  " << std::left << std::setw(26) << sTitle << std::right
+			<< std::setw(8) << nUsec / 1000 << " ms"
+			<< std::setw(12) << oCountingBuf.m_nTotLines << " lines"
+			<< std::setw(10) << std::fixed << std::setprecision(1) << (nUsec * 1000.0 / nTotLines) << " ns/line"
+			<< std::setw(10) << std::setprecision(1) << (oCountingBuf.m_nTotBytes / (nUsec + 1.0)) << " MB/s" << '\n';
+}
+
+int benchFormat(int32_t nTotResults)
+{
+	const std::string sBasePath = testing::getTempDir();
+	for (int32_t nDir = 0; nDir < s_nTotDirs; ++nDir) {
+		testing::makePath(sBasePath + "/d" + std::to_string(nDir));
+	}
+	int32_t nRet = 0;
+	{ // destroy the model before removing the tree
+		FofiModel oFofiModel(std::make_unique<FakeSource>(0), s_nTotDirs + 1000, nTotResults + 1000, false);
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		oDZ.m_nMaxDepth = 1;
+		auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+		if (sErr.empty()) {
+			sErr = oFofiModel.start();
+		}
+		if (! sErr.empty()) {
+			std::cout << sErr << '\n';
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+		std::vector<int32_t> aDirTags;
+		const auto& aTWDs = oFofiModel.getToWatchDirectories();
+		for (int32_t nIdx = 0; nIdx < static_cast<int32_t>(aTWDs.size()); ++nIdx) {
+			// the subdirectories of the zone, not the base path nor its ancestors
+			const auto& oTWD = aTWDs[nIdx];
+			if (oTWD.isWatched() && (oTWD.getOwnerDirectoryZone() >= 0) && (oTWD.m_nDepth == 1)) {
+				aDirTags.push_back(nIdx);
+			}
+		}
+		// the files don't need to exist, results are created from the events alone
+		auto* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+		for (int32_t nFile = 0; nFile < nTotResults; ++nFile) {
+			INotifierSource::FofiData oFD;
+			oFD.m_nTag = aDirTags[nFile % aDirTags.size()];
+			oFD.m_sName = "file-with-a-realistic-name-" + std::to_string(nFile) + ".txt";
+			oFD.m_bIsDir = false;
+			oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+			p0Source->callback(oFD);
+			oFD.m_eAction = INotifierSource::FOFI_ACTION_MODIFY;
+			p0Source->callback(oFD);
+		}
+		oFofiModel.stop();
+		const int64_t nDuration = oFofiModel.getDuration();
+		const int32_t nResults = static_cast<int32_t>(oFofiModel.getWatchedResults().size());
+		std::cout << "Results: " << nResults << '\n';
+		if (nResults == 0) {
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+
+		const WriteFunction oStream = [&](std::ostream& oOut, bool bDetail)
+		{
+			oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+			{
+				printResultStream(oOut, oFofiModel, oResult, bDetail, nDuration);
+			});
+		};
+		const WriteFunction oText = [&](std::ostream& oOut, bool bDetail)
+		{
+			TextWriter oWriter(oOut);
+			oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+			{
+				printResult(oWriter, oFofiModel, oResult, bDetail, nDuration);
+			});
+		};
+		const WriteFunction oJsonStrings = [&](std::ostream& oOut, bool bDetail)
+		{
+			JsonWriter oWriter(oOut, true);
+			oWriter.beginSequence();
+			oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+			{
+				printResultJSonStrings(oWriter, oFofiModel, oResult, bDetail, nDuration);
+			});
+			oWriter.endSequence();
+		};
+		const WriteFunction oJson = [&](std::ostream& oOut, bool bDetail)
+		{
+			JsonWriter oWriter(oOut, true);
+			oWriter.beginSequence();
+			oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+			{
+				printResultJSon(oWriter, oFofiModel, oResult, bDetail, nDuration);
+			});
+			oWriter.endSequence();
+		};
+		for (const bool bDetail : {false, true}) {
+			// the output must be the same as before
+			const bool bSame = (getOutputHash(oStream, bDetail) == getOutputHash(oText, bDetail))
+								&& (getOutputHash(oJsonStrings, bDetail) == getOutputHash(oJson, bDetail));
+			std::cout << (bDetail ? "Detailed" : "Code") << " output (same: " << (bSame ? "yes" : "NO") << ")" << '\n';
+			if (! bSame) {
+				nRet = 1;
+			}
+			benchWrite("ostream text", oStream, bDetail);
+			benchWrite("TextWriter text", oText, bDetail);
+			benchWrite("JsonWriter with strings", oJsonStrings, bDetail);
+			benchWrite("JsonWriter ndjson", oJson, bDetail);
+		}
+	}
+	removeTree(sBasePath);
+	return nRet;
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// benchFormat [TOT_RESULTS]
+	// the default produces a detailed dump of 10M lines (4 per result)
+	const int32_t nTotResults = ((argc > 1) ? std::atoi(argv[1]) : 2500000);
+	if (nTotResults <= 0) {
+		std::cerr << "Usage: benchFormat [TOT_RESULTS]" << '\n';
+		return 1;
+	}
+	// the fake source doesn't need it, but the model's timers do
+	auto refML = Glib::MainLoop::create();
+	return fofi::bench::benchFormat(nTotResults);
+}
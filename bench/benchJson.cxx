@@ -0,0 +1,235 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchJson.cxx
+ */
+
+#include "fofimodel.h"
+#include "jsonwriter.h"
+#include "printout.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "fakesource.h"
+#include "testingutil.h"
+
+#include "nlohmann/json.hpp"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+namespace fofi
+{
+namespace bench
+{
+
+using nlohmann::json;
+using testing::FakeSource;
+
+static constexpr int32_t s_nTotDirs = 100;
+
+/* How results were written before JsonWriter: a document object per result. */
+void printResultJSonDom(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec)
+{
+	json oJRes;
+	const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
+	oJRes["Path"] = std::string{Glib::filename_to_utf8(Util::getPathFromDirAndName(sParentPath, oFofiModel.getWatchedResultName(oResult)))};
+	oJRes["Dir"] = oResult.m_bIsDir;
+	oJRes["Status"] = (oResult.m_eResultType == FofiModel::RESULT_CREATED) ? "Created" : "Modified";
+	oJRes["Inconsistent"] = oResult.m_bInconsistent;
+	if (bDetail) {
+		auto& oJActions = oJRes["Actions"];
+		oJActions = json::array();
+		for (const auto& oAction : oResult.m_aActions) {
+			json oJAction;
+			oJAction["Action"] = (oAction.m_eAction == INotifierSource::FOFI_ACTION_CREATE) ? "Create" : "Modify";
+			oJAction["Time"] = Util::getTimeString(oAction.m_nTimeUsec, nDurationUsec);
+			oJActions.push_back(oJAction);
+		}
+	}
+	oOut << oJRes.dump(2) << '\n';
+}
+
+void writeDom(std::ostream& oOut, const FofiModel& oFofiModel, bool bDetail, int64_t nDurationUsec)
+{
+	oOut << "[" << '\n';
+	bool bFirst = true;
+	oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+	{
+		if (! bFirst) {
+			oOut << "," << '\n';
+		}
+		bFirst = false;
+		printResultJSonDom(oOut, oFofiModel, oResult, bDetail, nDurationUsec);
+	});
+	oOut << "]" << '\n';
+}
+void writeStreaming(std::ostream& oOut, const FofiModel& oFofiModel, bool bDetail, int64_t nDurationUsec, bool bNDJSon)
+{
+	JsonWriter oWriter(oOut, bNDJSon);
+	oWriter.beginSequence();
+	oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+	{
+		printResultJSon(oWriter, oFofiModel, oResult, bDetail, nDurationUsec);
+	});
+	oWriter.endSequence();
+}
+
+/* Discards what is written, counting the bytes. */
+class CountingStreamBuf : public std::streambuf
+{
+public:
+	int64_t m_nTotBytes = 0;
+protected:
+	int_type overflow(int_type nC) override
+	{
+		if (! traits_type::eq_int_type(nC, traits_type::eof())) {
+			++m_nTotBytes;
+		}
+		return traits_type::not_eof(nC);
+	}
+	std::streamsize xsputn(const char_type* /*p0S*/, std::streamsize nCount) override
+	{
+		m_nTotBytes += nCount;
+		return nCount;
+	}
+};
+
+using WriteFunction = std::function<void(std::ostream& oOut, bool bDetail)>;
+
+void benchWrite(const std::string& sTitle, const WriteFunction& oWrite, bool bDetail, int32_t nTotResults)
+{
+	CountingStreamBuf oCountingBuf;
+	std::ostream oNull(&oCountingBuf);
+	const int64_t nStartRSS = testing::getResidentBytes();
+	const int64_t nStartUsec = Util::getNowTimeMicroseconds();
+	oWrite(oNull, bDetail);
+	const int64_t nUsec = Util::getNowTimeMicroseconds() - nStartUsec;
+	const int64_t nRSSGrowth = testing::getResidentBytes() - nStartRSS;
+	std::cout << "  " << std::left << std::setw(26) << sTitle << std::right
+			<< std::setw(8) << nUsec / 1000 << " ms"
+			<< std::setw(10) << std::fixed << std::setprecision(1) << (nUsec * 1000.0 / nTotResults) << " ns/result"
+			<< std::setw(10) << oCountingBuf.m_nTotBytes / nTotResults << " bytes/result"
+			<< std::setw(10) << nRSSGrowth / 1024 << " KiB RSS growth" << '\n';
+}
+
+int benchJson(int32_t nTotResults)
+{
+	const std::string sBasePath = testing::getTempDir();
+	for (int32_t nDir = 0; nDir < s_nTotDirs; ++nDir) {
+		testing::makePath(sBasePath + "/d" + std::to_string(nDir));
+	}
+	int32_t nRet = 0;
+	{ // destroy the model before removing the tree
+		FofiModel oFofiModel(std::make_unique<FakeSource>(0), s_nTotDirs + 1000, nTotResults + 1000, false);
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		oDZ.m_nMaxDepth = 1;
+		auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+		if (sErr.empty()) {
+			sErr = oFofiModel.start();
+		}
+		if (! sErr.empty()) {
+			std::cout << sErr << '\n';
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+		std::vector<int32_t> aDirTags;
+		const auto& aTWDs = oFofiModel.getToWatchDirectories();
+		for (int32_t nIdx = 0; nIdx < static_cast<int32_t>(aTWDs.size()); ++nIdx) {
+			// the subdirectories of the zone, not the base path nor its ancestors
+			const auto& oTWD = aTWDs[nIdx];
+			if (oTWD.isWatched() && (oTWD.getOwnerDirectoryZone() >= 0) && (oTWD.m_nDepth == 1)) {
+				aDirTags.push_back(nIdx);
+			}
+		}
+		// the files don't need to exist, results are created from the events alone
+		auto* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+		for (int32_t nFile = 0; nFile < nTotResults; ++nFile) {
+			INotifierSource::FofiData oFD;
+			oFD.m_nTag = aDirTags[nFile % aDirTags.size()];
+			oFD.m_sName = "file-with-a-realistic-name-" + std::to_string(nFile) + ".txt";
+			oFD.m_bIsDir = false;
+			oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+			p0Source->callback(oFD);
+			oFD.m_eAction = INotifierSource::FOFI_ACTION_MODIFY;
+			p0Source->callback(oFD);
+		}
+		oFofiModel.stop();
+		const int64_t nDuration = oFofiModel.getDuration();
+		const int32_t nResults = static_cast<int32_t>(oFofiModel.getWatchedResults().size());
+		std::cout << "Results: " << nResults << '\n';
+		if (nResults == 0) {
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+
+		const WriteFunction oDom = [&](std::ostream& oOut, bool bDetail)
+		{
+			writeDom(oOut, oFofiModel, bDetail, nDuration);
+		};
+		const WriteFunction oJson = [&](std::ostream& oOut, bool bDetail)
+		{
+			writeStreaming(oOut, oFofiModel, bDetail, nDuration, false);
+		};
+		const WriteFunction oNDJson = [&](std::ostream& oOut, bool bDetail)
+		{
+			writeStreaming(oOut, oFofiModel, bDetail, nDuration, true);
+		};
+		for (const bool bDetail : {false, true}) {
+			// the streaming output must be the same as the one built with nlohmann::json
+			std::ostringstream oDomOut;
+			oDom(oDomOut, bDetail);
+			std::ostringstream oJsonOut;
+			oJson(oJsonOut, bDetail);
+			const bool bSame = (oDomOut.str() == oJsonOut.str());
+			std::cout << (bDetail ? "Detailed" : "Code") << " output (same: " << (bSame ? "yes" : "NO") << ")" << '\n';
+			if (! bSame) {
+				nRet = 1;
+			}
+			benchWrite("nlohmann::json", oDom, bDetail, nResults);
+			benchWrite("JsonWriter json", oJson, bDetail, nResults);
+			benchWrite("JsonWriter ndjson", oNDJson, bDetail, nResults);
+		}
+	}
+	removeTree(sBasePath);
+	return nRet;
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// benchJson [TOT_RESULTS]
+	const int32_t nTotResults = ((argc > 1) ? std::atoi(argv[1]) : 1000000);
+	if (nTotResults <= 0) {
+		std::cerr << "Usage: benchJson [TOT_RESULTS]" << '\n';
+		return 1;
+	}
+	// the fake source doesn't need it, but the model's timers do
+	auto refML = Glib::MainLoop::create();
+	return fofi::bench::benchJson(nTotResults);
+}
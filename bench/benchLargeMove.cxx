@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchLargeMove.cxx
+ */
+
+#include "fofimodel.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "testingutil.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstdlib>
+
+#include <stdio.h>
+
+namespace fofi
+{
+namespace bench
+{
+
+/* Moves a tree from one watched directory to another and measures how long
+ * the model takes to process the move. */
+int benchMove(const std::string& sTitle, int32_t nTotDirs, int32_t nFanOut, int32_t nFilesPerDir)
+{
+	const std::string sBasePath = testing::getTempDir();
+	const std::string sFromPath = sBasePath + "/From/T";
+	const std::string sToPath = sBasePath + "/To/T";
+	testing::makePath(sBasePath + "/To");
+	const TreeSize oSize = createTree(sFromPath, nTotDirs, nFanOut, nFilesPerDir);
+
+	auto refML = Glib::MainLoop::create();
+	{ // destroy the model before removing the tree
+		FofiModel oFofiModel(nTotDirs * 2 + 1000, (oSize.m_nDirs + oSize.m_nFiles) * 2 + 1000);
+		std::string sAbortError;
+		oFofiModel.m_oAbortSignal.connect([&](const std::string& sError)
+		{
+			sAbortError = sError;
+			refML->quit();
+		});
+
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		oDZ.m_nMaxDepth = nTotDirs + 10;
+		auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+		if (sErr.empty()) {
+			const int64_t nSetupStartUsec = Util::getNowTimeMicroseconds();
+			sErr = oFofiModel.start();
+			if (sErr.empty()) {
+				std::cout << sTitle << ": " << oSize.m_nDirs << " dirs, " << oSize.m_nFiles << " files" << '\n';
+				std::cout << "  setup:   " << (Util::getNowTimeMicroseconds() - nSetupStartUsec) / 1000 << " ms" << '\n';
+			}
+		}
+		if (! sErr.empty()) {
+			std::cout << sTitle << ": " << sErr << '\n';
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+
+		const int64_t nMoveUsec = Util::getNowTimeMicroseconds();
+		::rename(sFromPath.c_str(), sToPath.c_str());
+		const int64_t nLastChangeUsec = runUntilResultsStable(oFofiModel, refML, nMoveUsec);
+		oFofiModel.stop();
+
+		if (! sAbortError.empty()) {
+			std::cout << "  aborted: " << sAbortError << '\n';
+		}
+		std::cout << "  move:    " << (nLastChangeUsec - nMoveUsec) / 1000 << " ms" << '\n';
+		std::cout << "  results: " << oFofiModel.getWatchedResults().size() << '\n';
+	}
+	removeTree(sBasePath);
+	return 0;
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// benchLargeMove [TOT_DIRS [FILES_PER_DIR [CHAIN_DEPTH [CROWDED_FILES]]]]
+	const int32_t nTotDirs = ((argc > 1) ? std::atoi(argv[1]) : 20000);
+	const int32_t nFilesPerDir = ((argc > 2) ? std::atoi(argv[2]) : 4);
+	const int32_t nChainDepth = ((argc > 3) ? std::atoi(argv[3]) : 1000);
+	const int32_t nCrowdedFiles = ((argc > 4) ? std::atoi(argv[4]) : 500);
+	if ((nTotDirs <= 0) || (nFilesPerDir < 0) || (nChainDepth <= 0) || (nCrowdedFiles < 0)) {
+		std::cerr << "Usage: benchLargeMove [TOT_DIRS [FILES_PER_DIR [CHAIN_DEPTH [CROWDED_FILES]]]]" << '\n';
+		return 1;
+	}
+
+	int32_t nRet = 0;
+	nRet += fofi::bench::benchMove("Wide tree", nTotDirs, 10, nFilesPerDir);
+	nRet += fofi::bench::benchMove("Deep chain", nChainDepth, 1, 1);
+	// few directories with many entries each
+	nRet += fofi::bench::benchMove("Crowded directories", 51, 50, nCrowdedFiles);
+	return ((nRet == 0) ? 0 : 1);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchMemory.cxx
+ */
+
+#include "fofimodel.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "testingutil.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include <stdio.h>
+
+namespace fofi
+{
+namespace bench
+{
+
+void printBytes(const std::string& sTitle, int64_t nBytes, int32_t nTotDirs)
+{
+	const double fPerDir = static_cast<double>(nBytes) / nTotDirs;
+	std::cout << sTitle << (nBytes / 1024) << " KiB  (" << static_cast<int64_t>(fPerDir) << " bytes/dir, "
+			<< static_cast<int64_t>(fPerDir * 1000000 / (1024 * 1024)) << " MiB per million dirs)" << '\n';
+}
+
+/* Measures the resident memory used by the model for watching a tree
+ * and for the results of moving it within the watched area. */
+int benchMemory(int32_t nTotDirs, int32_t nFilesPerDir)
+{
+	const std::string sBasePath = testing::getTempDir();
+	const std::string sFromPath = sBasePath + "/From/T";
+	const std::string sToPath = sBasePath + "/To/T";
+	testing::makePath(sBasePath + "/To");
+	const TreeSize oSize = createTree(sFromPath, nTotDirs, 10, nFilesPerDir);
+	std::cout << "Tree: " << oSize.m_nDirs << " dirs, " << oSize.m_nFiles << " files" << '\n';
+
+	auto refML = Glib::MainLoop::create();
+	{ // destroy the model before removing the tree
+		const int64_t nStartRSS = testing::getResidentBytes();
+		FofiModel oFofiModel(nTotDirs * 2 + 1000, (oSize.m_nDirs + oSize.m_nFiles) * 2 + 1000);
+		std::string sAbortError;
+		oFofiModel.m_oAbortSignal.connect([&](const std::string& sError)
+		{
+			sAbortError = sError;
+		});
+
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		oDZ.m_nMaxDepth = nTotDirs + 10;
+		auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+		if (sErr.empty()) {
+			sErr = oFofiModel.start();
+		}
+		if (! sErr.empty()) {
+			std::cout << sErr << '\n';
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+		const int64_t nWatchingRSS = testing::getResidentBytes();
+
+		const int64_t nMoveUsec = Util::getNowTimeMicroseconds();
+		::rename(sFromPath.c_str(), sToPath.c_str());
+		runUntilResultsStable(oFofiModel, refML, nMoveUsec);
+		const int64_t nResultsRSS = testing::getResidentBytes();
+		oFofiModel.stop();
+
+		if (! sAbortError.empty()) {
+			std::cout << "  aborted: " << sAbortError << '\n';
+		}
+		printBytes("  watching: ", nWatchingRSS - nStartRSS, oSize.m_nDirs);
+		printBytes("  results:  ", nResultsRSS - nWatchingRSS, oSize.m_nDirs);
+		std::cout << "            (" << oFofiModel.getWatchedResults().size() << " results)" << '\n';
+	}
+	removeTree(sBasePath);
+	return 0;
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// benchMemory [TOT_DIRS [FILES_PER_DIR]]
+	// Note: each directory needs an inotify watch (see /proc/sys/fs/inotify/max_user_watches)
+	const int32_t nTotDirs = ((argc > 1) ? std::atoi(argv[1]) : 40000);
+	const int32_t nFilesPerDir = ((argc > 2) ? std::atoi(argv[2]) : 4);
+	if ((nTotDirs <= 0) || (nFilesPerDir < 0)) {
+		std::cerr << "Usage: benchMemory [TOT_DIRS [FILES_PER_DIR]]" << '\n';
+		return 1;
+	}
+	return fofi::bench::benchMemory(nTotDirs, nFilesPerDir);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchSetup.cxx
+ */
+
+#include "fofimodel.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "testingutil.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+#include <string>
+#include <cstdlib>
+
+#include <stdio.h>
+
+namespace fofi
+{
+namespace bench
+{
+
+void printPhase(const std::string& sPhase, int64_t nUsec, int64_t nRSSBytes, int64_t nModelBytes, int32_t nTotDirs)
+{
+	std::cout << "  " << std::left << std::setw(22) << sPhase << std::right
+			<< std::setw(8) << (nUsec / 1000) << " ms " << std::setw(8) << std::fixed << std::setprecision(2)
+			<< (static_cast<double>(nUsec) / nTotDirs) << " us/dir "
+			<< std::setw(8) << (nRSSBytes / 1024) << " KiB " << std::setw(6) << (nRSSBytes / nTotDirs) << " bytes/dir";
+	if (nModelBytes >= 0) {
+		std::cout << "  (model " << (nModelBytes / nTotDirs) << " bytes/dir)";
+	}
+	std::cout << '\n';
+}
+
+enum SETUP_PHASE
+{
+	SETUP_PHASE_COUNT = 0 /* calcToWatchDirectories() like --dont-watch */
+	, SETUP_PHASE_COUNT_CACHED = 1 /* calcToWatchDirectories() with an up to date scan cache */
+	, SETUP_PHASE_START = 2 /* start() adding the watches */
+};
+
+/* Runs a setup phase in a new model and measures its time and the resident memory it added. */
+int benchPhase(const std::string& sPhase, SETUP_PHASE ePhase, const std::string& sBasePath
+				, const std::string& sScanCachePath, const TreeSize& oSize)
+{
+	const int64_t nStartRSS = testing::getResidentBytes();
+	FofiModel oFofiModel(oSize.m_nDirs * 2 + 1000, (oSize.m_nDirs + oSize.m_nFiles) * 2 + 1000);
+	std::string sAbortError;
+	oFofiModel.m_oAbortSignal.connect([&](const std::string& sError)
+	{
+		sAbortError = sError;
+	});
+	if (ePhase == SETUP_PHASE_COUNT_CACHED) {
+		oFofiModel.setScanCache(sScanCachePath);
+	}
+	FofiModel::DirectoryZone oDZ;
+	oDZ.m_sPath = sBasePath;
+	oDZ.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+	const int64_t nStartUsec = Util::getNowTimeMicroseconds();
+	if (sErr.empty()) {
+		if (ePhase == SETUP_PHASE_START) {
+			sErr = oFofiModel.start();
+		} else {
+			sErr = oFofiModel.calcToWatchDirectories();
+		}
+	}
+	const int64_t nPhaseUsec = Util::getNowTimeMicroseconds() - nStartUsec;
+	if (! sErr.empty()) {
+		std::cout << "  " << sPhase << ": " << sErr << '\n';
+		return 1; //----------------------------------------------------------------
+	}
+	const int64_t nPhaseRSS = testing::getResidentBytes() - nStartRSS;
+	const auto& aTWDs = oFofiModel.getToWatchDirectories();
+	const int32_t nTotTWDs = std::accumulate(aTWDs.begin(), aTWDs.end(), 0
+							, [&](int32_t nCurTot, const FofiModel::ToWatchDir& oTWD)
+		{
+			const bool bCount = ((ePhase == SETUP_PHASE_START) ? oTWD.isWatched() : oTWD.exists());
+			return nCurTot + (bCount ? 1 : 0);
+		});
+	printPhase(sPhase, nPhaseUsec, nPhaseRSS, oFofiModel.getMetrics().m_nModelBytes, oSize.m_nDirs);
+	if (ePhase == SETUP_PHASE_START) {
+		const int64_t nStopUsec = Util::getNowTimeMicroseconds();
+		oFofiModel.stop();
+		printPhase("stop", Util::getNowTimeMicroseconds() - nStopUsec, 0, -1, oSize.m_nDirs);
+	}
+	std::cout << "  " << std::left << std::setw(22) << "" << std::right
+			<< nTotTWDs << ((ePhase == SETUP_PHASE_START) ? " watched" : " potentially watched") << " directories" << '\n';
+	if (! sAbortError.empty()) {
+		std::cout << "  aborted: " << sAbortError << '\n';
+		return 1; //----------------------------------------------------------------
+	}
+	return 0;
+}
+
+int benchSetup(const std::string& sTitle, const TreeSpec& oSpec)
+{
+	const std::string sBasePath = testing::getTempDir();
+	const std::string sScanCachePath = sBasePath + ".scancache";
+	const int64_t nGenerateUsec = Util::getNowTimeMicroseconds();
+	const TreeSize oSize = generateTree(sBasePath + "/T", oSpec);
+	std::cout << sTitle << ": " << oSize.m_nDirs << " dirs, " << oSize.m_nFiles << " files (seed " << oSpec.m_nSeed << ")" << '\n';
+	printPhase("generate", Util::getNowTimeMicroseconds() - nGenerateUsec, 0, -1, oSize.m_nDirs);
+
+	int32_t nRet = 0;
+	nRet += benchPhase("count (--dont-watch)", SETUP_PHASE_COUNT, sBasePath, sScanCachePath, oSize);
+	// the first run fills the scan cache
+	nRet += benchPhase("count, cold cache", SETUP_PHASE_COUNT_CACHED, sBasePath, sScanCachePath, oSize);
+	nRet += benchPhase("count, warm cache", SETUP_PHASE_COUNT_CACHED, sBasePath, sScanCachePath, oSize);
+	nRet += benchPhase("start", SETUP_PHASE_START, sBasePath, sScanCachePath, oSize);
+
+	::remove(sScanCachePath.c_str());
+	removeTree(sBasePath);
+	return ((nRet == 0) ? 0 : 1);
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// benchSetup [TOT_DIRS [MAX_FILES_PER_DIR [MAX_NAME_LEN [SEED]]]]
+	// Note: start needs an inotify watch per directory (see /proc/sys/fs/inotify/max_user_watches)
+	const int32_t nTotDirs = ((argc > 1) ? std::atoi(argv[1]) : 50000);
+	const int32_t nMaxFilesPerDir = ((argc > 2) ? std::atoi(argv[2]) : 20);
+	const int32_t nMaxNameLen = ((argc > 3) ? std::atoi(argv[3]) : 24);
+	const uint32_t nSeed = ((argc > 4) ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 20200601);
+	if ((nTotDirs <= 0) || (nMaxFilesPerDir < 0) || (nMaxNameLen < 8)) {
+		std::cerr << "Usage: benchSetup [TOT_DIRS [MAX_FILES_PER_DIR [MAX_NAME_LEN [SEED]]]]" << '\n';
+		return 1;
+	}
+	auto refML = Glib::MainLoop::create();
+
+	int32_t nRet = 0;
+	fofi::bench::TreeSpec oSpec;
+	oSpec.m_nTotDirs = nTotDirs;
+	oSpec.m_nMaxFilesPerDir = nMaxFilesPerDir;
+	oSpec.m_nMaxNameLen = nMaxNameLen;
+	oSpec.m_nSeed = nSeed;
+	{
+		fofi::bench::TreeSpec oWide = oSpec;
+		oWide.m_nMaxDepth = 6;
+		oWide.m_nMinFanOut = 5;
+		oWide.m_nMaxFanOut = 30;
+		nRet += fofi::bench::benchSetup("Wide tree", oWide);
+	}
+	{
+		// like a source tree with deep package hierarchies
+		fofi::bench::TreeSpec oDeep = oSpec;
+		oDeep.m_nMaxDepth = 40;
+		oDeep.m_nMinFanOut = 1;
+		oDeep.m_nMaxFanOut = 3;
+		nRet += fofi::bench::benchSetup("Deep tree", oDeep);
+	}
+	{
+		// few directories with many entries each
+		fofi::bench::TreeSpec oCrowded = oSpec;
+		oCrowded.m_nTotDirs = std::max(1, nTotDirs / 100);
+		oCrowded.m_nMaxDepth = 2;
+		oCrowded.m_nMinFanOut = 10;
+		oCrowded.m_nMaxFanOut = 50;
+		oCrowded.m_nMinFilesPerDir = nMaxFilesPerDir * 25;
+		oCrowded.m_nMaxFilesPerDir = nMaxFilesPerDir * 50;
+		nRet += fofi::bench::benchSetup("Crowded directories", oCrowded);
+	}
+	return ((nRet == 0) ? 0 : 1);
+}
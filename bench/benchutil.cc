@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchutil.cc
+ */
+
+#include "benchutil.h"
+
+#include "fofimodel.h"
+#include "util.h"
+
+#include "testingutil.h"
+
+#include <deque>
+#include <random>
+#include <utility>
+#include <cassert>
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <ftw.h>
+#include <unistd.h>
+
+namespace fofi
+{
+namespace bench
+{
+
+void createFile(const std::string& sPathName)
+{
+	const auto nFD = ::open(sPathName.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (nFD >= 0) {
+		::close(nFD);
+	}
+}
+
+TreeSize createTree(const std::string& sRootPath, int32_t nTotDirs, int32_t nFanOut, int32_t nFilesPerDir)
+{
+	TreeSize oSize;
+	std::deque<std::string> aToVisit;
+	testing::makePath(sRootPath);
+	++oSize.m_nDirs;
+	aToVisit.push_back(sRootPath);
+	while (! aToVisit.empty()) {
+		const std::string sDirPath = aToVisit.front();
+		aToVisit.pop_front();
+		for (int32_t nFile = 0; nFile < nFilesPerDir; ++nFile) {
+			createFile(sDirPath + "/f" + std::to_string(nFile) + ".txt");
+			++oSize.m_nFiles;
+		}
+		for (int32_t nSub = 0; (nSub < nFanOut) && (oSize.m_nDirs < nTotDirs); ++nSub) {
+			const std::string sSubPath = sDirPath + "/d" + std::to_string(nSub);
+			testing::makePath(sSubPath);
+			++oSize.m_nDirs;
+			aToVisit.push_back(sSubPath);
+		}
+	}
+	return oSize;
+}
+
+int32_t randomInRange(std::mt19937& oRandom, int32_t nMin, int32_t nMax)
+{
+	assert(nMin <= nMax);
+	return nMin + static_cast<int32_t>(oRandom() % static_cast<uint32_t>(nMax - nMin + 1));
+}
+// The name starts with a unique prefix and is padded with random characters
+static std::string generateName(std::mt19937& oRandom, const TreeSpec& oSpec, char cKind, int32_t nIdx)
+{
+	static const char* const s_p0Chars = "abcdefghijklmnopqrstuvwxyz0123456789_-.";
+	static constexpr int32_t s_nTotChars = 39;
+	std::string sName = cKind + std::to_string(nIdx) + "_";
+	const int32_t nLen = randomInRange(oRandom, oSpec.m_nMinNameLen, oSpec.m_nMaxNameLen);
+	while (static_cast<int32_t>(sName.size()) < nLen) {
+		sName += s_p0Chars[randomInRange(oRandom, 0, s_nTotChars - 1)];
+	}
+	return sName;
+}
+TreeSize generateTree(const std::string& sRootPath, const TreeSpec& oSpec)
+{
+	assert((oSpec.m_nMinFanOut >= 0) && (oSpec.m_nMinFanOut <= oSpec.m_nMaxFanOut));
+	assert((oSpec.m_nMinFilesPerDir >= 0) && (oSpec.m_nMinFilesPerDir <= oSpec.m_nMaxFilesPerDir));
+	assert((oSpec.m_nMinNameLen >= 4) && (oSpec.m_nMinNameLen <= oSpec.m_nMaxNameLen));
+	std::mt19937 oRandom(oSpec.m_nSeed);
+	TreeSize oSize;
+	std::deque<std::pair<std::string, int32_t>> aToVisit; // Value: path, depth
+	testing::makePath(sRootPath);
+	++oSize.m_nDirs;
+	aToVisit.emplace_back(sRootPath, 0);
+	while (! aToVisit.empty()) {
+		const std::string sDirPath = std::move(aToVisit.front().first);
+		const int32_t nDepth = aToVisit.front().second;
+		aToVisit.pop_front();
+		const int32_t nTotFiles = randomInRange(oRandom, oSpec.m_nMinFilesPerDir, oSpec.m_nMaxFilesPerDir);
+		for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+			createFile(sDirPath + "/" + generateName(oRandom, oSpec, 'f', nFile));
+			++oSize.m_nFiles;
+		}
+		if (nDepth >= oSpec.m_nMaxDepth) {
+			continue; // while ---
+		}
+		const int32_t nFanOut = randomInRange(oRandom, oSpec.m_nMinFanOut, oSpec.m_nMaxFanOut);
+		for (int32_t nSub = 0; (nSub < nFanOut) && (oSize.m_nDirs < oSpec.m_nTotDirs); ++nSub) {
+			std::string sSubPath = sDirPath + "/" + generateName(oRandom, oSpec, 'd', nSub);
+			::mkdir(sSubPath.c_str(), S_IRWXU);
+			++oSize.m_nDirs;
+			aToVisit.emplace_back(std::move(sSubPath), nDepth + 1);
+		}
+	}
+	return oSize;
+}
+
+static int removeTreeEntry(const char* p0Path, const struct stat* /*p0Stat*/, int /*nFlag*/, struct FTW* /*p0FTW*/)
+{
+	::remove(p0Path);
+	return 0;
+}
+void removeTree(const std::string& sPath)
+{
+	::nftw(sPath.c_str(), &removeTreeEntry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+int64_t runUntilResultsStable(FofiModel& oFofiModel, const Glib::RefPtr<Glib::MainLoop>& refML, int64_t nSinceUsec)
+{
+	// the results are considered stable when they don't change for a while
+	const int32_t nStableTicks = 200;
+	const int64_t nGiveUpUsec = 600 * 1000000LL;
+	int32_t nTicks = 0;
+	size_t nLastResults = 0;
+	int64_t nLastChangeUsec = nSinceUsec;
+	auto oAbortConn = oFofiModel.m_oAbortSignal.connect([&](const std::string& /*sError*/)
+	{
+		refML->quit();
+	});
+	Glib::signal_timeout().connect([&]() -> bool
+	{
+		const int64_t nNowUsec = Util::getNowTimeMicroseconds();
+		const size_t nResults = oFofiModel.getWatchedResults().size();
+		if (nResults != nLastResults) {
+			nLastResults = nResults;
+			nLastChangeUsec = nNowUsec;
+			nTicks = 0;
+		} else if (nResults > 0) {
+			++nTicks;
+		}
+		if ((nTicks >= nStableTicks) || (nNowUsec - nSinceUsec > nGiveUpUsec)) {
+			refML->quit();
+			return false;
+		}
+		return true;
+	}, 1);
+	refML->run();
+	oAbortConn.disconnect();
+	return nLastChangeUsec;
+}
+
+} // namespace bench
+} // namespace fofi
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   benchutil.h
+ */
+
+#ifndef FOFIMON_BENCH_UTIL_H_
+#define FOFIMON_BENCH_UTIL_H_
+
+#include <glibmm.h>
+
+#include <string>
+#include <random>
+
+#include <stdint.h>
+
+namespace fofi
+{
+class FofiModel;
+namespace bench
+{
+
+struct TreeSize
+{
+	int32_t m_nDirs = 0;
+	int32_t m_nFiles = 0;
+};
+
+/** The shape of a generated tree.
+ * Counts and name lengths are uniformly distributed between min and max.
+ */
+struct TreeSpec
+{
+	int32_t m_nTotDirs = 1000; /**< The max number of directories including the root. */
+	int32_t m_nMaxDepth = 10; /**< The max depth of a directory relative to the root. */
+	int32_t m_nMinFanOut = 1; /**< The min number of subdirectories of a directory not at max depth. */
+	int32_t m_nMaxFanOut = 10; /**< The max number of subdirectories of a directory. */
+	int32_t m_nMinFilesPerDir = 0; /**< The min number of files in a directory. */
+	int32_t m_nMaxFilesPerDir = 10; /**< The max number of files in a directory. */
+	int32_t m_nMinNameLen = 4; /**< The min length of a name. Must be &gt;= 4. */
+	int32_t m_nMaxNameLen = 16; /**< The max length of a name. Must be &gt;= m_nMinNameLen. */
+	uint32_t m_nSeed = 1; /**< The same seed and values always generate the same tree. */
+};
+
+/** A random number in a range.
+ * Only uses the raw output of the generator, the distributions of the
+ * standard library are implementation defined.
+ * @param oRandom The generator. Its sequence is the same on all platforms.
+ * @param nMin The min value.
+ * @param nMax The max value. Must be &gt;= nMin.
+ * @return The number, including nMin and nMax.
+ */
+int32_t randomInRange(std::mt19937& oRandom, int32_t nMin, int32_t nMax);
+/** Creates an empty file.
+ * @param sPathName The file path.
+ */
+void createFile(const std::string& sPathName);
+/** Creates a tree of directories and files.
+ * Each directory has at most nFanOut subdirectories and nFilesPerDir files.
+ * If nFanOut is 1 the tree is a chain of nested directories.
+ * @param sRootPath The root of the tree. Is created.
+ * @param nTotDirs The number of directories including the root.
+ * @param nFanOut The max number of subdirectories of a directory.
+ * @param nFilesPerDir The number of files in each directory.
+ * @return The number of created directories and files.
+ */
+TreeSize createTree(const std::string& sRootPath, int32_t nTotDirs, int32_t nFanOut, int32_t nFilesPerDir);
+/** Creates a random but deterministic tree of directories and files.
+ * The directories are created breadth first so that the tree is as
+ * balanced as the spec allows when m_nTotDirs is reached.
+ * @param sRootPath The root of the tree. Is created.
+ * @param oSpec The shape of the tree.
+ * @return The number of created directories and files.
+ */
+TreeSize generateTree(const std::string& sRootPath, const TreeSpec& oSpec);
+/** Removes a directory and all its contents.
+ * @param sPath The path.
+ */
+void removeTree(const std::string& sPath);
+/** Runs the main loop until the results of the model don't change for a while.
+ * The loop is also quit if the model emits the abort signal.
+ * @param oFofiModel The running model.
+ * @param refML The main loop.
+ * @param nSinceUsec When the changes were triggered (see Util::getNowTimeMicroseconds()).
+ * @return When the results changed last.
+ */
+int64_t runUntilResultsStable(FofiModel& oFofiModel, const Glib::RefPtr<Glib::MainLoop>& refML, int64_t nSinceUsec);
+
+} // namespace bench
+} // namespace fofi
+
+#endif /* FOFIMON_BENCH_UTIL_H_ */
@@ -0,0 +1,492 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   fofimonBench.cxx
+ */
+
+#include "fofimodel.h"
+#include "latencyhistogram.h"
+#include "util.h"
+
+#include "benchutil.h"
+#include "fakesource.h"
+#include "testingutil.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+
+#include <stdio.h>
+#include <dirent.h>
+#include <unistd.h>
+
+namespace fofi
+{
+namespace bench
+{
+
+using testing::FakeSource;
+
+static constexpr uint32_t s_nDefaultSeed = 20200601;
+static constexpr int32_t s_nMaxToWatchDirs = 10000000;
+static constexpr int32_t s_nMaxResults = 50000000;
+static constexpr int32_t s_nMaxDepth = 9999;
+
+/* Sends synthetic inotify events to a model through its fake source and
+ * measures how long the model takes to process each of them.
+ * The change an event describes must already have been applied to the file system. */
+class Injector
+{
+public:
+	explicit Injector(FofiModel& oFofiModel)
+	: m_oFofiModel(oFofiModel)
+	, m_p0Source(static_cast<FakeSource*>(oFofiModel.getSource()))
+	, m_nTotEvents(0)
+	, m_nTotNsec(0)
+	{
+	}
+	// Returns -1 if the directory isn't watched
+	int32_t findDirTag(const std::string& sDirPath)
+	{
+		const auto itFind = m_oTagCache.find(sDirPath);
+		if (itFind != m_oTagCache.end()) {
+			return itFind->second; //-------------------------------------------
+		}
+		int32_t nTWDIdx = m_oFofiModel.getRootToWatchDirectoriesIdx();
+		std::string sCurPath;
+		for (const auto& sName : testing::splitAbsolutePath(sDirPath)) {
+			sCurPath += "/" + sName;
+			const auto& aTWDs = m_oFofiModel.getToWatchDirectories();
+			int32_t nFoundIdx = -1;
+			for (const int32_t nSubIdx : aTWDs[nTWDIdx].getToWatchSubDirIdxs()) {
+				if ((! aTWDs[nSubIdx].isFree()) && (m_oFofiModel.getToWatchDirPath(nSubIdx) == sCurPath)) {
+					nFoundIdx = nSubIdx;
+					break; // for nSubIdx ---
+				}
+			}
+			if (nFoundIdx < 0) {
+				return -1; //-----------------------------------------------------
+			}
+			nTWDIdx = nFoundIdx;
+		}
+		if (! m_oFofiModel.getToWatchDirectories()[nTWDIdx].isWatched()) {
+			return -1; //---------------------------------------------------------
+		}
+		m_oTagCache.emplace(sDirPath, nTWDIdx);
+		return nTWDIdx;
+	}
+	// Must be called after a watched directory was renamed or removed
+	void forgetDirs()
+	{
+		m_oTagCache.clear();
+	}
+	void inject(const std::string& sDirPath, const std::string& sName, bool bIsDir
+				, INotifierSource::FOFI_ACTION eAction, int32_t nRenameCookie = 0)
+	{
+		const int32_t nTag = findDirTag(sDirPath);
+		if (nTag < 0) {
+			return; //--------------------------------------------------------------
+		}
+		INotifierSource::FofiData oFD;
+		oFD.m_nTag = nTag;
+		oFD.m_sName = sName;
+		oFD.m_bIsDir = bIsDir;
+		oFD.m_eAction = eAction;
+		oFD.m_nRenameCookie = nRenameCookie;
+		const int64_t nStartNsec = Util::getNowTimeNanoseconds();
+		oFD.m_nReadTimeNsec = nStartNsec;
+		m_p0Source->callback(oFD);
+		const int64_t nEventNsec = Util::getNowTimeNanoseconds() - nStartNsec;
+		m_oLatency.record(nEventNsec);
+		m_nTotNsec += nEventNsec;
+		++m_nTotEvents;
+	}
+	int64_t getTotEvents() const { return m_nTotEvents; }
+	int64_t getTotNsec() const { return m_nTotNsec; }
+	const LatencyHistogram& getLatency() const { return m_oLatency; }
+private:
+	FofiModel& m_oFofiModel;
+	FakeSource* m_p0Source;
+	std::unordered_map<std::string, int32_t> m_oTagCache; // Key: dir path, Value: ToWatchDir index
+	LatencyHistogram m_oLatency;
+	int64_t m_nTotEvents;
+	int64_t m_nTotNsec;
+};
+
+using Random = std::mt19937; // its sequence is the same on all platforms
+
+struct Workload
+{
+	std::string m_sName;
+	std::string m_sTitle;
+	// Creates the initial tree in the base path
+	std::function<void(const std::string& sBasePath, int32_t nScale)> m_oPrepare;
+	// Customizes the directory zone of the base path (max depth is s_nMaxDepth)
+	std::function<void(FofiModel::DirectoryZone& oDZ)> m_oSetupZone;
+	// Applies the changes and injects the events
+	std::function<void(Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)> m_oRun;
+};
+
+void printMicroseconds(int64_t nNsec)
+{
+	std::cout << std::fixed << std::setprecision(2) << (nNsec / 1000.0) << " us";
+}
+
+int runWorkload(const Workload& oWorkload, int32_t nScale, uint32_t nSeed)
+{
+	const std::string sBasePath = testing::getTempDir();
+	testing::makePath(sBasePath);
+	if (oWorkload.m_oPrepare) {
+		oWorkload.m_oPrepare(sBasePath, nScale);
+	}
+	int32_t nRet = 0;
+	const int64_t nStartRSS = testing::getResidentBytes();
+	{ // destroy the model before removing the tree
+		FofiModel oFofiModel(std::make_unique<FakeSource>(0), s_nMaxToWatchDirs, s_nMaxResults, false);
+		std::string sAbortError;
+		oFofiModel.m_oAbortSignal.connect([&](const std::string& sError)
+		{
+			sAbortError = sError;
+		});
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		oDZ.m_nMaxDepth = s_nMaxDepth;
+		if (oWorkload.m_oSetupZone) {
+			oWorkload.m_oSetupZone(oDZ);
+		}
+		auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+		if (sErr.empty()) {
+			sErr = oFofiModel.start();
+		}
+		if (! sErr.empty()) {
+			std::cout << oWorkload.m_sTitle << ": " << sErr << '\n';
+			removeTree(sBasePath);
+			return 1; //------------------------------------------------------------
+		}
+		Injector oInjector(oFofiModel);
+		Random oRandom(nSeed);
+		oWorkload.m_oRun(oInjector, sBasePath, nScale, oRandom);
+		const int64_t nEndRSS = testing::getResidentBytes();
+
+		const int64_t nTotEvents = oInjector.getTotEvents();
+		const int64_t nTotNsec = std::max<int64_t>(1, oInjector.getTotNsec());
+		const LatencyHistogram& oLatency = oInjector.getLatency();
+		std::cout << oWorkload.m_sTitle << " (" << oWorkload.m_sName << "): " << nTotEvents << " events" << '\n';
+		std::cout << "  throughput: " << static_cast<int64_t>(nTotEvents * 1e9 / nTotNsec) << " events/s" << '\n';
+		std::cout << "  latency:    p50 ";
+		printMicroseconds(oLatency.getValueAtPercentile(50.0));
+		std::cout << ", p99 ";
+		printMicroseconds(oLatency.getValueAtPercentile(99.0));
+		std::cout << ", p99.9 ";
+		printMicroseconds(oLatency.getValueAtPercentile(99.9));
+		std::cout << ", max ";
+		printMicroseconds(oLatency.getMax());
+		std::cout << '\n';
+		std::cout << "  results:    " << oFofiModel.getWatchedResults().size() << '\n';
+		std::cout << "  memory:     " << (nEndRSS - nStartRSS) / 1024 << " KiB more resident, peak "
+					<< Util::getPeakResidentBytes() / 1024 << " KiB" << '\n';
+		if (oFofiModel.hasInconsistencies()) {
+			std::cout << "  warning:    inconsistencies detected" << '\n';
+		}
+		if (! sAbortError.empty()) {
+			std::cout << "  aborted:    " << sAbortError << '\n';
+			nRet = 1;
+		}
+		oFofiModel.stop();
+	}
+	removeTree(sBasePath);
+	return nRet;
+}
+
+std::string getDirName(int32_t nDir)
+{
+	return "d" + std::to_string(nDir);
+}
+void createFlatDirs(const std::string& sBasePath, int32_t nTotDirs, int32_t nFilesPerDir, const std::string& sExt)
+{
+	for (int32_t nDir = 0; nDir < nTotDirs; ++nDir) {
+		const std::string sDirPath = sBasePath + "/" + getDirName(nDir);
+		testing::makePath(sDirPath);
+		for (int32_t nFile = 0; nFile < nFilesPerDir; ++nFile) {
+			createFile(sDirPath + "/f" + std::to_string(nFile) + sExt);
+		}
+	}
+}
+
+/* Removes a tree bottom up, sending the delete event of each entry
+ * right after removing it, as "rm -rf" does. */
+void removeTreeInjecting(Injector& oInjector, const std::string& sDirPath)
+{
+	std::vector<std::pair<std::string, bool>> aEntries;
+	DIR* p0Dir = ::opendir(sDirPath.c_str());
+	if (p0Dir == nullptr) {
+		return; //--------------------------------------------------------------
+	}
+	struct dirent* p0Entry;
+	while ((p0Entry = ::readdir(p0Dir)) != nullptr) {
+		const std::string sName = p0Entry->d_name;
+		if ((sName == ".") || (sName == "..")) {
+			continue; // while ---
+		}
+		const bool bIsDir = Util::FileStat::create(sDirPath + "/" + sName).isDir();
+		aEntries.emplace_back(sName, bIsDir);
+	}
+	::closedir(p0Dir);
+	for (const auto& oEntry : aEntries) {
+		const std::string sPath = sDirPath + "/" + oEntry.first;
+		if (oEntry.second) {
+			removeTreeInjecting(oInjector, sPath);
+		}
+		::remove(sPath.c_str());
+		oInjector.inject(sDirPath, oEntry.first, oEntry.second, INotifierSource::FOFI_ACTION_DELETE);
+	}
+	oInjector.forgetDirs();
+}
+
+std::vector<Workload> createWorkloads()
+{
+	std::vector<Workload> aWorkloads;
+	{
+		// many new files in few directories
+		Workload oW;
+		oW.m_sName = "create-storm";
+		oW.m_sTitle = "Create storm";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t /*nScale*/)
+		{
+			createFlatDirs(sBasePath, 100, 0, "");
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)
+		{
+			const int32_t nTotFiles = 10000 * nScale;
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				const std::string sDirPath = sBasePath + "/" + getDirName(randomInRange(oRandom, 0, 99));
+				const std::string sName = "n" + std::to_string(nFile) + ".txt";
+				createFile(sDirPath + "/" + sName);
+				oInjector.inject(sDirPath, sName, false, INotifierSource::FOFI_ACTION_CREATE);
+				oInjector.inject(sDirPath, sName, false, INotifierSource::FOFI_ACTION_MODIFY);
+			}
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	{
+		// repeated writes to existing files
+		Workload oW;
+		oW.m_sName = "modify-storm";
+		oW.m_sTitle = "Modify storm";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t /*nScale*/)
+		{
+			createFlatDirs(sBasePath, 100, 100, ".txt");
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)
+		{
+			const int32_t nTotEvents = 20000 * nScale;
+			for (int32_t nEvent = 0; nEvent < nTotEvents; ++nEvent) {
+				const std::string sDirPath = sBasePath + "/" + getDirName(randomInRange(oRandom, 0, 99));
+				const std::string sName = "f" + std::to_string(randomInRange(oRandom, 0, 99)) + ".txt";
+				oInjector.inject(sDirPath, sName, false, INotifierSource::FOFI_ACTION_MODIFY);
+			}
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	{
+		// a deep chain of directories moved back and forth
+		Workload oW;
+		oW.m_sName = "deep-rename";
+		oW.m_sTitle = "Deep renames";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t /*nScale*/)
+		{
+			testing::makePath(sBasePath + "/B");
+			createTree(sBasePath + "/A/C", 200, 1, 2);
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)
+		{
+			const std::string sPathA = sBasePath + "/A";
+			const std::string sPathB = sBasePath + "/B";
+			const int32_t nTotRenames = 50 * nScale;
+			int32_t nCookie = 0;
+			bool bInA = true;
+			for (int32_t nRename = 0; nRename < nTotRenames; ++nRename) {
+				// the new name makes the model rebuild the paths of the subtree
+				const std::string sToName = "C" + std::to_string(randomInRange(oRandom, 0, 999999));
+				const std::string sFromName = ((nRename == 0) ? "C" : "C" + std::to_string(nCookie));
+				const std::string& sFromDir = (bInA ? sPathA : sPathB);
+				const std::string& sToDir = (bInA ? sPathB : sPathA);
+				::rename((sFromDir + "/" + sFromName).c_str(), (sToDir + "/" + sToName).c_str());
+				++nCookie;
+				oInjector.inject(sFromDir, sFromName, true, INotifierSource::FOFI_ACTION_RENAME_FROM, nCookie);
+				oInjector.inject(sToDir, sToName, true, INotifierSource::FOFI_ACTION_RENAME_TO, nCookie);
+				oInjector.forgetDirs();
+				// rename the result to the cookie based name so that the next rename finds it
+				::rename((sToDir + "/" + sToName).c_str(), (sToDir + "/C" + std::to_string(nCookie)).c_str());
+				++nCookie;
+				oInjector.inject(sToDir, sToName, true, INotifierSource::FOFI_ACTION_RENAME_FROM, nCookie);
+				oInjector.inject(sToDir, "C" + std::to_string(nCookie - 1), true, INotifierSource::FOFI_ACTION_RENAME_TO, nCookie);
+				oInjector.forgetDirs();
+				bInA = ! bInA;
+			}
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	{
+		Workload oW;
+		oW.m_sName = "rm-rf";
+		oW.m_sTitle = "Recursive removal";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t nScale)
+		{
+			createTree(sBasePath + "/T", 2000 * nScale, 10, 5);
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t /*nScale*/, Random& /*oRandom*/)
+		{
+			removeTreeInjecting(oInjector, sBasePath + "/T");
+			::remove((sBasePath + "/T").c_str());
+			oInjector.inject(sBasePath, "T", true, INotifierSource::FOFI_ACTION_DELETE);
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	{
+		// a compiler writing object files next to a source tree
+		Workload oW;
+		oW.m_sName = "build";
+		oW.m_sTitle = "Mixed build";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t /*nScale*/)
+		{
+			createFlatDirs(sBasePath + "/src", 50, 20, ".c");
+			testing::makePath(sBasePath + "/build");
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)
+		{
+			const std::string sBuildPath = sBasePath + "/build";
+			std::vector<bool> aBuildDirCreated(50, false);
+			const int32_t nTotSteps = 2500 * nScale;
+			int32_t nCookie = 0;
+			for (int32_t nStep = 0; nStep < nTotSteps; ++nStep) {
+				const int32_t nDir = randomInRange(oRandom, 0, 49);
+				const std::string sDirName = getDirName(nDir);
+				const std::string sSrcName = "f" + std::to_string(randomInRange(oRandom, 0, 19));
+				if (randomInRange(oRandom, 0, 3) == 0) {
+					// the source is edited
+					oInjector.inject(sBasePath + "/src/" + sDirName, sSrcName + ".c", false, INotifierSource::FOFI_ACTION_MODIFY);
+				}
+				const std::string sObjDirPath = sBuildPath + "/" + sDirName;
+				if (! aBuildDirCreated[nDir]) {
+					aBuildDirCreated[nDir] = true;
+					testing::makePath(sObjDirPath);
+					oInjector.inject(sBuildPath, sDirName, true, INotifierSource::FOFI_ACTION_CREATE);
+				}
+				const std::string sTmpName = sSrcName + ".o.tmp";
+				const std::string sObjName = sSrcName + ".o";
+				createFile(sObjDirPath + "/" + sTmpName);
+				oInjector.inject(sObjDirPath, sTmpName, false, INotifierSource::FOFI_ACTION_CREATE);
+				oInjector.inject(sObjDirPath, sTmpName, false, INotifierSource::FOFI_ACTION_MODIFY);
+				::rename((sObjDirPath + "/" + sTmpName).c_str(), (sObjDirPath + "/" + sObjName).c_str());
+				++nCookie;
+				oInjector.inject(sObjDirPath, sTmpName, false, INotifierSource::FOFI_ACTION_RENAME_FROM, nCookie);
+				oInjector.inject(sObjDirPath, sObjName, false, INotifierSource::FOFI_ACTION_RENAME_TO, nCookie);
+				oInjector.inject(sObjDirPath, sObjName, false, INotifierSource::FOFI_ACTION_ATTRIB);
+				if (randomInRange(oRandom, 0, 9) == 0) {
+					// make clean of a single object
+					::remove((sObjDirPath + "/" + sObjName).c_str());
+					oInjector.inject(sObjDirPath, sObjName, false, INotifierSource::FOFI_ACTION_DELETE);
+				}
+			}
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	{
+		// every event is matched against many filters
+		Workload oW;
+		oW.m_sName = "filters";
+		oW.m_sTitle = "Many filters";
+		oW.m_oPrepare = [](const std::string& sBasePath, int32_t /*nScale*/)
+		{
+			createFlatDirs(sBasePath, 20, 0, "");
+		};
+		oW.m_oSetupZone = [](FofiModel::DirectoryZone& oDZ)
+		{
+			for (int32_t nFilter = 0; nFilter < 200; ++nFilter) {
+				FofiModel::Filter oFilter;
+				oFilter.m_eFilterType = FofiModel::FILTER_REGEX;
+				oFilter.m_sFilter = ".*\\.x" + std::to_string(nFilter);
+				oDZ.m_aFileExcludeFilters.push_back(oFilter);
+			}
+			for (int32_t nFilter = 0; nFilter < 50; ++nFilter) {
+				FofiModel::Filter oFilter;
+				oFilter.m_sFilter = "skip" + std::to_string(nFilter);
+				oDZ.m_aFileExcludeFilters.push_back(oFilter);
+				oDZ.m_aSubDirExcludeFilters.push_back(oFilter);
+			}
+		};
+		oW.m_oRun = [](Injector& oInjector, const std::string& sBasePath, int32_t nScale, Random& oRandom)
+		{
+			const int32_t nTotFiles = 5000 * nScale;
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				const std::string sDirPath = sBasePath + "/" + getDirName(randomInRange(oRandom, 0, 19));
+				// about half of the names are excluded
+				const int32_t nExt = randomInRange(oRandom, 0, 399);
+				const std::string sName = "n" + std::to_string(nFile) + ".x" + std::to_string(nExt);
+				createFile(sDirPath + "/" + sName);
+				oInjector.inject(sDirPath, sName, false, INotifierSource::FOFI_ACTION_CREATE);
+				oInjector.inject(sDirPath, sName, false, INotifierSource::FOFI_ACTION_MODIFY);
+			}
+		};
+		aWorkloads.push_back(std::move(oW));
+	}
+	return aWorkloads;
+}
+
+} // namespace bench
+} // namespace fofi
+
+int main(int argc, char** argv)
+{
+	// fofimon-bench [WORKLOAD [SCALE [SEED]]]
+	const std::string sWorkload = ((argc > 1) ? std::string{argv[1]} : "all");
+	const int32_t nScale = ((argc > 2) ? std::atoi(argv[2]) : 1);
+	const uint32_t nSeed = ((argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : fofi::bench::s_nDefaultSeed);
+	const auto aWorkloads = fofi::bench::createWorkloads();
+	bool bFound = (sWorkload == "all");
+	for (const auto& oWorkload : aWorkloads) {
+		bFound = bFound || (oWorkload.m_sName == sWorkload);
+	}
+	if ((! bFound) || (nScale <= 0)) {
+		std::cerr << "Usage: fofimon-bench [WORKLOAD [SCALE [SEED]]]" << '\n';
+		std::cerr << "WORKLOAD is 'all' (default) or one of:";
+		for (const auto& oWorkload : aWorkloads) {
+			std::cerr << " " << oWorkload.m_sName;
+		}
+		std::cerr << '\n';
+		return 1;
+	}
+	// the fake source doesn't need it, but the model's timers do
+	auto refML = Glib::MainLoop::create();
+	std::cout << "Seed: " << nSeed << "  Scale: " << nScale << '\n';
+	int32_t nRet = 0;
+	for (const auto& oWorkload : aWorkloads) {
+		if ((sWorkload == "all") || (oWorkload.m_sName == sWorkload)) {
+			nRet += fofi::bench::runWorkload(oWorkload, nScale, nSeed);
+		}
+	}
+	return ((nRet == 0) ? 0 : 1);
+}
@@ -33,10 +33,20 @@ if ("${CMAKE_SCRIPT_MODE_FILE}" STREQUAL "")
     endif()
     # Beware! The prefix passed to pkg_check_modules(PREFIX ...) shouldn't contain underscores!
     pkg_check_modules(GLIBMM   REQUIRED  glibmm-2.4>=${FOFIMON_REQ_GLIBMM_VERSION})
+    # The live events writer thread
+    find_package(Threads REQUIRED)
+    # The compression of the '.gz' and '.zst' output files
+    find_package(ZLIB REQUIRED)
+    pkg_check_modules(ZSTD     REQUIRED  libzstd)
 endif()
 
 # include dirs
 list(APPEND FOFIMON_EXTRA_INCLUDE_DIRS  "${GLIBMM_INCLUDE_DIRS}")
+list(APPEND FOFIMON_EXTRA_INCLUDE_DIRS  "${ZLIB_INCLUDE_DIRS}")
+list(APPEND FOFIMON_EXTRA_INCLUDE_DIRS  "${ZSTD_INCLUDE_DIRS}")
 
 # libs
 list(APPEND FOFIMON_EXTRA_LIBRARIES     "${GLIBMM_LIBRARIES}")
+list(APPEND FOFIMON_EXTRA_LIBRARIES     "${CMAKE_THREAD_LIBS_INIT}")
+list(APPEND FOFIMON_EXTRA_LIBRARIES     "${ZLIB_LIBRARIES}")
+list(APPEND FOFIMON_EXTRA_LIBRARIES     "${ZSTD_LIBRARIES}")
@@ -73,6 +73,9 @@ def main():
 
 	if not oArgs.bNoUninstall:
 		subprocess.check_call("{} rm -r -f            {}/bin/fofimon".format(sSudo, sInstallDir).split())
+		subprocess.check_call("{} rm -r -f      {}/bin/fofimon-trace".format(sSudo, sInstallDir).split())
+		subprocess.check_call("{} rm -r -f       {}/bin/fofimon-live".format(sSudo, sInstallDir).split())
+		subprocess.check_call("{} rm -r -f       {}/bin/fofimon-tail".format(sSudo, sInstallDir).split())
 		subprocess.check_call("{} rm -r -f {}/share/man/man1/fofimon.1.gz".format(sSudo, sInstallDir).split())
 
 	if not oArgs.bNoClean:
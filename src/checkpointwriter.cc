@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   checkpointwriter.cc
+ */
+
+#include "checkpointwriter.h"
+
+#include "printout.h"
+#include "jsonwriter.h"
+#include "textwriter.h"
+#include "util.h"
+
+#include <ostream>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+
+static constexpr int32_t s_nCheckpointDigits = 6;
+
+static std::string getFileName(const std::string& sPathName) noexcept
+{
+	const auto nSlashPos = sPathName.rfind('/');
+	return ((nSlashPos == std::string::npos) ? sPathName : sPathName.substr(nSlashPos + 1));
+}
+
+CheckpointWriter::CheckpointWriter() noexcept
+: m_bJSon(false)
+, m_bNDJSon(false)
+, m_nLastCheckpoint(0)
+{
+}
+void CheckpointWriter::init(const std::string& sPathName, const Config& oConfig) noexcept
+{
+	assert(! sPathName.empty());
+	assert(oConfig.m_nMaxFiles >= 0);
+	m_oConfig = oConfig;
+	const std::string sFileName = getFileName(sPathName);
+	const auto nDotPos = sFileName.rfind('.');
+	if ((nDotPos == std::string::npos) || (nDotPos == 0)) {
+		m_sPathStem = sPathName;
+		m_sExtension.clear();
+	} else {
+		const size_t nExtSize = sFileName.size() - nDotPos;
+		m_sPathStem = sPathName.substr(0, sPathName.size() - nExtSize);
+		m_sExtension = sFileName.substr(nDotPos);
+	}
+	m_bNDJSon = (m_sExtension == ".ndjson");
+	m_bJSon = m_bNDJSon || (m_sExtension == ".json");
+	m_nLastCheckpoint = 0;
+	m_aManifest.clear();
+}
+std::string CheckpointWriter::getManifestPathName() const noexcept
+{
+	return m_sPathStem + ".manifest.json";
+}
+std::string CheckpointWriter::getCheckpointPathName(int32_t nCheckpoint) const noexcept
+{
+	assert(nCheckpoint > 0);
+	std::string sNr = std::to_string(nCheckpoint);
+	if (static_cast<int32_t>(sNr.size()) < s_nCheckpointDigits) {
+		sNr.insert(0, s_nCheckpointDigits - sNr.size(), '0');
+	}
+	return m_sPathStem + "." + sNr + m_sExtension;
+}
+std::string CheckpointWriter::write(FofiModel& oFofiModel)
+{
+	assert(! m_sPathStem.empty());
+	if (! oFofiModel.hasChangedResults()) {
+		return ""; //-----------------------------------------------------------
+	}
+	const int64_t nDurationUsec = oFofiModel.getDuration();
+	const int32_t nCheckpoint = m_nLastCheckpoint + 1;
+	int32_t nTotResults = 0;
+	const auto sError = Util::writeFileAtomically(getCheckpointPathName(nCheckpoint), [&](std::ostream& oOut)
+	{
+		JsonWriter oJsonWriter(oOut, m_bNDJSon);
+		TextWriter oTextWriter(oOut);
+		ResultParentPath oParentPath(oFofiModel);
+		if (m_bJSon) {
+			oJsonWriter.beginSequence();
+		}
+		const auto sSpillError = oFofiModel.forEachChangedResult([&](const FofiModel::WatchedResult& oResult)
+		{
+			if (m_oConfig.m_bSkipTemporary && (oResult.m_eResultType == FofiModel::RESULT_TEMPORARY)) {
+				return; //------------------------------------------------------
+			}
+			++nTotResults;
+			if (m_bJSon) {
+				printResultJSon(oJsonWriter, oFofiModel, oResult, oParentPath.get(oResult), m_oConfig.m_bDetail, nDurationUsec);
+			} else {
+				printResult(oTextWriter, oFofiModel, oResult, oParentPath.get(oResult), m_oConfig.m_bDetail, nDurationUsec);
+			}
+		});
+		if (m_bJSon) {
+			oJsonWriter.endSequence();
+		} else {
+			oTextWriter.flush();
+		}
+		return sSpillError;
+	});
+	if (! sError.empty()) {
+		// the changes are kept for the next attempt
+		return sError; //-------------------------------------------------------
+	}
+	oFofiModel.checkpoint();
+	m_nLastCheckpoint = nCheckpoint;
+	m_aManifest.push_back(ManifestEntry{nCheckpoint, nTotResults, nDurationUsec});
+	if (m_oConfig.m_nMaxFiles > 0) {
+		while (static_cast<int32_t>(m_aManifest.size()) > m_oConfig.m_nMaxFiles) {
+			::unlink(getCheckpointPathName(m_aManifest.front().m_nCheckpoint).c_str());
+			m_aManifest.pop_front();
+		}
+	}
+	return writeManifest();
+}
+std::string CheckpointWriter::writeManifest() noexcept
+{
+	const int64_t nLastTimeUsec = m_aManifest.back().m_nTimeUsec;
+	return Util::writeFileAtomically(getManifestPathName(), [&](std::ostream& oOut)
+	{
+		JsonWriter oJsonWriter(oOut, false);
+		oJsonWriter.beginSequence();
+		for (const ManifestEntry& oEntry : m_aManifest) {
+			oJsonWriter.beginObject();
+			oJsonWriter.key("Checkpoint");
+			oJsonWriter.value(oEntry.m_nCheckpoint);
+			oJsonWriter.key("File");
+			oJsonWriter.fileNameValue(getFileName(getCheckpointPathName(oEntry.m_nCheckpoint)));
+			oJsonWriter.key("Results");
+			oJsonWriter.value(oEntry.m_nTotResults);
+			oJsonWriter.key("Time");
+			oJsonWriter.value(Util::getTimeString(oEntry.m_nTimeUsec, nLastTimeUsec));
+			oJsonWriter.endObject();
+		}
+		oJsonWriter.endSequence();
+		return std::string{};
+	});
+}
+
+} // namespace fofi
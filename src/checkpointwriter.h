@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   checkpointwriter.h
+ */
+
+#ifndef FOFIMON_CHECKPOINT_WRITER_H_
+#define FOFIMON_CHECKPOINT_WRITER_H_
+
+#include "fofimodel.h"
+
+#include <string>
+#include <deque>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Writes the results that changed since the previous checkpoint to numbered files.
+ *
+ * Given the path name "DIR/results.json" the checkpoints are written to
+ * "DIR/results.000001.json", "DIR/results.000002.json", ... and the list of
+ * the checkpoint files to "DIR/results.manifest.json". Text, json or NDJSON
+ * is chosen by the extension like for the -o output.
+ *
+ * A checkpoint file contains only the results that changed (see
+ * FofiModel::forEachChangedResult()), no file is written if none did.
+ * Files are written to a temporary file and then renamed, the manifest is
+ * rewritten after each file, so readers of the manifest only see complete files.
+ *
+ * The manifest is a json array with an object per checkpoint file, for example
+ *
+ *     {"Checkpoint": 3, "File": "results.000003.json", "Results": 12, "Time": "  65.000012"}
+ *
+ * where "Time" is the time from the start of watching. If the number of files
+ * is limited the oldest are deleted and removed from the manifest. */
+class CheckpointWriter
+{
+public:
+	struct Config
+	{
+		int32_t m_nMaxFiles = 0; /**< The max number of checkpoint files kept or 0 if unlimited. */
+		bool m_bDetail = false; /**< Whether to write the actions of each result. */
+		bool m_bSkipTemporary = false; /**< Whether RESULT_TEMPORARY results are left out. */
+	};
+	CheckpointWriter() noexcept;
+	/** Sets the path name from which the file names are derived.
+	 * Nothing is written yet.
+	 * @param sPathName The path name. Cannot be empty.
+	 * @param oConfig The configuration.
+	 */
+	void init(const std::string& sPathName, const Config& oConfig) noexcept;
+	/** Writes the results changed since the previous checkpoint.
+	 * Then calls FofiModel::checkpoint().
+	 * @param oFofiModel The model.
+	 * @return Empty string or error.
+	 */
+	std::string write(FofiModel& oFofiModel);
+
+	/** The number of checkpoint files written so far.
+	 * @return The number of files.
+	 */
+	int32_t getTotWritten() const noexcept { return m_nLastCheckpoint; }
+	/** The path name of the manifest.
+	 * @return The path name.
+	 */
+	std::string getManifestPathName() const noexcept;
+	/** The path name of a checkpoint file.
+	 * @param nCheckpoint The number of the checkpoint. Must be positive.
+	 * @return The path name.
+	 */
+	std::string getCheckpointPathName(int32_t nCheckpoint) const noexcept;
+private:
+	std::string writeManifest() noexcept;
+private:
+	struct ManifestEntry
+	{
+		int32_t m_nCheckpoint;
+		int32_t m_nTotResults;
+		int64_t m_nTimeUsec;
+	};
+	Config m_oConfig;
+	std::string m_sPathStem; // the path name without extension
+	std::string m_sExtension; // with the dot or empty
+	bool m_bJSon;
+	bool m_bNDJSon;
+	int32_t m_nLastCheckpoint;
+	std::deque<ManifestEntry> m_aManifest;
+private:
+	CheckpointWriter(const CheckpointWriter& oSource) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_CHECKPOINT_WRITER_H_ */
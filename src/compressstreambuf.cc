@@ -0,0 +1,326 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   compressstreambuf.cc
+ */
+
+#include "compressstreambuf.h"
+
+#include <system_error>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <zstd.h>
+
+namespace fofi
+{
+
+static constexpr size_t s_nChunkSize = 256 * 1024;
+static constexpr size_t s_nMaxQueuedChunks = 4;
+static constexpr size_t s_nOutBufferSize = 64 * 1024;
+// 15 is the max window, adding 16 writes a gzip header and trailer
+static constexpr int s_nGzipWindowBits = 15 + 16;
+static constexpr int s_nMemLevel = 8;
+static constexpr const char* s_p0GzExtension = ".gz";
+static constexpr const char* s_p0ZstdExtension = ".zst";
+
+CompressStreamBuf::CompressStreamBuf() noexcept
+: m_nFD(-1)
+, m_bOpen(false)
+, m_eCompression(COMPRESSION_NONE)
+, m_nTotInBytes(0)
+, m_p0ZstdCCtx(nullptr)
+, m_bWriteFailed(false)
+, m_nTotWrittenBytes(0)
+, m_bStop(false)
+{
+}
+CompressStreamBuf::~CompressStreamBuf() noexcept
+{
+	close();
+}
+static bool hasExtension(const std::string& sPathName, const char* p0Ext) noexcept
+{
+	const size_t nSize = sPathName.size();
+	const size_t nExtSize = std::strlen(p0Ext);
+	return (nSize > nExtSize) && (sPathName.compare(nSize - nExtSize, nExtSize, p0Ext) == 0);
+}
+CompressStreamBuf::COMPRESSION CompressStreamBuf::getCompression(const std::string& sPathName) noexcept
+{
+	if (hasExtension(sPathName, s_p0GzExtension)) {
+		return COMPRESSION_GZIP; //---------------------------------------------
+	}
+	if (hasExtension(sPathName, s_p0ZstdExtension)) {
+		return COMPRESSION_ZSTD; //---------------------------------------------
+	}
+	return COMPRESSION_NONE;
+}
+std::string CompressStreamBuf::getUncompressedPathName(const std::string& sPathName) noexcept
+{
+	switch (getCompression(sPathName)) {
+	case COMPRESSION_GZIP:
+		return sPathName.substr(0, sPathName.size() - std::strlen(s_p0GzExtension)); //---
+	case COMPRESSION_ZSTD:
+		return sPathName.substr(0, sPathName.size() - std::strlen(s_p0ZstdExtension)); //---
+	default:
+		return sPathName; //----------------------------------------------------
+	}
+}
+bool CompressStreamBuf::initCompressor() noexcept
+{
+	if (m_eCompression == COMPRESSION_GZIP) {
+		m_refZStream = std::make_unique<z_stream_s>();
+		if (::deflateInit2(m_refZStream.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, s_nGzipWindowBits
+							, s_nMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+			m_refZStream.reset();
+			return false; //----------------------------------------------------
+		}
+		return true; //---------------------------------------------------------
+	}
+	m_p0ZstdCCtx = ::ZSTD_createCCtx();
+	if ((m_p0ZstdCCtx == nullptr)
+			|| ::ZSTD_isError(::ZSTD_CCtx_setParameter(m_p0ZstdCCtx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT))
+			|| ::ZSTD_isError(::ZSTD_CCtx_setParameter(m_p0ZstdCCtx, ZSTD_c_checksumFlag, 1))) {
+		::ZSTD_freeCCtx(m_p0ZstdCCtx);
+		m_p0ZstdCCtx = nullptr;
+		return false; //--------------------------------------------------------
+	}
+	return true;
+}
+void CompressStreamBuf::endCompressor() noexcept
+{
+	if (m_refZStream) {
+		::deflateEnd(m_refZStream.get());
+		m_refZStream.reset();
+	}
+	// accepts null
+	::ZSTD_freeCCtx(m_p0ZstdCCtx);
+	m_p0ZstdCCtx = nullptr;
+}
+std::string CompressStreamBuf::open(const std::string& sPathName, COMPRESSION eCompression, bool bAppend)
+{
+	assert(! m_bOpen);
+	assert((eCompression == COMPRESSION_GZIP) || (eCompression == COMPRESSION_ZSTD));
+	m_nFD = ::open(sPathName.c_str(), O_WRONLY | O_CREAT | (bAppend ? O_APPEND : O_TRUNC) | O_CLOEXEC, 0666);
+	if (m_nFD < 0) {
+		return "Could not open " + sPathName + ": " + ::strerror(errno); //-----
+	}
+	m_eCompression = eCompression;
+	if (! initCompressor()) {
+		::close(m_nFD);
+		m_nFD = -1;
+		return "Could not initialize compression for " + sPathName; //---------
+	}
+	m_aOutBuffer.resize(s_nOutBufferSize);
+	m_bWriteFailed = false;
+	m_nTotInBytes = 0;
+	m_nTotWrittenBytes.store(0, std::memory_order_relaxed);
+	m_aQueuedChunks.clear();
+	m_aFreeChunks.clear();
+	m_bStop = false;
+	m_sError.clear();
+	resetPutArea();
+	try {
+		m_oCompressorThread = std::thread(&CompressStreamBuf::compressorThreadRun, this);
+	} catch (const std::system_error& oErr) {
+		setp(nullptr, nullptr);
+		endCompressor();
+		::close(m_nFD);
+		m_nFD = -1;
+		return "Could not start compressor thread for " + sPathName + ": " + oErr.what(); //---
+	}
+	m_bOpen = true;
+	return "";
+}
+std::string CompressStreamBuf::close() noexcept
+{
+	if (! m_bOpen) {
+		return ""; //-----------------------------------------------------------
+	}
+	queueChunk();
+	m_bOpen = false;
+	setp(nullptr, nullptr);
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		m_bStop = true;
+	}
+	m_oChunkQueuedCond.notify_one();
+	m_oCompressorThread.join();
+	endCompressor();
+	if (::close(m_nFD) != 0) {
+		setError(std::string("Could not close compressed output: ") + ::strerror(errno));
+	}
+	m_nFD = -1;
+	return m_sError;
+}
+CompressStreamBuf::int_type CompressStreamBuf::overflow(int_type nC)
+{
+	if (! m_bOpen) {
+		return traits_type::eof(); //-------------------------------------------
+	}
+	queueChunk();
+	if (traits_type::eq_int_type(nC, traits_type::eof())) {
+		return traits_type::not_eof(nC); //-------------------------------------
+	}
+	*pptr() = traits_type::to_char_type(nC);
+	pbump(1);
+	return nC;
+}
+int CompressStreamBuf::sync()
+{
+	// a flush of the stream doesn't end the chunk so that the
+	// compression ratio doesn't depend on how often it's flushed
+	return (m_bOpen ? 0 : -1);
+}
+void CompressStreamBuf::resetPutArea() noexcept
+{
+	m_sChunk.resize(s_nChunkSize);
+	setp(&m_sChunk[0], &m_sChunk[0] + m_sChunk.size());
+}
+void CompressStreamBuf::queueChunk() noexcept
+{
+	const size_t nSize = static_cast<size_t>(pptr() - pbase());
+	if (nSize == 0) {
+		return; //--------------------------------------------------------------
+	}
+	m_sChunk.resize(nSize);
+	m_nTotInBytes += static_cast<int64_t>(nSize);
+	{
+		std::unique_lock<std::mutex> oLock(m_oMutex);
+		m_oChunkDoneCond.wait(oLock, [&]()
+		{
+			return (m_aQueuedChunks.size() < s_nMaxQueuedChunks);
+		});
+		m_aQueuedChunks.push_back(std::move(m_sChunk));
+		if (m_aFreeChunks.empty()) {
+			m_sChunk = std::string{};
+		} else {
+			m_sChunk = std::move(m_aFreeChunks.back());
+			m_aFreeChunks.pop_back();
+		}
+	}
+	m_oChunkQueuedCond.notify_one();
+	resetPutArea();
+}
+void CompressStreamBuf::setError(const std::string& sError) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_sError.empty()) {
+		m_sError = sError;
+	}
+}
+void CompressStreamBuf::compressorThreadRun() noexcept
+{
+	std::unique_lock<std::mutex> oLock(m_oMutex);
+	while (true) {
+		m_oChunkQueuedCond.wait(oLock, [&]()
+		{
+			return (! m_aQueuedChunks.empty()) || m_bStop;
+		});
+		if (m_aQueuedChunks.empty()) {
+			// stopped and all chunks compressed
+			break; // while ----
+		}
+		std::string sChunk = std::move(m_aQueuedChunks.front());
+		m_aQueuedChunks.pop_front();
+		oLock.unlock();
+		compressChunk(sChunk, false);
+		sChunk.clear();
+		oLock.lock();
+		// keeps the capacity
+		m_aFreeChunks.push_back(std::move(sChunk));
+		m_oChunkDoneCond.notify_one();
+	}
+	oLock.unlock();
+	compressChunk(std::string{}, true);
+}
+void CompressStreamBuf::compressChunk(const std::string& sChunk, bool bFinish) noexcept
+{
+	if (m_bWriteFailed) {
+		// the chunk is discarded
+		return; //--------------------------------------------------------------
+	}
+	if (m_eCompression == COMPRESSION_GZIP) {
+		deflateChunk(sChunk, bFinish);
+	} else {
+		zstdChunk(sChunk, bFinish);
+	}
+}
+void CompressStreamBuf::deflateChunk(const std::string& sChunk, bool bFinish) noexcept
+{
+	z_stream_s& oZStream = *m_refZStream;
+	oZStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(sChunk.data()));
+	oZStream.avail_in = static_cast<uInt>(sChunk.size());
+	const int nFlush = (bFinish ? Z_FINISH : Z_SYNC_FLUSH);
+	do {
+		oZStream.next_out = reinterpret_cast<Bytef*>(m_aOutBuffer.data());
+		oZStream.avail_out = static_cast<uInt>(m_aOutBuffer.size());
+		if (::deflate(&oZStream, nFlush) == Z_STREAM_ERROR) {
+			setError("Could not compress output");
+			m_bWriteFailed = true;
+			return; //----------------------------------------------------------
+		}
+		writeOut(m_aOutBuffer.data(), m_aOutBuffer.size() - oZStream.avail_out);
+		if (m_bWriteFailed) {
+			return; //----------------------------------------------------------
+		}
+	} while (oZStream.avail_out == 0);
+}
+void CompressStreamBuf::zstdChunk(const std::string& sChunk, bool bFinish) noexcept
+{
+	ZSTD_inBuffer oIn{sChunk.data(), sChunk.size(), 0};
+	// both end the block so that the data written so far can be decompressed
+	const ZSTD_EndDirective eDirective = (bFinish ? ZSTD_e_end : ZSTD_e_flush);
+	size_t nRemaining;
+	do {
+		ZSTD_outBuffer oOut{m_aOutBuffer.data(), m_aOutBuffer.size(), 0};
+		nRemaining = ::ZSTD_compressStream2(m_p0ZstdCCtx, &oOut, &oIn, eDirective);
+		if (::ZSTD_isError(nRemaining)) {
+			setError(std::string("Could not compress output: ") + ::ZSTD_getErrorName(nRemaining));
+			m_bWriteFailed = true;
+			return; //----------------------------------------------------------
+		}
+		writeOut(m_aOutBuffer.data(), oOut.pos);
+		if (m_bWriteFailed) {
+			return; //----------------------------------------------------------
+		}
+	} while (nRemaining != 0);
+}
+void CompressStreamBuf::writeOut(const char* p0Data, size_t nSize) noexcept
+{
+	while (nSize > 0) {
+		const ssize_t nWritten = ::write(m_nFD, p0Data, nSize);
+		if (nWritten < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			setError(std::string("Could not write compressed output: ") + ::strerror(errno));
+			m_bWriteFailed = true;
+			break; // while ----
+		}
+		p0Data += nWritten;
+		nSize -= static_cast<size_t>(nWritten);
+		m_nTotWrittenBytes.fetch_add(nWritten, std::memory_order_relaxed);
+	}
+}
+
+} // namespace fofi
@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   compressstreambuf.h
+ */
+
+#ifndef FOFIMON_COMPRESS_STREAM_BUF_H_
+#define FOFIMON_COMPRESS_STREAM_BUF_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <streambuf>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <stdint.h>
+
+struct z_stream_s;
+struct ZSTD_CCtx_s;
+
+namespace fofi
+{
+
+/* A stream buffer that writes a gzip or zstd compressed file.
+ *
+ * What is written to the stream is collected in chunks that a compressor thread
+ * compresses and writes to the file, so that formatting and compressing overlap.
+ * When the compressor thread lags behind the writer of the stream waits.
+ *
+ * Each chunk is terminated with a flush and written before the next one
+ * is compressed. If the program crashes the file still holds a prefix of the
+ * output that can be decompressed (gzip and zstd complain about the missing end).
+ * Flushing the stream doesn't end the current chunk.
+ *
+ * In append mode a new gzip member or zstd frame is added to the file. Both
+ * are decompressed as if their contents were concatenated.
+ *
+ * Example:
+ *
+ *     CompressStreamBuf oCompressBuf;
+ *     auto sError = oCompressBuf.open("out.json.zst", CompressStreamBuf::COMPRESSION_ZSTD, false);
+ *     std::ostream oOut(&oCompressBuf);
+ *     oOut << "Hello" << '\n';
+ *     sError = oCompressBuf.close(); */
+class CompressStreamBuf : public std::streambuf
+{
+public:
+	enum COMPRESSION
+	{
+		COMPRESSION_NONE = 0
+		, COMPRESSION_GZIP = 1 /**< Extension ".gz". */
+		, COMPRESSION_ZSTD = 2 /**< Extension ".zst". */
+	};
+	CompressStreamBuf() noexcept;
+	~CompressStreamBuf() noexcept override;
+	/** Creates, truncates or appends to the file and starts the compressor thread.
+	 * @param sPathName The file.
+	 * @param eCompression The compression. Cannot be COMPRESSION_NONE.
+	 * @param bAppend Whether to append a new gzip member or zstd frame to an existing file.
+	 * @return Empty string or error.
+	 */
+	std::string open(const std::string& sPathName, COMPRESSION eCompression, bool bAppend);
+	/** Whether the file is open.
+	 * @return Whether open() succeeded and close() wasn't called.
+	 */
+	bool isOpen() const noexcept { return m_bOpen; }
+	/** Compresses what's left, stops the compressor thread and closes the file.
+	 * @return Empty string or the first error that occurred.
+	 */
+	std::string close() noexcept;
+
+	/** The number of uncompressed bytes passed to the compressor thread.
+	 * @return The bytes.
+	 */
+	int64_t getTotInBytes() const noexcept { return m_nTotInBytes; }
+	/** The number of compressed bytes written to the file.
+	 * @return The bytes.
+	 */
+	int64_t getTotWrittenBytes() const noexcept { return m_nTotWrittenBytes.load(std::memory_order_relaxed); }
+
+	/** The compression determined by the extension of a path name.
+	 * @param sPathName The path name.
+	 * @return The compression or COMPRESSION_NONE.
+	 */
+	static COMPRESSION getCompression(const std::string& sPathName) noexcept;
+	/** The path name without the ".gz" or ".zst" extension.
+	 * @param sPathName The path name.
+	 * @return The path name without the extension or sPathName if it isn't compressed.
+	 */
+	static std::string getUncompressedPathName(const std::string& sPathName) noexcept;
+protected:
+	int_type overflow(int_type nC) override;
+	int sync() override;
+private:
+	bool initCompressor() noexcept;
+	void endCompressor() noexcept;
+	void queueChunk() noexcept;
+	void resetPutArea() noexcept;
+	void compressorThreadRun() noexcept;
+	void compressChunk(const std::string& sChunk, bool bFinish) noexcept;
+	void deflateChunk(const std::string& sChunk, bool bFinish) noexcept;
+	void zstdChunk(const std::string& sChunk, bool bFinish) noexcept;
+	void writeOut(const char* p0Data, size_t nSize) noexcept;
+	void setError(const std::string& sError) noexcept;
+private:
+	int m_nFD;
+	bool m_bOpen;
+	COMPRESSION m_eCompression;
+	// Producer
+	std::string m_sChunk; // the put area
+	int64_t m_nTotInBytes;
+	// Compressor thread
+	std::unique_ptr<z_stream_s> m_refZStream; // if COMPRESSION_GZIP
+	ZSTD_CCtx_s* m_p0ZstdCCtx; // if COMPRESSION_ZSTD
+	std::vector<char> m_aOutBuffer;
+	bool m_bWriteFailed; // the following chunks are discarded
+	std::atomic<int64_t> m_nTotWrittenBytes;
+	std::thread m_oCompressorThread;
+	std::mutex m_oMutex;
+	std::condition_variable m_oChunkQueuedCond;
+	std::condition_variable m_oChunkDoneCond;
+	std::deque<std::string> m_aQueuedChunks; // guarded by m_oMutex
+	std::vector<std::string> m_aFreeChunks; // guarded by m_oMutex, buffers to reuse
+	bool m_bStop; // guarded by m_oMutex
+	std::string m_sError; // guarded by m_oMutex
+private:
+	CompressStreamBuf(const CompressStreamBuf& oSource) = delete;
+	CompressStreamBuf& operator=(const CompressStreamBuf& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_COMPRESS_STREAM_BUF_H_ */
@@ -0,0 +1,444 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   eventserver.cc
+ */
+
+#include "eventserver.h"
+
+#include "jsonwriter.h"
+
+#include <sstream>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+namespace fofi
+{
+
+static constexpr size_t s_nMaxInputLineSize = 64 * 1024;
+static constexpr size_t s_nMaxIOVecs = 64;
+static constexpr size_t s_nReadChunkSize = 4096;
+
+static std::string formatEvent(const LiveBinary::Event& oEvent, const std::string& sPath, const std::string& sOtherPath) noexcept
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, true);
+		oWriter.beginSequence();
+		oWriter.beginObject();
+		oWriter.key("Action");
+		oWriter.value(LiveBinary::getActionCodeString(oEvent.m_eAction));
+		oWriter.key("Count");
+		oWriter.value(oEvent.m_nCount);
+		oWriter.key("Dir");
+		oWriter.value((oEvent.m_nFlags & LiveBinary::LIVE_FLAG_DIR) != 0);
+		oWriter.key("Inconsistent");
+		oWriter.value((oEvent.m_nFlags & LiveBinary::LIVE_FLAG_INCONSISTENT) != 0);
+		if (! sOtherPath.empty()) {
+			oWriter.key("Other path");
+			oWriter.fileNameValue(sOtherPath);
+		}
+		oWriter.key("Path");
+		oWriter.fileNameValue(sPath);
+		oWriter.key("Status");
+		oWriter.value(LiveBinary::getResultTypeCodeString(oEvent.m_eResultType));
+		oWriter.key("Time");
+		oWriter.value(oEvent.m_nTimeUsec);
+		oWriter.endObject();
+		oWriter.endSequence();
+	}
+	return oOut.str();
+}
+static std::string formatNotice(const char* p0Key, const std::string& sValue) noexcept
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, true);
+		oWriter.beginSequence();
+		oWriter.beginObject();
+		oWriter.key(p0Key);
+		oWriter.value(sValue);
+		oWriter.endObject();
+		oWriter.endSequence();
+	}
+	return oOut.str();
+}
+static std::string formatDropped(int64_t nDropped) noexcept
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, true);
+		oWriter.beginSequence();
+		oWriter.beginObject();
+		oWriter.key("Dropped");
+		oWriter.value(nDropped);
+		oWriter.endObject();
+		oWriter.endSequence();
+	}
+	return oOut.str();
+}
+static bool getActionFromCode(const std::string& sCode, int32_t& nAction) noexcept
+{
+	for (int32_t nCur = LiveBinary::LIVE_ACTION_CREATE; nCur <= LiveBinary::LIVE_ACTION_RENAME_TO; ++nCur) {
+		if (sCode == LiveBinary::getActionCodeString(nCur)) {
+			nAction = nCur;
+			return true; //-----------------------------------------------------
+		}
+	}
+	return false;
+}
+
+bool EventServer::getFullPolicyFromName(const std::string& sName, FULL_POLICY& eFullPolicy) noexcept
+{
+	if (sName == "drop") {
+		eFullPolicy = FULL_POLICY_DROP;
+	} else if (sName == "disconnect") {
+		eFullPolicy = FULL_POLICY_DISCONNECT;
+	} else {
+		return false; //--------------------------------------------------------
+	}
+	return true;
+}
+
+// Removes the socket file if no one is listening on it
+static std::string removeStaleSocket(const std::string& sPathName, const struct sockaddr_un& oAddr) noexcept
+{
+	const int nFD = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (nFD < 0) {
+		return std::string("Could not create socket: ") + ::strerror(errno); //-
+	}
+	const int nRet = ::connect(nFD, reinterpret_cast<const struct sockaddr*>(&oAddr), sizeof(oAddr));
+	const int nErrno = errno;
+	::close(nFD);
+	if ((nRet == 0) || (nErrno == EAGAIN)) {
+		// another instance is listening, possibly with a full backlog
+		return "Socket already in use: " + sPathName; //------------------------
+	}
+	if (nErrno != ECONNREFUSED) {
+		return "Could not check socket " + sPathName + ": " + ::strerror(nErrno); //-
+	}
+	// left by a previous instance
+	::unlink(sPathName.c_str());
+	return "";
+}
+
+EventServer::EventServer() noexcept
+: m_nListenFD(-1)
+, m_nTotDropped(0)
+, m_nTotDisconnected(0)
+{
+}
+EventServer::~EventServer() noexcept
+{
+	close();
+}
+std::string EventServer::listen(const std::string& sPathName, const Config& oConfig)
+{
+	assert(m_nListenFD < 0);
+	assert(oConfig.m_nMaxQueuedEvents > 0);
+	m_oConfig = oConfig;
+	struct sockaddr_un oAddr;
+	std::memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sun_family = AF_UNIX;
+	if (sPathName.size() >= sizeof(oAddr.sun_path)) {
+		return "Socket path too long: " + sPathName; //-------------------------
+	}
+	std::memcpy(oAddr.sun_path, sPathName.c_str(), sPathName.size() + 1);
+	struct stat oStat;
+	if ((::lstat(sPathName.c_str(), &oStat) == 0) && S_ISSOCK(oStat.st_mode)) {
+		auto sError = removeStaleSocket(sPathName, oAddr);
+		if (! sError.empty()) {
+			return sError; //---------------------------------------------------
+		}
+	}
+	const int nFD = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (nFD < 0) {
+		return std::string("Could not create socket: ") + ::strerror(errno); //-
+	}
+	if (::bind(nFD, reinterpret_cast<struct sockaddr*>(&oAddr), sizeof(oAddr)) != 0) {
+		const std::string sError = "Could not bind socket " + sPathName + ": " + ::strerror(errno);
+		::close(nFD);
+		return sError; //-------------------------------------------------------
+	}
+	if (::listen(nFD, SOMAXCONN) != 0) {
+		const std::string sError = "Could not listen on socket " + sPathName + ": " + ::strerror(errno);
+		::close(nFD);
+		::unlink(sPathName.c_str());
+		return sError; //-------------------------------------------------------
+	}
+	m_nListenFD = nFD;
+	m_sPathName = sPathName;
+	m_oListenConn = Glib::signal_io().connect(sigc::mem_fun(*this, &EventServer::onListenIO), m_nListenFD, Glib::IO_IN);
+	return "";
+}
+void EventServer::close() noexcept
+{
+	if (m_nListenFD < 0) {
+		return; //--------------------------------------------------------------
+	}
+	while (! m_aSubscribers.empty()) {
+		removeSubscriber(m_aSubscribers.back().get());
+	}
+	m_oListenConn.disconnect();
+	::close(m_nListenFD);
+	m_nListenFD = -1;
+	::unlink(m_sPathName.c_str());
+}
+bool EventServer::onListenIO(Glib::IOCondition /*eCondition*/) noexcept
+{
+	while (true) {
+		const int nFD = ::accept4(m_nListenFD, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (nFD < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			// EAGAIN or errors of the single connection
+			break; // while ----
+		}
+		m_aSubscribers.emplace_back(std::make_unique<Subscriber>());
+		Subscriber* p0Subscriber = m_aSubscribers.back().get();
+		p0Subscriber->m_nFD = nFD;
+		p0Subscriber->m_oInConn = Glib::signal_io().connect([this, p0Subscriber](Glib::IOCondition eCondition) -> bool
+		{
+			return onSubscriberIn(p0Subscriber, eCondition);
+		}, nFD, Glib::IO_IN | Glib::IO_HUP | Glib::IO_ERR);
+	}
+	return true;
+}
+bool EventServer::onSubscriberIn(Subscriber* p0Subscriber, Glib::IOCondition /*eCondition*/) noexcept
+{
+	Subscriber& oSubscriber = *p0Subscriber;
+	char aBuffer[s_nReadChunkSize];
+	while (true) {
+		const ssize_t nRead = ::recv(oSubscriber.m_nFD, aBuffer, sizeof(aBuffer), MSG_DONTWAIT);
+		if (nRead < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				return true; //-------------------------------------------------
+			}
+			removeSubscriber(p0Subscriber);
+			return false; //----------------------------------------------------
+		}
+		if (nRead == 0) {
+			// the subscriber closed the connection
+			removeSubscriber(p0Subscriber);
+			return false; //----------------------------------------------------
+		}
+		oSubscriber.m_sInput.append(aBuffer, static_cast<size_t>(nRead));
+		size_t nLineStart = 0;
+		size_t nNewLine;
+		while ((nNewLine = oSubscriber.m_sInput.find('\n', nLineStart)) != std::string::npos) {
+			const std::string sLine = oSubscriber.m_sInput.substr(nLineStart, nNewLine - nLineStart);
+			nLineStart = nNewLine + 1;
+			if (! processLine(oSubscriber, sLine)) {
+				removeSubscriber(p0Subscriber);
+				return false; //------------------------------------------------
+			}
+		}
+		oSubscriber.m_sInput.erase(0, nLineStart);
+		if (oSubscriber.m_sInput.size() > s_nMaxInputLineSize) {
+			removeSubscriber(p0Subscriber);
+			return false; //----------------------------------------------------
+		}
+	}
+}
+bool EventServer::processLine(Subscriber& oSubscriber, const std::string& sLine) noexcept
+{
+	std::string sTrimmed = sLine;
+	if ((! sTrimmed.empty()) && (sTrimmed.back() == '\r')) {
+		sTrimmed.pop_back();
+	}
+	if (sTrimmed.empty()) {
+		return true; //---------------------------------------------------------
+	}
+	const size_t nSpace = sTrimmed.find(' ');
+	const std::string sCommand = sTrimmed.substr(0, nSpace);
+	const std::string sArg = ((nSpace == std::string::npos) ? "" : sTrimmed.substr(nSpace + 1));
+	std::string sError;
+	if ((sCommand == "prefix") && (! sArg.empty()) && (sArg[0] == '/')) {
+		std::string sPrefix = sArg;
+		while ((sPrefix.size() > 1) && (sPrefix.back() == '/')) {
+			sPrefix.pop_back();
+		}
+		oSubscriber.m_aPrefixes.push_back(std::move(sPrefix));
+	} else if ((sCommand == "actions") && (! sArg.empty())) {
+		uint32_t nMask = 0;
+		std::istringstream oArgs(sArg);
+		std::string sCode;
+		while (std::getline(oArgs, sCode, ',')) {
+			int32_t nAction;
+			if (! getActionFromCode(sCode, nAction)) {
+				sError = "Unknown action " + sCode;
+				break; // while ----
+			}
+			nMask |= (1u << nAction);
+		}
+		if (sError.empty()) {
+			oSubscriber.m_nActionMask = nMask;
+		}
+	} else {
+		sError = "Invalid request: " + sTrimmed;
+	}
+	if (sError.empty()) {
+		return true; //---------------------------------------------------------
+	}
+	enqueue(oSubscriber, std::make_shared<const std::string>(formatNotice("Error", sError)));
+	return send(oSubscriber);
+}
+bool EventServer::isInterested(const Subscriber& oSubscriber, const LiveBinary::Event& oEvent, const std::string& sPath) const noexcept
+{
+	if ((oSubscriber.m_nActionMask & (1u << oEvent.m_eAction)) == 0) {
+		return false; //--------------------------------------------------------
+	}
+	if (oSubscriber.m_aPrefixes.empty()) {
+		return true; //---------------------------------------------------------
+	}
+	for (const auto& sPrefix : oSubscriber.m_aPrefixes) {
+		if (sPath.compare(0, sPrefix.size(), sPrefix) != 0) {
+			continue; // for ---
+		}
+		if ((sPath.size() == sPrefix.size()) || (sPrefix.back() == '/') || (sPath[sPrefix.size()] == '/')) {
+			return true; //-----------------------------------------------------
+		}
+	}
+	return false;
+}
+void EventServer::publish(const LiveBinary::Event& oEvent, const std::string& sPath, const std::string& sOtherPath) noexcept
+{
+	std::shared_ptr<const std::string> refMsg;
+	std::vector<Subscriber*> aToRemove;
+	for (auto& refSubscriber : m_aSubscribers) {
+		Subscriber& oSubscriber = *refSubscriber;
+		if (! isInterested(oSubscriber, oEvent, sPath)) {
+			continue; // for ---
+		}
+		if (oSubscriber.m_aQueue.size() >= static_cast<size_t>(m_oConfig.m_nMaxQueuedEvents)) {
+			if (m_oConfig.m_eFullPolicy == FULL_POLICY_DISCONNECT) {
+				++m_nTotDisconnected;
+				aToRemove.push_back(&oSubscriber);
+			} else {
+				++m_nTotDropped;
+				++oSubscriber.m_nPendingDropped;
+			}
+			continue; // for ---
+		}
+		if (! refMsg) {
+			// formatted once for all the subscribers
+			refMsg = std::make_shared<const std::string>(formatEvent(oEvent, sPath, sOtherPath));
+		}
+		if (oSubscriber.m_nPendingDropped > 0) {
+			enqueue(oSubscriber, std::make_shared<const std::string>(formatDropped(oSubscriber.m_nPendingDropped)));
+			oSubscriber.m_nPendingDropped = 0;
+		}
+		enqueue(oSubscriber, refMsg);
+		if (oSubscriber.m_oOutConn.connected()) {
+			// waiting for the socket to accept data
+			continue; // for ---
+		}
+		if (! send(oSubscriber)) {
+			aToRemove.push_back(&oSubscriber);
+		}
+	}
+	for (Subscriber* p0Subscriber : aToRemove) {
+		removeSubscriber(p0Subscriber);
+	}
+}
+void EventServer::enqueue(Subscriber& oSubscriber, const std::shared_ptr<const std::string>& refMsg) noexcept
+{
+	oSubscriber.m_aQueue.push_back(refMsg);
+}
+bool EventServer::send(Subscriber& oSubscriber) noexcept
+{
+	auto& aQueue = oSubscriber.m_aQueue;
+	struct iovec aIOVecs[s_nMaxIOVecs];
+	while (! aQueue.empty()) {
+		const size_t nTotIOVecs = std::min(aQueue.size(), s_nMaxIOVecs);
+		for (size_t nIdx = 0; nIdx < nTotIOVecs; ++nIdx) {
+			const std::string& sMsg = *aQueue[nIdx];
+			const size_t nSkip = ((nIdx == 0) ? oSubscriber.m_nFrontSent : 0);
+			aIOVecs[nIdx].iov_base = const_cast<char*>(sMsg.data() + nSkip);
+			aIOVecs[nIdx].iov_len = sMsg.size() - nSkip;
+		}
+		struct msghdr oMsgHdr;
+		std::memset(&oMsgHdr, 0, sizeof(oMsgHdr));
+		oMsgHdr.msg_iov = aIOVecs;
+		oMsgHdr.msg_iovlen = nTotIOVecs;
+		ssize_t nSent = ::sendmsg(oSubscriber.m_nFD, &oMsgHdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (nSent < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				break; // while ----
+			}
+			return false; //----------------------------------------------------
+		}
+		while (nSent > 0) {
+			const size_t nFrontLeft = aQueue.front()->size() - oSubscriber.m_nFrontSent;
+			if (static_cast<size_t>(nSent) < nFrontLeft) {
+				oSubscriber.m_nFrontSent += static_cast<size_t>(nSent);
+				break; // while ----
+			}
+			nSent -= static_cast<ssize_t>(nFrontLeft);
+			aQueue.pop_front();
+			oSubscriber.m_nFrontSent = 0;
+		}
+	}
+	if (aQueue.empty()) {
+		oSubscriber.m_oOutConn.disconnect();
+	} else if (! oSubscriber.m_oOutConn.connected()) {
+		Subscriber* p0Subscriber = &oSubscriber;
+		oSubscriber.m_oOutConn = Glib::signal_io().connect([this, p0Subscriber](Glib::IOCondition eCondition) -> bool
+		{
+			return onSubscriberOut(p0Subscriber, eCondition);
+		}, oSubscriber.m_nFD, Glib::IO_OUT);
+	}
+	return true;
+}
+bool EventServer::onSubscriberOut(Subscriber* p0Subscriber, Glib::IOCondition /*eCondition*/) noexcept
+{
+	if (! send(*p0Subscriber)) {
+		removeSubscriber(p0Subscriber);
+		return false; //--------------------------------------------------------
+	}
+	return p0Subscriber->m_oOutConn.connected();
+}
+void EventServer::removeSubscriber(Subscriber* p0Subscriber) noexcept
+{
+	p0Subscriber->m_oInConn.disconnect();
+	p0Subscriber->m_oOutConn.disconnect();
+	::close(p0Subscriber->m_nFD);
+	auto itFind = std::find_if(m_aSubscribers.begin(), m_aSubscribers.end(), [&](const std::unique_ptr<Subscriber>& refSubscriber)
+	{
+		return (refSubscriber.get() == p0Subscriber);
+	});
+	assert(itFind != m_aSubscribers.end());
+	m_aSubscribers.erase(itFind);
+}
+
+} // namespace fofi
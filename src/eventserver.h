@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   eventserver.h
+ */
+
+#ifndef FOFIMON_EVENT_SERVER_H_
+#define FOFIMON_EVENT_SERVER_H_
+
+#include "livebinary.h"
+
+#include <glibmm.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Serves live events to the subscribers connected to a unix domain socket.
+ *
+ * Each event is sent as a line of json (NDJSON), for example:
+ *
+ *     {"Action":"CREATE","Count":1,"Dir":false,"Inconsistent":false,"Path":"/a/b.txt","Status":"CREATED","Time":1234}
+ *
+ * Renames also have the "Other path" key if it is known. The action and status
+ * codes are those of LiveBinary::getActionCodeString() and
+ * LiveBinary::getResultTypeCodeString(). "Time" is in microseconds from the
+ * start of watching.
+ *
+ * A subscriber can send lines to restrict the events it receives:
+ *
+ *     prefix PATH         only events of PATH or of the files within it
+ *                         (can be repeated, the prefixes are alternatives)
+ *     actions A1,A2,...   only the listed actions (for example CREATE,DELETE)
+ *
+ * Invalid lines are answered with {"Error":"..."}.
+ *
+ * Each subscriber has its own bounded queue of events not yet accepted by the
+ * socket, the server never blocks. When a queue is full the policy decides
+ * whether the new events for that subscriber are dropped (and
+ * {"Dropped":N} is sent once the queue has room again) or the subscriber is
+ * disconnected.
+ *
+ * The sockets are watched by the default Glib main context. */
+class EventServer
+{
+public:
+	enum FULL_POLICY
+	{
+		FULL_POLICY_DROP = 0 /**< Drop the events that don't fit. */
+		, FULL_POLICY_DISCONNECT = 1 /**< Disconnect the subscriber. */
+	};
+	struct Config
+	{
+		int32_t m_nMaxQueuedEvents = 4096; /**< Per subscriber. Must be positive. */
+		FULL_POLICY m_eFullPolicy = FULL_POLICY_DROP;
+	};
+	EventServer() noexcept;
+	~EventServer() noexcept;
+	/** Starts listening.
+	 * A stale socket file at the same path is removed. Fails if another
+	 * process is listening on it.
+	 * @param sPathName The socket file.
+	 * @param oConfig The configuration.
+	 * @return Empty string or error.
+	 */
+	std::string listen(const std::string& sPathName, const Config& oConfig);
+	/** Whether listening.
+	 * @return Whether listen() succeeded and close() wasn't called.
+	 */
+	bool isListening() const noexcept { return (m_nListenFD >= 0); }
+	/** Sends an event to the interested subscribers.
+	 * @param oEvent The event. Its path ids are ignored.
+	 * @param sPath The path.
+	 * @param sOtherPath The other path of a rename or empty if unknown.
+	 */
+	void publish(const LiveBinary::Event& oEvent, const std::string& sPath, const std::string& sOtherPath) noexcept;
+	/** Disconnects all the subscribers, stops listening and removes the socket file.
+	 * Events still queued are lost.
+	 */
+	void close() noexcept;
+
+	/** The number of connected subscribers.
+	 * @return The number.
+	 */
+	int32_t getTotSubscribers() const noexcept { return static_cast<int32_t>(m_aSubscribers.size()); }
+	/** The total number of events dropped because of full queues.
+	 * @return The number of events.
+	 */
+	int64_t getTotDropped() const noexcept { return m_nTotDropped; }
+	/** The total number of subscribers disconnected because of full queues.
+	 * @return The number of subscribers.
+	 */
+	int64_t getTotDisconnected() const noexcept { return m_nTotDisconnected; }
+
+	/** Parses a policy name ("drop" or "disconnect").
+	 * @param sName The name.
+	 * @param eFullPolicy Is set to the policy if valid.
+	 * @return Whether valid.
+	 */
+	static bool getFullPolicyFromName(const std::string& sName, FULL_POLICY& eFullPolicy) noexcept;
+private:
+	struct Subscriber
+	{
+		int m_nFD = -1;
+		std::string m_sInput; // incomplete line
+		std::vector<std::string> m_aPrefixes; // empty: all paths
+		uint32_t m_nActionMask = ~0u; // bit: LiveBinary::LIVE_ACTION
+		std::deque<std::shared_ptr<const std::string>> m_aQueue;
+		size_t m_nFrontSent = 0; // bytes of the front of the queue already sent
+		int64_t m_nPendingDropped = 0; // not notified yet
+		sigc::connection m_oInConn;
+		sigc::connection m_oOutConn; // connected while the socket doesn't accept data
+	};
+	bool onListenIO(Glib::IOCondition eCondition) noexcept;
+	bool onSubscriberIn(Subscriber* p0Subscriber, Glib::IOCondition eCondition) noexcept;
+	bool onSubscriberOut(Subscriber* p0Subscriber, Glib::IOCondition eCondition) noexcept;
+	// Returns false if the subscriber had to be removed
+	bool processLine(Subscriber& oSubscriber, const std::string& sLine) noexcept;
+	bool isInterested(const Subscriber& oSubscriber, const LiveBinary::Event& oEvent, const std::string& sPath) const noexcept;
+	void enqueue(Subscriber& oSubscriber, const std::shared_ptr<const std::string>& refMsg) noexcept;
+	// Sends the queued events, returns false if the subscriber had to be removed
+	bool send(Subscriber& oSubscriber) noexcept;
+	void removeSubscriber(Subscriber* p0Subscriber) noexcept;
+private:
+	Config m_oConfig;
+	std::string m_sPathName;
+	int m_nListenFD;
+	sigc::connection m_oListenConn;
+	std::vector<std::unique_ptr<Subscriber>> m_aSubscribers;
+	int64_t m_nTotDropped;
+	int64_t m_nTotDisconnected;
+private:
+	EventServer(const EventServer& oSource) = delete;
+	EventServer& operator=(const EventServer& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_EVENT_SERVER_H_ */
@@ -27,13 +27,19 @@
 #include <sigc++/sigc++.h>
 
 #include <cassert>
-#include <iostream>
+#include <cstring>
+#include <ostream>
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <stdexcept>
 #include <utility>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fofi
 {
@@ -48,6 +54,7 @@ FofiModel::FofiModel(unique_ptr<INotifierSource> refSource, int32_t nMaxToWatchD
 , m_bIsUserRoot(bIsRoot)
 , m_refSource(std::move(refSource))
 , m_nRootTWDIdx(-1)
+, m_aPathCache(s_nPathCacheSize)
 , m_nEventCounter(0)
 , m_nStartTimeUsec(-1)
 , m_nStopTimeUsec(-1)
@@ -55,24 +62,50 @@ FofiModel::FofiModel(unique_ptr<INotifierSource> refSource, int32_t nMaxToWatchD
 , m_nRootResultIdx(-1)
 , m_bOverflow(false)
 , m_bHasInconsistencies(false)
+, m_nCheckpointGeneration(1)
+, m_bRecycleTemporary(false)
+, m_nSpillAfterUsec(0)
+, m_nNextSpillCheckUsec(0)
+, m_nOldestActiveIdx(-1)
+, m_nNewestActiveIdx(-1)
+, m_nTotSpilledResults(0)
+, m_nSpillDeadBytes(0)
+, m_bCollapseActions(false)
+, m_nMaxActions(0)
+, m_nTotCachedScans(0)
+, m_nNamesAfterRelease(0)
+, m_bTrackLatencies(true)
+, m_aLatencyHistograms(s_nTotEventActions * s_nTotLatencyStages)
+, m_eCurEventAction(INotifierSource::FOFI_ACTION_INVALID)
+, m_nCurEventReadNsec(-1)
+, m_nCurEventStartNsec(0)
+, m_nTotFilteredOutEvents(0)
+, m_nTotOverflows(0)
+, m_nSetupCpuUsec(0)
+, m_nWatchStartCpuUsec(-1)
+, m_nWatchStopCpuUsec(-1)
+, m_nSnapshotCpuUsec(0)
 , m_sES()
 {
 	assert(nMaxToWatchDirectories > 0);
 	assert(nMaxResultPaths > 0);
 	assert(m_refSource);
 	//
+	m_aTotEvents.fill(0);
 	m_refSource->attach_override();
 	m_refSource->connect(sigc::mem_fun(this, &FofiModel::onFileModified));
 
 	m_aInvalidPaths = m_refSource->invalidPaths();
 
-	Glib::signal_timeout().connect(
+	m_oCheckOpenMovesConn = Glib::signal_timeout().connect(
 			sigc::mem_fun(*this, &FofiModel::onCheckOpenMoves), s_nCheckOpenMovesMillisec);
 }
 FofiModel::~FofiModel()
 {
+	// the main loop might outlive the model
+	m_oCheckOpenMovesConn.disconnect();
 }
-void FofiModel::calcFiltersRegex(std::vector<Filter> aFilters)
+void FofiModel::calcFiltersRegex(std::vector<Filter>& aFilters)
 {
 	for (auto& oF : aFilters) {
 		assert(!oF.m_sFilter.empty());
@@ -83,7 +116,6 @@ void FofiModel::calcFiltersRegex(std::vector<Filter> aFilters)
 }
 std::string FofiModel::addDirectoryZone(DirectoryZone&& oDZ)
 {
-	assert(m_nEventCounter == 0); // can't add directory zones while watching
 	assert(oDZ.m_nMaxDepth >= 0);
 	try {
 		calcFiltersRegex(oDZ.m_aSubDirIncludeFilters);
@@ -134,19 +166,73 @@ std::string FofiModel::addDirectoryZone(DirectoryZone&& oDZ)
 			return sError; //---------------------------------------------------
 		}
 	}
+	const int32_t nDZIdx = static_cast<int32_t>(m_aDirectoryZones.size());
+	m_oDirectoryZoneTrie.insert(oDZ.m_sPath, nDZIdx);
 	m_aDirectoryZones.push_back(std::move(oDZ));
+	if (m_nEventCounter == 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	// appending keeps the owner zone indexes of the ToWatchDir valid
+	try {
+		const int32_t nTWDIdx = initialFillTheGaps(-1, m_aDirectoryZones[nDZIdx].m_sPath);
+		pinToWatchDirAncestors(nTWDIdx);
+		reconcileToWatchDir(nTWDIdx, true);
+	} catch (const std::runtime_error& oErr) {
+		return oErr.what(); //--------------------------------------------------
+	}
 	return "";
 }
 std::string FofiModel::removeDirectoryZone(const std::string& sPath)
 {
-	assert(m_nEventCounter == 0); // can't remove directory zones while watching
 	const auto nFoundIdx = findDirectoryZone(sPath);
 	if (nFoundIdx < 0) {
 		return "Path not defined: " + Glib::filename_to_utf8(sPath);
 	}
-	m_aDirectoryZones.erase(m_aDirectoryZones.begin() + nFoundIdx);
+	if (m_nEventCounter == 0) {
+		m_aDirectoryZones.erase(m_aDirectoryZones.begin() + nFoundIdx);
+		rebuildDirectoryZoneTrie();
+		return ""; //-----------------------------------------------------------
+	}
+	eraseDirectoryZoneWatching(nFoundIdx);
+	const int32_t nTWDIdx = findToWatchDir(sPath);
+	if (nTWDIdx < 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	try {
+		const int32_t nTopTWDIdx = unpinToWatchDirAncestors(nTWDIdx);
+		// the owner of the directories of the subtree changed in any case
+		reconcileChain(nTopTWDIdx, nTWDIdx, true);
+	} catch (const std::runtime_error& oErr) {
+		return oErr.what(); //--------------------------------------------------
+	}
 	return "";
 }
+void FofiModel::eraseDirectoryZoneWatching(int32_t nDZIdx)
+{
+	const int32_t nLastDZIdx = static_cast<int32_t>(m_aDirectoryZones.size()) - 1;
+	if (nDZIdx < nLastDZIdx) {
+		m_aDirectoryZones[nDZIdx] = std::move(m_aDirectoryZones[nLastDZIdx]);
+		// only the subtree of its base path can be owned by the moved zone
+		const int32_t nBaseTWDIdx = findToWatchDir(m_aDirectoryZones[nDZIdx].m_sPath);
+		std::vector<int32_t> aStack;
+		if (nBaseTWDIdx >= 0) {
+			aStack.push_back(nBaseTWDIdx);
+		}
+		while (! aStack.empty()) {
+			ToWatchDir& oTWD = m_aToWatchDirs[aStack.back()];
+			aStack.pop_back();
+			if (oTWD.m_bFree) {
+				continue; // while ---
+			}
+			if (oTWD.m_nIdxOwnerDirectoryZone == nLastDZIdx) {
+				oTWD.m_nIdxOwnerDirectoryZone = nDZIdx;
+			}
+			aStack.insert(aStack.end(), oTWD.m_aToWatchSubdirIdxs.begin(), oTWD.m_aToWatchSubdirIdxs.end());
+		}
+	}
+	m_aDirectoryZones.pop_back();
+	rebuildDirectoryZoneTrie();
+}
 const std::vector<FofiModel::DirectoryZone>& FofiModel::getDirectoryZones() const
 {
 	return m_aDirectoryZones;
@@ -157,57 +243,92 @@ bool FofiModel::hasDirectoryZone(const std::string& sPath) const
 }
 int32_t FofiModel::findDirectoryZone(const std::string& sPath) const
 {
-	const auto itFind = std::find_if(m_aDirectoryZones.begin(), m_aDirectoryZones.end(), [&](const DirectoryZone& oBaseDir)
-	{
-		return (oBaseDir.m_sPath == sPath);
-	});
-	if (itFind == m_aDirectoryZones.end()) {
-		return -1;
+	return m_oDirectoryZoneTrie.find(sPath);
+}
+void FofiModel::rebuildDirectoryZoneTrie()
+{
+	m_oDirectoryZoneTrie.clear();
+	const int32_t nTotDirectoryZones = static_cast<int32_t>(m_aDirectoryZones.size());
+	for (int32_t nDZIdx = 0; nDZIdx < nTotDirectoryZones; ++nDZIdx) {
+		m_oDirectoryZoneTrie.insert(m_aDirectoryZones[nDZIdx].m_sPath, nDZIdx);
 	}
-	return static_cast<int32_t>(std::distance(m_aDirectoryZones.begin(), itFind));
 }
 int32_t FofiModel::findToWatchDir(const std::string& sPath) const
 {
-	const auto itFind = std::find_if(m_aToWatchDirs.begin(), m_aToWatchDirs.end(), [&](const ToWatchDir& oTWD)
-	{
-		return (oTWD.m_sPathName == sPath);
-	});
-	if (itFind == m_aToWatchDirs.end()) {
-		return -1;
+	if ((m_nRootTWDIdx < 0) || sPath.empty() || (sPath[0] != '/')) {
+		return -1; //-----------------------------------------------------------
+	}
+	// descend from the root one component at a time
+	int32_t nTWDIdx = m_nRootTWDIdx;
+	const auto nPathLen = sPath.size();
+	std::string::size_type nCompPos = 1;
+	while (nCompPos < nPathLen) {
+		auto nSlashPos = sPath.find('/', nCompPos);
+		if (nSlashPos == std::string::npos) {
+			nSlashPos = nPathLen;
+		}
+		if (nSlashPos > nCompPos) {
+			const int32_t nNameId = m_oStringPool.find(sPath.substr(nCompPos, nSlashPos - nCompPos));
+			nTWDIdx = m_aToWatchDirs[nTWDIdx].findSubDirIdx(nNameId);
+			if (nTWDIdx < 0) {
+				return -1; //---------------------------------------------------
+			}
+		}
+		nCompPos = nSlashPos + 1;
 	}
-	return static_cast<int32_t>(std::distance(m_aToWatchDirs.begin(), itFind));
+	return nTWDIdx;
 }
 int32_t FofiModel::findToWatchDir(int32_t nParentTWDIdx, const std::string& sPathName) const
 {
 	const auto& oToWatch = m_aToWatchDirs[nParentTWDIdx];
-	const auto itFind = std::find_if(oToWatch.m_aToWatchSubdirIdxs.begin(), oToWatch.m_aToWatchSubdirIdxs.end(), [&](int32_t nCurTWDIdx)
-	{
-		const auto& oCurToWatch = m_aToWatchDirs[nCurTWDIdx];
-		return (oCurToWatch.m_sPathName == sPathName);
-	});
-	if (itFind == oToWatch.m_aToWatchSubdirIdxs.end()) {
-		return -1;
+	const auto nFoundSlashPos = sPathName.find_last_of('/');
+	if (nFoundSlashPos == std::string::npos) {
+		return -1; //-----------------------------------------------------------
 	}
-	return *itFind;
+	const int32_t nTWDIdx = oToWatch.findSubDirIdx(m_oStringPool.find(sPathName.substr(nFoundSlashPos + 1)));
+	assert((nTWDIdx < 0) || (getToWatchDirPath(nTWDIdx) == sPathName));
+	return nTWDIdx;
 }
 std::string FofiModel::addToWatchFile(const std::string& sPath)
 {
-	assert(m_nEventCounter == 0); // can't add files while watching
 	const auto nFoundIdx = findToWatchFile(sPath);
 	if (nFoundIdx >= 0) {
 		return "File already defined: " + Glib::filename_to_utf8(sPath); //-----
 	}
 	m_aToWatchFiles.push_back(sPath);
+	if (m_nEventCounter == 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	try {
+		const int32_t nParentTWDIdx = initialFillTheGaps(-1, Util::getPathDirName(sPath).second);
+		Util::addValueToVectorUniquely(m_aToWatchDirs[nParentTWDIdx].m_aPinnedFiles, Util::getPathFileName(sPath).second);
+		pinToWatchDirAncestors(nParentTWDIdx);
+	} catch (const std::runtime_error& oErr) {
+		return oErr.what(); //--------------------------------------------------
+	}
 	return "";
 }
 std::string FofiModel::removeToWatchFile(const std::string& sPath)
 {
-	assert(m_nEventCounter == 0); // can't remove files while watching
 	const auto nFoundIdx = findToWatchFile(sPath);
 	if (nFoundIdx < 0) {
 		return "File not defined: " + Glib::filename_to_utf8(sPath); //---------
 	}
 	m_aToWatchFiles.erase(m_aToWatchFiles.begin() + nFoundIdx);
+	if (m_nEventCounter == 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	const int32_t nParentTWDIdx = findToWatchDir(Util::getPathDirName(sPath).second);
+	if (nParentTWDIdx < 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	Util::removeValueFromVector(m_aToWatchDirs[nParentTWDIdx].m_aPinnedFiles, Util::getPathFileName(sPath).second);
+	try {
+		const int32_t nTopTWDIdx = unpinToWatchDirAncestors(nParentTWDIdx);
+		reconcileChain(nTopTWDIdx, nParentTWDIdx, false);
+	} catch (const std::runtime_error& oErr) {
+		return oErr.what(); //--------------------------------------------------
+	}
 	return "";
 }
 const std::vector<std::string>& FofiModel::getToWatchFiles() const
@@ -231,7 +352,7 @@ int32_t FofiModel::findToWatchFile(const std::string& sPath) const
 }
 void FofiModel::checkThrowMaxToWatchDirsReached()
 {
-	const int32_t nTotWatchedDirs = static_cast<int32_t>(m_aToWatchDirs.size());
+	const int32_t nTotWatchedDirs = static_cast<int32_t>(m_aToWatchDirs.size() - m_aFreeToWatchDirIdxs.size());
 	if (nTotWatchedDirs >= m_nMaxToWatchDirectories) {
 		const std::string sError = "Reached limit of " + std::to_string(nTotWatchedDirs) + " watched directories";
 		throw std::runtime_error(sError);
@@ -328,19 +449,18 @@ bool FofiModel::isFilteredOutFile(const ToWatchDir& oToWatch, const std::string&
 	}
 	return false;
 }
-void FofiModel::setDirectoryZone(ToWatchDir& oTWD)
+void FofiModel::setDirectoryZone(ToWatchDir& oTWD, const std::string& sPath)
 {
 	assert(oTWD.m_nIdxOwnerDirectoryZone < 0);
-	// inverse loop order because if a path is within multiple zones the one
-	// with the closest base path is chosen as owner,
-	// that is the owner is set by the directory zone that creates the
-	// ToWatchDir instance first
-	const int32_t nTotDirectoryZones = static_cast<int32_t>(m_aDirectoryZones.size());
-	for (int32_t nDZIdx = nTotDirectoryZones - 1; nDZIdx >= 0; --nDZIdx) {
-		DirectoryZone& oDZ = m_aDirectoryZones[nDZIdx];
-		// Note the base path is allowed not to exist
-		const int32_t nDepth = Util::getPathDepth(oTWD.m_sPathName, oDZ.m_sPath, oDZ.m_nMaxDepth);
-		const bool bIsInZone = (nDepth >= 0);
+	// if a path is within multiple zones the one with the closest base path
+	// is chosen as owner, the ancestors are therefore visited by increasing depth
+	// Note the base path is allowed not to exist
+	m_oDirectoryZoneTrie.findAncestors(sPath, m_aZoneAncestors);
+	for (const auto& oAncestor : m_aZoneAncestors) {
+		const int32_t nDZIdx = oAncestor.m_nValue;
+		const DirectoryZone& oDZ = m_aDirectoryZones[nDZIdx];
+		const int32_t nDepth = oAncestor.m_nDepth;
+		const bool bIsInZone = (nDepth <= oDZ.m_nMaxDepth);
 		if (bIsInZone) {
 			oTWD.m_nIdxOwnerDirectoryZone = nDZIdx;
 			oTWD.m_nDepth = nDepth;
@@ -349,22 +469,46 @@ void FofiModel::setDirectoryZone(ToWatchDir& oTWD)
 		}
 	}
 }
-void FofiModel::addExistingContent(ToWatchDir& oTWD)
+void FofiModel::scanDirectory(const std::string& sPath, std::vector<ScanCache::Entry>& aEntries)
+{
+	aEntries.clear();
+	ScanCache::DirStamp oStamp;
+	// the stamp is taken before reading, if the directory changes meanwhile
+	// the cached listing is stale at the next run
+	const bool bUseCache = m_bInitialSetup && (! m_sScanCachePath.empty()) && ScanCache::getDirStamp(sPath, oStamp);
+	if (bUseCache && m_oScanCache.lookup(sPath, oStamp, aEntries)) {
+		return; //--------------------------------------------------------------
+	}
+	Glib::Dir oDir(sPath);
+	for (const auto& sChildName : oDir) {
+		const std::string sChildPath = Util::getPathFromDirAndName(sPath, sChildName);
+		const auto oChildFStat = Util::FileStat::create(sChildPath);
+		if (! oChildFStat.exists()) {
+			continue; //----
+		}
+		aEntries.push_back(ScanCache::Entry{sChildName, oChildFStat.isDir()});
+	}
+	if (bUseCache) {
+		m_oScanCache.store(sPath, oStamp, aEntries);
+	}
+}
+void FofiModel::addExistingContent(int32_t nTWDIdx)
 {
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
 	assert(oTWD.m_aExisting.empty());
+	std::vector<ScanCache::Entry> aEntries;
 	try {
-		Glib::Dir oDir(oTWD.m_sPathName);
-		for (const auto& sChildName : oDir) {
-			const std::string sChildPath = Util::getPathFromDirAndName(oTWD.m_sPathName, sChildName);
-			const auto oChildFStat = Util::FileStat::create(sChildPath);
-			const bool bChildExists = oChildFStat.exists();
-			if (! bChildExists) {
-				continue; //----
-			}
-			const bool bChildIsDir = oChildFStat.isDir();
-			oTWD.m_aExisting.push_back({sChildName, bChildIsDir, false});
-		}
+		scanDirectory(getToWatchDirPath(nTWDIdx), aEntries);
 	} catch (const Glib::FileError& oErr) {
+		return; //--------------------------------------------------------------
+	}
+	for (const ScanCache::Entry& oEntry : aEntries) {
+		const int32_t nNameId = m_oStringPool.intern(oEntry.m_sName);
+		if (oTWD.findWatchedResultIdx(nNameId, oEntry.m_bIsDir) != -1) {
+			// re-watching a directory (see reconcileToWatchDir()): the result tells the state
+			continue; // for ---
+		}
+		oTWD.addExisting(nNameId, oEntry.m_bIsDir);
 	}
 }
 int32_t FofiModel::initialFillTheGaps(int32_t nChildTWDIdx, const std::string& sPath)
@@ -376,17 +520,16 @@ int32_t FofiModel::initialFillTheGaps(int32_t nChildTWDIdx, const std::string& s
 			return true;
 		} else {
 			checkThrowMaxToWatchDirsReached();
-			nTWDIdx = static_cast<int32_t>(m_aToWatchDirs.size());
-			m_aToWatchDirs.emplace_back();
+			nTWDIdx = allocToWatchDir();
 			return false;
 		}
 	}();
 	auto& oTWD = m_aToWatchDirs[nTWDIdx];
 	if (nChildTWDIdx >= 0) {
 		auto& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
-		const std::string sChildDirName{oChildTWD.getName()};
-		Util::addValueToVectorUniquely(oTWD.m_aPinnedSubDirs, sChildDirName);
-		Util::addValueToDequeUniquely(oTWD.m_aToWatchSubdirIdxs, nChildTWDIdx);
+		const int32_t nChildNameId = oChildTWD.m_nNameId;
+		Util::addValueToVectorUniquely(oTWD.m_aPinnedSubDirs, std::string{m_oStringPool.get(nChildNameId)});
+		oTWD.addSubDirIdx(nChildTWDIdx, nChildNameId);
 		if (oChildTWD.m_nParentTWDIdx < 0) {
 			oChildTWD.m_nParentTWDIdx = nTWDIdx;
 		}
@@ -394,18 +537,20 @@ int32_t FofiModel::initialFillTheGaps(int32_t nChildTWDIdx, const std::string& s
 	if (bAlreadyDefined) {
 		return nTWDIdx; //------------------------------------------------------
 	}
-	oTWD.m_sPathName = sPath;
 	const auto oFStat = Util::FileStat::create(sPath);
 	const bool bExists = oFStat.exists();
 	const bool bExistsAndDir = bExists && oFStat.isDir();
 	oTWD.m_bExists = bExistsAndDir;
 	const bool bIsRoot = (sPath == "/");
-	if (! bIsRoot) {
-		const auto nFoundSlashPos = sPath.find_last_of('/');
-		assert(nFoundSlashPos != std::string::npos);
-		oTWD.m_nNamePos = static_cast<int32_t>(nFoundSlashPos) + 1;
+	if (bIsRoot) {
+		m_nRootTWDIdx = nTWDIdx;
+	} else {
+		const std::string sName = Util::getPathFileName(sPath).second;
+		assert(! sName.empty());
+		oTWD.m_nNameId = m_oStringPool.intern(sName);
 	}
-	setDirectoryZone(oTWD);
+	// the parent is linked by the recursive call below
+	setDirectoryZone(oTWD, sPath);
 
 	if (! bIsRoot) {
 		std::string sParentDir = Util::getPathDirName(sPath).second;
@@ -419,7 +564,7 @@ int32_t FofiModel::initialFillTheGaps(int32_t nChildTWDIdx, const std::string& s
 	}
 	if (bRunning && bExistsAndDir) {
 		if (oTWD.isWatched()) {
-			addExistingContent(oTWD);
+			addExistingContent(nTWDIdx);
 		}
 	}
 	return nTWDIdx;
@@ -433,57 +578,71 @@ void FofiModel::initialCreateToWatchDir(int32_t nParentTWDIdx)
 		return; //--------------------------------------------------------------
 	}
 	const bool bRunning = (m_nEventCounter > 0);
+	const std::string sParentPath = getToWatchDirPath(nParentTWDIdx);
+	std::vector<ScanCache::Entry> aEntries;
 	try {
-		Glib::Dir oDir(oParentTWD.m_sPathName);
-		for (const auto& sChildName : oDir) {
-			const std::string sChildPath = Util::getPathFromDirAndName(oParentTWD.m_sPathName, sChildName);
-			const auto oFStat = Util::FileStat::create(sChildPath);
-			const bool bExists = oFStat.exists();
-			const bool bExistsAndDir = bExists && oFStat.isDir();
-			if (! bExistsAndDir) {
-				continue; //-----
+		scanDirectory(sParentPath, aEntries);
+	} catch (const Glib::FileError& oErr) {
+		return; //--------------------------------------------------------------
+	}
+	for (const ScanCache::Entry& oEntry : aEntries) {
+		if (! oEntry.m_bIsDir) {
+			continue; //-----
+		}
+		const std::string& sChildName = oEntry.m_sName;
+		const std::string sChildPath = Util::getPathFromDirAndName(sParentPath, sChildName);
+		if (isFilteredOutSubDir(oParentTWD, sChildName, sChildPath)) {
+			continue; //-----
+		}
+		int32_t nTWDIdx = findToWatchDir(nParentTWDIdx, sChildPath);
+		if (nTWDIdx >= 0) {
+			ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+			assert(oParentTWD.m_nIdxOwnerDirectoryZone >= 0);
+			assert(oTWD.m_nIdxOwnerDirectoryZone >= 0);
+			if (oTWD.m_nIdxOwnerDirectoryZone != oParentTWD.m_nIdxOwnerDirectoryZone) {
+				continue;  //-----
 			}
-			if (isFilteredOutSubDir(oParentTWD, sChildName, sChildPath)) {
+		} else {
+			nTWDIdx = addExistingToWatchDir(nParentTWDIdx, sChildName, sChildPath);
+		}
+		ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		if (bRunning && oTWD.m_bExists && !oTWD.isWatched()) {
+			createINotifyWatch(nTWDIdx, oTWD);
+			if (! oTWD.isWatched()) {
 				continue; //-----
 			}
-			int32_t nTWDIdx = findToWatchDir(nParentTWDIdx, sChildPath);
-			if (nTWDIdx >= 0) {
-				ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-				assert(oParentTWD.m_nIdxOwnerDirectoryZone >= 0);
-				assert(oTWD.m_nIdxOwnerDirectoryZone >= 0);
-				if (oTWD.m_nIdxOwnerDirectoryZone != oParentTWD.m_nIdxOwnerDirectoryZone) {
-					continue;  //-----
-				}
-			} else {
-				nTWDIdx = addExistingToWatchDir(sChildPath);
-				ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-				oTWD.m_nParentTWDIdx = nParentTWDIdx;
-				Util::addValueToDequeUniquely(oParentTWD.m_aToWatchSubdirIdxs, nTWDIdx);
-			}
-			ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-			if (bRunning && oTWD.m_bExists && !oTWD.isWatched()) {
-				createINotifyWatch(nTWDIdx, oTWD);
-				if (! oTWD.isWatched()) {
-					continue; //-----
-				}
-				//
-				addExistingContent(oTWD);
-			}
-			// recurse
-			initialCreateToWatchDir(nTWDIdx);
+			//
+			addExistingContent(nTWDIdx);
 		}
-	} catch (const Glib::FileError& oErr) {
+		// recurse
+		initialCreateToWatchDir(nTWDIdx);
 	}
 }
-void FofiModel::initialSetup()
+void FofiModel::clearToWatchDirs()
 {
 	m_aToWatchDirs.clear();
+	m_aFreeToWatchDirIdxs.clear();
+	m_aRecycleCandidates.clear();
+	m_aCompactTWDIdxs.clear();
+	m_nRootTWDIdx = -1;
+	for (auto& oEntry : m_aPathCache) {
+		oEntry.m_nTWDIdx = -1;
+	}
+}
+void FofiModel::sortDirectoryZones()
+{
 	// order related (possibly overlapping) directory zones by increasing depth
 	// (this is achieved by ordering by name)
 	std::sort(m_aDirectoryZones.begin(), m_aDirectoryZones.end(), [](const DirectoryZone& oDZ1, const DirectoryZone& oDZ2)
 	{
 		return (oDZ1.m_sPath < oDZ2.m_sPath);
 	});
+	rebuildDirectoryZoneTrie();
+}
+void FofiModel::initialSetup()
+{
+	clearToWatchDirs();
+	sortDirectoryZones();
 	// every directory zone base path needs it's ancestors (if existing)
 	// to be watched
 	const int32_t nTotDirectoryZones = static_cast<int32_t>(m_aDirectoryZones.size());
@@ -506,97 +665,274 @@ void FofiModel::initialSetup()
 		DirectoryZone& oDZ = m_aDirectoryZones[nDZIdx];
 		initialCreateToWatchDir(findToWatchDir(oDZ.m_sPath));
 	}
-	m_nRootTWDIdx = findToWatchDir("/");
+	// set by initialFillTheGaps()
 	assert(m_nRootTWDIdx >= 0);
 }
-int32_t FofiModel::addWatchedResult(ToWatchDir& oParentTWD, const std::string& sName, bool bIsDir)
+int32_t FofiModel::addWatchedResultRoot()
 {
-	return addWatchedResult(oParentTWD, oParentTWD.m_sPathName, sName, bIsDir);
+	return addWatchedResult(-1, "", true);
 }
-int32_t FofiModel::addWatchedResultRoot()
+int64_t FofiModel::ToWatchDir::getNameKey(int32_t nNameId, bool bIsDir)
 {
-	ToWatchDir oDummyTWD;
-	return addWatchedResult(oDummyTWD, "/", "", true);
+	return static_cast<int64_t>(nNameId) * 2 + (bIsDir ? 1 : 0);
 }
-std::deque<FofiModel::ToWatchDir::FileDir>::iterator FofiModel::ToWatchDir::findInExisting(bool bIsDir, const std::string& sName)
+void FofiModel::ToWatchDir::addSubDirIdx(int32_t nSubDirTWDIdx, int32_t nNameId)
 {
-	auto itFind = std::find_if(m_aExisting.begin(), m_aExisting.end(), [&](const ToWatchDir::FileDir& oFD)
-	{
-		return ((!oFD.m_bRemoved) && (oFD.m_sName == sName) && (oFD.m_bIsDir == bIsDir));
-	});
-	return itFind;
+	assert(nNameId >= 0);
+	const auto oPair = m_oSubDirIdxByName.emplace(nNameId, nSubDirTWDIdx);
+	const bool bInserted = oPair.second;
+	if (bInserted) {
+		m_aToWatchSubdirIdxs.push_back(nSubDirTWDIdx);
+	} else {
+		assert(oPair.first->second == nSubDirTWDIdx);
+	}
+}
+int32_t FofiModel::ToWatchDir::findSubDirIdx(int32_t nNameId) const
+{
+	const auto itFind = m_oSubDirIdxByName.find(nNameId);
+	if (itFind == m_oSubDirIdxByName.end()) {
+		return -1; //-----------------------------------------------------------
+	}
+	return itFind->second;
+}
+int32_t FofiModel::ToWatchDir::addWatchedResultIdx(int32_t nResultIdx, int32_t nNameId, bool bIsDir)
+{
+	assert(nNameId >= 0);
+	const int32_t nRefPos = static_cast<int32_t>(m_aWatchedResultIdxs.size());
+	m_aWatchedResultIdxs.push_back(nResultIdx);
+	// if already present keep the first, as a linear search would
+	m_oWatchedResultIdxByKey.emplace(getNameKey(nNameId, bIsDir), nResultIdx);
+	return nRefPos;
+}
+int32_t FofiModel::ToWatchDir::findWatchedResultIdx(int32_t nNameId, bool bIsDir) const
+{
+	const auto itFind = m_oWatchedResultIdxByKey.find(getNameKey(nNameId, bIsDir));
+	if (itFind == m_oWatchedResultIdxByKey.end()) {
+		return -1; //-----------------------------------------------------------
+	}
+	return itFind->second;
+}
+void FofiModel::ToWatchDir::addExisting(int32_t nNameId, bool bIsDir)
+{
+	assert(nNameId >= 0);
+	const int32_t nExistingIdx = static_cast<int32_t>(m_aExisting.size());
+	m_aExisting.push_back({nNameId, bIsDir, false});
+	m_oExistingIdxsByKey.emplace(getNameKey(nNameId, bIsDir), nExistingIdx);
+}
+void FofiModel::ToWatchDir::clearExisting()
+{
+	m_aExisting.clear();
+	m_oExistingIdxsByKey.clear();
+}
+std::deque<FofiModel::ToWatchDir::FileDir>::iterator FofiModel::ToWatchDir::findInExisting(bool bIsDir, int32_t nNameId)
+{
+	// the same name might have been added more than once,
+	// return the first that wasn't removed
+	int32_t nFoundIdx = -1;
+	const auto oRange = m_oExistingIdxsByKey.equal_range(getNameKey(nNameId, bIsDir));
+	for (auto itCur = oRange.first; itCur != oRange.second; ++itCur) {
+		const int32_t nExistingIdx = itCur->second;
+		if (m_aExisting[nExistingIdx].m_bRemoved) {
+			continue; // for ---
+		}
+		if ((nFoundIdx < 0) || (nExistingIdx < nFoundIdx)) {
+			nFoundIdx = nExistingIdx;
+		}
+	}
+	if (nFoundIdx < 0) {
+		return m_aExisting.end(); //--------------------------------------------
+	}
+	return m_aExisting.begin() + nFoundIdx;
 }
-int32_t FofiModel::addWatchedResult(ToWatchDir& oParentTWD, const std::string& sPath, const std::string& sName, bool bIsDir)
+int32_t FofiModel::addWatchedResult(int32_t nParentTWDIdx, const std::string& sName, bool bIsDir)
 {
-	int32_t nResultIdx = static_cast<int32_t>(m_aWatchedResults.size());
-	if (! sName.empty()) {
-		oParentTWD.m_aWatchedResultIdxs.push_back(nResultIdx);
+	const int32_t nResultIdx = allocWatchedResult();
+	const int32_t nNameId = m_oStringPool.intern(sName);
+	int32_t nRefPos = -1;
+	if (nParentTWDIdx >= 0) {
+		assert(! sName.empty());
+		ToWatchDir& oParentTWD = m_aToWatchDirs[nParentTWDIdx];
+		nRefPos = oParentTWD.addWatchedResultIdx(nResultIdx, nNameId, bIsDir);
 		//
-		const auto itFind = oParentTWD.findInExisting(bIsDir, sName);
+		const auto itFind = oParentTWD.findInExisting(bIsDir, nNameId);
 		if (itFind != oParentTWD.m_aExisting.end()) {
 			// When for a file or dir a result is created
 			// it is marked as removed from the existing list
 			(*itFind).m_bRemoved = true;
 		}
 	}
-	m_aWatchedResults.emplace_back();
 	WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
-	oWatchedResult.m_sPath = sPath;
-	oWatchedResult.m_sName = sName;
+	oWatchedResult.m_nParentTWDIdx = nParentTWDIdx;
+	oWatchedResult.m_nNameId = nNameId;
+	oWatchedResult.m_nRefPos = nRefPos;
 	oWatchedResult.m_bIsDir = bIsDir;
+	if (isResultSpill() && (nParentTWDIdx >= 0)) {
+		touchActiveResult(nResultIdx);
+	}
 	return nResultIdx;
 }
 void FofiModel::setInconsistent(WatchedResult& oWR)
 {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::setInconsistent =" << oWR.m_sPath << "/" << oWR.m_sName << (oWR.m_bIsDir ? "/" : "") << '\n';
-#endif //STMM_TRACE_DEBUG
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_INCONSISTENT, oWR.m_nParentTWDIdx, oWR.m_nNameId
+						, oWR.m_eResultType, (oWR.m_bIsDir ? 1 : 0), m_eCurEventAction);
 	oWR.m_bInconsistent = true;
 	m_bHasInconsistencies = true;
+	setChanged(oWR);
+}
+void FofiModel::setChanged(WatchedResult& oWR)
+{
+	if (oWR.m_nChangeGeneration == m_nCheckpointGeneration) {
+		return; //--------------------------------------------------------------
+	}
+	oWR.m_nChangeGeneration = m_nCheckpointGeneration;
+	m_aChangedResultKeys.emplace_back(oWR.m_nParentTWDIdx, ToWatchDir::getNameKey(oWR.m_nNameId, oWR.m_bIsDir));
+}
+static void addToResultCounts(FofiModel::ResultCounts& oCounts, FofiModel::RESULT_TYPE eResultType, int32_t nDelta)
+{
+	switch (eResultType) {
+		case FofiModel::RESULT_CREATED: oCounts.m_nCreated += nDelta; break;
+		case FofiModel::RESULT_DELETED: oCounts.m_nDeleted += nDelta; break;
+		case FofiModel::RESULT_MODIFIED: oCounts.m_nModified += nDelta; break;
+		case FofiModel::RESULT_TEMPORARY: oCounts.m_nTemporary += nDelta; break;
+		default: break;
+	}
+}
+void FofiModel::setResultType(WatchedResult& oWR, RESULT_TYPE eResultType)
+{
+	if (oWR.m_eResultType == eResultType) {
+		return; //--------------------------------------------------------------
+	}
+	updateResultCounts(oWR.m_nParentTWDIdx, oWR.m_eResultType, -1);
+	oWR.m_eResultType = eResultType;
+	updateResultCounts(oWR.m_nParentTWDIdx, eResultType, +1);
+}
+void FofiModel::updateResultCounts(int32_t nParentTWDIdx, RESULT_TYPE eResultType, int32_t nDelta)
+{
+	if (eResultType == RESULT_NONE) {
+		return; //--------------------------------------------------------------
+	}
+	addToResultCounts(m_oTotalResultCounts, eResultType, nDelta);
+	if (nParentTWDIdx < 0) {
+		// the root directory result
+		return; //--------------------------------------------------------------
+	}
+	addToResultCounts(m_aToWatchDirs[nParentTWDIdx].m_oResultCounts, eResultType, nDelta);
+	int32_t nTWDIdx = nParentTWDIdx;
+	while (nTWDIdx >= 0) {
+		ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		addToResultCounts(oTWD.m_oSubtreeResultCounts, eResultType, nDelta);
+		nTWDIdx = oTWD.m_nParentTWDIdx;
+	}
 }
 void FofiModel::setNotImmediate(WatchedResult& oWR)
 {
 	assert(! oWR.m_aActions.empty());
-	ActionData& oActionData = oWR.m_aActions.back();
+	ActionData& oActionData = oWR.m_aActions.getBack();
 	oActionData.m_bImmediate = false;
 }
-FofiModel::ActionData& FofiModel::addActionData(WatchedResult& oWR, INotifierSource::FOFI_ACTION eAction, int64_t nTimeUsec)
+void FofiModel::addActionData(WatchedResult& oWR, INotifierSource::FOFI_ACTION eAction, int64_t nTimeUsec
+								, bool bCausedByAttribChange, bool bImmediate, int32_t nOtherPathId)
 {
-	oWR.m_aActions.emplace_back();
-	ActionData& oActionData = oWR.m_aActions.back();
+	setChanged(oWR);
+	if (isResultSpill() && (oWR.m_nParentTWDIdx >= 0)) {
+		touchActiveResult(m_aToWatchDirs[oWR.m_nParentTWDIdx].m_aWatchedResultIdxs[oWR.m_nRefPos]);
+	}
+	auto& aActions = oWR.m_aActions;
+	if (m_bCollapseActions && ! aActions.empty()) {
+		ActionData& oLastActionData = aActions.getBack();
+		if ((oLastActionData.m_eAction == eAction) && (oLastActionData.m_nOtherPathId == nOtherPathId)
+				&& (oLastActionData.m_bCausedByAttribChange == bCausedByAttribChange)
+				&& (oLastActionData.m_bImmediate == bImmediate)) {
+			++oLastActionData.m_nCount;
+			oLastActionData.m_nLastTimeUsec = nTimeUsec;
+			return; //----------------------------------------------------------
+		}
+	}
+	ActionData* p0ActionData;
+	if ((m_nMaxActions > 0) && (aActions.size() >= m_nMaxActions)) {
+		// only more than the max if restored from a snapshot saved with a bigger max
+		while (aActions.size() > m_nMaxActions) {
+			oWR.m_nDroppedActions += aActions.front().m_nCount;
+			aActions.popFront();
+		}
+		oWR.m_nDroppedActions += aActions.front().m_nCount;
+		p0ActionData = &aActions.recycleFront();
+	} else {
+		p0ActionData = &aActions.pushBack();
+	}
+	ActionData& oActionData = *p0ActionData;
 	oActionData.m_eAction = eAction;
+	oActionData.m_bImmediate = bImmediate;
+	oActionData.m_bCausedByAttribChange = bCausedByAttribChange;
 	oActionData.m_nTimeUsec = nTimeUsec;
+	oActionData.m_nLastTimeUsec = nTimeUsec;
+	oActionData.m_nOtherPathId = nOtherPathId;
+}
+
+void FofiModel::ActionRing::straighten()
+{
+	if (m_nOldest == 0) {
+		return; //--------------------------------------------------------------
+	}
+	std::rotate(m_aData.begin(), m_aData.begin() + m_nOldest, m_aData.end());
+	m_nOldest = 0;
+}
+FofiModel::ActionData& FofiModel::ActionRing::pushBack()
+{
+	straighten();
+	m_aData.emplace_back();
+	return m_aData.back();
+}
+void FofiModel::ActionRing::popFront()
+{
+	assert(! m_aData.empty());
+	straighten();
+	m_aData.erase(m_aData.begin());
+}
+FofiModel::ActionData& FofiModel::ActionRing::recycleFront()
+{
+	assert(! m_aData.empty());
+	ActionData& oActionData = m_aData[m_nOldest];
+	oActionData = ActionData{};
+	++m_nOldest;
+	if (m_nOldest == size()) {
+		m_nOldest = 0;
+	}
 	return oActionData;
 }
+void FofiModel::ActionRing::resize(int32_t nSize)
+{
+	straighten();
+	m_aData.resize(nSize);
+}
 
 void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib, int64_t nNowUsec)
 {
-	createImmediateChildren(nParentTWDIdx, bWasAttrib, nNowUsec, m_aEFD);
+	createImmediateChildren(nParentTWDIdx, bWasAttrib, nNowUsec, m_oENK);
 }
-void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib, int64_t nNowUsec, const std::vector<ToWatchDir::FileDir>& aExcepts)
+void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib, int64_t nNowUsec, const std::unordered_set<int64_t>& oExceptKeys)
 {
-//std::cout << "FofiModel::createImmediateChildren nParentTWDIdx=" << nParentTWDIdx << '\n';
 	assert(nParentTWDIdx >= 0);
-	const bool bHasExcepts = ! aExcepts.empty();
+	const bool bHasExcepts = ! oExceptKeys.empty();
 	ToWatchDir& oParentTWD = m_aToWatchDirs[nParentTWDIdx];
 	const bool bParentIsLeaf = oParentTWD.isLeaf();
+	const std::string sParentPath = getToWatchDirPath(nParentTWDIdx);
 	try {
-		Glib::Dir oDir(oParentTWD.m_sPathName);
+		Glib::Dir oDir(sParentPath);
 		for (const auto& sChildName : oDir) {
-			const std::string sChildPath = Util::getPathFromDirAndName(oParentTWD.m_sPathName, sChildName);
+			const std::string sChildPath = Util::getPathFromDirAndName(sParentPath, sChildName);
 			const auto oFStat = Util::FileStat::create(sChildPath);
 			const bool bIsDir = oFStat.isDir();
+			// the child ends up either in a result or in the existing
+			const int32_t nChildNameId = m_oStringPool.intern(sChildName);
 			if (bHasExcepts) {
-				const auto itFind = std::find_if(aExcepts.begin(), aExcepts.end(), [&](const ToWatchDir::FileDir& oViFiDi) {
-					return ((oViFiDi.m_bIsDir == bIsDir) && (oViFiDi.m_sName == sChildName));
-				});
-				if (itFind != aExcepts.end()) {
+				if (oExceptKeys.count(ToWatchDir::getNameKey(nChildNameId, bIsDir)) > 0) {
 					continue; //for ---
 				}
 			}
 			const bool bFilteredOut = isFilteredOut(bIsDir, oParentTWD, sChildName, sChildPath);
 			if (bFilteredOut) {
-				oParentTWD.m_aExisting.push_back({sChildName, bIsDir, false});
+				oParentTWD.addExisting(nChildNameId, bIsDir);
 				continue; //-----
 			}
 			bool bExistedAtStart = false;
@@ -606,16 +942,10 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 			int32_t nResultIdx = findResult(nParentTWDIdx, sChildName, bIsDir);
 			bool bWatchedResultExists = (nResultIdx >= 0);
 			if (! bWatchedResultExists) {
-				nResultIdx = addWatchedResult(oParentTWD, sChildName, bIsDir);
-#ifdef STMM_TRACE_DEBUG
-	std::cout << "FofiModel::createImmediateChildren Created immediately (N) sChildPath=" << sChildPath << '\n';
-#endif //STMM_TRACE_DEBUG
+				nResultIdx = addWatchedResult(nParentTWDIdx, sChildName, bIsDir);
 			} else {
 				WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
 				bWasCreatedImmediately = oWatchedResult.immediate();
-#ifdef STMM_TRACE_DEBUG
-	std::cout << "FofiModel::createImmediateChildren Created immediately (E) sChildPath=" << sChildPath << '\n';
-#endif //STMM_TRACE_DEBUG
 				if (bWasCreatedImmediately) {
 					assert(oWatchedResult.exists());
 				}
@@ -626,27 +956,21 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 				bExistedAtStart = oWatchedResult.existedAtStart();
 				bInconsistent = ((!bWasCreatedImmediately) && oWatchedResult.exists());
 				if (bInconsistent) {
-#ifdef STMM_TRACE_DEBUG
-	std::cout << "FofiModel::createImmediateChildren Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sChildName=" << sChildName << '\n';
-	std::cout << "FofiModel::createImmediateChildren            1 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
 			}
 			WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
 			if ((! bWasCreatedImmediately) || bInconsistent) {
-				ActionData& oActionData = addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_CREATE, nNowUsec);
-				oActionData.m_bCausedByAttribChange = bWasAttrib;
-				oActionData.m_bImmediate = ! bInconsistent;
+				addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_CREATE, nNowUsec, bWasAttrib, ! bInconsistent);
 			} else {
 				bEmitWatchedResult = false;
 			}
 			//
-			oWatchedResult.m_eResultType = (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED);
+			setResultType(oWatchedResult, (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED));
 
 			if (! bIsDir) {
 				if (bEmitWatchedResult) {
-					m_oWatchedResultActionSignal.emit(oWatchedResult);
+					emitWatchedResultAction(oWatchedResult);
 				}
 				continue; //-----
 			}
@@ -656,14 +980,11 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 				if (bParentIsLeaf) {
 					// if a structural TWD is not present this dir isn't watched
 					if (bEmitWatchedResult) {
-						m_oWatchedResultActionSignal.emit(oWatchedResult);
+						emitWatchedResultAction(oWatchedResult);
 					}
 					continue; //-----
 				}
-				nTWDIdx = addExistingToWatchDir(sChildPath);
-				ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-				oTWD.m_nParentTWDIdx = nParentTWDIdx;
-				Util::addValueToDequeUniquely(oParentTWD.m_aToWatchSubdirIdxs, nTWDIdx);
+				nTWDIdx = addExistingToWatchDir(nParentTWDIdx, sChildName, sChildPath);
 			} else {
 				ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
 				if (oTWD.m_bExists) {
@@ -673,8 +994,7 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 						if (oTWD.isWatched()) {
 							// if it's watched it's permission might have changed
 							// and might no longer be watchable
-							m_refSource->removePath(oTWD.m_nWatchedIdx, nTWDIdx);
-							oTWD.m_nWatchedIdx = -1;
+							removeINotifyWatch(nTWDIdx, oTWD);
 						}
 						if (bWatchedResultExists) {
 							// If WR existed and TWD is inconsistent
@@ -682,14 +1002,10 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 							assert(bInconsistent);
 						} else { // WR just created
 							if (!bInconsistent) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::createImmediateChildren Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sChildName=" << sChildName << '\n';
-//	std::cout << "FofiModel::createImmediateChildren           1b oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 								setInconsistent(oWatchedResult);
 								assert(oWatchedResult.m_eResultType == RESULT_CREATED);
 								// when a directory is deleted and then recreated mark it as modified
-								oWatchedResult.m_eResultType = RESULT_MODIFIED;
+								setResultType(oWatchedResult, RESULT_MODIFIED);
 							}
 						}
 					} else {
@@ -710,136 +1026,1565 @@ void FofiModel::createImmediateChildren(int32_t nParentTWDIdx, bool bWasAttrib,
 			}
 			//
 			if (bEmitWatchedResult) {
-				m_oWatchedResultActionSignal.emit(oWatchedResult);
+				emitWatchedResultAction(oWatchedResult);
 			}
 			if (oTWD.isWatched()) {
 				// only recurse if could create a watch
 				createImmediateChildren(nTWDIdx, bWasAttrib, nNowUsec);
 			}
 		}
-	} catch (const Glib::FileError& oErr) {
-		//TODO set inconsistent of paernt WR (maybe it's root!)
+	} catch (const Glib::FileError& oErr) {
+		//TODO set inconsistent of paernt WR (maybe it's root!)
+	}
+}
+std::string FofiModel::calcToWatchDirectories()
+{
+	assert(m_nEventCounter == 0); // Can't call this while running
+	return internalCalcToWatchDirectories();
+}
+std::string FofiModel::internalCalcToWatchDirectories()
+{
+	if (! m_sScanCachePath.empty()) {
+		// a missing or stale cache just means the directories are read
+		m_oScanCache.load(m_sScanCachePath);
+	}
+	m_bInitialSetup = true;
+	try {
+		initialSetup();
+	} catch (const std::runtime_error& oErr) {
+		m_bInitialSetup = false;
+		m_oScanCache.clear();
+		return oErr.what(); //--------------------------------------------------
+	}
+
+	m_bInitialSetup = false;
+	m_nTotCachedScans = m_oScanCache.getTotHits();
+	if (! m_sScanCachePath.empty()) {
+		// failing to update the cache only slows down the next run
+		m_oScanCache.save(m_sScanCachePath);
+	}
+	m_oScanCache.clear();
+	return "";
+}
+const std::deque<FofiModel::ToWatchDir>& FofiModel::getToWatchDirectories() const
+{
+	return m_aToWatchDirs;
+}
+int32_t FofiModel::getRootToWatchDirectoriesIdx() const
+{
+	return m_nRootTWDIdx;
+}
+std::string FofiModel::getToWatchDirPath(int32_t nTWDIdx) const
+{
+	assert((nTWDIdx >= 0) && (nTWDIdx < static_cast<int32_t>(m_aToWatchDirs.size())));
+	// walk up to the closest ancestor whose path is cached (or the root)
+	m_aPathChain.clear();
+	std::string sPath;
+	int32_t nCurIdx = nTWDIdx;
+	while (true) {
+		const PathCacheEntry& oEntry = m_aPathCache[nCurIdx % s_nPathCacheSize];
+		if (oEntry.m_nTWDIdx == nCurIdx) {
+			sPath = oEntry.m_sPath;
+			break; // while ---
+		}
+		const ToWatchDir& oCurTWD = m_aToWatchDirs[nCurIdx];
+		if (oCurTWD.m_nParentTWDIdx < 0) {
+			// only the root has no parent
+			assert(oCurTWD.m_nNameId < 0);
+			sPath = "/";
+			break; // while ---
+		}
+		m_aPathChain.push_back(nCurIdx);
+		nCurIdx = oCurTWD.m_nParentTWDIdx;
+	}
+	// then down again appending the names
+	for (auto itChain = m_aPathChain.rbegin(); itChain != m_aPathChain.rend(); ++itChain) {
+		const int32_t nChainIdx = *itChain;
+		sPath = Util::getPathFromDirAndName(sPath, m_oStringPool.get(m_aToWatchDirs[nChainIdx].m_nNameId));
+		PathCacheEntry& oEntry = m_aPathCache[nChainIdx % s_nPathCacheSize];
+		oEntry.m_nTWDIdx = nChainIdx;
+		oEntry.m_sPath = sPath;
+	}
+	return sPath;
+}
+std::string FofiModel::start()
+{
+	assert(m_nEventCounter == 0);
+	const int64_t nStartCpuUsec = Util::getProcessCpuTimeMicroseconds();
+	m_nEventCounter = 1; // marks start watching
+	// the results of the last run are discarded together with their names
+	std::string sError = clearResults();
+	if (! sError.empty()) {
+		m_nEventCounter = 0;
+		return sError; //-------------------------------------------------------
+	}
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_START, -1, -1, 0);
+	// create ToWatchDir and add to INotifierSource
+	sError = internalCalcToWatchDirectories();
+	if (! sError.empty()) {
+		m_nEventCounter = 0;
+		return sError; //-------------------------------------------------------
+	}
+
+	m_nStartTimeUsec = Util::getNowTimeMicroseconds();
+	m_nStopTimeUsec = -1;
+	//
+	m_bOverflow = false;
+	m_bHasInconsistencies = false;
+	//
+	assert(m_aOpenMoves.empty());
+	setWatchStartCpuTime(nStartCpuUsec);
+	return "";
+}
+std::string FofiModel::clearResults()
+{
+	m_nRootResultIdx = -1;
+	m_aWatchedResults.clear();
+	m_aFreeWatchedResultIdxs.clear();
+	m_nCheckpointGeneration = 1;
+	m_aChangedResultKeys.clear();
+	m_oTotalResultCounts = ResultCounts{};
+	for (ToWatchDir& oTWD : m_aToWatchDirs) {
+		oTWD.m_oResultCounts = ResultCounts{};
+		oTWD.m_oSubtreeResultCounts = ResultCounts{};
+	}
+	m_aSpilledSlots.clear();
+	m_nTotSpilledResults = 0;
+	m_aFreeSpilledIds.clear();
+	m_nSpillDeadBytes = 0;
+	m_nNextSpillCheckUsec = 0;
+	m_nOldestActiveIdx = -1;
+	m_nNewestActiveIdx = -1;
+	m_oStringPool.clear();
+	m_nNamesAfterRelease = 0;
+	for (auto& oHistogram : m_aLatencyHistograms) {
+		oHistogram.clear();
+	}
+	m_aTotEvents.fill(0);
+	m_nTotFilteredOutEvents = 0;
+	m_nTotOverflows = 0;
+	m_oFailedWatches.clear();
+	if (m_sSpillDir.empty()) {
+		m_oSpillSegment.close();
+		return ""; //-----------------------------------------------------------
+	}
+	return m_oSpillSegment.open(m_sSpillDir);
+}
+void FofiModel::stop()
+{
+	assert(m_nEventCounter > 0);
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_STOP, -1, -1);
+	m_nStopTimeUsec = Util::getNowTimeMicroseconds();
+	m_aOpenMoves.clear();
+	m_aRecycleCandidates.clear();
+	m_nEventCounter = 0; // stop watching
+	m_refSource->clearAll();
+	m_nWatchStopCpuUsec = Util::getProcessCpuTimeMicroseconds();
+}
+const LatencyHistogram& FofiModel::getLatencyHistogram(INotifierSource::FOFI_ACTION eAction, LATENCY_STAGE eStage) const
+{
+	assert((eAction >= 0) && (eAction < s_nTotEventActions));
+	assert((eStage >= 0) && (eStage < s_nTotLatencyStages));
+	return m_aLatencyHistograms[eAction * s_nTotLatencyStages + eStage];
+}
+void FofiModel::setWatchStartCpuTime(int64_t nSetupStartCpuUsec)
+{
+	m_nWatchStartCpuUsec = Util::getProcessCpuTimeMicroseconds();
+	m_nWatchStopCpuUsec = -1;
+	m_nSetupCpuUsec = m_nWatchStartCpuUsec - nSetupStartCpuUsec;
+}
+FofiModel::Metrics FofiModel::getMetrics() const
+{
+	Metrics oMetrics;
+	oMetrics.m_aTotEvents = m_aTotEvents;
+	oMetrics.m_nTotFilteredOutEvents = m_nTotFilteredOutEvents;
+	oMetrics.m_nTotOverflows = m_nTotOverflows;
+	oMetrics.m_nTotReads = m_refSource->getTotReads();
+	oMetrics.m_nTotReadEvents = m_refSource->getTotReadEvents();
+	oMetrics.m_nTotWatches = m_refSource->getTotWatches();
+	oMetrics.m_oFailedWatches = m_oFailedWatches;
+	for (const ToWatchDir& oTWD : m_aToWatchDirs) {
+		if (oTWD.m_bFree) {
+			continue; // for ---
+		}
+		++oMetrics.m_nTotToWatchDirs;
+		if (oTWD.m_bExists) {
+			++oMetrics.m_nTotExistingToWatchDirs;
+		}
+	}
+	oMetrics.m_nTotResults = static_cast<int32_t>(m_aWatchedResults.size() - m_aFreeWatchedResultIdxs.size());
+	oMetrics.m_nTotSpilledResults = m_nTotSpilledResults;
+	oMetrics.m_nSpillFileBytes = m_oSpillSegment.size();
+	oMetrics.m_nTotOpenMoves = static_cast<int32_t>(m_aOpenMoves.size());
+	oMetrics.m_nModelBytes = estimateMemoryBytes();
+	oMetrics.m_nPeakResidentBytes = Util::getPeakResidentBytes();
+	oMetrics.m_nSetupCpuUsec = m_nSetupCpuUsec;
+	if (m_nWatchStartCpuUsec >= 0) {
+		const int64_t nEndCpuUsec = ((m_nWatchStopCpuUsec >= 0) ? m_nWatchStopCpuUsec : Util::getProcessCpuTimeMicroseconds());
+		oMetrics.m_nWatchCpuUsec = nEndCpuUsec - m_nWatchStartCpuUsec;
+	}
+	oMetrics.m_nSnapshotCpuUsec = m_nSnapshotCpuUsec;
+	return oMetrics;
+}
+TraceRing::Dump FofiModel::getTraceDump(const std::string& sReason) const
+{
+	TraceRing::Dump oDump;
+	oDump.m_sReason = sReason;
+	oDump.m_nDumpTimeNsec = Util::getNowTimeNanoseconds();
+	oDump.m_nDumpWallTimeUsec = std::chrono::duration_cast<std::chrono::microseconds>(
+													std::chrono::system_clock::now().time_since_epoch()).count();
+	oDump.m_nTotRecorded = m_oTraceRing.getTotRecorded();
+	oDump.m_aRecords = m_oTraceRing.getRecords();
+	// the ids of the records before the last start refer to the names of a previous run
+	const auto& aRecords = oDump.m_aRecords;
+	const auto itLastStart = std::find_if(aRecords.rbegin(), aRecords.rend(), [](const TraceRing::Record& oRecord)
+	{
+		return (oRecord.m_nEvent == TraceRing::TRACE_EVENT_START);
+	});
+	const auto itFirstCur = ((itLastStart == aRecords.rend()) ? aRecords.begin() : std::prev(itLastStart.base()));
+	const int32_t nTotTWDs = static_cast<int32_t>(m_aToWatchDirs.size());
+	for (auto itRecord = itFirstCur; itRecord != aRecords.end(); ++itRecord) {
+		const int32_t nNameId = itRecord->m_nNameId;
+		if ((nNameId >= 0) && (nNameId < m_oStringPool.size())) {
+			oDump.m_oNames.emplace(nNameId, m_oStringPool.get(nNameId));
+		}
+		const int32_t nTag = itRecord->m_nTag;
+		if ((nTag >= 0) && (nTag < nTotTWDs) && (! m_aToWatchDirs[nTag].isFree())
+				&& (oDump.m_oDirPaths.find(nTag) == oDump.m_oDirPaths.end())) {
+			oDump.m_oDirPaths.emplace(nTag, getToWatchDirPath(nTag));
+		}
+	}
+	return oDump;
+}
+int64_t FofiModel::estimateMemoryBytes() const
+{
+	// the nodes of the std::unordered_map: next pointer, key, value and cached hash
+	constexpr int64_t nHashNodeBytes = sizeof(void*) + 2 * sizeof(int64_t) + sizeof(size_t);
+	const auto oHashBytes = [&](int64_t nSize, int64_t nBuckets) -> int64_t
+	{
+		return nSize * nHashNodeBytes + nBuckets * static_cast<int64_t>(sizeof(void*));
+	};
+	int64_t nBytes = sizeof(FofiModel);
+	nBytes += static_cast<int64_t>(m_aToWatchDirs.size()) * sizeof(ToWatchDir);
+	for (const ToWatchDir& oTWD : m_aToWatchDirs) {
+		nBytes += static_cast<int64_t>(oTWD.m_aToWatchSubdirIdxs.size()) * sizeof(int32_t);
+		nBytes += static_cast<int64_t>(oTWD.m_aWatchedResultIdxs.capacity()) * sizeof(int32_t);
+		nBytes += static_cast<int64_t>(oTWD.m_aExisting.size()) * sizeof(ToWatchDir::FileDir);
+		nBytes += oHashBytes(oTWD.m_oSubDirIdxByName.size(), oTWD.m_oSubDirIdxByName.bucket_count());
+		nBytes += oHashBytes(oTWD.m_oWatchedResultIdxByKey.size(), oTWD.m_oWatchedResultIdxByKey.bucket_count());
+		nBytes += oHashBytes(oTWD.m_oExistingIdxsByKey.size(), oTWD.m_oExistingIdxsByKey.bucket_count());
+	}
+	nBytes += static_cast<int64_t>(m_aFreeToWatchDirIdxs.capacity()) * sizeof(int32_t);
+	nBytes += static_cast<int64_t>(m_aWatchedResults.size()) * sizeof(WatchedResult);
+	for (const WatchedResult& oWR : m_aWatchedResults) {
+		nBytes += static_cast<int64_t>(oWR.m_aActions.capacity()) * sizeof(ActionData);
+	}
+	nBytes += static_cast<int64_t>(m_aFreeWatchedResultIdxs.capacity()) * sizeof(int32_t);
+	nBytes += static_cast<int64_t>(m_aSpilledSlots.capacity()) * sizeof(SpilledSlot);
+	nBytes += static_cast<int64_t>(m_aFreeSpilledIds.capacity()) * sizeof(int32_t);
+	for (const PathCacheEntry& oEntry : m_aPathCache) {
+		nBytes += sizeof(PathCacheEntry) + oEntry.m_sPath.capacity();
+	}
+	nBytes += static_cast<int64_t>(m_aRecycleCandidates.capacity()) * sizeof(RecycleCandidate);
+	nBytes += static_cast<int64_t>(m_aOpenMoves.capacity()) * sizeof(OpenMove);
+	nBytes += static_cast<int64_t>(m_aLatencyHistograms.size()) * sizeof(LatencyHistogram);
+	nBytes += m_oStringPool.getAllocatedBytes();
+	return nBytes;
+}
+int64_t FofiModel::getDuration() const
+{
+	if (m_nStartTimeUsec < 0) {
+		return 0;
+	} else if (m_nStopTimeUsec >= m_nStartTimeUsec) {
+		return m_nStopTimeUsec - m_nStartTimeUsec;
+	} else {
+		return Util::getNowTimeMicroseconds() - m_nStartTimeUsec;
+	}
+}
+std::string FofiModel::saveSnapshot(const std::string& sPathName) const
+{
+	const int64_t nStartCpuUsec = Util::getProcessCpuTimeMicroseconds();
+	const std::string sError = writeSnapshot(sPathName);
+	m_nSnapshotCpuUsec = Util::getProcessCpuTimeMicroseconds() - nStartCpuUsec;
+	return sError;
+}
+std::string FofiModel::writeSnapshot(const std::string& sPathName) const
+{
+	assert(m_nStartTimeUsec >= 0); // start() or resume() must have been called
+	assert(m_nRootTWDIdx >= 0);
+	return Util::writeFileAtomically(sPathName, [&](std::ostream& oOut)
+	{
+		return writeSnapshotContent(oOut);
+	});
+}
+std::string FofiModel::writeSnapshotContent(std::ostream& oOut) const
+{
+	uint64_t nChecksum = Util::s_nChecksumInit;
+	const auto oWrite = [&](const void* p0Src, size_t nSize)
+	{
+		nChecksum = Util::updateChecksum(nChecksum, static_cast<const char*>(p0Src), nSize);
+		oOut.write(static_cast<const char*>(p0Src), nSize);
+	};
+	const auto oWriteInt32 = [&](int32_t nValue)
+	{
+		oWrite(&nValue, sizeof(int32_t));
+	};
+	const auto oWriteString = [&](const char* p0Str, size_t nLen)
+	{
+		oWriteInt32(static_cast<int32_t>(nLen));
+		oWrite(p0Str, nLen);
+	};
+	const int32_t nTotTWDs = static_cast<int32_t>(m_aToWatchDirs.size());
+	const int32_t nRootResultIdx = findRootResult();
+	int32_t nTotResults = ((nRootResultIdx >= 0) ? 1 : 0);
+	for (const ToWatchDir& oTWD : m_aToWatchDirs) {
+		if (! oTWD.m_bFree) {
+			nTotResults += static_cast<int32_t>(oTWD.m_aWatchedResultIdxs.size());
+		}
+	}
+	SnapshotHeader oHeader{};
+	std::memcpy(oHeader.m_aMagic, s_p0SnapshotMagic, sizeof(oHeader.m_aMagic));
+	oHeader.m_nVersion = s_nSnapshotVersion;
+	oHeader.m_nFlags = (m_bOverflow ? s_nSnapshotFlagOverflow : 0) | (m_bHasInconsistencies ? s_nSnapshotFlagInconsistencies : 0);
+	oHeader.m_nDurationUsec = getDuration();
+	oHeader.m_nTotPoolStrings = m_oStringPool.size();
+	oHeader.m_nTotZones = static_cast<int32_t>(m_aDirectoryZones.size());
+	oHeader.m_nTotFiles = static_cast<int32_t>(m_aToWatchFiles.size());
+	oHeader.m_nTotTWDs = nTotTWDs;
+	oHeader.m_nRootTWDIdx = m_nRootTWDIdx;
+	oHeader.m_nTotResults = nTotResults;
+	oWrite(&oHeader, sizeof(SnapshotHeader));
+	// the pool is rebuilt in the same order so that the ids don't change
+	for (int32_t nId = 0; nId < oHeader.m_nTotPoolStrings; ++nId) {
+		if (m_oStringPool.isReleased(nId)) {
+			oWriteInt32(-1);
+			continue; // for ---
+		}
+		const char* p0Str = m_oStringPool.get(nId);
+		oWriteString(p0Str, std::strlen(p0Str));
+	}
+	for (const DirectoryZone& oDZ : m_aDirectoryZones) {
+		oWriteString(oDZ.m_sPath.c_str(), oDZ.m_sPath.size());
+		oWriteInt32(oDZ.m_nMaxDepth);
+	}
+	for (const std::string& sFilePath : m_aToWatchFiles) {
+		oWriteString(sFilePath.c_str(), sFilePath.size());
+	}
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		const ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		SnapshotTWD oST{};
+		if (oTWD.m_bFree) {
+			oST.m_nFree = 1;
+			oWrite(&oST, sizeof(SnapshotTWD));
+			continue; // for ---
+		}
+		if (oTWD.isWatched()) {
+			// resume() only rescans the directory if it changed after this
+			oST.m_nMTimeNsec = Util::FileStat::create(getToWatchDirPath(nTWDIdx)).getModificationTimeNsec();
+		}
+		oST.m_nNameId = oTWD.m_nNameId;
+		oST.m_nParentTWDIdx = oTWD.m_nParentTWDIdx;
+		oST.m_nIdxOwnerDirectoryZone = oTWD.m_nIdxOwnerDirectoryZone;
+		oST.m_nDepth = oTWD.m_nDepth;
+		oST.m_nMaxDepth = oTWD.m_nMaxDepth;
+		oST.m_nTotPinnedSubDirs = static_cast<int32_t>(oTWD.m_aPinnedSubDirs.size());
+		oST.m_nTotPinnedFiles = static_cast<int32_t>(oTWD.m_aPinnedFiles.size());
+		oST.m_nTotExisting = static_cast<int32_t>(oTWD.m_aExisting.size());
+		oST.m_nExists = (oTWD.m_bExists ? 1 : 0);
+		oST.m_nWatched = (oTWD.isWatched() ? 1 : 0);
+		oWrite(&oST, sizeof(SnapshotTWD));
+		for (const std::string& sName : oTWD.m_aPinnedSubDirs) {
+			oWriteString(sName.c_str(), sName.size());
+		}
+		for (const std::string& sName : oTWD.m_aPinnedFiles) {
+			oWriteString(sName.c_str(), sName.size());
+		}
+		for (const ToWatchDir::FileDir& oFD : oTWD.m_aExisting) {
+			SnapshotExisting oSE{};
+			oSE.m_nNameId = oFD.m_nNameId;
+			oSE.m_nIsDir = (oFD.m_bIsDir ? 1 : 0);
+			oSE.m_nRemoved = (oFD.m_bRemoved ? 1 : 0);
+			oWrite(&oSE, sizeof(SnapshotExisting));
+		}
+	}
+	// the results are written in the order their parents reference them, so that
+	// a result shadowing another with the same name still does after resume()
+	std::vector<char> aBuffer;
+	if (nRootResultIdx >= 0) {
+		serializeResult(m_aWatchedResults[nRootResultIdx], aBuffer);
+		oWrite(aBuffer.data(), aBuffer.size());
+	}
+	WatchedResult oSpilledWR;
+	for (const ToWatchDir& oTWD : m_aToWatchDirs) {
+		if (oTWD.m_bFree) {
+			continue; // for ---
+		}
+		for (const int32_t nRef : oTWD.m_aWatchedResultIdxs) {
+			if (! isSpilledRef(nRef)) {
+				serializeResult(m_aWatchedResults[nRef], aBuffer);
+			} else {
+				if (! readSpilledResult(getSpilledId(nRef), oSpilledWR)) {
+					const std::string sError = "Could not read spilled result from " + m_oSpillSegment.getPath();
+					return sError; //-------------------------------------------
+				}
+				serializeResult(oSpilledWR, aBuffer);
+			}
+			oWrite(aBuffer.data(), aBuffer.size());
+		}
+	}
+	oOut.write(reinterpret_cast<const char*>(&nChecksum), sizeof(uint64_t));
+	return "";
+}
+std::string FofiModel::resume(const std::string& sPathName)
+{
+	assert(m_nEventCounter == 0);
+	const int64_t nStartCpuUsec = Util::getProcessCpuTimeMicroseconds();
+	const int nFD = ::open(sPathName.c_str(), O_RDONLY | O_CLOEXEC);
+	if (nFD < 0) {
+		const std::string sError = "Could not open snapshot " + sPathName + ": " + Glib::strerror(errno);
+		return sError; //-------------------------------------------------------
+	}
+	struct ::stat oStat;
+	if ((::fstat(nFD, &oStat) != 0) || (oStat.st_size < static_cast<off_t>(sizeof(SnapshotHeader)))) {
+		::close(nFD);
+		const std::string sError = "Not a snapshot file: " + sPathName;
+		return sError; //-------------------------------------------------------
+	}
+	const int64_t nSize = oStat.st_size;
+	void* p0Map = ::mmap(nullptr, nSize, PROT_READ, MAP_PRIVATE, nFD, 0);
+	::close(nFD);
+	if (p0Map == MAP_FAILED) {
+		const std::string sError = "Could not map snapshot " + sPathName + ": " + Glib::strerror(errno);
+		return sError; //-------------------------------------------------------
+	}
+	::madvise(p0Map, nSize, MADV_SEQUENTIAL);
+
+	m_nEventCounter = 1; // marks start watching
+	std::string sError = clearResults();
+	if (sError.empty()) {
+		m_oTraceRing.trace(TraceRing::TRACE_EVENT_START, -1, -1, 1);
+		m_bInitialSetup = true;
+		try {
+			internalResume(static_cast<const char*>(p0Map), nSize);
+		} catch (const std::runtime_error& oErr) {
+			sError = oErr.what();
+		}
+		m_bInitialSetup = false;
+	}
+	::munmap(p0Map, nSize);
+	if (! sError.empty()) {
+		m_refSource->clearAll();
+		clearToWatchDirs();
+		m_nEventCounter = 0;
+		return sError; //-------------------------------------------------------
+	}
+	assert(m_aOpenMoves.empty());
+	setWatchStartCpuTime(nStartCpuUsec);
+	return "";
+}
+void FofiModel::internalResume(const char* p0Data, int64_t nSize)
+{
+	int64_t nPos = 0;
+	int64_t nDataEnd = nSize; // Excludes the checksum once verified
+	const auto oCheckAvailable = [&](int64_t nBytes)
+	{
+		if ((nBytes < 0) || (nPos + nBytes > nDataEnd)) {
+			throw std::runtime_error("Snapshot is truncated");
+		}
+	};
+	const auto oRead = [&](void* p0Dest, int64_t nBytes)
+	{
+		oCheckAvailable(nBytes);
+		std::memcpy(p0Dest, p0Data + nPos, nBytes);
+		nPos += nBytes;
+	};
+	const auto oReadInt32 = [&]() -> int32_t
+	{
+		int32_t nValue;
+		oRead(&nValue, sizeof(int32_t));
+		return nValue;
+	};
+	const auto oReadString = [&]() -> std::string
+	{
+		const int32_t nLen = oReadInt32();
+		oCheckAvailable(nLen);
+		std::string sStr(p0Data + nPos, nLen);
+		nPos += nLen;
+		return sStr;
+	};
+	const auto oCheckCorrupted = [](bool bValid)
+	{
+		if (! bValid) {
+			throw std::runtime_error("Snapshot is corrupted");
+		}
+	};
+	SnapshotHeader oHeader;
+	oRead(&oHeader, sizeof(SnapshotHeader));
+	if (std::memcmp(oHeader.m_aMagic, s_p0SnapshotMagic, sizeof(oHeader.m_aMagic)) != 0) {
+		throw std::runtime_error("Not a snapshot file");
+	}
+	if (oHeader.m_nVersion != s_nSnapshotVersion) {
+		throw std::runtime_error("Unsupported snapshot version " + std::to_string(oHeader.m_nVersion));
+	}
+	// the data is verified before any count or index in it is used
+	oCheckAvailable(sizeof(uint64_t));
+	nDataEnd = nSize - static_cast<int64_t>(sizeof(uint64_t));
+	uint64_t nChecksum;
+	std::memcpy(&nChecksum, p0Data + nDataEnd, sizeof(uint64_t));
+	oCheckCorrupted(nChecksum == Util::updateChecksum(Util::s_nChecksumInit, p0Data, nDataEnd));
+	const int32_t nTotPoolStrings = oHeader.m_nTotPoolStrings;
+	const int32_t nTotTWDs = oHeader.m_nTotTWDs;
+	oCheckCorrupted((nTotPoolStrings >= 0) && (oHeader.m_nTotZones >= 0) && (oHeader.m_nTotFiles >= 0)
+					&& (oHeader.m_nRootTWDIdx >= 0) && (oHeader.m_nRootTWDIdx < nTotTWDs)
+					&& (oHeader.m_nTotResults >= 0) && (oHeader.m_nDurationUsec >= 0));
+	// interning in the same order gives the names their old ids
+	for (int32_t nId = 0; nId < nTotPoolStrings; ++nId) {
+		const int32_t nLen = oReadInt32();
+		if (nLen == -1) {
+			m_oStringPool.addReleased();
+			continue; // for ---
+		}
+		oCheckCorrupted(nLen >= 0);
+		oCheckAvailable(nLen);
+		oCheckCorrupted(m_oStringPool.append(std::string(p0Data + nPos, nLen)) == nId);
+		nPos += nLen;
+	}
+	m_nNamesAfterRelease = m_oStringPool.size() - m_oStringPool.getTotReleased();
+	const auto oIsValidNameId = [&](int32_t nNameId)
+	{
+		return (nNameId >= -1) && (nNameId < nTotPoolStrings);
+	};
+	// the owner zone indexes are only valid if the zones are the same,
+	// they are put in the order of the snapshot since zones added or
+	// removed while watching aren't sorted
+	bool bSameZones = (oHeader.m_nTotZones == static_cast<int32_t>(m_aDirectoryZones.size()));
+	std::vector<DirectoryZone> aOrderedZones;
+	for (int32_t nDZIdx = 0; nDZIdx < oHeader.m_nTotZones; ++nDZIdx) {
+		const std::string sPath = oReadString();
+		const int32_t nMaxDepth = oReadInt32();
+		if (bSameZones) {
+			const int32_t nFoundIdx = findDirectoryZone(sPath);
+			bSameZones = (nFoundIdx >= 0) && (m_aDirectoryZones[nFoundIdx].m_nMaxDepth == nMaxDepth);
+			if (bSameZones) {
+				aOrderedZones.push_back(m_aDirectoryZones[nFoundIdx]);
+			}
+		}
+	}
+	if (! bSameZones) {
+		throw std::runtime_error("The directory zones differ from those of the snapshot");
+	}
+	// the paths are unique, therefore it is a permutation
+	m_aDirectoryZones = std::move(aOrderedZones);
+	rebuildDirectoryZoneTrie();
+	std::vector<std::string> aFilePaths;
+	for (int32_t nFileIdx = 0; nFileIdx < oHeader.m_nTotFiles; ++nFileIdx) {
+		aFilePaths.push_back(oReadString());
+	}
+	std::vector<std::string> aToWatchFiles = m_aToWatchFiles;
+	std::sort(aFilePaths.begin(), aFilePaths.end());
+	std::sort(aToWatchFiles.begin(), aToWatchFiles.end());
+	if (aFilePaths != aToWatchFiles) {
+		throw std::runtime_error("The watched files differ from those of the snapshot");
+	}
+
+	clearToWatchDirs();
+	// The modification times of the directories that were watched or -1
+	std::vector<int64_t> aMTimes(nTotTWDs, -1);
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		SnapshotTWD oST;
+		oRead(&oST, sizeof(SnapshotTWD));
+		if (oST.m_nFree != 0) {
+			m_aToWatchDirs.emplace_back();
+			m_aToWatchDirs.back().m_bFree = true;
+			m_aFreeToWatchDirIdxs.push_back(nTWDIdx);
+			continue; // for ---
+		}
+		oCheckCorrupted(oIsValidNameId(oST.m_nNameId) && (oST.m_nParentTWDIdx >= -1) && (oST.m_nParentTWDIdx < nTotTWDs)
+						&& (oST.m_nIdxOwnerDirectoryZone >= -1) && (oST.m_nIdxOwnerDirectoryZone < oHeader.m_nTotZones)
+						&& (oST.m_nTotPinnedSubDirs >= 0) && (oST.m_nTotPinnedFiles >= 0) && (oST.m_nTotExisting >= 0));
+		checkThrowMaxToWatchDirsReached();
+		m_aToWatchDirs.emplace_back();
+		ToWatchDir& oTWD = m_aToWatchDirs.back();
+		oTWD.m_nNameId = oST.m_nNameId;
+		oTWD.m_nParentTWDIdx = oST.m_nParentTWDIdx;
+		oTWD.m_nIdxOwnerDirectoryZone = oST.m_nIdxOwnerDirectoryZone;
+		oTWD.m_nDepth = oST.m_nDepth;
+		oTWD.m_nMaxDepth = oST.m_nMaxDepth;
+		oTWD.m_bExists = (oST.m_nExists != 0);
+		for (int32_t nCount = 0; nCount < oST.m_nTotPinnedSubDirs; ++nCount) {
+			oTWD.m_aPinnedSubDirs.push_back(oReadString());
+		}
+		for (int32_t nCount = 0; nCount < oST.m_nTotPinnedFiles; ++nCount) {
+			oTWD.m_aPinnedFiles.push_back(oReadString());
+		}
+		for (int32_t nCount = 0; nCount < oST.m_nTotExisting; ++nCount) {
+			SnapshotExisting oSE;
+			oRead(&oSE, sizeof(SnapshotExisting));
+			oCheckCorrupted((oSE.m_nNameId >= 0) && oIsValidNameId(oSE.m_nNameId));
+			oTWD.addExisting(oSE.m_nNameId, (oSE.m_nIsDir != 0));
+			oTWD.m_aExisting.back().m_bRemoved = (oSE.m_nRemoved != 0);
+		}
+		if (oST.m_nWatched != 0) {
+			aMTimes[nTWDIdx] = oST.m_nMTimeNsec;
+		}
+	}
+	// link the subdirectories to their parents
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		const ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		if (oTWD.m_bFree || (oTWD.m_nParentTWDIdx < 0)) {
+			continue; // for ---
+		}
+		ToWatchDir& oParentTWD = m_aToWatchDirs[oTWD.m_nParentTWDIdx];
+		oCheckCorrupted((! oParentTWD.m_bFree) && (oTWD.m_nNameId >= 0));
+		oParentTWD.addSubDirIdx(nTWDIdx, oTWD.m_nNameId);
+	}
+	m_nRootTWDIdx = oHeader.m_nRootTWDIdx;
+	oCheckCorrupted((! m_aToWatchDirs[m_nRootTWDIdx].m_bFree) && (m_aToWatchDirs[m_nRootTWDIdx].m_nParentTWDIdx < 0));
+	// every parent chain must end at the root, otherwise building a path
+	// or updating the subtree counts would loop forever
+	std::vector<uint8_t> aChainState(nTotTWDs, 0); // Index: ToWatchDir index, Value: 0 unknown, 1 being checked, 2 reaches the root
+	aChainState[m_nRootTWDIdx] = 2;
+	std::vector<int32_t> aChain;
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		if (m_aToWatchDirs[nTWDIdx].m_bFree) {
+			continue; // for ---
+		}
+		int32_t nCurIdx = nTWDIdx;
+		while (aChainState[nCurIdx] == 0) {
+			aChainState[nCurIdx] = 1;
+			aChain.push_back(nCurIdx);
+			nCurIdx = m_aToWatchDirs[nCurIdx].m_nParentTWDIdx;
+			// another root
+			oCheckCorrupted(nCurIdx >= 0);
+		}
+		// a cycle
+		oCheckCorrupted(aChainState[nCurIdx] == 2);
+		for (const int32_t nChainIdx : aChain) {
+			aChainState[nChainIdx] = 2;
+		}
+		aChain.clear();
+	}
+
+	for (int32_t nCount = 0; nCount < oHeader.m_nTotResults; ++nCount) {
+		SpilledResult oSR;
+		oRead(&oSR, sizeof(SpilledResult));
+		oCheckCorrupted((oSR.m_nTotActions >= 0) && oIsValidNameId(oSR.m_nNameId)
+						&& (oSR.m_nParentTWDIdx >= -1) && (oSR.m_nParentTWDIdx < nTotTWDs));
+		const int64_t nActionsSize = static_cast<int64_t>(oSR.m_nTotActions) * sizeof(SpilledAction);
+		oCheckAvailable(nActionsSize);
+		const int32_t nResultIdx = allocWatchedResult();
+		WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+		deserializeResult(oSR, p0Data + nPos, oWR);
+		nPos += nActionsSize;
+		for (const ActionData& oActionData : oWR.m_aActions) {
+			oCheckCorrupted(oIsValidNameId(oActionData.m_nOtherPathId));
+		}
+		if (oSR.m_nParentTWDIdx < 0) {
+			m_nRootResultIdx = nResultIdx;
+		} else {
+			ToWatchDir& oParentTWD = m_aToWatchDirs[oSR.m_nParentTWDIdx];
+			oCheckCorrupted((! oParentTWD.m_bFree) && (oSR.m_nNameId >= 0));
+			oWR.m_nRefPos = oParentTWD.addWatchedResultIdx(nResultIdx, oSR.m_nNameId, oWR.m_bIsDir);
+		}
+		updateResultCounts(oSR.m_nParentTWDIdx, oWR.m_eResultType, +1);
+	}
+	oCheckCorrupted(nPos == nDataEnd);
+	if (isResultSpill()) {
+		// the restored results are spilled in the order they were last modified
+		std::vector<std::pair<int64_t, int32_t>> aLastTimes; // Value: (last time, index into m_aWatchedResults)
+		const int32_t nTotResults = static_cast<int32_t>(m_aWatchedResults.size());
+		for (int32_t nResultIdx = 0; nResultIdx < nTotResults; ++nResultIdx) {
+			const WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+			if ((! oWR.isFree()) && (oWR.m_nParentTWDIdx >= 0)) {
+				aLastTimes.emplace_back((oWR.m_aActions.empty() ? 0 : oWR.m_aActions.back().m_nLastTimeUsec), nResultIdx);
+			}
+		}
+		std::sort(aLastTimes.begin(), aLastTimes.end());
+		for (const auto& oLastTime : aLastTimes) {
+			touchActiveResult(oLastTime.second);
+		}
+	}
+	m_bOverflow = ((oHeader.m_nFlags & s_nSnapshotFlagOverflow) != 0);
+	m_bHasInconsistencies = ((oHeader.m_nFlags & s_nSnapshotFlagInconsistencies) != 0);
+	// the time while not watching is skipped
+	m_nStartTimeUsec = Util::getNowTimeMicroseconds() - oHeader.m_nDurationUsec;
+	m_nStopTimeUsec = -1;
+
+	const int64_t nNowUsec = oHeader.m_nDurationUsec;
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		if (aMTimes[nTWDIdx] < 0) {
+			continue; // for ---
+		}
+		ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		if (oTWD.isWatched() || ! oTWD.m_bExists) {
+			// already handled by the rescan of the parent
+			continue; // for ---
+		}
+		const auto oFStat = Util::FileStat::create(getToWatchDirPath(nTWDIdx));
+		if (! oFStat.isDir()) {
+			// the delete result is added by the rescan of the parent
+			oTWD.m_bExists = false;
+			oTWD.clearExisting();
+			continue; // for ---
+		}
+		createINotifyWatch(nTWDIdx, oTWD);
+		if (oTWD.isWatched() && (oFStat.getModificationTimeNsec() != aMTimes[nTWDIdx])) {
+			resyncDirectory(nTWDIdx, nNowUsec);
+		}
+	}
+}
+void FofiModel::resyncDirectory(int32_t nTWDIdx, int64_t nNowUsec)
+{
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	const std::string sPath = getToWatchDirPath(nTWDIdx);
+	std::unordered_set<int64_t> oPresentKeys;
+	try {
+		Glib::Dir oDir(sPath);
+		for (const auto& sChildName : oDir) {
+			const auto oChildFStat = Util::FileStat::create(Util::getPathFromDirAndName(sPath, sChildName));
+			if (! oChildFStat.exists()) {
+				continue; //----
+			}
+			oPresentKeys.insert(ToWatchDir::getNameKey(m_oStringPool.intern(sChildName), oChildFStat.isDir()));
+		}
+	} catch (const Glib::FileError& oErr) {
+		return; //--------------------------------------------------------------
+	}
+	const auto oRemoveSubDir = [&](int32_t nNameId)
+	{
+		const int32_t nSubTWDIdx = oTWD.findSubDirIdx(nNameId);
+		if (nSubTWDIdx < 0) {
+			return; //----------------------------------------------------------
+		}
+		detachToWatchDir(nSubTWDIdx);
+	};
+	// The names that are still there are left alone
+	std::unordered_set<int64_t> oUnchangedKeys;
+	std::vector<ToWatchDir::FileDir> aDeleted;
+	for (const ToWatchDir::FileDir& oFD : oTWD.m_aExisting) {
+		if (oFD.m_bRemoved) {
+			continue; // for ---
+		}
+		const int64_t nKey = ToWatchDir::getNameKey(oFD.m_nNameId, oFD.m_bIsDir);
+		if (oPresentKeys.count(nKey) > 0) {
+			oUnchangedKeys.insert(nKey);
+		} else {
+			aDeleted.push_back(oFD);
+		}
+	}
+	for (const ToWatchDir::FileDir& oFD : aDeleted) {
+		const int32_t nResultIdx = addWatchedResult(nTWDIdx, m_oStringPool.get(oFD.m_nNameId), oFD.m_bIsDir);
+		WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
+		setResultType(oWatchedResult, RESULT_DELETED);
+		addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_DELETE, nNowUsec);
+		if (oFD.m_bIsDir) {
+			oRemoveSubDir(oFD.m_nNameId);
+		}
+		emitWatchedResultAction(oWatchedResult);
+	}
+	for (const int32_t nResultIdx : oTWD.m_aWatchedResultIdxs) {
+		// resume() loads all the results
+		assert(! isSpilledRef(nResultIdx));
+		WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
+		if (oTWD.findWatchedResultIdx(oWatchedResult.m_nNameId, oWatchedResult.m_bIsDir) != nResultIdx) {
+			// shadowed
+			continue; // for ---
+		}
+		const int64_t nKey = ToWatchDir::getNameKey(oWatchedResult.m_nNameId, oWatchedResult.m_bIsDir);
+		if (! oWatchedResult.exists()) {
+			// if it reappeared it is created below
+			continue; // for ---
+		}
+		if (oPresentKeys.count(nKey) > 0) {
+			oUnchangedKeys.insert(nKey);
+			continue; // for ---
+		}
+		addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_DELETE, nNowUsec);
+		setResultType(oWatchedResult, (oWatchedResult.existedAtStart() ? RESULT_DELETED : RESULT_TEMPORARY));
+		if (oWatchedResult.m_eResultType == RESULT_TEMPORARY) {
+			addRecycleCandidate(nTWDIdx);
+		}
+		if (oWatchedResult.m_bIsDir) {
+			oRemoveSubDir(oWatchedResult.m_nNameId);
+		}
+		emitWatchedResultAction(oWatchedResult);
+	}
+	// the names that appeared
+	createImmediateChildren(nTWDIdx, false, nNowUsec, oUnchangedKeys);
+}
+bool FofiModel::isMatchedByFilters(const std::vector<Filter>& aFilters
+									, const std::string& sName, const std::string& sPathName) const
+{
+	for (const auto& oIF : aFilters) {
+		const std::string& sStr = (oIF.bApplyToPathName ? sPathName : sName);
+		if (oIF.m_eFilterType == FILTER_EXACT) {
+			if (sStr == oIF.m_sFilter) {
+				return true; //-------------------------------------------------
+			}
+		} else {
+			if (std::regex_match(sStr, oIF.m_oFilterRegex)) {
+				return true; //-------------------------------------------------
+			}
+		}
+	}
+	return false;
+}
+int32_t FofiModel::addExistingToWatchDir(int32_t nParentTWDIdx, const std::string& sName, const std::string& sPath)
+{
+	assert(nParentTWDIdx >= 0);
+	assert(! sName.empty());
+	checkThrowMaxToWatchDirsReached(); //-------------------------------
+	const int32_t nTWDIdx = allocToWatchDir();
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	oTWD.m_nNameId = m_oStringPool.intern(sName);
+	oTWD.m_nParentTWDIdx = nParentTWDIdx;
+	oTWD.m_bExists = true;
+	setDirectoryZone(oTWD, sPath);
+	m_aToWatchDirs[nParentTWDIdx].addSubDirIdx(nTWDIdx, oTWD.m_nNameId);
+	return nTWDIdx;
+}
+void FofiModel::createINotifyWatch(int32_t nTWDIdx, ToWatchDir& oTWD)
+{
+	const auto oPair = m_refSource->addPath(getToWatchDirPath(nTWDIdx), nTWDIdx);
+	int32_t nErrno = oPair.first;
+	if (nErrno == 0) {
+		oTWD.m_nWatchedIdx = oPair.second;
+		m_oTraceRing.trace(TraceRing::TRACE_EVENT_WATCH_ADDED, nTWDIdx, oTWD.m_nNameId, oTWD.m_nWatchedIdx);
+		return; //--------------------------------------------------------------
+	}
+	assert(nErrno != INotifierSource::EXTENDED_ERRNO_FAKE_FS);
+	assert(nErrno != INotifierSource::EXTENDED_ERRNO_WATCH_NOT_FOUND);
+	++m_oFailedWatches[nErrno];
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_WATCH_FAILED, nTWDIdx, oTWD.m_nNameId, nErrno);
+	checkThrowMaxInotifyUserWatches(nErrno); //---------------------------------
+	// probably permission denied
+	oTWD.m_nWatchedIdx = -1;
+}
+int32_t FofiModel::removeINotifyWatch(int32_t nTWDIdx, ToWatchDir& oTWD)
+{
+	assert(oTWD.isWatched());
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_WATCH_REMOVED, nTWDIdx, oTWD.m_nNameId, oTWD.m_nWatchedIdx);
+	const int32_t nErrno = m_refSource->removePath(oTWD.m_nWatchedIdx, nTWDIdx);
+	oTWD.m_nWatchedIdx = -1;
+	return nErrno;
+}
+void FofiModel::emitAbort(const std::string& sError)
+{
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_ABORT, -1, -1);
+	m_oAbortSignal.emit(sError);
+}
+void FofiModel::detachToWatchDir(int32_t nTWDIdx)
+{
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	if (oTWD.isWatched()) {
+		removeINotifyWatch(nTWDIdx, oTWD);
+	}
+	oTWD.m_bExists = false;
+	oTWD.clearExisting();
+	addRecycleCandidate(nTWDIdx);
+}
+void FofiModel::attachToWatchDir(int32_t nTWDIdx)
+{
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	assert(! oTWD.isWatched());
+	const auto oFStat = Util::FileStat::create(getToWatchDirPath(nTWDIdx));
+	oTWD.m_bExists = oFStat.exists() && oFStat.isDir();
+	if (! oTWD.m_bExists) {
+		return; //--------------------------------------------------------------
+	}
+	createINotifyWatch(nTWDIdx, oTWD);
+	if (! oTWD.isWatched()) {
+		return; //--------------------------------------------------------------
+	}
+	oTWD.clearExisting();
+	addExistingContent(nTWDIdx);
+}
+bool FofiModel::isNeededPath(const std::string& sPath) const
+{
+	if (m_oDirectoryZoneTrie.hasPathOrDescendants(sPath)) {
+		return true; //---------------------------------------------------------
+	}
+	const std::string sPrefix = ((sPath == "/") ? sPath : sPath + "/");
+	return std::any_of(m_aToWatchFiles.begin(), m_aToWatchFiles.end(), [&](const std::string& sFilePath)
+	{
+		return (sFilePath.compare(0, sPrefix.size(), sPrefix) == 0);
+	});
+}
+bool FofiModel::isStructural(int32_t nTWDIdx) const
+{
+	const ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	if ((oTWD.m_nParentTWDIdx < 0) || ! oTWD.m_aPinnedFiles.empty()) {
+		return true; //---------------------------------------------------------
+	}
+	if (findDirectoryZone(getToWatchDirPath(nTWDIdx)) >= 0) {
+		return true; //---------------------------------------------------------
+	}
+	const auto& aPinnedSubDirs = m_aToWatchDirs[oTWD.m_nParentTWDIdx].m_aPinnedSubDirs;
+	return (std::find(aPinnedSubDirs.begin(), aPinnedSubDirs.end(), m_oStringPool.get(oTWD.m_nNameId)) != aPinnedSubDirs.end());
+}
+bool FofiModel::isWantedByParent(int32_t nTWDIdx) const
+{
+	if (isStructural(nTWDIdx)) {
+		return true; //---------------------------------------------------------
+	}
+	const ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	const ToWatchDir& oParentTWD = m_aToWatchDirs[oTWD.m_nParentTWDIdx];
+	if ((! oParentTWD.isWatched()) || oParentTWD.isLeaf()) {
+		return false; //--------------------------------------------------------
+	}
+	return ! isFilteredOutSubDir(oParentTWD, m_oStringPool.get(oTWD.m_nNameId), getToWatchDirPath(nTWDIdx));
+}
+void FofiModel::pinToWatchDirAncestors(int32_t nTWDIdx)
+{
+	int32_t nCurIdx = nTWDIdx;
+	while (nCurIdx >= 0) {
+		ToWatchDir& oCurTWD = m_aToWatchDirs[nCurIdx];
+		if (! oCurTWD.isWatched()) {
+			attachToWatchDir(nCurIdx);
+		}
+		const int32_t nParentIdx = oCurTWD.m_nParentTWDIdx;
+		if (nParentIdx >= 0) {
+			Util::addValueToVectorUniquely(m_aToWatchDirs[nParentIdx].m_aPinnedSubDirs, std::string{m_oStringPool.get(oCurTWD.m_nNameId)});
+		}
+		nCurIdx = nParentIdx;
+	}
+}
+int32_t FofiModel::unpinToWatchDirAncestors(int32_t nTWDIdx)
+{
+	int32_t nTopTWDIdx = nTWDIdx;
+	int32_t nCurIdx = nTWDIdx;
+	while (true) {
+		const ToWatchDir& oCurTWD = m_aToWatchDirs[nCurIdx];
+		const int32_t nParentIdx = oCurTWD.m_nParentTWDIdx;
+		if (nParentIdx < 0) {
+			break; // while ---
+		}
+		// if needed by another zone or file so are the ancestors
+		if (isNeededPath(getToWatchDirPath(nCurIdx))) {
+			break; // while ---
+		}
+		Util::removeValueFromVector(m_aToWatchDirs[nParentIdx].m_aPinnedSubDirs, std::string{m_oStringPool.get(oCurTWD.m_nNameId)});
+		nTopTWDIdx = nCurIdx;
+		nCurIdx = nParentIdx;
+	}
+	return nTopTWDIdx;
+}
+void FofiModel::reconcileChain(int32_t nTopTWDIdx, int32_t nTWDIdx, bool bAlwaysLast)
+{
+	std::vector<int32_t> aChain;
+	int32_t nCurIdx = nTWDIdx;
+	while (true) {
+		aChain.push_back(nCurIdx);
+		if (nCurIdx == nTopTWDIdx) {
+			break; // while ---
+		}
+		nCurIdx = m_aToWatchDirs[nCurIdx].m_nParentTWDIdx;
+		assert(nCurIdx >= 0);
+	}
+	// top down, the subtree of the first that changed contains the rest of the chain
+	for (auto itChain = aChain.rbegin(); itChain != aChain.rend(); ++itChain) {
+		nCurIdx = *itChain;
+		const ToWatchDir& oCurTWD = m_aToWatchDirs[nCurIdx];
+		const bool bWanted = isWantedByParent(nCurIdx);
+		const bool bChanged = (bWanted ? ! oCurTWD.isWatched() : (oCurTWD.isWatched() || oCurTWD.m_bExists));
+		if (bChanged || (bAlwaysLast && (nCurIdx == nTWDIdx))) {
+			reconcileToWatchDir(nCurIdx, bWanted);
+			return; //----------------------------------------------------------
+		}
+	}
+}
+void FofiModel::reconcileToWatchDir(int32_t nTWDIdx, bool bWanted)
+{
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	const std::string sPath = getToWatchDirPath(nTWDIdx);
+	// a zone was added or removed
+	const int32_t nOldOwnerDZIdx = oTWD.m_nIdxOwnerDirectoryZone;
+	oTWD.m_nIdxOwnerDirectoryZone = -1;
+	oTWD.m_nDepth = 0;
+	oTWD.m_nMaxDepth = 0;
+	setDirectoryZone(oTWD, sPath);
+	if (! bWanted) {
+		if (oTWD.isWatched() || oTWD.m_bExists) {
+			detachToWatchDir(nTWDIdx);
+		}
+	} else if (! oTWD.isWatched()) {
+		attachToWatchDir(nTWDIdx);
+	} else if (oTWD.m_nIdxOwnerDirectoryZone != nOldOwnerDZIdx) {
+		// the names that were filtered out by the old zone weren't tracked
+		oTWD.clearExisting();
+		addExistingContent(nTWDIdx);
+	}
+	// copied because the subdirs created below are already complete
+	const std::deque<int32_t> aSubDirIdxs = oTWD.m_aToWatchSubdirIdxs;
+	if (oTWD.isWatched() && ! oTWD.isLeaf()) {
+		// the subdirs that are now within the zone
+		std::vector<ScanCache::Entry> aEntries;
+		try {
+			scanDirectory(sPath, aEntries);
+		} catch (const Glib::FileError& oErr) {
+			aEntries.clear();
+		}
+		for (const ScanCache::Entry& oEntry : aEntries) {
+			if (! oEntry.m_bIsDir) {
+				continue; // for ---
+			}
+			const std::string& sChildName = oEntry.m_sName;
+			if (oTWD.findSubDirIdx(m_oStringPool.find(sChildName)) >= 0) {
+				continue; // for ---
+			}
+			const std::string sChildPath = Util::getPathFromDirAndName(sPath, sChildName);
+			if (isFilteredOutSubDir(oTWD, sChildName, sChildPath)) {
+				continue; // for ---
+			}
+			const int32_t nSubTWDIdx = addExistingToWatchDir(nTWDIdx, sChildName, sChildPath);
+			ToWatchDir& oSubTWD = m_aToWatchDirs[nSubTWDIdx];
+			createINotifyWatch(nSubTWDIdx, oSubTWD);
+			if (oSubTWD.isWatched()) {
+				addExistingContent(nSubTWDIdx);
+				initialCreateToWatchDir(nSubTWDIdx);
+			}
+		}
+	}
+	for (const int32_t nSubTWDIdx : aSubDirIdxs) {
+		const ToWatchDir& oSubTWD = m_aToWatchDirs[nSubTWDIdx];
+		if (oSubTWD.m_bFree || (oSubTWD.m_nParentTWDIdx != nTWDIdx)) {
+			continue; // for ---
+		}
+		// the owner of this directory is already up to date
+		reconcileToWatchDir(nSubTWDIdx, isWantedByParent(nSubTWDIdx));
+	}
+}
+int32_t FofiModel::allocToWatchDir()
+{
+	if (m_aFreeToWatchDirIdxs.empty()) {
+		const int32_t nTWDIdx = static_cast<int32_t>(m_aToWatchDirs.size());
+		m_aToWatchDirs.emplace_back();
+		return nTWDIdx; //------------------------------------------------------
+	}
+	const int32_t nTWDIdx = m_aFreeToWatchDirIdxs.back();
+	m_aFreeToWatchDirIdxs.pop_back();
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	assert(oTWD.m_bFree);
+	oTWD.m_bFree = false;
+	return nTWDIdx;
+}
+int32_t FofiModel::allocWatchedResult()
+{
+	if (m_aFreeWatchedResultIdxs.empty()) {
+		const int32_t nResultIdx = static_cast<int32_t>(m_aWatchedResults.size());
+		m_aWatchedResults.emplace_back();
+		return nResultIdx; //---------------------------------------------------
+	}
+	const int32_t nResultIdx = m_aFreeWatchedResultIdxs.back();
+	m_aFreeWatchedResultIdxs.pop_back();
+	WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+	assert(oWR.m_bFree);
+	oWR.m_bFree = false;
+	return nResultIdx;
+}
+void FofiModel::addRecycleCandidate(int32_t nTWDIdx)
+{
+	if (! m_bRecycleTemporary) {
+		return; //--------------------------------------------------------------
+	}
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	if (oTWD.m_bRecycleCandidate) {
+		return; //--------------------------------------------------------------
+	}
+	oTWD.m_bRecycleCandidate = true;
+	m_aRecycleCandidates.push_back({nTWDIdx, oTWD.m_nGeneration});
+}
+void FofiModel::recycleCandidates()
+{
+	if (m_aRecycleCandidates.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	assert(m_aOpenMoves.empty());
+	// In the order they were added, which is bottom-up for the directories
+	// of a deleted or moved away subtree
+	for (const RecycleCandidate& oCandidate : m_aRecycleCandidates) {
+		int32_t nTWDIdx = oCandidate.m_nTWDIdx;
+		ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		if (oTWD.m_nGeneration != oCandidate.m_nGeneration) {
+			// already recycled
+			continue; // for ---
+		}
+		oTWD.m_bRecycleCandidate = false;
+		recycleTemporaryResults(nTWDIdx);
+		// recycling a directory might make its parent recyclable
+		while ((nTWDIdx >= 0) && isRecyclable(m_aToWatchDirs[nTWDIdx])) {
+			const int32_t nParentTWDIdx = m_aToWatchDirs[nTWDIdx].m_nParentTWDIdx;
+			recycleToWatchDir(nTWDIdx);
+			nTWDIdx = nParentTWDIdx;
+		}
+	}
+	m_aRecycleCandidates.clear();
+	// remove the recycled subdirs in one pass per parent
+	for (const int32_t nTWDIdx : m_aCompactTWDIdxs) {
+		ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+		if (! oTWD.m_bSubDirsToCompact) {
+			// was itself recycled
+			continue; // for ---
+		}
+		oTWD.m_bSubDirsToCompact = false;
+		auto& aSubdirIdxs = oTWD.m_aToWatchSubdirIdxs;
+		// no slot is reused while recycling, so a free subdir is a removed subdir
+		aSubdirIdxs.erase(std::remove_if(aSubdirIdxs.begin(), aSubdirIdxs.end(), [&](int32_t nSubDirTWDIdx)
+		{
+			return m_aToWatchDirs[nSubDirTWDIdx].m_bFree;
+		}), aSubdirIdxs.end());
+	}
+	m_aCompactTWDIdxs.clear();
+}
+void FofiModel::releaseUnusedNames()
+{
+	const int32_t nTotIds = m_oStringPool.size();
+	std::vector<bool> aUsed(nTotIds, false); // Index: name id
+	const auto oMark = [&](int32_t nNameId)
+	{
+		if (nNameId >= 0) {
+			aUsed[nNameId] = true;
+		}
+	};
+	const auto oMarkResult = [&](const WatchedResult& oWR)
+	{
+		oMark(oWR.m_nNameId);
+		for (const ActionData& oActionData : oWR.m_aActions) {
+			oMark(oActionData.m_nOtherPathId);
+		}
+	};
+	for (const ToWatchDir& oTWD : m_aToWatchDirs) {
+		if (oTWD.m_bFree) {
+			continue; // for ---
+		}
+		oMark(oTWD.m_nNameId);
+		for (const ToWatchDir::FileDir& oFileDir : oTWD.m_aExisting) {
+			oMark(oFileDir.m_nNameId);
+		}
+		// the keys of spilled and shadowed results
+		for (const auto& oPair : oTWD.m_oWatchedResultIdxByKey) {
+			oMark(static_cast<int32_t>(oPair.first / 2));
+		}
+		for (const auto& oPair : oTWD.m_oSubDirIdxByName) {
+			oMark(oPair.first);
+		}
+	}
+	for (const WatchedResult& oWR : m_aWatchedResults) {
+		if (! oWR.m_bFree) {
+			oMarkResult(oWR);
+		}
+	}
+	const int32_t nTotSlots = static_cast<int32_t>(m_aSpilledSlots.size());
+	WatchedResult oSpilledWR;
+	for (int32_t nSpilledId = 0; nSpilledId < nTotSlots; ++nSpilledId) {
+		if (m_aSpilledSlots[nSpilledId].m_nOffset < 0) {
+			continue; // for ---
+		}
+		if (! readSpilledResult(nSpilledId, oSpilledWR)) {
+			// the names of the result are unknown, keep them all
+			return; //----------------------------------------------------------
+		}
+		oMarkResult(oSpilledWR);
+	}
+	// the keys of recycled results are skipped by forEachChangedResult() anyway
+	// and might otherwise find a result with a reused name
+	m_aChangedResultKeys.erase(std::remove_if(m_aChangedResultKeys.begin(), m_aChangedResultKeys.end()
+											, [&](const std::pair<int32_t, int64_t>& oKey)
+	{
+		if (oKey.first < 0) {
+			return false; //----------------------------------------------------
+		}
+		const ToWatchDir& oTWD = m_aToWatchDirs[oKey.first];
+		return oTWD.m_bFree || (oTWD.m_oWatchedResultIdxByKey.count(oKey.second) == 0);
+	}), m_aChangedResultKeys.end());
+	for (const auto& oPair : m_aChangedResultKeys) {
+		oMark(static_cast<int32_t>(oPair.second / 2));
+	}
+	if (m_oTraceRing.isEnabled()) {
+		for (const TraceRing::Record& oRecord : m_oTraceRing.getRecords()) {
+			oMark(oRecord.m_nNameId);
+		}
+	}
+	for (int32_t nNameId = 0; nNameId < nTotIds; ++nNameId) {
+		if ((! aUsed[nNameId]) && ! m_oStringPool.isReleased(nNameId)) {
+			m_oStringPool.release(nNameId);
+		}
 	}
+	m_nNamesAfterRelease = m_oStringPool.size() - m_oStringPool.getTotReleased();
 }
-std::string FofiModel::calcToWatchDirectories()
+void FofiModel::recycleTemporaryResults(int32_t nTWDIdx)
 {
-	assert(m_nEventCounter == 0); // Can't call this while running
-	return internalCalcToWatchDirectories();
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	auto& aResultIdxs = oTWD.m_aWatchedResultIdxs;
+	const int32_t nTotResults = static_cast<int32_t>(aResultIdxs.size());
+	int32_t nKept = 0;
+	for (int32_t nIdx = 0; nIdx < nTotResults; ++nIdx) {
+		const int32_t nResultIdx = aResultIdxs[nIdx];
+		if (isSpilledRef(nResultIdx)) {
+			m_aSpilledSlots[getSpilledId(nResultIdx)].m_nRefPos = nKept;
+			aResultIdxs[nKept] = nResultIdx;
+			++nKept;
+			continue; // for ---
+		}
+		if (m_aWatchedResults[nResultIdx].m_eResultType != RESULT_TEMPORARY) {
+			m_aWatchedResults[nResultIdx].m_nRefPos = nKept;
+			aResultIdxs[nKept] = nResultIdx;
+			++nKept;
+			continue; // for ---
+		}
+		WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+		const auto itFind = oTWD.m_oWatchedResultIdxByKey.find(ToWatchDir::getNameKey(oWR.m_nNameId, oWR.m_bIsDir));
+		if ((itFind != oTWD.m_oWatchedResultIdxByKey.end()) && (itFind->second == nResultIdx)) {
+			oTWD.m_oWatchedResultIdxByKey.erase(itFind);
+		}
+		updateResultCounts(nTWDIdx, RESULT_TEMPORARY, -1);
+		unlinkActiveResult(nResultIdx);
+		oWR = WatchedResult{};
+		oWR.m_bFree = true;
+		m_aFreeWatchedResultIdxs.push_back(nResultIdx);
+	}
+	aResultIdxs.resize(nKept);
 }
-std::string FofiModel::internalCalcToWatchDirectories()
+bool FofiModel::isRecyclable(const ToWatchDir& oTWD) const
 {
-	m_bInitialSetup = true;
-	try {
-		initialSetup();
-	} catch (const std::runtime_error& oErr) {
-		m_bInitialSetup = false;
-		return oErr.what(); //--------------------------------------------------
+	if (oTWD.m_bFree || oTWD.m_bExists || oTWD.isWatched()) {
+		return false; //--------------------------------------------------------
 	}
-
-	m_bInitialSetup = false;
-	return "";
+	// The directory zone base paths, the gap fillers and the directories
+	// with pinned files or subdirs are structural
+	if ((oTWD.m_nParentTWDIdx < 0) || (oTWD.m_nIdxOwnerDirectoryZone < 0) || (oTWD.m_nDepth == 0)) {
+		return false; //--------------------------------------------------------
+	}
+	if ((! oTWD.m_aPinnedFiles.empty()) || ! oTWD.m_aPinnedSubDirs.empty()) {
+		return false; //--------------------------------------------------------
+	}
+	if ((! oTWD.m_aWatchedResultIdxs.empty()) || ! oTWD.m_oSubDirIdxByName.empty()) {
+		return false; //--------------------------------------------------------
+	}
+	return std::all_of(oTWD.m_aExisting.begin(), oTWD.m_aExisting.end(), [](const ToWatchDir::FileDir& oFiDi)
+	{
+		return oFiDi.m_bRemoved;
+	});
 }
-const std::deque<FofiModel::ToWatchDir>& FofiModel::getToWatchDirectories() const
+void FofiModel::recycleToWatchDir(int32_t nTWDIdx)
 {
-	return m_aToWatchDirs;
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	assert(! oTWD.isWatched());
+	ToWatchDir& oParentTWD = m_aToWatchDirs[oTWD.m_nParentTWDIdx];
+	#ifndef NDEBUG
+	const auto nErased =
+	#endif //NDEBUG
+	oParentTWD.m_oSubDirIdxByName.erase(oTWD.m_nNameId);
+	assert(nErased == 1);
+	if (! oParentTWD.m_bSubDirsToCompact) {
+		oParentTWD.m_bSubDirsToCompact = true;
+		m_aCompactTWDIdxs.push_back(oTWD.m_nParentTWDIdx);
+	}
+	PathCacheEntry& oEntry = m_aPathCache[nTWDIdx % s_nPathCacheSize];
+	if (oEntry.m_nTWDIdx == nTWDIdx) {
+		oEntry.m_nTWDIdx = -1;
+		oEntry.m_sPath.clear();
+	}
+	const int32_t nGeneration = oTWD.m_nGeneration;
+	oTWD = ToWatchDir{};
+	oTWD.m_bFree = true;
+	oTWD.m_nGeneration = nGeneration + 1;
+	m_aFreeToWatchDirIdxs.push_back(nTWDIdx);
 }
-int32_t FofiModel::getRootToWatchDirectoriesIdx() const
+void FofiModel::setResultSpill(const std::string& sSpillDir, int64_t nSpillAfterUsec)
 {
-	return m_nRootTWDIdx;
+	assert(m_nEventCounter == 0); // can't change while watching
+	assert(nSpillAfterUsec > 0);
+	m_sSpillDir = sSpillDir;
+	m_nSpillAfterUsec = nSpillAfterUsec;
 }
-std::string FofiModel::start()
+void FofiModel::setScanCache(const std::string& sPathName)
 {
-	assert(m_nEventCounter == 0);
-	m_nEventCounter = 1; // marks start watching
-	// create ToWatchDir and add to INotifierSource
-	const std::string sError = internalCalcToWatchDirectories();
-	if (! sError.empty()) {
-		m_nEventCounter = 0;
-		return sError; //-------------------------------------------------------
-	}
-
-	m_nStartTimeUsec = Util::getNowTimeMicroseconds();
-	m_nStopTimeUsec = -1;
-	//
-	m_nRootResultIdx = -1;
-	m_aWatchedResults.clear();
-	m_bOverflow = false;
-	m_bHasInconsistencies = false;
-	//
-	assert(m_aOpenMoves.empty());
-	return "";
+	assert(m_nEventCounter == 0); // can't change while watching
+	m_sScanCachePath = sPathName;
 }
-void FofiModel::stop()
+void FofiModel::setActionCompaction(bool bCollapseRuns, int32_t nMaxActions)
 {
-	assert(m_nEventCounter > 0);
-	m_nStopTimeUsec = Util::getNowTimeMicroseconds();
-	m_aOpenMoves.clear();
-	m_nEventCounter = 0; // stop watching
-	m_refSource->clearAll();
+	assert(m_nEventCounter == 0); // can't change while watching
+	assert(nMaxActions >= 0);
+	m_bCollapseActions = bCollapseRuns;
+	m_nMaxActions = nMaxActions;
 }
-int64_t FofiModel::getDuration() const
+void FofiModel::touchActiveResult(int32_t nResultIdx)
 {
-	if (m_nStartTimeUsec < 0) {
-		return 0;
-	} else if (m_nStopTimeUsec >= m_nStartTimeUsec) {
-		return m_nStopTimeUsec - m_nStartTimeUsec;
+	WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+	if (nResultIdx == m_nNewestActiveIdx) {
+		return; //--------------------------------------------------------------
+	}
+	unlinkActiveResult(nResultIdx);
+	oWR.m_nOlderActiveIdx = m_nNewestActiveIdx;
+	if (m_nNewestActiveIdx >= 0) {
+		m_aWatchedResults[m_nNewestActiveIdx].m_nNewerActiveIdx = nResultIdx;
 	} else {
-		return Util::getNowTimeMicroseconds() - m_nStartTimeUsec;
+		m_nOldestActiveIdx = nResultIdx;
 	}
+	m_nNewestActiveIdx = nResultIdx;
+	oWR.m_bActive = true;
 }
-bool FofiModel::isMatchedByFilters(const std::vector<Filter>& aFilters
-									, const std::string& sName, const std::string& sPathName) const
+void FofiModel::unlinkActiveResult(int32_t nResultIdx)
 {
-	for (const auto& oIF : aFilters) {
-//std::cout << "FofiModel::isMatchedByFilters sPathName=" << sPathName << "  oIF.m_sFilter=" << oIF.m_sFilter << '\n';
-		const std::string& sStr = (oIF.bApplyToPathName ? sPathName : sName);
-		if (oIF.m_eFilterType == FILTER_EXACT) {
-			if (sStr == oIF.m_sFilter) {
-				return true; //-------------------------------------------------
-			}
-		} else {
-			const bool bMatch = std::regex_match(sStr, oIF.m_oFilterRegex);
-			if (! bMatch) {
-				return true; //-------------------------------------------------
-			}
+	WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+	if (! oWR.m_bActive) {
+		return; //--------------------------------------------------------------
+	}
+	if (oWR.m_nOlderActiveIdx >= 0) {
+		m_aWatchedResults[oWR.m_nOlderActiveIdx].m_nNewerActiveIdx = oWR.m_nNewerActiveIdx;
+	} else {
+		m_nOldestActiveIdx = oWR.m_nNewerActiveIdx;
+	}
+	if (oWR.m_nNewerActiveIdx >= 0) {
+		m_aWatchedResults[oWR.m_nNewerActiveIdx].m_nOlderActiveIdx = oWR.m_nOlderActiveIdx;
+	} else {
+		m_nNewestActiveIdx = oWR.m_nOlderActiveIdx;
+	}
+	oWR.m_nOlderActiveIdx = -1;
+	oWR.m_nNewerActiveIdx = -1;
+	oWR.m_bActive = false;
+}
+void FofiModel::spillInactiveResults(int64_t nNowUsec)
+{
+	// Only the results that expired are visited
+	while (m_nOldestActiveIdx >= 0) {
+		const int32_t nResultIdx = m_nOldestActiveIdx;
+		const WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+		const int64_t nLastTimeUsec = (oWR.m_aActions.empty() ? 0 : oWR.m_aActions.back().m_nLastTimeUsec);
+		if (nLastTimeUsec + m_nSpillAfterUsec > nNowUsec) {
+			// the following results were modified later
+			return; //----------------------------------------------------------
+		}
+		ToWatchDir& oTWD = m_aToWatchDirs[oWR.m_nParentTWDIdx];
+		const auto itFind = oTWD.m_oWatchedResultIdxByKey.find(ToWatchDir::getNameKey(oWR.m_nNameId, oWR.m_bIsDir));
+		if ((itFind == oTWD.m_oWatchedResultIdxByKey.end()) || (itFind->second != nResultIdx)) {
+			// shadowed by a result with the same name, can't be found anyway
+			unlinkActiveResult(nResultIdx);
+			continue; // while ---
+		}
+		const int32_t nRefPos = oWR.m_nRefPos;
+		const int32_t nSpilledRef = spillResult(nResultIdx);
+		if (nSpilledRef == -1) {
+			// probably disk full, retry at next check
+			return; //----------------------------------------------------------
 		}
+		itFind->second = nSpilledRef;
+		oTWD.m_aWatchedResultIdxs[nRefPos] = nSpilledRef;
 	}
-	return false;
 }
-int32_t FofiModel::addExistingToWatchDir(const std::string& sPath)
+int32_t FofiModel::spillResult(int32_t nResultIdx)
 {
-	checkThrowMaxToWatchDirsReached(); //-------------------------------
-	const int32_t nTotWatchedDirs = static_cast<int32_t>(m_aToWatchDirs.size());
-	const int32_t nTWDIdx = nTotWatchedDirs;
-	m_aToWatchDirs.emplace_back();
-	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-	oTWD.m_sPathName = sPath;
-	const auto nFoundSlashPos = sPath.find_last_of('/');
-	assert(nFoundSlashPos != std::string::npos);
-	oTWD.m_nNamePos = static_cast<int32_t>(nFoundSlashPos) + 1;
-	oTWD.m_bExists = true;
-	setDirectoryZone(oTWD);
-	return nTWDIdx;
+	WatchedResult& oWR = m_aWatchedResults[nResultIdx];
+	assert(! oWR.m_bFree);
+	assert(oWR.m_nParentTWDIdx >= 0);
+	serializeResult(oWR, m_aSpillBuffer);
+	const int32_t nSize = static_cast<int32_t>(m_aSpillBuffer.size());
+	const int64_t nOffset = m_oSpillSegment.append(m_aSpillBuffer.data(), nSize);
+	if (nOffset < 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	int32_t nSpilledId;
+	if (m_aFreeSpilledIds.empty()) {
+		nSpilledId = static_cast<int32_t>(m_aSpilledSlots.size());
+		m_aSpilledSlots.emplace_back();
+	} else {
+		nSpilledId = m_aFreeSpilledIds.back();
+		m_aFreeSpilledIds.pop_back();
+	}
+	SpilledSlot& oSlot = m_aSpilledSlots[nSpilledId];
+	oSlot.m_nOffset = nOffset;
+	oSlot.m_nSize = nSize;
+	oSlot.m_nRefPos = oWR.m_nRefPos;
+	++m_nTotSpilledResults;
+	unlinkActiveResult(nResultIdx);
+	// also releases the actions
+	oWR = WatchedResult{};
+	oWR.m_bFree = true;
+	m_aFreeWatchedResultIdxs.push_back(nResultIdx);
+	return getSpilledRef(nSpilledId);
 }
-void FofiModel::createINotifyWatch(int32_t nTWDIdx, ToWatchDir& oTWD)
+void FofiModel::compactSpillSegment()
 {
-	const auto oPair = m_refSource->addPath(oTWD.m_sPathName, nTWDIdx);
-	int32_t nErrno = oPair.first;
-	if (nErrno == 0) {
-		oTWD.m_nWatchedIdx = oPair.second;
+	if ((m_nSpillDeadBytes < s_nMinSpillDeadBytesToCompact) || (m_nSpillDeadBytes * 2 <= m_oSpillSegment.size())) {
 		return; //--------------------------------------------------------------
 	}
-	assert(nErrno != INotifierSource::EXTENDED_ERRNO_FAKE_FS);
-	assert(nErrno != INotifierSource::EXTENDED_ERRNO_WATCH_NOT_FOUND);
-	checkThrowMaxInotifyUserWatches(nErrno); //---------------------------------
-	// probably permission denied
-	oTWD.m_nWatchedIdx = -1;
+	SpillSegment oNewSegment;
+	if (! oNewSegment.open(m_sSpillDir).empty()) {
+		// retry at next check
+		return; //--------------------------------------------------------------
+	}
+	const int32_t nTotSlots = static_cast<int32_t>(m_aSpilledSlots.size());
+	std::vector<int64_t> aNewOffsets(nTotSlots, -1); // Index: spilled id
+	for (int32_t nSpilledId = 0; nSpilledId < nTotSlots; ++nSpilledId) {
+		const SpilledSlot& oSlot = m_aSpilledSlots[nSpilledId];
+		if (oSlot.m_nOffset < 0) {
+			continue; // for ---
+		}
+		m_aSpillBuffer.resize(oSlot.m_nSize);
+		if (! m_oSpillSegment.read(oSlot.m_nOffset, m_aSpillBuffer.data(), oSlot.m_nSize)) {
+			// the result is reported as unreadable when needed
+			return; //----------------------------------------------------------
+		}
+		aNewOffsets[nSpilledId] = oNewSegment.append(m_aSpillBuffer.data(), oSlot.m_nSize);
+		if (aNewOffsets[nSpilledId] < 0) {
+			// probably disk full, the new file is deleted, retry at next check
+			return; //----------------------------------------------------------
+		}
+	}
+	for (int32_t nSpilledId = 0; nSpilledId < nTotSlots; ++nSpilledId) {
+		m_aSpilledSlots[nSpilledId].m_nOffset = aNewOffsets[nSpilledId];
+	}
+	m_oSpillSegment.swap(oNewSegment);
+	m_nSpillDeadBytes = 0;
+	// the old file is deleted by the destructor of oNewSegment
+}
+void FofiModel::serializeResult(const WatchedResult& oWR, std::vector<char>& aBuffer)
+{
+	const int32_t nTotActions = static_cast<int32_t>(oWR.m_aActions.size());
+	aBuffer.resize(sizeof(SpilledResult) + nTotActions * sizeof(SpilledAction));
+	char* p0Cur = aBuffer.data();
+	SpilledResult oSR{};
+	oSR.m_nDroppedActions = oWR.m_nDroppedActions;
+	oSR.m_nParentTWDIdx = oWR.m_nParentTWDIdx;
+	oSR.m_nNameId = oWR.m_nNameId;
+	oSR.m_nTotActions = nTotActions;
+	oSR.m_nResultType = static_cast<uint8_t>(oWR.m_eResultType);
+	oSR.m_nIsDir = (oWR.m_bIsDir ? 1 : 0);
+	oSR.m_nInconsistent = (oWR.m_bInconsistent ? 1 : 0);
+	std::memcpy(p0Cur, &oSR, sizeof(SpilledResult));
+	p0Cur += sizeof(SpilledResult);
+	for (const ActionData& oActionData : oWR.m_aActions) {
+		SpilledAction oSA{};
+		oSA.m_nTimeUsec = oActionData.m_nTimeUsec;
+		oSA.m_nLastTimeUsec = oActionData.m_nLastTimeUsec;
+		oSA.m_nCount = oActionData.m_nCount;
+		oSA.m_nOtherPathId = oActionData.m_nOtherPathId;
+		oSA.m_nAction = static_cast<uint8_t>(oActionData.m_eAction);
+		oSA.m_nImmediate = (oActionData.m_bImmediate ? 1 : 0);
+		oSA.m_nCausedByAttribChange = (oActionData.m_bCausedByAttribChange ? 1 : 0);
+		std::memcpy(p0Cur, &oSA, sizeof(SpilledAction));
+		p0Cur += sizeof(SpilledAction);
+	}
+}
+void FofiModel::deserializeResult(const SpilledResult& oSR, const char* p0Actions, WatchedResult& oWR)
+{
+	oWR.m_aActions.resize(oSR.m_nTotActions);
+	const char* p0Cur = p0Actions;
+	for (ActionData& oActionData : oWR.m_aActions.m_aData) {
+		SpilledAction oSA;
+		std::memcpy(&oSA, p0Cur, sizeof(SpilledAction));
+		p0Cur += sizeof(SpilledAction);
+		oActionData.m_eAction = static_cast<INotifierSource::FOFI_ACTION>(oSA.m_nAction);
+		oActionData.m_bImmediate = (oSA.m_nImmediate != 0);
+		oActionData.m_bCausedByAttribChange = (oSA.m_nCausedByAttribChange != 0);
+		oActionData.m_nTimeUsec = oSA.m_nTimeUsec;
+		oActionData.m_nLastTimeUsec = oSA.m_nLastTimeUsec;
+		oActionData.m_nCount = oSA.m_nCount;
+		oActionData.m_nOtherPathId = oSA.m_nOtherPathId;
+	}
+	oWR.m_nDroppedActions = oSR.m_nDroppedActions;
+	oWR.m_eResultType = static_cast<RESULT_TYPE>(oSR.m_nResultType);
+	oWR.m_bIsDir = (oSR.m_nIsDir != 0);
+	oWR.m_bInconsistent = (oSR.m_nInconsistent != 0);
+	oWR.m_nParentTWDIdx = oSR.m_nParentTWDIdx;
+	oWR.m_nNameId = oSR.m_nNameId;
+}
+bool FofiModel::readSpilledResult(int32_t nSpilledId, WatchedResult& oWR) const
+{
+	const int64_t nOffset = m_aSpilledSlots[nSpilledId].m_nOffset;
+	assert(nOffset >= 0);
+	SpilledResult oSR;
+	if (! m_oSpillSegment.read(nOffset, reinterpret_cast<char*>(&oSR), sizeof(SpilledResult))) {
+		return false; //--------------------------------------------------------
+	}
+	const int32_t nSize = static_cast<int32_t>(oSR.m_nTotActions * sizeof(SpilledAction));
+	m_aSpillBuffer.resize(nSize);
+	if ((nSize > 0) && ! m_oSpillSegment.read(nOffset + sizeof(SpilledResult), m_aSpillBuffer.data(), nSize)) {
+		return false; //--------------------------------------------------------
+	}
+	deserializeResult(oSR, m_aSpillBuffer.data(), oWR);
+	return true;
+}
+int32_t FofiModel::faultInResult(int32_t nTWDIdx, int32_t nRefPos)
+{
+	ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
+	const int32_t nSpilledRef = oTWD.m_aWatchedResultIdxs[nRefPos];
+	assert(isSpilledRef(nSpilledRef));
+	const int32_t nSpilledId = getSpilledId(nSpilledRef);
+	assert(m_aSpilledSlots[nSpilledId].m_nRefPos == nRefPos);
+	WatchedResult oSpilledWR;
+	if (! readSpilledResult(nSpilledId, oSpilledWR)) {
+		// the result stays spilled, its history can't be replaced by a made up one
+		throw std::runtime_error("Could not read spilled result from " + m_oSpillSegment.getPath());
+	}
+	const int64_t nKey = ToWatchDir::getNameKey(oSpilledWR.m_nNameId, oSpilledWR.m_bIsDir);
+	const int32_t nResultIdx = allocWatchedResult();
+	m_aWatchedResults[nResultIdx] = std::move(oSpilledWR);
+	m_aWatchedResults[nResultIdx].m_nRefPos = nRefPos;
+	oTWD.m_aWatchedResultIdxs[nRefPos] = nResultIdx;
+	oTWD.m_oWatchedResultIdxByKey[nKey] = nResultIdx;
+	m_nSpillDeadBytes += m_aSpilledSlots[nSpilledId].m_nSize;
+	m_aSpilledSlots[nSpilledId].m_nOffset = -1;
+	m_aFreeSpilledIds.push_back(nSpilledId);
+	--m_nTotSpilledResults;
+	// Its last action is older than the ones of the results before it in the list,
+	// so it's spilled again at the latest when they are
+	touchActiveResult(nResultIdx);
+	return nResultIdx;
 }
 INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::FofiData& oFofiData)
+{
+	const INotifierSource::FOFI_ACTION eAction = oFofiData.m_eAction;
+	const bool bValidAction = (! oFofiData.m_bOverflow) && (eAction >= 0) && (eAction < s_nTotEventActions);
+	if (! bValidAction) {
+		return processFileModified(oFofiData); //-------------------------------
+	}
+	++m_aTotEvents[eAction];
+	if (m_oTraceRing.isEnabled()) {
+		// not interned: the pool never shrinks, names that aren't known yet are recorded as -1
+		const int32_t nNameId = (oFofiData.m_sName.empty() ? -1 : m_oStringPool.find(oFofiData.m_sName));
+		m_oTraceRing.trace(TraceRing::TRACE_EVENT_INOTIFY, oFofiData.m_nTag, nNameId
+							, eAction, (oFofiData.m_bIsDir ? 1 : 0), oFofiData.m_nRenameCookie);
+	}
+	m_eCurEventAction = eAction;
+	if (m_bTrackLatencies && (oFofiData.m_nReadTimeNsec > 0)) {
+		m_nCurEventReadNsec = oFofiData.m_nReadTimeNsec;
+		m_nCurEventStartNsec = Util::getNowTimeNanoseconds();
+		m_aLatencyHistograms[eAction * s_nTotLatencyStages + LATENCY_STAGE_QUEUED].record(m_nCurEventStartNsec - m_nCurEventReadNsec);
+	}
+	INotifierSource::FOFI_PROGRESS eProgress = INotifierSource::FOFI_PROGRESS_CONTINUE;
+	try {
+		eProgress = processFileModified(oFofiData);
+	} catch (const std::runtime_error& oErr) {
+		// ex. a spilled result couldn't be read back
+		emitAbort(oErr.what());
+	}
+	m_nCurEventReadNsec = -1;
+	m_eCurEventAction = INotifierSource::FOFI_ACTION_INVALID;
+	return eProgress;
+}
+void FofiModel::emitWatchedResultAction(const WatchedResult& oWatchedResult)
+{
+	if (m_nCurEventReadNsec >= 0) {
+		const int64_t nNowNsec = Util::getNowTimeNanoseconds();
+		const int32_t nFirstIdx = m_eCurEventAction * s_nTotLatencyStages;
+		m_aLatencyHistograms[nFirstIdx + LATENCY_STAGE_PROCESSED].record(nNowNsec - m_nCurEventStartNsec);
+		m_aLatencyHistograms[nFirstIdx + LATENCY_STAGE_EMITTED].record(nNowNsec - m_nCurEventReadNsec);
+	}
+	m_oTraceRing.trace(TraceRing::TRACE_EVENT_RESULT, oWatchedResult.m_nParentTWDIdx, oWatchedResult.m_nNameId
+						, oWatchedResult.m_eResultType, (oWatchedResult.m_bIsDir ? 1 : 0)
+						, (oWatchedResult.m_aActions.empty() ? -1 : oWatchedResult.m_aActions.back().m_eAction));
+	m_oWatchedResultActionSignal.emit(oWatchedResult);
+}
+INotifierSource::FOFI_PROGRESS FofiModel::processFileModified(const INotifierSource::FofiData& oFofiData)
 {
 	++m_nEventCounter;
 	if (oFofiData.m_bOverflow) {
 		m_bOverflow = true;
+		++m_nTotOverflows;
+		m_oTraceRing.trace(TraceRing::TRACE_EVENT_OVERFLOW, -1, -1);
 		return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------------------
 	}
 	INotifierSource::FOFI_ACTION eAction = oFofiData.m_eAction;
@@ -847,11 +2592,13 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 	const bool bIsDir = oFofiData.m_bIsDir;
 	const auto& sName = oFofiData.m_sName;
 	ToWatchDir& oParentTWD = m_aToWatchDirs[nParentTWDIdx];
+	if (oParentTWD.m_bFree) {
+		// Can't happen: a recycled ToWatchDir has no watch and
+		// the source drops the events of removed watches
+		assert(false);
+		return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------------------
+	}
 	//
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified tag=" << oFofiData.m_nTag << "    name=\"" << oFofiData.m_sName << "\"  " << (oFofiData.m_bIsDir ? "DIR" : "FILE") << '\n';
-//	std::cout << "               action=" << static_cast<int32_t>(oFofiData.m_eAction) << " cookie=" << oFofiData.m_nRenameCookie << '\n';
-#endif //STMM_TRACE_DEBUG
 	const auto nNowUsec = Util::getNowTimeMicroseconds() - m_nStartTimeUsec;
 	//
 	if (sName.empty()) {
@@ -867,8 +2614,7 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 		if (m_nRootResultIdx < 0) {
 			m_nRootResultIdx = addWatchedResultRoot();
 			WatchedResult& oWatchedResult = m_aWatchedResults[m_nRootResultIdx];
-			oWatchedResult.m_eResultType = RESULT_MODIFIED;
-//std::cout << "FofiModel::onFileModified RESULT 2 sChildPath=/ (root)" << '\n';
+			setResultType(oWatchedResult, RESULT_MODIFIED);
 			addActionData(oWatchedResult, eAction, nNowUsec);
 		} else {
 			#ifndef NDEBUG
@@ -879,9 +2625,17 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 		return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------------------
 	}
 
-	const std::string sChildPathName = Util::getPathFromDirAndName(oParentTWD.m_sPathName, sName);
+	const std::string sParentPath = getToWatchDirPath(nParentTWDIdx);
+	const std::string sChildPathName = Util::getPathFromDirAndName(sParentPath, sName);
 
 	const bool bFilteredOut = isFilteredOut(bIsDir, oParentTWD, sName, sChildPathName);
+	if (bFilteredOut) {
+		++m_nTotFilteredOutEvents;
+		if (m_oTraceRing.isEnabled()) {
+			m_oTraceRing.trace(TraceRing::TRACE_EVENT_FILTERED_OUT, nParentTWDIdx, m_oStringPool.find(sName)
+								, eAction, (bIsDir ? 1 : 0));
+		}
+	}
 	bool bWasAttrib = false;
 	//
 	const bool bRenameFrom = (eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
@@ -889,7 +2643,6 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 		if (bRenameFrom) {
 			m_aOpenMoves.emplace_back();
 			OpenMove& oOpenMove = m_aOpenMoves.back();
-//std::cout << "onFileModified RENAME FROM nNowUsec=" << nNowUsec << "  cookie=" << oFofiData.m_nRenameCookie << " &Move=" << reinterpret_cast<int64_t>(&oOpenMove) << '\n';
 			oOpenMove.m_nParentTWDIdx = nParentTWDIdx;
 			oOpenMove.m_nTWDIdx = -1; // The renamed (watched) directory, filled below if bIsDir == true
 			oOpenMove.m_bIsDir = bIsDir;
@@ -906,20 +2659,17 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 					// Check other objects are coherent
 					assert(findResult(nParentTWDIdx, sName, true) < 0);
 					#ifndef NDEBUG
-					auto itFindE = oParentTWD.findInExisting(bIsDir, sName);
+					auto itFindE = oParentTWD.findInExisting(bIsDir, m_oStringPool.find(sName));
 					#endif //NDEBUG
 					assert(itFindE == oParentTWD.m_aExisting.end());
 					try {
 						// just create a non iwatched but marked as existing (falsely, since moved from) TWD
-						nChildTWDIdx = addExistingToWatchDir(sChildPathName);
+						nChildTWDIdx = addExistingToWatchDir(nParentTWDIdx, sName, sChildPathName);
 					} catch (const std::runtime_error& oErr) {
-						m_oAbortSignal.emit(oErr.what());
+						emitAbort(oErr.what());
 						return INotifierSource::FOFI_PROGRESS_CONTINUE; //------
 					}
 					assert(nChildTWDIdx >= 0);
-					ToWatchDir& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
-					oChildTWD.m_nParentTWDIdx = nParentTWDIdx;
-					Util::addValueToDequeUniquely(oParentTWD.m_aToWatchSubdirIdxs, nChildTWDIdx);
 				} else {
 					// Setting to non existing is done in the rename to?
 					//ToWatchDir& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
@@ -932,15 +2682,11 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				oOpenMove.m_nMoveFromTimeUsec = nNowUsec;
 			}
 		} else { // rename to
-//std::cout << "onFileModified RENAME TO nNowUsec=" << nNowUsec << "  cookie=" << oFofiData.m_nRenameCookie <<  '\n';
 			const auto itFind = std::find_if(m_aOpenMoves.begin(), m_aOpenMoves.end(), [&](const OpenMove& oOpenMove)
 			{
-//std::cout << "onFileModified RENAME TO cookie=" << oOpenMove.m_nRenameCookie <<  '\n';
-//std::cout << "              oOpenMove.m_sName=" << oOpenMove.m_sName <<  '\n';
 				return (oOpenMove.m_nRenameCookie == oFofiData.m_nRenameCookie);
 			});
 			if (itFind != m_aOpenMoves.end()) {
-//std::cout << "onFileModified RENAME TO FOUND! m_aOpenMoves.size()=" << m_aOpenMoves.size() << '\n';
 				OpenMove& oOpenMove = *itFind;
 				if (bFilteredOut && oOpenMove.m_bFilteredOut) {
 					return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------
@@ -952,16 +2698,22 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				// On the other hand the destination zone might create ToWatchDir for
 				// actual folders that were filtered out in the source or (alas) were
 				// created immediately after the inode rename (generating fake file renames)
-				const auto& sFromParentPath = m_aToWatchDirs[oOpenMove.m_nParentTWDIdx].m_sPathName;
+				// The source ToWatchDir subtree isn't reparented in place because the
+				// results of the source keep their parent index and are still reported
+				// (renamed from) under the old path, the destination needs its own
+				// ToWatchDirs with the owner zone, depth and filters of the destination
+				// and the path cache relies on a ToWatchDir never being renamed.
+				// Only the inotify watches are transferred.
+				const auto sFromParentPath = getToWatchDirPath(oOpenMove.m_nParentTWDIdx);
 				try {
 					traverseRename((oOpenMove.m_bFilteredOut ? -1 : oOpenMove.m_nParentTWDIdx)
 									, sFromParentPath, oOpenMove.m_sName, oOpenMove.m_sPathName
 									, bIsDir
 									, (bFilteredOut ? -1 : nParentTWDIdx)
-									, oParentTWD.m_sPathName, sName, sChildPathName
+									, sParentPath, sName, sChildPathName
 									, nNowUsec);
 				} catch (const std::runtime_error& oErr) {
-					m_oAbortSignal.emit(oErr.what());
+					emitAbort(oErr.what());
 					return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------
 				}
 				if (m_aOpenMoves.size() > 1) {
@@ -969,7 +2721,6 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				}
 				m_aOpenMoves.pop_back();
 			} else {
-//std::cout << "onFileModified RENAME TO !NOT!FOUND! m_aOpenMoves.size()=" << m_aOpenMoves.size() << '\n';
 				// rename to from outside watched area
 				if (bFilteredOut) {
 					return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------
@@ -979,16 +2730,15 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 									, "", "", ""
 									, bIsDir
 									, nParentTWDIdx
-									, oParentTWD.m_sPathName, sName, sChildPathName
+									, sParentPath, sName, sChildPathName
 									, nNowUsec);
 				} catch (const std::runtime_error& oErr) {
-					m_oAbortSignal.emit(oErr.what());
+					emitAbort(oErr.what());
 					return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------
 				}
 			}
 		}
 	} else if (bFilteredOut) {
-//std::cout << "FofiModel::onFileModified FILTERED OUT" << '\n';
 		return INotifierSource::FOFI_PROGRESS_CONTINUE; //----------------------
 	} else {
 		bool bResultIdxFindCalled = false;
@@ -997,10 +2747,10 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 			// Did an attribute change cause the file or dir to become visible?
 			// or to disappear?
 			// (root user can see everything)
-			nResultIdx = findResult(oParentTWD.m_sPathName, sName, bIsDir);
+			nResultIdx = findResult(nParentTWDIdx, sName, bIsDir);
 			bResultIdxFindCalled = true;
 			if (nResultIdx < 0) {
-				auto itFindE = oParentTWD.findInExisting(bIsDir, sName);
+				auto itFindE = oParentTWD.findInExisting(bIsDir, m_oStringPool.find(sName));
 				if (itFindE == oParentTWD.m_aExisting.end()) {
 					// popped into existence (visibility from root only to normal user)
 					eAction = INotifierSource::FOFI_ACTION_CREATE;
@@ -1015,11 +2765,6 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				}
 			}
 		}
-#ifdef STMM_TRACE_DEBUG
-		if (bWasAttrib) {
-//			std::cout << "WAS ATTRIB!!!   sChildPathName=" << sChildPathName << "  action=" << static_cast<int32_t>(eAction)<< '\n';
-		}
-#endif //STMM_TRACE_DEBUG
 		if (! bResultIdxFindCalled) {
 			nResultIdx = findResult(nParentTWDIdx, sName, bIsDir);
 		}
@@ -1028,77 +2773,49 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 		bool bWasCreatedImmediately = false;
 		bool bInconsistent = false;
 		if (! bWatchedResultExists) {
-			const auto itFindE = oParentTWD.findInExisting(bIsDir, sName);
+			const auto itFindE = oParentTWD.findInExisting(bIsDir, m_oStringPool.find(sName));
 			const bool bExisted = (itFindE != oParentTWD.m_aExisting.end());
-			nResultIdx = addWatchedResult(oParentTWD, sName, bIsDir);
+			nResultIdx = addWatchedResult(nParentTWDIdx, sName, bIsDir);
 			WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
-//std::cout << "FofiModel::onFileModified RESULT 3 sChildPath=" << sChildPathName << '\n';
 			if (eAction == INotifierSource::FOFI_ACTION_CREATE) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  CREATE (N) nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-#endif //STMM_TRACE_DEBUG
-				oWatchedResult.m_eResultType = RESULT_CREATED;
+				setResultType(oWatchedResult, RESULT_CREATED);
 				if (bExisted) {
 					// Inconsistent: existing file or dir is created! Missed remove
 					// or race condition happened during initial setup
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            1x oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
 			} else if (eAction == INotifierSource::FOFI_ACTION_DELETE) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  DELETE (N) nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-#endif //STMM_TRACE_DEBUG
-				oWatchedResult.m_eResultType = RESULT_DELETED;
+				setResultType(oWatchedResult, RESULT_DELETED);
 				if (! bExisted) {
 					// Inconsistent: non existing file or dir is deleted! Missed create
 					// or race condition happened during initial setup
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            1y oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
 			} else {
 				assert((eAction == INotifierSource::FOFI_ACTION_MODIFY) || (eAction == INotifierSource::FOFI_ACTION_ATTRIB));
-				oWatchedResult.m_eResultType = RESULT_MODIFIED;
+				setResultType(oWatchedResult, RESULT_MODIFIED);
 				if (! bExisted) {
 					// Inconsistent: non existing file or dir is modified! Missed create
 					// or race condition happened during initial setup
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            1z oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
 			}
-			ActionData& oActionData = addActionData(oWatchedResult, eAction, nNowUsec);
-			oActionData.m_bCausedByAttribChange = bWasAttrib;
+			addActionData(oWatchedResult, eAction, nNowUsec, bWasAttrib);
 		} else {
 			WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
 			const bool bExistedAtStart = oWatchedResult.existedAtStart();
 			if (eAction == INotifierSource::FOFI_ACTION_CREATE) {
 				bWasCreatedImmediately = oWatchedResult.immediate();
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  CREATE (E) nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << "  bWasCreatedImmediately=" << bWasCreatedImmediately << '\n';
-#endif //STMM_TRACE_DEBUG
 				// from RESULT_DELETED to RESULT_MODIFIED
 				// from RESULT_TEMPORARY to RESULT_CREATED
 				// from RESULT_CREATED to RESULT_CREATED: error
 				// from RESULT_MODIFIED to RESULT_MODIFIED: error
 				bInconsistent = ((! bWasCreatedImmediately) && oWatchedResult.exists());
 				if (bInconsistent) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            2 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
 				if ((! bWasCreatedImmediately) || bInconsistent) {
-					ActionData& oActionData = addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_CREATE, nNowUsec);
-					oActionData.m_bCausedByAttribChange = bWasAttrib;
+					addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_CREATE, nNowUsec, bWasAttrib);
 				} else {
 					setNotImmediate(oWatchedResult);
 					//#ifndef NDEBUG
@@ -1109,27 +2826,19 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 					bEmitWatchedResult = false;
 				}
 				//
-				oWatchedResult.m_eResultType = (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED);
+				setResultType(oWatchedResult, (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED));
 				//
 			} else if (eAction == INotifierSource::FOFI_ACTION_DELETE) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified  DELETE (E) nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-#endif //STMM_TRACE_DEBUG
 				// from RESULT_DELETED to RESULT_DELETED error
 				// from RESULT_TEMPORARY to RESULT_TEMPORARY error
 				// from RESULT_CREATED to RESULT_TEMPORARY
 				// from RESULT_MODIFIED to RESULT_DELETED
 				if (! oWatchedResult.exists()) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            3 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
 				}
-				ActionData& oActionData = addActionData(oWatchedResult, eAction, nNowUsec);
-				oActionData.m_bCausedByAttribChange = bWasAttrib;
+				addActionData(oWatchedResult, eAction, nNowUsec, bWasAttrib);
 				//
-				oWatchedResult.m_eResultType = (bExistedAtStart ? RESULT_DELETED : RESULT_TEMPORARY);
+				setResultType(oWatchedResult, (bExistedAtStart ? RESULT_DELETED : RESULT_TEMPORARY));
 			} else {
 				assert((eAction == INotifierSource::FOFI_ACTION_MODIFY) || (eAction == INotifierSource::FOFI_ACTION_ATTRIB));
 				// from RESULT_DELETED to RESULT_MODIFIED error
@@ -1137,15 +2846,10 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				// from RESULT_CREATED to RESULT_MODIFIED ignore
 				// from RESULT_MODIFIED to RESULT_MODIFIED ignore
 				if (! oWatchedResult.exists()) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            4 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 					setInconsistent(oWatchedResult);
-					ActionData& oActionData = addActionData(oWatchedResult, eAction, nNowUsec);
-					oActionData.m_bCausedByAttribChange = bWasAttrib;
+					addActionData(oWatchedResult, eAction, nNowUsec, bWasAttrib);
 					//
-					oWatchedResult.m_eResultType = (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED);
+					setResultType(oWatchedResult, (bExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED));
 				} else {
 					// no significant action
 					setNotImmediate(oWatchedResult);
@@ -1154,38 +2858,35 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				}
 			}
 		}
-//std::cout << "FofiModel::onFileModified added result: sName=" << sName << "  oParentTWD.m_sPath=" << oParentTWD.m_sPathName << '\n';
 		WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
 		assert(! oWatchedResult.immediate());
+		if (oWatchedResult.m_eResultType == RESULT_TEMPORARY) {
+			addRecycleCandidate(nParentTWDIdx);
+		}
 		//
 		if (! bIsDir) {
 			if (bEmitWatchedResult) {
-				m_oWatchedResultActionSignal.emit(oWatchedResult);
+				emitWatchedResultAction(oWatchedResult);
 			}
 			return INotifierSource::FOFI_PROGRESS_CONTINUE; //------------------
 		}
 
 		const bool bParentIsLeaf = oParentTWD.isLeaf();
-//std::cout << "FofiModel::onFileModified parent=" << nParentTWDIdx << "  is leaf=" << bParentIsLeaf << '\n';
 		//
 		if (eAction == INotifierSource::FOFI_ACTION_CREATE) {
 			//
 			try {
 				// check whether a TWD already exists!
 				int32_t nChildTWDIdx = findToWatchDir(nParentTWDIdx, sChildPathName);
-//std::cout << "FofiModel::onFileModified nChildTWDIdx=" << nChildTWDIdx << '\n';
 				if (nChildTWDIdx < 0) {
 					if (bParentIsLeaf) {
 						// if a structural TWD is not present this dir isn't watched
 						if (bEmitWatchedResult) {
-							m_oWatchedResultActionSignal.emit(oWatchedResult);
+							emitWatchedResultAction(oWatchedResult);
 						}
 						return INotifierSource::FOFI_PROGRESS_CONTINUE; //------
 					}
-					nChildTWDIdx = addExistingToWatchDir(sChildPathName);
-					ToWatchDir& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
-					oChildTWD.m_nParentTWDIdx = nParentTWDIdx;
-					Util::addValueToDequeUniquely(oParentTWD.m_aToWatchSubdirIdxs, nChildTWDIdx);
+					nChildTWDIdx = addExistingToWatchDir(nParentTWDIdx, sName, sChildPathName);
 				} else {
 					ToWatchDir& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
 					if (oChildTWD.m_bExists) {
@@ -1195,8 +2896,7 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 							if (oChildTWD.isWatched()) {
 								// the watch has probably gone anyway
 								/*const int32_t nErrno =*/
-								m_refSource->removePath(oChildTWD.m_nWatchedIdx, nChildTWDIdx);
-								oChildTWD.m_nWatchedIdx = -1;
+								removeINotifyWatch(nChildTWDIdx, oChildTWD);
 							}
 							if (bWatchedResultExists) {
 								// If WR existed and TWD is inconsistent
@@ -1205,19 +2905,14 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 							} else {
 								// Since having a TWD doesn't imply a WR (for the same dir) is also present
 								if (!bInconsistent) {
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::onFileModified Inconsistent nParentTWDIdx=" << nParentTWDIdx << "  sName=" << sName << '\n';
-//	std::cout << "FofiModel::onFileModified            6 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 									setInconsistent(oWatchedResult);
 									assert(oWatchedResult.m_eResultType == RESULT_CREATED);
 									// when a directory is deleted and then recreated mark it as modified
-									oWatchedResult.m_eResultType = RESULT_MODIFIED;
+									setResultType(oWatchedResult, RESULT_MODIFIED);
 								}
 							}
 							assert(bEmitWatchedResult);
 						} else {
-//std::cout << "FofiModel::onFileModified IMM sChildPathName" << sChildPathName << '\n';
 							// the creation was already emitted by createImmediateChildren
 							// it would be a duplicate
 							bEmitWatchedResult = false;
@@ -1235,14 +2930,14 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				}
 				//
 				if (bEmitWatchedResult) {
-					m_oWatchedResultActionSignal.emit(oWatchedResult);
+					emitWatchedResultAction(oWatchedResult);
 				}
 				//
 				if (oChildTWD.isWatched()) {
 					createImmediateChildren(nChildTWDIdx, bWasAttrib, nNowUsec);
 				}
 			} catch (const std::runtime_error& oErr) {
-				m_oAbortSignal.emit(oErr.what());
+				emitAbort(oErr.what());
 				return INotifierSource::FOFI_PROGRESS_CONTINUE; //--------------
 			}
 		} else if (eAction == INotifierSource::FOFI_ACTION_DELETE) {
@@ -1250,12 +2945,7 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 			if (nChildTWDIdx >= 0) {
 				ToWatchDir& oChildTWD = m_aToWatchDirs[nChildTWDIdx];
 				if (oChildTWD.m_bExists) {
-					if (oChildTWD.isWatched()) {
-						m_refSource->removePath(oChildTWD.m_nWatchedIdx, nChildTWDIdx);
-						oChildTWD.m_nWatchedIdx = -1;
-					}
-					oChildTWD.m_bExists = false;
-					oChildTWD.m_aExisting.clear();
+					detachToWatchDir(nChildTWDIdx);
 					//TODO check whether child TWDs (of oChildTWD) are still
 					//TODO marked as existing and watched recursively
 					//TODO and go through the WR and possibly add the missed delete action
@@ -1266,12 +2956,28 @@ INotifierSource::FOFI_PROGRESS FofiModel::onFileModified(const INotifierSource::
 				// deleting a subdir that was never created?
 			}
 			if (bEmitWatchedResult) {
-				m_oWatchedResultActionSignal.emit(oWatchedResult);
+				emitWatchedResultAction(oWatchedResult);
 			}
 		}
 	}
 	return INotifierSource::FOFI_PROGRESS_CONTINUE;
 }
+void FofiModel::RenameFrame::setArgs(int32_t nFromParentTWDIdx
+									, const std::string& sFromParentPath, const std::string& sFromName, const std::string& sFromPath
+									, bool bIsDir
+									, int32_t nToParentTWDIdx
+									, const std::string& sToParentPath, const std::string& sToName, const std::string& sToPath)
+{
+	m_nFromParentTWDIdx = nFromParentTWDIdx;
+	m_sFromParentPath = sFromParentPath;
+	m_sFromName = sFromName;
+	m_sFromPath = sFromPath;
+	m_bIsDir = bIsDir;
+	m_nToParentTWDIdx = nToParentTWDIdx;
+	m_sToParentPath = sToParentPath;
+	m_sToName = sToName;
+	m_sToPath = sToPath;
+}
 void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 								, const std::string& sFromParentPath, const std::string& sFromName, const std::string& sFromPath
 								, bool bIsDir
@@ -1279,7 +2985,42 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 								, const std::string& sToParentPath, const std::string& sToName, const std::string& sToPath
 								, int64_t nNowUsec)
 {
-//std::cout << "FofiModel::traverseRename  sFromPath=" << sFromPath << "  sToPath=" << sToPath << '\n';
+	// Depth first traversal with an explicit stack rather than recursion
+	// since the renamed subtree can be arbitrarily deep.
+	// The visiting order is the same as the recursive one.
+	RenameFrame oFrame;
+	oFrame.setArgs(nFromParentTWDIdx, sFromParentPath, sFromName, sFromPath, bIsDir
+					, nToParentTWDIdx, sToParentPath, sToName, sToPath);
+	if (! traverseRenameEnter(oFrame, nNowUsec)) {
+		return; //--------------------------------------------------------------
+	}
+	std::vector<RenameFrame> aFrames;
+	aFrames.push_back(std::move(oFrame));
+	RenameFrame oChildFrame;
+	while (! aFrames.empty()) {
+		const bool bHasChild = traverseRenameNextChild(aFrames.back(), oChildFrame);
+		if (bHasChild) {
+			if (traverseRenameEnter(oChildFrame, nNowUsec)) {
+				// Note: this invalidates references to the frames
+				aFrames.push_back(std::move(oChildFrame));
+			}
+		} else {
+			traverseRenameLeave(aFrames.back(), nNowUsec);
+			aFrames.pop_back();
+		}
+	}
+}
+bool FofiModel::traverseRenameEnter(RenameFrame& oFrame, int64_t nNowUsec)
+{
+	const int32_t nFromParentTWDIdx = oFrame.m_nFromParentTWDIdx;
+	const std::string& sFromParentPath = oFrame.m_sFromParentPath;
+	const std::string& sFromName = oFrame.m_sFromName;
+	const std::string& sFromPath = oFrame.m_sFromPath;
+	const bool bIsDir = oFrame.m_bIsDir;
+	const int32_t nToParentTWDIdx = oFrame.m_nToParentTWDIdx;
+	const std::string& sToParentPath = oFrame.m_sToParentPath;
+	const std::string& sToName = oFrame.m_sToName;
+	const std::string& sToPath = oFrame.m_sToPath;
 	const bool bFromParentWatched = (nFromParentTWDIdx >= 0);
 	const bool bToParentWatched = (nToParentTWDIdx >= 0);
 	assert(bFromParentWatched || bToParentWatched);
@@ -1292,18 +3033,14 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 	if (bFromParentWatched) {
 		int32_t nFromResultIdx = findResult(nFromParentTWDIdx, sFromName, bIsDir);
 		const bool bNoFromResult = (nFromResultIdx < 0);
-//std::cout << "FofiModel::traverseRename bNoFromResult=" << bNoFromResult << "  sFromName=" << sFromName << "  bIsDir=" << bIsDir<< '\n';
 		if (bNoFromResult) {
-			auto& oFromParentTWD = m_aToWatchDirs[nFromParentTWDIdx];
-			nFromResultIdx = addWatchedResult(oFromParentTWD, sFromParentPath, sFromName, bIsDir);
-//std::cout << "FofiModel::traverseRename RESULT 4 sChildPath=" << sFromParentPath << "/" << sFromName << '\n';
+			nFromResultIdx = addWatchedResult(nFromParentTWDIdx, sFromName, bIsDir);
 		}
 		WatchedResult& oWatchedResult = m_aWatchedResults[nFromResultIdx];
 //if (! oWatchedResult.m_aActions.empty()) {
-//std::cout << "FofiModel::traverseRename action 0=" << static_cast<int32_t>(oWatchedResult.m_aActions[0].m_eAction) << "  size=" << oWatchedResult.m_aActions.size() << '\n';
 //}
 		if (bNoFromResult) {
-			oWatchedResult.m_eResultType = RESULT_DELETED;
+			setResultType(oWatchedResult, RESULT_DELETED);
 		} else {
 			// from RESULT_DELETED to RESULT_DELETED error
 			// from RESULT_TEMPORARY to RESULT_TEMPORARY error
@@ -1313,17 +3050,16 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 			const bool bFromInconsistent = ! oWatchedResult.exists();
 			if (bFromInconsistent) {
 				// missed a create dir?
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::traverseRename Inconsistent nFromParentTWDIdx=" << nFromParentTWDIdx << "  sFromName=" << sFromName << '\n';
-//	std::cout << "FofiModel::traverseRename            7 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 				setInconsistent(oWatchedResult);
 			}
-			oWatchedResult.m_eResultType = (bFromExistedAtStart ? RESULT_DELETED : RESULT_TEMPORARY);
+			setResultType(oWatchedResult, (bFromExistedAtStart ? RESULT_DELETED : RESULT_TEMPORARY));
+			if (! bFromExistedAtStart) {
+				addRecycleCandidate(nFromParentTWDIdx);
+			}
 		}
-		ActionData& oActionData = addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_RENAME_FROM, nNowUsec);
-		oActionData.m_sOtherPath = sToPath;
-		m_oWatchedResultActionSignal.emit(oWatchedResult);
+		addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_RENAME_FROM, nNowUsec
+						, false, false, (sToPath.empty() ? -1 : m_oStringPool.intern(sToPath)));
+		emitWatchedResultAction(oWatchedResult);
 	}
 
 	//
@@ -1331,29 +3067,26 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 	if (bToParentWatched) {
 		nToResultIdx = findResult(nToParentTWDIdx, sToName, bIsDir);
 		const bool bNoToResult = (nToResultIdx < 0);
-//std::cout << "FofiModel::traverseRename bNoToResult=" << bNoToResult << "  sToName=" << sToName << "  bIsDir=" << bIsDir << '\n';
 		if (bNoToResult) {
-			auto& oToParentTWD = m_aToWatchDirs[nToParentTWDIdx];
-			nToResultIdx = addWatchedResult(oToParentTWD, sToParentPath, sToName, bIsDir);
-//std::cout << "FofiModel::traverseRename RESULT 5 sChildPath=" << sToParentPath << "/" << sToName << '\n';
+			nToResultIdx = addWatchedResult(nToParentTWDIdx, sToName, bIsDir);
 		}
 		WatchedResult& oWatchedResult = m_aWatchedResults[nToResultIdx];
 		if (bNoToResult) {
-			oWatchedResult.m_eResultType = RESULT_CREATED;
+			setResultType(oWatchedResult, RESULT_CREATED);
 		} else {
 			// from RESULT_DELETED to RESULT_MODIFIED
 			// from RESULT_TEMPORARY to RESULT_CREATED
 			// from RESULT_CREATED to RESULT_CREATED: NO error!
 			// from RESULT_MODIFIED to RESULT_MODIFIED: NO error!
 			const bool bToExistedAtStart = oWatchedResult.existedAtStart();
-			oWatchedResult.m_eResultType = (bToExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED);
+			setResultType(oWatchedResult, (bToExistedAtStart ? RESULT_MODIFIED : RESULT_CREATED));
 		}
-		ActionData& oActionData = addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_RENAME_TO, nNowUsec);
-		oActionData.m_sOtherPath = sFromPath;
-		m_oWatchedResultActionSignal.emit(oWatchedResult);
+		addActionData(oWatchedResult, INotifierSource::FOFI_ACTION_RENAME_TO, nNowUsec
+						, false, false, (sFromPath.empty() ? -1 : m_oStringPool.intern(sFromPath)));
+		emitWatchedResultAction(oWatchedResult);
 	}
 	if (! bIsDir) {
-		return; //--------------------------------------------------------------
+		return false; //--------------------------------------------------------
 	}
 	const int32_t nFromTWDIdx = (bFromParentWatched ? findToWatchDir(nFromParentTWDIdx, sFromPath) : -1);
 	const bool bFromExists = (nFromTWDIdx >= 0) && m_aToWatchDirs[nFromTWDIdx].m_bExists;
@@ -1363,16 +3096,12 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 		if (nToTWDIdx < 0) {
 			// from function invariant we know sToPath not filtered out
 			// but if parent is leaf the TWD should either already exist because base path
-			// of another DZ or because it's a gap filler, otherwise recursion (as
+			// of another DZ or because it's a gap filler, otherwise the traversal (as
 			// far as the destination is concerned) stops.
 			const bool bToParentIsLeaf = m_aToWatchDirs[nToParentTWDIdx].isLeaf();
 			if (!bToParentIsLeaf) {
 				// create a TWD!
-				nToTWDIdx = addExistingToWatchDir(sToPath);
-				auto& oToTWD = m_aToWatchDirs[nToTWDIdx];
-				oToTWD.m_nParentTWDIdx = nToParentTWDIdx;
-				auto& oToParentTWD = m_aToWatchDirs[nToParentTWDIdx];
-				Util::addValueToDequeUniquely(oToParentTWD.m_aToWatchSubdirIdxs, nToTWDIdx);
+				nToTWDIdx = addExistingToWatchDir(nToParentTWDIdx, sToName, sToPath);
 				// not adding iwatch yet because it might be transfered to
 				// destination path by from path further down
 			}
@@ -1382,17 +3111,12 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 				// a delete event was missed
 				if (oToTWD.isWatched()) {
 					/*const int32_t nErrno =*/
-					m_refSource->removePath(oToTWD.m_nWatchedIdx, nToTWDIdx);
-					oToTWD.m_nWatchedIdx = -1;
+					removeINotifyWatch(nToTWDIdx, oToTWD);
 				}
 				WatchedResult& oWatchedResult = m_aWatchedResults[nToResultIdx];
-#ifdef STMM_TRACE_DEBUG
-//	std::cout << "FofiModel::traverseRename Inconsistent nToParentTWDIdx=" << nToParentTWDIdx << "  sToName=" << sToName << '\n';
-//	std::cout << "FofiModel::traverseRename            9 oWatchedResult.m_eResultType=" << static_cast<int32_t>(oWatchedResult.m_eResultType) << '\n';
-#endif //STMM_TRACE_DEBUG
 				setInconsistent(oWatchedResult);
 				setNotImmediate(oWatchedResult);
-				oToTWD.m_aExisting.clear();
+				oToTWD.clearExisting();
 			} else {
 				// pretend the directory exists even though oFStat.exixts()
 				// might already be false causing of delete event following in the inotify queue
@@ -1401,19 +3125,23 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 		}
 	}
 	const bool bToExists = (nToTWDIdx >= 0) && m_aToWatchDirs[nToTWDIdx].m_bExists;
-//std::cout << "FofiModel::traverseRename bFromExists=" << bFromExists << " bToExists=" << bToExists << '\n';
-//std::cout << "                          sFromPath=" << sFromPath << " sToPath=" << sToPath << '\n';
-//std::cout << "                          nFromTWDIdx=" << nFromTWDIdx << " nToTWDIdx=" << nToTWDIdx << '\n';
 	if ((!bFromExists) && !bToExists) {
-		return; //--------------------------------------------------------------
+		return false; //--------------------------------------------------------
 	}
-	std::vector<ToWatchDir::FileDir> aVisitedNames;
+	oFrame.m_nFromTWDIdx = nFromTWDIdx;
+	oFrame.m_bFromExists = bFromExists;
+	oFrame.m_nToTWDIdx = nToTWDIdx;
+	oFrame.m_bToExists = bToExists;
+	oFrame.m_eStage = RENAME_STAGE_DONE;
+	oFrame.m_nCurIdx = 0;
+	oFrame.m_nEndIdx = 0;
+	oFrame.m_nVisitingFromChildTWDIdx = -1;
+	oFrame.m_oVisitedKeys.clear();
 	if (bFromExists) {
 		ToWatchDir& oFromTWD = m_aToWatchDirs[nFromTWDIdx];
 		if (oFromTWD.isWatched()) {
 			if (bToExists) {
 				// transfer iwatch to destination
-//std::cout << "FofiModel::traverseRename RENAME iWatch!" << '\n';
 				#ifndef NDEBUG
 				const int32_t nErrno =
 				#endif //NDEBUG
@@ -1428,88 +3156,109 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 				#ifndef NDEBUG
 				const int32_t nErrno =
 				#endif //NDEBUG
-				m_refSource->removePath(oFromTWD.m_nWatchedIdx, nFromTWDIdx);
+				removeINotifyWatch(nFromTWDIdx, oFromTWD);
 				assert(nErrno != INotifierSource::EXTENDED_ERRNO_WATCH_NOT_FOUND);
-				oFromTWD.m_nWatchedIdx = -1;
 			}
 		}
 		oFromTWD.m_bExists = false;
-		for (const int32_t& nFromChildTWDIdx : oFromTWD.m_aToWatchSubdirIdxs) {
+		oFrame.m_eStage = RENAME_STAGE_SUB_DIRS;
+		oFrame.m_nEndIdx = static_cast<int32_t>(oFromTWD.m_aToWatchSubdirIdxs.size());
+	}
+	return true;
+}
+bool FofiModel::traverseRenameNextChild(RenameFrame& oFrame, RenameFrame& oChildFrame)
+{
+	if (oFrame.m_nVisitingFromChildTWDIdx >= 0) {
+		// the subdir's traversal has completed
+		m_aToWatchDirs[oFrame.m_nVisitingFromChildTWDIdx].m_bExists = false;
+		oFrame.m_nVisitingFromChildTWDIdx = -1;
+	}
+	const int32_t nFromTWDIdx = oFrame.m_nFromTWDIdx;
+	const int32_t nToTWDIdx = oFrame.m_nToTWDIdx;
+	const bool bToExists = oFrame.m_bToExists;
+	const std::string& sFromPath = oFrame.m_sFromPath;
+	const std::string& sToPath = oFrame.m_sToPath;
+	auto& oVisitedKeys = oFrame.m_oVisitedKeys;
+	if (oFrame.m_eStage == RENAME_STAGE_SUB_DIRS) {
+		ToWatchDir& oFromTWD = m_aToWatchDirs[nFromTWDIdx];
+		while (oFrame.m_nCurIdx < oFrame.m_nEndIdx) {
+			const int32_t nFromChildTWDIdx = oFromTWD.m_aToWatchSubdirIdxs[oFrame.m_nCurIdx];
+			++oFrame.m_nCurIdx;
 			auto& oFromChildTWD = m_aToWatchDirs[nFromChildTWDIdx];
 			// if the TWD for the from child exists, we know it isn't filtered out
-			char const* p0FromChildName = oFromChildTWD.getName();
-			assert(p0FromChildName != nullptr);
-			const std::string sFromChildName{p0FromChildName};
-			aVisitedNames.push_back({sFromChildName, true, false});
+			const int32_t nFromChildNameId = oFromChildTWD.m_nNameId;
+			assert(nFromChildNameId >= 0);
+			const std::string sFromChildName{m_oStringPool.get(nFromChildNameId)};
+			oVisitedKeys.insert(ToWatchDir::getNameKey(nFromChildNameId, true));
 			if (! oFromChildTWD.m_bExists) {
 				// oFromChildTWD.m_bExists equals child WR.exists() (if WR object present)
-				continue; // for----
+				continue; // while ---
 			}
 			//
 			bool bToChildDefined = bToExists;
 			if (bToExists) {
 				const ToWatchDir& oToTWD = m_aToWatchDirs[nToTWDIdx];
-				const auto itFind = std::find_if(oToTWD.m_aToWatchSubdirIdxs.begin(), oToTWD.m_aToWatchSubdirIdxs.end(), [&](int32_t nCurTWDIdx)
-				{
-					auto& oToChildTWD = m_aToWatchDirs[nCurTWDIdx];
-					char const* p0ToName = oToChildTWD.getName();
-					assert(p0ToName != nullptr);
-					return (sFromChildName == p0ToName);
-				});
-				const bool bNameWasWatched = (itFind != oToTWD.m_aToWatchSubdirIdxs.end());
+				const int32_t nToChildTWDIdx = oToTWD.findSubDirIdx(nFromChildNameId);
+				const bool bNameWasWatched = (nToChildTWDIdx >= 0);
 				if (bNameWasWatched) {
 					// the TWD for the to child found, therefore can't possibly be filtered out
 					// even though it's not necessarily part of oToTWD's zone
-					const int32_t nToChildTWDIdx = *itFind;
 					ToWatchDir& oToChildTWD = m_aToWatchDirs[nToChildTWDIdx];
 					if (oToChildTWD.m_bExists) {
 						oToChildTWD.m_bExists = false;
-						oToChildTWD.m_aExisting.clear();
+						oToChildTWD.clearExisting();
 						// inconsistent: we missed a remove event
 						if (oToChildTWD.isWatched()) {
 							// if it's watched it's permission might have changed
-							m_refSource->removePath(oToChildTWD.m_nWatchedIdx, nToChildTWDIdx);
-							oToChildTWD.m_nWatchedIdx = -1;
+							removeINotifyWatch(nToChildTWDIdx, oToChildTWD);
 						}
 					}
 				} else {
 					// check whether filtered out in the destination
 					//TODO is this recalculated below?
-					const auto sToChildPath = Util::getPathFromDirAndName(oToTWD.m_sPathName, sFromChildName);
+					const auto sToChildPath = Util::getPathFromDirAndName(sToPath, sFromChildName);
 					const bool bFilteredOut = isFilteredOutSubDir(oToTWD, sFromChildName, sToChildPath);
 					if (bFilteredOut) {
 						bToChildDefined = false;
 					}
 				}
 			}
-//std::cout << "FofiModel::traverseRename DIR1 sFromChildPath=" << oFromChildTWD.m_sPathName << '\n';
+			const std::string sFromChildPath = Util::getPathFromDirAndName(sFromPath, sFromChildName);
 			const std::string sToChildPath = (bToChildDefined ? Util::getPathFromDirAndName(sToPath, sFromChildName) : m_sES);
-			traverseRename(nFromTWDIdx, oFromTWD.m_sPathName, sFromChildName, oFromChildTWD.m_sPathName
-							, true
-							, (bToChildDefined ? nToTWDIdx : -1)
-							, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath
-							, nNowUsec);
-			oFromChildTWD.m_bExists = false;
+			oChildFrame.setArgs(nFromTWDIdx, sFromPath, sFromChildName, sFromChildPath
+								, true
+								, (bToChildDefined ? nToTWDIdx : -1)
+								, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath);
+			oFrame.m_nVisitingFromChildTWDIdx = nFromChildTWDIdx;
+			return true; //-----------------------------------------------------
 		}
-		//
-		for (const int32_t nWRIdx : oFromTWD.m_aWatchedResultIdxs) {
+		oFrame.m_eStage = RENAME_STAGE_RESULTS;
+		oFrame.m_nCurIdx = 0;
+		oFrame.m_nEndIdx = static_cast<int32_t>(oFromTWD.m_aWatchedResultIdxs.size());
+	}
+	if (oFrame.m_eStage == RENAME_STAGE_RESULTS) {
+		ToWatchDir& oFromTWD = m_aToWatchDirs[nFromTWDIdx];
+		while (oFrame.m_nCurIdx < oFrame.m_nEndIdx) {
+			int32_t nWRIdx = oFromTWD.m_aWatchedResultIdxs[oFrame.m_nCurIdx];
+			if (isSpilledRef(nWRIdx)) {
+				nWRIdx = faultInResult(nFromTWDIdx, oFrame.m_nCurIdx);
+			}
+			++oFrame.m_nCurIdx;
 			WatchedResult& oWR = m_aWatchedResults[nWRIdx];
-			const std::string& sFromChildName = oWR.m_sName;
 			const bool bIsFromChildDir = oWR.m_bIsDir;
+			const int64_t nKey = ToWatchDir::getNameKey(oWR.m_nNameId, bIsFromChildDir);
 			if (bIsFromChildDir) {
-				const auto itFind = std::find_if(aVisitedNames.begin(), aVisitedNames.end(), [&](const ToWatchDir::FileDir& oViFiDi) {
-					return (oViFiDi.m_bIsDir && (oViFiDi.m_sName == sFromChildName));
-				});
-				if (itFind != aVisitedNames.end()) {
-					continue; //for ---
+				if (oVisitedKeys.count(nKey) > 0) {
+					continue; // while ---
 				}
 			}
-			aVisitedNames.push_back({sFromChildName, bIsFromChildDir, false});
+			oVisitedKeys.insert(nKey);
 			if (! oWR.exists()) {
-				continue; //for ---
+				continue; // while ---
 			}
+			const std::string sFromChildName{m_oStringPool.get(oWR.m_nNameId)};
 			// If WR exists from child can't be filtered out
-			const auto sFromChildPath = Util::getPathFromDirAndName(oWR.m_sPath, sFromChildName);
+			const auto sFromChildPath = Util::getPathFromDirAndName(sFromPath, sFromChildName);
 			// make sure destination child isn't filtered out
 			bool bToChildDefined = bToExists;
 			const auto sToChildPathTemp = (bToExists ? Util::getPathFromDirAndName(sToPath, sFromChildName) : m_sES);
@@ -1521,29 +3270,34 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 				}
 			}
 			const std::string& sToChildPath = (bToChildDefined ? sToChildPathTemp : m_sES);
-			traverseRename(nFromTWDIdx, oWR.m_sPath, sFromChildName, sFromChildPath
-							, bIsFromChildDir
-							, (bToChildDefined ? nToTWDIdx : -1)
-							, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath
-							, nNowUsec);
+			oChildFrame.setArgs(nFromTWDIdx, sFromPath, sFromChildName, sFromChildPath
+								, bIsFromChildDir
+								, (bToChildDefined ? nToTWDIdx : -1)
+								, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath);
+			return true; //-----------------------------------------------------
 		}
-		//
-		for (const ToWatchDir::FileDir& oFiDi : oFromTWD.m_aExisting) {
+		oFrame.m_eStage = RENAME_STAGE_EXISTING;
+		oFrame.m_nCurIdx = 0;
+		oFrame.m_nEndIdx = static_cast<int32_t>(oFromTWD.m_aExisting.size());
+	}
+	if (oFrame.m_eStage == RENAME_STAGE_EXISTING) {
+		ToWatchDir& oFromTWD = m_aToWatchDirs[nFromTWDIdx];
+		while (oFrame.m_nCurIdx < oFrame.m_nEndIdx) {
+			const ToWatchDir::FileDir& oFiDi = oFromTWD.m_aExisting[oFrame.m_nCurIdx];
+			++oFrame.m_nCurIdx;
 			if (oFiDi.m_bRemoved) {
-				continue; //for ---
+				continue; // while ---
 			}
-			const std::string& sFromChildName = oFiDi.m_sName;
+			const int32_t nFromChildNameId = oFiDi.m_nNameId;
 			const bool bIsFromChildDir = oFiDi.m_bIsDir;
-			const auto itFind = std::find_if(aVisitedNames.begin(), aVisitedNames.end(), [&](const ToWatchDir::FileDir& oViFiDi) {
-				return ((oViFiDi.m_bIsDir == bIsFromChildDir) && (oViFiDi.m_sName == sFromChildName));
-			});
-			if (itFind != aVisitedNames.end()) {
-				continue; //for ---
+			const bool bInserted = oVisitedKeys.insert(ToWatchDir::getNameKey(nFromChildNameId, bIsFromChildDir)).second;
+			if (! bInserted) {
+				continue; // while ---
 			}
-			aVisitedNames.push_back({sFromChildName, bIsFromChildDir, false});
+			const std::string sFromChildName{m_oStringPool.get(nFromChildNameId)};
 			// make sure the child isn't filtered out in both source and destination
 			bool bFromChildDefined = true;
-			const auto sFromChildPathTemp = Util::getPathFromDirAndName(oFromTWD.m_sPathName, sFromChildName);
+			const auto sFromChildPathTemp = Util::getPathFromDirAndName(sFromPath, sFromChildName);
 			const bool bFromFilteredOut = isFilteredOut(bIsFromChildDir, oFromTWD, sFromChildName, sFromChildPathTemp);
 			if (bFromFilteredOut) {
 				bFromChildDefined = false;
@@ -1558,23 +3312,32 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 					bToChildDefined = false;
 					// Since filtered out a WR won't be created for this name in the destination
 					// so the name must be added to the exising of the destination
-					oToTWD.m_aExisting.push_back({sFromChildName, bIsFromChildDir, false});
+					oToTWD.addExisting(nFromChildNameId, bIsFromChildDir);
 				}
 			}
 			if (! (bFromChildDefined || bToChildDefined)) {
-				continue; //for ---
+				continue; // while ---
 			}
 			const std::string& sFromChildPath = (bFromChildDefined ? sFromChildPathTemp : m_sES);
 			const std::string& sToChildPath = (bToChildDefined ? sToChildPathTemp : m_sES);
-			traverseRename(nFromTWDIdx, oFromTWD.m_sPathName, sFromChildName, sFromChildPath
-							, bIsFromChildDir
-							, (bToChildDefined ? nToTWDIdx : -1)
-							, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath
-							, nNowUsec);
+			oChildFrame.setArgs(nFromTWDIdx, sFromPath, sFromChildName, sFromChildPath
+								, bIsFromChildDir
+								, (bToChildDefined ? nToTWDIdx : -1)
+								, (bToChildDefined ? sToPath : m_sES), (bToChildDefined ? sFromChildName : m_sES), sToChildPath);
+			return true; //-----------------------------------------------------
 		}
-		oFromTWD.m_aExisting.clear();
+		oFrame.m_eStage = RENAME_STAGE_DONE;
+	}
+	return false;
+}
+void FofiModel::traverseRenameLeave(RenameFrame& oFrame, int64_t nNowUsec)
+{
+	if (oFrame.m_bFromExists) {
+		m_aToWatchDirs[oFrame.m_nFromTWDIdx].clearExisting();
+		addRecycleCandidate(oFrame.m_nFromTWDIdx);
 	}
-	if (bToExists) {
+	if (oFrame.m_bToExists) {
+		const int32_t nToTWDIdx = oFrame.m_nToTWDIdx;
 		bool bWatchCreatedNow = false;
 		auto& oToTWD = m_aToWatchDirs[nToTWDIdx];
 		if (! oToTWD.isWatched()) {
@@ -1589,7 +3352,7 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 		// immediately after the rename and shouldn't be part of the rename event
 		// But if renamed from unknown might consider them renamed to files???
 		if (bWatchCreatedNow) {
-			createImmediateChildren(nToTWDIdx, false, nNowUsec, aVisitedNames);
+			createImmediateChildren(nToTWDIdx, false, nNowUsec, oFrame.m_oVisitedKeys);
 		} else {
 			// iwatch was renamed => possible immediate creation of files is caught
 		}
@@ -1597,11 +3360,22 @@ void FofiModel::traverseRename(int32_t nFromParentTWDIdx
 }
 bool FofiModel::onCheckOpenMoves()
 {
+	const auto nNowUsec = Util::getNowTimeMicroseconds() - m_nStartTimeUsec;
 	if (m_aOpenMoves.size() == 0) {
+		// no indexes are held by open moves
+		recycleCandidates();
+		const int32_t nTotNames = m_oStringPool.size() - m_oStringPool.getTotReleased();
+		if (nTotNames >= 2 * std::max(m_nNamesAfterRelease, s_nMinNamesToReleaseUnused)) {
+			// amortized over the names added since the last time
+			releaseUnusedNames();
+		}
+		if (isResultSpill() && (m_nEventCounter > 0) && (nNowUsec >= m_nNextSpillCheckUsec)) {
+			spillInactiveResults(nNowUsec);
+			compactSpillSegment();
+			m_nNextSpillCheckUsec = nNowUsec + std::min(m_nSpillAfterUsec, s_nMaxSpillCheckIntervalUsec);
+		}
 		return true;
 	}
-	const auto nNowUsec = Util::getNowTimeMicroseconds() - m_nStartTimeUsec;
-//std::cout << "onCheckOpenMoves   nNowUsec=" << nNowUsec<< '\n';
 	auto itCurMove = m_aOpenMoves.begin();
 	while (itCurMove != m_aOpenMoves.end()) {
 		if (nNowUsec < itCurMove->m_nMoveFromTimeUsec + s_nOpenMovesFailedAfterUsec) {
@@ -1610,18 +3384,22 @@ bool FofiModel::onCheckOpenMoves()
 		}
 		// moved out of watched area
 		auto& oOpenMove = *itCurMove;
-//std::cout << "onCheckOpenMoves   oOpenMove.m_nParentTWDIdx=" << oOpenMove.m_nParentTWDIdx << '\n';
-//std::cout << "onCheckOpenMoves   oOpenMove.m_sName=" << oOpenMove.m_sName << '\n';
-//std::cout << "onCheckOpenMoves   oOpenMove.m_sPathName=" << oOpenMove.m_sPathName << '\n';
-//std::cout << "onCheckOpenMoves   oOpenMove.m_nRenameCookie=" << oOpenMove.m_nRenameCookie << '\n';
+		if (m_oTraceRing.isEnabled()) {
+			m_oTraceRing.trace(TraceRing::TRACE_EVENT_MOVE_UNPAIRED, oOpenMove.m_nParentTWDIdx, m_oStringPool.find(oOpenMove.m_sName)
+								, oOpenMove.m_nRenameCookie, (oOpenMove.m_bIsDir ? 1 : 0));
+		}
 		if (! oOpenMove.m_bFilteredOut) {
-			const auto& sFromParentPath = m_aToWatchDirs[oOpenMove.m_nParentTWDIdx].m_sPathName;
-			traverseRename(oOpenMove.m_nParentTWDIdx
-							, sFromParentPath, oOpenMove.m_sName, oOpenMove.m_sPathName
-							, oOpenMove.m_bIsDir
-							, -1
-							, "", "", ""
-							, nNowUsec);
+			const auto sFromParentPath = getToWatchDirPath(oOpenMove.m_nParentTWDIdx);
+			try {
+				traverseRename(oOpenMove.m_nParentTWDIdx
+								, sFromParentPath, oOpenMove.m_sName, oOpenMove.m_sPathName
+								, oOpenMove.m_bIsDir
+								, -1
+								, "", "", ""
+								, nNowUsec);
+			} catch (const std::runtime_error& oErr) {
+				emitAbort(oErr.what());
+			}
 		}
 		itCurMove = m_aOpenMoves.erase(itCurMove);
 	}
@@ -1631,42 +3409,120 @@ int32_t FofiModel::findRootResult() const
 {
 	const auto itFind = std::find_if(m_aWatchedResults.begin(), m_aWatchedResults.end(), [&](const WatchedResult& oWR)
 	{
-		return (oWR.m_sPath == "/") && oWR.m_sName.empty();
+		return (! oWR.m_bFree) && (oWR.m_nParentTWDIdx < 0);
 	});
 	if (itFind == m_aWatchedResults.end()) {
 		return -1;
 	}
 	return static_cast<int32_t>(std::distance(m_aWatchedResults.begin(), itFind));
 }
-int32_t FofiModel::findResult(const std::string& sPath, const std::string& sName, bool bIsDir) const
-{
-	const int32_t nTWDIdx = findToWatchDir(sPath);
-	if (nTWDIdx < 0) {
-		return -1;
-	}
-	return findResult(nTWDIdx, sName, bIsDir);
-}
-int32_t FofiModel::findResult(int32_t nTWDIdx, const std::string& sName, bool bIsDir) const
+int32_t FofiModel::findResult(int32_t nTWDIdx, const std::string& sName, bool bIsDir)
 {
 	assert(nTWDIdx >= 0);
 	assert(!sName.empty());
 	const ToWatchDir& oTWD = m_aToWatchDirs[nTWDIdx];
-	const auto& aResultIdxs = oTWD.m_aWatchedResultIdxs;
-	const auto itFind = std::find_if(aResultIdxs.begin(), aResultIdxs.end(), [&](int32_t nResultIdx)
-	{
-		const WatchedResult& oWatchedResult = m_aWatchedResults[nResultIdx];
-		return ((oWatchedResult.m_sName == sName) && (oWatchedResult.m_bIsDir == bIsDir));
-	});
-	if (itFind == aResultIdxs.end()) {
-		return -1;
+	const int32_t nRef = oTWD.findWatchedResultIdx(m_oStringPool.find(sName), bIsDir);
+	if (! isSpilledRef(nRef)) {
+		return nRef; //---------------------------------------------------------
 	}
-	const auto nResultIdx = *itFind;
-	return nResultIdx;
+	return faultInResult(nTWDIdx, m_aSpilledSlots[getSpilledId(nRef)].m_nRefPos);
 }
 const std::deque<FofiModel::WatchedResult>& FofiModel::getWatchedResults() const
 {
 	return m_aWatchedResults;
 }
+std::string FofiModel::forEachWatchedResult(const std::function<void(const WatchedResult&)>& oVisitor) const
+{
+	assert(oVisitor);
+	for (const WatchedResult& oWR : m_aWatchedResults) {
+		if (oWR.m_bFree) {
+			continue; // for ---
+		}
+		oVisitor(oWR);
+	}
+	if (m_nTotSpilledResults == 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	WatchedResult oWR;
+	const int32_t nTotSpilled = static_cast<int32_t>(m_aSpilledSlots.size());
+	for (int32_t nSpilledId = 0; nSpilledId < nTotSpilled; ++nSpilledId) {
+		if (m_aSpilledSlots[nSpilledId].m_nOffset < 0) {
+			// was read back
+			continue; // for ---
+		}
+		if (! readSpilledResult(nSpilledId, oWR)) {
+			const std::string sError = "Could not read spilled result from " + m_oSpillSegment.getPath();
+			return sError; //---------------------------------------------------
+		}
+		oVisitor(oWR);
+	}
+	return "";
+}
+std::string FofiModel::forEachChangedResult(const std::function<void(const WatchedResult&)>& oVisitor) const
+{
+	assert(oVisitor);
+	// a result read back from disk might have been recorded twice
+	auto aKeys = m_aChangedResultKeys;
+	std::sort(aKeys.begin(), aKeys.end());
+	aKeys.erase(std::unique(aKeys.begin(), aKeys.end()), aKeys.end());
+	WatchedResult oSpilledWR;
+	for (const auto& oKey : aKeys) {
+		const int32_t nParentTWDIdx = oKey.first;
+		if (nParentTWDIdx < 0) {
+			const int32_t nRootResultIdx = ((m_nRootResultIdx >= 0) ? m_nRootResultIdx : findRootResult());
+			if (nRootResultIdx >= 0) {
+				oVisitor(m_aWatchedResults[nRootResultIdx]);
+			}
+			continue; // for ---
+		}
+		const ToWatchDir& oTWD = m_aToWatchDirs[nParentTWDIdx];
+		if (oTWD.m_bFree) {
+			continue; // for ---
+		}
+		const auto itFind = oTWD.m_oWatchedResultIdxByKey.find(oKey.second);
+		if (itFind == oTWD.m_oWatchedResultIdxByKey.end()) {
+			// recycled
+			continue; // for ---
+		}
+		const int32_t nRef = itFind->second;
+		if (! isSpilledRef(nRef)) {
+			const WatchedResult& oWR = m_aWatchedResults[nRef];
+			if (! oWR.m_bFree) {
+				oVisitor(oWR);
+			}
+			continue; // for ---
+		}
+		if (! readSpilledResult(getSpilledId(nRef), oSpilledWR)) {
+			const std::string sError = "Could not read spilled result from " + m_oSpillSegment.getPath();
+			return sError; //---------------------------------------------------
+		}
+		oVisitor(oSpilledWR);
+	}
+	return "";
+}
+void FofiModel::checkpoint()
+{
+	++m_nCheckpointGeneration;
+	m_aChangedResultKeys.clear();
+}
+std::string FofiModel::getWatchedResultParentPath(const WatchedResult& oResult) const
+{
+	if (oResult.m_nParentTWDIdx < 0) {
+		return "/"; //----------------------------------------------------------
+	}
+	return getToWatchDirPath(oResult.m_nParentTWDIdx);
+}
+std::string FofiModel::getWatchedResultName(const WatchedResult& oResult) const
+{
+	return m_oStringPool.get(oResult.m_nNameId);
+}
+std::string FofiModel::getActionOtherPath(const ActionData& oAction) const
+{
+	if (oAction.m_nOtherPathId < 0) {
+		return ""; //-----------------------------------------------------------
+	}
+	return m_oStringPool.get(oAction.m_nOtherPathId);
+}
 
 
 } // namespace fofi
@@ -22,14 +22,26 @@
 #define FOFIMON_FOFI_MODEL_H_
 
 #include "inotifiersource.h"
+#include "latencyhistogram.h"
+#include "pathtrie.h"
+#include "scancache.h"
+#include "spillsegment.h"
+#include "stringpool.h"
+#include "tracering.h"
 
 #include <sigc++/signal.h>
 
+#include <array>
 #include <vector>
 #include <string>
+#include <map>
 #include <memory>
+#include <functional>
 #include <regex>
 #include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <iosfwd>
 
 #include <stdint.h>
 
@@ -102,23 +114,36 @@ public:
 		friend class FofiModel;
 		bool m_bMightHaveInvalidDescendants = false;
 	};
+	/** The number of results by type. */
+	struct ResultCounts
+	{
+		int32_t m_nCreated = 0; /**< RESULT_CREATED results. */
+		int32_t m_nDeleted = 0; /**< RESULT_DELETED results. */
+		int32_t m_nModified = 0; /**< RESULT_MODIFIED results. */
+		int32_t m_nTemporary = 0; /**< RESULT_TEMPORARY results. */
+		/** The number of results of any type.
+		 * @return The sum of the counts.
+		 */
+		int32_t getTotal() const { return m_nCreated + m_nDeleted + m_nModified + m_nTemporary; }
+	};
 	/** A watched directory.
+	 * Only the (interned) name is stored, the absolute path is built from the parent chain
+	 * (see FofiModel::getToWatchDirPath()).
 	 */
 	struct ToWatchDir
 	{
-		std::string m_sPathName; /**< The absolute path of the watched directory. */
 		int32_t m_nDepth = 0; /**< The depth relative to DirectoryZone */
 		std::vector<std::string> m_aPinnedSubDirs;
 			/**< Subdirs that are watched despite the filter.
 			 * These include not only those defined in the owner directory zone,
-			 * but also those defined in all other directory zones that cover m_sPath.
+			 * but also those defined in all other directory zones that cover the path.
 			 * In addition all the subfolders that lead to a directory zone base path
 			 * are added.
 			 */
 		std::vector<std::string> m_aPinnedFiles;
 			/**< Files that are watched despite the filter.
 			 * These include not only those defined in the owner directory zone,
-			 * but also those defined in all other directory zones that cover m_sPath.
+			 * but also those defined in all other directory zones that cover the path.
 			 */
 		/** Whether the directory exists.
 		 * @return Whether the directory exists.
@@ -133,43 +158,77 @@ public:
 		 */
 		const std::deque<int32_t>& getToWatchSubDirIdxs() const { return m_aToWatchSubdirIdxs; }
 		/** The parent ToWatchDir.
-		 * @return The index into FofiModel::getToWatchDirectories() of the parent or -1 if m_sPathName is "/" (root).
+		 * @return The index into FofiModel::getToWatchDirectories() of the parent or -1 if root.
 		 */
 		int32_t getParentIdx() const { return m_nParentTWDIdx; }
 		/** The owner directory one.
 		 * @return The index into FofiModel::getDirectoryZones() or -1 if gap filler directory.
 		 */
 		int32_t getOwnerDirectoryZone() const { return m_nIdxOwnerDirectoryZone; }
-		/** The name part of the directory.
-		 * @return The name of m_sPathName or null if root.
-		 */
-		const char* getName() const { return ((m_nNamePos < 0) ? nullptr : m_sPathName.c_str() + m_nNamePos); }
 		/** Whether the directory is a leaf of the zone.
 		 * @return Whether m_nMaxDepth == m_nDepth.
 		 */
 		bool isLeaf() const { return (m_nMaxDepth == m_nDepth); }
+		/** Whether the object was recycled.
+		 * A recycled object is unused (until reused) and must be skipped.
+		 * See FofiModel::setRecycleTemporary().
+		 * @return Whether free.
+		 */
+		bool isFree() const { return m_bFree; }
+		/** The results of the files and subdirectories of the directory by type.
+		 * @return The counts.
+		 */
+		const ResultCounts& getResultCounts() const { return m_oResultCounts; }
+		/** The results of the whole subtree of the directory by type.
+		 * These are getResultCounts() plus the subtree counts of the subdirectories.
+		 * Results in subdirectories that aren't a ToWatchDir are not included.
+		 * @return The counts.
+		 */
+		const ResultCounts& getSubtreeResultCounts() const { return m_oSubtreeResultCounts; }
 	private:
 		friend class FofiModel;
 		struct FileDir
 		{
-			std::string m_sName; /**< The name of the dir or file. Cannot be empty. */
+			int32_t m_nNameId = -1; /**< The id of the name of the dir or file in FofiModel::m_oStringPool. */
 			bool m_bIsDir = false; /**< Whether a dir or file. Default: false. */
 			bool m_bRemoved = false; /**< Set to false when removed. Default: false. */
 		};
-		std::deque<FileDir>::iterator findInExisting(bool bIsDir, const std::string& sName);
+		// The key used by the name indexes, formed by the name id and the dir flag.
+		static int64_t getNameKey(int32_t nNameId, bool bIsDir);
+		// The name ids are from FofiModel::m_oStringPool, -1 (never interned) is never found
+		void addSubDirIdx(int32_t nSubDirTWDIdx, int32_t nNameId);
+		// returns the index into m_aToWatchDirs or -1
+		int32_t findSubDirIdx(int32_t nNameId) const;
+		// returns the position of the index in m_aWatchedResultIdxs
+		int32_t addWatchedResultIdx(int32_t nResultIdx, int32_t nNameId, bool bIsDir);
+		// returns the index into m_aWatchedResults, a spilled reference (see FofiModel::isSpilledRef()) or -1
+		int32_t findWatchedResultIdx(int32_t nNameId, bool bIsDir) const;
+		void addExisting(int32_t nNameId, bool bIsDir);
+		void clearExisting();
+		std::deque<FileDir>::iterator findInExisting(bool bIsDir, int32_t nNameId);
 	private:
-		int32_t m_nNamePos = -1; // within m_sPathName. -1 if root.
+		int32_t m_nNameId = -1; // The id of the last component of the path in FofiModel::m_oStringPool. -1 if root.
 		int32_t m_nIdxOwnerDirectoryZone = -1; // The directory zone from which this was generated or -1 (gap filler)
-		int32_t m_nParentTWDIdx = -1; // The parent: -1 if m_sPath == "/"
+		int32_t m_nParentTWDIdx = -1; // The parent: -1 if root
 		bool m_bExists = false; // Whether the dir exists
 		int32_t m_nWatchedIdx = -1; // The INotifierSource watched index, -1 if not watched
 		int32_t m_nMaxDepth = 0; /**< The max depth of watched directories relative to the path. If 0 just the path itself. */
 		std::deque<int32_t> m_aToWatchSubdirIdxs; /**< Indexes into m_aToWatchDirs for faster access. */
 		std::vector<int32_t> m_aWatchedResultIdxs; /**< Indexes into m_aWatchedResults for faster access.
-												 * Files and subdirs that already where modified. */
+												 * Files and subdirs that already where modified.
+												 * Spilled results have a spilled reference instead. */
 		std::deque<FileDir> m_aExisting; /**< Names of files or (sub)directories that existed at startup.
 											 * Once a WatchedResult is created the name is removed.
 											 * A name can be removed in that it is set to empty.*/
+		std::unordered_map<int32_t, int32_t> m_oSubDirIdxByName; // Key: subdir name id, Value: index into m_aToWatchDirs
+		std::unordered_map<int64_t, int32_t> m_oWatchedResultIdxByKey; // Key: getNameKey(), Value: index into m_aWatchedResults or spilled reference
+		ResultCounts m_oResultCounts; // Updated when the type of a child result changes
+		ResultCounts m_oSubtreeResultCounts; // Updated along the parent chain, O(depth)
+		std::unordered_multimap<int64_t, int32_t> m_oExistingIdxsByKey; // Key: getNameKey(), Value: index into m_aExisting
+		bool m_bFree = false; // Whether the index is in FofiModel::m_aFreeToWatchDirIdxs
+		int32_t m_nGeneration = 0; // Incremented each time the object is recycled
+		bool m_bRecycleCandidate = false; // Whether in FofiModel::m_aRecycleCandidates
+		bool m_bSubDirsToCompact = false; // Whether m_aToWatchSubdirIdxs might contain recycled subdirs
 	};
 	/** Add directory zone.
 	 * The base path of the directory zone must not already be used by an already added
@@ -190,11 +249,24 @@ public:
 	 *     file "/A/B/C/f1.txt" belongs to DZ2.
 	 *     file "/A/B/C/D/E/f3.txt" belongs to no directory zone, because DZ2
 	 *       is closer to it and shadows DZ1.
+	 *
+	 * Can also be called while watching. Only the subtree of the base path
+	 * is then scanned and watched, the results are kept. The names that already
+	 * exist when the zone is added are treated as if they existed at start.
+	 * If an error is returned while watching (ex. the limit of watched
+	 * directories was reached) the zone was added but might be only partially watched.
 	 * @param oDirectoryZone The directory zone to add.
 	 * @return Empty string or error.
 	 */
 	std::string addDirectoryZone(DirectoryZone&& oDirectoryZone);
-
+	/** Remove a directory zone.
+	 * Can also be called while watching. The inotify watches of the directories
+	 * that are no longer within a zone and aren't needed to reach another zone or
+	 * file are removed, the directories within an enclosing zone are taken over by it.
+	 * The results are kept. Note that while watching the remaining zones might be reordered.
+	 * @param sPath The base path of the zone.
+	 * @return Empty string or error.
+	 */
 	std::string removeDirectoryZone(const std::string& sPath);
 	const std::vector<DirectoryZone>& getDirectoryZones() const;
 	bool hasDirectoryZone(const std::string& sPath) const;
@@ -204,10 +276,17 @@ public:
 	 *
 	 * An inotify watch isn't added for the file but the containing dir (if existing)
 	 * is, even if it doesn't belong to a directory zone.
+	 *
+	 * Can also be called while watching, see addDirectoryZone().
 	 * @param sPath The path of the file to watch. Cannot be empty.
 	 * @return Empty string or error.
 	 */
 	std::string addToWatchFile(const std::string& sPath);
+	/** Remove a single file to watch.
+	 * Can also be called while watching, see removeDirectoryZone().
+	 * @param sPath The path of the file.
+	 * @return Empty string or error.
+	 */
 	std::string removeToWatchFile(const std::string& sPath);
 	const std::vector<std::string>& getToWatchFiles() const;
 	bool hasToWatchFile(const std::string& sPath) const;
@@ -236,6 +315,12 @@ public:
 	 * @return The root index or -1 if calcToWatchDirectories() wasn't called.
 	 */
 	int32_t getRootToWatchDirectoriesIdx() const;
+	/** The absolute path of a watched directory.
+	 * The path is built from the names of the directory and its ancestors.
+	 * @param nTWDIdx The index into getToWatchDirectories().
+	 * @return The path.
+	 */
+	std::string getToWatchDirPath(int32_t nTWDIdx) const;
 
 	/** Start watching the directory zones and files for modifications.
 	 * Resets all the data of the last run.
@@ -246,6 +331,35 @@ public:
 	 * Must be called after a successful call of start().
 	 */
 	void stop();
+	/** Saves the state of the model to a file.
+	 * The file contains the zones and files, the watched directories with the names
+	 * that existed at start, all the results (also the spilled ones) and the duration
+	 * of the session. It can be passed to resume() to continue the session
+	 * after a restart of the program without scanning all the zones again.
+	 *
+	 * Can be called while watching or after stop(), but start() or resume() must
+	 * have been called at least once.
+	 * @param sPathName The file path. The data is written to a temporary file in the
+	 *                  same directory which then replaces the file.
+	 * @return Empty string or error.
+	 */
+	std::string saveSnapshot(const std::string& sPathName) const;
+	/** Start watching continuing the session saved with saveSnapshot().
+	 * Instead of scanning the zones the watched directories and the names
+	 * that existed at the start of the saved session are restored from the file
+	 * and the inotify watches registered again. Only the directories the
+	 * modification time of which changed since the snapshot was saved are scanned,
+	 * the names that appeared or disappeared in the meantime are added as results.
+	 * Changes to the contents of files while not watching aren't detected.
+	 *
+	 * The directory zones (base paths and max depths) and the files must be
+	 * the same as when the snapshot was saved. The time during which the
+	 * program wasn't watching is not included in getDuration() and in the
+	 * times of the actions.
+	 * @param sPathName The snapshot file.
+	 * @return Empty string or error. If error the model isn't watching.
+	 */
+	std::string resume(const std::string& sPathName);
 	/** The duration in microseconds.
 	 * If still watching the elapsed time since start() otherwise the duration of
 	 * the last run.
@@ -256,6 +370,103 @@ public:
 	 * @return true if started and not stopeed yet.
 	 */
 	bool isWatching() const { return (m_nEventCounter > 0); }
+	/** Whether temporary results and the deleted directories containing them are recycled.
+	 * When set, while watching, RESULT_TEMPORARY results and the ToWatchDir objects
+	 * of deleted directories that are left with neither results nor subdirectories
+	 * are periodically reclaimed and their slots reused. This keeps memory bounded
+	 * when the same directories are repeatedly created and deleted during a long
+	 * session, but the temporary results are lost and a recreated name starts with
+	 * a new result with a fresh history of actions.
+	 *
+	 * Recycled objects stay in getToWatchDirectories() and getWatchedResults()
+	 * marked as free (see ToWatchDir::isFree() and WatchedResult::isFree()).
+	 * Only directories without inotify watch are recycled, so no event can
+	 * refer to a recycled index.
+	 *
+	 * Default: false.
+	 * @param bRecycle Whether to recycle.
+	 */
+	void setRecycleTemporary(bool bRecycle) { m_bRecycleTemporary = bRecycle; }
+	/** Whether temporary results are recycled.
+	 * @return Whether recycling.
+	 */
+	bool isRecycleTemporary() const { return m_bRecycleTemporary; }
+	/** Sets the spilling of inactive results to disk.
+	 * When set, while watching, the results that weren't modified for at least
+	 * the given interval are periodically appended to a file in the spill directory
+	 * and removed from memory. A spilled result is read back as soon as an event
+	 * refers to it again. If it can't be read back m_oAbortSignal is emitted and
+	 * the result stays on disk. This keeps the memory used by the results of a long
+	 * session proportional to the active files rather than to all the files
+	 * that were ever modified.
+	 *
+	 * Spilled results are not in getWatchedResults(), use forEachWatchedResult()
+	 * to visit all of them. The spill file is created by start() and deleted
+	 * by the next start() or when the model is destroyed.
+	 *
+	 * Cannot be called while watching.
+	 * @param sSpillDir The directory in which the spill file is created. If empty results aren't spilled (default).
+	 * @param nSpillAfterUsec The inactivity interval in microseconds after which a result is spilled. Must be positive.
+	 */
+	void setResultSpill(const std::string& sSpillDir, int64_t nSpillAfterUsec);
+	/** Whether inactive results are spilled to disk.
+	 * @return Whether spilling.
+	 */
+	bool isResultSpill() const { return ! m_sSpillDir.empty(); }
+	/** The number of results currently on disk.
+	 * @return The number of spilled results.
+	 */
+	int32_t getTotSpilledResults() const { return m_nTotSpilledResults; }
+	/** The size of the spill file.
+	 * Includes the records of the results read back since the file was last compacted.
+	 * @return The size in bytes or 0 if not spilling.
+	 */
+	int64_t getSpillFileSize() const { return m_oSpillSegment.size(); }
+	/** The number of distinct names and paths in memory.
+	 * The names no longer used by any object are released from time to time.
+	 * @return The number of names.
+	 */
+	int32_t getTotNames() const { return m_oStringPool.size() - m_oStringPool.getTotReleased(); }
+	/** Sets how the history of actions of a result is compacted.
+	 * Files that are modified all the time (ex. logs) can accumulate a huge number of
+	 * actions during a long session.
+	 *
+	 * If collapsing, an action identical to the last action of a result (same type,
+	 * other path and flags) isn't added, instead the count of the last action is
+	 * incremented and its last time updated (see ActionData::m_nCount).
+	 *
+	 * If nMaxActions is positive only the most recent actions of a result are kept.
+	 * The number of discarded actions is in WatchedResult::m_nDroppedActions.
+	 *
+	 * Cannot be called while watching.
+	 * @param bCollapseRuns Whether to collapse consecutive identical actions. Default: false.
+	 * @param nMaxActions The max number of actions kept per result or 0 if unlimited (default). Must be &gt;= 0.
+	 */
+	void setActionCompaction(bool bCollapseRuns, int32_t nMaxActions);
+	/** Whether consecutive identical actions are collapsed.
+	 * @return Whether collapsing.
+	 */
+	bool isCollapseActions() const { return m_bCollapseActions; }
+	/** The max number of actions kept per result.
+	 * @return The max or 0 if unlimited.
+	 */
+	int32_t getMaxActions() const { return m_nMaxActions; }
+	/** Sets the file in which the directory listings of the initial scan are cached.
+	 * When set, calcToWatchDirectories() and start() read the directory only
+	 * if its modification or change time (or its inode) differ from those
+	 * in the cache, and update the file afterwards. A missing, stale or
+	 * corrupt file is ignored.
+	 *
+	 * Cannot be called while watching.
+	 * @param sPathName The cache file or empty if no cache is used (default).
+	 */
+	void setScanCache(const std::string& sPathName);
+	/** The number of directory listings of the last initial scan that were taken from the cache.
+	 * See setScanCache(). Note that the initial scan might need the listing of a
+	 * directory more than once.
+	 * @return The number of cached listings used.
+	 */
+	int32_t getTotCachedScans() const { return m_nTotCachedScans; }
 
 	enum RESULT_TYPE
 	{
@@ -268,33 +479,189 @@ public:
 	struct ActionData
 	{
 		INotifierSource::FOFI_ACTION m_eAction = INotifierSource::FOFI_ACTION_INVALID;
-		std::string m_sOtherPath; /**< Used for FOFI_ACTION_RENAME_FROM and FOFI_ACTION_RENAME_TO. */
 		bool m_bImmediate = false; /**< True if action created manually (ex. by scanning a dir) or false if from inotify. Default: false. */
 		bool m_bCausedByAttribChange = false; /**< Default: false. */
-		int64_t m_nTimeUsec = 0; /**< Microseconds from start of watching. */
+		int64_t m_nTimeUsec = 0; /**< Microseconds from start of watching. If collapsed the time of the first action. */
+		int64_t m_nLastTimeUsec = 0; /**< The time of the last of the collapsed actions. If m_nCount is 1 same as m_nTimeUsec. */
+		int32_t m_nCount = 1; /**< The number of identical consecutive actions represented by this object.
+								 * See FofiModel::setActionCompaction(). Default: 1. */
+	private:
+		friend class FofiModel;
+		int32_t m_nOtherPathId = -1; // The id in FofiModel::m_oStringPool of the other path of
+									// FOFI_ACTION_RENAME_FROM and FOFI_ACTION_RENAME_TO or -1 if unknown
+	};
+	/** The actions of a result, oldest first.
+	 * A ring buffer so that when FofiModel::getMaxActions() is reached the
+	 * oldest action is replaced by the new one without shifting the others.
+	 * Can be used like a read-only std::vector.
+	 */
+	class ActionRing
+	{
+	public:
+		class const_iterator
+		{
+		public:
+			const_iterator(const ActionRing* p0Ring, int32_t nIdx) : m_p0Ring(p0Ring), m_nIdx(nIdx) {}
+			const ActionData& operator*() const { return (*m_p0Ring)[m_nIdx]; }
+			const ActionData* operator->() const { return &(*m_p0Ring)[m_nIdx]; }
+			const_iterator& operator++() { ++m_nIdx; return *this; }
+			bool operator==(const const_iterator& oOther) const { return (m_nIdx == oOther.m_nIdx); }
+			bool operator!=(const const_iterator& oOther) const { return (m_nIdx != oOther.m_nIdx); }
+		private:
+			const ActionRing* m_p0Ring;
+			int32_t m_nIdx;
+		};
+
+		int32_t size() const { return static_cast<int32_t>(m_aData.size()); }
+		bool empty() const { return m_aData.empty(); }
+		size_t capacity() const { return m_aData.capacity(); }
+		/** The action at a position.
+		 * @param nIdx The position from the oldest. Must be &gt;= 0 and &lt; size().
+		 * @return The action.
+		 */
+		const ActionData& operator[](int32_t nIdx) const { return m_aData[getDataIdx(nIdx)]; }
+		const ActionData& front() const { return (*this)[0]; }
+		const ActionData& back() const { return (*this)[size() - 1]; }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, size()); }
+	private:
+		friend class FofiModel;
+		ActionData& get(int32_t nIdx) { return m_aData[getDataIdx(nIdx)]; }
+		ActionData& getBack() { return get(size() - 1); }
+		int32_t getDataIdx(int32_t nIdx) const
+		{
+			const int32_t nDataIdx = m_nOldest + nIdx;
+			return ((nDataIdx >= size()) ? nDataIdx - size() : nDataIdx);
+		}
+		// Moves the oldest to the first position of m_aData
+		void straighten();
+		// Appends a default action
+		ActionData& pushBack();
+		// Removes the oldest
+		void popFront();
+		// The oldest becomes a default action that is the newest
+		ActionData& recycleFront();
+		// The actions are in order in m_aData afterwards
+		void resize(int32_t nSize);
+	private:
+		std::vector<ActionData> m_aData;
+		int32_t m_nOldest = 0; // The index into m_aData of the oldest action
 	};
 	/** The modified file or directory class.
 	 * Note: during the watching a file could be removed and a directory with the
-	 * same name created, so the key is formed by the pair (m_sPath + "/" + m_sName, m_bIsDir)
+	 * same name created, so the key is formed by the triple (parent, name, m_bIsDir).
+	 * The name and the parent path can be obtained with FofiModel::getWatchedResultName()
+	 * and FofiModel::getWatchedResultParentPath().
 	 */
 	struct WatchedResult
 	{
 		RESULT_TYPE m_eResultType = RESULT_NONE; /**< The current state of the file or dir. */
-		std::string m_sPath; /**< The parent path of the file or directory. */
-		std::string m_sName; /**< The name of the file or directory. If m_sPath is "/" then this is empty. Otherwise not empty. */
-		bool m_bIsDir = false; /**< Whether m_sName is a directory. */
+		bool m_bIsDir = false; /**< Whether the result is a directory. */
 		bool m_bInconsistent = false; /**< Whether the file or dir state might be inaccurate. */
-		std::vector<ActionData> m_aActions; /**< The actions performed on the file or direcory. */
+		ActionRing m_aActions; /**< The actions performed on the file or direcory. */
+		int64_t m_nDroppedActions = 0; /**< The number of oldest actions that were discarded to keep
+										 * at most FofiModel::getMaxActions() in m_aActions. */
+		/** The parent directory.
+		 * @return The index into FofiModel::getToWatchDirectories() of the parent or -1 if the root directory.
+		 */
+		int32_t getParentIdx() const { return m_nParentTWDIdx; }
+		/** Whether the object was recycled.
+		 * A recycled object is unused (until reused) and must be skipped.
+		 * See FofiModel::setRecycleTemporary().
+		 * @return Whether free.
+		 */
+		bool isFree() const { return m_bFree; }
+		/** The checkpoint generation in which the result last changed.
+		 * See FofiModel::forEachChangedResult().
+		 * @return The generation or 0 if unknown (not changed since start() or read back from disk).
+		 */
+		int64_t getChangeGeneration() const { return m_nChangeGeneration; }
 	private:
 		friend class FofiModel;
+		int64_t m_nChangeGeneration = 0;
+		int32_t m_nParentTWDIdx = -1; // The parent ToWatchDir: -1 if the root directory
+		int32_t m_nNameId = -1; // The id of the name in FofiModel::m_oStringPool. The name is empty if the root directory.
+		int32_t m_nRefPos = -1; // The position in ToWatchDir::m_aWatchedResultIdxs of the parent, -1 if the root directory
+		// The list of the results that can be spilled (see FofiModel::m_nOldestActiveIdx)
+		int32_t m_nOlderActiveIdx = -1; // The result modified before this one or -1
+		int32_t m_nNewerActiveIdx = -1; // The result modified after this one or -1
+		bool m_bActive = false; // Whether in the list
 		bool existedAtStart() const { return (m_eResultType == RESULT_DELETED) || (m_eResultType == RESULT_MODIFIED); }
 		bool exists() const { return (m_eResultType == RESULT_CREATED) || (m_eResultType == RESULT_MODIFIED); }
 		bool immediate() const { return ((! m_aActions.empty()) && (m_aActions.back().m_bImmediate)); }
+		bool m_bFree = false; // Whether the index is in FofiModel::m_aFreeWatchedResultIdxs
 	};
-	/** The files and directories that where modified.
+	/** The files and directories that where modified and are in memory.
+	 * Results for which WatchedResult::isFree() is true must be skipped.
+	 * If results are spilled (see setResultSpill()) use forEachWatchedResult().
 	 * @return The read-only result objects.
 	 */
 	const std::deque<WatchedResult>& getWatchedResults() const;
+	/** Visits all the files and directories that where modified.
+	 * First the results in memory (except the free ones) are visited, then
+	 * those that are spilled to disk, which are read one at a time.
+	 * The reference passed to the visitor is only valid during the call.
+	 *
+	 * Can also be called after stop().
+	 * @param oVisitor The visitor. Cannot be null. Must not modify the model.
+	 * @return Empty string or error if a spilled result couldn't be read.
+	 */
+	std::string forEachWatchedResult(const std::function<void(const WatchedResult&)>& oVisitor) const;
+	/** Visits the files and directories that changed since the last checkpoint().
+	 * A result changes when an action is added to it (or the count of its last
+	 * action is incremented, see setActionCompaction()) or when it becomes inconsistent.
+	 * The cost is proportional to the number of changed results rather than to
+	 * all the results. Changed results that were spilled to disk are read one at
+	 * a time, recycled ones are not visited. The results restored from a snapshot
+	 * only count as changed once they are modified again.
+	 * The reference passed to the visitor is only valid during the call.
+	 *
+	 * Can also be called after stop().
+	 * @param oVisitor The visitor. Cannot be null. Must not modify the model.
+	 * @return Empty string or error if a spilled result couldn't be read.
+	 */
+	std::string forEachChangedResult(const std::function<void(const WatchedResult&)>& oVisitor) const;
+	/** Starts a new checkpoint generation.
+	 * The results changed so far are no longer visited by forEachChangedResult().
+	 * Can also be called after stop().
+	 */
+	void checkpoint();
+	/** The current checkpoint generation.
+	 * It is 1 after start() and incremented by checkpoint().
+	 * @return The generation.
+	 */
+	int64_t getCheckpointGeneration() const { return m_nCheckpointGeneration; }
+	/** Whether results changed since the last checkpoint().
+	 * @return Whether forEachChangedResult() might visit results.
+	 */
+	bool hasChangedResults() const { return ! m_aChangedResultKeys.empty(); }
+	/** The number of results by type.
+	 * Includes the root directory result.
+	 * For the counts of a directory's subtree see ToWatchDir::getSubtreeResultCounts().
+	 * @return The counts.
+	 */
+	const ResultCounts& getTotalResultCounts() const { return m_oTotalResultCounts; }
+	/** The parent path of a result.
+	 * @param oResult The result. Must be one of getWatchedResults() or visited by forEachWatchedResult().
+	 * @return The absolute path of the parent directory or "/" if the result is the root directory.
+	 */
+	std::string getWatchedResultParentPath(const WatchedResult& oResult) const;
+	/** The name of a result.
+	 * @param oResult The result. Must be one of getWatchedResults() or visited by forEachWatchedResult().
+	 * @return The name of the file or directory or empty if the result is the root directory.
+	 */
+	std::string getWatchedResultName(const WatchedResult& oResult) const;
+	/** The name of a result without copying it.
+	 * @param oResult The result. Must be one of getWatchedResults() or visited by forEachWatchedResult().
+	 * @return The null terminated name. Valid until the next start().
+	 */
+	const char* getWatchedResultNamePtr(const WatchedResult& oResult) const { return m_oStringPool.get(oResult.m_nNameId); }
+	/** The other path of a rename action.
+	 * @param oAction The action. Must be one of a result of getWatchedResults().
+	 * @return The path renamed to (FOFI_ACTION_RENAME_FROM) or from (FOFI_ACTION_RENAME_TO)
+	 *         or empty if unknown or not a rename.
+	 */
+	std::string getActionOtherPath(const ActionData& oAction) const;
 	/** Whether the result data might be inconsistent.
 	 * @return Whether to trust the results.
 	 */
@@ -304,6 +671,85 @@ public:
 	 * @return Whether to trust the results.
 	 */
 	bool hasQueueOverflown() const { return m_bOverflow; }
+	enum LATENCY_STAGE {
+		LATENCY_STAGE_QUEUED = 0 /**< From the read() of an inotify event to the start of its processing. */
+		, LATENCY_STAGE_PROCESSED = 1 /**< From the start of the processing of an event to a m_oWatchedResultActionSignal emission. */
+		, LATENCY_STAGE_EMITTED = 2 /**< From the read() of an inotify event to a m_oWatchedResultActionSignal emission. */
+	};
+	static constexpr int32_t s_nTotLatencyStages = 3;
+	static constexpr int32_t s_nTotEventActions = 6; /**< The actions from FOFI_ACTION_CREATE to FOFI_ACTION_RENAME_TO. */
+	/** Sets whether the latencies of the inotify events are recorded.
+	 * Recording takes a couple of clock readings per event.
+	 * Can be called while watching.
+	 * @param bTrack Whether to record. Default: true.
+	 */
+	void setLatencyTracking(bool bTrack) { m_bTrackLatencies = bTrack; }
+	/** Whether the latencies of the inotify events are recorded.
+	 * @return Whether recording.
+	 */
+	bool isLatencyTracking() const { return m_bTrackLatencies; }
+	/** The latencies of the inotify events of an action type.
+	 * If an event causes more than one m_oWatchedResultActionSignal emission, a value
+	 * is recorded for each of them in the LATENCY_STAGE_PROCESSED and LATENCY_STAGE_EMITTED
+	 * histograms. The emissions not caused by an inotify event (ex. the rename timeouts
+	 * or the resync of resume()) aren't recorded.
+	 *
+	 * The histograms are cleared by start() and resume().
+	 * @param eAction The action. Cannot be FOFI_ACTION_INVALID.
+	 * @param eStage The stage.
+	 * @return The histogram.
+	 */
+	const LatencyHistogram& getLatencyHistogram(INotifierSource::FOFI_ACTION eAction, LATENCY_STAGE eStage) const;
+	/** The counters and sizes of the model and its source.
+	 * The counters are reset by start() and resume().
+	 */
+	struct Metrics
+	{
+		std::array<int64_t, s_nTotEventActions> m_aTotEvents{}; /**< The inotify events received. Index: INotifierSource::FOFI_ACTION. */
+		int64_t m_nTotFilteredOutEvents = 0; /**< The events about files or dirs excluded by the filters. */
+		int64_t m_nTotOverflows = 0; /**< The times the inotify queue did overflow. */
+		int64_t m_nTotReads = 0; /**< The reads from inotify (since the source was created). */
+		int64_t m_nTotReadEvents = 0; /**< The events read from inotify (since the source was created). */
+		int32_t m_nTotWatches = 0; /**< The active inotify watches. */
+		std::map<int32_t, int64_t> m_oFailedWatches; /**< Key: errno, Value: the number of watches that could not be added. */
+		int32_t m_nTotToWatchDirs = 0; /**< The ToWatchDir objects in use (not free). */
+		int32_t m_nTotExistingToWatchDirs = 0; /**< The ToWatchDir objects whose directory exists. */
+		int32_t m_nTotResults = 0; /**< The results in memory (not free). */
+		int32_t m_nTotSpilledResults = 0; /**< The results spilled to disk. */
+		int64_t m_nSpillFileBytes = 0; /**< The size of the spill file. */
+		int32_t m_nTotOpenMoves = 0; /**< The renames waiting for their counterpart. */
+		int64_t m_nModelBytes = 0; /**< Estimate of the heap memory used by the model. */
+		int64_t m_nPeakResidentBytes = 0; /**< The maximum resident set size of the process. */
+		int64_t m_nSetupCpuUsec = 0; /**< The process CPU time (user + system) used by the last start() or resume(). */
+		int64_t m_nWatchCpuUsec = 0; /**< The process CPU time used while watching after the setup. */
+		int64_t m_nSnapshotCpuUsec = 0; /**< The process CPU time used by the last saveSnapshot(). */
+	};
+	/** Collects the metrics.
+	 * Takes time proportional to the number of ToWatchDir and results
+	 * because of the memory estimate.
+	 * @return The metrics.
+	 */
+	Metrics getMetrics() const;
+	/** Sets the number of records kept by the trace ring.
+	 * The ring records what the model does (events, results, inconsistencies,
+	 * watches) for post-mortem analysis. Removes the current records.
+	 * Can be called while watching.
+	 * @param nTotRecords The number of records or 0 to disable tracing (default).
+	 */
+	void setTraceCapacity(int32_t nTotRecords) { m_oTraceRing.setCapacity(nTotRecords); }
+	/** The trace ring.
+	 * Unlike the other data it is not cleared by start() and resume().
+	 * @return The ring.
+	 */
+	const TraceRing& getTraceRing() const { return m_oTraceRing; }
+	/** The content of the trace ring with the names and directory paths its records refer to.
+	 * Only the ids of the records since the last start or resume are resolved, since
+	 * the names of older runs are discarded. The directory path is the current one,
+	 * which might differ from the path at the time of a record if the directory was renamed.
+	 * @param sReason Why the dump is created.
+	 * @return The dump. Can be written with TraceRing::save().
+	 */
+	TraceRing::Dump getTraceDump(const std::string& sReason) const;
 	/* Emits when watched result is created has changes type. */
 	sigc::signal<void, const WatchedResult&> m_oWatchedResultActionSignal;
 	/** Abort request signal. The listener should call stop immediately.
@@ -325,18 +771,159 @@ private:
 		int64_t m_nMoveFromTimeUsec; /**< When the move from was received in microseconds. */
 		bool m_bFilteredOut = false; /**< The move from must not be watched. */
 	};
+	enum RENAME_STAGE
+	{
+		RENAME_STAGE_SUB_DIRS = 0
+		, RENAME_STAGE_RESULTS = 1
+		, RENAME_STAGE_EXISTING = 2
+		, RENAME_STAGE_DONE = 3
+	};
+	/** A directory (or file) being traversed by traverseRename(). */
+	struct RenameFrame
+	{
+		void setArgs(int32_t nFromParentTWDIdx
+					, const std::string& sFromParentPath, const std::string& sFromName, const std::string& sFromPath
+					, bool bIsDir
+					, int32_t nToParentTWDIdx
+					, const std::string& sToParentPath, const std::string& sToName, const std::string& sToPath);
+		// The arguments (see traverseRename())
+		int32_t m_nFromParentTWDIdx = -1;
+		std::string m_sFromParentPath;
+		std::string m_sFromName;
+		std::string m_sFromPath;
+		bool m_bIsDir = false;
+		int32_t m_nToParentTWDIdx = -1;
+		std::string m_sToParentPath;
+		std::string m_sToName;
+		std::string m_sToPath;
+		// The state of the traversal of the children
+		int32_t m_nFromTWDIdx = -1;
+		bool m_bFromExists = false;
+		int32_t m_nToTWDIdx = -1;
+		bool m_bToExists = false;
+		RENAME_STAGE m_eStage = RENAME_STAGE_DONE;
+		int32_t m_nCurIdx = 0; /**< The index of the next child in the container of the current stage. */
+		int32_t m_nEndIdx = 0; /**< The size of the container when the stage was started. */
+		int32_t m_nVisitingFromChildTWDIdx = -1; /**< The subdir that is set to not exist once traversed or -1. */
+		std::unordered_set<int64_t> m_oVisitedKeys; /**< The ToWatchDir::getNameKey() of the visited children. */
+	};
+	/** A ToWatchDir that might be recyclable. */
+	struct RecycleCandidate
+	{
+		int32_t m_nTWDIdx = -1;
+		int32_t m_nGeneration = 0; /**< The generation when added, if it differs the slot was already recycled. */
+	};
+	/** The fixed size part of a spilled WatchedResult record.
+	 * It is followed by m_nTotActions SpilledAction. */
+	struct SpilledResult
+	{
+		int64_t m_nDroppedActions;
+		int32_t m_nParentTWDIdx;
+		int32_t m_nNameId;
+		int32_t m_nTotActions;
+		uint8_t m_nResultType;
+		uint8_t m_nIsDir;
+		uint8_t m_nInconsistent;
+		uint8_t m_nPadding;
+	};
+	/** Where a spilled result is. Index: spilled id. */
+	struct SpilledSlot
+	{
+		int64_t m_nOffset = -1; /**< The offset into m_oSpillSegment or -1 if read back (the id is free). */
+		int32_t m_nSize = 0; /**< The size of the record in bytes. */
+		int32_t m_nRefPos = -1; /**< The position of the spilled reference in ToWatchDir::m_aWatchedResultIdxs. */
+	};
+	struct SpilledAction
+	{
+		int64_t m_nTimeUsec;
+		int64_t m_nLastTimeUsec;
+		int32_t m_nCount;
+		int32_t m_nOtherPathId;
+		uint8_t m_nAction;
+		uint8_t m_nImmediate;
+		uint8_t m_nCausedByAttribChange;
+		uint8_t m_nPadding;
+	};
+	/** The beginning of a snapshot file.
+	 * It is followed by sequential records in this order: the strings of
+	 * m_oStringPool, the zones (path and int32_t max depth), the file paths,
+	 * the ToWatchDir and the results (a SpilledResult followed by its
+	 * SpilledAction records).
+	 * A string is stored as its int32_t size followed by the characters,
+	 * a released id of the pool as size -1.
+	 * The file ends with the uint64_t checksum (see Util::updateChecksum()) of all the data before it.
+	 * The data is in native byte order, snapshots aren't portable. */
+	struct SnapshotHeader
+	{
+		char m_aMagic[8];
+		int32_t m_nVersion;
+		int32_t m_nFlags;
+		int64_t m_nDurationUsec;
+		int32_t m_nTotPoolStrings;
+		int32_t m_nTotZones;
+		int32_t m_nTotFiles;
+		int32_t m_nTotTWDs;
+		int32_t m_nRootTWDIdx;
+		int32_t m_nTotResults;
+	};
+	/** A ToWatchDir record.
+	 * It is followed by m_nTotPinnedSubDirs + m_nTotPinnedFiles strings
+	 * and m_nTotExisting SnapshotExisting records. */
+	struct SnapshotTWD
+	{
+		int64_t m_nMTimeNsec; // 0 if not watched
+		int32_t m_nNameId;
+		int32_t m_nParentTWDIdx;
+		int32_t m_nIdxOwnerDirectoryZone;
+		int32_t m_nDepth;
+		int32_t m_nMaxDepth;
+		int32_t m_nTotPinnedSubDirs;
+		int32_t m_nTotPinnedFiles;
+		int32_t m_nTotExisting;
+		uint8_t m_nExists;
+		uint8_t m_nWatched;
+		uint8_t m_nFree;
+		uint8_t m_nPadding;
+	};
+	struct SnapshotExisting
+	{
+		int32_t m_nNameId;
+		uint8_t m_nIsDir;
+		uint8_t m_nRemoved;
+		uint8_t m_nPadding[2];
+	};
 	int32_t findDirectoryZone(const std::string& sPath) const;
+	// orders the zones by path and rebuilds m_oDirectoryZoneTrie
+	void sortDirectoryZones();
+	// must be called whenever the indexes of m_aDirectoryZones change
+	void rebuildDirectoryZoneTrie();
+	// Removes the zone while watching by moving the last zone into its slot
+	void eraseDirectoryZoneWatching(int32_t nDZIdx);
 	int32_t findToWatchDir(const std::string& sPath) const;
 	int32_t findToWatchDir(int32_t nParentTWDIdx, const std::string& sPathName) const;
 	int32_t findToWatchFile(const std::string& sPath) const;
-	int32_t findResult(const std::string& sPath, const std::string& sName, bool bIsDir) const;
-	int32_t findResult(int32_t nTWDIdx, const std::string& sName, bool bIsDir) const;
+	// Reads the result back if it was spilled
+	// throws Could not read spilled result
+	int32_t findResult(int32_t nTWDIdx, const std::string& sName, bool bIsDir);
 	int32_t findRootResult() const;
-	void setDirectoryZone(ToWatchDir& oToWatch);
+	// sPath is the path of oToWatch, which might not be linked to its parent yet
+	void setDirectoryZone(ToWatchDir& oToWatch, const std::string& sPath);
 	std::string internalCalcToWatchDirectories();
 	// throws Max number of ToWatchDir structs reached
 	// throws Max number of INotify watches reached
 	void initialSetup();
+	// Resets the results and their names
+	// Returns empty or error if the spill file couldn't be created
+	std::string clearResults();
+	void clearToWatchDirs();
+	// throws Snapshot errors
+	// throws Max number of ToWatchDir structs reached
+	// throws Max number of INotify watches reached
+	void internalResume(const char* p0Data, int64_t nSize);
+	// Adds the names that appeared or disappeared while not watching
+	// throws Max number of ToWatchDir structs reached
+	// throws Max number of INotify watches reached
+	void resyncDirectory(int32_t nTWDIdx, int64_t nNowUsec);
 	// throws Max number of ToWatchDir structs reached
 	// throws Max number of INotify watches reached
 	int32_t initialFillTheGaps(int32_t nChildToTWDIdx, const std::string& sPath);
@@ -344,14 +931,90 @@ private:
 	// throws Max number of INotify watches reached
 	void initialCreateToWatchDir(int32_t nParentToTWDIdx);
 
-	void addExistingContent(ToWatchDir& oTWD);
+	// The names that already have a result are skipped
+	void addExistingContent(int32_t nTWDIdx);
+	// Uses m_oScanCache during the initial setup
+	// throws Glib::FileError
+	void scanDirectory(const std::string& sPath, std::vector<ScanCache::Entry>& aEntries);
 
-	void createImmediateChildren(int32_t nParentToTWDIdx, bool bWasAttrib, int64_t nNowUsec, const std::vector<ToWatchDir::FileDir>& aExcept);
+	// oExceptKeys contains ToWatchDir::getNameKey() values
+	void createImmediateChildren(int32_t nParentToTWDIdx, bool bWasAttrib, int64_t nNowUsec, const std::unordered_set<int64_t>& oExceptKeys);
 	void createImmediateChildren(int32_t nParentToTWDIdx, bool bWasAttrib, int64_t nNowUsec);
 	// throws Max number of ToWatchDir structs reached
-	int32_t addExistingToWatchDir(const std::string& sPath);
+	// Also links the new ToWatchDir to its parent.
+	int32_t addExistingToWatchDir(int32_t nParentTWDIdx, const std::string& sName, const std::string& sPath);
 	// throws Max number of INotify watches reached
 	void createINotifyWatch(int32_t nTWDIdx, ToWatchDir& oTWD);
+	// returns the errno of INotifierSource::removePath()
+	int32_t removeINotifyWatch(int32_t nTWDIdx, ToWatchDir& oTWD);
+	void emitAbort(const std::string& sError);
+	// The directory is then treated as if deleted, its results are kept
+	void detachToWatchDir(int32_t nTWDIdx);
+	// Watches the directory if it exists
+	// throws Max number of INotify watches reached
+	void attachToWatchDir(int32_t nTWDIdx);
+	// Whether a zone base path or the parent of a file is the path or one of its descendants
+	bool isNeededPath(const std::string& sPath) const;
+	// Whether a zone base path, the parent of a file or pinned by its parent
+	bool isStructural(int32_t nTWDIdx) const;
+	// Whether the directory is within the zone of its parent or structural
+	bool isWantedByParent(int32_t nTWDIdx) const;
+	// Makes sure the directory and its ancestors are watched and each pinned by its parent
+	// throws Max number of INotify watches reached
+	void pinToWatchDirAncestors(int32_t nTWDIdx);
+	// Removes the pins of the directory and its ancestors that are no longer needed
+	// Returns the topmost directory that was unpinned or nTWDIdx
+	int32_t unpinToWatchDirAncestors(int32_t nTWDIdx);
+	// Recalculates the owner zone of the directory and its subtree, watching
+	// the wanted directories (creating them if necessary) and detaching the others
+	// throws Max number of ToWatchDir structs reached
+	// throws Max number of INotify watches reached
+	void reconcileToWatchDir(int32_t nTWDIdx, bool bWanted);
+	// Reconciles the topmost directory along the chain from nTopTWDIdx down
+	// to nTWDIdx the status of which changed
+	// throws Max number of ToWatchDir structs reached
+	// throws Max number of INotify watches reached
+	void reconcileChain(int32_t nTopTWDIdx, int32_t nTWDIdx, bool bAlwaysLast);
+	// Returns a free or new index into m_aToWatchDirs
+	int32_t allocToWatchDir();
+	// Returns a free or new index into m_aWatchedResults
+	int32_t allocWatchedResult();
+	// Does nothing if not recycling
+	void addRecycleCandidate(int32_t nTWDIdx);
+	// Must not be called while there are open moves, since they hold indexes
+	void recycleCandidates();
+	void recycleTemporaryResults(int32_t nTWDIdx);
+	bool isRecyclable(const ToWatchDir& oTWD) const;
+	void recycleToWatchDir(int32_t nTWDIdx);
+	// Releases the names of m_oStringPool that aren't referenced anymore (ex. by recycled objects).
+	// Reads the spilled results. Must not be called during a traversal.
+	void releaseUnusedNames();
+
+	// A spilled reference is stored in place of a result index in the ToWatchDir
+	// of a spilled result. It is always < -1 so that -1 keeps meaning not found.
+	static bool isSpilledRef(int32_t nRef) { return (nRef < -1); }
+	static int32_t getSpilledRef(int32_t nSpilledId) { return -2 - nSpilledId; }
+	static int32_t getSpilledId(int32_t nSpilledRef) { return -2 - nSpilledRef; }
+	// Moves the result to the newest end of the list of active results
+	void touchActiveResult(int32_t nResultIdx);
+	// Does nothing if the result isn't in the list of active results
+	void unlinkActiveResult(int32_t nResultIdx);
+	// Must not be called during a traversal, since it moves results out of m_aWatchedResults
+	void spillInactiveResults(int64_t nNowUsec);
+	// Returns the spilled reference or -1 if the write failed
+	int32_t spillResult(int32_t nResultIdx);
+	// Copies the records of the spilled results to a new file if the dead records take more than half
+	// of the current one. Keeps the current file if the copy fails.
+	void compactSpillSegment();
+	bool readSpilledResult(int32_t nSpilledId, WatchedResult& oWR) const;
+	// Sets aBuffer to the SpilledResult followed by the SpilledAction records of the result
+	static void serializeResult(const WatchedResult& oWR, std::vector<char>& aBuffer);
+	// p0Actions points to oSR.m_nTotActions SpilledAction records
+	static void deserializeResult(const SpilledResult& oSR, const char* p0Actions, WatchedResult& oWR);
+	// nRefPos is the position of the spilled reference in ToWatchDir::m_aWatchedResultIdxs
+	// Returns the new index into m_aWatchedResults
+	// throws Could not read spilled result
+	int32_t faultInResult(int32_t nTWDIdx, int32_t nRefPos);
 
 	/** Traverse a subtree renaming.
 	 * @param nFromParentTWDIdx The parent ToWatchDir of the renamed from file or subdir. If -1 parent not watched.
@@ -366,6 +1029,7 @@ private:
 	 * @param nNowUsec The time stamp.
 	 * @throws Max number of ToWatchDir structs reached
 	 * @throws Max number of INotify watches reached
+	 * @throws Could not read spilled result
 	 */
 	void traverseRename(int32_t nFromParentTWDIdx
 						, const std::string& sFromParentPath, const std::string& sFromName, const std::string& sFromPath
@@ -373,14 +1037,29 @@ private:
 						, int32_t nToParentTWDIdx
 						, const std::string& sToParentPath, const std::string& sToName, const std::string& sToPath
 						, int64_t nNowUsec);
+	// The part of the traversal before the children are visited.
+	// Returns whether the children have to be traversed.
+	// throws Max number of ToWatchDir structs reached
+	bool traverseRenameEnter(RenameFrame& oFrame, int64_t nNowUsec);
+	// Returns whether oChildFrame was set to the next child to traverse
+	bool traverseRenameNextChild(RenameFrame& oFrame, RenameFrame& oChildFrame);
+	// The part of the traversal after the children were visited.
+	// throws Max number of INotify watches reached
+	void traverseRenameLeave(RenameFrame& oFrame, int64_t nNowUsec);
 
 	int32_t addWatchedResultRoot();
-	int32_t addWatchedResult(ToWatchDir& oParentTWD, const std::string& sName, bool bIsDir);
-	int32_t addWatchedResult(ToWatchDir& oParentTWD, const std::string& sPath, const std::string& sName, bool bIsDir);
+	int32_t addWatchedResult(int32_t nParentTWDIdx, const std::string& sName, bool bIsDir);
 	void setInconsistent(WatchedResult& oWR);
 	void setNotImmediate(WatchedResult& oWR);
+	// Records that the result changed in the current checkpoint generation
+	void setChanged(WatchedResult& oWR);
+	// Sets the type and updates the counts of the ancestors
+	void setResultType(WatchedResult& oWR, RESULT_TYPE eResultType);
+	void updateResultCounts(int32_t nParentTWDIdx, RESULT_TYPE eResultType, int32_t nDelta);
 
-	ActionData& addActionData(WatchedResult& oWR, INotifierSource::FOFI_ACTION eAction, int64_t nTimeUsec);
+	// Collapses and discards actions according to setActionCompaction()
+	void addActionData(WatchedResult& oWR, INotifierSource::FOFI_ACTION eAction, int64_t nTimeUsec
+						, bool bCausedByAttribChange = false, bool bImmediate = false, int32_t nOtherPathId = -1);
 
 	// throws Max numb<r of ToWatchDir structs reached
 	void checkThrowMaxToWatchDirsReached();
@@ -391,10 +1070,19 @@ private:
 	bool isFilteredOutSubDir(const ToWatchDir& oToWatch, const std::string& sName, const std::string& sPath) const;
 	bool isFilteredOutFile(const ToWatchDir& oToWatch, const std::string& sName, const std::string& sPath) const;
 
+	// Records the latencies and calls processFileModified()
 	INotifierSource::FOFI_PROGRESS onFileModified(const INotifierSource::FofiData& oFofiData);
+	INotifierSource::FOFI_PROGRESS processFileModified(const INotifierSource::FofiData& oFofiData);
+	// Emits m_oWatchedResultActionSignal recording the latency of the event being processed
+	void emitWatchedResultAction(const WatchedResult& oWatchedResult);
+	int64_t estimateMemoryBytes() const;
+	// Sets the CPU time of the setup and the start of the watch phase
+	void setWatchStartCpuTime(int64_t nSetupStartCpuUsec);
+	std::string writeSnapshot(const std::string& sPathName) const;
+	std::string writeSnapshotContent(std::ostream& oOut) const;
 	bool onCheckOpenMoves();
 
-	void calcFiltersRegex(std::vector<Filter> aFilters);
+	void calcFiltersRegex(std::vector<Filter>& aFilters);
 	// returns true if one of the filters matches
 	bool isMatchedByFilters(const std::vector<Filter>& aFilters
 							, const std::string& sName, const std::string& sPathName) const;
@@ -405,6 +1093,14 @@ private:
 private:
 	static constexpr int32_t s_nCheckOpenMovesMillisec = 1;
 	static constexpr int32_t s_nOpenMovesFailedAfterUsec = 200;
+	static constexpr int32_t s_nPathCacheSize = 256;
+	static constexpr int64_t s_nMaxSpillCheckIntervalUsec = 1000000;
+	static constexpr int64_t s_nMinSpillDeadBytesToCompact = 4096;
+	static constexpr int32_t s_nMinNamesToReleaseUnused = 4096;
+	static constexpr const char* s_p0SnapshotMagic = "FOFISNAP"; // without the terminating null
+	static constexpr int32_t s_nSnapshotVersion = 3;
+	static constexpr int32_t s_nSnapshotFlagOverflow = 1;
+	static constexpr int32_t s_nSnapshotFlagInconsistencies = 2;
 
 	int32_t m_nMaxToWatchDirectories;
 	int32_t m_nMaxResultPaths;
@@ -413,10 +1109,23 @@ private:
 	std::unique_ptr<INotifierSource> m_refSource;
 	std::vector<std::string> m_aInvalidPaths;
 	std::vector<DirectoryZone> m_aDirectoryZones;
+	PathTrie m_oDirectoryZoneTrie; // Key: DirectoryZone::m_sPath, Value: index into m_aDirectoryZones
+	std::vector<PathTrie::Ancestor> m_aZoneAncestors; // Used by setDirectoryZone() to avoid reallocations
 	std::vector<std::string> m_aToWatchFiles; // the watched files
 	//
 	std::deque<ToWatchDir> m_aToWatchDirs; // the directory zones + their subtree according to depth
+	std::vector<int32_t> m_aFreeToWatchDirIdxs; // Indexes into m_aToWatchDirs of recycled objects
 	int32_t m_nRootTWDIdx; // points into m_aToWatchDirs after calcToWatchDirectories() or is -1
+	struct PathCacheEntry
+	{
+		int32_t m_nTWDIdx = -1;
+		std::string m_sPath;
+	};
+	// Direct mapped by ToWatchDir index. Since a ToWatchDir is never renamed
+	// its path never changes, the cache only needs to be cleared along with m_aToWatchDirs
+	// and an entry when its ToWatchDir is recycled.
+	mutable std::vector<PathCacheEntry> m_aPathCache;
+	mutable std::vector<int32_t> m_aPathChain; // Used by getToWatchDirPath() to avoid reallocations
 	int64_t m_nEventCounter; // 0 means not watching
 	int64_t m_nStartTimeUsec;
 	int64_t m_nStopTimeUsec;
@@ -426,11 +1135,63 @@ private:
 	bool m_bOverflow;
 	bool m_bHasInconsistencies;
 	std::deque<WatchedResult> m_aWatchedResults;
+	std::vector<int32_t> m_aFreeWatchedResultIdxs; // Indexes into m_aWatchedResults of recycled objects
+	int64_t m_nCheckpointGeneration;
+	// The results changed in the current checkpoint generation identified by
+	// parent ToWatchDir index (-1 for the root result) and ToWatchDir::getNameKey(),
+	// so that they can still be found after being spilled. Might contain duplicates.
+	// The keys of recycled results are removed by releaseUnusedNames().
+	std::vector<std::pair<int32_t, int64_t>> m_aChangedResultKeys;
+	ResultCounts m_oTotalResultCounts;
+	bool m_bRecycleTemporary;
+	std::vector<RecycleCandidate> m_aRecycleCandidates;
+	std::vector<int32_t> m_aCompactTWDIdxs; // The ToWatchDir with m_bSubDirsToCompact set
+	std::string m_sSpillDir; // Empty if results aren't spilled
+	int64_t m_nSpillAfterUsec;
+	int64_t m_nNextSpillCheckUsec; // Microseconds from start of watching
+	// The results in memory that can be spilled, ordered from the least to the most
+	// recently modified, linked through WatchedResult::m_nOlderActiveIdx and m_nNewerActiveIdx.
+	// Only maintained if spilling.
+	int32_t m_nOldestActiveIdx; // Index into m_aWatchedResults or -1
+	int32_t m_nNewestActiveIdx; // Index into m_aWatchedResults or -1
+	SpillSegment m_oSpillSegment;
+	std::vector<SpilledSlot> m_aSpilledSlots; // Index: spilled id
+	int32_t m_nTotSpilledResults; // The number of m_aSpilledSlots with non negative offset
+	std::vector<int32_t> m_aFreeSpilledIds; // The ids of m_aSpilledSlots with negative offset
+	int64_t m_nSpillDeadBytes; // The bytes of m_oSpillSegment taken by records of results read back
+	mutable std::vector<char> m_aSpillBuffer; // Used to avoid reallocations
+	bool m_bCollapseActions;
+	int32_t m_nMaxActions; // 0 means unlimited
+	std::string m_sScanCachePath; // Empty if no scan cache
+	ScanCache m_oScanCache; // Only filled during the initial setup
+	int32_t m_nTotCachedScans;
+	// The names of m_aToWatchDirs, m_aWatchedResults and the ToWatchDir::m_aExisting
+	// and the other paths of the rename actions. Cleared by start().
+	StringPool m_oStringPool;
+	int32_t m_nNamesAfterRelease; // The names in m_oStringPool after the last releaseUnusedNames()
+	bool m_bTrackLatencies;
+	// Index: action * s_nTotLatencyStages + stage
+	std::vector<LatencyHistogram> m_aLatencyHistograms;
+	// The event being processed by onFileModified() or FOFI_ACTION_INVALID if none
+	INotifierSource::FOFI_ACTION m_eCurEventAction;
+	// The read time of the processed event, -1 if none or its latencies aren't recorded
+	int64_t m_nCurEventReadNsec;
+	int64_t m_nCurEventStartNsec;
+	std::array<int64_t, s_nTotEventActions> m_aTotEvents; // Index: INotifierSource::FOFI_ACTION
+	int64_t m_nTotFilteredOutEvents;
+	int64_t m_nTotOverflows;
+	std::map<int32_t, int64_t> m_oFailedWatches; // Key: errno, Value: count
+	int64_t m_nSetupCpuUsec;
+	int64_t m_nWatchStartCpuUsec; // -1 if never started
+	int64_t m_nWatchStopCpuUsec; // -1 if watching
+	mutable int64_t m_nSnapshotCpuUsec;
+	TraceRing m_oTraceRing;
 
 	std::vector<OpenMove> m_aOpenMoves;
+	sigc::connection m_oCheckOpenMovesConn;
 
 	const std::string m_sES;
-	const std::vector<ToWatchDir::FileDir> m_aEFD;
+	const std::unordered_set<int64_t> m_oENK;
 private:
 	FofiModel() = delete;
 	FofiModel(const FofiModel& oSource) = delete;
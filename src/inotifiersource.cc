@@ -20,6 +20,8 @@
 
 #include "inotifiersource.h"
 
+#include "util.h"
+
 #ifndef NDEBUG
 //#include <iostream>
 #endif //NDEBUG
@@ -70,6 +72,8 @@ int32_t INotifierSource::getSystemMaxUserWatches() noexcept
 INotifierSource::INotifierSource(int32_t nReserveSize) noexcept
 : Glib::Source()
 , m_nINotifyFD(-1)
+, m_nTotReads(0)
+, m_nTotReadEvents(0)
 {
 	static_assert(sizeof(int) <= sizeof(int32_t), "");
 	static_assert(false == FALSE, "");
@@ -202,6 +206,10 @@ int32_t INotifierSource::clearAll() noexcept
 	m_aFreeWatchIdxs.clear();
 	return nErrno;
 }
+int32_t INotifierSource::getTotWatches() const noexcept
+{
+	return static_cast<int32_t>(m_aWatchItems.size() - m_aFreeWatchIdxs.size());
+}
 int32_t INotifierSource::removePath(int32_t nTag) noexcept
 {
 	return removePath(-1, nTag);
@@ -298,12 +306,15 @@ bool INotifierSource::dispatch(sigc::slot_base* p0Slot) noexcept
 	if (nLen <= 0) {
 		return bContinue; //----------------------------------------------------
 	}
+	const int64_t nReadTimeNsec = Util::getNowTimeNanoseconds();
+	++m_nTotReads;
 
 
 	struct inotify_event* p0Event = nullptr;
 	char* p0Cur = m_aBuffer;
 	for (; p0Cur < (m_aBuffer + nLen); p0Cur += sizeof(struct inotify_event) + p0Event->len) {
 		p0Event = reinterpret_cast<struct inotify_event *>(p0Cur);
+		++m_nTotReadEvents;
 		const int32_t nMask = p0Event->mask;
 		const int32_t nWatchFD = p0Event->wd;
 		const int32_t nWatchIdx = findEntryByWatch(nWatchFD);
@@ -363,6 +374,7 @@ bool INotifierSource::dispatch(sigc::slot_base* p0Slot) noexcept
 			oData.m_nRenameCookie = p0Event->cookie;
 			oData.m_sName = ((p0Event->len > 0) ? std::string{p0Event->name} : "");
 			oData.m_nTag = m_aWatchItems[nWatchIdx].m_nTag;
+			oData.m_nReadTimeNsec = nReadTimeNsec;
 			FOFI_PROGRESS eProg = (*static_cast<sigc::slot<FOFI_PROGRESS, const FofiData&>*>(p0Slot))(oData);
 			bContinue = (eProg == FOFI_PROGRESS_CONTINUE);
 		}
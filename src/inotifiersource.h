@@ -127,6 +127,22 @@ public:
 	virtual
 	#endif // STMF_TESTING_IFACE
 	int32_t clearAll() noexcept;
+	/** The number of active watches.
+	 * @return The number of added and not yet removed paths.
+	 */
+	#ifdef STMF_TESTING_IFACE
+	virtual
+	#endif // STMF_TESTING_IFACE
+	int32_t getTotWatches() const noexcept;
+	/** The number of non empty reads from the inotify file descriptor.
+	 * @return The number of reads since the source was created.
+	 */
+	int64_t getTotReads() const noexcept { return m_nTotReads; }
+	/** The number of inotify events read.
+	 * Includes the events of removed watches and those not passed to the callback.
+	 * @return The number of events since the source was created.
+	 */
+	int64_t getTotReadEvents() const noexcept { return m_nTotReadEvents; }
 
 	enum FOFI_ACTION
 	{
@@ -146,6 +162,8 @@ public:
 		FOFI_ACTION m_eAction = FOFI_ACTION_CREATE; /**< The action. Default is FOFI_ACTION_CREATE. */
 		int32_t m_nRenameCookie = 0;
 		bool m_bOverflow = false; /**< Whether events were dropped. Default is false. */
+		int64_t m_nReadTimeNsec = 0; /**< When the event was read from inotify (Util::getNowTimeNanoseconds()).
+									 * All the events of a read share the same time. Default is 0 (unknown). */
 	};
 	//
 	enum FOFI_PROGRESS
@@ -185,6 +203,9 @@ private:
 	int32_t m_nINotifyFD;
 	Glib::PollFD m_oINotifyPollFD;
 	//
+	int64_t m_nTotReads;
+	int64_t m_nTotReadEvents;
+	//
 	static constexpr int32_t s_nBufferSize = 8192;
 	char m_aBuffer[s_nBufferSize];
 	//
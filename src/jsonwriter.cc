@@ -0,0 +1,259 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   jsonwriter.cc
+ */
+
+#include "jsonwriter.h"
+
+#include "util.h"
+
+#include <glibmm.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace fofi
+{
+
+static constexpr size_t s_nFlushBufferSize = 64 * 1024;
+static constexpr int32_t s_nIndent = 2; // same as nlohmann::json::dump(2)
+
+JsonWriter::JsonWriter(std::ostream& oOut, bool bNDJSon) noexcept
+: m_oOut(oOut)
+, m_bNDJSon(bNDJSon)
+, m_bAfterKey(false)
+, m_nTotSequenceValues(0)
+{
+	m_sBuffer.reserve(s_nFlushBufferSize + 4096);
+}
+JsonWriter::~JsonWriter() noexcept
+{
+	flush();
+}
+void JsonWriter::flush() noexcept
+{
+	if (m_sBuffer.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	m_oOut.write(m_sBuffer.data(), m_sBuffer.size());
+	m_sBuffer.clear();
+}
+void JsonWriter::beginSequence() noexcept
+{
+	assert(m_aEmptyContainers.empty());
+	m_nTotSequenceValues = 0;
+	if (! m_bNDJSon) {
+		m_sBuffer.append("[\n");
+	}
+}
+void JsonWriter::endSequence() noexcept
+{
+	assert(m_aEmptyContainers.empty());
+	if (! m_bNDJSon) {
+		m_sBuffer.append("]\n");
+	}
+	flush();
+}
+void JsonWriter::continueSequence() noexcept
+{
+	assert(m_aEmptyContainers.empty());
+	// the next value is preceded by a separator
+	m_nTotSequenceValues = 1;
+}
+void JsonWriter::newLineAndIndent() noexcept
+{
+	m_sBuffer.push_back('\n');
+	m_sBuffer.append(m_aEmptyContainers.size() * s_nIndent, ' ');
+}
+void JsonWriter::beginValue() noexcept
+{
+	if (m_bAfterKey) {
+		m_bAfterKey = false;
+		return; //--------------------------------------------------------------
+	}
+	if (m_aEmptyContainers.empty()) {
+		// top level
+		if ((! m_bNDJSon) && (m_nTotSequenceValues > 0)) {
+			m_sBuffer.append(",\n");
+		}
+		return; //--------------------------------------------------------------
+	}
+	if (m_aEmptyContainers.back()) {
+		m_aEmptyContainers.back() = false;
+	} else {
+		m_sBuffer.push_back(',');
+	}
+	if (! m_bNDJSon) {
+		newLineAndIndent();
+	}
+}
+void JsonWriter::endValue() noexcept
+{
+	if (! m_aEmptyContainers.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	// top level
+	m_sBuffer.push_back('\n');
+	++m_nTotSequenceValues;
+	if (m_sBuffer.size() >= s_nFlushBufferSize) {
+		flush();
+	}
+}
+void JsonWriter::beginContainer(char cOpen) noexcept
+{
+	beginValue();
+	m_sBuffer.push_back(cOpen);
+	m_aEmptyContainers.push_back(true);
+}
+void JsonWriter::endContainer(char cClose) noexcept
+{
+	assert(! m_aEmptyContainers.empty());
+	assert(! m_bAfterKey);
+	const bool bEmpty = m_aEmptyContainers.back();
+	m_aEmptyContainers.pop_back();
+	if ((! bEmpty) && (! m_bNDJSon)) {
+		newLineAndIndent();
+	}
+	m_sBuffer.push_back(cClose);
+	endValue();
+}
+void JsonWriter::beginObject() noexcept
+{
+	beginContainer('{');
+}
+void JsonWriter::endObject() noexcept
+{
+	endContainer('}');
+}
+void JsonWriter::beginArray() noexcept
+{
+	beginContainer('[');
+}
+void JsonWriter::endArray() noexcept
+{
+	endContainer(']');
+}
+void JsonWriter::key(const char* p0Key) noexcept
+{
+	assert(p0Key != nullptr);
+	assert(! m_aEmptyContainers.empty());
+	assert(! m_bAfterKey);
+	beginValue();
+	m_sBuffer.push_back('"');
+	appendEscaped(p0Key, std::strlen(p0Key));
+	m_sBuffer.append(m_bNDJSon ? "\":" : "\": ");
+	m_bAfterKey = true;
+}
+void JsonWriter::value(const std::string& sValue) noexcept
+{
+	beginValue();
+	m_sBuffer.push_back('"');
+	appendEscaped(sValue.data(), sValue.size());
+	m_sBuffer.push_back('"');
+	endValue();
+}
+void JsonWriter::value(const char* p0Value) noexcept
+{
+	assert(p0Value != nullptr);
+	beginValue();
+	m_sBuffer.push_back('"');
+	appendEscaped(p0Value, std::strlen(p0Value));
+	m_sBuffer.push_back('"');
+	endValue();
+}
+void JsonWriter::value(int64_t nValue) noexcept
+{
+	beginValue();
+	char aDigits[Util::s_nMaxIntChars];
+	const int32_t nSize = Util::formatInt(nValue, aDigits);
+	m_sBuffer.append(aDigits, nSize);
+	endValue();
+}
+void JsonWriter::value(bool bValue) noexcept
+{
+	beginValue();
+	m_sBuffer.append(bValue ? "true" : "false");
+	endValue();
+}
+void JsonWriter::fileNameValue(const std::string& sFileName) noexcept
+{
+	if (m_oEncoding.isUtf8(sFileName)) {
+		value(sFileName);
+	} else {
+		value(std::string{Glib::filename_display_name(sFileName)});
+	}
+}
+void JsonWriter::pathValue(const std::string& sDirPath, const char* p0Name) noexcept
+{
+	assert(p0Name != nullptr);
+	const size_t nNameSize = std::strlen(p0Name);
+	if (! m_oEncoding.isUtf8(sDirPath, p0Name, nNameSize)) {
+		fileNameValue(Util::getPathFromDirAndName(sDirPath, p0Name));
+		return; //--------------------------------------------------------------
+	}
+	beginValue();
+	m_sBuffer.push_back('"');
+	appendEscaped(sDirPath.data(), sDirPath.size());
+	if (sDirPath != "/") {
+		m_sBuffer.push_back('/');
+	}
+	appendEscaped(p0Name, nNameSize);
+	m_sBuffer.push_back('"');
+	endValue();
+}
+void JsonWriter::timeValue(int64_t nTimeUsec, int64_t nDurationUsec) noexcept
+{
+	beginValue();
+	char aTime[Util::s_nMaxTimeChars];
+	const int32_t nSize = Util::formatTime(nTimeUsec, nDurationUsec, aTime);
+	m_sBuffer.push_back('"');
+	m_sBuffer.append(aTime, nSize);
+	m_sBuffer.push_back('"');
+	endValue();
+}
+void JsonWriter::appendEscaped(const char* p0Str, size_t nSize) noexcept
+{
+	static const char* const s_p0HexDigits = "0123456789abcdef";
+	const char* p0Plain = p0Str;
+	const char* const p0End = p0Str + nSize;
+	for (const char* p0Cur = p0Str; p0Cur != p0End; ++p0Cur) {
+		const unsigned char c = static_cast<unsigned char>(*p0Cur);
+		if ((c >= 0x20) && (c != '"') && (c != '\\')) {
+			continue; // for ---
+		}
+		m_sBuffer.append(p0Plain, p0Cur - p0Plain);
+		p0Plain = p0Cur + 1;
+		switch (c) {
+			case '"':  m_sBuffer.append("\\\""); break;
+			case '\\': m_sBuffer.append("\\\\"); break;
+			case '\b': m_sBuffer.append("\\b"); break;
+			case '\f': m_sBuffer.append("\\f"); break;
+			case '\n': m_sBuffer.append("\\n"); break;
+			case '\r': m_sBuffer.append("\\r"); break;
+			case '\t': m_sBuffer.append("\\t"); break;
+			default:
+			{
+				const char aCode[6] = {'\\', 'u', '0', '0', s_p0HexDigits[c >> 4], s_p0HexDigits[c & 0x0f]};
+				m_sBuffer.append(aCode, sizeof(aCode));
+			}
+		}
+	}
+	m_sBuffer.append(p0Plain, p0End - p0Plain);
+}
+
+} // namespace fofi
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   jsonwriter.h
+ */
+
+#ifndef FOFIMON_JSON_WRITER_H_
+#define FOFIMON_JSON_WRITER_H_
+
+#include "textwriter.h"
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Streaming writer of a sequence of json values.
+ * The values are written into a buffer that is passed to the stream when it grows
+ * over a threshold, no document object is built.
+ *
+ * In json mode the sequence is an array and values are indented like
+ * nlohmann::json::dump(2) does, one per line. In NDJSON (newline delimited json)
+ * mode each value of the sequence is written compactly on its own line.
+ *
+ * Example:
+ *
+ *     JsonWriter oWriter(oOut, false);
+ *     oWriter.beginSequence();
+ *     oWriter.beginObject();
+ *     oWriter.key("Count");
+ *     oWriter.value(3);
+ *     oWriter.endObject();
+ *     oWriter.endSequence();
+ *
+ * The caller is responsible for the well-formedness (for example that a key
+ * precedes each value of an object). */
+class JsonWriter
+{
+public:
+	/** Constructor.
+	 * @param oOut The stream the buffer is written to.
+	 * @param bNDJSon Whether newline delimited json.
+	 */
+	JsonWriter(std::ostream& oOut, bool bNDJSon) noexcept;
+	/** Destructor. Flushes. */
+	~JsonWriter() noexcept;
+
+	/** Starts the sequence of top level values. */
+	void beginSequence() noexcept;
+	/** Ends the sequence of top level values and flushes. */
+	void endSequence() noexcept;
+	/** Continues a sequence begun by another writer that already wrote values.
+	 * Used to write parts of the same sequence into different buffers, for example
+	 * from different threads. Instead of beginSequence(). The last part is ended
+	 * with endSequence(), the others with flush().
+	 */
+	void continueSequence() noexcept;
+
+	void beginObject() noexcept;
+	void endObject() noexcept;
+	void beginArray() noexcept;
+	void endArray() noexcept;
+	/** The key of the next value of the current object.
+	 * @param p0Key The key. Must be valid UTF-8. Cannot be null.
+	 */
+	void key(const char* p0Key) noexcept;
+	/** A string value.
+	 * @param sValue Must be valid UTF-8.
+	 */
+	void value(const std::string& sValue) noexcept;
+	/** A string value.
+	 * @param p0Value Must be valid UTF-8. Cannot be null.
+	 */
+	void value(const char* p0Value) noexcept;
+	void value(int64_t nValue) noexcept;
+	void value(int32_t nValue) noexcept { value(static_cast<int64_t>(nValue)); }
+	void value(bool bValue) noexcept;
+	/** A string value from a file name in the file system encoding.
+	 * Same as Glib::filename_to_utf8() but doesn't copy if the encoding is UTF-8.
+	 * Invalid sequences are replaced.
+	 * @param sFileName The path or name.
+	 */
+	void fileNameValue(const std::string& sFileName) noexcept;
+	/** A string value from the path of a directory and a name in it.
+	 * Same as fileNameValue(Util::getPathFromDirAndName(sDirPath, p0Name))
+	 * but the path isn't built if the encoding is UTF-8.
+	 * @param sDirPath The path of the directory.
+	 * @param p0Name The null terminated name. Cannot be null.
+	 */
+	void pathValue(const std::string& sDirPath, const char* p0Name) noexcept;
+	/** A string value from a time.
+	 * Same as value(Util::getTimeString(nTimeUsec, nDurationUsec)) without allocation.
+	 * @param nTimeUsec The time in microseconds.
+	 * @param nDurationUsec The duration that determines the width.
+	 */
+	void timeValue(int64_t nTimeUsec, int64_t nDurationUsec) noexcept;
+
+	/** Writes the buffer to the stream. */
+	void flush() noexcept;
+private:
+	void beginValue() noexcept;
+	void endValue() noexcept;
+	void beginContainer(char cOpen) noexcept;
+	void endContainer(char cClose) noexcept;
+	void newLineAndIndent() noexcept;
+	void appendEscaped(const char* p0Str, size_t nSize) noexcept;
+private:
+	std::ostream& m_oOut;
+	const bool m_bNDJSon;
+	const FileNameEncoding m_oEncoding;
+	std::string m_sBuffer;
+	// One entry per open container: whether it doesn't have values yet
+	std::vector<bool> m_aEmptyContainers;
+	bool m_bAfterKey;
+	int64_t m_nTotSequenceValues;
+private:
+	JsonWriter(const JsonWriter& oSource) = delete;
+	JsonWriter& operator=(const JsonWriter& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_JSON_WRITER_H_ */
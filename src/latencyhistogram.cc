@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   latencyhistogram.cc
+ */
+#include "latencyhistogram.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+namespace fofi
+{
+
+LatencyHistogram::LatencyHistogram() noexcept
+{
+	clear();
+}
+void LatencyHistogram::clear() noexcept
+{
+	m_aCounts.fill(0);
+	m_nTotCount = 0;
+	m_nTotNsec = 0;
+	m_nMaxNsec = 0;
+}
+void LatencyHistogram::merge(const LatencyHistogram& oOther) noexcept
+{
+	for (int32_t nIdx = 0; nIdx < s_nTotBuckets; ++nIdx) {
+		m_aCounts[nIdx] += oOther.m_aCounts[nIdx];
+	}
+	m_nTotCount += oOther.m_nTotCount;
+	m_nTotNsec += oOther.m_nTotNsec;
+	m_nMaxNsec = std::max(m_nMaxNsec, oOther.m_nMaxNsec);
+}
+int64_t LatencyHistogram::getMean() const noexcept
+{
+	if (m_nTotCount == 0) {
+		return 0; //------------------------------------------------------------
+	}
+	return m_nTotNsec / m_nTotCount;
+}
+int64_t LatencyHistogram::getValueAtPercentile(double fPercentile) const noexcept
+{
+	if (m_nTotCount == 0) {
+		return 0; //------------------------------------------------------------
+	}
+	fPercentile = std::min(100.0, std::max(0.0, fPercentile));
+	const int64_t nRank = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(fPercentile / 100.0 * m_nTotCount)));
+	int64_t nCumulated = 0;
+	for (int32_t nIdx = 0; nIdx < s_nTotBuckets; ++nIdx) {
+		nCumulated += m_aCounts[nIdx];
+		if (nCumulated >= nRank) {
+			return std::min(getBucketMaxValue(nIdx), m_nMaxNsec); //------------
+		}
+	}
+	assert(false);
+	return m_nMaxNsec;
+}
+int64_t LatencyHistogram::getBucketMaxValue(int32_t nBucketIdx) noexcept
+{
+	assert((nBucketIdx >= 0) && (nBucketIdx < s_nTotBuckets));
+	if (nBucketIdx < s_nSubBuckets) {
+		return nBucketIdx; //---------------------------------------------------
+	}
+	const int32_t nShift = (nBucketIdx >> s_nSubBucketBits) - 1;
+	const int64_t nSubBucket = s_nSubBuckets + (nBucketIdx & (s_nSubBuckets - 1));
+	return ((nSubBucket + 1) << nShift) - 1;
+}
+
+} // namespace fofi
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   latencyhistogram.h
+ */
+
+#ifndef FOFIMON_LATENCY_HISTOGRAM_H_
+#define FOFIMON_LATENCY_HISTOGRAM_H_
+
+#include <array>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Histogram of durations in nanoseconds.
+ * Each power of two is split into 16 linear buckets, so that a value read back
+ * (ex. a percentile) is at most about 6% bigger than the recorded one.
+ * Recording doesn't allocate and just increments a few counters. */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram() noexcept;
+	/** Records a duration.
+	 * Negative durations are recorded as 0, durations bigger than getMaxTrackable()
+	 * as getMaxTrackable().
+	 * @param nValueNsec The duration in nanoseconds.
+	 */
+	void record(int64_t nValueNsec) noexcept
+	{
+		if (nValueNsec < 0) {
+			nValueNsec = 0;
+		} else if (nValueNsec > s_nMaxTrackable) {
+			nValueNsec = s_nMaxTrackable;
+		}
+		++m_aCounts[getBucketIdx(nValueNsec)];
+		++m_nTotCount;
+		m_nTotNsec += nValueNsec;
+		if (nValueNsec > m_nMaxNsec) {
+			m_nMaxNsec = nValueNsec;
+		}
+	}
+	/** Removes all the recorded values. */
+	void clear() noexcept;
+	/** Adds the recorded values of another histogram.
+	 * @param oOther The other histogram.
+	 */
+	void merge(const LatencyHistogram& oOther) noexcept;
+	/** The number of recorded values.
+	 * @return The count.
+	 */
+	int64_t getTotCount() const noexcept { return m_nTotCount; }
+	/** The biggest recorded value.
+	 * @return The value in nanoseconds or 0 if empty.
+	 */
+	int64_t getMax() const noexcept { return m_nMaxNsec; }
+	/** The average of the recorded values.
+	 * @return The value in nanoseconds or 0 if empty.
+	 */
+	int64_t getMean() const noexcept;
+	/** The sum of the recorded values.
+	 * @return The sum in nanoseconds.
+	 */
+	int64_t getSum() const noexcept { return m_nTotNsec; }
+	/** The value below which a percentage of the recorded values lies.
+	 * The returned value is the upper bound of the bucket, but never bigger than getMax().
+	 * @param fPercentile The percentage. From 0 to 100.
+	 * @return The value in nanoseconds or 0 if empty.
+	 */
+	int64_t getValueAtPercentile(double fPercentile) const noexcept;
+	/** The biggest value that can be recorded.
+	 * @return The value in nanoseconds (about 4.8 hours).
+	 */
+	static constexpr int64_t getMaxTrackable() noexcept { return s_nMaxTrackable; }
+
+private:
+	static constexpr int32_t s_nSubBucketBits = 4;
+	static constexpr int32_t s_nSubBuckets = (1 << s_nSubBucketBits);
+	static constexpr int32_t s_nMaxValueBits = 44;
+	static constexpr int64_t s_nMaxTrackable = (int64_t{1} << s_nMaxValueBits) - 1;
+	static constexpr int32_t s_nTotBuckets = s_nSubBuckets * (s_nMaxValueBits - s_nSubBucketBits + 1);
+
+	// Values smaller than 2 * s_nSubBuckets have their own bucket, the
+	// bigger ones are grouped by their most significant s_nSubBucketBits + 1 bits
+	static int32_t getBucketIdx(int64_t nValue) noexcept
+	{
+		if (nValue < s_nSubBuckets) {
+			return static_cast<int32_t>(nValue); //----------------------------
+		}
+		const int32_t nShift = (63 - __builtin_clzll(static_cast<uint64_t>(nValue))) - s_nSubBucketBits;
+		return ((nShift + 1) << s_nSubBucketBits) + static_cast<int32_t>((nValue >> nShift) - s_nSubBuckets);
+	}
+	static int64_t getBucketMaxValue(int32_t nBucketIdx) noexcept;
+
+private:
+	std::array<int64_t, s_nTotBuckets> m_aCounts;
+	int64_t m_nTotCount;
+	int64_t m_nTotNsec;
+	int64_t m_nMaxNsec;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,343 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   livebinary.cc
+ */
+
+#include "livebinary.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fofi
+{
+
+constexpr const char* LiveBinary::s_p0Extension;
+constexpr int32_t LiveBinaryWriter::s_nDefaultMaxPaths;
+
+static const char* const s_p0LiveMagic = "FOFILIVE";
+static constexpr size_t s_nLiveMagicSize = 8;
+static constexpr uint32_t s_nLiveVersion = 2;
+// Version 1 files never redefine a path id
+static constexpr uint32_t s_nLiveMinVersion = 1;
+static constexpr uint32_t s_nLiveByteOrderMark = 0x01020304;
+static constexpr size_t s_nHeaderSize = s_nLiveMagicSize + 4 + 4 + 8;
+static constexpr size_t s_nRecordPrefixSize = 4 + 1;
+static constexpr size_t s_nPathRecordMinSize = s_nRecordPrefixSize + 4;
+static constexpr size_t s_nEventRecordMinSize = s_nRecordPrefixSize + 1 + 1 + 1 + 8 + 4 + 4 + 4;
+// Protects the reader from allocating huge buffers for corrupt sizes
+static constexpr uint32_t s_nMaxRecordSize = 1024 * 1024;
+static constexpr size_t s_nReadChunkSize = 1024 * 1024;
+
+template<typename T>
+static void appendValue(std::string& sOut, T nValue) noexcept
+{
+	char aBytes[sizeof(T)];
+	std::memcpy(aBytes, &nValue, sizeof(T));
+	sOut.append(aBytes, sizeof(T));
+}
+template<typename T>
+static T extractValue(const char*& p0Cur) noexcept
+{
+	T nValue;
+	std::memcpy(&nValue, p0Cur, sizeof(T));
+	p0Cur += sizeof(T);
+	return nValue;
+}
+// Sets the size field of a record starting at the beginning of sRecord
+static void setRecordSize(std::string& sRecord) noexcept
+{
+	const uint32_t nSize = static_cast<uint32_t>(sRecord.size());
+	std::memcpy(&sRecord[0], &nSize, sizeof(uint32_t));
+}
+
+const char* LiveBinary::getActionCodeString(int32_t nAction) noexcept
+{
+	switch (nAction) {
+		case LIVE_ACTION_CREATE: return "CREATE";
+		case LIVE_ACTION_DELETE: return "DELETE";
+		case LIVE_ACTION_MODIFY: return "MODIFY";
+		case LIVE_ACTION_ATTRIB: return "ATTRIB";
+		case LIVE_ACTION_RENAME_FROM: return "RENAME_FROM";
+		case LIVE_ACTION_RENAME_TO: return "RENAME_TO";
+		default: return "UNKNOWN";
+	}
+}
+const char* LiveBinary::getResultTypeCodeString(int32_t nResultType) noexcept
+{
+	switch (nResultType) {
+		case LIVE_RESULT_NONE: return "NONE";
+		case LIVE_RESULT_CREATED: return "CREATED";
+		case LIVE_RESULT_DELETED: return "DELETED";
+		case LIVE_RESULT_MODIFIED: return "MODIFIED";
+		case LIVE_RESULT_TEMPORARY: return "TEMPORARY";
+		default: return "UNKNOWN";
+	}
+}
+
+LiveBinaryWriter::LiveBinaryWriter(int32_t nMaxPaths) noexcept
+: m_nMaxPaths(nMaxPaths)
+, m_bHeaderWritten(false)
+, m_nClockHand(0)
+, m_nTotEvictedPaths(0)
+{
+	assert(nMaxPaths >= 2);
+}
+void LiveBinaryWriter::writeHeader(std::ostream& oOut, int64_t nStartWallTimeUsec) noexcept
+{
+	if (m_bHeaderWritten) {
+		return; //--------------------------------------------------------------
+	}
+	m_bHeaderWritten = true;
+	m_sRecord.clear();
+	m_sRecord.append(s_p0LiveMagic, s_nLiveMagicSize);
+	appendValue<uint32_t>(m_sRecord, s_nLiveVersion);
+	appendValue<uint32_t>(m_sRecord, s_nLiveByteOrderMark);
+	appendValue<int64_t>(m_sRecord, nStartWallTimeUsec);
+	oOut.write(m_sRecord.data(), m_sRecord.size());
+}
+int32_t LiveBinaryWriter::evictPath(int32_t nKeepId) noexcept
+{
+	assert(static_cast<int32_t>(m_aPathKeys.size()) == m_nMaxPaths);
+	// second chance: skip (once) the ids used since the hand last passed
+	while (m_aPathUsed[m_nClockHand] || (m_nClockHand == nKeepId)) {
+		m_aPathUsed[m_nClockHand] = false;
+		m_nClockHand = (m_nClockHand + 1) % m_nMaxPaths;
+	}
+	const int32_t nId = m_nClockHand;
+	m_nClockHand = (m_nClockHand + 1) % m_nMaxPaths;
+	const auto itFind = m_oPathIds.find(*m_aPathKeys[nId]);
+	assert(itFind != m_oPathIds.end());
+	m_oPathIds.erase(itFind);
+	++m_nTotEvictedPaths;
+	return nId;
+}
+int32_t LiveBinaryWriter::getPathId(std::ostream& oOut, const std::string& sPath, int32_t nKeepId) noexcept
+{
+	const auto itFind = m_oPathIds.find(sPath);
+	if (itFind != m_oPathIds.end()) {
+		m_aPathUsed[itFind->second] = true;
+		return itFind->second; //-----------------------------------------------
+	}
+	int32_t nNewId;
+	if (static_cast<int32_t>(m_aPathKeys.size()) < m_nMaxPaths) {
+		nNewId = static_cast<int32_t>(m_aPathKeys.size());
+		m_aPathKeys.push_back(nullptr);
+		m_aPathUsed.push_back(false);
+	} else {
+		nNewId = evictPath(nKeepId);
+	}
+	const auto oPair = m_oPathIds.emplace(sPath, nNewId);
+	assert(oPair.second);
+	m_aPathKeys[nNewId] = &(oPair.first->first);
+	m_aPathUsed[nNewId] = true;
+	m_sRecord.clear();
+	appendValue<uint32_t>(m_sRecord, 0);
+	appendValue<uint8_t>(m_sRecord, LiveBinary::LIVE_RECORD_PATH);
+	appendValue<int32_t>(m_sRecord, nNewId);
+	m_sRecord.append(sPath);
+	setRecordSize(m_sRecord);
+	oOut.write(m_sRecord.data(), m_sRecord.size());
+	return nNewId;
+}
+void LiveBinaryWriter::writeEvent(std::ostream& oOut, const LiveBinary::Event& oEvent
+								, const std::string& sPath, const std::string* p0OtherPath) noexcept
+{
+	assert(m_bHeaderWritten);
+	const int32_t nPathId = getPathId(oOut, sPath, -1);
+	// the other path must not take the id of the path
+	const int32_t nOtherPathId = ((p0OtherPath == nullptr) ? -1 : getPathId(oOut, *p0OtherPath, nPathId));
+	m_sRecord.clear();
+	appendValue<uint32_t>(m_sRecord, static_cast<uint32_t>(s_nEventRecordMinSize));
+	appendValue<uint8_t>(m_sRecord, LiveBinary::LIVE_RECORD_EVENT);
+	appendValue<uint8_t>(m_sRecord, oEvent.m_eAction);
+	appendValue<uint8_t>(m_sRecord, oEvent.m_eResultType);
+	appendValue<uint8_t>(m_sRecord, oEvent.m_nFlags);
+	appendValue<int64_t>(m_sRecord, oEvent.m_nTimeUsec);
+	appendValue<int32_t>(m_sRecord, nPathId);
+	appendValue<int32_t>(m_sRecord, nOtherPathId);
+	appendValue<int32_t>(m_sRecord, oEvent.m_nCount);
+	assert(m_sRecord.size() == s_nEventRecordMinSize);
+	oOut.write(m_sRecord.data(), m_sRecord.size());
+}
+
+const std::string LiveBinaryReader::s_sEmpty{};
+
+LiveBinaryReader::LiveBinaryReader() noexcept
+: m_nFD(-1)
+, m_nBufferStart(0)
+, m_nBufferEnd(0)
+, m_nStartWallTimeUsec(-1)
+{
+}
+LiveBinaryReader::~LiveBinaryReader() noexcept
+{
+	if (m_nFD >= 0) {
+		::close(m_nFD);
+	}
+}
+std::string LiveBinaryReader::open(const std::string& sPathName)
+{
+	assert(m_nFD < 0);
+	m_nFD = ::open(sPathName.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_nFD < 0) {
+		return "Could not open " + sPathName + ": " + ::strerror(errno); //-----
+	}
+	return "";
+}
+int64_t LiveBinaryReader::readFile()
+{
+	assert(m_nFD >= 0);
+	int64_t nTotRead = 0;
+	while (true) {
+		compactBuffer();
+		if (m_aBuffer.size() - m_nBufferEnd < s_nReadChunkSize) {
+			m_aBuffer.resize(m_nBufferEnd + s_nReadChunkSize);
+		}
+		const ssize_t nRead = ::read(m_nFD, m_aBuffer.data() + m_nBufferEnd, m_aBuffer.size() - m_nBufferEnd);
+		if (nRead < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			m_sError = std::string("Could not read: ") + ::strerror(errno);
+			return -1; //-------------------------------------------------------
+		}
+		m_nBufferEnd += static_cast<size_t>(nRead);
+		nTotRead += nRead;
+		// read at most one chunk so that the caller can decode it
+		if ((nRead == 0) || (nTotRead >= static_cast<int64_t>(s_nReadChunkSize))) {
+			break; // while ----
+		}
+	}
+	return nTotRead;
+}
+void LiveBinaryReader::feed(const char* p0Data, size_t nSize)
+{
+	compactBuffer();
+	if (m_aBuffer.size() - m_nBufferEnd < nSize) {
+		m_aBuffer.resize(m_nBufferEnd + nSize);
+	}
+	std::memcpy(m_aBuffer.data() + m_nBufferEnd, p0Data, nSize);
+	m_nBufferEnd += nSize;
+}
+void LiveBinaryReader::compactBuffer() noexcept
+{
+	if (m_nBufferStart == 0) {
+		return; //--------------------------------------------------------------
+	}
+	const size_t nPending = m_nBufferEnd - m_nBufferStart;
+	if (nPending > 0) {
+		std::memmove(m_aBuffer.data(), m_aBuffer.data() + m_nBufferStart, nPending);
+	}
+	m_nBufferStart = 0;
+	m_nBufferEnd = nPending;
+}
+bool LiveBinaryReader::readHeader()
+{
+	if (m_nBufferEnd - m_nBufferStart < s_nHeaderSize) {
+		return false; //--------------------------------------------------------
+	}
+	const char* p0Cur = m_aBuffer.data() + m_nBufferStart;
+	if (std::memcmp(p0Cur, s_p0LiveMagic, s_nLiveMagicSize) != 0) {
+		m_sError = "Not a binary live events file";
+		return false; //--------------------------------------------------------
+	}
+	p0Cur += s_nLiveMagicSize;
+	const uint32_t nVersion = extractValue<uint32_t>(p0Cur);
+	const uint32_t nByteOrderMark = extractValue<uint32_t>(p0Cur);
+	if (nByteOrderMark != s_nLiveByteOrderMark) {
+		m_sError = "Binary live events file written with a different byte order";
+		return false; //--------------------------------------------------------
+	}
+	if ((nVersion < s_nLiveMinVersion) || (nVersion > s_nLiveVersion)) {
+		m_sError = "Unsupported binary live events version " + std::to_string(nVersion);
+		return false; //--------------------------------------------------------
+	}
+	m_nStartWallTimeUsec = extractValue<int64_t>(p0Cur);
+	m_nBufferStart += s_nHeaderSize;
+	return true;
+}
+LiveBinaryReader::READ_RESULT LiveBinaryReader::next(LiveBinary::Event& oEvent)
+{
+	if (! m_sError.empty()) {
+		return READ_RESULT_ERROR; //--------------------------------------------
+	}
+	if (m_nStartWallTimeUsec < 0) {
+		if (! readHeader()) {
+			return (m_sError.empty() ? READ_RESULT_NEED_DATA : READ_RESULT_ERROR); //---
+		}
+	}
+	while (m_nBufferEnd - m_nBufferStart >= s_nRecordPrefixSize) {
+		const char* p0Cur = m_aBuffer.data() + m_nBufferStart;
+		const uint32_t nSize = extractValue<uint32_t>(p0Cur);
+		const uint8_t nType = extractValue<uint8_t>(p0Cur);
+		if ((nSize < s_nRecordPrefixSize) || (nSize > s_nMaxRecordSize)) {
+			m_sError = "Corrupt record size " + std::to_string(nSize);
+			return READ_RESULT_ERROR; //----------------------------------------
+		}
+		if (m_nBufferEnd - m_nBufferStart < nSize) {
+			// partial record, wait for the rest
+			break; // while ----
+		}
+		m_nBufferStart += nSize;
+		if (nType == LiveBinary::LIVE_RECORD_PATH) {
+			if (nSize < s_nPathRecordMinSize) {
+				m_sError = "Corrupt path record";
+				return READ_RESULT_ERROR; //------------------------------------
+			}
+			const int32_t nPathId = extractValue<int32_t>(p0Cur);
+			if ((nPathId < 0) || (nPathId > static_cast<int32_t>(m_aPaths.size()))) {
+				m_sError = "Unexpected path id " + std::to_string(nPathId);
+				return READ_RESULT_ERROR; //------------------------------------
+			}
+			if (nPathId < static_cast<int32_t>(m_aPaths.size())) {
+				// the writer reused the id of an evicted path
+				m_aPaths[nPathId].assign(p0Cur, nSize - s_nPathRecordMinSize);
+			} else {
+				m_aPaths.emplace_back(p0Cur, nSize - s_nPathRecordMinSize);
+			}
+		} else if (nType == LiveBinary::LIVE_RECORD_EVENT) {
+			if (nSize < s_nEventRecordMinSize) {
+				m_sError = "Corrupt event record";
+				return READ_RESULT_ERROR; //------------------------------------
+			}
+			oEvent.m_eAction = static_cast<LiveBinary::LIVE_ACTION>(extractValue<uint8_t>(p0Cur));
+			oEvent.m_eResultType = static_cast<LiveBinary::LIVE_RESULT>(extractValue<uint8_t>(p0Cur));
+			oEvent.m_nFlags = extractValue<uint8_t>(p0Cur);
+			oEvent.m_nTimeUsec = extractValue<int64_t>(p0Cur);
+			oEvent.m_nPathId = extractValue<int32_t>(p0Cur);
+			oEvent.m_nOtherPathId = extractValue<int32_t>(p0Cur);
+			oEvent.m_nCount = extractValue<int32_t>(p0Cur);
+			return READ_RESULT_EVENT; //----------------------------------------
+		}
+		// unknown record types are skipped
+	}
+	return READ_RESULT_NEED_DATA;
+}
+const std::string& LiveBinaryReader::getPath(int32_t nPathId) const noexcept
+{
+	if ((nPathId < 0) || (nPathId >= static_cast<int32_t>(m_aPaths.size()))) {
+		return s_sEmpty; //-----------------------------------------------------
+	}
+	return m_aPaths[nPathId];
+}
+
+} // namespace fofi
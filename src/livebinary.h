@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   livebinary.h
+ */
+
+#ifndef FOFIMON_LIVE_BINARY_H_
+#define FOFIMON_LIVE_BINARY_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Binary format of the live events (fofimon -l FILE.fofilive).
+ *
+ * The file starts with a header:
+ *
+ *     char[8]  "FOFILIVE"
+ *     uint32   version (2)
+ *     uint32   0x01020304 (byte order mark, all integers are in host byte order)
+ *     int64    wall time (microseconds since the epoch) of the start of watching
+ *
+ * followed by length-prefixed records:
+ *
+ *     uint32   size of the record in bytes (including this field)
+ *     uint8    record type
+ *     ...      payload
+ *
+ * A path record (type 1) defines a path id before an event uses it:
+ *
+ *     int32    path id (new ids are assigned in increasing order from 0)
+ *     char[]   the path in the file system encoding (no terminating null)
+ *
+ * The writer keeps a bounded number of ids: once they are all used an id
+ * is defined again with another path, which replaces the old one from
+ * then on (since version 2).
+ *
+ * An event record (type 2):
+ *
+ *     uint8    action (LIVE_ACTION)
+ *     uint8    result type after the action (LIVE_RESULT)
+ *     uint8    flags (LIVE_FLAG)
+ *     int64    time of the action in microseconds from the start of watching
+ *     int32    path id
+ *     int32    other path id of renames or -1 if unknown
+ *     int32    number of collapsed identical actions (see fofimon --collapse-actions)
+ *
+ * Readers must skip records of unknown type and ignore the bytes following
+ * the known fields of a record, newer versions might add some. */
+class LiveBinary
+{
+public:
+	enum LIVE_ACTION : uint8_t
+	{
+		LIVE_ACTION_CREATE = 0
+		, LIVE_ACTION_DELETE = 1
+		, LIVE_ACTION_MODIFY = 2
+		, LIVE_ACTION_ATTRIB = 3
+		, LIVE_ACTION_RENAME_FROM = 4
+		, LIVE_ACTION_RENAME_TO = 5
+	};
+	enum LIVE_RESULT : uint8_t
+	{
+		LIVE_RESULT_NONE = 0
+		, LIVE_RESULT_CREATED = 1
+		, LIVE_RESULT_DELETED = 2
+		, LIVE_RESULT_MODIFIED = 3
+		, LIVE_RESULT_TEMPORARY = 4
+	};
+	enum LIVE_FLAG : uint8_t
+	{
+		LIVE_FLAG_DIR = 0x01
+		, LIVE_FLAG_INCONSISTENT = 0x02
+		, LIVE_FLAG_IMMEDIATE = 0x04 /**< Not from inotify, for example found by scanning a new directory. */
+		, LIVE_FLAG_ATTRIB_CHANGE = 0x08 /**< Caused by an attribute change. */
+	};
+	enum LIVE_RECORD : uint8_t
+	{
+		LIVE_RECORD_PATH = 1
+		, LIVE_RECORD_EVENT = 2
+	};
+	struct Event
+	{
+		LIVE_ACTION m_eAction = LIVE_ACTION_CREATE;
+		LIVE_RESULT m_eResultType = LIVE_RESULT_NONE;
+		uint8_t m_nFlags = 0; /**< LIVE_FLAG bits. */
+		int64_t m_nTimeUsec = 0; /**< Microseconds from the start of watching. */
+		int32_t m_nPathId = -1;
+		int32_t m_nOtherPathId = -1; /**< The other path of renames or -1. */
+		int32_t m_nCount = 1;
+	};
+	/** The file name extension that selects the format. */
+	static constexpr const char* s_p0Extension = ".fofilive";
+	static const char* getActionCodeString(int32_t nAction) noexcept;
+	static const char* getResultTypeCodeString(int32_t nResultType) noexcept;
+};
+
+/* Encodes live events, defining each path the first time it is used.
+ * When more than a maximum number of paths were defined the ids of those not
+ * used recently are reused (second chance), an evicted path that shows up
+ * again is defined anew. */
+class LiveBinaryWriter
+{
+public:
+	static constexpr int32_t s_nDefaultMaxPaths = 64 * 1024;
+	/** Constructor.
+	 * @param nMaxPaths The maximum number of defined path ids. Must be at least 2.
+	 */
+	explicit LiveBinaryWriter(int32_t nMaxPaths = s_nDefaultMaxPaths) noexcept;
+	/** Writes the header if not already written.
+	 * @param oOut The stream.
+	 * @param nStartWallTimeUsec The wall time of the start of watching.
+	 */
+	void writeHeader(std::ostream& oOut, int64_t nStartWallTimeUsec) noexcept;
+	/** Whether writeHeader() was called.
+	 * @return Whether written.
+	 */
+	bool isHeaderWritten() const noexcept { return m_bHeaderWritten; }
+	/** Writes an event, preceded by the definition of its paths if they are new.
+	 * @param oOut The stream. writeHeader() must have been called.
+	 * @param oEvent The event. Its path ids are ignored.
+	 * @param sPath The path of the file or directory.
+	 * @param p0OtherPath The other path of a rename or null.
+	 */
+	void writeEvent(std::ostream& oOut, const LiveBinary::Event& oEvent, const std::string& sPath, const std::string* p0OtherPath) noexcept;
+	/** The number of defined paths.
+	 * @return The number, at most the maximum passed to the constructor.
+	 */
+	int32_t getTotPaths() const noexcept { return static_cast<int32_t>(m_oPathIds.size()); }
+	/** The number of path definitions written again after their id was reused.
+	 * @return The number of evicted paths.
+	 */
+	int64_t getTotEvictedPaths() const noexcept { return m_nTotEvictedPaths; }
+private:
+	// nKeepId is an id that must not be evicted or -1
+	int32_t getPathId(std::ostream& oOut, const std::string& sPath, int32_t nKeepId) noexcept;
+	int32_t evictPath(int32_t nKeepId) noexcept;
+private:
+	const int32_t m_nMaxPaths;
+	bool m_bHeaderWritten;
+	std::unordered_map<std::string, int32_t> m_oPathIds;
+	std::vector<const std::string*> m_aPathKeys; // Index: path id, Value: the key in m_oPathIds
+	std::vector<bool> m_aPathUsed; // Index: path id, Value: whether used since the clock hand last passed
+	int32_t m_nClockHand; // The next id considered for eviction
+	int64_t m_nTotEvictedPaths;
+	std::string m_sRecord; // reused
+};
+
+/* Decodes a stream written by LiveBinaryWriter.
+ * The data can be fed in chunks of any size, also while the file is growing. */
+class LiveBinaryReader
+{
+public:
+	enum READ_RESULT
+	{
+		READ_RESULT_EVENT = 0 /**< An event was read. */
+		, READ_RESULT_NEED_DATA = 1 /**< More data must be fed. */
+		, READ_RESULT_ERROR = 2 /**< Corrupt data. See getError(). */
+	};
+	LiveBinaryReader() noexcept;
+	~LiveBinaryReader() noexcept;
+	/** Opens a file.
+	 * @param sPathName The file.
+	 * @return Empty string or error.
+	 */
+	std::string open(const std::string& sPathName);
+	/** Reads the data appended to the file since the last call.
+	 * @return The number of bytes read or -1 if error (see getError()).
+	 */
+	int64_t readFile();
+	/** Adds data to be decoded.
+	 * Use instead of open() and readFile() if the data doesn't come from a file.
+	 * @param p0Data The data.
+	 * @param nSize The size.
+	 */
+	void feed(const char* p0Data, size_t nSize);
+	/** Decodes the next event.
+	 * Path records are processed internally.
+	 * @param oEvent Is set to the event if READ_RESULT_EVENT is returned.
+	 * @return The result.
+	 */
+	READ_RESULT next(LiveBinary::Event& oEvent);
+	/** The path of an id.
+	 * Since ids can be defined again, call it before decoding the next event.
+	 * @param nPathId The path id of an event (can be -1).
+	 * @return The path or empty if not defined.
+	 */
+	const std::string& getPath(int32_t nPathId) const noexcept;
+	/** The start of watching.
+	 * @return The wall time in microseconds since the epoch or -1 if the header wasn't read yet.
+	 */
+	int64_t getStartWallTimeUsec() const noexcept { return m_nStartWallTimeUsec; }
+	/** The error.
+	 * @return Empty string or the error.
+	 */
+	const std::string& getError() const noexcept { return m_sError; }
+private:
+	bool readHeader();
+	void compactBuffer() noexcept;
+private:
+	int m_nFD;
+	std::vector<char> m_aBuffer;
+	size_t m_nBufferStart; // the first not decoded byte
+	size_t m_nBufferEnd; // the end of the valid data
+	int64_t m_nStartWallTimeUsec;
+	std::vector<std::string> m_aPaths; // Index: path id
+	std::string m_sError;
+	static const std::string s_sEmpty;
+private:
+	LiveBinaryReader(const LiveBinaryReader& oSource) = delete;
+	LiveBinaryReader& operator=(const LiveBinaryReader& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_LIVE_BINARY_H_ */
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   livemain.cc
+ */
+
+#include "livebinary.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <stdlib.h>
+
+namespace fofi
+{
+
+void printLiveUsage() noexcept
+{
+	std::cout << "Usage: fofimon-live [--follow] [--stats] FILE" << '\n';
+	std::cout << "Prints the events written by 'fofimon -l FILE.fofilive'." << '\n';
+	std::cout << "Each line contains the microseconds from the start of watching, the action," << '\n';
+	std::cout << "the status after the action and the path." << '\n';
+	std::cout << "  --follow   Waits for events appended to FILE (until interrupted)." << '\n';
+	std::cout << "  --stats    Only prints the number of events and the decoding speed." << '\n';
+}
+
+static void printLiveEvent(std::ostream& oOut, const LiveBinaryReader& oReader, const LiveBinary::Event& oEvent) noexcept
+{
+	oOut << oEvent.m_nTimeUsec << ' ' << LiveBinary::getActionCodeString(oEvent.m_eAction)
+			<< ' ' << LiveBinary::getResultTypeCodeString(oEvent.m_eResultType)
+			<< ' ' << oReader.getPath(oEvent.m_nPathId)
+			<< (((oEvent.m_nFlags & LiveBinary::LIVE_FLAG_DIR) != 0) ? "/" : "");
+	const bool bIsRenameFrom = (oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_FROM);
+	if (bIsRenameFrom || (oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_TO)) {
+		oOut << (bIsRenameFrom ? "  (T " : "  (F ");
+		oOut << ((oEvent.m_nOtherPathId < 0) ? std::string{"unknown"} : oReader.getPath(oEvent.m_nOtherPathId)) << ")";
+	}
+	if (oEvent.m_nCount > 1) {
+		oOut << "  (" << oEvent.m_nCount << " times)";
+	}
+	oOut << '\n';
+}
+
+int fofimonLiveMain(int nArgC, char** aArgV) noexcept
+{
+	bool bFollow = false;
+	bool bStats = false;
+	std::string sFile;
+	for (int nArg = 1; nArg < nArgC; ++nArg) {
+		const std::string sArg = aArgV[nArg];
+		if ((sArg == "-h") || (sArg == "--help")) {
+			printLiveUsage();
+			return EXIT_SUCCESS; //---------------------------------------------
+		} else if (sArg == "--follow") {
+			bFollow = true;
+		} else if (sArg == "--stats") {
+			bStats = true;
+		} else if (sFile.empty() && (sArg.substr(0, 1) != "-")) {
+			sFile = sArg;
+		} else {
+			printLiveUsage();
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+	}
+	if (sFile.empty()) {
+		printLiveUsage();
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	LiveBinaryReader oReader;
+	const auto sError = oReader.open(sFile);
+	if (! sError.empty()) {
+		std::cerr << sError << '\n';
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	const auto oStart = std::chrono::steady_clock::now();
+	int64_t nTotEvents = 0;
+	int64_t nTotBytes = 0;
+	LiveBinary::Event oEvent;
+	while (true) {
+		const int64_t nRead = oReader.readFile();
+		if (nRead < 0) {
+			break; // while ----
+		}
+		nTotBytes += nRead;
+		LiveBinaryReader::READ_RESULT eResult;
+		while ((eResult = oReader.next(oEvent)) == LiveBinaryReader::READ_RESULT_EVENT) {
+			++nTotEvents;
+			if (! bStats) {
+				printLiveEvent(std::cout, oReader, oEvent);
+			}
+		}
+		if (eResult == LiveBinaryReader::READ_RESULT_ERROR) {
+			break; // while ----
+		}
+		if (nRead == 0) {
+			if (! bFollow) {
+				break; // while ----
+			}
+			std::cout.flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		}
+	}
+	if (! oReader.getError().empty()) {
+		std::cerr << oReader.getError() << '\n';
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	if (bStats) {
+		const int64_t nElapsedUsec = std::chrono::duration_cast<std::chrono::microseconds>(
+												std::chrono::steady_clock::now() - oStart).count();
+		std::cout << "Events:       " << nTotEvents << '\n';
+		std::cout << "Bytes:        " << nTotBytes << '\n';
+		std::cout << "Decode usec:  " << nElapsedUsec << '\n';
+		if (nElapsedUsec > 0) {
+			std::cout << "Events/sec:   " << (nTotEvents * 1000000 / nElapsedUsec) << '\n';
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+} // namespace fofi
+
+int main(int nArgC, char** aArgV)
+{
+	return fofi::fofimonLiveMain(nArgC, aArgV);
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   livewriter.cc
+ */
+
+#include "livewriter.h"
+
+#include <chrono>
+#include <system_error>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fofi
+{
+
+LiveWriter::LiveWriter() noexcept
+: m_nFD(-1)
+, m_bOpen(false)
+, m_oEntryStream(&m_oEntryStreamBuf)
+, m_nUnsignaledBytes(0)
+, m_nTotStalls(0)
+, m_nMask(0)
+, m_nHead(0)
+, m_nTail(0)
+, m_nTotWrittenBytes(0)
+, m_bWakeUp(false)
+, m_bStop(false)
+{
+	m_oEntryStreamBuf.m_p0Entry = &m_sEntry;
+}
+LiveWriter::~LiveWriter() noexcept
+{
+	close();
+}
+bool LiveWriter::getFsyncPolicyFromName(const std::string& sName, FSYNC_POLICY& eFsyncPolicy) noexcept
+{
+	if (sName == "none") {
+		eFsyncPolicy = FSYNC_POLICY_NONE;
+	} else if (sName == "close") {
+		eFsyncPolicy = FSYNC_POLICY_CLOSE;
+	} else if (sName == "flush") {
+		eFsyncPolicy = FSYNC_POLICY_FLUSH;
+	} else {
+		return false; //--------------------------------------------------------
+	}
+	return true;
+}
+std::string LiveWriter::open(const std::string& sPathName, const Config& oConfig)
+{
+	assert(! m_bOpen);
+	assert(oConfig.m_nFlushIntervalMillisec > 0);
+	assert(oConfig.m_nFlushBytes > 0);
+	assert(oConfig.m_nQueueEntries > 0);
+	m_oConfig = oConfig;
+	m_nFD = ::open(sPathName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (m_nFD < 0) {
+		return "Could not open " + sPathName + ": " + ::strerror(errno); //-----
+	}
+	size_t nTotSlots = 1;
+	while (nTotSlots < static_cast<size_t>(oConfig.m_nQueueEntries)) {
+		nTotSlots *= 2;
+	}
+	m_aSlots.clear();
+	m_aSlots.resize(nTotSlots);
+	m_nMask = nTotSlots - 1;
+	m_nHead.store(0, std::memory_order_relaxed);
+	m_nTail.store(0, std::memory_order_relaxed);
+	m_sEntry.clear();
+	m_nUnsignaledBytes = 0;
+	m_nTotStalls = 0;
+	m_sBuffer.clear();
+	m_sBuffer.reserve(static_cast<size_t>(oConfig.m_nFlushBytes) * 2);
+	m_nTotWrittenBytes.store(0, std::memory_order_relaxed);
+	m_bWakeUp = false;
+	m_bStop = false;
+	m_sError.clear();
+	try {
+		m_oWriterThread = std::thread(&LiveWriter::writerThreadRun, this);
+	} catch (const std::system_error& oErr) {
+		::close(m_nFD);
+		m_nFD = -1;
+		return "Could not start writer thread for " + sPathName + ": " + oErr.what(); //---
+	}
+	m_bOpen = true;
+	return "";
+}
+void LiveWriter::commit() noexcept
+{
+	if (m_sEntry.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	if (! m_bOpen) {
+		m_sEntry.clear();
+		return; //--------------------------------------------------------------
+	}
+	const uint64_t nTail = m_nTail.load(std::memory_order_relaxed);
+	if (nTail - m_nHead.load(std::memory_order_acquire) > m_nMask) {
+		// full
+		++m_nTotStalls;
+		do {
+			wakeUpWriter();
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		} while (nTail - m_nHead.load(std::memory_order_acquire) > m_nMask);
+	}
+	const int64_t nEntrySize = static_cast<int64_t>(m_sEntry.size());
+	// the slot was cleared by the writer thread, swapping reuses its buffer
+	m_aSlots[nTail & m_nMask].swap(m_sEntry);
+	m_nTail.store(nTail + 1, std::memory_order_release);
+	m_sEntry.clear();
+	m_nUnsignaledBytes += nEntrySize;
+	if (m_nUnsignaledBytes >= m_oConfig.m_nFlushBytes) {
+		m_nUnsignaledBytes = 0;
+		wakeUpWriter();
+	}
+}
+std::string LiveWriter::close() noexcept
+{
+	if (! m_bOpen) {
+		return ""; //-----------------------------------------------------------
+	}
+	m_bOpen = false;
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		m_bStop = true;
+	}
+	m_oWakeUpCond.notify_one();
+	m_oWriterThread.join();
+	if (m_oConfig.m_eFsyncPolicy != FSYNC_POLICY_NONE) {
+		if (::fsync(m_nFD) != 0) {
+			setError(std::string("Could not sync live output: ") + ::strerror(errno));
+		}
+	}
+	if (::close(m_nFD) != 0) {
+		setError(std::string("Could not close live output: ") + ::strerror(errno));
+	}
+	m_nFD = -1;
+	return m_sError;
+}
+void LiveWriter::wakeUpWriter() noexcept
+{
+	{
+		std::lock_guard<std::mutex> oLock(m_oMutex);
+		m_bWakeUp = true;
+	}
+	m_oWakeUpCond.notify_one();
+}
+void LiveWriter::setError(const std::string& sError) noexcept
+{
+	std::lock_guard<std::mutex> oLock(m_oMutex);
+	if (m_sError.empty()) {
+		m_sError = sError;
+	}
+}
+void LiveWriter::writerThreadRun() noexcept
+{
+	const auto oInterval = std::chrono::milliseconds(m_oConfig.m_nFlushIntervalMillisec);
+	std::unique_lock<std::mutex> oLock(m_oMutex);
+	while (true) {
+		m_oWakeUpCond.wait_for(oLock, oInterval, [&]()
+		{
+			return m_bWakeUp || m_bStop;
+		});
+		const bool bStop = m_bStop;
+		m_bWakeUp = false;
+		oLock.unlock();
+		// after the stop no more entries can be committed
+		drainQueue();
+		writeBuffer();
+		if (bStop) {
+			break; // while ----
+		}
+		oLock.lock();
+	}
+}
+void LiveWriter::drainQueue() noexcept
+{
+	const uint64_t nHead = m_nHead.load(std::memory_order_relaxed);
+	const uint64_t nTail = m_nTail.load(std::memory_order_acquire);
+	for (uint64_t nCur = nHead; nCur != nTail; ++nCur) {
+		std::string& sSlot = m_aSlots[nCur & m_nMask];
+		m_sBuffer.append(sSlot);
+		sSlot.clear();
+		if (m_sBuffer.size() >= static_cast<size_t>(m_oConfig.m_nFlushBytes)) {
+			writeBuffer();
+		}
+	}
+	m_nHead.store(nTail, std::memory_order_release);
+}
+void LiveWriter::writeBuffer() noexcept
+{
+	if (m_sBuffer.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	const char* p0Data = m_sBuffer.data();
+	size_t nToWrite = m_sBuffer.size();
+	while (nToWrite > 0) {
+		const ssize_t nWritten = ::write(m_nFD, p0Data, nToWrite);
+		if (nWritten < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			// the entries are lost
+			setError(std::string("Could not write live output: ") + ::strerror(errno));
+			break; // while ----
+		}
+		p0Data += nWritten;
+		nToWrite -= static_cast<size_t>(nWritten);
+		m_nTotWrittenBytes.fetch_add(nWritten, std::memory_order_relaxed);
+	}
+	m_sBuffer.clear();
+	if ((nToWrite == 0) && (m_oConfig.m_eFsyncPolicy == FSYNC_POLICY_FLUSH)) {
+		if (::fdatasync(m_nFD) != 0) {
+			setError(std::string("Could not sync live output: ") + ::strerror(errno));
+		}
+	}
+}
+
+LiveWriter::EntryStreamBuf::int_type LiveWriter::EntryStreamBuf::overflow(int_type nC)
+{
+	if (traits_type::eq_int_type(nC, traits_type::eof())) {
+		return traits_type::not_eof(nC); //-------------------------------------
+	}
+	m_p0Entry->push_back(traits_type::to_char_type(nC));
+	return nC;
+}
+std::streamsize LiveWriter::EntryStreamBuf::xsputn(const char_type* p0S, std::streamsize nCount)
+{
+	m_p0Entry->append(p0S, static_cast<size_t>(nCount));
+	return nCount;
+}
+
+} // namespace fofi
@@ -0,0 +1,152 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   livewriter.h
+ */
+
+#ifndef FOFIMON_LIVE_WRITER_H_
+#define FOFIMON_LIVE_WRITER_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <streambuf>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Appends entries (for example live actions) to a file that is kept open.
+ * The entries are formatted by one producer thread and passed through a lock-free
+ * single producer single consumer queue to a writer thread that collects them in
+ * a buffer and writes the buffer when it exceeds a size or at regular intervals.
+ *
+ * Example:
+ *
+ *     oWriter.entry() << "Hello " << nCount << '\n';
+ *     oWriter.commit();
+ *
+ * When the queue is full commit() waits for the writer thread. */
+class LiveWriter
+{
+public:
+	enum FSYNC_POLICY
+	{
+		FSYNC_POLICY_NONE = 0 /**< Leave it to the kernel. */
+		, FSYNC_POLICY_CLOSE = 1 /**< Sync when the file is closed. */
+		, FSYNC_POLICY_FLUSH = 2 /**< Sync after each write of the buffer. */
+	};
+	struct Config
+	{
+		int32_t m_nFlushIntervalMillisec = 1000; /**< Max time entries stay in the buffer. Must be positive. */
+		int32_t m_nFlushBytes = 64 * 1024; /**< The buffer is written when it reaches this size. Must be positive. */
+		int32_t m_nQueueEntries = 4096; /**< Rounded up to a power of two. Must be positive. */
+		FSYNC_POLICY m_eFsyncPolicy = FSYNC_POLICY_NONE;
+	};
+	LiveWriter() noexcept;
+	~LiveWriter() noexcept;
+	/** Creates (or truncates) the file and starts the writer thread.
+	 * @param sPathName The file.
+	 * @param oConfig The configuration.
+	 * @return Empty string or error.
+	 */
+	std::string open(const std::string& sPathName, const Config& oConfig);
+	/** Whether the file is open.
+	 * @return Whether open() succeeded and close() wasn't called.
+	 */
+	bool isOpen() const noexcept { return m_bOpen; }
+	/** The stream to format the next entry.
+	 * Only the producer thread can call this. The entry is queued by commit().
+	 * @return The stream.
+	 */
+	std::ostream& entry() noexcept { return m_oEntryStream; }
+	/** Queues the entry formatted since the last commit().
+	 * Only the producer thread can call this. Empty entries are ignored.
+	 */
+	void commit() noexcept;
+	/** Writes all the queued entries, stops the writer thread and closes the file.
+	 * @return Empty string or the first error that occurred while writing.
+	 */
+	std::string close() noexcept;
+
+	/** The number of bytes written to the file.
+	 * @return The bytes.
+	 */
+	int64_t getTotWrittenBytes() const noexcept { return m_nTotWrittenBytes.load(std::memory_order_relaxed); }
+	/** The number of times commit() had to wait because the queue was full.
+	 * @return The number of stalls.
+	 */
+	int64_t getTotStalls() const noexcept { return m_nTotStalls; }
+
+	/** Parses a policy name ("none", "close" or "flush").
+	 * @param sName The name.
+	 * @param eFsyncPolicy Is set to the policy if valid.
+	 * @return Whether valid.
+	 */
+	static bool getFsyncPolicyFromName(const std::string& sName, FSYNC_POLICY& eFsyncPolicy) noexcept;
+private:
+	void writerThreadRun() noexcept;
+	void drainQueue() noexcept;
+	void writeBuffer() noexcept;
+	void setError(const std::string& sError) noexcept;
+	void wakeUpWriter() noexcept;
+
+	class EntryStreamBuf : public std::streambuf
+	{
+	public:
+		std::string* m_p0Entry = nullptr;
+	protected:
+		int_type overflow(int_type nC) override;
+		std::streamsize xsputn(const char_type* p0S, std::streamsize nCount) override;
+	};
+private:
+	Config m_oConfig;
+	int m_nFD;
+	bool m_bOpen;
+	// Producer
+	std::string m_sEntry;
+	EntryStreamBuf m_oEntryStreamBuf;
+	std::ostream m_oEntryStream;
+	int64_t m_nUnsignaledBytes;
+	int64_t m_nTotStalls;
+	// Queue (m_aSlots.size() is a power of two)
+	std::vector<std::string> m_aSlots;
+	size_t m_nMask;
+	std::atomic<uint64_t> m_nHead; // written by the writer thread
+	std::atomic<uint64_t> m_nTail; // written by the producer
+	// Writer thread
+	std::string m_sBuffer;
+	std::atomic<int64_t> m_nTotWrittenBytes;
+	std::thread m_oWriterThread;
+	std::mutex m_oMutex;
+	std::condition_variable m_oWakeUpCond;
+	bool m_bWakeUp; // guarded by m_oMutex
+	bool m_bStop; // guarded by m_oMutex
+	std::string m_sError; // guarded by m_oMutex
+private:
+	LiveWriter(const LiveWriter& oSource) = delete;
+	LiveWriter& operator=(const LiveWriter& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_LIVE_WRITER_H_ */
@@ -26,8 +26,17 @@
 #include "fofimodel.h"
 #include "util.h"
 #include "inotifiersource.h"
+#include "tracering.h"
+#include "livewriter.h"
+#include "livebinary.h"
+#include "shmring.h"
+#include "eventserver.h"
+#include "sorteddump.h"
+#include "checkpointwriter.h"
+#include "compressstreambuf.h"
 
 #include <glibmm.h>
+#include <glib-unix.h>
 #include <sigc++/sigc++.h>
 
 #include <cassert>
@@ -35,6 +44,7 @@
 #include <numeric>
 #include <algorithm>
 #include <deque>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -44,8 +54,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <errno.h>
 #include <limits.h>
@@ -72,6 +84,30 @@ void printUsage() noexcept
 	std::cout << "  --dont-watch            Doesn't start watching." << '\n';
 	std::cout << "  -f --add-file FILEPATH  Adds file FILEPATH to watch (unaffected by zone filters)." << '\n';
 	std::cout << "  -z --add-zone DIRPATH   Adds a watched zone with base directory DIRPATH." << '\n';
+	std::cout << "  --spill-dir DIR         Moves the modifications of files that are inactive" << '\n';
+	std::cout << "                          to a temporary file in DIR to save memory." << '\n';
+	std::cout << "  --spill-after SECS      Inactivity in seconds after which the modifications" << '\n';
+	std::cout << "                          of a file are moved (default: 60)." << '\n';
+	std::cout << "  --snapshot FILE         Continues the session saved in FILE if it exists and" << '\n';
+	std::cout << "                          saves the session to FILE when stopped." << '\n';
+	std::cout << "  --snapshot-every SECS   Also saves the session to FILE every SECS seconds (default: 0," << '\n';
+	std::cout << "                          only when stopped)." << '\n';
+	std::cout << "  --scan-cache FILE       Reuses the directory listings stored in FILE if the" << '\n';
+	std::cout << "                          directories weren't modified, to speed up the setup." << '\n';
+	std::cout << "  --metrics FILE          Periodically writes the metrics to FILE (Prometheus text" << '\n';
+	std::cout << "                          format or json if FILE ends with '.json'). Also written" << '\n';
+	std::cout << "                          when signal SIGUSR1 is received and when stopped." << '\n';
+	std::cout << "  --metrics-every SECS    Interval in seconds between metrics writes (default: 60)." << '\n';
+	std::cout << "  --checkpoint FILE       Periodically writes the results modified since the previous" << '\n';
+	std::cout << "                          checkpoint to numbered files derived from FILE and lists" << '\n';
+	std::cout << "                          them in a manifest (json if FILE ends with '.json'). Also" << '\n';
+	std::cout << "                          written when stopped." << '\n';
+	std::cout << "  --checkpoint-every SECS Interval in seconds between checkpoints (default: 300)." << '\n';
+	std::cout << "  --checkpoint-keep N     Keeps only the last N checkpoint files (default: all)." << '\n';
+	std::cout << "  --trace FILE            Records what happens in a ring buffer and writes it to FILE" << '\n';
+	std::cout << "                          when aborted, when signal SIGUSR2 is received and when" << '\n';
+	std::cout << "                          stopped with inconsistencies. Decode with fofimon-trace." << '\n';
+	std::cout << "  --trace-records N       The number of records kept by the ring (default: 65536)." << '\n';
 	std::cout << "Zone options (must follow --add-zone):" << '\n';
 	std::cout << "  -m --max-depth DEPTH    Sets the max depth of a zone. Examples of DEPTH:" << '\n';
 	std::cout << "                          0: just watches the base path of the zone (default)." << '\n';
@@ -88,15 +124,49 @@ void printUsage() noexcept
 	std::cout << "  --exclude-dir NAME      Excludes dir name. Overrides includes." << '\n';
 	std::cout << "  --exclude-all           Excludes all dir and file names. Overrides includes." << '\n';
 	std::cout << "                          Same as defining regular expression filters \".*\"." << '\n';
-	std::cout << "Output options (if OUT ends with '.json', json output is used):" << '\n';
+	std::cout << "Output options (if OUT ends with '.json', json output is used," << '\n';
+	std::cout << "                if it ends with '.ndjson', newline delimited json," << '\n';
+	std::cout << "                if it ends with '.gz' or '.zst', it is compressed, as in 'out.json.gz'):" << '\n';
 	std::cout << "  --print-zones [OUT]       Prints directory zones (to OUT file if given)." << '\n';
 	std::cout << "  --print-watched [OUT]     Prints initial to be watched directories (to OUT file if given)." << '\n';
 	std::cout << "  -l --live-events [OUTL]   Prints single events as they happen" << '\n';
-	std::cout << "                            (to OUTL file if given, no json)." << '\n';
+	std::cout << "                            (to OUTL file if given, no json). If OUTL ends with" << '\n';
+	std::cout << "                            '.fofilive' the compact binary format is used (see fofimon-live)." << '\n';
+	std::cout << "  --live-flush-ms MSECS     Max time events written to OUTL stay buffered (default: 1000)." << '\n';
+	std::cout << "  --live-flush-bytes N      Buffered events are written to OUTL when they reach N bytes" << '\n';
+	std::cout << "                            (default: 65536)." << '\n';
+	std::cout << "  --live-fsync POLICY       When OUTL is synced to disk: 'none' (default), 'close'" << '\n';
+	std::cout << "                            or 'flush' (each time the buffer is written)." << '\n';
+	std::cout << "  --live-shm NAME           Publishes single events as they happen to a ring buffer" << '\n';
+	std::cout << "                            in /dev/shm/NAME (see fofimon-tail)." << '\n';
+	std::cout << "  --live-shm-slots N        The number of events kept by the ring buffer (default: 16384)." << '\n';
+	std::cout << "  --live-socket PATH        Serves single events as they happen to the subscribers" << '\n';
+	std::cout << "                            connected to unix socket PATH (one json per line)." << '\n';
+	std::cout << "                            Subscribers can send 'prefix DIRPATH' and" << '\n';
+	std::cout << "                            'actions CREATE,DELETE,MODIFY,ATTRIB,RENAME_FROM,RENAME_TO'" << '\n';
+	std::cout << "                            lines to only receive some events." << '\n';
+	std::cout << "  --live-socket-queue N     The max number of events queued for a subscriber (default: 4096)." << '\n';
+	std::cout << "  --live-socket-policy P    When the queue of a subscriber is full: 'drop' (default)" << '\n';
+	std::cout << "                            the events or 'disconnect' the subscriber." << '\n';
 	std::cout << "  -o --print-modified [OUT] Prints watched modifications after Control-D is pressed" << '\n';
 	std::cout << "                            (to OUT file if given)." << '\n';
+	std::cout << "  --sort-modified           Prints watched modifications sorted by path and grouped by" << '\n';
+	std::cout << "                            directory, with the number of modifications in each subtree." << '\n';
+	std::cout << "  --sort-threads N          The max number of threads used to sort and format the" << '\n';
+	std::cout << "                            watched modifications (default: number of processors)." << '\n';
 	std::cout << "  --skip-temporary          Don't show temporary files in watched modifications." << '\n';
+	std::cout << "                            Their memory is reclaimed while watching." << '\n';
 	std::cout << "  --show-detail             Show more info (-l and -o outputs)." << '\n';
+	std::cout << "  --collapse-actions        Show identical consecutive actions of a file once" << '\n';
+	std::cout << "                            with a count (detailed output)." << '\n';
+	std::cout << "  --max-actions N           Keep only the last N actions of a file (detailed output)." << '\n';
+	std::cout << "  --print-latencies [OUT]   Prints the event processing latencies after Control-D is pressed" << '\n';
+	std::cout << "                            (to OUT file if given). Signal SIGUSR1 prints them while watching." << '\n';
+	std::cout << "  --print-summary DEPTH [OUT]" << '\n';
+	std::cout << "                            Prints the number of created, modified, deleted and temporary" << '\n';
+	std::cout << "                            files in the subtree of each directory after Control-D is pressed" << '\n';
+	std::cout << "                            (to OUT file if given). Directories deeper than DEPTH relative" << '\n';
+	std::cout << "                            to their zone are left out." << '\n';
 	std::cout << "Output codes:" << '\n';
 	std::cout << "  Events (-l output):     State (-o output):" << '\n';
 	std::cout << "    c: create               C: created" << '\n';
@@ -111,15 +181,48 @@ struct OutputFile
 	std::string m_sPathName;
 	bool m_bCreated = false;
 	bool m_bJSON = false;
+	bool m_bNDJSON = false; /**< Newline delimited json. If true m_bJSON is also true. */
 };
+bool isNDJSON(const std::string& sPathName) noexcept
+{
+	const std::string sName = CompressStreamBuf::getUncompressedPathName(sPathName);
+	return (sName.size() > 7) && (sName.substr(sName.size() - 7) == ".ndjson");
+}
+bool isLiveBinary(const std::string& sPathName) noexcept
+{
+	const std::string sExt = LiveBinary::s_p0Extension;
+	return (sPathName.size() > sExt.size()) && (sPathName.substr(sPathName.size() - sExt.size()) == sExt);
+}
 bool isJSON(const std::string& sPathName) noexcept
 {
-	return (sPathName.size() > 5) && (sPathName.substr(sPathName.size() - 5) == ".json");
+	const std::string sName = CompressStreamBuf::getUncompressedPathName(sPathName);
+	return ((sName.size() > 5) && (sName.substr(sName.size() - 5) == ".json")) || isNDJSON(sName);
 }
 template<typename P>
 void printOutput(OutputFile& oOutFile, P oP)
 {
-	if (! oOutFile.m_sPathName.empty()) {
+	const auto eCompression = CompressStreamBuf::getCompression(oOutFile.m_sPathName);
+	if (eCompression != CompressStreamBuf::COMPRESSION_NONE) {
+		// compressed while being written, appending adds a gzip member or zstd frame
+		const bool bAppend = oOutFile.m_bCreated;
+		CompressStreamBuf oCompressBuf;
+		auto sError = oCompressBuf.open(oOutFile.m_sPathName, eCompression, bAppend);
+		if (! sError.empty()) {
+			std::cerr << "Error: " << sError << '\n';
+			return; //----------------------------------------------------------
+		}
+		{
+			std::ostream oOut(&oCompressBuf);
+			oP(oOut, oOutFile.m_bJSON);
+		}
+		sError = oCompressBuf.close();
+		if (! sError.empty()) {
+			std::cerr << "Error: " << sError << '\n';
+		}
+		if (!bAppend) {
+			oOutFile.m_bCreated = true;
+		}
+	} else if (! oOutFile.m_sPathName.empty()) {
 		const bool bAppend = oOutFile.m_bCreated;
 		std::ofstream oOut(oOutFile.m_sPathName, (bAppend ? std::ios::app : std::ios::out));
 		if (! oOut) {
@@ -134,6 +237,27 @@ void printOutput(OutputFile& oOutFile, P oP)
 		oP(std::cout, oOutFile.m_bJSON);
 	}
 }
+// Same as printOutput but passes a file descriptor
+template<typename P>
+void printOutputFD(OutputFile& oOutFile, P oP)
+{
+	if (! oOutFile.m_sPathName.empty()) {
+		const bool bAppend = oOutFile.m_bCreated;
+		const int nFD = ::open(oOutFile.m_sPathName.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (bAppend ? O_APPEND : O_TRUNC), 0644);
+		if (nFD < 0) {
+			std::cerr << "Error: opening " << oOutFile.m_sPathName << '\n';
+			return; //----------------------------------------------------------
+		}
+		oP(nFD, oOutFile.m_bJSON);
+		::close(nFD);
+		if (!bAppend) {
+			oOutFile.m_bCreated = true;
+		}
+	} else {
+		std::cout.flush();
+		oP(STDOUT_FILENO, oOutFile.m_bJSON);
+	}
+}
 void printNoZoneError(const std::string& sMatch) noexcept
 {
 	std::cerr << "Error: --add-zone must be defined before " << sMatch << '\n';
@@ -149,16 +273,42 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 	bool bDontWatch = false;
 	bool bSkipTemporary = false;
 	bool bShowDetail = false;
+	bool bSortModified = false;
+	int32_t nSortThreads = 0;
+	bool bCollapseActions = false;
+	int32_t nMaxActions = 0;
 	bool bPrintZones = false;
 	bool bPrintToWatchDirs = false;
 	bool bPrintToWatchAfterDirs = false;
 	bool bPrintLiveActions = false;
 	bool bPrintModified = false;
+	bool bPrintLatencies = false;
+	bool bPrintSummary = false;
+	int32_t nSummaryDepth = 0;
 	std::string sOutFileZones;
 	std::string sOutFileToWatchDirs;
 	std::string sOutFileToWatchAfterDirs;
 	std::string sOutFileLiveActions;
 	std::string sOutFileModified;
+	std::string sOutFileLatencies;
+	std::string sOutFileSummary;
+	LiveWriter::Config oLiveConfig;
+	std::string sLiveShmName;
+	ShmRing::Config oShmConfig;
+	std::string sLiveSocket;
+	EventServer::Config oServerConfig;
+	std::string sSpillDir;
+	int32_t nSpillAfterSecs = 60;
+	std::string sSnapshotFile;
+	int32_t nSnapshotEverySecs = 0;
+	std::string sScanCacheFile;
+	std::string sMetricsFile;
+	int32_t nMetricsEverySecs = 60;
+	std::string sCheckpointFile;
+	int32_t nCheckpointEverySecs = 300;
+	int32_t nCheckpointKeep = 0;
+	std::string sTraceFile;
+	int32_t nTraceRecords = 65536;
 
 	std::vector<std::string> aToWatchFiles;
 	std::vector<FofiModel::DirectoryZone> aDZs;
@@ -185,6 +335,8 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		evalBoolArg(nArgC, aArgV, "--dont-watch", "", sMatch, bDontWatch);
 		evalBoolArg(nArgC, aArgV, "--skip-temporary", "", sMatch, bSkipTemporary);
 		evalBoolArg(nArgC, aArgV, "--show-detail", "", sMatch, bShowDetail);
+		evalBoolArg(nArgC, aArgV, "--sort-modified", "", sMatch, bSortModified);
+		evalBoolArg(nArgC, aArgV, "--collapse-actions", "", sMatch, bCollapseActions);
 		bool bOk = evalPathNameArg(nArgC, aArgV, false, "--print-zones", "", false, sMatch, sOutFileZones);
 		if (!bOk) {
 			return EXIT_FAILURE; //---------------------------------------------
@@ -220,6 +372,83 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		if (! sMatch.empty()) {
 			bPrintModified = true;
 		}
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--print-latencies", "", false, sMatch, sOutFileLatencies);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		if (! sMatch.empty()) {
+			bPrintLatencies = true;
+		}
+		bOk = evalIntArg(nArgC, aArgV, "--print-summary", "", sMatch, nSummaryDepth, 0);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		if (! sMatch.empty()) {
+			bPrintSummary = true;
+			if ((nArgC >= 2) && (aArgV[1] != nullptr) && (aArgV[1][0] != '-')) {
+				// the optional OUT file
+				sOutFileSummary = aArgV[1];
+				--nArgC;
+				++aArgV;
+			}
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--live-flush-ms", "", sMatch, oLiveConfig.m_nFlushIntervalMillisec, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--live-flush-bytes", "", sMatch, oLiveConfig.m_nFlushBytes, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, true, "--live-fsync", "", true, sMatch, sRes);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		if (! sMatch.empty()) {
+			if (! LiveWriter::getFsyncPolicyFromName(sRes, oLiveConfig.m_eFsyncPolicy)) {
+				std::cerr << "Error: " << sMatch << " unknown policy " << sRes << '\n';
+				return EXIT_FAILURE; //-----------------------------------------
+			}
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, true, "--live-shm", "", true, sMatch, sLiveShmName);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--live-shm-slots", "", sMatch, oShmConfig.m_nTotSlots, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--live-socket", "", true, sMatch, sLiveSocket);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--live-socket-queue", "", sMatch, oServerConfig.m_nMaxQueuedEvents, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, true, "--live-socket-policy", "", true, sMatch, sRes);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		if (! sMatch.empty()) {
+			if (! EventServer::getFullPolicyFromName(sRes, oServerConfig.m_eFullPolicy)) {
+				std::cerr << "Error: " << sMatch << " unknown policy " << sRes << '\n';
+				return EXIT_FAILURE; //-----------------------------------------
+			}
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--sort-threads", "", sMatch, nSortThreads, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
 		//
 		bOk = evalIntArg(nArgC, aArgV, "--max-watched-dirs", "", sMatch, nMaxToWatchDirectories, 1);
 		if (!bOk) {
@@ -231,6 +460,71 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 			return EXIT_FAILURE; //---------------------------------------------
 		}
 		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--spill-dir", "", true, sMatch, sSpillDir);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--spill-after", "", sMatch, nSpillAfterSecs, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--max-actions", "", sMatch, nMaxActions, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--snapshot", "", true, sMatch, sSnapshotFile);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--snapshot-every", "", sMatch, nSnapshotEverySecs, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--scan-cache", "", true, sMatch, sScanCacheFile);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--metrics", "", true, sMatch, sMetricsFile);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--metrics-every", "", sMatch, nMetricsEverySecs, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--checkpoint", "", true, sMatch, sCheckpointFile);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--checkpoint-every", "", sMatch, nCheckpointEverySecs, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--checkpoint-keep", "", sMatch, nCheckpointKeep, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalPathNameArg(nArgC, aArgV, false, "--trace", "", true, sMatch, sTraceFile);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
+		bOk = evalIntArg(nArgC, aArgV, "--trace-records", "", sMatch, nTraceRecords, 1);
+		if (!bOk) {
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		//
 		bOk = evalPathNameArg(nArgC, aArgV, false, "--add-file", "-f", true, sMatch, sRes);
 		if (!bOk) {
 			return EXIT_FAILURE; //---------------------------------------------
@@ -402,6 +696,18 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 	const int32_t nReserveWatchedDirs = INotifierSource::getSystemMaxUserWatches();
 
 	FofiModel oFofiModel(std::make_unique<INotifierSource>(nReserveWatchedDirs), nMaxToWatchDirectories, nMaxResultPaths, bIsRoot);
+	// temporary results aren't shown anyway
+	oFofiModel.setRecycleTemporary(bSkipTemporary);
+	oFofiModel.setActionCompaction(bCollapseActions, nMaxActions);
+	if (! sSpillDir.empty()) {
+		oFofiModel.setResultSpill(sSpillDir, static_cast<int64_t>(nSpillAfterSecs) * 1000000);
+	}
+	if (! sScanCacheFile.empty()) {
+		oFofiModel.setScanCache(sScanCacheFile);
+	}
+	if (! sTraceFile.empty()) {
+		oFofiModel.setTraceCapacity(nTraceRecords);
+	}
 
 	for (auto& sFile : aToWatchFiles) {
 		const auto sRet = oFofiModel.addToWatchFile(std::move(sFile));
@@ -445,22 +751,98 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 	OutputFile oZonesOF;
 	oZonesOF.m_sPathName = sOutFileZones;
 	oZonesOF.m_bJSON = isJSON(sOutFileZones);
+	oZonesOF.m_bNDJSON = isNDJSON(sOutFileZones);
 	//
 	OutputFile oTWDOF;
 	oTWDOF.m_sPathName = sOutFileToWatchDirs;
 	oTWDOF.m_bJSON = isJSON(sOutFileToWatchDirs);
+	oTWDOF.m_bNDJSON = isNDJSON(sOutFileToWatchDirs);
 	//
-	OutputFile oLiveOF;
-	oLiveOF.m_sPathName = sOutFileLiveActions;
-	oLiveOF.m_bJSON = isJSON(sOutFileLiveActions);
+	// The live events file is kept open and written by another thread
+	LiveWriter oLiveWriter;
+	LiveBinaryWriter oLiveBinaryWriter;
+	const bool bLiveBinary = isLiveBinary(sOutFileLiveActions);
 	//
 	OutputFile oTWDAfterOF;
 	oTWDAfterOF.m_sPathName = sOutFileToWatchAfterDirs;
 	oTWDAfterOF.m_bJSON = isJSON(sOutFileToWatchAfterDirs);
+	oTWDAfterOF.m_bNDJSON = isNDJSON(sOutFileToWatchAfterDirs);
 	//
 	OutputFile oModifiedOF;
 	oModifiedOF.m_sPathName = sOutFileModified;
 	oModifiedOF.m_bJSON = isJSON(sOutFileModified);
+	oModifiedOF.m_bNDJSON = isNDJSON(sOutFileModified);
+	//
+	OutputFile oSummaryOF;
+	oSummaryOF.m_sPathName = sOutFileSummary;
+	oSummaryOF.m_bJSON = isJSON(sOutFileSummary);
+	oSummaryOF.m_bNDJSON = isNDJSON(sOutFileSummary);
+	//
+	OutputFile oLatenciesOF;
+	oLatenciesOF.m_sPathName = sOutFileLatencies;
+	oLatenciesOF.m_bJSON = isJSON(sOutFileLatencies);
+	const auto& oPrintLatencies = [&]()
+	{
+		printOutput(oLatenciesOF, [&](std::ostream& oOut, bool bJSON)
+			{
+				if (bJSON) {
+					printLatenciesJSon(oOut, oFofiModel);
+				} else {
+					printLatencies(oOut, oFofiModel);
+				}
+			});
+	};
+	// the metrics are not compressed
+	const bool bMetricsJSON = isJSON(sMetricsFile)
+								&& (CompressStreamBuf::getCompression(sMetricsFile) == CompressStreamBuf::COMPRESSION_NONE);
+	const auto& oWriteMetrics = [&]()
+	{
+		// a reader never sees a partially written file
+		const auto sError = Util::writeFileAtomically(sMetricsFile, [&](std::ostream& oOut)
+			{
+				if (bMetricsJSON) {
+					printMetricsJSon(oOut, oFofiModel);
+				} else {
+					printMetrics(oOut, oFofiModel);
+				}
+				return std::string{};
+			});
+		if (! sError.empty()) {
+			std::cerr << "Error: " << sError << '\n';
+		}
+	};
+	CheckpointWriter oCheckpointWriter;
+	if (! sCheckpointFile.empty()) {
+		CheckpointWriter::Config oCheckpointConfig;
+		oCheckpointConfig.m_nMaxFiles = nCheckpointKeep;
+		oCheckpointConfig.m_bDetail = bShowDetail;
+		oCheckpointConfig.m_bSkipTemporary = bSkipTemporary;
+		oCheckpointWriter.init(sCheckpointFile, oCheckpointConfig);
+	}
+	const auto& oWriteCheckpoint = [&]()
+	{
+		const auto sCheckpointError = oCheckpointWriter.write(oFofiModel);
+		if (! sCheckpointError.empty()) {
+			std::cerr << sCheckpointError << '\n';
+		}
+	};
+	const auto& oWriteTrace = [&](const std::string& sReason)
+	{
+		const auto sTraceError = TraceRing::save(sTraceFile, oFofiModel.getTraceDump(sReason));
+		if (! sTraceError.empty()) {
+			std::cerr << sTraceError << '\n';
+		}
+	};
+	// On SIGUSR1
+	const std::function<void()> oDumpOnDemand = [&]()
+	{
+		if (bPrintLatencies) {
+			oPrintLatencies();
+		}
+		if (! sMetricsFile.empty()) {
+			oWriteMetrics();
+		}
+	};
 
 	const auto& oPrintZones = [&]()
 	{
@@ -468,7 +850,7 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 			printOutput(oZonesOF, [&](std::ostream& oOut, bool bJSon)
 				{
 					if (bJSon) {
-						printZonesJSon(oOut, oFofiModel);
+						printZonesJSon(oOut, oFofiModel, oZonesOF.m_bNDJSON);
 					} else {
 						printZones(oOut, oFofiModel);
 					}
@@ -501,7 +883,7 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 				printOutput(oTWDOF, [&](std::ostream& oOut, bool bJSON)
 					{
 						if (bJSON){
-							printToWatchDirsJSon(oOut, oFofiModel, true);
+							printToWatchDirsJSon(oOut, oFofiModel, true, oTWDOF.m_bNDJSON);
 						} else {
 							printToWatchDirs(oOut, oFofiModel, true);
 						}
@@ -521,7 +903,7 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		std::cout << "Setting up initial watches: this may take a while ..." << '\n';
 	}
 
-	if ((!bPrintLiveActions) && (!bPrintModified)) {
+	if ((!bPrintLiveActions) && (!bPrintModified) && (!bPrintSummary)) {
 		bPrintModified = true;
 	}
 
@@ -529,20 +911,46 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 	oFofiModel.m_oAbortSignal.connect([&](const std::string& sError)
 	{
 		sFatalError = sError;
+		if (! sTraceFile.empty()) {
+			oWriteTrace("Aborted: " + sError);
+		}
 		refML->quit();
 	});
 	if (bPrintLiveActions) {
+		if (! sOutFileLiveActions.empty()) {
+			const auto sLiveError = oLiveWriter.open(sOutFileLiveActions, oLiveConfig);
+			if (! sLiveError.empty()) {
+				std::cerr << sLiveError << '\n';
+				return EXIT_FAILURE; //-----------------------------------------
+			}
+		}
 		oFofiModel.m_oWatchedResultActionSignal.connect([&](const FofiModel::WatchedResult& oWR)
 		{
-			printOutput(oLiveOF, [&](std::ostream& oOut, bool /*bJSON*/)
-				{
-					printLiveAction(oOut, oWR, bShowDetail);
-				});
+			if (bLiveBinary) {
+				printLiveActionBinary(oLiveBinaryWriter, oLiveWriter.entry(), oFofiModel, oWR);
+				oLiveWriter.commit();
+			} else if (oLiveWriter.isOpen()) {
+				printLiveAction(oLiveWriter.entry(), oFofiModel, oWR, bShowDetail);
+				oLiveWriter.commit();
+			} else {
+				printLiveAction(std::cout, oFofiModel, oWR, bShowDetail);
+			}
 		});
 	}
 	oPrintZones();
 
-	const auto sRet = oFofiModel.start();
+	std::string sRet;
+	if ((! sSnapshotFile.empty()) && Util::FileStat::create(sSnapshotFile).exists()) {
+		sRet = oFofiModel.resume(sSnapshotFile);
+		if (sRet.empty()) {
+			std::cout << "Resumed session from " << sSnapshotFile << '\n';
+		} else {
+			std::cerr << "Warning! Could not resume session: " << sRet << '\n';
+		}
+	}
+	if (! oFofiModel.isWatching()) {
+		sRet = oFofiModel.start();
+	}
 	if (! sRet.empty()) {
 		std::cerr << sRet << '\n';
 		return EXIT_FAILURE; //-------------------------------------------------
@@ -552,13 +960,49 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		printOutput(oTWDOF, [&](std::ostream& oOut, bool bJSON)
 			{
 				if (bJSON){
-					printToWatchDirsJSon(oOut, oFofiModel, false);
+					printToWatchDirsJSon(oOut, oFofiModel, false, oTWDOF.m_bNDJSON);
 				} else {
 					printToWatchDirs(oOut, oFofiModel, false);
 				}
 			});
 	}
 
+	// created after starting so that the start time is known
+	ShmRing oShmRing;
+	if (! sLiveShmName.empty()) {
+		const auto sShmError = oShmRing.create(sLiveShmName, oShmConfig, getStartWallTimeUsec(oFofiModel));
+		if (! sShmError.empty()) {
+			std::cerr << sShmError << '\n';
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		oFofiModel.m_oWatchedResultActionSignal.connect([&](const FofiModel::WatchedResult& oWR)
+		{
+			std::string sPath;
+			std::string sOtherPath;
+			const LiveBinary::Event oEvent = getLiveBinaryEvent(oFofiModel, oWR, sPath, sOtherPath);
+			oShmRing.publish(oEvent, sPath, (sOtherPath.empty() ? nullptr : &sOtherPath));
+		});
+	}
+
+	EventServer oEventServer;
+	if (! sLiveSocket.empty()) {
+		const auto sServerError = oEventServer.listen(sLiveSocket, oServerConfig);
+		if (! sServerError.empty()) {
+			std::cerr << sServerError << '\n';
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+		oFofiModel.m_oWatchedResultActionSignal.connect([&](const FofiModel::WatchedResult& oWR)
+		{
+			if (oEventServer.getTotSubscribers() == 0) {
+				return; //------------------------------------------------------
+			}
+			std::string sPath;
+			std::string sOtherPath;
+			const LiveBinary::Event oEvent = getLiveBinaryEvent(oFofiModel, oWR, sPath, sOtherPath);
+			oEventServer.publish(oEvent, sPath, sOtherPath);
+		});
+	}
+
 	oPrintTotalWatchedDirs(true);
 	std::cout << "Press 'Control-D' to stop watching ..." << '\n';
 
@@ -580,15 +1024,100 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		return bContinue;
 	}, refStdIn, Glib::IO_IN | Glib::IO_HUP);
 
+	const guint nSigUsr1SourceId = ::g_unix_signal_add(SIGUSR1, [](gpointer p0Data) -> gboolean
+	{
+		(*static_cast<const std::function<void()>*>(p0Data))();
+		return G_SOURCE_CONTINUE;
+	}, const_cast<std::function<void()>*>(&oDumpOnDemand));
+	// On SIGUSR2
+	const std::function<void()> oTraceOnDemand = [&]()
+	{
+		if (! sTraceFile.empty()) {
+			oWriteTrace("SIGUSR2");
+		}
+	};
+	const guint nSigUsr2SourceId = ::g_unix_signal_add(SIGUSR2, [](gpointer p0Data) -> gboolean
+	{
+		(*static_cast<const std::function<void()>*>(p0Data))();
+		return G_SOURCE_CONTINUE;
+	}, const_cast<std::function<void()>*>(&oTraceOnDemand));
+	sigc::connection oMetricsConn;
+	if (! sMetricsFile.empty()) {
+		oWriteMetrics();
+		oMetricsConn = Glib::signal_timeout().connect([&]() -> bool
+		{
+			oWriteMetrics();
+			return true;
+		}, nMetricsEverySecs * 1000);
+	}
+	sigc::connection oCheckpointConn;
+	if (! sCheckpointFile.empty()) {
+		oCheckpointConn = Glib::signal_timeout().connect([&]() -> bool
+		{
+			oWriteCheckpoint();
+			return true;
+		}, nCheckpointEverySecs * 1000);
+	}
+	const auto oSaveSnapshot = [&]()
+	{
+		const auto sSnapshotError = oFofiModel.saveSnapshot(sSnapshotFile);
+		if (! sSnapshotError.empty()) {
+			std::cerr << sSnapshotError << '\n';
+		}
+	};
+	sigc::connection oSnapshotConn;
+	if ((! sSnapshotFile.empty()) && (nSnapshotEverySecs > 0)) {
+		// the file is replaced atomically, a crash leaves the previous snapshot
+		oSnapshotConn = Glib::signal_timeout().connect([&]() -> bool
+		{
+			oSaveSnapshot();
+			return true;
+		}, nSnapshotEverySecs * 1000);
+	}
+
 	refML->run();
 
+	oSnapshotConn.disconnect();
+	oCheckpointConn.disconnect();
+	oMetricsConn.disconnect();
+	::g_source_remove(nSigUsr1SourceId);
+	::g_source_remove(nSigUsr2SourceId);
+
 	oFofiModel.stop();
 
+	oShmRing.close();
+	oEventServer.close();
+	if (oEventServer.getTotDropped() > 0) {
+		std::cerr << "Warning! Dropped " << oEventServer.getTotDropped() << " events for slow socket subscribers" << '\n';
+	}
+	if (oEventServer.getTotDisconnected() > 0) {
+		std::cerr << "Warning! Disconnected " << oEventServer.getTotDisconnected() << " slow socket subscribers" << '\n';
+	}
+
+	if (oLiveWriter.isOpen()) {
+		const auto sLiveError = oLiveWriter.close();
+		if (! sLiveError.empty()) {
+			std::cerr << sLiveError << '\n';
+		}
+	}
+
+	if (! sCheckpointFile.empty()) {
+		oWriteCheckpoint();
+	}
+
+	if (! sSnapshotFile.empty()) {
+		oSaveSnapshot();
+	}
+
 	const int64_t nDuration = oFofiModel.getDuration();
 	std::cout << "Total time (seconds): " << Util::getTimeString(nDuration, nDuration) << '\n';
 
 	if (oFofiModel.hasInconsistencies()) {
 		std::cout << "Warning! Inconsistencies where detected. The results might not be accurate." << '\n';
+		if ((! sTraceFile.empty()) && sFatalError.empty()) {
+			oWriteTrace("Inconsistencies");
+			std::cout << "         Trace written to " << sTraceFile << '\n';
+		}
 	}
 	if (oFofiModel.hasQueueOverflown()) {
 		std::cout << "Warning! INotify event buffer did overflow." << '\n';
@@ -603,7 +1132,7 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		printOutput(oTWDAfterOF, [&](std::ostream& oOut, bool bJSON)
 			{
 				if (bJSON){
-					printToWatchDirsJSon(oOut, oFofiModel, false);
+					printToWatchDirsJSon(oOut, oFofiModel, false, oTWDAfterOF.m_bNDJSON);
 				} else {
 					printToWatchDirs(oOut, oFofiModel, false);
 					if (bAborted) {
@@ -614,37 +1143,97 @@ int fofimonMain(int nArgC, char** aArgV) noexcept
 		oPrintTotalWatchedDirs(false);
 	}
 
-	if (bPrintModified) {
+	if (bPrintLatencies) {
+		oPrintLatencies();
+	}
+	if (! sMetricsFile.empty()) {
+		oWriteMetrics();
+	}
+
+	if (bPrintModified && bSortModified) {
+		SortedDump::Config oSortConfig;
+		oSortConfig.m_bJSon = oModifiedOF.m_bJSON;
+		oSortConfig.m_bNDJSon = oModifiedOF.m_bNDJSON;
+		oSortConfig.m_bDetail = bShowDetail;
+		oSortConfig.m_bSkipTemporary = bSkipTemporary;
+		oSortConfig.m_nTotThreads = nSortThreads;
+		SortedDump oSortedDump(oFofiModel, oSortConfig);
+		const auto sSortError = oSortedDump.sort();
+		if (! sSortError.empty()) {
+			std::cerr << sSortError << '\n';
+		}
+		if (CompressStreamBuf::getCompression(oModifiedOF.m_sPathName) != CompressStreamBuf::COMPRESSION_NONE) {
+			printOutput(oModifiedOF, [&](std::ostream& oOut, bool bJSON)
+				{
+					const auto sWriteError = oSortedDump.write(oOut, nDuration);
+					if (! sWriteError.empty()) {
+						std::cerr << sWriteError << '\n';
+						return; //----------------------------------------------
+					}
+					if ((! bJSON) && bAborted) {
+						oOut << "Aborted! " << sFatalError << '\n';
+					}
+				});
+		} else {
+			printOutputFD(oModifiedOF, [&](int nFD, bool bJSON)
+				{
+					const auto sWriteError = oSortedDump.write(nFD, nDuration);
+					if (! sWriteError.empty()) {
+						std::cerr << sWriteError << '\n';
+						return; //----------------------------------------------
+					}
+					if ((! bJSON) && bAborted) {
+						const std::string sAborted = "Aborted! " + sFatalError + "\n";
+						if (::write(nFD, sAborted.data(), sAborted.size()) < 0) {
+							std::cerr << "Error: writing " << oModifiedOF.m_sPathName << '\n';
+						}
+					}
+				});
+		}
+	} else if (bPrintModified) {
 		printOutput(oModifiedOF, [&](std::ostream& oOut, bool bJSON)
 			{
+				JsonWriter oJsonWriter(oOut, oModifiedOF.m_bNDJSON);
+				TextWriter oTextWriter(oOut);
+				ResultParentPath oParentPath(oFofiModel);
 				if (bJSON) {
-					oOut << "[" << '\n';
+					oJsonWriter.beginSequence();
 				}
-				bool bFirst = true;
-				const auto& aResults = oFofiModel.getWatchedResults();
-				for (const auto& oResult : aResults) {
+				// also the results spilled to disk
+				const auto sSpillError = oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+				{
 					if (bSkipTemporary && (oResult.m_eResultType == FofiModel::RESULT_TEMPORARY)) {
-						continue; // for ----
+						return; //----------------------------------------------
 					}
 					if (bJSON) {
-						if (! bFirst) {
-							bFirst = false;
-							oOut << "," << '\n';
-						}
-						printResultJSon(oOut, oResult, bShowDetail, nDuration);
+						printResultJSon(oJsonWriter, oFofiModel, oResult, oParentPath.get(oResult), bShowDetail, nDuration);
 					} else {
-						printResult(oOut, oResult, bShowDetail, nDuration);
+						printResult(oTextWriter, oFofiModel, oResult, oParentPath.get(oResult), bShowDetail, nDuration);
 					}
+				});
+				if (! sSpillError.empty()) {
+					std::cerr << sSpillError << '\n';
 				}
 				if (bJSON) {
-					oOut << "]" << '\n';
+					oJsonWriter.endSequence();
 				} else {
+					oTextWriter.flush();
 					if (bAborted) {
 						oOut << "Aborted! " << sFatalError << '\n';
 					}
 				}
 			});
 	}
+	if (bPrintSummary) {
+		printOutput(oSummaryOF, [&](std::ostream& oOut, bool bJSON)
+			{
+				if (bJSON) {
+					printSummaryJSon(oOut, oFofiModel, nSummaryDepth, oSummaryOF.m_bNDJSON);
+				} else {
+					printSummary(oOut, oFofiModel, nSummaryDepth);
+				}
+			});
+	}
 	return EXIT_SUCCESS;
 }
 
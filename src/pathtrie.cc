@@ -0,0 +1,156 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   pathtrie.cc
+ */
+#include "pathtrie.h"
+
+#include <cassert>
+#include <algorithm>
+
+namespace fofi
+{
+
+PathTrie::PathTrie() noexcept
+: m_aNodes(1)
+, m_nTotValues(0)
+{
+}
+void PathTrie::clear() noexcept
+{
+	m_aNodes.clear();
+	m_aNodes.emplace_back();
+	m_nTotValues = 0;
+}
+int32_t PathTrie::nextComponent(const std::string& sPath, int32_t nPos, std::string& sComponent) noexcept
+{
+	const int32_t nSize = static_cast<int32_t>(sPath.size());
+	while ((nPos < nSize) && (sPath[nPos] == '/')) {
+		++nPos;
+	}
+	if (nPos >= nSize) {
+		return -1; //-----------------------------------------------------------
+	}
+	const auto nFoundSlashPos = sPath.find('/', nPos);
+	const int32_t nEndPos = ((nFoundSlashPos == std::string::npos) ? nSize : static_cast<int32_t>(nFoundSlashPos));
+	sComponent.assign(sPath, nPos, nEndPos - nPos);
+	return nEndPos;
+}
+bool PathTrie::insert(const std::string& sPath, int32_t nValue) noexcept
+{
+	assert(!sPath.empty());
+	assert(nValue >= 0);
+	int32_t nNodeIdx = 0;
+	std::string sComponent;
+	int32_t nPos = 0;
+	while ((nPos = nextComponent(sPath, nPos, sComponent)) >= 0) {
+		auto& oChildren = m_aNodes[nNodeIdx].m_oChildren;
+		const auto itFind = oChildren.find(sComponent);
+		if (itFind != oChildren.end()) {
+			nNodeIdx = itFind->second;
+		} else {
+			const int32_t nNewNodeIdx = static_cast<int32_t>(m_aNodes.size());
+			oChildren.emplace(sComponent, nNewNodeIdx);
+			// careful: this might invalidate oChildren
+			m_aNodes.emplace_back();
+			nNodeIdx = nNewNodeIdx;
+		}
+	}
+	Node& oNode = m_aNodes[nNodeIdx];
+	if (oNode.m_nValue >= 0) {
+		return false; //--------------------------------------------------------
+	}
+	oNode.m_nValue = nValue;
+	++m_nTotValues;
+	return true;
+}
+int32_t PathTrie::findNode(const std::string& sPath) const noexcept
+{
+	int32_t nNodeIdx = 0;
+	std::string sComponent;
+	int32_t nPos = 0;
+	while ((nPos = nextComponent(sPath, nPos, sComponent)) >= 0) {
+		const auto& oChildren = m_aNodes[nNodeIdx].m_oChildren;
+		const auto itFind = oChildren.find(sComponent);
+		if (itFind == oChildren.end()) {
+			return -1; //-------------------------------------------------------
+		}
+		nNodeIdx = itFind->second;
+	}
+	return nNodeIdx;
+}
+int32_t PathTrie::find(const std::string& sPath) const noexcept
+{
+	if (sPath.empty()) {
+		return -1; //-----------------------------------------------------------
+	}
+	const int32_t nNodeIdx = findNode(sPath);
+	if (nNodeIdx < 0) {
+		return -1; //-----------------------------------------------------------
+	}
+	return m_aNodes[nNodeIdx].m_nValue;
+}
+bool PathTrie::hasPathOrDescendants(const std::string& sPath) const noexcept
+{
+	if (sPath.empty() || (m_nTotValues == 0)) {
+		return false; //--------------------------------------------------------
+	}
+	// since paths are never removed every node leads to at least one value
+	return (findNode(sPath) >= 0);
+}
+void PathTrie::findAncestors(const std::string& sPath, std::vector<Ancestor>& aAncestors) const noexcept
+{
+	aAncestors.clear();
+	if (sPath.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	// the depths are first stored as component counts from the root
+	// and then converted once the total is known
+	int32_t nNodeIdx = 0;
+	int32_t nTotComponents = 0;
+	if (m_aNodes[0].m_nValue >= 0) {
+		aAncestors.push_back({m_aNodes[0].m_nValue, 0});
+	}
+	std::string sComponent;
+	int32_t nPos = 0;
+	while ((nPos = nextComponent(sPath, nPos, sComponent)) >= 0) {
+		++nTotComponents;
+		if (nNodeIdx < 0) {
+			// the trie has no more nodes, just count the remaining components
+			continue;
+		}
+		const auto& oChildren = m_aNodes[nNodeIdx].m_oChildren;
+		const auto itFind = oChildren.find(sComponent);
+		if (itFind == oChildren.end()) {
+			nNodeIdx = -1;
+			continue;
+		}
+		nNodeIdx = itFind->second;
+		const int32_t nValue = m_aNodes[nNodeIdx].m_nValue;
+		if (nValue >= 0) {
+			aAncestors.push_back({nValue, nTotComponents});
+		}
+	}
+	// closest first
+	std::reverse(aAncestors.begin(), aAncestors.end());
+	for (auto& oAncestor : aAncestors) {
+		oAncestor.m_nDepth = nTotComponents - oAncestor.m_nDepth;
+	}
+}
+
+} // namespace fofi
+
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   pathtrie.h
+ */
+
+#ifndef FOFIMON_PATH_TRIE_H_
+#define FOFIMON_PATH_TRIE_H_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/** Maps absolute paths to non negative values.
+ * The paths are split into their components (the names between the slashes),
+ * each of which is a node of the trie. Empty components (ex. "//") are ignored.
+ *
+ * Looking up a path or its ancestors takes O(path depth) instead of scanning
+ * all the stored paths.
+ */
+class PathTrie
+{
+public:
+	PathTrie() noexcept;
+	/** Removes all paths.
+	 */
+	void clear() noexcept;
+	/** Whether no path was inserted.
+	 * @return Whether empty.
+	 */
+	bool empty() const noexcept { return (m_nTotValues == 0); }
+	/** Adds a path.
+	 * @param sPath The absolute path. Cannot be empty.
+	 * @param nValue The value. Must be &gt;= 0.
+	 * @return Whether added. If false the path already has a value, which is not changed.
+	 */
+	bool insert(const std::string& sPath, int32_t nValue) noexcept;
+	/** The value of a path.
+	 * @param sPath The absolute path.
+	 * @return The value or -1 if the path wasn't inserted.
+	 */
+	int32_t find(const std::string& sPath) const noexcept;
+	/** Whether a path or one of its descendants was inserted.
+	 * Ex. if "/A/B/C" was inserted, "/A", "/A/B" and "/A/B/C" yield true, "/A/B/C/D" false.
+	 * @param sPath The absolute path.
+	 * @return Whether the path or a descendant has a value.
+	 */
+	bool hasPathOrDescendants(const std::string& sPath) const noexcept;
+
+	struct Ancestor
+	{
+		int32_t m_nValue = -1; /**< The value of the ancestor path. */
+		int32_t m_nDepth = 0; /**< The number of components between the ancestor and the path. 0 if the path itself. */
+	};
+	/** The inserted paths that are equal to or ancestors of a path.
+	 * Ex. if "/", "/A" and "/A/B/C" were inserted, path "/A/B/C/D" yields
+	 * "/A/B/C" with depth 1, "/A" with depth 3 and "/" with depth 4.
+	 * Note that "/A/BB" is not a descendant of "/A/B".
+	 * @param sPath The absolute path.
+	 * @param aAncestors Is cleared and filled with the ancestors ordered by increasing depth.
+	 */
+	void findAncestors(const std::string& sPath, std::vector<Ancestor>& aAncestors) const noexcept;
+private:
+	struct Node
+	{
+		int32_t m_nValue = -1;
+		std::unordered_map<std::string, int32_t> m_oChildren; // Key: component name, Value: index into m_aNodes
+	};
+	// returns the index of the next component's start or -1 if there are no more components
+	static int32_t nextComponent(const std::string& sPath, int32_t nPos, std::string& sComponent) noexcept;
+	int32_t findNode(const std::string& sPath) const noexcept;
+private:
+	std::vector<Node> m_aNodes; // m_aNodes[0] is the root "/"
+	int32_t m_nTotValues;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_PATH_TRIE_H_ */
+
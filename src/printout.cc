@@ -21,6 +21,8 @@
 #include "printout.h"
 
 #include "util.h"
+#include "jsonwriter.h"
+#include "livebinary.h"
 
 #include "inotifiersource.h"  // for INotifierSource, INotifierSource::FO...
 
@@ -28,7 +30,10 @@
 
 #include <glibmm.h>
 
+#include <algorithm>
+#include <chrono>
 #include <deque>
+#include <iomanip>
 #include <memory>
 #include <string>
 #include <utility>
@@ -87,100 +92,73 @@ void printZones(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
 	}
 	oOut << "Total directory zones: " << aZones.size() << '\n';
 }
-void printZoneJSon(std::ostream& oOut, const FofiModel::DirectoryZone& oDZ) noexcept
+void printFiltersJSon(JsonWriter& oWriter, const char* p0Key, const std::vector<FofiModel::Filter>& aFilters) noexcept
 {
-	const char* const p0PinnedFiles = "Pinned files";
-	const char* const p0PinnedSubdirs = "Pinned subdirs";
-	const char* const p0FileIncludeFilters = "File include filters";
-	const char* const p0FileExcludeFilters = "File exclude filters";
-	const char* const p0SubdirIncludeFilters = "Subdir include filters";
-	const char* const p0SubdirExcludeFilters = "Subdir exclude filters";
-
-	json oJZ;
-	oJZ["Path"] = std::string{Glib::filename_to_utf8(oDZ.m_sPath)};
-	oJZ["Max depth"] = oDZ.m_nMaxDepth;
-	oJZ[p0PinnedFiles] = json::array();
-	auto& oJPinnedFiles = oJZ[p0PinnedFiles];
-	const auto& aPinnedFiles = oDZ.m_aPinnedFiles;
-	for (const auto& sPinnedFile : aPinnedFiles) {
-		oJPinnedFiles.push_back(std::string{Glib::filename_to_utf8(sPinnedFile)});
-	}
-	oJZ[p0PinnedSubdirs] = json::array();
-	auto& oJPinnedSubdirs = oJZ[p0PinnedSubdirs];
-	const auto& aPinnedSubDirs = oDZ.m_aPinnedSubDirs;
-	for (const auto& sPinnedSubDir : aPinnedSubDirs) {
-		oJPinnedSubdirs.push_back(std::string{Glib::filename_to_utf8(sPinnedSubDir)});
-	}
-	oJZ[p0FileIncludeFilters] = json::array();
-	auto& oJFileIncludeFilters = oJZ[p0FileIncludeFilters];
-	const auto& aFileIncludeFilters = oDZ.m_aFileIncludeFilters;
-	for (const auto& oFileIncludeFilter : aFileIncludeFilters) {
-		const bool bIsRegexp = (oFileIncludeFilter.m_eFilterType == FofiModel::FILTER_REGEX);
-		json oJFIF;
-		oJFIF["Filter"] = oFileIncludeFilter.m_sFilter;
-		oJFIF["Regexp"] = bIsRegexp;
-		oJFileIncludeFilters.push_back(std::move(oJFIF));
-	}
-	oJZ[p0FileExcludeFilters] = json::array();
-	auto& oJFileExcludeFilters = oJZ[p0FileExcludeFilters];
-	const auto& aFileExcludeFilters = oDZ.m_aFileExcludeFilters;
-	for (const auto& oFileExcludeFilter : aFileExcludeFilters) {
-		const bool bIsRegexp = (oFileExcludeFilter.m_eFilterType == FofiModel::FILTER_REGEX);
-		json oJFEF;
-		oJFEF["Filter"] = oFileExcludeFilter.m_sFilter;
-		oJFEF["Regexp"] = bIsRegexp;
-		oJFileExcludeFilters.push_back(std::move(oJFEF));
-	}
-	oJZ[p0SubdirIncludeFilters] = json::array();
-	auto& oJSubdirIncludeFilters = oJZ[p0SubdirIncludeFilters];
-	const auto& aSubDirIncludeFilters = oDZ.m_aSubDirIncludeFilters;
-	for (const auto& oSubDirIncludeFilter : aSubDirIncludeFilters) {
-		const bool bIsRegexp = (oSubDirIncludeFilter.m_eFilterType == FofiModel::FILTER_REGEX);
-		json oJSIF;
-		oJSIF["Filter"] = oSubDirIncludeFilter.m_sFilter;
-		oJSIF["Regexp"] = bIsRegexp;
-		oJSubdirIncludeFilters.push_back(std::move(oJSIF));
+	oWriter.key(p0Key);
+	oWriter.beginArray();
+	for (const auto& oFilter : aFilters) {
+		const bool bIsRegexp = (oFilter.m_eFilterType == FofiModel::FILTER_REGEX);
+		oWriter.beginObject();
+		oWriter.key("Filter");
+		oWriter.value(oFilter.m_sFilter);
+		oWriter.key("Regexp");
+		oWriter.value(bIsRegexp);
+		oWriter.endObject();
 	}
-	oJZ[p0SubdirExcludeFilters] = json::array();
-	auto& oJSubdirExcludeFilters = oJZ[p0SubdirExcludeFilters];
-	const auto& aSubDirExcludeFilters = oDZ.m_aSubDirExcludeFilters;
-	for (const auto& oSubDirExcludeFilter : aSubDirExcludeFilters) {
-		const bool bIsRegexp = (oSubDirExcludeFilter.m_eFilterType == FofiModel::FILTER_REGEX);
-		json oJSEF;
-		oJSEF["Filter"] = oSubDirExcludeFilter.m_sFilter;
-		oJSEF["Regexp"] = bIsRegexp;
-		oJSubdirExcludeFilters.push_back(std::move(oJSEF));
+	oWriter.endArray();
+}
+void printFileNamesJSon(JsonWriter& oWriter, const char* p0Key, const std::vector<std::string>& aFileNames) noexcept
+{
+	oWriter.key(p0Key);
+	oWriter.beginArray();
+	for (const auto& sFileName : aFileNames) {
+		oWriter.fileNameValue(sFileName);
 	}
-	oOut << oJZ.dump(2) << '\n';
+	oWriter.endArray();
+}
+// The keys of json objects are written in alphabetical order
+// (the order nlohmann::json used when the output was built with it)
+void printZoneJSon(JsonWriter& oWriter, const FofiModel::DirectoryZone& oDZ) noexcept
+{
+	oWriter.beginObject();
+	printFiltersJSon(oWriter, "File exclude filters", oDZ.m_aFileExcludeFilters);
+	printFiltersJSon(oWriter, "File include filters", oDZ.m_aFileIncludeFilters);
+	oWriter.key("Max depth");
+	oWriter.value(oDZ.m_nMaxDepth);
+	oWriter.key("Path");
+	oWriter.fileNameValue(oDZ.m_sPath);
+	printFileNamesJSon(oWriter, "Pinned files", oDZ.m_aPinnedFiles);
+	printFileNamesJSon(oWriter, "Pinned subdirs", oDZ.m_aPinnedSubDirs);
+	printFiltersJSon(oWriter, "Subdir exclude filters", oDZ.m_aSubDirExcludeFilters);
+	printFiltersJSon(oWriter, "Subdir include filters", oDZ.m_aSubDirIncludeFilters);
+	oWriter.endObject();
 }
-void printZonesJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
+void printZonesJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bNDJSon) noexcept
 {
-	oOut << "[" << '\n';
-	bool bFirst = true;
+	JsonWriter oWriter(oOut, bNDJSon);
+	oWriter.beginSequence();
 	const auto& aZones = oFofiModel.getDirectoryZones();
 	for (const auto& oDZ : aZones) {
-		if (! bFirst) {
-			bFirst = false;
-			oOut << "," << '\n';
-		}
-		printZoneJSon(oOut, oDZ);
+		printZoneJSon(oWriter, oDZ);
 	}
-	oOut << "]" << '\n';
+	oWriter.endSequence();
 }
 void printToWatchDirs(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch) noexcept
 {
 	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
 	oOut << "Watched directories:" << '\n';
 	const auto& oDZs = oFofiModel.getDirectoryZones();
-	#ifdef STMM_TRACE_DEBUG
 	int32_t nC = 0;
-	#endif //STMM_TRACE_DEBUG
 	for (const auto& oTWD : aToWatchDirs) {
-		oOut << "  Path to watch     : " << oTWD.m_sPathName << '\n';
+		if (oTWD.isFree()) {
+			++nC;
+			continue; // for ---
+		}
+		oOut << "  Path to watch     : " << oFofiModel.getToWatchDirPath(nC) << '\n';
 		#ifdef STMM_TRACE_DEBUG
 		oOut << "                idx : " << nC << '\n';
-		++nC;
 		#endif //STMM_TRACE_DEBUG
+		++nC;
 		const int32_t nDZ = oTWD.getOwnerDirectoryZone();
 		if (nDZ >= 0) {
 			oOut << "                zone: " << oDZs[nDZ].m_sPath << '\n';
@@ -207,51 +185,48 @@ void printToWatchDirs(std::ostream& oOut, const FofiModel& oFofiModel, bool bDon
 		}
 	}
 }
-void printToWatchDirsJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch) noexcept
+void printToWatchDirsJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch, bool bNDJSon) noexcept
 {
-	const char * const p0PinnedFiles = "Pinned files";
-	const char * const p0PinnedSubdirs = "Pinned subdirs";
-
-	oOut << "[" << '\n';
+	JsonWriter oWriter(oOut, bNDJSon);
+	oWriter.beginSequence();
 	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
 	const auto& oDZs = oFofiModel.getDirectoryZones();
 	int32_t nC = 0;
 	for (const auto& oTWD : aToWatchDirs) {
-		if (nC > 0) {
-			oOut << "," << '\n';
+		if (oTWD.isFree()) {
+			++nC;
+			continue; // for ---
+		}
+		oWriter.beginObject();
+		const int32_t nDZ = oTWD.getOwnerDirectoryZone();
+		if (nDZ >= 0) {
+			oWriter.key("Depth");
+			oWriter.value(oTWD.m_nDepth);
 		}
-		json oJTWD;
-		oJTWD["Path"] = std::string{Glib::filename_to_utf8(oTWD.m_sPathName)};
 		#ifdef STMM_TRACE_DEBUG
-		oJTWD["Idx"] = nC;
+		oWriter.key("Idx");
+		oWriter.value(nC);
 		#endif //STMM_TRACE_DEBUG
+		oWriter.key("Path");
+		oWriter.fileNameValue(oFofiModel.getToWatchDirPath(nC));
 		++nC;
-		const int32_t nDZ = oTWD.getOwnerDirectoryZone();
+		printFileNamesJSon(oWriter, "Pinned files", oTWD.m_aPinnedFiles);
+		printFileNamesJSon(oWriter, "Pinned subdirs", oTWD.m_aPinnedSubDirs);
+		oWriter.key("Zone");
 		if (nDZ >= 0) {
-			oJTWD["Zone"] = std::string{Glib::filename_to_utf8(oDZs[nDZ].m_sPath)};
-			oJTWD["Depth"] = oTWD.m_nDepth;
+			oWriter.fileNameValue(oDZs[nDZ].m_sPath);
 		} else {
-			oJTWD["Zone"] = "";
+			oWriter.value("");
 		}
-		oJTWD[p0PinnedFiles] = json::array();
-		auto& oJPinnedFiles = oJTWD[p0PinnedFiles];
-		const auto& aPinnedFiles = oTWD.m_aPinnedFiles;
-		for (const auto& sPinnedFile : aPinnedFiles) {
-			oJPinnedFiles.push_back(std::string{Glib::filename_to_utf8(sPinnedFile)});
-		}
-		oJTWD[p0PinnedSubdirs] = json::array();
-		auto& oJPinnedSubdirs = oJTWD[p0PinnedSubdirs];
-		const auto& aPinnedSubDirs = oTWD.m_aPinnedSubDirs;
-		for (const auto& sPinnedSubDirs : aPinnedSubDirs) {
-			oJPinnedSubdirs.push_back(std::string{Glib::filename_to_utf8(sPinnedSubDirs)});
-		}
-		oJTWD["exists"] = oTWD.exists();
+		oWriter.key("exists");
+		oWriter.value(oTWD.exists());
 		if (! bDontWatch) {
-			oJTWD["watched"] = oTWD.isWatched();
+			oWriter.key("watched");
+			oWriter.value(oTWD.isWatched());
 		}
-		oOut << oJTWD.dump(2) << '\n';
+		oWriter.endObject();
 	}
-	oOut << "]" << '\n';
+	oWriter.endSequence();
 }
 const char* getActionCodeString(INotifierSource::FOFI_ACTION eA) noexcept
 {
@@ -297,137 +272,520 @@ const char* getResultTypeString(FofiModel::RESULT_TYPE eT) noexcept
 		default:                          return "None";
 	}
 }
-void printAction(std::ostream& oOut, const FofiModel::ActionData& oAction, int64_t nDurationUsec) noexcept
+void printAction(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::ActionData& oAction, int64_t nDurationUsec) noexcept
 {
-	const char* p0Action = getActionString(oAction.m_eAction);
-	oOut << "        " << Util::getTimeString(oAction.m_nTimeUsec, nDurationUsec) << " " << p0Action;
+	oWriter.append("        ");
+	oWriter.appendTime(oAction.m_nTimeUsec, nDurationUsec);
+	oWriter.append(' ');
+	oWriter.append(getActionString(oAction.m_eAction));
 	const bool bIsRenameFrom = (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
 	if (bIsRenameFrom || (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
-		oOut << "  ";
-		if (bIsRenameFrom) {
-			oOut << "(to ";
+		oWriter.append(bIsRenameFrom ? "  (to " : "  (from ");
+		const std::string sOtherPath = oFofiModel.getActionOtherPath(oAction);
+		if (sOtherPath.empty()) {
+			oWriter.append("unknown");
 		} else {
-			oOut << "(from ";
+			oWriter.appendFileName(sOtherPath);
 		}
-		oOut << (oAction.m_sOtherPath.empty() ? "unknown" : oAction.m_sOtherPath) << ")";
+		oWriter.append(')');
+	}
+	if (oAction.m_nCount > 1) {
+		oWriter.append("  (");
+		oWriter.appendInt(oAction.m_nCount);
+		oWriter.append(" times, last ");
+		oWriter.appendTime(oAction.m_nLastTimeUsec, nDurationUsec);
+		oWriter.append(')');
 	}
-	oOut << '\n';
+	oWriter.endLine();
 }
-void printDetailResult(std::ostream& oOut, const FofiModel::WatchedResult& oResult, int64_t nDurationUsec)
+void printDetailResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+						, const std::string& sParentPath, int64_t nDurationUsec) noexcept
 {
-	oOut << "File: " << Glib::filename_to_utf8(Util::getPathFromDirAndName(oResult.m_sPath, oResult.m_sName))
-				<< ((oResult.m_bIsDir && (oResult.m_sPath != "/")) ? "/" : "") << '\n';
-	const char* p0Status = getResultTypeString(oResult.m_eResultType);
-	oOut << "    Status: " << p0Status << (oResult.m_bInconsistent ? " (inconsistent)" : "") << '\n';
-	oOut << "      Actions:" << '\n';
+	oWriter.append("File: ");
+	oWriter.appendPath(sParentPath, oFofiModel.getWatchedResultNamePtr(oResult));
+	if (oResult.m_bIsDir && (sParentPath != "/")) {
+		oWriter.append('/');
+	}
+	oWriter.endLine();
+	oWriter.append("    Status: ");
+	oWriter.append(getResultTypeString(oResult.m_eResultType));
+	if (oResult.m_bInconsistent) {
+		oWriter.append(" (inconsistent)");
+	}
+	oWriter.endLine();
+	oWriter.append("      Actions:");
+	oWriter.endLine();
+	if (oResult.m_nDroppedActions > 0) {
+		oWriter.append("        (");
+		oWriter.appendInt(oResult.m_nDroppedActions);
+		oWriter.append(" older actions discarded)");
+		oWriter.endLine();
+	}
 	const auto& aActions = oResult.m_aActions;
 	for (const auto& oAction : aActions) {
-		printAction(oOut, oAction, nDurationUsec);
+		printAction(oWriter, oFofiModel, oAction, nDurationUsec);
+	}
+}
+void printCodeResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+					, const std::string& sParentPath) noexcept
+{
+	oWriter.append(getResultTypeCodeString(oResult.m_eResultType));
+	oWriter.append(oResult.m_bInconsistent ? '?' : ' ');
+	oWriter.appendPath(sParentPath, oFofiModel.getWatchedResultNamePtr(oResult));
+	if (oResult.m_bIsDir && (sParentPath != "/")) {
+		oWriter.append('/');
 	}
+	oWriter.endLine();
 }
-void printCodeResult(std::ostream& oOut, const FofiModel::WatchedResult& oResult) noexcept
+void printResult(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept
 {
-	const char* p0Status = getResultTypeCodeString(oResult.m_eResultType);
-	oOut << p0Status << (oResult.m_bInconsistent ? "?" : " ")
-				<< Glib::filename_to_utf8(Util::getPathFromDirAndName(oResult.m_sPath, oResult.m_sName))
-				<< ((oResult.m_bIsDir && (oResult.m_sPath != "/")) ? "/" : "") << '\n';
+	TextWriter oWriter(oOut);
+	printResult(oWriter, oFofiModel, oResult, bDetail, nDurationUsec);
 }
-void printResult(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept
+void printResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept
+{
+	printResult(oWriter, oFofiModel, oResult, oFofiModel.getWatchedResultParentPath(oResult), bDetail, nDurationUsec);
+}
+void printResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+				, const std::string& sParentPath, bool bDetail, int64_t nDurationUsec) noexcept
 {
 	if (bDetail) {
-		printDetailResult(oOut, oResult, nDurationUsec);
+		printDetailResult(oWriter, oFofiModel, oResult, sParentPath, nDurationUsec);
 	} else {
-		printCodeResult(oOut, oResult);
+		printCodeResult(oWriter, oFofiModel, oResult, sParentPath);
 	}
 }
-void printCodeResultJSon(std::ostream& oOut, const FofiModel::WatchedResult& oResult, json& oJRes) noexcept
+void printResultJSon(JsonWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept
 {
-	oJRes["Path"] = std::string{Glib::filename_to_utf8(Util::getPathFromDirAndName(oResult.m_sPath, oResult.m_sName))};
-	oJRes["Dir"] = oResult.m_bIsDir;
-	const char* p0Status = getResultTypeString(oResult.m_eResultType);
-	oJRes["Status"] = p0Status;
-	oJRes["Inconsistent"] = oResult.m_bInconsistent;
-	oOut << oJRes.dump(2) << '\n';
+	printResultJSon(oWriter, oFofiModel, oResult, oFofiModel.getWatchedResultParentPath(oResult), bDetail, nDurationUsec);
 }
-void printDetailResultJSon(std::ostream& oOut, const FofiModel::WatchedResult& oResult, int64_t nDurationUsec, json& oJRes) noexcept
+void printResultJSon(JsonWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+					, const std::string& sParentPath, bool bDetail, int64_t nDurationUsec) noexcept
 {
-	printCodeResultJSon(oOut, oResult, oJRes);
-	const char * const p0Actions = "Actions";
-	oJRes[p0Actions] = json::array();
-	auto& oJActions = oJRes[p0Actions];
-	const auto& aActions = oResult.m_aActions;
-	for (const auto& oAction : aActions) {
-		json oJAction;
-		const char* p0Action = getActionString(oAction.m_eAction);
-		oJAction["Action"] = p0Action;
-		oJAction["Time"] = Util::getTimeString(oAction.m_nTimeUsec, nDurationUsec);
-		const bool bIsRenameFrom = (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
-		if (bIsRenameFrom || (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
-			if (! oAction.m_sOtherPath.empty()) {
-				oJAction[(bIsRenameFrom ? "Renamed to" : "Renamed from")] = std::string{Glib::filename_to_utf8(oAction.m_sOtherPath)};
+	oWriter.beginObject();
+	if (bDetail) {
+		oWriter.key("Actions");
+		oWriter.beginArray();
+		const auto& aActions = oResult.m_aActions;
+		for (const auto& oAction : aActions) {
+			oWriter.beginObject();
+			oWriter.key("Action");
+			oWriter.value(getActionString(oAction.m_eAction));
+			if (oAction.m_nCount > 1) {
+				oWriter.key("Count");
+				oWriter.value(oAction.m_nCount);
+				oWriter.key("Last time");
+				oWriter.timeValue(oAction.m_nLastTimeUsec, nDurationUsec);
+			}
+			const bool bIsRenameFrom = (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
+			if (bIsRenameFrom || (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
+				const std::string sOtherPath = oFofiModel.getActionOtherPath(oAction);
+				if (! sOtherPath.empty()) {
+					oWriter.key(bIsRenameFrom ? "Renamed to" : "Renamed from");
+					oWriter.fileNameValue(sOtherPath);
+				}
 			}
+			oWriter.key("Time");
+			oWriter.timeValue(oAction.m_nTimeUsec, nDurationUsec);
+			oWriter.endObject();
 		}
-		oJActions.push_back(oJAction);
+		oWriter.endArray();
+	}
+	oWriter.key("Dir");
+	oWriter.value(oResult.m_bIsDir);
+	if (bDetail && (oResult.m_nDroppedActions > 0)) {
+		oWriter.key("Discarded actions");
+		oWriter.value(oResult.m_nDroppedActions);
 	}
-	oOut << oJRes.dump(2) << '\n';
+	oWriter.key("Inconsistent");
+	oWriter.value(oResult.m_bInconsistent);
+	oWriter.key("Path");
+	oWriter.pathValue(sParentPath, oFofiModel.getWatchedResultNamePtr(oResult));
+	oWriter.key("Status");
+	oWriter.value(getResultTypeString(oResult.m_eResultType));
+	oWriter.endObject();
 }
-void printResultJSon(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept
+ResultParentPath::ResultParentPath(const FofiModel& oFofiModel) noexcept
+: m_oFofiModel(oFofiModel)
+, m_nParentIdx(-2)
 {
-	json oJRes;
-	if (bDetail) {
-		printDetailResultJSon(oOut, oResult, nDurationUsec, oJRes);
-	} else {
-		printCodeResultJSon(oOut, oResult, oJRes);
+}
+const std::string& ResultParentPath::get(const FofiModel::WatchedResult& oResult) noexcept
+{
+	const int32_t nParentIdx = oResult.getParentIdx();
+	if (nParentIdx != m_nParentIdx) {
+		m_sParentPath = m_oFofiModel.getWatchedResultParentPath(oResult);
+		m_nParentIdx = nParentIdx;
 	}
+	return m_sParentPath;
 }
-void printCodeLiveAction(std::ostream& oOut, const FofiModel::WatchedResult& oResult) noexcept
+void printLiveActionOtherPath(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::ActionData& oAction
+							, const char* p0RenameFrom, const char* p0RenameTo) noexcept
 {
-	assert(! oResult.m_aActions.empty());
-	const auto& oAction = oResult.m_aActions.back();
-	const char* p0Action = getActionCodeString(oAction.m_eAction);
-	oOut << p0Action;
-	oOut << " " << Glib::filename_to_utf8(Util::getPathFromDirAndName(oResult.m_sPath, oResult.m_sName))
-				<< ((oResult.m_bIsDir && oResult.m_sPath != "/") ? "/" : "");
 	const bool bIsRenameFrom = (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
 	if (bIsRenameFrom || (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
-		oOut << "  ";
-		if (bIsRenameFrom) {
-			oOut << "(T ";
+		oWriter.append(bIsRenameFrom ? p0RenameFrom : p0RenameTo);
+		const std::string sOtherPath = oFofiModel.getActionOtherPath(oAction);
+		if (sOtherPath.empty()) {
+			oWriter.append("unknown");
 		} else {
-			oOut << "(F ";
+			oWriter.appendFileName(sOtherPath);
 		}
-		oOut << (oAction.m_sOtherPath.empty() ? "unknown" : Glib::filename_to_utf8(oAction.m_sOtherPath)) << ")";
+		oWriter.append(')');
 	}
-	oOut << '\n';
 }
-void printDetailLiveAction(std::ostream& oOut, const FofiModel::WatchedResult& oResult) noexcept
+void printCodeLiveAction(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult) noexcept
 {
 	assert(! oResult.m_aActions.empty());
+	const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
 	const auto& oAction = oResult.m_aActions.back();
-	oOut << Util::getTimeString(oAction.m_nTimeUsec, 1000 * 1000000);
-	const char* p0Action = getActionString(oAction.m_eAction);
-	oOut << " " << p0Action;
-	oOut << " " << Util::getPathFromDirAndName(oResult.m_sPath, oResult.m_sName)
-				<< ((oResult.m_bIsDir && oResult.m_sPath != "/") ? "/" : "");
-	const bool bIsRenameFrom = (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
-	if (bIsRenameFrom || (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
-		oOut << "  ";
-		if (bIsRenameFrom) {
-			oOut << "(to ";
-		} else {
-			oOut << "(from ";
-		}
-		oOut << (oAction.m_sOtherPath.empty() ? "unknown" : oAction.m_sOtherPath) << ")";
+	oWriter.append(getActionCodeString(oAction.m_eAction));
+	oWriter.append(' ');
+	oWriter.appendPath(sParentPath, oFofiModel.getWatchedResultNamePtr(oResult));
+	if (oResult.m_bIsDir && (sParentPath != "/")) {
+		oWriter.append('/');
 	}
-	oOut << '\n';
+	printLiveActionOtherPath(oWriter, oFofiModel, oAction, "  (T ", "  (F ");
+	oWriter.endLine();
 }
-void printLiveAction(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail) noexcept
+void printDetailLiveAction(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult) noexcept
 {
+	assert(! oResult.m_aActions.empty());
+	const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
+	const auto& oAction = oResult.m_aActions.back();
+	// if collapsed the last time is when the action just happened
+	oWriter.appendTime(oAction.m_nLastTimeUsec, 1000 * 1000000);
+	oWriter.append(' ');
+	oWriter.append(getActionString(oAction.m_eAction));
+	oWriter.append(' ');
+	oWriter.appendPath(sParentPath, oFofiModel.getWatchedResultNamePtr(oResult));
+	if (oResult.m_bIsDir && (sParentPath != "/")) {
+		oWriter.append('/');
+	}
+	printLiveActionOtherPath(oWriter, oFofiModel, oAction, "  (to ", "  (from ");
+	if (oAction.m_nCount > 1) {
+		oWriter.append("  (");
+		oWriter.appendInt(oAction.m_nCount);
+		oWriter.append(" times)");
+	}
+	oWriter.endLine();
+}
+void printLiveAction(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail) noexcept
+{
+	TextWriter oWriter(oOut);
 	if (bDetail) {
-		printDetailLiveAction(oOut, oResult);
+		printDetailLiveAction(oWriter, oFofiModel, oResult);
 	} else {
-		printCodeLiveAction(oOut, oResult);
+		printCodeLiveAction(oWriter, oFofiModel, oResult);
+	}
+}
+LiveBinary::Event getLiveBinaryEvent(const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+									, std::string& sPath, std::string& sOtherPath) noexcept
+{
+	assert(! oResult.m_aActions.empty());
+	const auto& oAction = oResult.m_aActions.back();
+	LiveBinary::Event oEvent;
+	// the codes of the format have the same values
+	static_assert(static_cast<int>(LiveBinary::LIVE_ACTION_CREATE) == static_cast<int>(INotifierSource::FOFI_ACTION_CREATE), "");
+	static_assert(static_cast<int>(LiveBinary::LIVE_ACTION_RENAME_TO) == static_cast<int>(INotifierSource::FOFI_ACTION_RENAME_TO), "");
+	static_assert(static_cast<int>(LiveBinary::LIVE_RESULT_NONE) == static_cast<int>(FofiModel::RESULT_NONE), "");
+	static_assert(static_cast<int>(LiveBinary::LIVE_RESULT_TEMPORARY) == static_cast<int>(FofiModel::RESULT_TEMPORARY), "");
+	oEvent.m_eAction = static_cast<LiveBinary::LIVE_ACTION>(oAction.m_eAction);
+	oEvent.m_eResultType = static_cast<LiveBinary::LIVE_RESULT>(oResult.m_eResultType);
+	oEvent.m_nFlags = (oResult.m_bIsDir ? LiveBinary::LIVE_FLAG_DIR : 0)
+					| (oResult.m_bInconsistent ? LiveBinary::LIVE_FLAG_INCONSISTENT : 0)
+					| (oAction.m_bImmediate ? LiveBinary::LIVE_FLAG_IMMEDIATE : 0)
+					| (oAction.m_bCausedByAttribChange ? LiveBinary::LIVE_FLAG_ATTRIB_CHANGE : 0);
+	// if collapsed the last time is when the action just happened
+	oEvent.m_nTimeUsec = oAction.m_nLastTimeUsec;
+	oEvent.m_nCount = oAction.m_nCount;
+	sPath = Util::getPathFromDirAndName(oFofiModel.getWatchedResultParentPath(oResult)
+										, oFofiModel.getWatchedResultName(oResult));
+	sOtherPath.clear();
+	if ((oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM)
+			|| (oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO)) {
+		sOtherPath = oFofiModel.getActionOtherPath(oAction);
+	}
+	return oEvent;
+}
+int64_t getStartWallTimeUsec(const FofiModel& oFofiModel) noexcept
+{
+	const int64_t nNowWallUsec = std::chrono::duration_cast<std::chrono::microseconds>(
+											std::chrono::system_clock::now().time_since_epoch()).count();
+	return nNowWallUsec - oFofiModel.getDuration();
+}
+void printLiveActionBinary(LiveBinaryWriter& oWriter, std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult) noexcept
+{
+	if (! oWriter.isHeaderWritten()) {
+		oWriter.writeHeader(oOut, getStartWallTimeUsec(oFofiModel));
+	}
+	std::string sPath;
+	std::string sOtherPath;
+	const LiveBinary::Event oEvent = getLiveBinaryEvent(oFofiModel, oResult, sPath, sOtherPath);
+	oWriter.writeEvent(oOut, oEvent, sPath, (sOtherPath.empty() ? nullptr : &sOtherPath));
+}
+const char* getLatencyStageString(FofiModel::LATENCY_STAGE eStage) noexcept
+{
+	switch (eStage) {
+		case FofiModel::LATENCY_STAGE_QUEUED:     return "queued"; break;
+		case FofiModel::LATENCY_STAGE_PROCESSED:  return "processed"; break;
+		case FofiModel::LATENCY_STAGE_EMITTED:    return "emitted"; break;
+		default: return "???";
+	}
+}
+// The directories to summarize: those with results in their subtree, either gap fillers
+// or at most nMaxDepth levels below their zone's base path. Sorted by path.
+static std::vector<std::pair<std::string, int32_t>> getSummaryDirs(const FofiModel& oFofiModel, int32_t nMaxDepth) noexcept
+{
+	std::vector<std::pair<std::string, int32_t>> aDirs;
+	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
+	if (nRootTWDIdx < 0) {
+		return aDirs; //--------------------------------------------------------
+	}
+	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
+	std::vector<int32_t> aStack{nRootTWDIdx};
+	while (! aStack.empty()) {
+		const int32_t nTWDIdx = aStack.back();
+		aStack.pop_back();
+		const auto& oTWD = aToWatchDirs[nTWDIdx];
+		if (oTWD.isFree() || (oTWD.getSubtreeResultCounts().getTotal() == 0)) {
+			// nothing to summarize in the whole subtree
+			continue; // while ---
+		}
+		if ((oTWD.getOwnerDirectoryZone() < 0) || (oTWD.m_nDepth <= nMaxDepth)) {
+			aDirs.emplace_back(oFofiModel.getToWatchDirPath(nTWDIdx), nTWDIdx);
+		}
+		const auto& aSubDirIdxs = oTWD.getToWatchSubDirIdxs();
+		aStack.insert(aStack.end(), aSubDirIdxs.begin(), aSubDirIdxs.end());
+	}
+	std::sort(aDirs.begin(), aDirs.end());
+	return aDirs;
+}
+static void printSummaryCounts(std::ostream& oOut, const FofiModel::ResultCounts& oCounts) noexcept
+{
+	oOut << std::setw(10) << oCounts.m_nCreated << std::setw(10) << oCounts.m_nModified
+			<< std::setw(10) << oCounts.m_nDeleted << std::setw(10) << oCounts.m_nTemporary;
+}
+void printSummary(std::ostream& oOut, const FofiModel& oFofiModel, int32_t nMaxDepth) noexcept
+{
+	const auto oFlags = oOut.flags();
+	oOut << "Modifications by directory (whole subtree):" << '\n';
+	oOut << std::right << std::setw(10) << "Created" << std::setw(10) << "Modified"
+			<< std::setw(10) << "Deleted" << std::setw(10) << "Temporary" << "  Directory" << '\n';
+	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
+	for (const auto& oDir : getSummaryDirs(oFofiModel, nMaxDepth)) {
+		const std::string& sPath = oDir.first;
+		printSummaryCounts(oOut, aToWatchDirs[oDir.second].getSubtreeResultCounts());
+		oOut << "  " << Glib::filename_to_utf8(sPath) << ((sPath != "/") ? "/" : "") << '\n';
+	}
+	printSummaryCounts(oOut, oFofiModel.getTotalResultCounts());
+	oOut << "  (total)" << '\n';
+	oOut.flags(oFlags);
+}
+void printSummaryJSon(std::ostream& oOut, const FofiModel& oFofiModel, int32_t nMaxDepth, bool bNDJSon) noexcept
+{
+	JsonWriter oWriter(oOut, bNDJSon);
+	oWriter.beginSequence();
+	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
+	for (const auto& oDir : getSummaryDirs(oFofiModel, nMaxDepth)) {
+		const auto& oTWD = aToWatchDirs[oDir.second];
+		const FofiModel::ResultCounts& oCounts = oTWD.getSubtreeResultCounts();
+		oWriter.beginObject();
+		oWriter.key("Created");
+		oWriter.value(oCounts.m_nCreated);
+		oWriter.key("Deleted");
+		oWriter.value(oCounts.m_nDeleted);
+		oWriter.key("Directory results");
+		oWriter.value(oTWD.getResultCounts().getTotal());
+		oWriter.key("Modified");
+		oWriter.value(oCounts.m_nModified);
+		oWriter.key("Path");
+		oWriter.fileNameValue(oDir.first);
+		oWriter.key("Temporary");
+		oWriter.value(oCounts.m_nTemporary);
+		oWriter.endObject();
+	}
+	oWriter.endSequence();
+}
+
+static const double s_aLatencyPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+void printLatencies(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
+{
+	const auto oFlags = oOut.flags();
+	const auto nPrecision = oOut.precision();
+	oOut << "Event latencies (microseconds):" << '\n';
+	oOut << "  " << std::left << std::setw(12) << "Action" << std::setw(10) << "Stage" << std::right
+			<< std::setw(10) << "Count" << std::setw(10) << "Mean"
+			<< std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+			<< std::setw(10) << "Max" << '\n';
+	oOut << std::fixed << std::setprecision(1);
+	for (int32_t nAction = 0; nAction < FofiModel::s_nTotEventActions; ++nAction) {
+		const auto eAction = static_cast<INotifierSource::FOFI_ACTION>(nAction);
+		for (int32_t nStage = 0; nStage < FofiModel::s_nTotLatencyStages; ++nStage) {
+			const auto eStage = static_cast<FofiModel::LATENCY_STAGE>(nStage);
+			const LatencyHistogram& oHistogram = oFofiModel.getLatencyHistogram(eAction, eStage);
+			if (oHistogram.getTotCount() == 0) {
+				continue; // for nStage ---
+			}
+			oOut << "  " << std::left << std::setw(12) << getActionString(eAction) << std::setw(10) << getLatencyStageString(eStage)
+					<< std::right << std::setw(10) << oHistogram.getTotCount()
+					<< std::setw(10) << oHistogram.getMean() / 1000.0;
+			for (const double fPercentile : s_aLatencyPercentiles) {
+				oOut << std::setw(10) << oHistogram.getValueAtPercentile(fPercentile) / 1000.0;
+			}
+			oOut << std::setw(10) << oHistogram.getMax() / 1000.0 << '\n';
+		}
+	}
+	oOut.flags(oFlags);
+	oOut.precision(nPrecision);
+}
+void printLatenciesJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
+{
+	json oJLatencies = json::array();
+	for (int32_t nAction = 0; nAction < FofiModel::s_nTotEventActions; ++nAction) {
+		const auto eAction = static_cast<INotifierSource::FOFI_ACTION>(nAction);
+		for (int32_t nStage = 0; nStage < FofiModel::s_nTotLatencyStages; ++nStage) {
+			const auto eStage = static_cast<FofiModel::LATENCY_STAGE>(nStage);
+			const LatencyHistogram& oHistogram = oFofiModel.getLatencyHistogram(eAction, eStage);
+			if (oHistogram.getTotCount() == 0) {
+				continue; // for nStage ---
+			}
+			json oJLatency;
+			oJLatency["Action"] = getActionString(eAction);
+			oJLatency["Stage"] = getLatencyStageString(eStage);
+			oJLatency["Count"] = oHistogram.getTotCount();
+			oJLatency["Mean nsec"] = oHistogram.getMean();
+			oJLatency["P50 nsec"] = oHistogram.getValueAtPercentile(50.0);
+			oJLatency["P90 nsec"] = oHistogram.getValueAtPercentile(90.0);
+			oJLatency["P99 nsec"] = oHistogram.getValueAtPercentile(99.0);
+			oJLatency["P99.9 nsec"] = oHistogram.getValueAtPercentile(99.9);
+			oJLatency["Max nsec"] = oHistogram.getMax();
+			oJLatencies.push_back(std::move(oJLatency));
+		}
+	}
+	oOut << oJLatencies.dump(2) << '\n';
+}
+const char* getActionLabelString(INotifierSource::FOFI_ACTION eA) noexcept
+{
+	switch (eA) {
+		case INotifierSource::FOFI_ACTION_CREATE:       return "create"; break;
+		case INotifierSource::FOFI_ACTION_DELETE:       return "delete"; break;
+		case INotifierSource::FOFI_ACTION_MODIFY:       return "modify"; break;
+		case INotifierSource::FOFI_ACTION_ATTRIB:       return "attrib"; break;
+		case INotifierSource::FOFI_ACTION_RENAME_FROM:  return "rename_from"; break;
+		case INotifierSource::FOFI_ACTION_RENAME_TO:    return "rename_to"; break;
+		default: return "???";
+	}
+}
+void printMetricHeader(std::ostream& oOut, const char* p0Name, const char* p0Type, const char* p0Help) noexcept
+{
+	oOut << "# HELP " << p0Name << " " << p0Help << '\n';
+	oOut << "# TYPE " << p0Name << " " << p0Type << '\n';
+}
+void printMetrics(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
+{
+	const FofiModel::Metrics oMetrics = oFofiModel.getMetrics();
+	const auto oFlags = oOut.flags();
+	const auto nPrecision = oOut.precision();
+	oOut << std::fixed << std::setprecision(6);
+
+	printMetricHeader(oOut, "fofimon_events_total", "counter", "Inotify events received by the model.");
+	for (int32_t nAction = 0; nAction < FofiModel::s_nTotEventActions; ++nAction) {
+		const auto eAction = static_cast<INotifierSource::FOFI_ACTION>(nAction);
+		oOut << "fofimon_events_total{action=\"" << getActionLabelString(eAction) << "\"} " << oMetrics.m_aTotEvents[nAction] << '\n';
+	}
+	printMetricHeader(oOut, "fofimon_events_filtered_out_total", "counter", "Events about files or directories excluded by the filters.");
+	oOut << "fofimon_events_filtered_out_total " << oMetrics.m_nTotFilteredOutEvents << '\n';
+	printMetricHeader(oOut, "fofimon_queue_overflows_total", "counter", "Inotify queue overflows.");
+	oOut << "fofimon_queue_overflows_total " << oMetrics.m_nTotOverflows << '\n';
+	printMetricHeader(oOut, "fofimon_inotify_reads_total", "counter", "Reads from the inotify file descriptor.");
+	oOut << "fofimon_inotify_reads_total " << oMetrics.m_nTotReads << '\n';
+	printMetricHeader(oOut, "fofimon_inotify_events_read_total", "counter", "Events read from the inotify file descriptor.");
+	oOut << "fofimon_inotify_events_read_total " << oMetrics.m_nTotReadEvents << '\n';
+	printMetricHeader(oOut, "fofimon_watches", "gauge", "Active inotify watches.");
+	oOut << "fofimon_watches " << oMetrics.m_nTotWatches << '\n';
+	printMetricHeader(oOut, "fofimon_watch_failures_total", "counter", "Inotify watches that could not be added by errno.");
+	for (const auto& oPair : oMetrics.m_oFailedWatches) {
+		oOut << "fofimon_watch_failures_total{errno=\"" << oPair.first << "\"} " << oPair.second << '\n';
+	}
+	printMetricHeader(oOut, "fofimon_to_watch_dirs", "gauge", "Directories tracked by the model.");
+	oOut << "fofimon_to_watch_dirs{state=\"existing\"} " << oMetrics.m_nTotExistingToWatchDirs << '\n';
+	oOut << "fofimon_to_watch_dirs{state=\"missing\"} " << (oMetrics.m_nTotToWatchDirs - oMetrics.m_nTotExistingToWatchDirs) << '\n';
+	printMetricHeader(oOut, "fofimon_results", "gauge", "Modified files and directories.");
+	oOut << "fofimon_results{location=\"memory\"} " << oMetrics.m_nTotResults << '\n';
+	oOut << "fofimon_results{location=\"disk\"} " << oMetrics.m_nTotSpilledResults << '\n';
+	printMetricHeader(oOut, "fofimon_spill_file_bytes", "gauge", "Size of the file holding the results on disk.");
+	oOut << "fofimon_spill_file_bytes " << oMetrics.m_nSpillFileBytes << '\n';
+	printMetricHeader(oOut, "fofimon_open_moves", "gauge", "Renames waiting for their counterpart.");
+	oOut << "fofimon_open_moves " << oMetrics.m_nTotOpenMoves << '\n';
+	printMetricHeader(oOut, "fofimon_model_bytes", "gauge", "Estimate of the heap memory used by the model.");
+	oOut << "fofimon_model_bytes " << oMetrics.m_nModelBytes << '\n';
+	printMetricHeader(oOut, "fofimon_peak_resident_bytes", "gauge", "Maximum resident set size of the process.");
+	oOut << "fofimon_peak_resident_bytes " << oMetrics.m_nPeakResidentBytes << '\n';
+	printMetricHeader(oOut, "fofimon_cpu_seconds_total", "counter", "Process CPU time (user and system) by phase.");
+	oOut << "fofimon_cpu_seconds_total{phase=\"setup\"} " << oMetrics.m_nSetupCpuUsec / 1000000.0 << '\n';
+	oOut << "fofimon_cpu_seconds_total{phase=\"watch\"} " << oMetrics.m_nWatchCpuUsec / 1000000.0 << '\n';
+	oOut << "fofimon_cpu_seconds_total{phase=\"snapshot\"} " << oMetrics.m_nSnapshotCpuUsec / 1000000.0 << '\n';
+	printMetricHeader(oOut, "fofimon_watch_seconds", "gauge", "Time spent watching.");
+	oOut << "fofimon_watch_seconds " << oFofiModel.getDuration() / 1000000.0 << '\n';
+
+	oOut << std::setprecision(9);
+	printMetricHeader(oOut, "fofimon_event_latency_seconds", "summary", "Latency of the inotify events by action and stage.");
+	for (int32_t nAction = 0; nAction < FofiModel::s_nTotEventActions; ++nAction) {
+		const auto eAction = static_cast<INotifierSource::FOFI_ACTION>(nAction);
+		for (int32_t nStage = 0; nStage < FofiModel::s_nTotLatencyStages; ++nStage) {
+			const auto eStage = static_cast<FofiModel::LATENCY_STAGE>(nStage);
+			const LatencyHistogram& oHistogram = oFofiModel.getLatencyHistogram(eAction, eStage);
+			if (oHistogram.getTotCount() == 0) {
+				continue; // for nStage ---
+			}
+			const std::string sLabels = std::string{"action=\""} + getActionLabelString(eAction)
+										+ "\",stage=\"" + getLatencyStageString(eStage) + "\"";
+			for (const double fPercentile : s_aLatencyPercentiles) {
+				oOut << "fofimon_event_latency_seconds{" << sLabels << ",quantile=\"" << std::setprecision(3) << fPercentile / 100.0
+						<< "\"} " << std::setprecision(9) << oHistogram.getValueAtPercentile(fPercentile) / 1e9 << '\n';
+			}
+			oOut << "fofimon_event_latency_seconds_sum{" << sLabels << "} " << oHistogram.getSum() / 1e9 << '\n';
+			oOut << "fofimon_event_latency_seconds_count{" << sLabels << "} " << oHistogram.getTotCount() << '\n';
+		}
+	}
+	oOut.flags(oFlags);
+	oOut.precision(nPrecision);
+}
+void printMetricsJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept
+{
+	const FofiModel::Metrics oMetrics = oFofiModel.getMetrics();
+	json oJMetrics;
+	json oJEvents;
+	for (int32_t nAction = 0; nAction < FofiModel::s_nTotEventActions; ++nAction) {
+		const auto eAction = static_cast<INotifierSource::FOFI_ACTION>(nAction);
+		oJEvents[getActionString(eAction)] = oMetrics.m_aTotEvents[nAction];
+	}
+	oJMetrics["Events"] = oJEvents;
+	oJMetrics["Filtered out events"] = oMetrics.m_nTotFilteredOutEvents;
+	oJMetrics["Queue overflows"] = oMetrics.m_nTotOverflows;
+	oJMetrics["Inotify reads"] = oMetrics.m_nTotReads;
+	oJMetrics["Inotify events read"] = oMetrics.m_nTotReadEvents;
+	oJMetrics["Watches"] = oMetrics.m_nTotWatches;
+	json oJFailed = json::object();
+	for (const auto& oPair : oMetrics.m_oFailedWatches) {
+		oJFailed[std::to_string(oPair.first)] = oPair.second;
 	}
+	oJMetrics["Failed watches by errno"] = oJFailed;
+	oJMetrics["Directories"] = oMetrics.m_nTotToWatchDirs;
+	oJMetrics["Existing directories"] = oMetrics.m_nTotExistingToWatchDirs;
+	oJMetrics["Results in memory"] = oMetrics.m_nTotResults;
+	oJMetrics["Results on disk"] = oMetrics.m_nTotSpilledResults;
+	oJMetrics["Spill file bytes"] = oMetrics.m_nSpillFileBytes;
+	oJMetrics["Open moves"] = oMetrics.m_nTotOpenMoves;
+	oJMetrics["Model bytes"] = oMetrics.m_nModelBytes;
+	oJMetrics["Peak resident bytes"] = oMetrics.m_nPeakResidentBytes;
+	oJMetrics["Setup CPU usec"] = oMetrics.m_nSetupCpuUsec;
+	oJMetrics["Watch CPU usec"] = oMetrics.m_nWatchCpuUsec;
+	oJMetrics["Snapshot CPU usec"] = oMetrics.m_nSnapshotCpuUsec;
+	oJMetrics["Watch usec"] = oFofiModel.getDuration();
+	oOut << oJMetrics.dump(2) << '\n';
 }
 
 } // namespace fofi
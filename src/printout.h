@@ -22,6 +22,9 @@
 #define FOFIMON_PRINT_OUT_H_
 
 #include "fofimodel.h"
+#include "jsonwriter.h"
+#include "livebinary.h"
+#include "textwriter.h"
 
 #include <fstream>
 
@@ -31,15 +34,70 @@ namespace fofi
 {
 
 void printZones(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
-void printZonesJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
+/* The sequence of zones as a json array or as NDJSON. */
+void printZonesJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bNDJSon) noexcept;
 
 void printToWatchDirs(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch) noexcept;
-void printToWatchDirsJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch) noexcept;
+/* The sequence of directories as a json array or as NDJSON. */
+void printToWatchDirsJSon(std::ostream& oOut, const FofiModel& oFofiModel, bool bDontWatch, bool bNDJSon) noexcept;
 
-void printResult(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept;
-void printResultJSon(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept;
+/* Writes a single result. When printing many use the TextWriter overload with
+ * the parent path, which doesn't allocate a buffer or build the path for each. */
+void printResult(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept;
+void printResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept;
+/* A value of the sequence started with JsonWriter::beginSequence(). */
+void printResultJSon(JsonWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail, int64_t nDurationUsec) noexcept;
+/* Same as printResult() and printResultJSon() but with the parent path of the result
+ * (see FofiModel::getWatchedResultParentPath()) already known. These don't use the
+ * path cache of the model and can be called concurrently from different threads. */
+void printResult(TextWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+				, const std::string& sParentPath, bool bDetail, int64_t nDurationUsec) noexcept;
+void printResultJSon(JsonWriter& oWriter, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+					, const std::string& sParentPath, bool bDetail, int64_t nDurationUsec) noexcept;
 
-void printLiveAction(std::ostream& oOut, const FofiModel::WatchedResult& oResult, bool bDetail) noexcept;
+/* The parent path of the results being printed.
+ * The path is only built again when a result isn't in the same directory
+ * as the previous one, so that printing the results of a directory builds it once. */
+class ResultParentPath
+{
+public:
+	explicit ResultParentPath(const FofiModel& oFofiModel) noexcept;
+	/* The path of the parent directory of the result.
+	 * Valid until the next call. */
+	const std::string& get(const FofiModel::WatchedResult& oResult) noexcept;
+private:
+	const FofiModel& m_oFofiModel;
+	int32_t m_nParentIdx; // The parent of the last result or -2 if none
+	std::string m_sParentPath;
+private:
+	ResultParentPath(const ResultParentPath& oSource) = delete;
+	ResultParentPath& operator=(const ResultParentPath& oSource) = delete;
+};
+
+void printLiveAction(std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult, bool bDetail) noexcept;
+/* The last action of the result as a live event.
+ * sOtherPath is set to the other path of a rename or empty if unknown. */
+LiveBinary::Event getLiveBinaryEvent(const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult
+									, std::string& sPath, std::string& sOtherPath) noexcept;
+/* The wall time (microseconds since the epoch) corresponding to time 0 of the actions. */
+int64_t getStartWallTimeUsec(const FofiModel& oFofiModel) noexcept;
+/* Writes the last action of the result in the binary live format (see LiveBinary).
+ * The header is written before the first action. */
+void printLiveActionBinary(LiveBinaryWriter& oWriter, std::ostream& oOut, const FofiModel& oFofiModel, const FofiModel::WatchedResult& oResult) noexcept;
+
+/* The number of results by type in the subtree of each directory that has any.
+ * Directories deeper than nMaxDepth relative to their zone's base path are left out
+ * (their results are still counted by their ancestors). Costs O(directories). */
+void printSummary(std::ostream& oOut, const FofiModel& oFofiModel, int32_t nMaxDepth) noexcept;
+/* The sequence of directories as a json array or as NDJSON. */
+void printSummaryJSon(std::ostream& oOut, const FofiModel& oFofiModel, int32_t nMaxDepth, bool bNDJSon) noexcept;
+
+void printLatencies(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
+void printLatenciesJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
+
+/* Prometheus text exposition format. */
+void printMetrics(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
+void printMetricsJSon(std::ostream& oOut, const FofiModel& oFofiModel) noexcept;
 
 } // namespace fofi
 
@@ -0,0 +1,300 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   scancache.cc
+ */
+
+#include "scancache.h"
+
+#include "util.h"
+
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace fofi
+{
+
+static constexpr const char* s_p0ScanCacheMagic = "FOFISCAN"; // without the terminating null
+
+static void appendVarUInt(std::string& sOut, uint64_t nValue)
+{
+	while (nValue >= 0x80) {
+		sOut.push_back(static_cast<char>((nValue & 0x7F) | 0x80));
+		nValue >>= 7;
+	}
+	sOut.push_back(static_cast<char>(nValue));
+}
+static void appendUInt64(std::string& sOut, uint64_t nValue)
+{
+	char aBytes[sizeof(uint64_t)];
+	std::memcpy(aBytes, &nValue, sizeof(uint64_t));
+	sOut.append(aBytes, sizeof(uint64_t));
+}
+// appends the length of the common prefix with sPrev and the rest of sStr
+static void appendFrontCoded(std::string& sOut, const std::string& sPrev, const std::string& sStr)
+{
+	const auto itMismatch = std::mismatch(sPrev.begin(), sPrev.begin() + std::min(sPrev.size(), sStr.size()), sStr.begin());
+	const size_t nPrefix = static_cast<size_t>(std::distance(sPrev.begin(), itMismatch.first));
+	appendVarUInt(sOut, nPrefix);
+	appendVarUInt(sOut, sStr.size() - nPrefix);
+	sOut.append(sStr, nPrefix, std::string::npos);
+}
+static int64_t getTimespecNsec(const struct ::timespec& oTime)
+{
+	return static_cast<int64_t>(oTime.tv_sec) * 1000000000 + oTime.tv_nsec;
+}
+
+/** Reads the data written by ScanCache::save().
+ * All the methods return false if the data is exhausted or invalid.
+ */
+class ScanCacheReader
+{
+public:
+	ScanCacheReader(const char* p0Data, size_t nSize) noexcept
+	: m_p0Cur(p0Data)
+	, m_p0End(p0Data + nSize)
+	{
+	}
+	bool readVarUInt(uint64_t& nValue) noexcept
+	{
+		nValue = 0;
+		int32_t nShift = 0;
+		while (m_p0Cur < m_p0End) {
+			const uint8_t nByte = static_cast<uint8_t>(*m_p0Cur);
+			++m_p0Cur;
+			if (nShift >= 64) {
+				return false; //------------------------------------------------
+			}
+			nValue |= static_cast<uint64_t>(nByte & 0x7F) << nShift;
+			if ((nByte & 0x80) == 0) {
+				return true; //-------------------------------------------------
+			}
+			nShift += 7;
+		}
+		return false;
+	}
+	bool readUInt64(uint64_t& nValue) noexcept
+	{
+		if (m_p0End - m_p0Cur < static_cast<int64_t>(sizeof(uint64_t))) {
+			return false; //----------------------------------------------------
+		}
+		std::memcpy(&nValue, m_p0Cur, sizeof(uint64_t));
+		m_p0Cur += sizeof(uint64_t);
+		return true;
+	}
+	bool readByte(uint8_t& nValue) noexcept
+	{
+		if (m_p0Cur >= m_p0End) {
+			return false; //----------------------------------------------------
+		}
+		nValue = static_cast<uint8_t>(*m_p0Cur);
+		++m_p0Cur;
+		return true;
+	}
+	// sStr is the previous string on input
+	bool readFrontCoded(std::string& sStr)
+	{
+		uint64_t nPrefix;
+		uint64_t nSuffix;
+		if (! (readVarUInt(nPrefix) && readVarUInt(nSuffix))) {
+			return false; //----------------------------------------------------
+		}
+		if ((nPrefix > sStr.size()) || (nSuffix > static_cast<uint64_t>(m_p0End - m_p0Cur))) {
+			return false; //----------------------------------------------------
+		}
+		sStr.resize(nPrefix);
+		sStr.append(m_p0Cur, nSuffix);
+		m_p0Cur += nSuffix;
+		return true;
+	}
+	bool atEnd() const noexcept { return (m_p0Cur == m_p0End); }
+private:
+	const char* m_p0Cur;
+	const char* m_p0End;
+};
+
+ScanCache::ScanCache() noexcept
+: m_nTotHits(0)
+, m_nTotMisses(0)
+{
+}
+bool ScanCache::getDirStamp(const std::string& sPath, DirStamp& oStamp) noexcept
+{
+	struct ::stat oStat;
+	const auto nRet = ::fstatat(AT_FDCWD, sPath.c_str(), &oStat, AT_SYMLINK_NOFOLLOW);
+	if ((nRet != 0) || ! S_ISDIR(oStat.st_mode)) {
+		return false; //--------------------------------------------------------
+	}
+	oStamp.m_nDevice = oStat.st_dev;
+	oStamp.m_nInode = oStat.st_ino;
+	oStamp.m_nMTimeNsec = getTimespecNsec(oStat.st_mtim);
+	oStamp.m_nCTimeNsec = getTimespecNsec(oStat.st_ctim);
+	return true;
+}
+void ScanCache::clear() noexcept
+{
+	m_oLoaded.clear();
+	m_oUsed.clear();
+	m_nTotHits = 0;
+	m_nTotMisses = 0;
+}
+std::string ScanCache::load(const std::string& sPathName)
+{
+	clear();
+	std::ifstream oIn(sPathName, std::ios::binary);
+	if (! oIn) {
+		const std::string sError = "Could not open scan cache " + sPathName;
+		return sError; //-------------------------------------------------------
+	}
+	const std::string sData{std::istreambuf_iterator<char>(oIn), std::istreambuf_iterator<char>()};
+	const size_t nMagicSize = std::strlen(s_p0ScanCacheMagic);
+	const size_t nHeaderSize = nMagicSize + sizeof(uint64_t);
+	const std::string sCorruptError = "Scan cache " + sPathName + " is corrupt";
+	if ((sData.size() < nHeaderSize + sizeof(uint64_t)) || (sData.compare(0, nMagicSize, s_p0ScanCacheMagic) != 0)) {
+		return sCorruptError; //------------------------------------------------
+	}
+	const size_t nBodyEnd = sData.size() - sizeof(uint64_t);
+	uint64_t nChecksum;
+	std::memcpy(&nChecksum, sData.data() + nBodyEnd, sizeof(uint64_t));
+	if (nChecksum != Util::updateChecksum(Util::s_nChecksumInit, sData.data(), nBodyEnd)) {
+		return sCorruptError; //------------------------------------------------
+	}
+	ScanCacheReader oReader(sData.data() + nMagicSize, nBodyEnd - nMagicSize);
+	uint64_t nVersion;
+	uint64_t nTotDirs;
+	if (! (oReader.readUInt64(nVersion) && oReader.readVarUInt(nTotDirs))) {
+		return sCorruptError; //------------------------------------------------
+	}
+	if (nVersion != static_cast<uint64_t>(s_nVersion)) {
+		const std::string sError = "Scan cache " + sPathName + " has unsupported version " + std::to_string(nVersion);
+		return sError; //-------------------------------------------------------
+	}
+	std::string sPath;
+	for (uint64_t nDir = 0; nDir < nTotDirs; ++nDir) {
+		Listing oListing;
+		uint64_t nTotEntries;
+		uint64_t nMTime;
+		uint64_t nCTime;
+		const bool bOk = oReader.readFrontCoded(sPath)
+						&& oReader.readUInt64(oListing.m_oStamp.m_nDevice) && oReader.readUInt64(oListing.m_oStamp.m_nInode)
+						&& oReader.readUInt64(nMTime) && oReader.readUInt64(nCTime)
+						&& oReader.readVarUInt(nTotEntries);
+		if (! bOk) {
+			m_oLoaded.clear();
+			return sCorruptError; //--------------------------------------------
+		}
+		oListing.m_oStamp.m_nMTimeNsec = static_cast<int64_t>(nMTime);
+		oListing.m_oStamp.m_nCTimeNsec = static_cast<int64_t>(nCTime);
+		std::string sName;
+		for (uint64_t nEntry = 0; nEntry < nTotEntries; ++nEntry) {
+			uint8_t nIsDir;
+			if (! (oReader.readFrontCoded(sName) && oReader.readByte(nIsDir))) {
+				m_oLoaded.clear();
+				return sCorruptError; //----------------------------------------
+			}
+			oListing.m_aEntries.push_back(Entry{sName, (nIsDir != 0)});
+		}
+		m_oLoaded[sPath] = std::move(oListing);
+	}
+	if (! oReader.atEnd()) {
+		m_oLoaded.clear();
+		return sCorruptError; //------------------------------------------------
+	}
+	return "";
+}
+std::string ScanCache::save(const std::string& sPathName) const
+{
+	std::string sData = s_p0ScanCacheMagic;
+	appendUInt64(sData, s_nVersion);
+	appendVarUInt(sData, m_oUsed.size());
+	const std::string sEmpty;
+	const std::string* p0PrevPath = &sEmpty;
+	for (const auto& oPair : m_oUsed) {
+		const std::string& sPath = oPair.first;
+		const Listing& oListing = oPair.second;
+		appendFrontCoded(sData, *p0PrevPath, sPath);
+		p0PrevPath = &sPath;
+		appendUInt64(sData, oListing.m_oStamp.m_nDevice);
+		appendUInt64(sData, oListing.m_oStamp.m_nInode);
+		appendUInt64(sData, static_cast<uint64_t>(oListing.m_oStamp.m_nMTimeNsec));
+		appendUInt64(sData, static_cast<uint64_t>(oListing.m_oStamp.m_nCTimeNsec));
+		appendVarUInt(sData, oListing.m_aEntries.size());
+		const std::string* p0PrevName = &sEmpty;
+		for (const Entry& oEntry : oListing.m_aEntries) {
+			appendFrontCoded(sData, *p0PrevName, oEntry.m_sName);
+			p0PrevName = &oEntry.m_sName;
+			sData.push_back(oEntry.m_bIsDir ? 1 : 0);
+		}
+	}
+	appendUInt64(sData, Util::updateChecksum(Util::s_nChecksumInit, sData.data(), sData.size()));
+
+	return Util::writeFileAtomically(sPathName, [&](std::ostream& oOut)
+	{
+		oOut.write(sData.data(), sData.size());
+		return std::string{};
+	});
+}
+bool ScanCache::lookup(const std::string& sPath, const DirStamp& oStamp, std::vector<Entry>& aEntries)
+{
+	const auto itUsed = m_oUsed.find(sPath);
+	if (itUsed != m_oUsed.end()) {
+		if (itUsed->second.m_oStamp == oStamp) {
+			++m_nTotHits;
+			aEntries = itUsed->second.m_aEntries;
+			return true; //-----------------------------------------------------
+		}
+		++m_nTotMisses;
+		return false; //--------------------------------------------------------
+	}
+	const auto itLoaded = m_oLoaded.find(sPath);
+	if ((itLoaded == m_oLoaded.end()) || ! (itLoaded->second.m_oStamp == oStamp)) {
+		++m_nTotMisses;
+		return false; //--------------------------------------------------------
+	}
+	++m_nTotHits;
+	aEntries = itLoaded->second.m_aEntries;
+	m_oUsed.emplace(sPath, std::move(itLoaded->second));
+	m_oLoaded.erase(itLoaded);
+	return true;
+}
+void ScanCache::store(const std::string& sPath, const DirStamp& oStamp, const std::vector<Entry>& aEntries)
+{
+	const int64_t nNowNsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+										std::chrono::system_clock::now().time_since_epoch()).count();
+	if (oStamp.m_nMTimeNsec + s_nRacyIntervalNsec > nNowNsec) {
+		// a change within the same timestamp tick would go unnoticed
+		m_oUsed.erase(sPath);
+		return; //--------------------------------------------------------------
+	}
+	Listing& oListing = m_oUsed[sPath];
+	oListing.m_oStamp = oStamp;
+	oListing.m_aEntries = aEntries;
+	std::sort(oListing.m_aEntries.begin(), oListing.m_aEntries.end(), [](const Entry& oE1, const Entry& oE2)
+	{
+		return (oE1.m_sName < oE2.m_sName);
+	});
+	m_oLoaded.erase(sPath);
+}
+
+} // namespace fofi
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   scancache.h
+ */
+
+#ifndef FOFIMON_SCAN_CACHE_H_
+#define FOFIMON_SCAN_CACHE_H_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/** Listings of directories that can be reused by the next run.
+ * A listing is only valid as long as the directory has the same stamp
+ * (device, inode, modification and change time), since adding, removing
+ * or renaming an entry changes the modification time of the directory.
+ *
+ * The listings that were looked up or stored since the last load() are
+ * written by save(), the others are dropped. In the file the paths
+ * and the names are front coded (only the suffix that differs from the
+ * previous, sorted, string is stored).
+ *
+ * A missing, stale or corrupt file just results in an empty cache.
+ */
+class ScanCache
+{
+public:
+	struct DirStamp
+	{
+		uint64_t m_nDevice = 0;
+		uint64_t m_nInode = 0;
+		int64_t m_nMTimeNsec = 0;
+		int64_t m_nCTimeNsec = 0;
+		bool operator==(const DirStamp& oOther) const noexcept
+		{
+			return (m_nDevice == oOther.m_nDevice) && (m_nInode == oOther.m_nInode)
+					&& (m_nMTimeNsec == oOther.m_nMTimeNsec) && (m_nCTimeNsec == oOther.m_nCTimeNsec);
+		}
+	};
+	struct Entry
+	{
+		std::string m_sName;
+		bool m_bIsDir = false;
+	};
+	ScanCache() noexcept;
+	/** The stamp of a directory.
+	 * @param sPath The path of the directory.
+	 * @param oStamp The stamp.
+	 * @return Whether the directory exists.
+	 */
+	static bool getDirStamp(const std::string& sPath, DirStamp& oStamp) noexcept;
+	/** Removes all the listings and resets the counters. */
+	void clear() noexcept;
+	/** Replaces the listings with those in a file.
+	 * If the file can't be read or is corrupt the cache is left empty.
+	 * @param sPathName The file.
+	 * @return Empty string or error.
+	 */
+	std::string load(const std::string& sPathName);
+	/** Writes the listings used since the last load().
+	 * The file is written to a temporary file first which then replaces it.
+	 * @param sPathName The file.
+	 * @return Empty string or error.
+	 */
+	std::string save(const std::string& sPathName) const;
+	/** Gets the listing of a directory.
+	 * @param sPath The directory path.
+	 * @param oStamp The current stamp of the directory.
+	 * @param aEntries Is set to the entries sorted by name if found.
+	 * @return Whether a listing with the same stamp was found.
+	 */
+	bool lookup(const std::string& sPath, const DirStamp& oStamp, std::vector<Entry>& aEntries);
+	/** Sets the listing of a directory.
+	 * Listings of directories modified in the last few seconds are ignored,
+	 * because a modification within the granularity of the file system
+	 * timestamps wouldn't change the stamp.
+	 * @param sPath The directory path.
+	 * @param oStamp The stamp of the directory taken before reading it.
+	 * @param aEntries The entries of the directory.
+	 */
+	void store(const std::string& sPath, const DirStamp& oStamp, const std::vector<Entry>& aEntries);
+	/** The number of successful lookups since the last load() or clear().
+	 * @return The number of hits.
+	 */
+	int32_t getTotHits() const noexcept { return m_nTotHits; }
+	/** The number of failed lookups since the last load() or clear().
+	 * @return The number of misses.
+	 */
+	int32_t getTotMisses() const noexcept { return m_nTotMisses; }
+private:
+	struct Listing
+	{
+		DirStamp m_oStamp;
+		std::vector<Entry> m_aEntries; // sorted by name
+	};
+	static constexpr int32_t s_nVersion = 1;
+	static constexpr int64_t s_nRacyIntervalNsec = 2000000000;
+	std::unordered_map<std::string, Listing> m_oLoaded; // Key: directory path
+	std::map<std::string, Listing> m_oUsed; // Key: directory path, sorted for the front coding
+	int32_t m_nTotHits;
+	int32_t m_nTotMisses;
+private:
+	ScanCache(const ScanCache& oSource) = delete;
+	ScanCache& operator=(const ScanCache& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_SCAN_CACHE_H_ */
@@ -0,0 +1,316 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   shmring.cc
+ */
+
+#include "shmring.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fofi
+{
+
+constexpr uint8_t ShmRing::LIVE_FLAG_TRUNCATED;
+
+// The atomics are shared between processes
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "");
+
+/* Layout of the file:
+ *
+ * Header (s_nHeaderSize bytes):
+ *     0  char[8]  "FOFISHMR"
+ *     8  uint32   version
+ *    12  uint32   slot size
+ *    16  uint64   number of slots (power of two)
+ *    24  int64    wall time of the start of watching
+ *    32  atomic<uint64> closed (0 or 1)
+ *    64  atomic<uint64> head: the number of published events
+ *
+ * followed by the slots. The event with sequence number N (from 0) is in slot
+ * N modulo the number of slots. Slot layout:
+ *     0  atomic<uint64> state: 2N+1 while event N is written, 2N+2 when complete
+ *     8  uint8    action
+ *     9  uint8    result type
+ *    10  uint8    flags
+ *    12  int32    count
+ *    16  int64    time from the start of watching
+ *    24  uint16   size of the path
+ *    26  uint16   size of the other path
+ *    28  uint8    whether there is an other path
+ *    32  char[]   the path followed by the other path
+ *
+ * A reader validates the copy of a slot by checking that the state didn't
+ * change while copying (like a seqlock). */
+static const char* const s_p0ShmMagic = "FOFISHMR";
+static constexpr size_t s_nShmMagicSize = 8;
+static constexpr uint32_t s_nShmVersion = 1;
+static constexpr size_t s_nHeaderSize = 128;
+static constexpr size_t s_nClosedOffset = 32;
+static constexpr size_t s_nHeadOffset = 64;
+static constexpr size_t s_nSlotHeaderSize = 32;
+static constexpr int32_t s_nMinSlotSize = 128;
+
+static std::atomic<uint64_t>& atomicAt(char* p0Mapped, size_t nOffset) noexcept
+{
+	return *reinterpret_cast<std::atomic<uint64_t>*>(p0Mapped + nOffset);
+}
+// Lock-free loads don't write, they work on read-only mappings
+static const std::atomic<uint64_t>& atomicAt(const char* p0Mapped, size_t nOffset) noexcept
+{
+	return *reinterpret_cast<const std::atomic<uint64_t>*>(p0Mapped + nOffset);
+}
+template<typename T>
+static void storeAt(char* p0Mapped, size_t nOffset, T nValue) noexcept
+{
+	std::memcpy(p0Mapped + nOffset, &nValue, sizeof(T));
+}
+template<typename T>
+static T loadAt(const char* p0Mapped, size_t nOffset) noexcept
+{
+	T nValue;
+	std::memcpy(&nValue, p0Mapped + nOffset, sizeof(T));
+	return nValue;
+}
+// Copies a path to the slot, truncating it to nMaxSize
+static size_t storePath(char* p0Dest, size_t nMaxSize, const std::string& sPath, bool& bTruncated) noexcept
+{
+	const size_t nSize = std::min(std::min(sPath.size(), nMaxSize), static_cast<size_t>(UINT16_MAX));
+	bTruncated = bTruncated || (nSize < sPath.size());
+	std::memcpy(p0Dest, sPath.data(), nSize);
+	return nSize;
+}
+
+std::string ShmRing::getPathName(const std::string& sName) noexcept
+{
+	if ((! sName.empty()) && (sName[0] == '/')) {
+		return sName; //--------------------------------------------------------
+	}
+	return "/dev/shm/" + sName;
+}
+
+ShmRing::ShmRing() noexcept
+: m_p0Mapped(nullptr)
+, m_nMappedSize(0)
+, m_nNextSeq(0)
+{
+}
+ShmRing::~ShmRing() noexcept
+{
+	close();
+}
+std::string ShmRing::create(const std::string& sName, const Config& oConfig, int64_t nStartWallTimeUsec)
+{
+	assert(m_p0Mapped == nullptr);
+	assert(oConfig.m_nTotSlots > 0);
+	assert(oConfig.m_nSlotSize >= s_nMinSlotSize);
+	uint64_t nTotSlots = 1;
+	while (nTotSlots < static_cast<uint64_t>(oConfig.m_nTotSlots)) {
+		nTotSlots *= 2;
+	}
+	// keeps the slot states aligned
+	const uint32_t nSlotSize = static_cast<uint32_t>((oConfig.m_nSlotSize + 63) / 64 * 64);
+	m_sPathName = getPathName(sName);
+	// readers of a previous ring keep their mapping of the removed file
+	::unlink(m_sPathName.c_str());
+	const int nFD = ::open(m_sPathName.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (nFD < 0) {
+		return "Could not create " + m_sPathName + ": " + ::strerror(errno); //-
+	}
+	m_nMappedSize = s_nHeaderSize + nTotSlots * nSlotSize;
+	if (::ftruncate(nFD, static_cast<off_t>(m_nMappedSize)) != 0) {
+		const std::string sError = "Could not resize " + m_sPathName + ": " + ::strerror(errno);
+		::close(nFD);
+		::unlink(m_sPathName.c_str());
+		return sError; //-------------------------------------------------------
+	}
+	void* p0Mapped = ::mmap(nullptr, m_nMappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFD, 0);
+	::close(nFD);
+	if (p0Mapped == MAP_FAILED) {
+		::unlink(m_sPathName.c_str());
+		return "Could not map " + m_sPathName + ": " + ::strerror(errno); //----
+	}
+	m_p0Mapped = static_cast<char*>(p0Mapped);
+	// the file is zero filled: all the slots are in state 0 (never written)
+	std::memcpy(m_p0Mapped, s_p0ShmMagic, s_nShmMagicSize);
+	storeAt<uint32_t>(m_p0Mapped, 8, s_nShmVersion);
+	storeAt<uint32_t>(m_p0Mapped, 12, nSlotSize);
+	storeAt<uint64_t>(m_p0Mapped, 16, nTotSlots);
+	storeAt<int64_t>(m_p0Mapped, 24, nStartWallTimeUsec);
+	m_nNextSeq = 0;
+	// a reader mapping the file sees the header once it sees the head
+	atomicAt(m_p0Mapped, s_nHeadOffset).store(0, std::memory_order_release);
+	return "";
+}
+void ShmRing::publish(const LiveBinary::Event& oEvent, const std::string& sPath, const std::string* p0OtherPath) noexcept
+{
+	if (m_p0Mapped == nullptr) {
+		return; //--------------------------------------------------------------
+	}
+	const uint32_t nSlotSize = loadAt<uint32_t>(m_p0Mapped, 12);
+	const uint64_t nTotSlots = loadAt<uint64_t>(m_p0Mapped, 16);
+	const uint64_t nSeq = m_nNextSeq;
+	char* p0Slot = m_p0Mapped + s_nHeaderSize + (nSeq & (nTotSlots - 1)) * nSlotSize;
+	auto& nState = atomicAt(p0Slot, 0);
+	nState.store(2 * nSeq + 1, std::memory_order_relaxed);
+	// the new state must be visible before any of the following stores
+	std::atomic_thread_fence(std::memory_order_release);
+	const size_t nMaxPathsSize = nSlotSize - s_nSlotHeaderSize;
+	bool bTruncated = false;
+	const size_t nPathSize = storePath(p0Slot + s_nSlotHeaderSize, nMaxPathsSize, sPath, bTruncated);
+	size_t nOtherPathSize = 0;
+	if (p0OtherPath != nullptr) {
+		nOtherPathSize = storePath(p0Slot + s_nSlotHeaderSize + nPathSize, nMaxPathsSize - nPathSize, *p0OtherPath, bTruncated);
+	}
+	storeAt<uint8_t>(p0Slot, 8, oEvent.m_eAction);
+	storeAt<uint8_t>(p0Slot, 9, oEvent.m_eResultType);
+	storeAt<uint8_t>(p0Slot, 10, oEvent.m_nFlags | (bTruncated ? LIVE_FLAG_TRUNCATED : 0));
+	storeAt<int32_t>(p0Slot, 12, oEvent.m_nCount);
+	storeAt<int64_t>(p0Slot, 16, oEvent.m_nTimeUsec);
+	storeAt<uint16_t>(p0Slot, 24, static_cast<uint16_t>(nPathSize));
+	storeAt<uint16_t>(p0Slot, 26, static_cast<uint16_t>(nOtherPathSize));
+	storeAt<uint8_t>(p0Slot, 28, (p0OtherPath != nullptr) ? 1 : 0);
+	nState.store(2 * nSeq + 2, std::memory_order_release);
+	++m_nNextSeq;
+	atomicAt(m_p0Mapped, s_nHeadOffset).store(m_nNextSeq, std::memory_order_release);
+}
+void ShmRing::close() noexcept
+{
+	if (m_p0Mapped == nullptr) {
+		return; //--------------------------------------------------------------
+	}
+	atomicAt(m_p0Mapped, s_nClosedOffset).store(1, std::memory_order_release);
+	::munmap(m_p0Mapped, m_nMappedSize);
+	m_p0Mapped = nullptr;
+	::unlink(m_sPathName.c_str());
+}
+
+ShmRingReader::ShmRingReader() noexcept
+: m_p0Mapped(nullptr)
+, m_nMappedSize(0)
+, m_nNextSeq(0)
+, m_nTotLost(0)
+{
+}
+ShmRingReader::~ShmRingReader() noexcept
+{
+	if (m_p0Mapped != nullptr) {
+		::munmap(const_cast<char*>(m_p0Mapped), m_nMappedSize);
+	}
+}
+std::string ShmRingReader::open(const std::string& sName, bool bFromOldest)
+{
+	assert(m_p0Mapped == nullptr);
+	const std::string sPathName = ShmRing::getPathName(sName);
+	// read-only: readers can't corrupt the ring and don't need write permission
+	const int nFD = ::open(sPathName.c_str(), O_RDONLY | O_CLOEXEC);
+	if (nFD < 0) {
+		return "Could not open " + sPathName + ": " + ::strerror(errno); //-----
+	}
+	struct stat oStat;
+	if ((::fstat(nFD, &oStat) != 0) || (oStat.st_size < static_cast<off_t>(s_nHeaderSize))) {
+		::close(nFD);
+		return "Not a live events ring: " + sPathName; //-----------------------
+	}
+	m_nMappedSize = static_cast<size_t>(oStat.st_size);
+	void* p0Mapped = ::mmap(nullptr, m_nMappedSize, PROT_READ, MAP_SHARED, nFD, 0);
+	::close(nFD);
+	if (p0Mapped == MAP_FAILED) {
+		return "Could not map " + sPathName + ": " + ::strerror(errno); //------
+	}
+	m_p0Mapped = static_cast<const char*>(p0Mapped);
+	const uint64_t nHead = atomicAt(m_p0Mapped, s_nHeadOffset).load(std::memory_order_acquire);
+	const uint32_t nSlotSize = loadAt<uint32_t>(m_p0Mapped, 12);
+	const uint64_t nTotSlots = loadAt<uint64_t>(m_p0Mapped, 16);
+	const bool bValid = (std::memcmp(m_p0Mapped, s_p0ShmMagic, s_nShmMagicSize) == 0)
+						&& (loadAt<uint32_t>(m_p0Mapped, 8) == s_nShmVersion)
+						&& (nSlotSize >= static_cast<uint32_t>(s_nMinSlotSize))
+						&& (nTotSlots > 0) && ((nTotSlots & (nTotSlots - 1)) == 0)
+						&& (s_nHeaderSize + nTotSlots * nSlotSize == m_nMappedSize);
+	if (! bValid) {
+		::munmap(const_cast<char*>(m_p0Mapped), m_nMappedSize);
+		m_p0Mapped = nullptr;
+		return "Not a live events ring: " + sPathName; //-----------------------
+	}
+	m_nNextSeq = ((bFromOldest && (nHead > nTotSlots)) ? (nHead - nTotSlots) : (bFromOldest ? 0 : nHead));
+	m_nTotLost = 0;
+	return "";
+}
+int64_t ShmRingReader::getStartWallTimeUsec() const noexcept
+{
+	assert(m_p0Mapped != nullptr);
+	return loadAt<int64_t>(m_p0Mapped, 24);
+}
+ShmRingReader::READ_RESULT ShmRingReader::next(LiveBinary::Event& oEvent, std::string& sPath, std::string& sOtherPath) noexcept
+{
+	assert(m_p0Mapped != nullptr);
+	const uint32_t nSlotSize = loadAt<uint32_t>(m_p0Mapped, 12);
+	const uint64_t nTotSlots = loadAt<uint64_t>(m_p0Mapped, 16);
+	// read before the head so that no event published before closing is missed
+	const bool bClosed = (atomicAt(m_p0Mapped, s_nClosedOffset).load(std::memory_order_acquire) != 0);
+	const uint64_t nHead = atomicAt(m_p0Mapped, s_nHeadOffset).load(std::memory_order_acquire);
+	if (m_nNextSeq >= nHead) {
+		return (bClosed ? READ_RESULT_CLOSED : READ_RESULT_NONE); //------------
+	}
+	if (nHead - m_nNextSeq > nTotSlots) {
+		m_nTotLost += static_cast<int64_t>(nHead - nTotSlots - m_nNextSeq);
+		m_nNextSeq = nHead - nTotSlots;
+		return READ_RESULT_LAGGED; //-------------------------------------------
+	}
+	const char* p0Slot = m_p0Mapped + s_nHeaderSize + (m_nNextSeq & (nTotSlots - 1)) * nSlotSize;
+	const auto& nState = atomicAt(p0Slot, 0);
+	const uint64_t nExpectedState = 2 * m_nNextSeq + 2;
+	if (nState.load(std::memory_order_acquire) == nExpectedState) {
+		oEvent.m_eAction = static_cast<LiveBinary::LIVE_ACTION>(loadAt<uint8_t>(p0Slot, 8));
+		oEvent.m_eResultType = static_cast<LiveBinary::LIVE_RESULT>(loadAt<uint8_t>(p0Slot, 9));
+		oEvent.m_nFlags = loadAt<uint8_t>(p0Slot, 10);
+		oEvent.m_nCount = loadAt<int32_t>(p0Slot, 12);
+		oEvent.m_nTimeUsec = loadAt<int64_t>(p0Slot, 16);
+		oEvent.m_nPathId = -1;
+		oEvent.m_nOtherPathId = -1;
+		// the sizes could be garbage if the slot is being overwritten
+		const size_t nMaxPathsSize = nSlotSize - s_nSlotHeaderSize;
+		const size_t nPathSize = std::min<size_t>(loadAt<uint16_t>(p0Slot, 24), nMaxPathsSize);
+		const size_t nOtherPathSize = std::min<size_t>(loadAt<uint16_t>(p0Slot, 26), nMaxPathsSize - nPathSize);
+		sPath.assign(p0Slot + s_nSlotHeaderSize, nPathSize);
+		sOtherPath.assign(p0Slot + s_nSlotHeaderSize + nPathSize, nOtherPathSize);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (nState.load(std::memory_order_relaxed) == nExpectedState) {
+			++m_nNextSeq;
+			return READ_RESULT_EVENT; //----------------------------------------
+		}
+	}
+	// overwritten by a newer event
+	const uint64_t nNewHead = atomicAt(m_p0Mapped, s_nHeadOffset).load(std::memory_order_acquire);
+	const uint64_t nOldest = ((nNewHead > nTotSlots) ? (nNewHead - nTotSlots) : 0);
+	const uint64_t nNewNext = std::max(m_nNextSeq + 1, nOldest);
+	m_nTotLost += static_cast<int64_t>(nNewNext - m_nNextSeq);
+	m_nNextSeq = nNewNext;
+	return READ_RESULT_LAGGED;
+}
+
+} // namespace fofi
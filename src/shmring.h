@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   shmring.h
+ */
+
+#ifndef FOFIMON_SHM_RING_H_
+#define FOFIMON_SHM_RING_H_
+
+#include "livebinary.h"
+
+#include <string>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Ring buffer of live events in a memory mapped file (usually under /dev/shm).
+ *
+ * The publisher (ShmRing) writes each event into a fixed size slot tagged
+ * with the event's sequence number, overwriting the oldest event when the
+ * ring is full. Any number of readers (ShmRingReader) can map the file and
+ * read the events without system calls; a reader that falls behind by more
+ * than the number of slots detects how many events it lost.
+ *
+ * The events use the fields of LiveBinary::Event, the paths are stored in
+ * the slot (truncated if too long, see LIVE_FLAG_TRUNCATED). */
+class ShmRing
+{
+public:
+	/** Set in LiveBinary::Event::m_nFlags if a path didn't fit in the slot. */
+	static constexpr uint8_t LIVE_FLAG_TRUNCATED = 0x80;
+	struct Config
+	{
+		int32_t m_nTotSlots = 16384; /**< Rounded up to a power of two. Must be positive. */
+		int32_t m_nSlotSize = 1024; /**< In bytes, including the slot header. Must be at least 128. */
+	};
+	ShmRing() noexcept;
+	~ShmRing() noexcept;
+	/** Creates (or recreates) the ring.
+	 * Readers that mapped a previous ring with the same name see it as closed.
+	 * @param sName The name of a file in /dev/shm or an absolute path.
+	 * @param oConfig The configuration.
+	 * @param nStartWallTimeUsec The wall time (microseconds since the epoch) of the start of watching.
+	 * @return Empty string or error.
+	 */
+	std::string create(const std::string& sName, const Config& oConfig, int64_t nStartWallTimeUsec);
+	/** Whether the ring was created and not closed.
+	 * @return Whether open.
+	 */
+	bool isOpen() const noexcept { return (m_p0Mapped != nullptr); }
+	/** Publishes an event.
+	 * @param oEvent The event. The path ids are ignored.
+	 * @param sPath The path.
+	 * @param p0OtherPath The other path of a rename or null.
+	 */
+	void publish(const LiveBinary::Event& oEvent, const std::string& sPath, const std::string* p0OtherPath) noexcept;
+	/** Marks the ring as closed, unmaps and removes the file.
+	 * Readers that already mapped it can still read the remaining events.
+	 */
+	void close() noexcept;
+
+	/** The file path of a ring name.
+	 * @param sName The name of a file in /dev/shm or an absolute path.
+	 * @return The path.
+	 */
+	static std::string getPathName(const std::string& sName) noexcept;
+private:
+	std::string m_sPathName;
+	char* m_p0Mapped;
+	size_t m_nMappedSize;
+	uint64_t m_nNextSeq;
+private:
+	ShmRing(const ShmRing& oSource) = delete;
+	ShmRing& operator=(const ShmRing& oSource) = delete;
+};
+
+/* Reader of a ShmRing. */
+class ShmRingReader
+{
+public:
+	enum READ_RESULT
+	{
+		READ_RESULT_EVENT = 0 /**< An event was read. */
+		, READ_RESULT_NONE = 1 /**< No new event yet. */
+		, READ_RESULT_LAGGED = 2 /**< Events were overwritten before they could be read. See getTotLost(). */
+		, READ_RESULT_CLOSED = 3 /**< The publisher closed the ring and all the events were read. */
+	};
+	ShmRingReader() noexcept;
+	~ShmRingReader() noexcept;
+	/** Maps an existing ring.
+	 * @param sName The name of a file in /dev/shm or an absolute path.
+	 * @param bFromOldest Whether to start from the oldest event still in the ring
+	 * rather than from the next published one.
+	 * @return Empty string or error.
+	 */
+	std::string open(const std::string& sName, bool bFromOldest);
+	/** Reads the next event.
+	 * @param oEvent Is set to the event if READ_RESULT_EVENT is returned.
+	 * @param sPath Is set to the path if READ_RESULT_EVENT is returned.
+	 * @param sOtherPath Is set to the other path of a rename (or empty) if READ_RESULT_EVENT is returned.
+	 * @return The result.
+	 */
+	READ_RESULT next(LiveBinary::Event& oEvent, std::string& sPath, std::string& sOtherPath) noexcept;
+	/** The total number of events that were overwritten before they could be read.
+	 * @return The number of events.
+	 */
+	int64_t getTotLost() const noexcept { return m_nTotLost; }
+	/** The wall time of the start of watching.
+	 * @return Microseconds since the epoch.
+	 */
+	int64_t getStartWallTimeUsec() const noexcept;
+private:
+	const char* m_p0Mapped;
+	size_t m_nMappedSize;
+	uint64_t m_nNextSeq;
+	int64_t m_nTotLost;
+private:
+	ShmRingReader(const ShmRingReader& oSource) = delete;
+	ShmRingReader& operator=(const ShmRingReader& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_SHM_RING_H_ */
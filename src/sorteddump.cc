@@ -0,0 +1,385 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   sorteddump.cc
+ */
+
+#include "sorteddump.h"
+
+#include "printout.h"
+#include "jsonwriter.h"
+#include "textwriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <system_error>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+namespace fofi
+{
+
+// Below this number of results per thread more threads don't pay off
+static constexpr int32_t s_nMinItemsPerThread = 8192;
+// Chunks per thread, so that threads that finish early can take more work
+static constexpr int32_t s_nChunksPerThread = 4;
+
+// Runs oTask(0) ... oTask(nTotTasks - 1) each on its own thread, the first on the calling one.
+// If a thread can't be started its task is run by the calling thread.
+static void runTasks(int32_t nTotTasks, const std::function<void(int32_t nTask)>& oTask) noexcept
+{
+	std::vector<std::thread> aThreads;
+	std::vector<int32_t> aNotStarted;
+	for (int32_t nTask = 1; nTask < nTotTasks; ++nTask) {
+		try {
+			aThreads.emplace_back(oTask, nTask);
+		} catch (const std::system_error& oErr) {
+			aNotStarted.push_back(nTask);
+		}
+	}
+	if (nTotTasks > 0) {
+		oTask(0);
+	}
+	for (const int32_t nTask : aNotStarted) {
+		oTask(nTask);
+	}
+	for (auto& oThread : aThreads) {
+		oThread.join();
+	}
+}
+static bool isPathWithin(const std::string& sDirPath, const std::string& sPath) noexcept
+{
+	const size_t nDirSize = sDirPath.size();
+	if (sPath.compare(0, nDirSize, sDirPath) != 0) {
+		return false; //--------------------------------------------------------
+	}
+	return (sPath.size() == nDirSize) || (sDirPath.back() == '/') || (sPath[nDirSize] == '/');
+}
+
+SortedDump::SortedDump(const FofiModel& oFofiModel, const Config& oConfig) noexcept
+: m_oFofiModel(oFofiModel)
+, m_oConfig(oConfig)
+, m_nTotUsedThreads(0)
+{
+	assert(m_oConfig.m_bJSon || ! m_oConfig.m_bNDJSon);
+	assert(m_oConfig.m_nTotThreads >= 0);
+}
+int32_t SortedDump::comparePaths(const std::string& sPath1, const std::string& sPath2) noexcept
+{
+	const size_t nMinSize = std::min(sPath1.size(), sPath2.size());
+	for (size_t nIdx = 0; nIdx < nMinSize; ++nIdx) {
+		const unsigned char c1 = static_cast<unsigned char>(sPath1[nIdx]);
+		const unsigned char c2 = static_cast<unsigned char>(sPath2[nIdx]);
+		if (c1 == c2) {
+			continue; // for ---
+		}
+		if (c1 == '/') {
+			return -1; //-------------------------------------------------------
+		}
+		if (c2 == '/') {
+			return 1; //--------------------------------------------------------
+		}
+		return ((c1 < c2) ? -1 : 1); //-----------------------------------------
+	}
+	if (sPath1.size() == sPath2.size()) {
+		return 0; //------------------------------------------------------------
+	}
+	return ((sPath1.size() < sPath2.size()) ? -1 : 1);
+}
+int32_t SortedDump::calcTotThreads(int32_t nTotItems) const noexcept
+{
+	int32_t nTotThreads = m_oConfig.m_nTotThreads;
+	if (nTotThreads == 0) {
+		nTotThreads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
+	return std::max(1, std::min(nTotThreads, nTotItems / s_nMinItemsPerThread));
+}
+std::string SortedDump::sort()
+{
+	m_aSpilledResults.clear();
+	m_aParentPaths.clear();
+	m_aEntries.clear();
+	m_aGroups.clear();
+	// forEachWatchedResult() visits the results in memory first: their references stay valid
+	int32_t nTotInMemory = 0;
+	for (const auto& oResult : m_oFofiModel.getWatchedResults()) {
+		if (! oResult.isFree()) {
+			++nTotInMemory;
+		}
+	}
+	// The entries temporarily hold the index into m_aParentPaths instead of the rank
+	std::unordered_map<int32_t, int32_t> oParentIds; // Key: parent ToWatchDir index, Value: index into m_aParentPaths
+	int32_t nTotVisited = 0;
+	const auto sError = m_oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+	{
+		const FofiModel::WatchedResult* p0Result = &oResult;
+		if (nTotVisited >= nTotInMemory) {
+			m_aSpilledResults.push_back(oResult);
+			p0Result = &m_aSpilledResults.back();
+		}
+		++nTotVisited;
+		if (m_oConfig.m_bSkipTemporary && (oResult.m_eResultType == FofiModel::RESULT_TEMPORARY)) {
+			return; //----------------------------------------------------------
+		}
+		const int32_t nParentIdx = oResult.getParentIdx();
+		auto itFind = oParentIds.find(nParentIdx);
+		if (itFind == oParentIds.end()) {
+			// computing the path is the expensive part: once per directory
+			itFind = oParentIds.emplace(nParentIdx, static_cast<int32_t>(m_aParentPaths.size())).first;
+			m_aParentPaths.push_back(m_oFofiModel.getWatchedResultParentPath(oResult));
+		}
+		m_aEntries.push_back(Entry{p0Result, m_oFofiModel.getWatchedResultNamePtr(oResult), itFind->second});
+	});
+	// Sort the directories, the entries are then compared by rank
+	const int32_t nTotParents = static_cast<int32_t>(m_aParentPaths.size());
+	std::vector<int32_t> aSortedIds(nTotParents);
+	for (int32_t nId = 0; nId < nTotParents; ++nId) {
+		aSortedIds[nId] = nId;
+	}
+	std::sort(aSortedIds.begin(), aSortedIds.end(), [&](int32_t nId1, int32_t nId2)
+	{
+		return (comparePaths(m_aParentPaths[nId1], m_aParentPaths[nId2]) < 0);
+	});
+	std::vector<int32_t> aRanks(nTotParents);
+	std::vector<std::string> aSortedPaths;
+	aSortedPaths.reserve(nTotParents);
+	for (const int32_t nId : aSortedIds) {
+		// the root directory might be reached from different indexes
+		if (aSortedPaths.empty() || (aSortedPaths.back() != m_aParentPaths[nId])) {
+			aSortedPaths.push_back(std::move(m_aParentPaths[nId]));
+		}
+		aRanks[nId] = static_cast<int32_t>(aSortedPaths.size()) - 1;
+	}
+	m_aParentPaths.swap(aSortedPaths);
+	for (Entry& oEntry : m_aEntries) {
+		oEntry.m_nParentRank = aRanks[oEntry.m_nParentRank];
+	}
+	const int32_t nTotThreads = calcTotThreads(static_cast<int32_t>(m_aEntries.size()));
+	m_nTotUsedThreads = nTotThreads;
+	sortEntries(nTotThreads);
+	calcGroups();
+	return sError;
+}
+void SortedDump::sortEntries(int32_t nTotThreads) noexcept
+{
+	const auto oLess = [](const Entry& oEntry1, const Entry& oEntry2)
+	{
+		if (oEntry1.m_nParentRank != oEntry2.m_nParentRank) {
+			return (oEntry1.m_nParentRank < oEntry2.m_nParentRank); //----------
+		}
+		const int nCmp = std::strcmp(oEntry1.m_p0Name, oEntry2.m_p0Name);
+		if (nCmp != 0) {
+			return (nCmp < 0); //-----------------------------------------------
+		}
+		// a file and a directory with the same name: the file first
+		return (! oEntry1.m_p0Result->m_bIsDir) && oEntry2.m_p0Result->m_bIsDir;
+	};
+	const int32_t nTotEntries = static_cast<int32_t>(m_aEntries.size());
+	// Each thread sorts a part, then neighbouring parts are merged pairwise
+	std::vector<int32_t> aBounds(nTotThreads + 1);
+	for (int32_t nPart = 0; nPart <= nTotThreads; ++nPart) {
+		aBounds[nPart] = static_cast<int32_t>(static_cast<int64_t>(nTotEntries) * nPart / nTotThreads);
+	}
+	const auto itBegin = m_aEntries.begin();
+	runTasks(nTotThreads, [&](int32_t nPart)
+	{
+		std::sort(itBegin + aBounds[nPart], itBegin + aBounds[nPart + 1], oLess);
+	});
+	for (int32_t nStep = 1; nStep < nTotThreads; nStep *= 2) {
+		const int32_t nTotMerges = (nTotThreads - nStep + 2 * nStep - 1) / (2 * nStep);
+		runTasks(nTotMerges, [&](int32_t nMerge)
+		{
+			const int32_t nFirstPart = nMerge * 2 * nStep;
+			const int32_t nEndPart = std::min(nFirstPart + 2 * nStep, nTotThreads);
+			std::inplace_merge(itBegin + aBounds[nFirstPart], itBegin + aBounds[nFirstPart + nStep]
+								, itBegin + aBounds[nEndPart], oLess);
+		});
+	}
+}
+void SortedDump::calcGroups() noexcept
+{
+	const int32_t nTotEntries = static_cast<int32_t>(m_aEntries.size());
+	for (int32_t nIdx = 0; nIdx < nTotEntries; ++nIdx) {
+		const int32_t nParentRank = m_aEntries[nIdx].m_nParentRank;
+		if (m_aGroups.empty() || (m_aGroups.back().m_nParentRank != nParentRank)) {
+			m_aGroups.push_back(Group{nParentRank, nIdx, nIdx + 1, nIdx + 1});
+		} else {
+			m_aGroups.back().m_nEnd = nIdx + 1;
+		}
+	}
+	// The groups of a subtree are contiguous because of comparePaths()
+	const auto itGroupsEnd = m_aGroups.end();
+	for (auto itGroup = m_aGroups.begin(); itGroup != itGroupsEnd; ++itGroup) {
+		const std::string& sDirPath = m_aParentPaths[itGroup->m_nParentRank];
+		const auto itSubtreeEnd = std::partition_point(itGroup + 1, itGroupsEnd, [&](const Group& oGroup)
+		{
+			return isPathWithin(sDirPath, m_aParentPaths[oGroup.m_nParentRank]);
+		});
+		itGroup->m_nSubtreeEnd = (itSubtreeEnd - 1)->m_nEnd;
+	}
+}
+void SortedDump::formatChunk(int32_t nFirstGroup, int32_t nEndGroup, bool bFirst, bool bLast, int64_t nDurationUsec
+							, std::string& sBuffer) const noexcept
+{
+	std::ostringstream oOut;
+	if (m_oConfig.m_bJSon) {
+		JsonWriter oWriter(oOut, m_oConfig.m_bNDJSon);
+		if (bFirst) {
+			oWriter.beginSequence();
+		} else {
+			oWriter.continueSequence();
+		}
+		for (int32_t nGroup = nFirstGroup; nGroup < nEndGroup; ++nGroup) {
+			const Group& oGroup = m_aGroups[nGroup];
+			const std::string& sDirPath = m_aParentPaths[oGroup.m_nParentRank];
+			oWriter.beginObject();
+			oWriter.key("Directory");
+			oWriter.fileNameValue(sDirPath);
+			oWriter.key("Results");
+			oWriter.beginArray();
+			for (int32_t nIdx = oGroup.m_nBegin; nIdx < oGroup.m_nEnd; ++nIdx) {
+				printResultJSon(oWriter, m_oFofiModel, *m_aEntries[nIdx].m_p0Result, sDirPath, m_oConfig.m_bDetail, nDurationUsec);
+			}
+			oWriter.endArray();
+			oWriter.key("Subtree results");
+			oWriter.value(oGroup.m_nSubtreeEnd - oGroup.m_nBegin);
+			oWriter.endObject();
+		}
+		if (bLast) {
+			oWriter.endSequence();
+		} else {
+			oWriter.flush();
+		}
+	} else {
+		TextWriter oWriter(oOut);
+		for (int32_t nGroup = nFirstGroup; nGroup < nEndGroup; ++nGroup) {
+			const Group& oGroup = m_aGroups[nGroup];
+			const std::string& sDirPath = m_aParentPaths[oGroup.m_nParentRank];
+			oWriter.append("Dir: ");
+			oWriter.appendFileName(sDirPath);
+			if (sDirPath != "/") {
+				oWriter.append('/');
+			}
+			oWriter.append("  (results: ");
+			oWriter.appendInt(oGroup.m_nEnd - oGroup.m_nBegin);
+			oWriter.append(", subtree: ");
+			oWriter.appendInt(oGroup.m_nSubtreeEnd - oGroup.m_nBegin);
+			oWriter.append(')');
+			oWriter.endLine();
+			for (int32_t nIdx = oGroup.m_nBegin; nIdx < oGroup.m_nEnd; ++nIdx) {
+				printResult(oWriter, m_oFofiModel, *m_aEntries[nIdx].m_p0Result, sDirPath, m_oConfig.m_bDetail, nDurationUsec);
+			}
+		}
+	}
+	sBuffer = oOut.str();
+}
+std::vector<std::string> SortedDump::formatChunks(int64_t nDurationUsec)
+{
+	const int32_t nTotGroups = static_cast<int32_t>(m_aGroups.size());
+	const int32_t nTotThreads = calcTotThreads(static_cast<int32_t>(m_aEntries.size()));
+	m_nTotUsedThreads = nTotThreads;
+	// Split the groups into chunks of about the same number of results
+	std::vector<int32_t> aChunkFirstGroups;
+	const int32_t nTargetChunkSize = std::max<int32_t>(1, static_cast<int32_t>(m_aEntries.size()) / (nTotThreads * s_nChunksPerThread));
+	int32_t nChunkSize = nTargetChunkSize;
+	for (int32_t nGroup = 0; nGroup < nTotGroups; ++nGroup) {
+		if (nChunkSize >= nTargetChunkSize) {
+			aChunkFirstGroups.push_back(nGroup);
+			nChunkSize = 0;
+		}
+		nChunkSize += m_aGroups[nGroup].m_nEnd - m_aGroups[nGroup].m_nBegin;
+	}
+	if (aChunkFirstGroups.empty()) {
+		// still needs the begin and end of the json sequence
+		aChunkFirstGroups.push_back(0);
+	}
+	const int32_t nTotChunks = static_cast<int32_t>(aChunkFirstGroups.size());
+	aChunkFirstGroups.push_back(nTotGroups);
+	std::vector<std::string> aBuffers(nTotChunks);
+	std::atomic<int32_t> nNextChunk{0};
+	runTasks(std::min(nTotThreads, nTotChunks), [&](int32_t /*nTask*/)
+	{
+		while (true) {
+			const int32_t nChunk = nNextChunk.fetch_add(1);
+			if (nChunk >= nTotChunks) {
+				break; // while ----
+			}
+			formatChunk(aChunkFirstGroups[nChunk], aChunkFirstGroups[nChunk + 1], (nChunk == 0), (nChunk == nTotChunks - 1)
+						, nDurationUsec, aBuffers[nChunk]);
+		}
+	});
+	return aBuffers;
+}
+std::string SortedDump::write(int nFD, int64_t nDurationUsec)
+{
+	std::vector<std::string> aBuffers = formatChunks(nDurationUsec);
+	// Write the buffers in order without joining them
+	std::vector<struct iovec> aIOVecs;
+	aIOVecs.reserve(aBuffers.size());
+	for (std::string& sBuffer : aBuffers) {
+		if (! sBuffer.empty()) {
+			aIOVecs.push_back(iovec{&(sBuffer[0]), sBuffer.size()});
+		}
+	}
+	const size_t nTotIOVecs = aIOVecs.size();
+	size_t nCurIOVec = 0;
+	while (nCurIOVec < nTotIOVecs) {
+		const int nBatch = static_cast<int>(std::min<size_t>(nTotIOVecs - nCurIOVec, IOV_MAX));
+		const ssize_t nWritten = ::writev(nFD, &(aIOVecs[nCurIOVec]), nBatch);
+		if (nWritten < 0) {
+			if (errno == EINTR) {
+				continue; // while ----
+			}
+			return std::string("Could not write sorted results: ") + ::strerror(errno); //---
+		}
+		// skip what was written, possibly in the middle of a buffer
+		size_t nLeft = static_cast<size_t>(nWritten);
+		while ((nLeft > 0) && (nCurIOVec < nTotIOVecs)) {
+			struct iovec& oIOVec = aIOVecs[nCurIOVec];
+			if (nLeft >= oIOVec.iov_len) {
+				nLeft -= oIOVec.iov_len;
+				++nCurIOVec;
+			} else {
+				oIOVec.iov_base = static_cast<char*>(oIOVec.iov_base) + nLeft;
+				oIOVec.iov_len -= nLeft;
+				nLeft = 0;
+			}
+		}
+	}
+	return "";
+}
+std::string SortedDump::write(std::ostream& oOut, int64_t nDurationUsec)
+{
+	const std::vector<std::string> aBuffers = formatChunks(nDurationUsec);
+	for (const std::string& sBuffer : aBuffers) {
+		oOut.write(sBuffer.data(), static_cast<std::streamsize>(sBuffer.size()));
+	}
+	if (! oOut) {
+		return "Could not write sorted results"; //-----------------------------
+	}
+	return "";
+}
+
+} // namespace fofi
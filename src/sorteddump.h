@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   sorteddump.h
+ */
+
+#ifndef FOFIMON_SORTED_DUMP_H_
+#define FOFIMON_SORTED_DUMP_H_
+
+#include "fofimodel.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <ostream>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Writes the results of a model sorted by path and grouped by parent directory.
+ *
+ * The groups are ordered so that the subdirectories of a directory follow it,
+ * within a group the results are ordered by name. Each group starts with the
+ * path of the directory, the number of its results and the number of results
+ * in the whole subtree of the directory. In text mode:
+ *
+ *     Dir: /a/b/  (results: 2, subtree: 5)
+ *     M /a/b/x.txt
+ *     C /a/b/y/
+ *     Dir: /a/b/y/  (results: 3, subtree: 3)
+ *     ...
+ *
+ * In json mode each group is a value of the sequence with keys "Directory",
+ * "Results" (the array of result objects) and "Subtree results".
+ *
+ * The results are sorted by several threads, then the groups are split into
+ * chunks that are formatted in parallel, each into its own buffer. The buffers
+ * are written in order with writev() or, for example when the output is
+ * compressed, to a stream. */
+class SortedDump
+{
+public:
+	struct Config
+	{
+		bool m_bJSon = false;
+		bool m_bNDJSon = false; /**< Newline delimited json. If true m_bJSon must also be true. */
+		bool m_bDetail = false; /**< Whether to print the actions of each result. */
+		bool m_bSkipTemporary = false; /**< Whether RESULT_TEMPORARY results are left out. */
+		int32_t m_nTotThreads = 0; /**< The max number of threads or 0 for the number of hardware threads. */
+	};
+	/** Constructor.
+	 * @param oFofiModel The model. Must not be modified while the object is used.
+	 * @param oConfig The configuration.
+	 */
+	SortedDump(const FofiModel& oFofiModel, const Config& oConfig) noexcept;
+	/** Collects and sorts the results.
+	 * If a spilled result couldn't be read the others are still sorted.
+	 * @return Empty string or error if spilled results couldn't be read.
+	 */
+	std::string sort();
+	/** Writes the sorted results.
+	 * Must be called after sort().
+	 * @param nFD The file descriptor open for writing.
+	 * @param nDurationUsec The duration of the watching. Used to format times.
+	 * @return Empty string or error.
+	 */
+	std::string write(int nFD, int64_t nDurationUsec);
+	/** Writes the sorted results to a stream.
+	 * Must be called after sort(). The chunks are formatted in parallel as
+	 * in write(int, int64_t) but written with std::ostream::write().
+	 * @param oOut The stream.
+	 * @param nDurationUsec The duration of the watching. Used to format times.
+	 * @return Empty string or error.
+	 */
+	std::string write(std::ostream& oOut, int64_t nDurationUsec);
+
+	/** The number of groups (parent directories) after sort().
+	 * @return The number of groups.
+	 */
+	int32_t getTotGroups() const noexcept { return static_cast<int32_t>(m_aGroups.size()); }
+	/** The number of sorted results.
+	 * @return The number of results.
+	 */
+	int32_t getTotResults() const noexcept { return static_cast<int32_t>(m_aEntries.size()); }
+	/** The number of threads used by the last sort() or write().
+	 * @return The number of threads.
+	 */
+	int32_t getTotUsedThreads() const noexcept { return m_nTotUsedThreads; }
+
+	/** Compares two paths, component by component.
+	 * Like a byte comparison where '/' is smaller than any other character,
+	 * so that "/a/b/c" comes before "/a/b.txt".
+	 * @param sPath1 The first path.
+	 * @param sPath2 The second path.
+	 * @return Negative if sPath1 comes first, 0 if equal, positive otherwise.
+	 */
+	static int32_t comparePaths(const std::string& sPath1, const std::string& sPath2) noexcept;
+private:
+	struct Entry
+	{
+		const FofiModel::WatchedResult* m_p0Result;
+		const char* m_p0Name;
+		int32_t m_nParentRank; // the position of the parent path in m_aParentPaths once sorted
+	};
+	struct Group
+	{
+		int32_t m_nParentRank;
+		int32_t m_nBegin; // first entry
+		int32_t m_nEnd; // after last entry of the group
+		int32_t m_nSubtreeEnd; // after last entry of the subtree
+	};
+	int32_t calcTotThreads(int32_t nTotItems) const noexcept;
+	void sortEntries(int32_t nTotThreads) noexcept;
+	void calcGroups() noexcept;
+	std::vector<std::string> formatChunks(int64_t nDurationUsec);
+	void formatChunk(int32_t nFirstGroup, int32_t nEndGroup, bool bFirst, bool bLast, int64_t nDurationUsec, std::string& sBuffer) const noexcept;
+private:
+	const FofiModel& m_oFofiModel;
+	const Config m_oConfig;
+	std::deque<FofiModel::WatchedResult> m_aSpilledResults; // copies of the results read from disk
+	std::vector<std::string> m_aParentPaths; // sorted
+	std::vector<Entry> m_aEntries;
+	std::vector<Group> m_aGroups;
+	int32_t m_nTotUsedThreads;
+private:
+	SortedDump(const SortedDump& oSource) = delete;
+	SortedDump& operator=(const SortedDump& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_SORTED_DUMP_H_ */
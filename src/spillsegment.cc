@@ -0,0 +1,123 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spillsegment.cc
+ */
+
+#include "spillsegment.h"
+
+#include <cassert>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace fofi
+{
+
+SpillSegment::SpillSegment() noexcept
+: m_nFD(-1)
+, m_nSize(0)
+{
+}
+SpillSegment::~SpillSegment() noexcept
+{
+	close();
+}
+std::string SpillSegment::open(const std::string& sDir)
+{
+	assert(! sDir.empty());
+	close();
+	std::string sTemplate = sDir + "/fofimon-spill-XXXXXX";
+	std::vector<char> aTemplate(sTemplate.begin(), sTemplate.end());
+	aTemplate.push_back(0);
+	const int nFD = ::mkstemp(aTemplate.data());
+	if (nFD < 0) {
+		const std::string sError = "Could not create spill file in " + sDir + ": " + ::strerror(errno);
+		return sError; //-------------------------------------------------------
+	}
+	m_nFD = nFD;
+	m_sPath = aTemplate.data();
+	m_nSize = 0;
+	return "";
+}
+void SpillSegment::close() noexcept
+{
+	if (m_nFD < 0) {
+		return; //--------------------------------------------------------------
+	}
+	::close(m_nFD);
+	::unlink(m_sPath.c_str());
+	m_nFD = -1;
+	m_sPath.clear();
+	m_nSize = 0;
+}
+int64_t SpillSegment::append(const char* p0Data, int32_t nSize) noexcept
+{
+	assert(isOpen());
+	assert(p0Data != nullptr);
+	assert(nSize > 0);
+	const int64_t nOffset = m_nSize;
+	int32_t nWritten = 0;
+	while (nWritten < nSize) {
+		const ssize_t nRes = ::pwrite(m_nFD, p0Data + nWritten, nSize - nWritten, nOffset + nWritten);
+		if (nRes < 0) {
+			if (errno == EINTR) {
+				continue; // while ---
+			}
+			// the partially written record is overwritten by the next append
+			return -1; //-------------------------------------------------------
+		}
+		nWritten += static_cast<int32_t>(nRes);
+	}
+	m_nSize += nSize;
+	return nOffset;
+}
+bool SpillSegment::read(int64_t nOffset, char* p0Data, int32_t nSize) const noexcept
+{
+	assert(isOpen());
+	assert(p0Data != nullptr);
+	assert(nSize > 0);
+	assert((nOffset >= 0) && (nOffset + nSize <= m_nSize));
+	int32_t nRead = 0;
+	while (nRead < nSize) {
+		const ssize_t nRes = ::pread(m_nFD, p0Data + nRead, nSize - nRead, nOffset + nRead);
+		if (nRes < 0) {
+			if (errno == EINTR) {
+				continue; // while ---
+			}
+			return false; //----------------------------------------------------
+		}
+		if (nRes == 0) {
+			return false; //----------------------------------------------------
+		}
+		nRead += static_cast<int32_t>(nRes);
+	}
+	return true;
+}
+void SpillSegment::swap(SpillSegment& oOther) noexcept
+{
+	std::swap(m_nFD, oOther.m_nFD);
+	m_sPath.swap(oOther.m_sPath);
+	std::swap(m_nSize, oOther.m_nSize);
+}
+
+} // namespace fofi
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   spillsegment.h
+ */
+
+#ifndef FOFIMON_SPILL_SEGMENT_H_
+#define FOFIMON_SPILL_SEGMENT_H_
+
+#include <string>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/** Append-only file of records.
+ * Records are appended at the end of the file and are never modified,
+ * a record is identified by its offset. The file is private to the
+ * process and is deleted by close() and by the destructor.
+ * The space of records no longer needed is reclaimed by copying the others
+ * to a new segment and swapping it with this one.
+ */
+class SpillSegment
+{
+public:
+	SpillSegment() noexcept;
+	~SpillSegment() noexcept;
+	/** Create the file.
+	 * If already open the old file is closed and deleted first.
+	 * @param sDir The directory in which to create the file. Cannot be empty.
+	 * @return Empty string or error.
+	 */
+	std::string open(const std::string& sDir);
+	/** Close and delete the file.
+	 * Does nothing if not open.
+	 */
+	void close() noexcept;
+	/** Whether the file is open.
+	 * @return Whether open.
+	 */
+	bool isOpen() const noexcept { return (m_nFD >= 0); }
+	/** The path of the file.
+	 * @return The path or empty if not open.
+	 */
+	const std::string& getPath() const noexcept { return m_sPath; }
+	/** The size of the file.
+	 * @return The number of bytes appended since open().
+	 */
+	int64_t size() const noexcept { return m_nSize; }
+	/** Appends a record.
+	 * @param p0Data The data. Cannot be null.
+	 * @param nSize The size of the data in bytes. Must be positive.
+	 * @return The offset of the record or -1 if the write failed (ex. disk full).
+	 */
+	int64_t append(const char* p0Data, int32_t nSize) noexcept;
+	/** Reads (part of) a record.
+	 * @param nOffset The offset as returned by append().
+	 * @param p0Data The buffer. Cannot be null.
+	 * @param nSize The number of bytes to read. Must be positive.
+	 * @return Whether all the bytes could be read.
+	 */
+	bool read(int64_t nOffset, char* p0Data, int32_t nSize) const noexcept;
+	/** Exchanges the files of two segments.
+	 * @param oOther The other segment.
+	 */
+	void swap(SpillSegment& oOther) noexcept;
+private:
+	int m_nFD;
+	std::string m_sPath;
+	int64_t m_nSize;
+private:
+	SpillSegment(const SpillSegment& oSource) = delete;
+	SpillSegment& operator=(const SpillSegment& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_SPILL_SEGMENT_H_ */
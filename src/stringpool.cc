@@ -0,0 +1,224 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   stringpool.cc
+ */
+
+#include "stringpool.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace fofi
+{
+
+const char* const StringPool::s_p0Released = "";
+
+StringPool::StringPool() noexcept
+: m_nChunksBytes(0)
+, m_p0Free(nullptr)
+, m_nFreeSize(0)
+, m_nFreeBytes(0)
+{
+	m_aBuckets.resize(s_nInitialBuckets, -1);
+}
+void StringPool::clear() noexcept
+{
+	m_aChunks.clear();
+	m_nChunksBytes = 0;
+	m_p0Free = nullptr;
+	m_nFreeSize = 0;
+	m_aStrings.clear();
+	m_aHashes.clear();
+	m_aBuckets.assign(s_nInitialBuckets, -1);
+	m_aFreeIds.clear();
+	m_oFreeBytes.clear();
+	m_nFreeBytes = 0;
+}
+uint32_t StringPool::calcHash(const char* p0Str, size_t nLen) noexcept
+{
+	// FNV-1a
+	uint32_t nHash = 2166136261u;
+	for (size_t nIdx = 0; nIdx < nLen; ++nIdx) {
+		nHash ^= static_cast<uint8_t>(p0Str[nIdx]);
+		nHash *= 16777619u;
+	}
+	return nHash;
+}
+int32_t StringPool::findBucket(const char* p0Str, size_t nLen, uint32_t nHash) const noexcept
+{
+	const int32_t nMask = static_cast<int32_t>(m_aBuckets.size()) - 1;
+	int32_t nBucket = static_cast<int32_t>(nHash) & nMask;
+	while (true) {
+		const int32_t nId = m_aBuckets[nBucket];
+		if (nId < 0) {
+			return nBucket; //--------------------------------------------------
+		}
+		if (m_aHashes[nId] == nHash) {
+			const char* p0Cur = m_aStrings[nId];
+			// strncmp stops at the terminator of the shorter
+			if ((std::strncmp(p0Cur, p0Str, nLen) == 0) && (p0Cur[nLen] == '\0')) {
+				return nBucket; //----------------------------------------------
+			}
+		}
+		nBucket = (nBucket + 1) & nMask;
+	}
+}
+int32_t StringPool::find(const std::string& sStr) const noexcept
+{
+	const auto nLen = sStr.size();
+	const int32_t nBucket = findBucket(sStr.c_str(), nLen, calcHash(sStr.c_str(), nLen));
+	return m_aBuckets[nBucket];
+}
+int32_t StringPool::intern(const std::string& sStr)
+{
+	assert(sStr.find('\0') == std::string::npos);
+	const auto nLen = sStr.size();
+	const uint32_t nHash = calcHash(sStr.c_str(), nLen);
+	int32_t nBucket = findBucket(sStr.c_str(), nLen, nHash);
+	if (m_aBuckets[nBucket] >= 0) {
+		return m_aBuckets[nBucket]; //------------------------------------------
+	}
+	return insert(sStr, nHash, nBucket, true);
+}
+int32_t StringPool::append(const std::string& sStr)
+{
+	assert(sStr.find('\0') == std::string::npos);
+	const auto nLen = sStr.size();
+	const uint32_t nHash = calcHash(sStr.c_str(), nLen);
+	int32_t nBucket = findBucket(sStr.c_str(), nLen, nHash);
+	if (m_aBuckets[nBucket] >= 0) {
+		return m_aBuckets[nBucket]; //------------------------------------------
+	}
+	return insert(sStr, nHash, nBucket, false);
+}
+int32_t StringPool::insert(const std::string& sStr, uint32_t nHash, int32_t nBucket, bool bReuseId)
+{
+	const auto nLen = sStr.size();
+	char* p0Str = allocate(nLen + 1);
+	std::memcpy(p0Str, sStr.c_str(), nLen + 1);
+	int32_t nId;
+	if ((! bReuseId) || m_aFreeIds.empty()) {
+		nId = static_cast<int32_t>(m_aStrings.size());
+		m_aStrings.push_back(p0Str);
+		m_aHashes.push_back(nHash);
+	} else {
+		nId = m_aFreeIds.back();
+		m_aFreeIds.pop_back();
+		m_aStrings[nId] = p0Str;
+		m_aHashes[nId] = nHash;
+	}
+	m_aBuckets[nBucket] = nId;
+	// keep the load factor below 1/2
+	if (2 * m_aStrings.size() > m_aBuckets.size()) {
+		grow();
+	}
+	return nId;
+}
+void StringPool::release(int32_t nId) noexcept
+{
+	assert(! isReleased(nId));
+	const char* p0Str = m_aStrings[nId];
+	const size_t nLen = std::strlen(p0Str);
+	int32_t nHole = findBucket(p0Str, nLen, m_aHashes[nId]);
+	assert(m_aBuckets[nHole] == nId);
+	// backward shift deletion: the following ids of the cluster that can't
+	// be found anymore across the hole are moved into it
+	const int32_t nMask = static_cast<int32_t>(m_aBuckets.size()) - 1;
+	int32_t nBucket = (nHole + 1) & nMask;
+	while (m_aBuckets[nBucket] >= 0) {
+		const int32_t nHome = static_cast<int32_t>(m_aHashes[m_aBuckets[nBucket]]) & nMask;
+		if (((nBucket - nHome) & nMask) >= ((nBucket - nHole) & nMask)) {
+			m_aBuckets[nHole] = m_aBuckets[nBucket];
+			nHole = nBucket;
+		}
+		nBucket = (nBucket + 1) & nMask;
+	}
+	m_aBuckets[nHole] = -1;
+	// the string is in a chunk that is never freed
+	m_oFreeBytes[nLen + 1].push_back(const_cast<char*>(p0Str));
+	m_nFreeBytes += static_cast<int64_t>(nLen + 1);
+	m_aStrings[nId] = s_p0Released;
+	m_aHashes[nId] = 0;
+	m_aFreeIds.push_back(nId);
+}
+int32_t StringPool::addReleased()
+{
+	const int32_t nId = static_cast<int32_t>(m_aStrings.size());
+	m_aStrings.push_back(s_p0Released);
+	m_aHashes.push_back(0);
+	m_aFreeIds.push_back(nId);
+	if (2 * m_aStrings.size() > m_aBuckets.size()) {
+		grow();
+	}
+	return nId;
+}
+char* StringPool::allocate(size_t nSize)
+{
+	if (m_nFreeBytes > 0) {
+		auto itFind = m_oFreeBytes.find(nSize);
+		if (itFind != m_oFreeBytes.end()) {
+			auto& aFree = itFind->second;
+			char* p0Ret = aFree.back();
+			aFree.pop_back();
+			if (aFree.empty()) {
+				m_oFreeBytes.erase(itFind);
+			}
+			m_nFreeBytes -= static_cast<int64_t>(nSize);
+			return p0Ret; //----------------------------------------------------
+		}
+	}
+	if (nSize > m_nFreeSize) {
+		// the rest of the current chunk is wasted
+		const size_t nChunkSize = ((nSize > s_nChunkSize) ? nSize : s_nChunkSize);
+		m_aChunks.emplace_back(new char[nChunkSize]);
+		m_nChunksBytes += static_cast<int64_t>(nChunkSize);
+		m_p0Free = m_aChunks.back().get();
+		m_nFreeSize = nChunkSize;
+	}
+	char* p0Ret = m_p0Free;
+	m_p0Free += nSize;
+	m_nFreeSize -= nSize;
+	return p0Ret;
+}
+void StringPool::grow()
+{
+	m_aBuckets.assign(m_aBuckets.size() * 2, -1);
+	const int32_t nMask = static_cast<int32_t>(m_aBuckets.size()) - 1;
+	const int32_t nTotStrings = static_cast<int32_t>(m_aStrings.size());
+	for (int32_t nId = 0; nId < nTotStrings; ++nId) {
+		if (isReleased(nId)) {
+			continue; // for ---
+		}
+		int32_t nBucket = static_cast<int32_t>(m_aHashes[nId]) & nMask;
+		while (m_aBuckets[nBucket] >= 0) {
+			nBucket = (nBucket + 1) & nMask;
+		}
+		m_aBuckets[nBucket] = nId;
+	}
+}
+int64_t StringPool::getAllocatedBytes() const noexcept
+{
+	return m_nChunksBytes
+			+ static_cast<int64_t>(m_aStrings.capacity() * sizeof(const char*))
+			+ static_cast<int64_t>(m_aHashes.capacity() * sizeof(uint32_t))
+			+ static_cast<int64_t>(m_aBuckets.capacity() * sizeof(int32_t))
+			+ static_cast<int64_t>(m_aFreeIds.capacity() * sizeof(int32_t))
+			+ static_cast<int64_t>(m_oFreeBytes.size() * (sizeof(size_t) + sizeof(std::vector<char*>)));
+}
+
+} // namespace fofi
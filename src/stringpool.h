@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   stringpool.h
+ */
+
+#ifndef FOFIMON_STRING_POOL_H_
+#define FOFIMON_STRING_POOL_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/** Interned strings stored in an arena.
+ * Each distinct string is stored only once, null terminated, in large
+ * chunks of memory that are never moved or freed until clear() is called,
+ * and is identified by a small non negative integer.
+ *
+ * A string no longer used can be released: its id and its bytes are
+ * reused by the strings interned later.
+ *
+ * The strings should not contain null characters (file names can't).
+ */
+class StringPool
+{
+public:
+	StringPool() noexcept;
+	/** Removes all strings.
+	 * All the ids and pointers returned so far become invalid.
+	 */
+	void clear() noexcept;
+	/** Adds a string if not already present.
+	 * @param sStr The string.
+	 * @return The id of the string. Equal strings have the same id.
+	 */
+	int32_t intern(const std::string& sStr);
+	/** The id of a string.
+	 * @param sStr The string.
+	 * @return The id or -1 if the string was never interned.
+	 */
+	int32_t find(const std::string& sStr) const noexcept;
+	/** The string of an id.
+	 * The returned pointer stays valid until the id is released or clear() is called.
+	 * @param nId The id. Must be valid.
+	 * @return The null terminated string. Empty if the id was released.
+	 */
+	const char* get(int32_t nId) const noexcept
+	{
+		return m_aStrings[nId];
+	}
+	/** The number of ids.
+	 * @return The number of strings including the released ones.
+	 */
+	int32_t size() const noexcept { return static_cast<int32_t>(m_aStrings.size()); }
+	/** Releases a string.
+	 * The id is given to a string interned later.
+	 * @param nId The id. Must be valid and not released.
+	 */
+	void release(int32_t nId) noexcept;
+	/** Adds a string with a new id.
+	 * Unlike intern() the released ids are not reused.
+	 * Used with addReleased() to rebuild a pool with the same ids.
+	 * @param sStr The string.
+	 * @return The new id or, if the string is already present, its id.
+	 */
+	int32_t append(const std::string& sStr);
+	/** Adds a released id.
+	 * Used with append() to rebuild a pool with the same ids.
+	 * @return The new id.
+	 */
+	int32_t addReleased();
+	/** Whether an id was released.
+	 * @param nId The id. Must be valid.
+	 * @return Whether released.
+	 */
+	bool isReleased(int32_t nId) const noexcept { return (m_aStrings[nId] == s_p0Released); }
+	/** The number of released ids not yet reused.
+	 * @return The number of ids.
+	 */
+	int32_t getTotReleased() const noexcept { return static_cast<int32_t>(m_aFreeIds.size()); }
+	/** The memory allocated for the strings and the lookup table.
+	 * @return The size in bytes.
+	 */
+	int64_t getAllocatedBytes() const noexcept;
+private:
+	static uint32_t calcHash(const char* p0Str, size_t nLen) noexcept;
+	// returns the bucket containing the id of the string or the empty bucket where it should be put
+	int32_t findBucket(const char* p0Str, size_t nLen, uint32_t nHash) const noexcept;
+	int32_t insert(const std::string& sStr, uint32_t nHash, int32_t nBucket, bool bReuseId);
+	char* allocate(size_t nSize);
+	void grow();
+private:
+	static constexpr size_t s_nChunkSize = 256 * 1024;
+	static constexpr int32_t s_nInitialBuckets = 1024; // must be a power of two
+	static const char* const s_p0Released; // The string of released ids
+	std::vector<std::unique_ptr<char[]>> m_aChunks;
+	int64_t m_nChunksBytes;
+	char* m_p0Free; // within the last chunk
+	size_t m_nFreeSize;
+	std::vector<const char*> m_aStrings; // Index: id
+	std::vector<uint32_t> m_aHashes; // Index: id
+	std::vector<int32_t> m_aBuckets; // Value: id or -1 (open addressing)
+	std::vector<int32_t> m_aFreeIds; // The released ids
+	std::unordered_map<size_t, std::vector<char*>> m_oFreeBytes; // Key: size including the terminator, Value: released strings
+	int64_t m_nFreeBytes; // The sum of the sizes of the strings in m_oFreeBytes
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_STRING_POOL_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   tailmain.cc
+ */
+
+#include "shmring.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <stdlib.h>
+
+namespace fofi
+{
+
+void printTailUsage() noexcept
+{
+	std::cout << "Usage: fofimon-tail [--from-oldest] NAME" << '\n';
+	std::cout << "Prints the events published by 'fofimon --live-shm NAME' until fofimon stops." << '\n';
+	std::cout << "Each line contains the microseconds from the start of watching, the action," << '\n';
+	std::cout << "the status after the action and the path." << '\n';
+	std::cout << "  --from-oldest   Starts from the oldest event still in the ring buffer" << '\n';
+	std::cout << "                  rather than from the next one." << '\n';
+}
+
+static void printTailEvent(std::ostream& oOut, const LiveBinary::Event& oEvent, const std::string& sPath, const std::string& sOtherPath) noexcept
+{
+	oOut << oEvent.m_nTimeUsec << ' ' << LiveBinary::getActionCodeString(oEvent.m_eAction)
+			<< ' ' << LiveBinary::getResultTypeCodeString(oEvent.m_eResultType)
+			<< ' ' << sPath << (((oEvent.m_nFlags & LiveBinary::LIVE_FLAG_DIR) != 0) ? "/" : "");
+	const bool bIsRenameFrom = (oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_FROM);
+	if (bIsRenameFrom || (oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_TO)) {
+		oOut << (bIsRenameFrom ? "  (T " : "  (F ");
+		oOut << (sOtherPath.empty() ? std::string{"unknown"} : sOtherPath) << ")";
+	}
+	if (oEvent.m_nCount > 1) {
+		oOut << "  (" << oEvent.m_nCount << " times)";
+	}
+	if ((oEvent.m_nFlags & ShmRing::LIVE_FLAG_TRUNCATED) != 0) {
+		oOut << "  (truncated)";
+	}
+	oOut << '\n';
+}
+
+int fofimonTailMain(int nArgC, char** aArgV) noexcept
+{
+	bool bFromOldest = false;
+	std::string sName;
+	for (int nArg = 1; nArg < nArgC; ++nArg) {
+		const std::string sArg = aArgV[nArg];
+		if ((sArg == "-h") || (sArg == "--help")) {
+			printTailUsage();
+			return EXIT_SUCCESS; //---------------------------------------------
+		} else if (sArg == "--from-oldest") {
+			bFromOldest = true;
+		} else if (sName.empty() && (sArg.substr(0, 1) != "-")) {
+			sName = sArg;
+		} else {
+			printTailUsage();
+			return EXIT_FAILURE; //---------------------------------------------
+		}
+	}
+	if (sName.empty()) {
+		printTailUsage();
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	ShmRingReader oReader;
+	const auto sError = oReader.open(sName, bFromOldest);
+	if (! sError.empty()) {
+		std::cerr << sError << '\n';
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	LiveBinary::Event oEvent;
+	std::string sPath;
+	std::string sOtherPath;
+	int64_t nReportedLost = 0;
+	while (true) {
+		const ShmRingReader::READ_RESULT eResult = oReader.next(oEvent, sPath, sOtherPath);
+		if (eResult == ShmRingReader::READ_RESULT_EVENT) {
+			printTailEvent(std::cout, oEvent, sPath, sOtherPath);
+		} else if (eResult == ShmRingReader::READ_RESULT_LAGGED) {
+			std::cout.flush();
+			std::cerr << "Lost " << (oReader.getTotLost() - nReportedLost) << " events" << '\n';
+			nReportedLost = oReader.getTotLost();
+		} else if (eResult == ShmRingReader::READ_RESULT_NONE) {
+			std::cout.flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} else {
+			break; // while ----
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+} // namespace fofi
+
+int main(int nArgC, char** aArgV)
+{
+	return fofi::fofimonTailMain(nArgC, aArgV);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   textwriter.cc
+ */
+
+#include "textwriter.h"
+
+#include "util.h"
+
+#include <glibmm.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace fofi
+{
+
+static constexpr size_t s_nFlushBufferSize = 64 * 1024;
+
+static bool areFileNamesUtf8() noexcept
+{
+	const gchar** aCharsets = nullptr;
+	return ::g_get_filename_charsets(&aCharsets);
+}
+
+FileNameEncoding::FileNameEncoding() noexcept
+: m_bFileNamesUtf8(areFileNamesUtf8())
+{
+}
+bool FileNameEncoding::isUtf8(const char* p0FileName, size_t nSize) const noexcept
+{
+	return m_bFileNamesUtf8 && ::g_utf8_validate(p0FileName, nSize, nullptr);
+}
+bool FileNameEncoding::isUtf8(const std::string& sDirPath, const char* p0Name, size_t nNameSize) const noexcept
+{
+	// both valid means the joined path is valid
+	return isUtf8(sDirPath) && isUtf8(p0Name, nNameSize);
+}
+
+TextWriter::TextWriter(std::ostream& oOut) noexcept
+: m_oOut(oOut)
+{
+	m_sBuffer.reserve(s_nFlushBufferSize + 4096);
+}
+TextWriter::~TextWriter() noexcept
+{
+	flush();
+}
+void TextWriter::flush() noexcept
+{
+	if (m_sBuffer.empty()) {
+		return; //--------------------------------------------------------------
+	}
+	m_oOut.write(m_sBuffer.data(), m_sBuffer.size());
+	m_sBuffer.clear();
+}
+void TextWriter::endLine() noexcept
+{
+	m_sBuffer.push_back('\n');
+	if (m_sBuffer.size() >= s_nFlushBufferSize) {
+		flush();
+	}
+}
+void TextWriter::append(const char* p0Str) noexcept
+{
+	assert(p0Str != nullptr);
+	m_sBuffer.append(p0Str, std::strlen(p0Str));
+}
+void TextWriter::appendInt(int64_t nValue) noexcept
+{
+	char aDigits[Util::s_nMaxIntChars];
+	const int32_t nSize = Util::formatInt(nValue, aDigits);
+	m_sBuffer.append(aDigits, nSize);
+}
+void TextWriter::appendTime(int64_t nTimeUsec, int64_t nDurationUsec) noexcept
+{
+	char aTime[Util::s_nMaxTimeChars];
+	const int32_t nSize = Util::formatTime(nTimeUsec, nDurationUsec, aTime);
+	m_sBuffer.append(aTime, nSize);
+}
+void TextWriter::appendFileName(const std::string& sFileName) noexcept
+{
+	if (m_oEncoding.isUtf8(sFileName)) {
+		m_sBuffer.append(sFileName);
+	} else {
+		m_sBuffer.append(Glib::filename_display_name(sFileName).raw());
+	}
+}
+void TextWriter::appendPath(const std::string& sDirPath, const char* p0Name) noexcept
+{
+	assert(p0Name != nullptr);
+	const size_t nNameSize = std::strlen(p0Name);
+	if (! m_oEncoding.isUtf8(sDirPath, p0Name, nNameSize)) {
+		appendFileName(Util::getPathFromDirAndName(sDirPath, p0Name));
+		return; //--------------------------------------------------------------
+	}
+	m_sBuffer.append(sDirPath);
+	if (sDirPath != "/") {
+		m_sBuffer.push_back('/');
+	}
+	m_sBuffer.append(p0Name, nNameSize);
+}
+
+} // namespace fofi
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   textwriter.h
+ */
+
+#ifndef FOFIMON_TEXT_WRITER_H_
+#define FOFIMON_TEXT_WRITER_H_
+
+#include <string>
+#include <ostream>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Whether file names in the file system encoding can be written as they are.
+ * Used by TextWriter and JsonWriter. The encoding is determined once
+ * on construction. */
+class FileNameEncoding
+{
+public:
+	FileNameEncoding() noexcept;
+	/** Whether the encoding is UTF-8 and the name is valid.
+	 * @param sFileName The path or name.
+	 * @return Whether it doesn't need to be converted.
+	 */
+	bool isUtf8(const std::string& sFileName) const noexcept { return isUtf8(sFileName.data(), sFileName.size()); }
+	bool isUtf8(const char* p0FileName, size_t nSize) const noexcept;
+	/** Whether the path built from a directory and a name is valid UTF-8.
+	 * @param sDirPath The path of the directory.
+	 * @param p0Name The null terminated name. Cannot be null.
+	 * @param nNameSize The length of the name.
+	 * @return Whether isUtf8(Util::getPathFromDirAndName(sDirPath, p0Name)).
+	 */
+	bool isUtf8(const std::string& sDirPath, const char* p0Name, size_t nNameSize) const noexcept;
+private:
+	const bool m_bFileNamesUtf8;
+};
+
+/* Buffered writer of text lines.
+ * The text is formatted into a buffer that is passed to the stream when it grows
+ * over a threshold. Numbers, times and paths are written directly into the
+ * buffer, without temporary strings.
+ *
+ * File names in the file system encoding are converted to UTF-8 like
+ * Glib::filename_display_name() does. If the encoding is UTF-8 and the name
+ * is valid, which is the common case, they are copied as they are.
+ *
+ * Example:
+ *
+ *     TextWriter oWriter(oOut);
+ *     oWriter.append("M ");
+ *     oWriter.appendPath("/tmp", "x.txt");
+ *     oWriter.endLine(); */
+class TextWriter
+{
+public:
+	/** Constructor.
+	 * @param oOut The stream the buffer is written to.
+	 */
+	explicit TextWriter(std::ostream& oOut) noexcept;
+	/** Destructor. Flushes. */
+	~TextWriter() noexcept;
+
+	void append(char c) noexcept { m_sBuffer.push_back(c); }
+	/** Appends a string.
+	 * @param p0Str The string. Cannot be null.
+	 */
+	void append(const char* p0Str) noexcept;
+	void append(const std::string& sStr) noexcept { m_sBuffer.append(sStr); }
+	void appendInt(int64_t nValue) noexcept;
+	/** Same as append(Util::getTimeString(nTimeUsec, nDurationUsec)).
+	 * @param nTimeUsec The time in microseconds.
+	 * @param nDurationUsec The duration that determines the width.
+	 */
+	void appendTime(int64_t nTimeUsec, int64_t nDurationUsec) noexcept;
+	/** Appends a file name in the file system encoding.
+	 * @param sFileName The path or name.
+	 */
+	void appendFileName(const std::string& sFileName) noexcept;
+	/** Same as appendFileName(Util::getPathFromDirAndName(sDirPath, p0Name)).
+	 * The name isn't copied, see FofiModel::getWatchedResultNamePtr().
+	 * @param sDirPath The path of the directory.
+	 * @param p0Name The null terminated name. Cannot be null.
+	 */
+	void appendPath(const std::string& sDirPath, const char* p0Name) noexcept;
+	/** Appends a new line and writes the buffer to the stream if it's big enough. */
+	void endLine() noexcept;
+
+	/** Writes the buffer to the stream. */
+	void flush() noexcept;
+private:
+	std::ostream& m_oOut;
+	const FileNameEncoding m_oEncoding;
+	std::string m_sBuffer;
+private:
+	TextWriter(const TextWriter& oSource) = delete;
+	TextWriter& operator=(const TextWriter& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_TEXT_WRITER_H_ */
@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   tracemain.cc
+ */
+
+#include "tracering.h"
+
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+
+namespace fofi
+{
+
+void printTraceUsage() noexcept
+{
+	std::cout << "Usage: fofimon-trace FILE" << '\n';
+	std::cout << "Prints the trace written by 'fofimon --trace FILE'." << '\n';
+	std::cout << "The time of each record is relative to when the trace was written." << '\n';
+}
+
+int fofimonTraceMain(int nArgC, char** aArgV) noexcept
+{
+	if (nArgC != 2) {
+		printTraceUsage();
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	const std::string sArg = aArgV[1];
+	if ((sArg == "-h") || (sArg == "--help")) {
+		printTraceUsage();
+		return EXIT_SUCCESS; //-------------------------------------------------
+	}
+	TraceRing::Dump oDump;
+	const auto sError = TraceRing::load(sArg, oDump);
+	if (! sError.empty()) {
+		std::cerr << sError << '\n';
+		return EXIT_FAILURE; //-------------------------------------------------
+	}
+	TraceRing::print(std::cout, oDump);
+	return EXIT_SUCCESS;
+}
+
+} // namespace fofi
+
+int main(int nArgC, char** aArgV)
+{
+	return fofi::fofimonTraceMain(nArgC, aArgV);
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   tracering.cc
+ */
+#include "tracering.h"
+
+#include "util.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+
+namespace fofi
+{
+
+static constexpr const char* s_p0TraceMagic = "FOFITRCE"; // without the terminating null
+static constexpr uint64_t s_nTraceVersion = 1;
+
+TraceRing::TraceRing() noexcept
+: m_nMask(0)
+, m_nTotRecorded(0)
+{
+	static_assert(sizeof(Record) == 32, "");
+}
+void TraceRing::setCapacity(int32_t nTotRecords)
+{
+	assert(nTotRecords >= 0);
+	size_t nCapacity = 0;
+	if (nTotRecords > 0) {
+		nCapacity = 1;
+		while (nCapacity < static_cast<size_t>(nTotRecords)) {
+			nCapacity *= 2;
+		}
+	}
+	m_aRecords.assign(nCapacity, Record{});
+	m_aRecords.shrink_to_fit();
+	m_nMask = ((nCapacity > 0) ? nCapacity - 1 : 0);
+	m_nTotRecorded = 0;
+}
+void TraceRing::clear() noexcept
+{
+	m_nTotRecorded = 0;
+}
+std::vector<TraceRing::Record> TraceRing::getRecords() const
+{
+	std::vector<Record> aRecords;
+	const int64_t nTotKept = std::min<int64_t>(m_nTotRecorded, static_cast<int64_t>(m_aRecords.size()));
+	aRecords.reserve(nTotKept);
+	for (int64_t nIdx = m_nTotRecorded - nTotKept; nIdx < m_nTotRecorded; ++nIdx) {
+		aRecords.push_back(m_aRecords[static_cast<size_t>(nIdx) & m_nMask]);
+	}
+	return aRecords;
+}
+
+const char* TraceRing::getEventName(int32_t nEvent) noexcept
+{
+	static const char* const s_aEventNames[s_nTotTraceEvents] = {
+		"start", "stop", "inotify", "overflow", "filtered-out", "result"
+		, "inconsistent", "watch-added", "watch-failed", "watch-removed", "move-unpaired", "abort"
+	};
+	if ((nEvent < 0) || (nEvent >= s_nTotTraceEvents)) {
+		return "?"; //----------------------------------------------------------
+	}
+	return s_aEventNames[nEvent];
+}
+
+static void appendUInt64(std::string& sOut, uint64_t nValue)
+{
+	char aBytes[sizeof(uint64_t)];
+	std::memcpy(aBytes, &nValue, sizeof(uint64_t));
+	sOut.append(aBytes, sizeof(uint64_t));
+}
+static void appendString(std::string& sOut, const std::string& sStr)
+{
+	appendUInt64(sOut, sStr.size());
+	sOut.append(sStr);
+}
+static void appendStringMap(std::string& sOut, const std::map<int32_t, std::string>& oMap)
+{
+	appendUInt64(sOut, oMap.size());
+	for (const auto& oPair : oMap) {
+		appendUInt64(sOut, static_cast<uint64_t>(static_cast<int64_t>(oPair.first)));
+		appendString(sOut, oPair.second);
+	}
+}
+
+/* Reads the data written by TraceRing::save().
+ * All the methods return false if the data is exhausted. */
+class TraceReader
+{
+public:
+	TraceReader(const char* p0Data, size_t nSize) noexcept
+	: m_p0Cur(p0Data)
+	, m_p0End(p0Data + nSize)
+	{
+	}
+	bool readBytes(void* p0Dest, size_t nSize) noexcept
+	{
+		if (static_cast<size_t>(m_p0End - m_p0Cur) < nSize) {
+			return false; //----------------------------------------------------
+		}
+		std::memcpy(p0Dest, m_p0Cur, nSize);
+		m_p0Cur += nSize;
+		return true;
+	}
+	bool readUInt64(uint64_t& nValue) noexcept
+	{
+		return readBytes(&nValue, sizeof(uint64_t));
+	}
+	bool readInt64(int64_t& nValue) noexcept
+	{
+		return readBytes(&nValue, sizeof(int64_t));
+	}
+	bool readString(std::string& sStr)
+	{
+		uint64_t nSize;
+		if (! readUInt64(nSize)) {
+			return false; //----------------------------------------------------
+		}
+		if (static_cast<uint64_t>(m_p0End - m_p0Cur) < nSize) {
+			return false; //----------------------------------------------------
+		}
+		sStr.assign(m_p0Cur, nSize);
+		m_p0Cur += nSize;
+		return true;
+	}
+	bool readStringMap(std::map<int32_t, std::string>& oMap)
+	{
+		uint64_t nTot;
+		if (! readUInt64(nTot)) {
+			return false; //----------------------------------------------------
+		}
+		for (uint64_t nCur = 0; nCur < nTot; ++nCur) {
+			int64_t nKey;
+			std::string sStr;
+			if (! (readInt64(nKey) && readString(sStr))) {
+				return false; //------------------------------------------------
+			}
+			oMap[static_cast<int32_t>(nKey)] = std::move(sStr);
+		}
+		return true;
+	}
+	bool atEnd() const noexcept
+	{
+		return (m_p0Cur == m_p0End);
+	}
+private:
+	const char* m_p0Cur;
+	const char* m_p0End;
+};
+
+std::string TraceRing::save(const std::string& sPathName, const Dump& oDump)
+{
+	std::string sData = s_p0TraceMagic;
+	appendUInt64(sData, s_nTraceVersion);
+	appendUInt64(sData, sizeof(Record));
+	appendString(sData, oDump.m_sReason);
+	appendUInt64(sData, static_cast<uint64_t>(oDump.m_nDumpTimeNsec));
+	appendUInt64(sData, static_cast<uint64_t>(oDump.m_nDumpWallTimeUsec));
+	appendUInt64(sData, static_cast<uint64_t>(oDump.m_nTotRecorded));
+	appendUInt64(sData, oDump.m_aRecords.size());
+	sData.append(reinterpret_cast<const char*>(oDump.m_aRecords.data()), oDump.m_aRecords.size() * sizeof(Record));
+	appendStringMap(sData, oDump.m_oNames);
+	appendStringMap(sData, oDump.m_oDirPaths);
+
+	return Util::writeFileAtomically(sPathName, [&](std::ostream& oOut)
+	{
+		oOut.write(sData.data(), sData.size());
+		return std::string{};
+	});
+}
+std::string TraceRing::load(const std::string& sPathName, Dump& oDump)
+{
+	oDump = Dump{};
+	std::ifstream oIn(sPathName, std::ios::binary);
+	if (! oIn) {
+		const std::string sError = "Could not open trace " + sPathName;
+		return sError; //-------------------------------------------------------
+	}
+	const std::string sData{std::istreambuf_iterator<char>(oIn), std::istreambuf_iterator<char>()};
+	const size_t nMagicSize = std::strlen(s_p0TraceMagic);
+	const std::string sCorruptError = "Trace " + sPathName + " is corrupt";
+	if ((sData.size() < nMagicSize) || (sData.compare(0, nMagicSize, s_p0TraceMagic) != 0)) {
+		return sCorruptError; //------------------------------------------------
+	}
+	TraceReader oReader(sData.data() + nMagicSize, sData.size() - nMagicSize);
+	uint64_t nVersion;
+	uint64_t nRecordSize;
+	if (! (oReader.readUInt64(nVersion) && oReader.readUInt64(nRecordSize))) {
+		return sCorruptError; //------------------------------------------------
+	}
+	if ((nVersion != s_nTraceVersion) || (nRecordSize != sizeof(Record))) {
+		const std::string sError = "Trace " + sPathName + " has unsupported version " + std::to_string(nVersion);
+		return sError; //-------------------------------------------------------
+	}
+	uint64_t nTotRecords;
+	bool bOk = oReader.readString(oDump.m_sReason) && oReader.readInt64(oDump.m_nDumpTimeNsec)
+				&& oReader.readInt64(oDump.m_nDumpWallTimeUsec) && oReader.readInt64(oDump.m_nTotRecorded)
+				&& oReader.readUInt64(nTotRecords);
+	if (bOk && (nTotRecords <= (sData.size() / sizeof(Record)))) {
+		oDump.m_aRecords.resize(nTotRecords);
+		bOk = oReader.readBytes(oDump.m_aRecords.data(), nTotRecords * sizeof(Record))
+				&& oReader.readStringMap(oDump.m_oNames) && oReader.readStringMap(oDump.m_oDirPaths)
+				&& oReader.atEnd();
+	} else {
+		bOk = false;
+	}
+	if (! bOk) {
+		oDump = Dump{};
+		return sCorruptError; //------------------------------------------------
+	}
+	return "";
+}
+
+static const char* getActionName(int32_t nAction)
+{
+	// INotifierSource::FOFI_ACTION
+	static const char* const s_aActionNames[] = {"create", "delete", "modify", "attrib", "rename-from", "rename-to"};
+	if ((nAction < 0) || (nAction >= static_cast<int32_t>(sizeof(s_aActionNames) / sizeof(s_aActionNames[0])))) {
+		return "-"; //----------------------------------------------------------
+	}
+	return s_aActionNames[nAction];
+}
+static const char* getResultTypeName(int32_t nResultType)
+{
+	// FofiModel::RESULT_TYPE
+	static const char* const s_aResultTypeNames[] = {"none", "created", "deleted", "modified", "temporary"};
+	if ((nResultType < 0) || (nResultType >= static_cast<int32_t>(sizeof(s_aResultTypeNames) / sizeof(s_aResultTypeNames[0])))) {
+		return "?"; //----------------------------------------------------------
+	}
+	return s_aResultTypeNames[nResultType];
+}
+static void printId(std::ostream& oOut, const std::map<int32_t, std::string>& oMap, int32_t nId)
+{
+	const auto itFind = oMap.find(nId);
+	if (itFind != oMap.end()) {
+		oOut << itFind->second;
+	} else {
+		oOut << "#" << nId;
+	}
+}
+void TraceRing::print(std::ostream& oOut, const Dump& oDump)
+{
+	oOut << "Reason: " << oDump.m_sReason << '\n';
+	oOut << "Records: " << oDump.m_aRecords.size() << " of " << oDump.m_nTotRecorded << '\n';
+	oOut << "Seconds before the dump, event, directory, name, details:" << '\n';
+	for (const Record& oRecord : oDump.m_aRecords) {
+		oOut << std::fixed << std::setprecision(6) << std::setw(14)
+				<< (-static_cast<double>(oDump.m_nDumpTimeNsec - oRecord.m_nTimeNsec) / 1000000000.0)
+				<< "  " << std::left << std::setw(13) << getEventName(oRecord.m_nEvent) << std::right << " ";
+		if (oRecord.m_nTag >= 0) {
+			printId(oOut, oDump.m_oDirPaths, oRecord.m_nTag);
+		} else {
+			oOut << "-";
+		}
+		oOut << "  ";
+		if (oRecord.m_nNameId >= 0) {
+			printId(oOut, oDump.m_oNames, oRecord.m_nNameId);
+		} else {
+			oOut << "-";
+		}
+		const int32_t* p0Args = oRecord.m_aArgs;
+		switch (oRecord.m_nEvent) {
+		case TRACE_EVENT_START:
+			oOut << ((p0Args[0] != 0) ? "  resumed" : "");
+			break;
+		case TRACE_EVENT_INOTIFY:
+			oOut << "  " << getActionName(p0Args[0]) << (p0Args[1] ? " dir" : "");
+			if (p0Args[2] != 0) {
+				oOut << " cookie=" << p0Args[2];
+			}
+			break;
+		case TRACE_EVENT_FILTERED_OUT:
+			oOut << "  " << getActionName(p0Args[0]) << (p0Args[1] ? " dir" : "");
+			break;
+		case TRACE_EVENT_RESULT:
+			oOut << "  " << getResultTypeName(p0Args[0]) << (p0Args[1] ? " dir" : "") << " last=" << getActionName(p0Args[2]);
+			break;
+		case TRACE_EVENT_INCONSISTENT:
+			oOut << "  " << getResultTypeName(p0Args[0]) << (p0Args[1] ? " dir" : "") << " during=" << getActionName(p0Args[2]);
+			break;
+		case TRACE_EVENT_WATCH_ADDED:
+		case TRACE_EVENT_WATCH_REMOVED:
+			oOut << "  watch=" << p0Args[0];
+			break;
+		case TRACE_EVENT_WATCH_FAILED:
+			oOut << "  errno=" << p0Args[0] << " (" << ::strerror(p0Args[0]) << ")";
+			break;
+		case TRACE_EVENT_MOVE_UNPAIRED:
+			oOut << "  cookie=" << p0Args[0] << (p0Args[1] ? " dir" : "");
+			break;
+		default:
+			break;
+		}
+		oOut << '\n';
+	}
+}
+
+} // namespace fofi
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   tracering.h
+ */
+
+#ifndef FOFIMON_TRACE_RING_H_
+#define FOFIMON_TRACE_RING_H_
+
+#include "util.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <iosfwd>
+
+#include <stdint.h>
+
+namespace fofi
+{
+
+/* Ring of fixed-size binary records of what the model did.
+ * When full the oldest records are overwritten. Disabled (and empty) by default:
+ * recording is then a single branch. When enabled recording takes a timestamp
+ * and copies a few integers, it never allocates.
+ *
+ * Names and directories are recorded as ids (see StringPool and
+ * FofiModel::getToWatchDirectories()) that are resolved when a Dump is created.
+ * Names that are not in the pool are recorded as -1. */
+class TraceRing
+{
+public:
+	enum TRACE_EVENT : int32_t
+	{
+		TRACE_EVENT_START = 0 /**< Arg0: 1 if resumed from a snapshot. */
+		, TRACE_EVENT_STOP = 1
+		, TRACE_EVENT_INOTIFY = 2 /**< Arg0: action, Arg1: is dir, Arg2: rename cookie. */
+		, TRACE_EVENT_OVERFLOW = 3
+		, TRACE_EVENT_FILTERED_OUT = 4 /**< Arg0: action, Arg1: is dir. */
+		, TRACE_EVENT_RESULT = 5 /**< A result was emitted. Arg0: result type, Arg1: is dir, Arg2: last action. */
+		, TRACE_EVENT_INCONSISTENT = 6 /**< Arg0: result type, Arg1: is dir, Arg2: current action or -1. */
+		, TRACE_EVENT_WATCH_ADDED = 7 /**< Arg0: watch index. */
+		, TRACE_EVENT_WATCH_FAILED = 8 /**< Arg0: errno. */
+		, TRACE_EVENT_WATCH_REMOVED = 9 /**< Arg0: watch index. */
+		, TRACE_EVENT_MOVE_UNPAIRED = 10 /**< A rename from with no rename to. Arg0: rename cookie, Arg1: is dir. */
+		, TRACE_EVENT_ABORT = 11
+	};
+	static constexpr int32_t s_nTotTraceEvents = 12;
+	struct Record
+	{
+		int64_t m_nTimeNsec; /**< See Util::getNowTimeNanoseconds(). */
+		int32_t m_nEvent; /**< The TRACE_EVENT. */
+		int32_t m_nTag; /**< The ToWatchDir index or -1. */
+		int32_t m_nNameId; /**< The StringPool id or -1. */
+		int32_t m_aArgs[3]; /**< Depends on m_nEvent. */
+	};
+	/** What is written to a dump file. */
+	struct Dump
+	{
+		std::string m_sReason; /**< Why the dump was written. */
+		int64_t m_nDumpTimeNsec = 0; /**< See Util::getNowTimeNanoseconds(). */
+		int64_t m_nDumpWallTimeUsec = 0; /**< Microseconds since the epoch. */
+		int64_t m_nTotRecorded = 0; /**< Can be bigger than the number of records. */
+		std::vector<Record> m_aRecords; /**< Oldest first. */
+		std::map<int32_t, std::string> m_oNames; /**< Key: name id. */
+		std::map<int32_t, std::string> m_oDirPaths; /**< Key: tag. */
+	};
+
+	TraceRing() noexcept;
+	/** Sets the max number of records.
+	 * Also removes all the records.
+	 * @param nTotRecords The number of records (rounded up to a power of two) or 0 to disable.
+	 */
+	void setCapacity(int32_t nTotRecords);
+	/** The max number of records.
+	 * @return The capacity or 0 if disabled.
+	 */
+	int32_t getCapacity() const noexcept { return static_cast<int32_t>(m_aRecords.size()); }
+	/** Whether records are kept.
+	 * @return Whether capacity is not 0.
+	 */
+	bool isEnabled() const noexcept { return ! m_aRecords.empty(); }
+	/** Adds a record, overwriting the oldest if full.
+	 * Does nothing if disabled.
+	 */
+	void trace(TRACE_EVENT eEvent, int32_t nTag, int32_t nNameId
+				, int32_t nArg0 = 0, int32_t nArg1 = 0, int32_t nArg2 = 0) noexcept
+	{
+		if (m_aRecords.empty()) {
+			return; //----------------------------------------------------------
+		}
+		Record& oRecord = m_aRecords[static_cast<size_t>(m_nTotRecorded) & m_nMask];
+		oRecord.m_nTimeNsec = Util::getNowTimeNanoseconds();
+		oRecord.m_nEvent = eEvent;
+		oRecord.m_nTag = nTag;
+		oRecord.m_nNameId = nNameId;
+		oRecord.m_aArgs[0] = nArg0;
+		oRecord.m_aArgs[1] = nArg1;
+		oRecord.m_aArgs[2] = nArg2;
+		++m_nTotRecorded;
+	}
+	/** Removes all the records. */
+	void clear() noexcept;
+	/** The number of records added since the last clear().
+	 * @return The number of records including the overwritten ones.
+	 */
+	int64_t getTotRecorded() const noexcept { return m_nTotRecorded; }
+	/** The kept records.
+	 * @return The records, oldest first.
+	 */
+	std::vector<Record> getRecords() const;
+
+	/** The name of an event.
+	 * @param nEvent The TRACE_EVENT.
+	 * @return The name or "?".
+	 */
+	static const char* getEventName(int32_t nEvent) noexcept;
+	/** Writes a dump to a file.
+	 * The file is written to a temporary file first which then replaces it.
+	 * @param sPathName The file.
+	 * @param oDump The dump.
+	 * @return Empty string or error.
+	 */
+	static std::string save(const std::string& sPathName, const Dump& oDump);
+	/** Reads a dump written by save().
+	 * @param sPathName The file.
+	 * @param oDump Is set to the dump.
+	 * @return Empty string or error.
+	 */
+	static std::string load(const std::string& sPathName, Dump& oDump);
+	/** Prints a dump, one line per record.
+	 * @param oOut The stream.
+	 * @param oDump The dump.
+	 */
+	static void print(std::ostream& oOut, const Dump& oDump);
+
+private:
+	std::vector<Record> m_aRecords;
+	size_t m_nMask;
+	int64_t m_nTotRecorded;
+private:
+	TraceRing(const TraceRing& oSource) = delete;
+	TraceRing& operator=(const TraceRing& oSource) = delete;
+};
+
+} // namespace fofi
+
+#endif /* FOFIMON_TRACE_RING_H_ */
@@ -25,16 +25,20 @@
 //#include <iostream>
 #endif //NDEBUG
 
+#include <fstream>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <cstdio>
 #include <stdexcept>
 #include <type_traits>
-#include <cmath>
 
 #include <limits.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 namespace fofi
 {
@@ -48,16 +52,93 @@ int64_t getNowTimeMicroseconds() noexcept
 								std::chrono::steady_clock::now().time_since_epoch()).count();
 	return nTimeUsec;
 }
+int64_t getNowTimeNanoseconds() noexcept
+{
+	const int64_t nTimeNsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+								std::chrono::steady_clock::now().time_since_epoch()).count();
+	return nTimeNsec;
+}
+int64_t getProcessCpuTimeMicroseconds() noexcept
+{
+	struct ::rusage oUsage;
+	if (::getrusage(RUSAGE_SELF, &oUsage) != 0) {
+		return 0; //------------------------------------------------------------
+	}
+	return (int64_t{oUsage.ru_utime.tv_sec} + oUsage.ru_stime.tv_sec) * 1000000
+			+ oUsage.ru_utime.tv_usec + oUsage.ru_stime.tv_usec;
+}
+int64_t getPeakResidentBytes() noexcept
+{
+	struct ::rusage oUsage;
+	if (::getrusage(RUSAGE_SELF, &oUsage) != 0) {
+		return 0; //------------------------------------------------------------
+	}
+	// Linux reports kilobytes
+	return int64_t{oUsage.ru_maxrss} * 1024;
+}
 std::string getTimeString(int64_t nTimeMicroseconds, int64_t nDurationMicroseconds) noexcept
 {
-	const int32_t nUSecSize = 1 + ((nDurationMicroseconds > 0) ? std::log10(nDurationMicroseconds) : 0);
+	char aTime[s_nMaxTimeChars];
+	const int32_t nSize = formatTime(nTimeMicroseconds, nDurationMicroseconds, aTime);
+	return std::string(aTime, nSize);
+}
+int32_t formatTime(int64_t nTimeMicroseconds, int64_t nDurationMicroseconds, char* p0Buffer) noexcept
+{
+	// the seconds are as wide as the seconds of the duration
+	int32_t nUSecSize = 1;
+	for (int64_t nRest = nDurationMicroseconds; nRest >= 10; nRest /= 10) {
+		++nUSecSize;
+	}
 	const int32_t nSecSize = std::max(1, nUSecSize - 6);
-	const auto oSecs = std::div(nTimeMicroseconds, static_cast<int64_t>(1000000));
-	std::string sUsecRes = "000000" + std::to_string(oSecs.rem);
-	sUsecRes = sUsecRes.substr(sUsecRes.size() - 6, 6);
-	std::string sSecRes = (std::string(nSecSize, ' ') + std::to_string(oSecs.quot));
-	sSecRes = sSecRes.substr(sSecRes.size() - nSecSize, nSecSize);
-	return sSecRes + "." + sUsecRes;
+	const int32_t nSize = nSecSize + 1 + 6;
+	assert(nSize <= s_nMaxTimeChars);
+	const uint64_t nTime = static_cast<uint64_t>(std::max<int64_t>(0, nTimeMicroseconds));
+	uint64_t nSecs = nTime / 1000000;
+	uint64_t nUSecs = nTime % 1000000;
+	char* p0Cur = p0Buffer + nSize;
+	for (int32_t nDigit = 0; nDigit < 6; ++nDigit) {
+		*(--p0Cur) = static_cast<char>('0' + (nUSecs % 10));
+		nUSecs /= 10;
+	}
+	*(--p0Cur) = '.';
+	// padded with spaces, if too many digits only the last ones
+	for (int32_t nDigit = 0; nDigit < nSecSize; ++nDigit) {
+		if ((nDigit > 0) && (nSecs == 0)) {
+			*(--p0Cur) = ' ';
+		} else {
+			*(--p0Cur) = static_cast<char>('0' + (nSecs % 10));
+			nSecs /= 10;
+		}
+	}
+	return nSize;
+}
+int32_t formatInt(int64_t nValue, char* p0Buffer) noexcept
+{
+	// avoids overflow when negating the smallest value
+	const uint64_t nAbs = ((nValue < 0) ? (~static_cast<uint64_t>(nValue) + 1) : static_cast<uint64_t>(nValue));
+	int32_t nSize = ((nValue < 0) ? 2 : 1);
+	for (uint64_t nRest = nAbs; nRest >= 10; nRest /= 10) {
+		++nSize;
+	}
+	assert(nSize <= s_nMaxIntChars);
+	char* p0Cur = p0Buffer + nSize;
+	uint64_t nRest = nAbs;
+	do {
+		*(--p0Cur) = static_cast<char>('0' + (nRest % 10));
+		nRest /= 10;
+	} while (nRest > 0);
+	if (nValue < 0) {
+		*(--p0Cur) = '-';
+	}
+	return nSize;
+}
+uint64_t updateChecksum(uint64_t nChecksum, const char* p0Data, size_t nSize) noexcept
+{
+	for (size_t nIdx = 0; nIdx < nSize; ++nIdx) {
+		nChecksum ^= static_cast<uint8_t>(p0Data[nIdx]);
+		nChecksum *= 1099511628211ull;
+	}
+	return nChecksum;
 }
 
 std::string cleanupPath(const std::string& sPath) noexcept
@@ -209,6 +290,33 @@ int32_t getPathDepth(const std::string& sChildPath, const std::string& sBasePath
 	return nDepth;
 }
 
+std::string writeFileAtomically(const std::string& sPathName, const std::function<std::string(std::ostream& oOut)>& oWrite)
+{
+	const std::string sTempPathName = sPathName + ".tmp";
+	{
+		std::ofstream oOut(sTempPathName, std::ios::binary | std::ios::trunc);
+		if (! oOut) {
+			return "Could not create " + sTempPathName; //----------------------
+		}
+		const std::string sError = oWrite(oOut);
+		oOut.close();
+		if (! sError.empty()) {
+			::unlink(sTempPathName.c_str());
+			return sError; //---------------------------------------------------
+		}
+		if (! oOut) {
+			::unlink(sTempPathName.c_str());
+			return "Could not write " + sTempPathName; //-----------------------
+		}
+	}
+	if (::rename(sTempPathName.c_str(), sPathName.c_str()) != 0) {
+		const std::string sError = "Could not rename " + sTempPathName + " to " + sPathName + ": " + ::strerror(errno);
+		::unlink(sTempPathName.c_str());
+		return sError; //-------------------------------------------------------
+	}
+	return "";
+}
+
 FileStat FileStat::create(const std::string& sPath) noexcept
 {
 	FileStat oStatRes;
@@ -219,6 +327,7 @@ FileStat FileStat::create(const std::string& sPath) noexcept
 	}
 	const bool bIsLink = ((oStat.st_mode & S_IFLNK) == S_IFLNK);
 	oStatRes.m_nFStat = (1 | (oStat.st_mode & (S_IFREG | S_IFDIR)) | (bIsLink ? FILE_STAT_IS_SYM_LINK : 0));
+	oStatRes.m_nMTimeNsec = static_cast<int64_t>(oStat.st_mtim.tv_sec) * 1000000000 + oStat.st_mtim.tv_nsec;
 	return oStatRes;
 }
 
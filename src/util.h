@@ -26,6 +26,8 @@
 #include <deque>
 #include <string>
 #include <algorithm>
+#include <functional>
+#include <iosfwd>
 
 #include <stdint.h>
 
@@ -37,8 +39,30 @@ namespace Util
 {
 
 int64_t getNowTimeMicroseconds() noexcept;
+/* Same clock as getNowTimeMicroseconds(). */
+int64_t getNowTimeNanoseconds() noexcept;
+/* User plus system CPU time consumed by the process. */
+int64_t getProcessCpuTimeMicroseconds() noexcept;
+/* The maximum resident set size of the process so far. */
+int64_t getPeakResidentBytes() noexcept;
 
 std::string getTimeString(int64_t nTimeMicroseconds, int64_t nDurationMicroseconds) noexcept;
+/* The max number of chars written by formatTime(). */
+constexpr int32_t s_nMaxTimeChars = 24;
+/* Same as getTimeString() but writes to a buffer with room for s_nMaxTimeChars chars.
+ * Doesn't allocate. Negative times are written as 0. Returns the number of chars
+ * written, no terminating null. */
+int32_t formatTime(int64_t nTimeMicroseconds, int64_t nDurationMicroseconds, char* p0Buffer) noexcept;
+/* The max number of chars written by formatInt(). */
+constexpr int32_t s_nMaxIntChars = 20;
+/* Writes the decimal digits of a number to a buffer with room for s_nMaxIntChars chars.
+ * Doesn't allocate. Returns the number of chars written, no terminating null. */
+int32_t formatInt(int64_t nValue, char* p0Buffer) noexcept;
+/* The checksum of no data, see updateChecksum(). */
+constexpr uint64_t s_nChecksumInit = 14695981039346656037ull;
+/* Adds data to a checksum (64 bit FNV-1a), so that it can be computed
+ * while the data is written. Returns the new checksum. */
+uint64_t updateChecksum(uint64_t nChecksum, const char* p0Data, size_t nSize) noexcept;
 
 template <typename T>
 void addVectorToVectorUniquely(std::vector<T>& aVs, const std::vector<T>& aVsAdd) noexcept
@@ -70,6 +94,17 @@ void addValueToDequeUniquely(std::deque<T>& aVs, T oT) noexcept
 	}
 }
 
+template <typename T>
+bool removeValueFromVector(std::vector<T>& aVs, const T& oT) noexcept
+{
+	const auto itFind = std::find(aVs.begin(), aVs.end(), oT);
+	if (itFind == aVs.end()) {
+		return false; //--------------------------------------------------------
+	}
+	aVs.erase(itFind);
+	return true;
+}
+
 template <typename T>
 bool isInVector(std::vector<T>& aVs, const T& oT) noexcept
 {
@@ -92,6 +127,14 @@ std::string getRealPathIfPossible(const std::string& sPath);
 
 int32_t getPathDepth(const std::string& sChildPath, const std::string& sBasePath, int32_t nMaxDepth) noexcept;
 
+/** Writes a file through a temporary file that is then renamed.
+ * A reader never sees a partially written file.
+ * @param sPathName The file.
+ * @param oWrite Writes the content to the stream and returns an empty string or error.
+ * @return Empty string or error.
+ */
+std::string writeFileAtomically(const std::string& sPathName, const std::function<std::string(std::ostream& oOut)>& oWrite);
+
 class FileStat
 {
 public:
@@ -104,6 +147,11 @@ public:
 	 * @return Whether sym link.
 	 */
 	bool isSymLink() const noexcept { return ((m_nFStat & FILE_STAT_IS_SYM_LINK) == FILE_STAT_IS_SYM_LINK); }
+	/** The last modification time.
+	 * Of the link itself if a symbolic link.
+	 * @return The nanoseconds since the epoch or 0 if not existing.
+	 */
+	int64_t getModificationTimeNsec() const noexcept { return m_nMTimeNsec; }
 private:
 	enum FILE_STAT : int32_t
 	{
@@ -113,6 +161,7 @@ private:
 		, FILE_STAT_IS_SYM_LINK = 8192
 	};
 	int32_t m_nFStat = 0;
+	int64_t m_nMTimeNsec = 0;
 private:
 	FileStat() = default;
 };
@@ -20,6 +20,8 @@
 
 #include "fakesource.h"
 
+#include "util.h"
+
 #ifndef NDEBUG
 #include <iostream>
 #endif //NDEBUG
@@ -94,6 +96,10 @@ int32_t FakeSource::clearAll() noexcept
 	m_aFreeWatchIdxs.clear();
 	return 0;
 }
+int32_t FakeSource::getTotWatches() const noexcept
+{
+	return static_cast<int32_t>(m_aPathWatchTags.size() - m_aFreeWatchIdxs.size());
+}
 int32_t FakeSource::removePath(int32_t nTag) noexcept
 {
 	return removePath(-1, nTag);
@@ -149,7 +155,13 @@ sigc::connection FakeSource::connect(const sigc::slot<FOFI_PROGRESS, const FofiD
 INotifierSource::FOFI_PROGRESS FakeSource::callback(const FofiData& oData) noexcept
 {
 	assert(!m_oFofiDataCallback.empty());
-	return m_oFofiDataCallback.emit(oData);
+	if (oData.m_nReadTimeNsec != 0) {
+		return m_oFofiDataCallback.emit(oData); //------------------------------
+	}
+	// as if just read from inotify
+	FofiData oReadData = oData;
+	oReadData.m_nReadTimeNsec = Util::getNowTimeNanoseconds();
+	return m_oFofiDataCallback.emit(oReadData);
 }
 
 } // namespace testing
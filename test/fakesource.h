@@ -54,6 +54,7 @@ public:
 	int32_t renamePath(int32_t nFromTag, int32_t nToTag) noexcept override;
 	int32_t renamePath(int32_t nFromWatchIdx, int32_t nFromTag, int32_t nToTag) noexcept override;
 	int32_t clearAll() noexcept override;
+	int32_t getTotWatches() const noexcept override;
 
 	sigc::connection connect(const sigc::slot<FOFI_PROGRESS, const FofiData&>& oSlot) noexcept override;
 
@@ -141,15 +141,16 @@ public:
 	}
 	int32_t findToWatchPath(const FofiModel& oFofiModel, const std::string& sDirPath) const
 	{
-		const auto& aTWDirs = oFofiModel.getToWatchDirectories();
-		const auto itFind = std::find_if(aTWDirs.begin(), aTWDirs.end(), [&](const FofiModel::ToWatchDir& oTWD)
-		{
-			return (oTWD.m_sPathName == sDirPath);
-		});
-		if (itFind == aTWDirs.end()) {
-			return -1;
+		const auto nTotTWDirs = static_cast<int32_t>(oFofiModel.getToWatchDirectories().size());
+		for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDirs; ++nTWDIdx) {
+			if (oFofiModel.getToWatchDirectories()[nTWDIdx].isFree()) {
+				continue;
+			}
+			if (oFofiModel.getToWatchDirPath(nTWDIdx) == sDirPath) {
+				return nTWDIdx;
+			}
 		}
-		return std::distance(aTWDirs.begin(), itFind);
+		return -1;
 	}
 	/** The unique test base directory (based on /tmp).
 	 */
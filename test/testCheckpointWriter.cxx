@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testCheckpointWriter.cxx
+ */
+
+#include "checkpointwriter.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+
+#include "fakesource.h"
+
+#include "util.h"
+
+#include "nlohmann/json.hpp"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+using nlohmann::json;
+
+void sendEvent(FakeSource* p0Source, int32_t nTWDIdx, const std::string& sName, INotifierSource::FOFI_ACTION eAction, bool bIsDir)
+{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = nTWDIdx;
+	oFD.m_sName = sName;
+	oFD.m_eAction = eAction;
+	oFD.m_bIsDir = bIsDir;
+	p0Source->callback(oFD);
+}
+std::vector<std::string> getChangedPaths(const FofiModel& oFofiModel)
+{
+	std::vector<std::string> aPaths;
+	const auto sError = oFofiModel.forEachChangedResult([&](const FofiModel::WatchedResult& oResult)
+	{
+		aPaths.push_back(Util::getPathFromDirAndName(oFofiModel.getWatchedResultParentPath(oResult)
+													, oFofiModel.getWatchedResultName(oResult)));
+	});
+	assert(sError.empty());
+	std::sort(aPaths.begin(), aPaths.end());
+	return aPaths;
+}
+bool fileExists(const std::string& sPathName)
+{
+	return (::access(sPathName.c_str(), F_OK) == 0);
+}
+
+int testChangedResults()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	oTempFileTreeFixture.createOrModifyRelFile("x.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/y.txt");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 1;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	oFofiModel.start();
+	EXPECT_TRUE(oFofiModel.getCheckpointGeneration() == 1);
+	EXPECT_TRUE(! oFofiModel.hasChangedResults());
+
+	const int32_t nTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE((nTWDIdx >= 0) && (n_A_TWDIdx >= 0));
+
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, n_A_TWDIdx, "y.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	EXPECT_TRUE(oFofiModel.hasChangedResults());
+	auto aPaths = getChangedPaths(oFofiModel);
+	EXPECT_TRUE(aPaths.size() == 2);
+	EXPECT_TRUE(aPaths[0] == sBasePath + "/A/y.txt");
+	EXPECT_TRUE(aPaths[1] == sBasePath + "/x.txt");
+
+	oFofiModel.checkpoint();
+	EXPECT_TRUE(oFofiModel.getCheckpointGeneration() == 2);
+	EXPECT_TRUE(! oFofiModel.hasChangedResults());
+	EXPECT_TRUE(getChangedPaths(oFofiModel).empty());
+
+	// not significant for an already modified file
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	EXPECT_TRUE(! oFofiModel.hasChangedResults());
+	sendEvent(p0Source, n_A_TWDIdx, "y.txt", INotifierSource::FOFI_ACTION_DELETE, false);
+	aPaths = getChangedPaths(oFofiModel);
+	EXPECT_TRUE(aPaths.size() == 1);
+	EXPECT_TRUE(aPaths[0] == sBasePath + "/A/y.txt");
+
+	oFofiModel.stop();
+	// still available after stop
+	EXPECT_TRUE(getChangedPaths(oFofiModel).size() == 1);
+	return 0;
+}
+int testWriter()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	oTempFileTreeFixture.createOrModifyRelFile("x.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("y.txt");
+	oTempFileTreeFixture.createRelDir("out");
+	const std::string sOutPath = sBasePath + "/out";
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 0;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	oFofiModel.start();
+
+	const int32_t nTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
+	EXPECT_TRUE(nTWDIdx >= 0);
+
+	CheckpointWriter::Config oConfig;
+	oConfig.m_nMaxFiles = 2;
+	CheckpointWriter oCheckpointWriter;
+	oCheckpointWriter.init(sOutPath + "/results.json", oConfig);
+	EXPECT_TRUE(oCheckpointWriter.getManifestPathName() == sOutPath + "/results.manifest.json");
+	EXPECT_TRUE(oCheckpointWriter.getCheckpointPathName(3) == sOutPath + "/results.000003.json");
+
+	// nothing changed
+	EXPECT_TRUE(oCheckpointWriter.write(oFofiModel).empty());
+	EXPECT_TRUE(oCheckpointWriter.getTotWritten() == 0);
+	EXPECT_TRUE(! fileExists(oCheckpointWriter.getManifestPathName()));
+
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, nTWDIdx, "y.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	EXPECT_TRUE(oCheckpointWriter.write(oFofiModel).empty());
+	EXPECT_TRUE(oCheckpointWriter.getTotWritten() == 1);
+	{
+		std::ifstream oIn(oCheckpointWriter.getCheckpointPathName(1));
+		const json oResults = json::parse(oIn);
+		EXPECT_TRUE(oResults.is_array() && (oResults.size() == 2));
+	}
+
+	sendEvent(p0Source, nTWDIdx, "y.txt", INotifierSource::FOFI_ACTION_DELETE, false);
+	EXPECT_TRUE(oCheckpointWriter.write(oFofiModel).empty());
+	EXPECT_TRUE(oCheckpointWriter.getTotWritten() == 2);
+	{
+		std::ifstream oIn(oCheckpointWriter.getCheckpointPathName(2));
+		const json oResults = json::parse(oIn);
+		EXPECT_TRUE(oResults.is_array() && (oResults.size() == 1));
+		EXPECT_TRUE(oResults[0]["Path"] == sBasePath + "/y.txt");
+	}
+
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_DELETE, false);
+	oFofiModel.stop();
+	EXPECT_TRUE(oCheckpointWriter.write(oFofiModel).empty());
+	EXPECT_TRUE(oCheckpointWriter.getTotWritten() == 3);
+	// only the last two are kept
+	EXPECT_TRUE(! fileExists(oCheckpointWriter.getCheckpointPathName(1)));
+	EXPECT_TRUE(fileExists(oCheckpointWriter.getCheckpointPathName(2)));
+	EXPECT_TRUE(fileExists(oCheckpointWriter.getCheckpointPathName(3)));
+
+	std::ifstream oIn(oCheckpointWriter.getManifestPathName());
+	const json oManifest = json::parse(oIn);
+	EXPECT_TRUE(oManifest.is_array() && (oManifest.size() == 2));
+	EXPECT_TRUE(oManifest[0]["Checkpoint"] == 2);
+	EXPECT_TRUE(oManifest[0]["File"] == "results.000002.json");
+	EXPECT_TRUE(oManifest[0]["Results"] == 1);
+	EXPECT_TRUE(oManifest[1]["Checkpoint"] == 3);
+	EXPECT_TRUE(oManifest[1]["File"] == "results.000003.json");
+	EXPECT_TRUE(oManifest[1]["Results"] == 1);
+	EXPECT_TRUE(oManifest[1]["Time"].is_string());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "CheckpointWriter Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testChangedResults());
+	EXECUTE_TEST(fofi::testing::testWriter());
+	//
+	std::cout << "CheckpointWriter Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testCompressStreamBuf.cxx
+ */
+
+#include "compressstreambuf.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+#include <unistd.h>
+
+#include <zlib.h>
+#include <zstd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+// Decompresses all the gzip members, bComplete is false if the last is truncated
+std::string gunzip(const std::string& sData, bool& bComplete)
+{
+	z_stream oZStream{};
+	int nRet = ::inflateInit2(&oZStream, 15 + 16);
+	assert(nRet == Z_OK);
+	oZStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(sData.data()));
+	oZStream.avail_in = static_cast<uInt>(sData.size());
+	std::string sResult;
+	char aOut[16384];
+	bComplete = true;
+	while (oZStream.avail_in > 0) {
+		oZStream.next_out = reinterpret_cast<Bytef*>(aOut);
+		oZStream.avail_out = sizeof(aOut);
+		nRet = ::inflate(&oZStream, Z_NO_FLUSH);
+		assert((nRet == Z_OK) || (nRet == Z_STREAM_END) || (nRet == Z_BUF_ERROR));
+		sResult.append(aOut, sizeof(aOut) - oZStream.avail_out);
+		if (nRet == Z_STREAM_END) {
+			bComplete = true;
+			// the next member
+			::inflateReset(&oZStream);
+		} else {
+			bComplete = false;
+			if ((nRet == Z_BUF_ERROR) || (oZStream.avail_in == 0)) {
+				break; // while ----
+			}
+		}
+	}
+	while (! bComplete) {
+		// what's left in the decompressor
+		oZStream.next_out = reinterpret_cast<Bytef*>(aOut);
+		oZStream.avail_out = sizeof(aOut);
+		::inflate(&oZStream, Z_SYNC_FLUSH);
+		const size_t nSize = sizeof(aOut) - oZStream.avail_out;
+		if (nSize == 0) {
+			break; // while ----
+		}
+		sResult.append(aOut, nSize);
+	}
+	::inflateEnd(&oZStream);
+	return sResult;
+}
+// Decompresses all the zstd frames, bComplete is false if the last is truncated
+std::string unzstd(const std::string& sData, bool& bComplete)
+{
+	ZSTD_DCtx* p0DCtx = ::ZSTD_createDCtx();
+	assert(p0DCtx != nullptr);
+	ZSTD_inBuffer oIn{sData.data(), sData.size(), 0};
+	std::string sResult;
+	char aOut[16384];
+	size_t nRet = 0;
+	ZSTD_outBuffer oOut{aOut, sizeof(aOut), 0};
+	do {
+		oOut.pos = 0;
+		nRet = ::ZSTD_decompressStream(p0DCtx, &oOut, &oIn);
+		assert(! ::ZSTD_isError(nRet));
+		sResult.append(aOut, oOut.pos);
+		// a full output buffer means there might be more to flush
+	} while ((oIn.pos < oIn.size) || (oOut.pos == oOut.size));
+	// 0 means the last frame was completely decoded
+	bComplete = (nRet == 0);
+	::ZSTD_freeDCtx(p0DCtx);
+	return sResult;
+}
+std::string decompress(CompressStreamBuf::COMPRESSION eCompression, const std::string& sData, bool& bComplete)
+{
+	if (eCompression == CompressStreamBuf::COMPRESSION_GZIP) {
+		return gunzip(sData, bComplete);
+	}
+	return unzstd(sData, bComplete);
+}
+
+int testPathNames()
+{
+	EXPECT_TRUE(CompressStreamBuf::getCompression("out.json.gz") == CompressStreamBuf::COMPRESSION_GZIP);
+	EXPECT_TRUE(CompressStreamBuf::getCompression("out.json.zst") == CompressStreamBuf::COMPRESSION_ZSTD);
+	EXPECT_TRUE(CompressStreamBuf::getCompression("out.json") == CompressStreamBuf::COMPRESSION_NONE);
+	EXPECT_TRUE(CompressStreamBuf::getCompression(".gz") == CompressStreamBuf::COMPRESSION_NONE);
+	EXPECT_TRUE(CompressStreamBuf::getCompression(".zst") == CompressStreamBuf::COMPRESSION_NONE);
+	EXPECT_TRUE(CompressStreamBuf::getUncompressedPathName("/tmp/out.ndjson.gz") == "/tmp/out.ndjson");
+	EXPECT_TRUE(CompressStreamBuf::getUncompressedPathName("/tmp/out.ndjson.zst") == "/tmp/out.ndjson");
+	EXPECT_TRUE(CompressStreamBuf::getUncompressedPathName("/tmp/out.txt") == "/tmp/out.txt");
+	return 0;
+}
+int testRoundTrip(CompressStreamBuf::COMPRESSION eCompression)
+{
+	const std::string sPathName = makeTempPathName("fofimon-testcompressstreambuf-");
+	std::string sExpected;
+	{
+		CompressStreamBuf oCompressBuf;
+		auto sError = oCompressBuf.open(sPathName, eCompression, false);
+		EXPECT_TRUE(sError.empty());
+		EXPECT_TRUE(oCompressBuf.isOpen());
+		std::ostream oOut(&oCompressBuf);
+		// several chunks
+		for (int32_t nLine = 0; nLine < 200000; ++nLine) {
+			oOut << "M /home/user/dir" << (nLine % 97) << "/file" << nLine << ".txt" << '\n';
+			sExpected += "M /home/user/dir" + std::to_string(nLine % 97) + "/file" + std::to_string(nLine) + ".txt\n";
+			if ((nLine % 1000) == 0) {
+				// doesn't end the chunk
+				oOut.flush();
+			}
+		}
+		EXPECT_TRUE(oOut.good());
+		sError = oCompressBuf.close();
+		EXPECT_TRUE(sError.empty());
+		EXPECT_TRUE(! oCompressBuf.isOpen());
+		EXPECT_TRUE(oCompressBuf.getTotInBytes() == static_cast<int64_t>(sExpected.size()));
+		EXPECT_TRUE(oCompressBuf.getTotWrittenBytes() < oCompressBuf.getTotInBytes() / 2);
+	}
+	const std::string sData = readFile(sPathName);
+	bool bComplete = false;
+	EXPECT_TRUE(decompress(eCompression, sData, bComplete) == sExpected);
+	EXPECT_TRUE(bComplete);
+
+	// empty
+	{
+		CompressStreamBuf oCompressBuf;
+		EXPECT_TRUE(oCompressBuf.open(sPathName, eCompression, false).empty());
+		EXPECT_TRUE(oCompressBuf.close().empty());
+	}
+	EXPECT_TRUE(decompress(eCompression, readFile(sPathName), bComplete).empty());
+	EXPECT_TRUE(bComplete);
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testAppend(CompressStreamBuf::COMPRESSION eCompression)
+{
+	const std::string sPathName = makeTempPathName("fofimon-testcompressstreambuf-");
+	for (int32_t nMember = 0; nMember < 2; ++nMember) {
+		CompressStreamBuf oCompressBuf;
+		EXPECT_TRUE(oCompressBuf.open(sPathName, eCompression, (nMember > 0)).empty());
+		std::ostream oOut(&oCompressBuf);
+		oOut << "Member " << nMember << '\n';
+		EXPECT_TRUE(oCompressBuf.close().empty());
+	}
+	bool bComplete = false;
+	EXPECT_TRUE(decompress(eCompression, readFile(sPathName), bComplete) == "Member 0\nMember 1\n");
+	EXPECT_TRUE(bComplete);
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testReadablePrefix(CompressStreamBuf::COMPRESSION eCompression)
+{
+	const std::string sPathName = makeTempPathName("fofimon-testcompressstreambuf-");
+	CompressStreamBuf oCompressBuf;
+	EXPECT_TRUE(oCompressBuf.open(sPathName, eCompression, false).empty());
+	std::ostream oOut(&oCompressBuf);
+	std::string sExpected;
+	for (int32_t nLine = 0; nLine < 100000; ++nLine) {
+		oOut << "Line " << nLine << '\n';
+		sExpected += "Line " + std::to_string(nLine) + "\n";
+	}
+	EXPECT_TRUE(oCompressBuf.getTotInBytes() > 0);
+	// what the compressor thread wrote so far can be decompressed
+	// as if the program had crashed
+	std::string sPrefix;
+	bool bComplete = true;
+	for (int32_t nTry = 0; nTry < 1000; ++nTry) {
+		sPrefix = decompress(eCompression, readFile(sPathName), bComplete);
+		if (sPrefix.size() > 0) {
+			break; // for ---
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_TRUE(! sPrefix.empty());
+	EXPECT_TRUE(! bComplete);
+	EXPECT_TRUE(sExpected.compare(0, sPrefix.size(), sPrefix) == 0);
+	EXPECT_TRUE(oCompressBuf.close().empty());
+	EXPECT_TRUE(decompress(eCompression, readFile(sPathName), bComplete) == sExpected);
+	EXPECT_TRUE(bComplete);
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testOpenError()
+{
+	CompressStreamBuf oCompressBuf;
+	const auto sError = oCompressBuf.open("/nonexistent-dir/out.gz", CompressStreamBuf::COMPRESSION_GZIP, false);
+	EXPECT_TRUE(! sError.empty());
+	EXPECT_TRUE(! oCompressBuf.isOpen());
+	std::ostream oOut(&oCompressBuf);
+	oOut << "Lost";
+	EXPECT_TRUE(! oOut.good());
+	EXPECT_TRUE(oCompressBuf.close().empty());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "CompressStreamBuf Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testPathNames());
+	for (auto eCompression : {fofi::CompressStreamBuf::COMPRESSION_GZIP, fofi::CompressStreamBuf::COMPRESSION_ZSTD}) {
+		EXECUTE_TEST(fofi::testing::testRoundTrip(eCompression));
+		EXECUTE_TEST(fofi::testing::testAppend(eCompression));
+		EXECUTE_TEST(fofi::testing::testReadablePrefix(eCompression));
+	}
+	EXECUTE_TEST(fofi::testing::testOpenError());
+	//
+	std::cout << "CompressStreamBuf Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testEventServer.cxx
+ */
+
+#include "eventserver.h"
+
+#include "mainloopfixture.h"
+#include "testingcommon.h"
+
+#include "nlohmann/json.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+std::string getTestSocketPathName()
+{
+	return "/tmp/fofimon-testeventserver-" + std::to_string(::getpid()) + ".sock";
+}
+int connectClient(const std::string& sPathName)
+{
+	const int nFD = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	assert(nFD >= 0);
+	struct sockaddr_un oAddr;
+	std::memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sun_family = AF_UNIX;
+	std::memcpy(oAddr.sun_path, sPathName.c_str(), sPathName.size() + 1);
+	const int nRet = ::connect(nFD, reinterpret_cast<struct sockaddr*>(&oAddr), sizeof(oAddr));
+	assert(nRet == 0);
+	(void)nRet;
+	return nFD;
+}
+// Appends the available data to sReceived, returns false if the connection was closed
+bool receiveAvailable(int nFD, std::string& sReceived)
+{
+	char aBuffer[65536];
+	while (true) {
+		const ssize_t nRead = ::recv(nFD, aBuffer, sizeof(aBuffer), MSG_DONTWAIT);
+		if (nRead > 0) {
+			sReceived.append(aBuffer, static_cast<size_t>(nRead));
+			continue; // while ----
+		}
+		if ((nRead < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) {
+			return true; //-----------------------------------------------------
+		}
+		return false; //--------------------------------------------------------
+	}
+}
+std::vector<nlohmann::json> parseLines(const std::string& sReceived)
+{
+	std::vector<nlohmann::json> aValues;
+	std::istringstream oIn(sReceived);
+	std::string sLine;
+	while (std::getline(oIn, sLine)) {
+		aValues.push_back(nlohmann::json::parse(sLine));
+	}
+	return aValues;
+}
+LiveBinary::Event makeEvent(LiveBinary::LIVE_ACTION eAction, int64_t nTimeUsec)
+{
+	LiveBinary::Event oEvent;
+	oEvent.m_eAction = eAction;
+	oEvent.m_eResultType = LiveBinary::LIVE_RESULT_CREATED;
+	oEvent.m_nTimeUsec = nTimeUsec;
+	return oEvent;
+}
+// Runs the main loop until oCF returns false (or 10 seconds)
+template<typename CF>
+void runUntil(CF oCF)
+{
+	MainLoopFixture oMainLoop;
+	int32_t nTicks = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		++nTicks;
+		return oCF() && (nTicks < 1000);
+	}, 10);
+}
+
+int testFilters()
+{
+	const std::string sPathName = getTestSocketPathName();
+	EventServer oServer;
+	EXPECT_TRUE(oServer.listen(sPathName, EventServer::Config{}).empty());
+	EXPECT_TRUE(oServer.isListening());
+	const int nAllFD = connectClient(sPathName);
+	const int nFilteredFD = connectClient(sPathName);
+	const int nInvalidFD = connectClient(sPathName);
+	const std::string sFilter = "prefix /tmp/x/\nactions CREATE,RENAME_TO\n";
+	EXPECT_TRUE(::write(nFilteredFD, sFilter.c_str(), sFilter.size()) == static_cast<ssize_t>(sFilter.size()));
+	const std::string sInvalid = "actions CREATE,EXPLODE\n";
+	EXPECT_TRUE(::write(nInvalidFD, sInvalid.c_str(), sInvalid.size()) == static_cast<ssize_t>(sInvalid.size()));
+	std::string sInvalidReceived;
+	runUntil([&]()
+	{
+		receiveAvailable(nInvalidFD, sInvalidReceived);
+		return (oServer.getTotSubscribers() < 3) || sInvalidReceived.empty();
+	});
+	EXPECT_TRUE(oServer.getTotSubscribers() == 3);
+	auto aValues = parseLines(sInvalidReceived);
+	EXPECT_TRUE(aValues.size() == 1);
+	EXPECT_TRUE(aValues[0].contains("Error"));
+
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_CREATE, 1), "/tmp/x/a", "");
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_MODIFY, 2), "/tmp/x/a", "");
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_CREATE, 3), "/tmp/xy", "");
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_RENAME_TO, 4), "/tmp/x", "/tmp/w");
+	std::string sAllReceived;
+	std::string sFilteredReceived;
+	EXPECT_TRUE(receiveAvailable(nAllFD, sAllReceived));
+	EXPECT_TRUE(receiveAvailable(nFilteredFD, sFilteredReceived));
+	aValues = parseLines(sAllReceived);
+	EXPECT_TRUE(aValues.size() == 4);
+	EXPECT_TRUE(aValues[1]["Action"] == "MODIFY");
+	EXPECT_TRUE(aValues[1]["Path"] == "/tmp/x/a");
+	EXPECT_TRUE(aValues[1]["Time"] == 2);
+	EXPECT_TRUE(aValues[1]["Status"] == "CREATED");
+	EXPECT_TRUE(aValues[1]["Dir"] == false);
+	EXPECT_TRUE(! aValues[1].contains("Other path"));
+	EXPECT_TRUE(aValues[3]["Other path"] == "/tmp/w");
+	aValues = parseLines(sFilteredReceived);
+	EXPECT_TRUE(aValues.size() == 2);
+	EXPECT_TRUE(aValues[0]["Time"] == 1);
+	EXPECT_TRUE(aValues[1]["Time"] == 4);
+	// the invalid actions line didn't change the filter
+	sInvalidReceived.clear();
+	EXPECT_TRUE(receiveAvailable(nInvalidFD, sInvalidReceived));
+	EXPECT_TRUE(parseLines(sInvalidReceived).size() == 4);
+
+	::close(nAllFD);
+	runUntil([&]()
+	{
+		return (oServer.getTotSubscribers() == 3);
+	});
+	EXPECT_TRUE(oServer.getTotSubscribers() == 2);
+	oServer.close();
+	EXPECT_TRUE(! oServer.isListening());
+	EXPECT_TRUE(::access(sPathName.c_str(), F_OK) != 0);
+	// the subscribers were disconnected
+	EXPECT_TRUE(! receiveAvailable(nFilteredFD, sFilteredReceived));
+	::close(nFilteredFD);
+	::close(nInvalidFD);
+	return 0;
+}
+int testDropPolicy()
+{
+	const std::string sPathName = getTestSocketPathName();
+	EventServer oServer;
+	EventServer::Config oConfig;
+	oConfig.m_nMaxQueuedEvents = 10;
+	EXPECT_TRUE(oServer.listen(sPathName, oConfig).empty());
+	const int nFD = connectClient(sPathName);
+	runUntil([&]()
+	{
+		return (oServer.getTotSubscribers() == 0);
+	});
+	// fills the socket buffers and the queue, the subscriber doesn't read
+	const std::string sLongPath = "/tmp/" + std::string(500, 'x');
+	const int32_t nTotEvents = 20000;
+	for (int32_t nCount = 0; nCount < nTotEvents; ++nCount) {
+		oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_MODIFY, nCount), sLongPath, "");
+	}
+	EXPECT_TRUE(oServer.getTotDropped() > 0);
+	EXPECT_TRUE(oServer.getTotSubscribers() == 1);
+	// the notice is sent with the next event that fits
+	std::string sReceived;
+	int32_t nIdleTicks = 0;
+	runUntil([&]()
+	{
+		const size_t nOldSize = sReceived.size();
+		receiveAvailable(nFD, sReceived);
+		nIdleTicks = ((sReceived.size() == nOldSize) ? nIdleTicks + 1 : 0);
+		return (sReceived.empty() || (nIdleTicks < 5));
+	});
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_MODIFY, nTotEvents), sLongPath, "");
+	runUntil([&]()
+	{
+		receiveAvailable(nFD, sReceived);
+		return (sReceived.find("\"Time\":" + std::to_string(nTotEvents) + "}") == std::string::npos);
+	});
+	const auto aValues = parseLines(sReceived);
+	int64_t nTotReceived = 0;
+	int64_t nTotDropped = 0;
+	int64_t nLastTime = -1;
+	for (const auto& oValue : aValues) {
+		if (oValue.contains("Dropped")) {
+			nTotDropped += oValue["Dropped"].get<int64_t>();
+			continue; // for ---
+		}
+		const int64_t nTime = oValue["Time"].get<int64_t>();
+		EXPECT_TRUE(nTime > nLastTime);
+		nLastTime = nTime;
+		++nTotReceived;
+	}
+	EXPECT_TRUE(nTotDropped == oServer.getTotDropped());
+	EXPECT_TRUE(nTotReceived + nTotDropped == nTotEvents + 1);
+	::close(nFD);
+	oServer.close();
+	return 0;
+}
+int testDisconnectPolicy()
+{
+	const std::string sPathName = getTestSocketPathName();
+	EventServer oServer;
+	EventServer::Config oConfig;
+	oConfig.m_nMaxQueuedEvents = 10;
+	oConfig.m_eFullPolicy = EventServer::FULL_POLICY_DISCONNECT;
+	EXPECT_TRUE(oServer.listen(sPathName, oConfig).empty());
+	const int nFD = connectClient(sPathName);
+	runUntil([&]()
+	{
+		return (oServer.getTotSubscribers() == 0);
+	});
+	const std::string sLongPath = "/tmp/" + std::string(500, 'x');
+	for (int32_t nCount = 0; (nCount < 20000) && (oServer.getTotSubscribers() > 0); ++nCount) {
+		oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_MODIFY, nCount), sLongPath, "");
+	}
+	EXPECT_TRUE(oServer.getTotSubscribers() == 0);
+	EXPECT_TRUE(oServer.getTotDisconnected() == 1);
+	EXPECT_TRUE(oServer.getTotDropped() == 0);
+	// the data already in the socket can still be read
+	std::string sReceived;
+	EXPECT_TRUE(! receiveAvailable(nFD, sReceived));
+	EXPECT_TRUE(! sReceived.empty());
+	::close(nFD);
+	oServer.close();
+	return 0;
+}
+int testSocketInUse()
+{
+	const std::string sPathName = getTestSocketPathName();
+	EventServer oServer;
+	EXPECT_TRUE(oServer.listen(sPathName, EventServer::Config{}).empty());
+	// doesn't take the path from a running instance
+	EventServer oSecondServer;
+	EXPECT_TRUE(! oSecondServer.listen(sPathName, EventServer::Config{}).empty());
+	EXPECT_TRUE(! oSecondServer.isListening());
+	const int nFD = connectClient(sPathName);
+	runUntil([&]()
+	{
+		return (oServer.getTotSubscribers() > 0);
+	});
+	EXPECT_TRUE(oServer.getTotSubscribers() > 0);
+	::close(nFD);
+	oServer.close();
+
+	// the socket file of an instance that didn't close it
+	const int nStaleFD = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	EXPECT_TRUE(nStaleFD >= 0);
+	struct sockaddr_un oAddr;
+	std::memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sun_family = AF_UNIX;
+	std::memcpy(oAddr.sun_path, sPathName.c_str(), sPathName.size() + 1);
+	EXPECT_TRUE(::bind(nStaleFD, reinterpret_cast<struct sockaddr*>(&oAddr), sizeof(oAddr)) == 0);
+	::close(nStaleFD);
+	EXPECT_TRUE(oSecondServer.listen(sPathName, EventServer::Config{}).empty());
+	oSecondServer.close();
+	return 0;
+}
+int testErrors()
+{
+	EventServer oServer;
+	EXPECT_TRUE(! oServer.listen("/tmp/fofimon-testeventserver-nonexistent/dir/s.sock", EventServer::Config{}).empty());
+	EXPECT_TRUE(! oServer.isListening());
+	// no subscribers: ignored
+	oServer.publish(makeEvent(LiveBinary::LIVE_ACTION_CREATE, 1), "/tmp/a", "");
+
+	EventServer::FULL_POLICY eFullPolicy = EventServer::FULL_POLICY_DROP;
+	EXPECT_TRUE(EventServer::getFullPolicyFromName("disconnect", eFullPolicy));
+	EXPECT_TRUE(eFullPolicy == EventServer::FULL_POLICY_DISCONNECT);
+	EXPECT_TRUE(EventServer::getFullPolicyFromName("drop", eFullPolicy));
+	EXPECT_TRUE(eFullPolicy == EventServer::FULL_POLICY_DROP);
+	EXPECT_TRUE(! EventServer::getFullPolicyFromName("block", eFullPolicy));
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "EventServer Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testFilters());
+	EXECUTE_TEST(fofi::testing::testDropPolicy());
+	EXECUTE_TEST(fofi::testing::testDisconnectPolicy());
+	EXECUTE_TEST(fofi::testing::testSocketInUse());
+	EXECUTE_TEST(fofi::testing::testErrors());
+	//
+	std::cout << "EventServer Tests successful!" << '\n';
+	return 0;
+}
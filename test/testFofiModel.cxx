@@ -59,7 +59,7 @@ int testAddDirectoryZone()
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
 	const FofiModel::ToWatchDir& oRootTWD = aToWatchDirs[nRootTWDIdx];
-	EXPECT_TRUE(oRootTWD.m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 	EXPECT_TRUE( oRootTWD.exists());
 	EXPECT_TRUE(oRootTWD.m_aPinnedSubDirs.size() == 1);
 	EXPECT_TRUE(oRootTWD.m_aPinnedSubDirs[0] == aBaseSplitPath[0]);
@@ -75,7 +75,7 @@ int testAddDirectoryZone()
 			sPartiaPath += "/" + aBaseSplitPath[nPartialEl];
 		}
 //std::cout << "sPartiaPath=" << sPartiaPath << '\n';
-		EXPECT_TRUE(oCurTWD.m_sPathName == sPartiaPath);
+		EXPECT_TRUE(oFofiModel.getToWatchDirPath(nCurTWDIdx) == sPartiaPath);
 		EXPECT_TRUE( oCurTWD.exists());
 		if (nPathEl != nBasePathEls - 1) {
 			EXPECT_TRUE(oCurTWD.m_aPinnedSubDirs.size() == 1);
@@ -88,8 +88,7 @@ int testAddDirectoryZone()
 	const auto& oCurTWD = aToWatchDirs[nCurTWDIdx];
 	EXPECT_TRUE(oCurTWD.getToWatchSubDirIdxs().size() == 1);
 	const int32_t nATWDIdx = oCurTWD.getToWatchSubDirIdxs()[0];
-	const auto& oATWD = aToWatchDirs[nATWDIdx];
-	EXPECT_TRUE(oATWD.m_sPathName == sBasePath + "/A");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nATWDIdx) == sBasePath + "/A");
 	
 	return 0;
 }
@@ -130,7 +129,7 @@ int testAddTwoDirectoryZones()
 	EXPECT_TRUE(aToWatchDirs.size() == aBaseSplitPath.size() + 1 + 2 + 4); // + "/" + ("A1","A2") + ("/A1/B12", "/A1/B12"/C121", "/A1/B12"/C122", "/A1/B12"/C123")
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
-	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 
 	const int32_t nBaseTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
 	EXPECT_TRUE(nBaseTWDIdx >= 0);
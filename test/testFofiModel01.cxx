@@ -97,7 +97,7 @@ int testAddTwoDirectoryZonesInclude()
 	EXPECT_TRUE(aToWatchDirs.size() == aBaseSplitPath.size() + 1 + 2 + 2); // + "/" + ("A1","A2") + ("/A1/B12", "/A1/B12"/C123")
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
-	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 
 	const int32_t nBaseTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
 	EXPECT_TRUE(nBaseTWDIdx >= 0);
@@ -145,14 +145,14 @@ int testAddTwoDirectoryZonesInclude()
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_MODIFY);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_MODIFIED);
-	EXPECT_TRUE(oResult0.m_sName == "xx123.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx123.txt");
 
 	const auto& oResult1 = aResults[1];
 	EXPECT_TRUE(oResult1.m_aActions.size() == 2);
 	EXPECT_TRUE(oResult1.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 	EXPECT_TRUE(oResult1.m_aActions[1].m_eAction == INotifierSource::FOFI_ACTION_DELETE);
 	EXPECT_TRUE(oResult1.m_eResultType == FofiModel::RESULT_TEMPORARY);
-	EXPECT_TRUE(oResult1.m_sName == "xx2.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "xx2.txt");
 	return 0;
 }
 
@@ -97,7 +97,7 @@ int testRenameDirectoryTree()
 	// + "/" + ("A1","A2") + ("/A1/B12", "/A1/B12/C121", "/A1/B12/C122", "/A1/B12/C123") 
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
-	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 
 	const int32_t nBaseTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
 	EXPECT_TRUE(nBaseTWDIdx >= 0);
@@ -151,14 +151,14 @@ int testRenameDirectoryTree()
 	EXPECT_TRUE(aResults.size() == 5);
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "xx123.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx123.txt");
 	EXPECT_TRUE(! oResult0.m_bIsDir);
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_MODIFY);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_MODIFIED);
 
 	const auto& oResult1 = aResults[1];
-	EXPECT_TRUE(oResult1.m_sName == "D1211");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "D1211");
 	EXPECT_TRUE(oResult1.m_bIsDir);
 //std::cout << "   oResult1.m_aActions.size()=" << oResult1.m_aActions.size() << '\n';
 	EXPECT_TRUE(oResult1.m_aActions.size() == 2);
@@ -167,7 +167,7 @@ int testRenameDirectoryTree()
 	EXPECT_TRUE(oResult1.m_eResultType == FofiModel::RESULT_TEMPORARY);
 
 	const auto& oResult2 = aResults[2];
-	EXPECT_TRUE(oResult2.m_sName == "xx2.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult2) == "xx2.txt");
 	EXPECT_TRUE(! oResult2.m_bIsDir);
 	EXPECT_TRUE(oResult2.m_aActions.size() == 2);
 	EXPECT_TRUE(oResult2.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
@@ -176,7 +176,7 @@ int testRenameDirectoryTree()
 
 	const auto& oResult3 = aResults[3];
 //std::cout << "   oResult3.m_sName=" << oResult3.m_sName << '\n';
-	EXPECT_TRUE(oResult3.m_sName == "AAA");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult3) == "AAA");
 	EXPECT_TRUE(oResult3.m_bIsDir);
 	EXPECT_TRUE(oResult3.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult3.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO);
@@ -185,7 +185,7 @@ int testRenameDirectoryTree()
 	const auto& oResult4 = aResults[4];
 //std::cout << "   oResult4.m_sName=" << oResult4.m_sName << '\n';
 //std::cout << "   oResult4.m_sPath=" << oResult4.m_sPath << '\n';
-	EXPECT_TRUE(oResult4.m_sName == "xx1211.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult4) == "xx1211.txt");
 	EXPECT_TRUE(! oResult4.m_bIsDir);
 	EXPECT_TRUE(oResult4.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult4.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
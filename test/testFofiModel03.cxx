@@ -96,7 +96,7 @@ int testDirectoryZoneShadowing()
 	// +  ("/A1/B12") 
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
-	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 
 	const int32_t nBaseTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
 	EXPECT_TRUE(nBaseTWDIdx >= 0);
@@ -143,7 +143,7 @@ int testDirectoryZoneShadowing()
 	EXPECT_TRUE(aResults.size() == 1);
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "C124");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "C124");
 //std::cout << "   oResult0.m_aActions.size()=" << oResult0.m_aActions.size() << '\n';
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
@@ -98,7 +98,7 @@ int testDontFollowSymLinks()
 	// +  ("/A1/B12") 
 	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
 	EXPECT_TRUE(nRootTWDIdx >= 0);
-	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].m_sPathName == "/");
+	EXPECT_TRUE(oFofiModel.getToWatchDirPath(nRootTWDIdx) == "/");
 
 	{
 	const int32_t nBaseTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
@@ -147,7 +147,7 @@ int testDontFollowSymLinks()
 	EXPECT_TRUE(aResults.size() == 2);
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "C124");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "C124");
 //std::cout << "   oResult0.m_aActions.size()=" << oResult0.m_aActions.size() << '\n';
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
@@ -155,7 +155,7 @@ int testDontFollowSymLinks()
 	EXPECT_TRUE(oResult0.m_bIsDir);
 
 	const auto& oResult1 = aResults[1];
-	EXPECT_TRUE(oResult1.m_sName == "A3");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "A3");
 //std::cout << "   oResult1.m_aActions.size()=" << oResult1.m_aActions.size() << '\n';
 	EXPECT_TRUE(oResult1.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult1.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
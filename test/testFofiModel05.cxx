@@ -154,7 +154,7 @@ int testNonExistingDirectoryZone()
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_CREATED);
-	EXPECT_TRUE(oResult0.m_sName == "B12");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "B12");
 	EXPECT_TRUE(oResult0.m_bIsDir);
 
 	const auto& oResult1 = aResults[1];
@@ -166,7 +166,7 @@ int testNonExistingDirectoryZone()
 	EXPECT_TRUE(oResult1.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult1.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 	EXPECT_TRUE(oResult1.m_eResultType == FofiModel::RESULT_CREATED);
-	EXPECT_TRUE(oResult1.m_sName == "C123");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "C123");
 	EXPECT_TRUE(oResult1.m_bIsDir);
 
 	const auto& oResult2 = aResults[2];
@@ -178,7 +178,7 @@ int testNonExistingDirectoryZone()
 	EXPECT_TRUE(oResult2.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult2.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 	EXPECT_TRUE(oResult2.m_eResultType == FofiModel::RESULT_CREATED);
-	EXPECT_TRUE(oResult2.m_sName == "xx123.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult2) == "xx123.txt");
 	EXPECT_TRUE(! oResult2.m_bIsDir);
 	return 0;
 }
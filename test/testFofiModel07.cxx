@@ -166,7 +166,7 @@ int testDeepDirectoryReCreation()
 	EXPECT_TRUE(aResults.size() == 7 + 2 + 6 + 1 + 8 + 3);
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "A1");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "A1");
 	EXPECT_TRUE(oResult0.m_bIsDir);
 
 	EXPECT_TRUE( ! oFofiModel.hasInconsistencies());
@@ -186,14 +186,14 @@ int testDeepDirectoryReCreation()
 //	EXPECT_TRUE(oResult1.m_aActions.size() == 1);
 //	EXPECT_TRUE(oResult1.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 //	EXPECT_TRUE(oResult1.m_eResultType == FofiModel::RESULT_CREATED);
-//	EXPECT_TRUE(oResult1.m_sName == "C123");
+//	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "C123");
 //	EXPECT_TRUE(oResult1.m_bIsDir);
 //
 //	const auto& oResult2 = aResults[2];
 //	EXPECT_TRUE(oResult2.m_aActions.size() == 1);
 //	EXPECT_TRUE(oResult2.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 //	EXPECT_TRUE(oResult2.m_eResultType == FofiModel::RESULT_CREATED);
-//	EXPECT_TRUE(oResult2.m_sName == "xx123.txt");
+//	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult2) == "xx123.txt");
 //	EXPECT_TRUE(! oResult2.m_bIsDir);
 	return 0;
 }
@@ -141,12 +141,12 @@ int testDeepRename()
 	EXPECT_TRUE(aResults.size() == 2 * (7 + (7-1) * nGenFiles));
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "A1");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "A1");
 	EXPECT_TRUE(oResult0.m_bIsDir);
 
 	uint32_t nCountA1 = 0;
 	for (const auto& oResult : aResults) {
-		const std::string sPathName = oResult.m_sPath + "/" + oResult.m_sName;
+		const std::string sPathName = oFofiModel.getWatchedResultParentPath(oResult) + "/" + oFofiModel.getWatchedResultName(oResult);
 //std::cout << "  Result path=" << sPathName << (oResult.m_bIsDir ? "/" : "") << '\n';
 		EXPECT_TRUE(oResult.m_aActions.size() == 1);
 		EXPECT_TRUE(! oResult.m_bInconsistent);
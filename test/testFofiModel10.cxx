@@ -142,12 +142,12 @@ int testDeepRenameAndBackNoSleep()
 	EXPECT_TRUE(aResults.size() == 2 * (7 + (7-1) * nGenFiles));
 
 	const auto& oResult0 = aResults[0];
-	EXPECT_TRUE(oResult0.m_sName == "A1");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "A1");
 	EXPECT_TRUE(oResult0.m_bIsDir);
 
 	uint32_t nCountA1 = 0;
 	for (const auto& oResult : aResults) {
-		const std::string sPathName = oResult.m_sPath + "/" + oResult.m_sName;
+		const std::string sPathName = oFofiModel.getWatchedResultParentPath(oResult) + "/" + oFofiModel.getWatchedResultName(oResult);
 //std::cout << "  Result path=" << sPathName << (oResult.m_bIsDir ? "/" : "") << '\n';
 //std::cout << "         oResult.m_aActions.size()=" << oResult.m_aActions.size() << '\n';
 		EXPECT_TRUE(oResult.m_aActions.size() == 2);
@@ -0,0 +1,285 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel12.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+struct ChurnStats
+{
+	int32_t m_nInitialLiveTWDs = 0;
+	int32_t m_nWarmTotTWDs = 0; /**< Including the free ones. */
+	int32_t m_nWarmTotResults = 0; /**< Including the free ones. */
+	int64_t m_nWarmRSS = 0;
+	int32_t m_nFinalLiveTWDs = 0;
+	int32_t m_nFinalTotTWDs = 0;
+	int32_t m_nFinalLiveResults = 0;
+	int32_t m_nFinalTotResults = 0;
+	int64_t m_nFinalRSS = 0;
+};
+
+int32_t countLive(const FofiModel& oFofiModel, int32_t& nLiveResults)
+{
+	int32_t nLiveTWDs = 0;
+	for (const auto& oTWD : oFofiModel.getToWatchDirectories()) {
+		if (! oTWD.isFree()) {
+			++nLiveTWDs;
+		}
+	}
+	nLiveResults = 0;
+	for (const auto& oResult : oFofiModel.getWatchedResults()) {
+		if (! oResult.isFree()) {
+			++nLiveResults;
+		}
+	}
+	return nLiveTWDs;
+}
+
+// Build directories with a new name each cycle are created and wiped
+static constexpr int32_t s_nDirsPerCycle = 3;
+static constexpr int32_t s_nResultsPerCycle = 7;
+void createBuildTree(TempFileTreeFixture& oTempFileTreeFixture, const std::string& sBuild)
+{
+	oTempFileTreeFixture.createOrModifyRelFile(sBuild + "/f1.o");
+	oTempFileTreeFixture.createOrModifyRelFile(sBuild + "/Obj/f2.o");
+	oTempFileTreeFixture.createOrModifyRelFile(sBuild + "/Obj/Sub/f3.o");
+	oTempFileTreeFixture.createOrModifyRelFile("Tmp.txt");
+}
+void removeBuildTree(TempFileTreeFixture& oTempFileTreeFixture, const std::string& sBuild)
+{
+	oTempFileTreeFixture.removeRelFile(sBuild + "/Obj/Sub/f3.o");
+	oTempFileTreeFixture.removeRelDir(sBuild + "/Obj/Sub");
+	oTempFileTreeFixture.removeRelFile(sBuild + "/Obj/f2.o");
+	oTempFileTreeFixture.removeRelDir(sBuild + "/Obj");
+	oTempFileTreeFixture.removeRelFile(sBuild + "/f1.o");
+	oTempFileTreeFixture.removeRelDir(sBuild);
+	oTempFileTreeFixture.removeRelFile("Tmp.txt");
+}
+
+int runChurn(bool bRecycle, int32_t nWarmCycles, int32_t nTotCycles, ChurnStats& oStats)
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("Keep/k.txt");
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setRecycleTemporary(bRecycle);
+	EXPECT_TRUE(oFofiModel.isRecycleTemporary() == bRecycle);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	int32_t nLiveResults = 0;
+	oStats.m_nInitialLiveTWDs = countLive(oFofiModel, nLiveResults);
+
+	// each cycle creates a tree on a tick and removes it on the next
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	int32_t nFinalCount = 10;
+	oMainLoop.run([&]() -> bool
+	{
+		const int32_t nCycle = nTick / 2;
+		if (nCycle < nTotCycles) {
+			const std::string sBuild = "Build" + std::to_string(nCycle);
+			if ((nTick % 2) == 0) {
+				if (nCycle == nWarmCycles) {
+					oStats.m_nWarmTotTWDs = static_cast<int32_t>(oFofiModel.getToWatchDirectories().size());
+					oStats.m_nWarmTotResults = static_cast<int32_t>(oFofiModel.getWatchedResults().size());
+					oStats.m_nWarmRSS = getResidentBytes();
+				}
+				createBuildTree(oTempFileTreeFixture, sBuild);
+			} else {
+				removeBuildTree(oTempFileTreeFixture, sBuild);
+			}
+			++nTick;
+			return true;
+		}
+		if (nFinalCount > 0) {
+			--nFinalCount;
+			return true;
+		}
+		return false;
+	}, nTestIntervalMillisec);
+
+	oStats.m_nFinalLiveTWDs = countLive(oFofiModel, oStats.m_nFinalLiveResults);
+	oStats.m_nFinalTotTWDs = static_cast<int32_t>(oFofiModel.getToWatchDirectories().size());
+	oStats.m_nFinalTotResults = static_cast<int32_t>(oFofiModel.getWatchedResults().size());
+	oStats.m_nFinalRSS = getResidentBytes();
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	// The untouched directories are still there
+	EXPECT_TRUE(oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/Keep") >= 0);
+	if (bRecycle) {
+		EXPECT_TRUE(oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/Build0") < 0);
+	}
+	return 0;
+}
+
+int testChurnWithoutRecycling()
+{
+	const int32_t nTotCycles = 50;
+	ChurnStats oStats;
+	const auto nRet = runChurn(false, 0, nTotCycles, oStats);
+	if (nRet != 0) {
+		return nRet; //---------------------------------------------------------
+	}
+	// every build directory leaves its objects behind
+	EXPECT_TRUE(oStats.m_nFinalTotTWDs >= oStats.m_nInitialLiveTWDs + nTotCycles * s_nDirsPerCycle);
+	EXPECT_TRUE(oStats.m_nFinalLiveTWDs == oStats.m_nFinalTotTWDs);
+	EXPECT_TRUE(oStats.m_nFinalLiveResults == oStats.m_nFinalTotResults);
+	// at least a temporary result for each build dir plus the Tmp.txt file
+	EXPECT_TRUE(oStats.m_nFinalLiveResults >= nTotCycles + 1);
+	return 0;
+}
+
+int testChurnWithRecycling()
+{
+	const int32_t nWarmCycles = 50;
+	const int32_t nTotCycles = 400;
+	ChurnStats oStats;
+	const auto nRet = runChurn(true, nWarmCycles, nTotCycles, oStats);
+	if (nRet != 0) {
+		return nRet; //---------------------------------------------------------
+	}
+	// all the temporary objects were reclaimed
+	EXPECT_TRUE(oStats.m_nFinalLiveTWDs == oStats.m_nInitialLiveTWDs);
+	EXPECT_TRUE(oStats.m_nFinalLiveResults == 0);
+	// the slots were reused rather than added
+	EXPECT_TRUE(oStats.m_nFinalTotTWDs <= oStats.m_nWarmTotTWDs + s_nDirsPerCycle);
+	EXPECT_TRUE(oStats.m_nFinalTotResults <= oStats.m_nWarmTotResults + s_nResultsPerCycle);
+	// no leak after the warm up, the bound leaves room for the allocator
+	if ((oStats.m_nWarmRSS > 0) && (oStats.m_nFinalRSS > 0)) {
+		EXPECT_TRUE(oStats.m_nFinalRSS - oStats.m_nWarmRSS < 8 * 1024 * 1024);
+	}
+	return 0;
+}
+
+int testChurnWithUniqueNames()
+{
+	// each create tick adds new names, each remove tick makes them unused
+	static constexpr int32_t nFilesPerTick = 150;
+	static constexpr int32_t nTotTicks = 200;
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("Keep/k.txt");
+	oTempFileTreeFixture.createRelDir("Tmp");
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setRecycleTemporary(true);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = oTempFileTreeFixture.m_sTestBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	int32_t nMaxNames = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == nTotTicks + 10) {
+			return false;
+		}
+		if (nTick < nTotTicks) {
+			const std::string sPrefix = "Tmp/u" + std::to_string(nTick / 2) + "_";
+			for (int32_t nFile = 0; nFile < nFilesPerTick; ++nFile) {
+				const std::string sRelPath = sPrefix + std::to_string(nFile) + ".txt";
+				if ((nTick % 2) == 0) {
+					oTempFileTreeFixture.createOrModifyRelFile(sRelPath);
+				} else {
+					oTempFileTreeFixture.removeRelFile(sRelPath);
+				}
+			}
+		}
+		nMaxNames = std::max(nMaxNames, oFofiModel.getTotNames());
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	int32_t nLiveResults = 0;
+	countLive(oFofiModel, nLiveResults);
+	const int32_t nFinalNames = oFofiModel.getTotNames();
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	EXPECT_TRUE(nLiveResults == 0);
+	// without releasing the unused names there would be nTotTicks / 2 * nFilesPerTick (15000)
+	EXPECT_TRUE(nMaxNames < 10000);
+	EXPECT_TRUE(nFinalNames < 10000);
+
+	// the released names are kept as holes so that the ids don't change
+	TempFileTreeFixture oSnapshotDirFixture{};
+	const std::string sSnapshot = oSnapshotDirFixture.m_sTestBasePath + "/fofimon.snap";
+	sErr = oFofiModel.saveSnapshot(sSnapshot);
+	EXPECT_TRUE(sErr.empty());
+	FofiModel oResumedModel(1000000, 1000000);
+	sErr = addZone(oResumedModel, oTempFileTreeFixture.m_sTestBasePath, 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oResumedModel.resume(sSnapshot);
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(oResumedModel.getTotNames() == nFinalNames);
+	countLive(oResumedModel, nLiveResults);
+	EXPECT_TRUE(nLiveResults == 0);
+	oResumedModel.stop();
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel12 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testChurnWithoutRecycling());
+	EXECUTE_TEST(fofi::testing::testChurnWithRecycling());
+	EXECUTE_TEST(fofi::testing::testChurnWithUniqueNames());
+	//
+	std::cout << "FofiModel12 Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel13.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+int32_t countInMemory(const FofiModel& oFofiModel)
+{
+	int32_t nLiveResults = 0;
+	for (const auto& oResult : oFofiModel.getWatchedResults()) {
+		if (! oResult.isFree()) {
+			++nLiveResults;
+		}
+	}
+	return nLiveResults;
+}
+
+int testSpillAndReadBack()
+{
+	static constexpr int32_t nTotFiles = 20;
+	TempFileTreeFixture oTempFileTreeFixture{};
+	for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+		oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+	}
+	oTempFileTreeFixture.createOrModifyRelFile("Other/o.txt");
+	// the spill file must not be in the watched zone
+	TempFileTreeFixture oSpillDirFixture{};
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setResultSpill(oSpillDirFixture.m_sTestBasePath, 100 * 1000);
+	EXPECT_TRUE(oFofiModel.isResultSpill());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const auto oCountActionsOfF0 = [&](const std::string& sParentPath) -> int32_t
+	{
+		int32_t nTotActions = -1;
+		oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+		{
+			if ((oFofiModel.getWatchedResultName(oResult) == "f0.txt")
+					&& (oFofiModel.getWatchedResultParentPath(oResult) == sParentPath)) {
+				nTotActions = static_cast<int32_t>(oResult.m_aActions.size());
+			}
+		});
+		return nTotActions;
+	};
+
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	int32_t nSpilledBeforeModify = -1;
+	int32_t nInMemoryBeforeModify = -1;
+	int32_t nActionsBeforeModify = -1;
+	int32_t nSpilledAfterModify = -1;
+	int32_t nInMemoryAfterModify = -1;
+	int32_t nActionsAfterModify = -1;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+			}
+		} else if (nTick == 80) {
+			// long after the spill interval
+			nSpilledBeforeModify = oFofiModel.getTotSpilledResults();
+			nInMemoryBeforeModify = countInMemory(oFofiModel);
+			nActionsBeforeModify = oCountActionsOfF0(sBasePath + "/A");
+			oTempFileTreeFixture.createOrModifyRelFile("A/f0.txt");
+		} else if (nTick == 82) {
+			nSpilledAfterModify = oFofiModel.getTotSpilledResults();
+			nInMemoryAfterModify = countInMemory(oFofiModel);
+			nActionsAfterModify = oCountActionsOfF0(sBasePath + "/A");
+			// the spilled results are renamed too
+			oTempFileTreeFixture.renameRelPathName("A", "Other/B");
+		} else if (nTick == 90) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	EXPECT_TRUE(nSpilledBeforeModify == nTotFiles);
+	EXPECT_TRUE(nInMemoryBeforeModify == 0);
+	EXPECT_TRUE(nActionsBeforeModify > 0);
+	// read back when modified again, with its history
+	EXPECT_TRUE(nSpilledAfterModify == nTotFiles - 1);
+	EXPECT_TRUE(nInMemoryAfterModify == 1);
+	EXPECT_TRUE(nActionsAfterModify == nActionsBeforeModify);
+
+	int32_t nTotRenamedFrom = 0;
+	int32_t nTotRenamedTo = 0;
+	sErr = oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& oResult)
+	{
+		const std::string sParentPath = oFofiModel.getWatchedResultParentPath(oResult);
+		if (sParentPath == sBasePath + "/A") {
+			if ((oResult.m_eResultType == FofiModel::RESULT_DELETED)
+					&& (oResult.m_aActions.back().m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM)) {
+				++nTotRenamedFrom;
+			}
+		} else if (sParentPath == sBasePath + "/Other/B") {
+			if (oResult.m_eResultType == FofiModel::RESULT_CREATED) {
+				++nTotRenamedTo;
+			}
+		}
+	});
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(nTotRenamedFrom == nTotFiles);
+	EXPECT_TRUE(nTotRenamedTo == nTotFiles);
+	EXPECT_TRUE(oCountActionsOfF0(sBasePath + "/A") == nActionsAfterModify + 1);
+	return 0;
+}
+
+int testSpillKeepsActiveResults()
+{
+	static constexpr int32_t nTotFiles = 10;
+	TempFileTreeFixture oTempFileTreeFixture{};
+	for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+		oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+	}
+	TempFileTreeFixture oSpillDirFixture{};
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setResultSpill(oSpillDirFixture.m_sTestBasePath, 100 * 1000);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = oTempFileTreeFixture.m_sTestBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	int32_t nSpilledAtEnd = -1;
+	int32_t nInMemoryAtEnd = -1;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+			}
+		} else if (nTick == 80) {
+			nSpilledAtEnd = oFofiModel.getTotSpilledResults();
+			nInMemoryAtEnd = countInMemory(oFofiModel);
+			return false;
+		} else if ((nTick % 8) == 0) {
+			// changed more often than the spill interval (a further modify would be ignored)
+			oTempFileTreeFixture.removeRelFile("A/f3.txt");
+		} else if ((nTick % 8) == 4) {
+			oTempFileTreeFixture.createOrModifyRelFile("A/f3.txt");
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	EXPECT_TRUE(nSpilledAtEnd == nTotFiles - 1);
+	EXPECT_TRUE(nInMemoryAtEnd == 1);
+	bool bF3InMemory = false;
+	for (const auto& oResult : oFofiModel.getWatchedResults()) {
+		if ((! oResult.isFree()) && (oFofiModel.getWatchedResultName(oResult) == "f3.txt")) {
+			bF3InMemory = true;
+		}
+	}
+	EXPECT_TRUE(bF3InMemory);
+	return 0;
+}
+
+int testSpillFileIsCompacted()
+{
+	static constexpr int32_t nTotFiles = 100;
+	static constexpr int32_t nTotCycles = 10;
+	TempFileTreeFixture oTempFileTreeFixture{};
+	for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+		oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+	}
+	TempFileTreeFixture oSpillDirFixture{};
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setResultSpill(oSpillDirFixture.m_sTestBasePath, 50 * 1000);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = oTempFileTreeFixture.m_sTestBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTestIntervalMillisec = 5;
+	const int32_t nTicksPerCycle = 30;
+	int32_t nTick = 0;
+	int64_t nFirstSpillSize = -1;
+	int64_t nMaxSpillSize = 0;
+	int32_t nTotFullySpilled = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if ((nTick % nTicksPerCycle) == 0) {
+			if (nTick > 0) {
+				// long after the spill interval
+				if (oFofiModel.getTotSpilledResults() == nTotFiles) {
+					++nTotFullySpilled;
+				}
+				if (nFirstSpillSize < 0) {
+					nFirstSpillSize = oFofiModel.getSpillFileSize();
+				}
+				nMaxSpillSize = std::max(nMaxSpillSize, oFofiModel.getSpillFileSize());
+			}
+			if (nTick == nTotCycles * nTicksPerCycle) {
+				return false;
+			}
+			// the results are read back and spilled again
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+			}
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	EXPECT_TRUE(nTotFullySpilled == nTotCycles);
+	EXPECT_TRUE(nFirstSpillSize > 0);
+	// without compaction it would grow to nTotCycles times the first size
+	EXPECT_TRUE(nMaxSpillSize < 4 * nFirstSpillSize);
+
+	int32_t nTotResults = 0;
+	sErr = oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& /*oResult*/)
+	{
+		++nTotResults;
+	});
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(nTotResults == nTotFiles);
+	return 0;
+}
+
+int testSpillReadFailure()
+{
+	static constexpr int32_t nTotFiles = 5;
+	TempFileTreeFixture oTempFileTreeFixture{};
+	for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+		oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+	}
+	TempFileTreeFixture oSpillDirFixture{};
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setResultSpill(oSpillDirFixture.m_sTestBasePath, 100 * 1000);
+	int32_t nTotAborts = 0;
+	oFofiModel.m_oAbortSignal.connect([&](const std::string& /*sError*/)
+	{
+		++nTotAborts;
+	});
+
+	auto sErr = addZone(oFofiModel, sBasePath, 9999);
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	int32_t nSpilled = -1;
+	int32_t nTotTruncated = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+				oTempFileTreeFixture.createOrModifyRelFile("A/f" + std::to_string(nFile) + ".txt");
+			}
+		} else if (nTick == 80) {
+			nSpilled = oFofiModel.getTotSpilledResults();
+			// lose the spilled data
+			Glib::Dir oDir(oSpillDirFixture.m_sTestBasePath);
+			for (const auto& sName : oDir) {
+				const std::string sPathName = oSpillDirFixture.m_sTestBasePath + "/" + sName;
+				if (::truncate(sPathName.c_str(), 0) == 0) {
+					++nTotTruncated;
+				}
+			}
+			oTempFileTreeFixture.createOrModifyRelFile("A/f0.txt");
+		} else if (nTick == 90) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+
+	EXPECT_TRUE(nSpilled == nTotFiles);
+	EXPECT_TRUE(nTotTruncated == 1);
+	EXPECT_TRUE(nTotAborts > 0);
+	// no result was made up for f0.txt
+	EXPECT_TRUE(oFofiModel.getTotSpilledResults() == nTotFiles);
+	EXPECT_TRUE(countInMemory(oFofiModel) == 0);
+	sErr = oFofiModel.forEachWatchedResult([&](const FofiModel::WatchedResult& /*oResult*/) {});
+	EXPECT_TRUE(! sErr.empty());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel13 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testSpillAndReadBack());
+	EXECUTE_TEST(fofi::testing::testSpillKeepsActiveResults());
+	EXECUTE_TEST(fofi::testing::testSpillFileIsCompacted());
+	EXECUTE_TEST(fofi::testing::testSpillReadFailure());
+	//
+	std::cout << "FofiModel13 Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel14.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+static constexpr int32_t s_nTotSaves = 10;
+
+// Saves a file the way editors do: write a temporary file then rename it over the original
+int runSaves(bool bCollapseRuns, int32_t nMaxActions, FofiModel::WatchedResult& oSaved, FofiModel::WatchedResult& oTemp)
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/doc.txt");
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setActionCompaction(bCollapseRuns, nMaxActions);
+	EXPECT_TRUE(oFofiModel.isCollapseActions() == bCollapseRuns);
+	EXPECT_TRUE(oFofiModel.getMaxActions() == nMaxActions);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTestIntervalMillisec = 5;
+	int32_t nTick = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick < s_nTotSaves) {
+			oTempFileTreeFixture.createOrModifyRelFile("A/doc.txt.tmp");
+			oTempFileTreeFixture.renameRelPathName("A/doc.txt.tmp", "A/doc.txt");
+		} else if (nTick == s_nTotSaves + 10) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	int32_t nFound = 0;
+	for (const auto& oResult : oFofiModel.getWatchedResults()) {
+		if (oResult.isFree()) {
+			continue; // for ---
+		}
+		const std::string sName = oFofiModel.getWatchedResultName(oResult);
+		if (sName == "doc.txt") {
+			oSaved = oResult;
+			++nFound;
+		} else if (sName == "doc.txt.tmp") {
+			oTemp = oResult;
+			++nFound;
+		}
+	}
+	EXPECT_TRUE(nFound == 2);
+	EXPECT_TRUE(oTemp.m_eResultType == FofiModel::RESULT_TEMPORARY);
+	return 0;
+}
+
+int testActionsNotCompacted()
+{
+	FofiModel::WatchedResult oSaved;
+	FofiModel::WatchedResult oTemp;
+	const auto nRet = runSaves(false, 0, oSaved, oTemp);
+	if (nRet != 0) {
+		return nRet; //---------------------------------------------------------
+	}
+	EXPECT_TRUE(static_cast<int32_t>(oSaved.m_aActions.size()) == s_nTotSaves);
+	for (const auto& oAction : oSaved.m_aActions) {
+		EXPECT_TRUE(oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO);
+		EXPECT_TRUE(oAction.m_nCount == 1);
+		EXPECT_TRUE(oAction.m_nLastTimeUsec == oAction.m_nTimeUsec);
+	}
+	EXPECT_TRUE(static_cast<int32_t>(oTemp.m_aActions.size()) == 2 * s_nTotSaves);
+	EXPECT_TRUE(oSaved.m_nDroppedActions == 0);
+	EXPECT_TRUE(oTemp.m_nDroppedActions == 0);
+	return 0;
+}
+
+int testActionsCollapsedAndDropped()
+{
+	const int32_t nMaxActions = 4;
+	FofiModel::WatchedResult oSaved;
+	FofiModel::WatchedResult oTemp;
+	const auto nRet = runSaves(true, nMaxActions, oSaved, oTemp);
+	if (nRet != 0) {
+		return nRet; //---------------------------------------------------------
+	}
+	// the renames from the same temporary file are identical
+	EXPECT_TRUE(oSaved.m_aActions.size() == 1);
+	const auto& oAction = oSaved.m_aActions[0];
+	EXPECT_TRUE(oAction.m_eAction == INotifierSource::FOFI_ACTION_RENAME_TO);
+	EXPECT_TRUE(oAction.m_nCount == s_nTotSaves);
+	EXPECT_TRUE(oAction.m_nLastTimeUsec > oAction.m_nTimeUsec);
+	EXPECT_TRUE(oSaved.m_nDroppedActions == 0);
+	// create and rename alternate, only the last ones are kept
+	EXPECT_TRUE(static_cast<int32_t>(oTemp.m_aActions.size()) == nMaxActions);
+	EXPECT_TRUE(oTemp.m_nDroppedActions == 2 * s_nTotSaves - nMaxActions);
+	EXPECT_TRUE(oTemp.m_aActions.back().m_eAction == INotifierSource::FOFI_ACTION_RENAME_FROM);
+	// the oldest kept actions were replaced in order
+	EXPECT_TRUE(oTemp.m_aActions.front().m_eAction == INotifierSource::FOFI_ACTION_CREATE);
+	for (int32_t nIdx = 1; nIdx < nMaxActions; ++nIdx) {
+		EXPECT_TRUE(oTemp.m_aActions[nIdx].m_eAction != oTemp.m_aActions[nIdx - 1].m_eAction);
+		EXPECT_TRUE(oTemp.m_aActions[nIdx].m_nTimeUsec >= oTemp.m_aActions[nIdx - 1].m_nTimeUsec);
+	}
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel14 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testActionsNotCompacted());
+	EXECUTE_TEST(fofi::testing::testActionsCollapsedAndDropped());
+	//
+	std::cout << "FofiModel14 Tests successful!" << '\n';
+	return 0;
+}
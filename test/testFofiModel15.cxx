@@ -0,0 +1,237 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel15.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <fstream>
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testSaveAndResume()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/f1.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/f2.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/Sub/s.txt");
+	oTempFileTreeFixture.makeRelPath("B");
+	// the snapshot must not be in the watched zone
+	TempFileTreeFixture oSnapshotDirFixture{};
+	const std::string sSnapshot = oSnapshotDirFixture.m_sTestBasePath + "/fofimon.snap";
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+	const int32_t nTestIntervalMillisec = 5;
+
+	int64_t nFirstDuration = 0;
+	{
+		FofiModel oFofiModel(1000000, 1000000);
+		auto sErr = addZone(oFofiModel, sBasePath, 9999);
+		EXPECT_TRUE(sErr.empty());
+		sErr = oFofiModel.start();
+		EXPECT_TRUE(sErr.empty());
+
+		int32_t nTick = 0;
+		oMainLoop.run([&]() -> bool
+		{
+			if (nTick == 0) {
+				oTempFileTreeFixture.createOrModifyRelFile("A/f1.txt");
+			} else if (nTick == 10) {
+				return false;
+			}
+			++nTick;
+			return true;
+		}, nTestIntervalMillisec);
+
+		oFofiModel.stop();
+		nFirstDuration = oFofiModel.getDuration();
+		sErr = oFofiModel.saveSnapshot(sSnapshot);
+		EXPECT_TRUE(sErr.empty());
+	}
+	// while not watching
+	oTempFileTreeFixture.removeRelFile("A/f2.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/new.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("B/NewDir/n.txt");
+
+	FofiModel oFofiModel(1000000, 1000000);
+	auto sErr = addZone(oFofiModel, sBasePath, 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oFofiModel.resume(sSnapshot);
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(oFofiModel.isWatching());
+	EXPECT_TRUE(oFofiModel.getDuration() >= nFirstDuration);
+
+	int32_t nTick = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			// the watch of the unchanged directory was registered again
+			oTempFileTreeFixture.createOrModifyRelFile("A/Sub/s.txt");
+		} else if (nTick == 10) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, nTestIntervalMillisec);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	// from the first session
+	const auto* p0F1 = findResult(oFofiModel, sBasePath + "/A", "f1.txt");
+	EXPECT_TRUE(p0F1 != nullptr);
+	EXPECT_TRUE(p0F1->m_eResultType == FofiModel::RESULT_MODIFIED);
+	EXPECT_TRUE(p0F1->m_aActions.back().m_nTimeUsec <= nFirstDuration);
+	// while not watching
+	const auto* p0F2 = findResult(oFofiModel, sBasePath + "/A", "f2.txt");
+	EXPECT_TRUE(p0F2 != nullptr);
+	EXPECT_TRUE(p0F2->m_eResultType == FofiModel::RESULT_DELETED);
+	const auto* p0New = findResult(oFofiModel, sBasePath + "/A", "new.txt");
+	EXPECT_TRUE(p0New != nullptr);
+	EXPECT_TRUE(p0New->m_eResultType == FofiModel::RESULT_CREATED);
+	const auto* p0NewDir = findResult(oFofiModel, sBasePath + "/B", "NewDir");
+	EXPECT_TRUE(p0NewDir != nullptr);
+	EXPECT_TRUE(p0NewDir->m_eResultType == FofiModel::RESULT_CREATED);
+	const auto* p0N = findResult(oFofiModel, sBasePath + "/B/NewDir", "n.txt");
+	EXPECT_TRUE(p0N != nullptr);
+	EXPECT_TRUE(p0N->m_eResultType == FofiModel::RESULT_CREATED);
+	// existed at the start of the first session
+	const auto* p0S = findResult(oFofiModel, sBasePath + "/A/Sub", "s.txt");
+	EXPECT_TRUE(p0S != nullptr);
+	EXPECT_TRUE(p0S->m_eResultType == FofiModel::RESULT_MODIFIED);
+	EXPECT_TRUE(p0S->m_aActions.front().m_nTimeUsec >= nFirstDuration);
+	// unchanged
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/A", "Sub") == nullptr);
+	return 0;
+}
+
+int testResumeOtherZones()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.makeRelPath("A");
+	oTempFileTreeFixture.makeRelPath("B");
+	TempFileTreeFixture oSnapshotDirFixture{};
+	const std::string sSnapshot = oSnapshotDirFixture.m_sTestBasePath + "/fofimon.snap";
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	{
+		FofiModel oFofiModel(1000000, 1000000);
+		auto sErr = addZone(oFofiModel, sBasePath + "/A", 9999);
+		EXPECT_TRUE(sErr.empty());
+		sErr = oFofiModel.start();
+		EXPECT_TRUE(sErr.empty());
+		oFofiModel.stop();
+		sErr = oFofiModel.saveSnapshot(sSnapshot);
+		EXPECT_TRUE(sErr.empty());
+	}
+	FofiModel oFofiModel(1000000, 1000000);
+	auto sErr = addZone(oFofiModel, sBasePath + "/B", 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oFofiModel.resume(sSnapshot);
+	EXPECT_TRUE(! sErr.empty());
+	EXPECT_TRUE(! oFofiModel.isWatching());
+	// not a snapshot
+	sErr = oFofiModel.resume(sBasePath + "/A");
+	EXPECT_TRUE(! sErr.empty());
+	EXPECT_TRUE(! oFofiModel.isWatching());
+	// the model is still usable
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	oFofiModel.stop();
+	return 0;
+}
+
+int testResumeCorrupted()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/f1.txt");
+	TempFileTreeFixture oSnapshotDirFixture{};
+	const std::string sSnapshot = oSnapshotDirFixture.m_sTestBasePath + "/fofimon.snap";
+
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	{
+		FofiModel oFofiModel(1000000, 1000000);
+		auto sErr = addZone(oFofiModel, sBasePath, 9999);
+		EXPECT_TRUE(sErr.empty());
+		sErr = oFofiModel.start();
+		EXPECT_TRUE(sErr.empty());
+		oFofiModel.stop();
+		sErr = oFofiModel.saveSnapshot(sSnapshot);
+		EXPECT_TRUE(sErr.empty());
+	}
+	const std::string sData = readFile(sSnapshot);
+	EXPECT_TRUE(sData.size() > 100);
+	const auto oWriteSnapshot = [&](const std::string& sContent)
+	{
+		std::ofstream oOut(sSnapshot, std::ios::binary | std::ios::trunc);
+		oOut << sContent;
+	};
+	const auto oResume = [&]() -> std::string
+	{
+		FofiModel oFofiModel(1000000, 1000000);
+		auto sErr = addZone(oFofiModel, sBasePath, 9999);
+		if (sErr.empty()) {
+			sErr = oFofiModel.resume(sSnapshot);
+		}
+		if (oFofiModel.isWatching()) {
+			oFofiModel.stop();
+		}
+		return sErr;
+	};
+	// a flipped bit after the header
+	std::string sFlipped = sData;
+	sFlipped[sFlipped.size() / 2] ^= 0x10;
+	oWriteSnapshot(sFlipped);
+	EXPECT_TRUE(oResume() == "Snapshot is corrupted");
+	// cut
+	oWriteSnapshot(sData.substr(0, sData.size() - 3));
+	EXPECT_TRUE(! oResume().empty());
+	// intact
+	oWriteSnapshot(sData);
+	EXPECT_TRUE(oResume().empty());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel15 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testSaveAndResume());
+	EXECUTE_TEST(fofi::testing::testResumeOtherZones());
+	EXECUTE_TEST(fofi::testing::testResumeCorrupted());
+	//
+	std::cout << "FofiModel15 Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel16.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <cassert>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+// Directories modified in the last seconds aren't cached
+void setOldModificationTime(const std::string& sPath)
+{
+	struct ::timespec aTimes[2];
+	aTimes[0].tv_sec = 1000000000;
+	aTimes[0].tv_nsec = 0;
+	aTimes[1] = aTimes[0];
+	::utimensat(AT_FDCWD, sPath.c_str(), aTimes, AT_SYMLINK_NOFOLLOW);
+}
+
+int testScanCache()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/f1.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/Sub/s.txt");
+	oTempFileTreeFixture.makeRelPath("B");
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	for (const auto& sRelPath : {"", "/A", "/A/Sub", "/B"}) {
+		setOldModificationTime(sBasePath + sRelPath);
+	}
+	// the cache must not be in the watched zone
+	TempFileTreeFixture oCacheDirFixture{};
+	const std::string sCache = oCacheDirFixture.m_sTestBasePath + "/scan.cache";
+
+	FofiModel oFofiModel(1000000, 1000000);
+	oFofiModel.setScanCache(sCache);
+	FofiModel::DirectoryZone oDZ;
+	oDZ.m_sPath = sBasePath;
+	oDZ.m_nMaxDepth = 9999;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	oFofiModel.stop();
+	const int32_t nFirstCachedScans = oFofiModel.getTotCachedScans();
+
+	// B is read again, the others are taken from the cache
+	oTempFileTreeFixture.createOrModifyRelFile("B/NewDir/n.txt");
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(oFofiModel.getTotCachedScans() > nFirstCachedScans);
+
+	MainLoopFixture oMainLoop;
+	int32_t nTick = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			oTempFileTreeFixture.createOrModifyRelFile("A/Sub/s.txt");
+			oTempFileTreeFixture.createOrModifyRelFile("B/NewDir/n.txt");
+			oTempFileTreeFixture.createOrModifyRelFile("A/f2.txt");
+		} else if (nTick == 10) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, 5);
+
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	// the existing names were taken from the cache
+	const auto* p0S = findResult(oFofiModel, sBasePath + "/A/Sub", "s.txt");
+	EXPECT_TRUE(p0S != nullptr);
+	EXPECT_TRUE(p0S->m_eResultType == FofiModel::RESULT_MODIFIED);
+	const auto* p0N = findResult(oFofiModel, sBasePath + "/B/NewDir", "n.txt");
+	EXPECT_TRUE(p0N != nullptr);
+	EXPECT_TRUE(p0N->m_eResultType == FofiModel::RESULT_MODIFIED);
+	const auto* p0F2 = findResult(oFofiModel, sBasePath + "/A", "f2.txt");
+	EXPECT_TRUE(p0F2 != nullptr);
+	EXPECT_TRUE(p0F2->m_eResultType == FofiModel::RESULT_CREATED);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel16 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testScanCache());
+	//
+	std::cout << "FofiModel16 Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright © 2018-2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModel17.cxx
+ */
+
+#include "fofimodel.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+#include "mainloopfixture.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+bool isWatchedDir(const FofiModel& oFofiModel, const std::string& sPath)
+{
+	const auto& aTWDs = oFofiModel.getToWatchDirectories();
+	const int32_t nTotTWDs = static_cast<int32_t>(aTWDs.size());
+	for (int32_t nTWDIdx = 0; nTWDIdx < nTotTWDs; ++nTWDIdx) {
+		if (aTWDs[nTWDIdx].isFree()) {
+			continue; // for ---
+		}
+		if (oFofiModel.getToWatchDirPath(nTWDIdx) == sPath) {
+			return aTWDs[nTWDIdx].isWatched(); //-------------------------------
+		}
+	}
+	return false;
+}
+
+// Runs the main loop for a few ticks calling oStep in the first
+template<typename STEP>
+void runStep(MainLoopFixture& oMainLoop, STEP oStep)
+{
+	int32_t nTick = 0;
+	oMainLoop.run([&]() -> bool
+	{
+		if (nTick == 0) {
+			oStep();
+		} else if (nTick == 10) {
+			return false;
+		}
+		++nTick;
+		return true;
+	}, 5);
+}
+
+int testAddRemoveZoneWhileWatching()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/a.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("B/b.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("B/Sub/s.txt");
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	auto sErr = addZone(oFofiModel, sBasePath + "/A", 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/B"));
+
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("A/a.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("B/b.txt");
+	});
+	// not watched yet
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/B", "b.txt") == nullptr);
+
+	sErr = addZone(oFofiModel, sBasePath + "/B", 9999);
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/B"));
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/B/Sub"));
+
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("B/Sub/s.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("B/new.txt");
+	});
+	// the result of the other zone was kept
+	const auto* p0A = findResult(oFofiModel, sBasePath + "/A", "a.txt");
+	EXPECT_TRUE((p0A != nullptr) && (p0A->m_eResultType == FofiModel::RESULT_MODIFIED));
+	// existed when the zone was added
+	const auto* p0S = findResult(oFofiModel, sBasePath + "/B/Sub", "s.txt");
+	EXPECT_TRUE((p0S != nullptr) && (p0S->m_eResultType == FofiModel::RESULT_MODIFIED));
+	const auto* p0New = findResult(oFofiModel, sBasePath + "/B", "new.txt");
+	EXPECT_TRUE((p0New != nullptr) && (p0New->m_eResultType == FofiModel::RESULT_CREATED));
+
+	sErr = oFofiModel.removeDirectoryZone(sBasePath + "/B");
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(! oFofiModel.hasDirectoryZone(sBasePath + "/B"));
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/B"));
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/B/Sub"));
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A"));
+	// the gap filler is shared with zone A
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath));
+
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("B/Sub/s2.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("A/a2.txt");
+	});
+	oFofiModel.stop();
+	EXPECT_TRUE(! oFofiModel.hasInconsistencies());
+
+	// the results of the removed zone were kept
+	p0S = findResult(oFofiModel, sBasePath + "/B/Sub", "s.txt");
+	EXPECT_TRUE((p0S != nullptr) && (p0S->m_eResultType == FofiModel::RESULT_MODIFIED));
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/B/Sub", "s2.txt") == nullptr);
+	const auto* p0A2 = findResult(oFofiModel, sBasePath + "/A", "a2.txt");
+	EXPECT_TRUE((p0A2 != nullptr) && (p0A2->m_eResultType == FofiModel::RESULT_CREATED));
+	return 0;
+}
+
+int testRemoveOuterZoneWhileWatching()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/X/Y/y.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/Z/z.txt");
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	auto sErr = addZone(oFofiModel, sBasePath + "/A", 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = addZone(oFofiModel, sBasePath + "/A/X/Y", 0);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A/Z"));
+
+	sErr = oFofiModel.removeDirectoryZone(sBasePath + "/A");
+	EXPECT_TRUE(sErr.empty());
+	// the path to the inner zone is still needed
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A"));
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A/X"));
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A/X/Y"));
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/A/Z"));
+
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("A/X/Y/y.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("A/Z/z.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("A/a.txt");
+	});
+	const auto* p0Y = findResult(oFofiModel, sBasePath + "/A/X/Y", "y.txt");
+	EXPECT_TRUE((p0Y != nullptr) && (p0Y->m_eResultType == FofiModel::RESULT_MODIFIED));
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/A/Z", "z.txt") == nullptr);
+	// a gap filler only sees the pinned names
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/A", "a.txt") == nullptr);
+
+	// the outer zone takes over the directories again
+	sErr = addZone(oFofiModel, sBasePath + "/A", 9999);
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A/Z"));
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("A/Z/z.txt");
+	});
+	oFofiModel.stop();
+	const auto* p0Z = findResult(oFofiModel, sBasePath + "/A/Z", "z.txt");
+	EXPECT_TRUE((p0Z != nullptr) && (p0Z->m_eResultType == FofiModel::RESULT_MODIFIED));
+	return 0;
+}
+
+int testAddRemoveFileWhileWatching()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	oTempFileTreeFixture.createOrModifyRelFile("A/a.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("F/G/f.txt");
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	MainLoopFixture oMainLoop;
+
+	FofiModel oFofiModel(1000000, 1000000);
+	auto sErr = addZone(oFofiModel, sBasePath + "/A", 9999);
+	EXPECT_TRUE(sErr.empty());
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.addToWatchFile(sBasePath + "/F/G/f.txt");
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/F/G"));
+	runStep(oMainLoop, [&]()
+	{
+		oTempFileTreeFixture.createOrModifyRelFile("F/G/f.txt");
+		oTempFileTreeFixture.createOrModifyRelFile("F/G/other.txt");
+	});
+	const auto* p0F = findResult(oFofiModel, sBasePath + "/F/G", "f.txt");
+	EXPECT_TRUE((p0F != nullptr) && (p0F->m_eResultType == FofiModel::RESULT_MODIFIED));
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/F/G", "other.txt") == nullptr);
+
+	sErr = oFofiModel.removeToWatchFile(sBasePath + "/F/G/f.txt");
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/F/G"));
+	EXPECT_TRUE(! isWatchedDir(oFofiModel, sBasePath + "/F"));
+	EXPECT_TRUE(isWatchedDir(oFofiModel, sBasePath + "/A"));
+	oFofiModel.stop();
+	// kept
+	p0F = findResult(oFofiModel, sBasePath + "/F/G", "f.txt");
+	EXPECT_TRUE(p0F != nullptr);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel17 Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testAddRemoveZoneWhileWatching());
+	EXECUTE_TEST(fofi::testing::testRemoveOuterZoneWhileWatching());
+	EXECUTE_TEST(fofi::testing::testAddRemoveFileWhileWatching());
+	//
+	std::cout << "FofiModel17 Tests successful!" << '\n';
+	return 0;
+}
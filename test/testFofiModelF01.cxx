@@ -97,7 +97,7 @@ int testMissingDeleteDir()
 	EXPECT_TRUE(oResult0.m_aActions.size() == 1);
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_DELETE);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_DELETED);
-	EXPECT_TRUE(oResult0.m_sName == "xx1.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx1.txt");
 	EXPECT_TRUE(! oResult0.m_bIsDir);
 	EXPECT_TRUE(! oResult0.m_bInconsistent);
 
@@ -106,7 +106,7 @@ int testMissingDeleteDir()
 	EXPECT_TRUE(oResult1.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 //std::cout << "oResult1.m_eResultType=" << static_cast<int32_t>(oResult1.m_eResultType) << '\n';
 	EXPECT_TRUE(oResult1.m_eResultType == FofiModel::RESULT_MODIFIED);
-	EXPECT_TRUE(oResult1.m_sName == "B");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult1) == "B");
 	EXPECT_TRUE(oResult1.m_bIsDir);
 	EXPECT_TRUE(oResult1.m_bInconsistent);
 
@@ -174,7 +174,7 @@ int testCreatePresentFile()
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_MODIFY);
 	EXPECT_TRUE(oResult0.m_aActions[1].m_eAction == INotifierSource::FOFI_ACTION_CREATE);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_MODIFIED);
-	EXPECT_TRUE(oResult0.m_sName == "xx1.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx1.txt");
 	EXPECT_TRUE(! oResult0.m_bIsDir);
 	EXPECT_TRUE(oResult0.m_bInconsistent);
 
@@ -242,7 +242,7 @@ int testDeleteDeletedFile()
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_DELETE);
 	EXPECT_TRUE(oResult0.m_aActions[1].m_eAction == INotifierSource::FOFI_ACTION_DELETE);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_DELETED);
-	EXPECT_TRUE(oResult0.m_sName == "xx1.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx1.txt");
 	EXPECT_TRUE(! oResult0.m_bIsDir);
 	EXPECT_TRUE(oResult0.m_bInconsistent);
 
@@ -310,7 +310,7 @@ int testModifyDeletedFile()
 	EXPECT_TRUE(oResult0.m_aActions[0].m_eAction == INotifierSource::FOFI_ACTION_DELETE);
 	EXPECT_TRUE(oResult0.m_aActions[1].m_eAction == INotifierSource::FOFI_ACTION_MODIFY);
 	EXPECT_TRUE(oResult0.m_eResultType == FofiModel::RESULT_MODIFIED);
-	EXPECT_TRUE(oResult0.m_sName == "xx1.txt");
+	EXPECT_TRUE(oFofiModel.getWatchedResultName(oResult0) == "xx1.txt");
 	EXPECT_TRUE(! oResult0.m_bIsDir);
 	EXPECT_TRUE(oResult0.m_bInconsistent);
 
@@ -0,0 +1,486 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testFofiModelF02.cxx
+ */
+
+#include "fofimodel.h"
+#include "util.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+
+#include "fakesource.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testEventLatencies()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createRelDir("A");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+	EXPECT_TRUE(oFofiModel.isLatencyTracking());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	int32_t nTotEmitted = 0;
+	oFofiModel.m_oWatchedResultActionSignal.connect([&](const FofiModel::WatchedResult& /*oWR*/)
+	{
+		++nTotEmitted;
+	});
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE(n_A_TWDIdx >= 0);
+
+	const int64_t nQueuedNsec = 5 * 1000 * 1000;
+	oTempFileTreeFixture.createOrModifyRelFile("A/xx1.txt");
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+	oFD.m_nReadTimeNsec = Util::getNowTimeNanoseconds() - nQueuedNsec;
+	p0Source->callback(oFD);
+	}
+	EXPECT_TRUE(nTotEmitted == 1);
+
+	const auto& oQueued = oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_CREATE, FofiModel::LATENCY_STAGE_QUEUED);
+	const auto& oProcessed = oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_CREATE, FofiModel::LATENCY_STAGE_PROCESSED);
+	const auto& oEmitted = oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_CREATE, FofiModel::LATENCY_STAGE_EMITTED);
+	EXPECT_TRUE(oQueued.getTotCount() == 1);
+	EXPECT_TRUE(oQueued.getMax() >= nQueuedNsec);
+	EXPECT_TRUE(oProcessed.getTotCount() == 1);
+	EXPECT_TRUE(oProcessed.getMax() < oEmitted.getMax());
+	EXPECT_TRUE(oEmitted.getTotCount() == 1);
+	EXPECT_TRUE(oEmitted.getMax() >= nQueuedNsec);
+	// the other actions are untouched
+	EXPECT_TRUE(oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_MODIFY, FofiModel::LATENCY_STAGE_QUEUED).getTotCount() == 0);
+
+	// the source stamps the events without read time
+	oTempFileTreeFixture.createOrModifyRelFile("A/xx1.txt");
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_MODIFY;
+	p0Source->callback(oFD);
+	}
+	// a created file stays created
+	EXPECT_TRUE(nTotEmitted == 1);
+	const auto& oModifyQueued = oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_MODIFY, FofiModel::LATENCY_STAGE_QUEUED);
+	EXPECT_TRUE(oModifyQueued.getTotCount() == 1);
+	EXPECT_TRUE(oModifyQueued.getMax() < nQueuedNsec);
+
+	oFofiModel.setLatencyTracking(false);
+	oTempFileTreeFixture.removeRelFile("A/xx1.txt");
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_DELETE;
+	p0Source->callback(oFD);
+	}
+	EXPECT_TRUE(nTotEmitted == 2);
+	EXPECT_TRUE(oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_DELETE, FofiModel::LATENCY_STAGE_QUEUED).getTotCount() == 0);
+	EXPECT_TRUE(oFofiModel.getLatencyHistogram(INotifierSource::FOFI_ACTION_DELETE, FofiModel::LATENCY_STAGE_EMITTED).getTotCount() == 0);
+
+	oFofiModel.stop();
+	// cleared by start
+	oFofiModel.setLatencyTracking(true);
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(oQueued.getTotCount() == 0);
+	EXPECT_TRUE(oModifyQueued.getTotCount() == 0);
+	oFofiModel.stop();
+	return 0;
+}
+
+int testMetrics()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createRelDir("A");
+	oTempFileTreeFixture.createRelDir("B");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	FofiModel::Filter oFilter;
+	oFilter.m_sFilter = "xx.o";
+	oDZ1.m_aFileExcludeFilters.push_back(oFilter);
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	auto oMetrics = oFofiModel.getMetrics();
+	// base, A, B and the ancestors of base
+	EXPECT_TRUE(oMetrics.m_nTotWatches >= 3);
+	EXPECT_TRUE(oMetrics.m_nTotToWatchDirs >= 3);
+	EXPECT_TRUE(oMetrics.m_nTotExistingToWatchDirs >= 3);
+	EXPECT_TRUE(oMetrics.m_oFailedWatches.empty());
+	EXPECT_TRUE(oMetrics.m_nTotResults == 0);
+	EXPECT_TRUE(oMetrics.m_nModelBytes > 0);
+	EXPECT_TRUE(oMetrics.m_nSetupCpuUsec >= 0);
+
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE(n_A_TWDIdx >= 0);
+
+	oTempFileTreeFixture.createOrModifyRelFile("A/xx1.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/xx.o");
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+	p0Source->callback(oFD);
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_MODIFY;
+	p0Source->callback(oFD);
+	oFD.m_sName = "xx.o";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+	p0Source->callback(oFD);
+	}
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_bOverflow = true;
+	p0Source->callback(oFD);
+	}
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_RENAME_FROM;
+	oFD.m_nRenameCookie = 77;
+	p0Source->callback(oFD);
+	}
+	oMetrics = oFofiModel.getMetrics();
+	EXPECT_TRUE(oMetrics.m_aTotEvents[INotifierSource::FOFI_ACTION_CREATE] == 2);
+	EXPECT_TRUE(oMetrics.m_aTotEvents[INotifierSource::FOFI_ACTION_MODIFY] == 1);
+	EXPECT_TRUE(oMetrics.m_aTotEvents[INotifierSource::FOFI_ACTION_DELETE] == 0);
+	EXPECT_TRUE(oMetrics.m_aTotEvents[INotifierSource::FOFI_ACTION_RENAME_FROM] == 1);
+	EXPECT_TRUE(oMetrics.m_nTotFilteredOutEvents == 1);
+	EXPECT_TRUE(oMetrics.m_nTotOverflows == 1);
+	EXPECT_TRUE(oMetrics.m_nTotOpenMoves == 1);
+	EXPECT_TRUE(oMetrics.m_nTotResults == 1);
+
+	oFofiModel.stop();
+	oMetrics = oFofiModel.getMetrics();
+	EXPECT_TRUE(oMetrics.m_nTotWatches == 0);
+	EXPECT_TRUE(oMetrics.m_nTotOpenMoves == 0);
+	EXPECT_TRUE(oMetrics.m_nWatchCpuUsec >= 0);
+	// kept after stop
+	EXPECT_TRUE(oMetrics.m_nTotOverflows == 1);
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	oMetrics = oFofiModel.getMetrics();
+	EXPECT_TRUE(oMetrics.m_aTotEvents[INotifierSource::FOFI_ACTION_CREATE] == 0);
+	EXPECT_TRUE(oMetrics.m_nTotOverflows == 0);
+	oFofiModel.stop();
+	return 0;
+}
+
+int testRegexExcludeFilter()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createRelDir("A");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	FofiModel::Filter oFilter;
+	oFilter.m_eFilterType = FofiModel::FILTER_REGEX;
+	oFilter.m_sFilter = ".*\\.o";
+	oDZ1.m_aFileExcludeFilters.push_back(oFilter);
+	oFilter.m_sFilter = ".*~";
+	oDZ1.m_aFileExcludeFilters.push_back(oFilter);
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE(n_A_TWDIdx >= 0);
+
+	for (const auto& sName : {"xx.o", "xx.c", "xx.c~", "xxo"}) {
+		oTempFileTreeFixture.createOrModifyRelFile(std::string{"A/"} + sName);
+		INotifierSource::FofiData oFD;
+		oFD.m_nTag = n_A_TWDIdx;
+		oFD.m_sName = sName;
+		oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+		p0Source->callback(oFD);
+	}
+	const auto oMetrics = oFofiModel.getMetrics();
+	EXPECT_TRUE(oMetrics.m_nTotFilteredOutEvents == 2);
+	EXPECT_TRUE(oMetrics.m_nTotResults == 2);
+
+	oFofiModel.stop();
+	return 0;
+}
+
+int testRegexIncludeAndPathFilters()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createRelDir("A/src");
+	oTempFileTreeFixture.createRelDir("A/tmp12");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	{
+		// an invalid regex is reported instead of silently matching nothing
+		FofiModel::DirectoryZone oDZ;
+		oDZ.m_sPath = sBasePath;
+		FofiModel::Filter oFilter;
+		oFilter.m_eFilterType = FofiModel::FILTER_REGEX;
+		oFilter.m_sFilter = "[a";
+		oDZ.m_aFileIncludeFilters.push_back(oFilter);
+		EXPECT_TRUE(! oFofiModel.addDirectoryZone(std::move(oDZ)).empty());
+	}
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	FofiModel::Filter oFilter;
+	oFilter.m_eFilterType = FofiModel::FILTER_REGEX;
+	oFilter.m_sFilter = ".*\\.c";
+	oDZ1.m_aFileIncludeFilters.push_back(oFilter);
+	oFilter.m_sFilter = ".*/A/tmp[0-9]*";
+	oFilter.bApplyToPathName = true;
+	oDZ1.m_aSubDirExcludeFilters.push_back(oFilter);
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE(n_A_TWDIdx >= 0);
+	EXPECT_TRUE(oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A/src") >= 0);
+	EXPECT_TRUE(oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A/tmp12") < 0);
+
+	for (const auto& sName : {"xx.c", "xx.h", "yy.c", "xxc"}) {
+		oTempFileTreeFixture.createOrModifyRelFile(std::string{"A/"} + sName);
+		INotifierSource::FofiData oFD;
+		oFD.m_nTag = n_A_TWDIdx;
+		oFD.m_sName = sName;
+		oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+		p0Source->callback(oFD);
+	}
+	const auto oMetrics = oFofiModel.getMetrics();
+	EXPECT_TRUE(oMetrics.m_nTotFilteredOutEvents == 2);
+	EXPECT_TRUE(oMetrics.m_nTotResults == 2);
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/A", "xx.c") != nullptr);
+	EXPECT_TRUE(findResult(oFofiModel, sBasePath + "/A", "yy.c") != nullptr);
+
+	oFofiModel.stop();
+	return 0;
+}
+
+int testTraceInconsistency()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createRelDir("A");
+	oTempFileTreeFixture.createOrModifyRelFile("A/xx1.txt");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+	oFofiModel.setTraceCapacity(1000);
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE(n_A_TWDIdx >= 0);
+	{
+	// the file existed at start: a delete event was missed
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "xx1.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+	p0Source->callback(oFD);
+	}
+	EXPECT_TRUE(oFofiModel.hasInconsistencies());
+	oFofiModel.stop();
+
+	const auto oDump = oFofiModel.getTraceDump("Testing");
+	const auto& aRecords = oDump.m_aRecords;
+	EXPECT_TRUE(aRecords.size() >= 5);
+	EXPECT_TRUE(aRecords.front().m_nEvent == TraceRing::TRACE_EVENT_START);
+	EXPECT_TRUE(aRecords.back().m_nEvent == TraceRing::TRACE_EVENT_STOP);
+	const auto itInconsistent = std::find_if(aRecords.begin(), aRecords.end(), [](const TraceRing::Record& oRecord)
+	{
+		return (oRecord.m_nEvent == TraceRing::TRACE_EVENT_INCONSISTENT);
+	});
+	EXPECT_TRUE(itInconsistent != aRecords.end());
+	EXPECT_TRUE(itInconsistent->m_nTag == n_A_TWDIdx);
+	EXPECT_TRUE(itInconsistent->m_aArgs[2] == INotifierSource::FOFI_ACTION_CREATE);
+	// preceded by the inotify event that caused it
+	EXPECT_TRUE(std::prev(itInconsistent)->m_nEvent == TraceRing::TRACE_EVENT_INOTIFY);
+	EXPECT_TRUE(oDump.m_oNames.at(itInconsistent->m_nNameId) == "xx1.txt");
+	EXPECT_TRUE(oDump.m_oDirPaths.at(n_A_TWDIdx) == sBasePath + "/A");
+	const auto nTotWatchesAdded = std::count_if(aRecords.begin(), aRecords.end(), [](const TraceRing::Record& oRecord)
+	{
+		return (oRecord.m_nEvent == TraceRing::TRACE_EVENT_WATCH_ADDED);
+	});
+	// base, A and the ancestors of base
+	EXPECT_TRUE(nTotWatchesAdded >= 2);
+	return 0;
+}
+int testResultCounts()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+
+	oTempFileTreeFixture.createOrModifyRelFile("A/a.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/m.txt");
+	oTempFileTreeFixture.createRelDir("B");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+
+	const int32_t nTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	const int32_t n_B_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/B");
+	EXPECT_TRUE((nTWDIdx >= 0) && (n_A_TWDIdx >= 0) && (n_B_TWDIdx >= 0));
+
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "m.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_MODIFY;
+	p0Source->callback(oFD);
+	// not a transition
+	p0Source->callback(oFD);
+	oFD.m_sName = "n.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_CREATE;
+	p0Source->callback(oFD);
+	}
+	const auto& aToWatchDirs = oFofiModel.getToWatchDirectories();
+	EXPECT_TRUE(aToWatchDirs[n_A_TWDIdx].getResultCounts().m_nModified == 1);
+	EXPECT_TRUE(aToWatchDirs[n_A_TWDIdx].getResultCounts().m_nCreated == 1);
+	EXPECT_TRUE(aToWatchDirs[nTWDIdx].getResultCounts().getTotal() == 0);
+	EXPECT_TRUE(aToWatchDirs[nTWDIdx].getSubtreeResultCounts().getTotal() == 2);
+	{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = n_A_TWDIdx;
+	oFD.m_sName = "n.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_DELETE;
+	p0Source->callback(oFD);
+	oFD.m_sName = "a.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_RENAME_FROM;
+	oFD.m_nRenameCookie = 77;
+	p0Source->callback(oFD);
+	oFD.m_nTag = n_B_TWDIdx;
+	oFD.m_sName = "b.txt";
+	oFD.m_eAction = INotifierSource::FOFI_ACTION_RENAME_TO;
+	p0Source->callback(oFD);
+	}
+	const FofiModel::ResultCounts& oCountsA = aToWatchDirs[n_A_TWDIdx].getSubtreeResultCounts();
+	EXPECT_TRUE(oCountsA.m_nCreated == 0);
+	EXPECT_TRUE(oCountsA.m_nModified == 1);
+	EXPECT_TRUE(oCountsA.m_nDeleted == 1);
+	EXPECT_TRUE(oCountsA.m_nTemporary == 1);
+	EXPECT_TRUE(aToWatchDirs[n_B_TWDIdx].getResultCounts().m_nCreated == 1);
+	const FofiModel::ResultCounts& oCounts = aToWatchDirs[nTWDIdx].getSubtreeResultCounts();
+	EXPECT_TRUE(oCounts.m_nCreated == 1);
+	EXPECT_TRUE(oCounts.m_nModified == 1);
+	EXPECT_TRUE(oCounts.m_nDeleted == 1);
+	EXPECT_TRUE(oCounts.m_nTemporary == 1);
+	// the ancestors of the zone base path
+	const int32_t nRootTWDIdx = oFofiModel.getRootToWatchDirectoriesIdx();
+	EXPECT_TRUE(aToWatchDirs[nRootTWDIdx].getSubtreeResultCounts().getTotal() == 4);
+	EXPECT_TRUE(oFofiModel.getTotalResultCounts().getTotal() == 4);
+
+	oFofiModel.stop();
+	// kept after stop
+	EXPECT_TRUE(oFofiModel.getTotalResultCounts().getTotal() == 4);
+	sErr = oFofiModel.start();
+	EXPECT_TRUE(sErr.empty());
+	EXPECT_TRUE(oFofiModel.getTotalResultCounts().getTotal() == 0);
+	oFofiModel.stop();
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "FofiModel Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testEventLatencies());
+	EXECUTE_TEST(fofi::testing::testMetrics());
+	EXECUTE_TEST(fofi::testing::testRegexExcludeFilter());
+	EXECUTE_TEST(fofi::testing::testRegexIncludeAndPathFilters());
+	EXECUTE_TEST(fofi::testing::testTraceInconsistency());
+	EXECUTE_TEST(fofi::testing::testResultCounts());
+	//
+	std::cout << "FofiModel Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testJsonWriter.cxx
+ */
+
+#include "jsonwriter.h"
+
+#include "testingcommon.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+void writeTwoValues(JsonWriter& oWriter)
+{
+	oWriter.beginSequence();
+	oWriter.beginObject();
+	oWriter.key("Empty");
+	oWriter.beginArray();
+	oWriter.endArray();
+	oWriter.key("List");
+	oWriter.beginArray();
+	oWriter.value(std::numeric_limits<int64_t>::min());
+	oWriter.beginObject();
+	oWriter.key("Yes");
+	oWriter.value(true);
+	oWriter.endObject();
+	oWriter.endArray();
+	oWriter.key("Name");
+	oWriter.value("a\"b\\c\nd\x01");
+	oWriter.endObject();
+	oWriter.value(std::string{"Ünïcödé"});
+	oWriter.endSequence();
+}
+
+int testPretty()
+{
+	std::ostringstream oOut;
+	JsonWriter oWriter(oOut, false);
+	writeTwoValues(oWriter);
+	// same as nlohmann::json::dump(2) of each value
+	const std::string sExpected =
+			"[\n"
+			"{\n"
+			"  \"Empty\": [],\n"
+			"  \"List\": [\n"
+			"    -9223372036854775808,\n"
+			"    {\n"
+			"      \"Yes\": true\n"
+			"    }\n"
+			"  ],\n"
+			"  \"Name\": \"a\\\"b\\\\c\\nd\\u0001\"\n"
+			"}\n"
+			",\n"
+			"\"Ünïcödé\"\n"
+			"]\n";
+	EXPECT_TRUE(oOut.str() == sExpected);
+	return 0;
+}
+int testNDJSon()
+{
+	std::ostringstream oOut;
+	JsonWriter oWriter(oOut, true);
+	writeTwoValues(oWriter);
+	const std::string sExpected =
+			"{\"Empty\":[],\"List\":[-9223372036854775808,{\"Yes\":true}],\"Name\":\"a\\\"b\\\\c\\nd\\u0001\"}\n"
+			"\"Ünïcödé\"\n";
+	EXPECT_TRUE(oOut.str() == sExpected);
+	return 0;
+}
+int testEmptySequence()
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, false);
+		oWriter.beginSequence();
+		oWriter.endSequence();
+	}
+	EXPECT_TRUE(oOut.str() == "[\n]\n");
+	return 0;
+}
+int testContinueSequence()
+{
+	std::ostringstream oFirst;
+	std::ostringstream oSecond;
+	{
+		JsonWriter oWriter(oFirst, false);
+		oWriter.beginSequence();
+		oWriter.value(1);
+		oWriter.flush();
+	}
+	{
+		JsonWriter oWriter(oSecond, false);
+		oWriter.continueSequence();
+		oWriter.value(2);
+		oWriter.endSequence();
+	}
+	EXPECT_TRUE(oFirst.str() + oSecond.str() == "[\n1\n,\n2\n]\n");
+	return 0;
+}
+int testFileNames()
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, true);
+		oWriter.beginSequence();
+		oWriter.fileNameValue("/tmp/x\xff" "y.txt");
+		oWriter.fileNameValue("/tmp/ok.txt");
+		oWriter.endSequence();
+	}
+	const std::string sOut = oOut.str();
+	// invalid sequences are replaced
+	EXPECT_TRUE(::g_utf8_validate(sOut.data(), sOut.size(), nullptr));
+	EXPECT_TRUE(sOut.find("/tmp/x") == 1);
+	EXPECT_TRUE(sOut.find("\"/tmp/ok.txt\"\n") != std::string::npos);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "JsonWriter Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testPretty());
+	EXECUTE_TEST(fofi::testing::testNDJSon());
+	EXECUTE_TEST(fofi::testing::testEmptySequence());
+	EXECUTE_TEST(fofi::testing::testContinueSequence());
+	EXECUTE_TEST(fofi::testing::testFileNames());
+	//
+	std::cout << "JsonWriter Tests successful!" << '\n';
+	return 0;
+}
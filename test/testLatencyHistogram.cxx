@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testLatencyHistogram.cxx
+ */
+
+#include "latencyhistogram.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testEmpty()
+{
+	LatencyHistogram oHistogram;
+	EXPECT_TRUE(oHistogram.getTotCount() == 0);
+	EXPECT_TRUE(oHistogram.getMax() == 0);
+	EXPECT_TRUE(oHistogram.getMean() == 0);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(50.0) == 0);
+	return 0;
+}
+int testSmallValuesAreExact()
+{
+	LatencyHistogram oHistogram;
+	for (int64_t nValue = 0; nValue < 32; ++nValue) {
+		oHistogram.record(nValue);
+	}
+	EXPECT_TRUE(oHistogram.getTotCount() == 32);
+	EXPECT_TRUE(oHistogram.getMax() == 31);
+	EXPECT_TRUE(oHistogram.getMean() == 15);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(0.0) == 0);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(50.0) == 15);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(100.0) == 31);
+	return 0;
+}
+int testPercentiles()
+{
+	LatencyHistogram oHistogram;
+	for (int64_t nValue = 1; nValue <= 100000; ++nValue) {
+		oHistogram.record(nValue * 1000);
+	}
+	EXPECT_TRUE(oHistogram.getTotCount() == 100000);
+	EXPECT_TRUE(oHistogram.getMax() == 100000 * 1000);
+	EXPECT_TRUE(oHistogram.getMean() == 50000500);
+	const double aPercentiles[] = {1.0, 50.0, 90.0, 99.0, 99.9};
+	for (const double fPercentile : aPercentiles) {
+		const int64_t nExpected = static_cast<int64_t>(fPercentile * 1000) * 1000;
+		const int64_t nValue = oHistogram.getValueAtPercentile(fPercentile);
+		// never below the real value, at most 1/16 above (the rank might be rounded up by one)
+		EXPECT_TRUE(nValue >= nExpected);
+		EXPECT_TRUE(nValue <= (nExpected + 1000) + (nExpected + 1000) / 16);
+	}
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(100.0) == oHistogram.getMax());
+	return 0;
+}
+int testClampAndMerge()
+{
+	LatencyHistogram oHistogram;
+	oHistogram.record(-5);
+	oHistogram.record(LatencyHistogram::getMaxTrackable() + 1000);
+	EXPECT_TRUE(oHistogram.getTotCount() == 2);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(50.0) == 0);
+	EXPECT_TRUE(oHistogram.getMax() == LatencyHistogram::getMaxTrackable());
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(100.0) == LatencyHistogram::getMaxTrackable());
+
+	LatencyHistogram oOther;
+	oOther.record(1000);
+	oOther.record(1000);
+	oHistogram.merge(oOther);
+	EXPECT_TRUE(oHistogram.getTotCount() == 4);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(50.0) >= 1000);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(50.0) <= 1000 + 1000 / 16);
+	EXPECT_TRUE(oHistogram.getMax() == LatencyHistogram::getMaxTrackable());
+
+	oHistogram.clear();
+	EXPECT_TRUE(oHistogram.getTotCount() == 0);
+	EXPECT_TRUE(oHistogram.getMax() == 0);
+	EXPECT_TRUE(oHistogram.getValueAtPercentile(99.0) == 0);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "LatencyHistogram Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testEmpty());
+	EXECUTE_TEST(fofi::testing::testSmallValuesAreExact());
+	EXECUTE_TEST(fofi::testing::testPercentiles());
+	EXECUTE_TEST(fofi::testing::testClampAndMerge());
+	//
+	std::cout << "LatencyHistogram Tests successful!" << '\n';
+	return 0;
+}
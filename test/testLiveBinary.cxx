@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testLiveBinary.cxx
+ */
+
+#include "livebinary.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+std::string writeSampleEvents()
+{
+	std::ostringstream oOut;
+	LiveBinaryWriter oWriter;
+	assert(! oWriter.isHeaderWritten());
+	oWriter.writeHeader(oOut, 1234567);
+	assert(oWriter.isHeaderWritten());
+	LiveBinary::Event oEvent;
+	oEvent.m_eAction = LiveBinary::LIVE_ACTION_CREATE;
+	oEvent.m_eResultType = LiveBinary::LIVE_RESULT_CREATED;
+	oEvent.m_nTimeUsec = 10;
+	oWriter.writeEvent(oOut, oEvent, "/tmp/a.txt", nullptr);
+	oEvent.m_eAction = LiveBinary::LIVE_ACTION_MODIFY;
+	oEvent.m_nTimeUsec = 20;
+	oEvent.m_nCount = 3;
+	oWriter.writeEvent(oOut, oEvent, "/tmp/a.txt", nullptr);
+	oEvent.m_eAction = LiveBinary::LIVE_ACTION_RENAME_FROM;
+	oEvent.m_eResultType = LiveBinary::LIVE_RESULT_TEMPORARY;
+	oEvent.m_nFlags = LiveBinary::LIVE_FLAG_DIR | LiveBinary::LIVE_FLAG_IMMEDIATE;
+	oEvent.m_nTimeUsec = 30;
+	oEvent.m_nCount = 1;
+	oWriter.writeEvent(oOut, oEvent, "/tmp/a.txt", nullptr);
+	oWriter.writeEvent(oOut, oEvent, "/tmp/d", nullptr);
+	const std::string sOther = "/tmp/e";
+	oWriter.writeEvent(oOut, oEvent, "/tmp/d", &sOther);
+	assert(oWriter.getTotPaths() == 3);
+	return oOut.str();
+}
+
+int testRoundTrip()
+{
+	const std::string sData = writeSampleEvents();
+	LiveBinaryReader oReader;
+	oReader.feed(sData.data(), sData.size());
+	LiveBinary::Event oEvent;
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(oReader.getStartWallTimeUsec() == 1234567);
+	EXPECT_TRUE(oEvent.m_eAction == LiveBinary::LIVE_ACTION_CREATE);
+	EXPECT_TRUE(oEvent.m_eResultType == LiveBinary::LIVE_RESULT_CREATED);
+	EXPECT_TRUE(oEvent.m_nFlags == 0);
+	EXPECT_TRUE(oEvent.m_nTimeUsec == 10);
+	EXPECT_TRUE(oEvent.m_nPathId == 0);
+	EXPECT_TRUE(oEvent.m_nOtherPathId == -1);
+	EXPECT_TRUE(oEvent.m_nCount == 1);
+	EXPECT_TRUE(oReader.getPath(0) == "/tmp/a.txt");
+	EXPECT_TRUE(oReader.getPath(-1).empty());
+
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(oEvent.m_eAction == LiveBinary::LIVE_ACTION_MODIFY);
+	EXPECT_TRUE(oEvent.m_nPathId == 0);
+	EXPECT_TRUE(oEvent.m_nCount == 3);
+
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_FROM);
+	EXPECT_TRUE(oEvent.m_eResultType == LiveBinary::LIVE_RESULT_TEMPORARY);
+	EXPECT_TRUE(oEvent.m_nFlags == (LiveBinary::LIVE_FLAG_DIR | LiveBinary::LIVE_FLAG_IMMEDIATE));
+	EXPECT_TRUE(oEvent.m_nTimeUsec == 30);
+
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(oEvent.m_nPathId == 1);
+	EXPECT_TRUE(oReader.getPath(1) == "/tmp/d");
+
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(oEvent.m_nPathId == 1);
+	EXPECT_TRUE(oEvent.m_nOtherPathId == 2);
+	EXPECT_TRUE(oReader.getPath(2) == "/tmp/e");
+
+	EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_NEED_DATA);
+	EXPECT_TRUE(oReader.getError().empty());
+	return 0;
+}
+int testFeedByteByByte()
+{
+	// like following a file that is being written
+	const std::string sData = writeSampleEvents();
+	LiveBinaryReader oReader;
+	LiveBinary::Event oEvent;
+	int32_t nTotEvents = 0;
+	for (const char c : sData) {
+		oReader.feed(&c, 1);
+		LiveBinaryReader::READ_RESULT eResult;
+		while ((eResult = oReader.next(oEvent)) == LiveBinaryReader::READ_RESULT_EVENT) {
+			++nTotEvents;
+		}
+		EXPECT_TRUE(eResult == LiveBinaryReader::READ_RESULT_NEED_DATA);
+	}
+	EXPECT_TRUE(nTotEvents == 5);
+	EXPECT_TRUE(oReader.getPath(2) == "/tmp/e");
+	return 0;
+}
+int testReadFile()
+{
+	const std::string sPathName = makeTempPathName("fofimon-testlivebinary-");
+	const std::string sData = writeSampleEvents();
+	{
+		std::ofstream oOut(sPathName, std::ios::binary);
+		oOut.write(sData.data(), sData.size());
+	}
+	LiveBinaryReader oReader;
+	EXPECT_TRUE(oReader.open(sPathName).empty());
+	EXPECT_TRUE(oReader.readFile() == static_cast<int64_t>(sData.size()));
+	LiveBinary::Event oEvent;
+	int32_t nTotEvents = 0;
+	while (oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT) {
+		++nTotEvents;
+	}
+	EXPECT_TRUE(nTotEvents == 5);
+	EXPECT_TRUE(oReader.readFile() == 0);
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testBoundedPaths()
+{
+	std::ostringstream oOut;
+	LiveBinaryWriter oWriter(4);
+	oWriter.writeHeader(oOut, 0);
+	LiveBinary::Event oEvent;
+	std::vector<std::string> aExpected;
+	for (int32_t nCount = 0; nCount < 20; ++nCount) {
+		// a path used by every other event should stay defined
+		const std::string sPath = (((nCount % 2) == 0) ? std::string{"/tmp/hot"} : "/tmp/f" + std::to_string(nCount));
+		const std::string sOther = "/tmp/o" + std::to_string(nCount);
+		oWriter.writeEvent(oOut, oEvent, sPath, &sOther);
+		aExpected.push_back(sPath);
+		aExpected.push_back(sOther);
+		EXPECT_TRUE(oWriter.getTotPaths() <= 4);
+	}
+	EXPECT_TRUE(oWriter.getTotEvictedPaths() > 0);
+	const std::string sData = oOut.str();
+	LiveBinaryReader oReader;
+	oReader.feed(sData.data(), sData.size());
+	int32_t nHotPathId = -1;
+	size_t nIdx = 0;
+	while (oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_EVENT) {
+		EXPECT_TRUE(nIdx + 1 < aExpected.size());
+		EXPECT_TRUE(oEvent.m_nPathId < 4);
+		EXPECT_TRUE(oEvent.m_nOtherPathId < 4);
+		EXPECT_TRUE(oEvent.m_nPathId != oEvent.m_nOtherPathId);
+		EXPECT_TRUE(oReader.getPath(oEvent.m_nPathId) == aExpected[nIdx]);
+		EXPECT_TRUE(oReader.getPath(oEvent.m_nOtherPathId) == aExpected[nIdx + 1]);
+		if (aExpected[nIdx] == "/tmp/hot") {
+			EXPECT_TRUE((nHotPathId < 0) || (nHotPathId == oEvent.m_nPathId));
+			nHotPathId = oEvent.m_nPathId;
+		}
+		nIdx += 2;
+	}
+	EXPECT_TRUE(nIdx == aExpected.size());
+	EXPECT_TRUE(oReader.getError().empty());
+	return 0;
+}
+int testErrors()
+{
+	{
+		LiveBinaryReader oReader;
+		EXPECT_TRUE(! oReader.open("/tmp/fofimon-testlivebinary-nonexistent/file.fofilive").empty());
+	}
+	{
+		LiveBinaryReader oReader;
+		const std::string sData = "NOTALIVEFILE-WITH-ENOUGH-BYTES";
+		oReader.feed(sData.data(), sData.size());
+		LiveBinary::Event oEvent;
+		EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_ERROR);
+		EXPECT_TRUE(! oReader.getError().empty());
+	}
+	{
+		// corrupt record size after the header
+		std::string sData = writeSampleEvents();
+		sData[24] = 0;
+		sData[25] = 0;
+		sData[26] = 0;
+		sData[27] = 0;
+		LiveBinaryReader oReader;
+		oReader.feed(sData.data(), sData.size());
+		LiveBinary::Event oEvent;
+		EXPECT_TRUE(oReader.next(oEvent) == LiveBinaryReader::READ_RESULT_ERROR);
+	}
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "LiveBinary Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testRoundTrip());
+	EXECUTE_TEST(fofi::testing::testFeedByteByByte());
+	EXECUTE_TEST(fofi::testing::testReadFile());
+	EXECUTE_TEST(fofi::testing::testBoundedPaths());
+	EXECUTE_TEST(fofi::testing::testErrors());
+	//
+	std::cout << "LiveBinary Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testLiveWriter.cxx
+ */
+
+#include "livewriter.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testAllWrittenOnClose()
+{
+	const std::string sPathName = makeTempPathName("fofimon-testlivewriter-");
+	LiveWriter oWriter;
+	LiveWriter::Config oConfig;
+	oConfig.m_nFlushIntervalMillisec = 100000;
+	oConfig.m_nFlushBytes = 100;
+	// so that the producer has to wait
+	oConfig.m_nQueueEntries = 3;
+	auto sError = oWriter.open(sPathName, oConfig);
+	EXPECT_TRUE(sError.empty());
+	EXPECT_TRUE(oWriter.isOpen());
+	std::string sExpected;
+	for (int32_t nEntry = 0; nEntry < 10000; ++nEntry) {
+		oWriter.entry() << "Entry " << nEntry << '\n';
+		oWriter.commit();
+		sExpected += "Entry " + std::to_string(nEntry) + "\n";
+	}
+	// ignored
+	oWriter.commit();
+	sError = oWriter.close();
+	EXPECT_TRUE(sError.empty());
+	EXPECT_TRUE(! oWriter.isOpen());
+	EXPECT_TRUE(oWriter.getTotWrittenBytes() == static_cast<int64_t>(sExpected.size()));
+	EXPECT_TRUE(readFile(sPathName) == sExpected);
+	// the file is truncated when reopened
+	oConfig.m_eFsyncPolicy = LiveWriter::FSYNC_POLICY_FLUSH;
+	sError = oWriter.open(sPathName, oConfig);
+	EXPECT_TRUE(sError.empty());
+	oWriter.entry() << "Again" << '\n';
+	oWriter.commit();
+	sError = oWriter.close();
+	EXPECT_TRUE(sError.empty());
+	EXPECT_TRUE(readFile(sPathName) == "Again\n");
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testFlushInterval()
+{
+	const std::string sPathName = makeTempPathName("fofimon-testlivewriter-");
+	LiveWriter oWriter;
+	LiveWriter::Config oConfig;
+	oConfig.m_nFlushIntervalMillisec = 10;
+	oConfig.m_nFlushBytes = 1000000;
+	auto sError = oWriter.open(sPathName, oConfig);
+	EXPECT_TRUE(sError.empty());
+	oWriter.entry() << "Single" << '\n';
+	oWriter.commit();
+	// written even though the buffer isn't full
+	int32_t nWaitMillisec = 0;
+	while ((oWriter.getTotWrittenBytes() == 0) && (nWaitMillisec < 5000)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		nWaitMillisec += 5;
+	}
+	EXPECT_TRUE(oWriter.getTotWrittenBytes() == 7);
+	EXPECT_TRUE(readFile(sPathName) == "Single\n");
+	sError = oWriter.close();
+	EXPECT_TRUE(sError.empty());
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testErrors()
+{
+	LiveWriter oWriter;
+	const auto sError = oWriter.open("/tmp/fofimon-testlivewriter-nonexistent/dir/file.txt", LiveWriter::Config{});
+	EXPECT_TRUE(! sError.empty());
+	EXPECT_TRUE(! oWriter.isOpen());
+	// not open: discarded
+	oWriter.entry() << "Lost" << '\n';
+	oWriter.commit();
+	EXPECT_TRUE(oWriter.close().empty());
+
+	LiveWriter::FSYNC_POLICY eFsyncPolicy = LiveWriter::FSYNC_POLICY_NONE;
+	EXPECT_TRUE(LiveWriter::getFsyncPolicyFromName("flush", eFsyncPolicy));
+	EXPECT_TRUE(eFsyncPolicy == LiveWriter::FSYNC_POLICY_FLUSH);
+	EXPECT_TRUE(LiveWriter::getFsyncPolicyFromName("close", eFsyncPolicy));
+	EXPECT_TRUE(eFsyncPolicy == LiveWriter::FSYNC_POLICY_CLOSE);
+	EXPECT_TRUE(! LiveWriter::getFsyncPolicyFromName("always", eFsyncPolicy));
+	EXPECT_TRUE(eFsyncPolicy == LiveWriter::FSYNC_POLICY_CLOSE);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "LiveWriter Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testAllWrittenOnClose());
+	EXECUTE_TEST(fofi::testing::testFlushInterval());
+	EXECUTE_TEST(fofi::testing::testErrors());
+	//
+	std::cout << "LiveWriter Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testPathTrie.cxx
+ */
+
+#include "pathtrie.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testInsertFind()
+{
+	PathTrie oTrie;
+	EXPECT_TRUE(oTrie.empty());
+	EXPECT_TRUE(oTrie.find("/") == -1);
+	EXPECT_TRUE(oTrie.insert("/A/BB", 0));
+	EXPECT_TRUE(oTrie.insert("/A", 1));
+	EXPECT_TRUE(oTrie.insert("/", 2));
+	EXPECT_TRUE(! oTrie.insert("/A/BB", 3));
+	EXPECT_TRUE(! oTrie.empty());
+	EXPECT_TRUE(oTrie.find("/A/BB") == 0);
+	EXPECT_TRUE(oTrie.find("/A") == 1);
+	EXPECT_TRUE(oTrie.find("/") == 2);
+	EXPECT_TRUE(oTrie.find("/A/B") == -1);
+	EXPECT_TRUE(oTrie.find("/A/BB/C") == -1);
+	EXPECT_TRUE(oTrie.find("") == -1);
+	oTrie.clear();
+	EXPECT_TRUE(oTrie.empty());
+	EXPECT_TRUE(oTrie.find("/A") == -1);
+	return 0;
+}
+int testFindAncestors()
+{
+	PathTrie oTrie;
+	oTrie.insert("/", 0);
+	oTrie.insert("/A", 1);
+	oTrie.insert("/A/B/C", 2);
+	oTrie.insert("/A/B/CX", 3);
+	std::vector<PathTrie::Ancestor> aAncestors;
+	oTrie.findAncestors("/A/B/C/D", aAncestors);
+	EXPECT_TRUE(aAncestors.size() == 3);
+	EXPECT_TRUE((aAncestors[0].m_nValue == 2) && (aAncestors[0].m_nDepth == 1));
+	EXPECT_TRUE((aAncestors[1].m_nValue == 1) && (aAncestors[1].m_nDepth == 3));
+	EXPECT_TRUE((aAncestors[2].m_nValue == 0) && (aAncestors[2].m_nDepth == 4));
+
+	oTrie.findAncestors("/A/B/C", aAncestors);
+	EXPECT_TRUE(aAncestors.size() == 3);
+	EXPECT_TRUE((aAncestors[0].m_nValue == 2) && (aAncestors[0].m_nDepth == 0));
+
+	// not a component prefix
+	oTrie.findAncestors("/A/B/CXY", aAncestors);
+	EXPECT_TRUE(aAncestors.size() == 2);
+	EXPECT_TRUE((aAncestors[0].m_nValue == 1) && (aAncestors[0].m_nDepth == 2));
+
+	oTrie.findAncestors("/", aAncestors);
+	EXPECT_TRUE(aAncestors.size() == 1);
+	EXPECT_TRUE((aAncestors[0].m_nValue == 0) && (aAncestors[0].m_nDepth == 0));
+
+	oTrie.clear();
+	oTrie.findAncestors("/A/B/C", aAncestors);
+	EXPECT_TRUE(aAncestors.empty());
+	return 0;
+}
+int testHasPathOrDescendants()
+{
+	PathTrie oTrie;
+	EXPECT_TRUE(! oTrie.hasPathOrDescendants("/"));
+	oTrie.insert("/A/B/C", 0);
+	EXPECT_TRUE(oTrie.hasPathOrDescendants("/"));
+	EXPECT_TRUE(oTrie.hasPathOrDescendants("/A"));
+	EXPECT_TRUE(oTrie.hasPathOrDescendants("/A/B/C"));
+	EXPECT_TRUE(! oTrie.hasPathOrDescendants("/A/B/C/D"));
+	EXPECT_TRUE(! oTrie.hasPathOrDescendants("/A/BB"));
+	EXPECT_TRUE(! oTrie.hasPathOrDescendants(""));
+	oTrie.clear();
+	EXPECT_TRUE(! oTrie.hasPathOrDescendants("/A"));
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "PathTrie Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testInsertFind());
+	EXECUTE_TEST(fofi::testing::testFindAncestors());
+	EXECUTE_TEST(fofi::testing::testHasPathOrDescendants());
+	//
+	std::cout << "PathTrie Tests successful!" << '\n';
+	return 0;
+}
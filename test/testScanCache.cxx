@@ -0,0 +1,155 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testScanCache.cxx
+ */
+
+#include "scancache.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+// well in the past
+static constexpr int64_t s_nOldTimeNsec = 1000000000LL * 1000000000LL;
+
+ScanCache::DirStamp makeStamp(uint64_t nInode, int64_t nMTimeNsec)
+{
+	ScanCache::DirStamp oStamp;
+	oStamp.m_nDevice = 7;
+	oStamp.m_nInode = nInode;
+	oStamp.m_nMTimeNsec = nMTimeNsec;
+	oStamp.m_nCTimeNsec = nMTimeNsec + 5;
+	return oStamp;
+}
+
+int testLookupStore()
+{
+	ScanCache oCache;
+	std::vector<ScanCache::Entry> aEntries;
+	EXPECT_TRUE(! oCache.lookup("/A", makeStamp(1, s_nOldTimeNsec), aEntries));
+	oCache.store("/A", makeStamp(1, s_nOldTimeNsec), {{"zz", false}, {"Sub", true}, {"abc", false}});
+	EXPECT_TRUE(oCache.lookup("/A", makeStamp(1, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(aEntries.size() == 3);
+	EXPECT_TRUE((aEntries[0].m_sName == "Sub") && aEntries[0].m_bIsDir);
+	EXPECT_TRUE((aEntries[1].m_sName == "abc") && ! aEntries[1].m_bIsDir);
+	EXPECT_TRUE(aEntries[2].m_sName == "zz");
+	// modified
+	EXPECT_TRUE(! oCache.lookup("/A", makeStamp(1, s_nOldTimeNsec + 1), aEntries));
+	// replaced by another directory
+	EXPECT_TRUE(! oCache.lookup("/A", makeStamp(2, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(oCache.getTotHits() == 1);
+	EXPECT_TRUE(oCache.getTotMisses() == 3);
+	// modified just now, a change in the same timestamp tick wouldn't be noticed
+	oCache.store("/B", makeStamp(3, std::numeric_limits<int64_t>::max() / 2), {{"x", false}});
+	EXPECT_TRUE(! oCache.lookup("/B", makeStamp(3, std::numeric_limits<int64_t>::max() / 2), aEntries));
+	oCache.clear();
+	EXPECT_TRUE(! oCache.lookup("/A", makeStamp(1, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(oCache.getTotHits() == 0);
+	return 0;
+}
+int testSaveLoad()
+{
+	const std::string sPathName = makeTempPathName("fofimon-testscancache-");
+	{
+		ScanCache oCache;
+		oCache.store("/home/user/project", makeStamp(1, s_nOldTimeNsec), {{"main.cc", false}, {"main.h", false}, {"build", true}});
+		oCache.store("/home/user/project/build", makeStamp(2, s_nOldTimeNsec), {});
+		oCache.store("/home/user/projects", makeStamp(3, s_nOldTimeNsec), {{"a", false}});
+		EXPECT_TRUE(oCache.save(sPathName).empty());
+	}
+	ScanCache oCache;
+	EXPECT_TRUE(oCache.load(sPathName).empty());
+	std::vector<ScanCache::Entry> aEntries;
+	EXPECT_TRUE(oCache.lookup("/home/user/project", makeStamp(1, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(aEntries.size() == 3);
+	EXPECT_TRUE((aEntries[0].m_sName == "build") && aEntries[0].m_bIsDir);
+	EXPECT_TRUE((aEntries[1].m_sName == "main.cc") && ! aEntries[1].m_bIsDir);
+	EXPECT_TRUE((aEntries[2].m_sName == "main.h") && ! aEntries[2].m_bIsDir);
+	EXPECT_TRUE(oCache.lookup("/home/user/project/build", makeStamp(2, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(aEntries.empty());
+	// only the used listings are saved
+	EXPECT_TRUE(oCache.save(sPathName).empty());
+	EXPECT_TRUE(oCache.load(sPathName).empty());
+	EXPECT_TRUE(oCache.lookup("/home/user/project", makeStamp(1, s_nOldTimeNsec), aEntries));
+	EXPECT_TRUE(! oCache.lookup("/home/user/projects", makeStamp(3, s_nOldTimeNsec), aEntries));
+	::unlink(sPathName.c_str());
+	return 0;
+}
+int testCorrupt()
+{
+	const std::string sPathName = makeTempPathName("fofimon-testscancache-");
+	{
+		ScanCache oCache;
+		oCache.store("/A", makeStamp(1, s_nOldTimeNsec), {{"f", false}});
+		EXPECT_TRUE(oCache.save(sPathName).empty());
+	}
+	// change the name of the entry
+	std::string sData;
+	{
+		std::ifstream oIn(sPathName, std::ios::binary);
+		sData.assign(std::istreambuf_iterator<char>(oIn), std::istreambuf_iterator<char>());
+	}
+	const auto nPos = sData.rfind('f');
+	EXPECT_TRUE(nPos != std::string::npos);
+	sData[nPos] = 'g';
+	{
+		std::ofstream oOut(sPathName, std::ios::binary | std::ios::trunc);
+		oOut << sData;
+	}
+	ScanCache oCache;
+	EXPECT_TRUE(! oCache.load(sPathName).empty());
+	std::vector<ScanCache::Entry> aEntries;
+	EXPECT_TRUE(! oCache.lookup("/A", makeStamp(1, s_nOldTimeNsec), aEntries));
+	// truncated
+	{
+		std::ofstream oOut(sPathName, std::ios::binary | std::ios::trunc);
+		oOut << sData.substr(0, sData.size() / 2);
+	}
+	EXPECT_TRUE(! oCache.load(sPathName).empty());
+	::unlink(sPathName.c_str());
+	// missing
+	EXPECT_TRUE(! oCache.load(sPathName).empty());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "ScanCache Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testLookupStore());
+	EXECUTE_TEST(fofi::testing::testSaveLoad());
+	EXECUTE_TEST(fofi::testing::testCorrupt());
+	//
+	std::cout << "ScanCache Tests successful!" << '\n';
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testShmRing.cxx
+ */
+
+#include "shmring.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+std::string getTestRingPathName()
+{
+	// absolute so that the test doesn't depend on /dev/shm
+	return "/tmp/fofimon-testshmring-" + std::to_string(::getpid());
+}
+LiveBinary::Event makeEvent(int64_t nTimeUsec)
+{
+	LiveBinary::Event oEvent;
+	oEvent.m_eAction = LiveBinary::LIVE_ACTION_MODIFY;
+	oEvent.m_eResultType = LiveBinary::LIVE_RESULT_MODIFIED;
+	oEvent.m_nTimeUsec = nTimeUsec;
+	return oEvent;
+}
+
+int testPublishAndRead()
+{
+	const std::string sPathName = getTestRingPathName();
+	ShmRing oRing;
+	ShmRing::Config oConfig;
+	oConfig.m_nTotSlots = 8;
+	EXPECT_TRUE(oRing.create(sPathName, oConfig, 777).empty());
+	EXPECT_TRUE(oRing.isOpen());
+	oRing.publish(makeEvent(1), "/tmp/before", nullptr);
+
+	ShmRingReader oOldestReader;
+	EXPECT_TRUE(oOldestReader.open(sPathName, true).empty());
+	EXPECT_TRUE(oOldestReader.getStartWallTimeUsec() == 777);
+	ShmRingReader oNewReader;
+	EXPECT_TRUE(oNewReader.open(sPathName, false).empty());
+
+	LiveBinary::Event oEvent;
+	std::string sPath;
+	std::string sOtherPath;
+	EXPECT_TRUE(oNewReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_NONE);
+	EXPECT_TRUE(oOldestReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_EVENT);
+	EXPECT_TRUE(sPath == "/tmp/before");
+	EXPECT_TRUE(oEvent.m_nTimeUsec == 1);
+
+	LiveBinary::Event oRename = makeEvent(2);
+	oRename.m_eAction = LiveBinary::LIVE_ACTION_RENAME_TO;
+	oRename.m_nFlags = LiveBinary::LIVE_FLAG_DIR;
+	oRename.m_nCount = 2;
+	const std::string sFrom = "/tmp/from";
+	oRing.publish(oRename, "/tmp/to", &sFrom);
+	for (ShmRingReader* p0Reader : {&oOldestReader, &oNewReader}) {
+		EXPECT_TRUE(p0Reader->next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_EVENT);
+		EXPECT_TRUE(oEvent.m_eAction == LiveBinary::LIVE_ACTION_RENAME_TO);
+		EXPECT_TRUE(oEvent.m_eResultType == LiveBinary::LIVE_RESULT_MODIFIED);
+		EXPECT_TRUE(oEvent.m_nFlags == LiveBinary::LIVE_FLAG_DIR);
+		EXPECT_TRUE(oEvent.m_nTimeUsec == 2);
+		EXPECT_TRUE(oEvent.m_nCount == 2);
+		EXPECT_TRUE(sPath == "/tmp/to");
+		EXPECT_TRUE(sOtherPath == "/tmp/from");
+		EXPECT_TRUE(p0Reader->next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_NONE);
+	}
+	oRing.close();
+	EXPECT_TRUE(! oRing.isOpen());
+	// the file is removed but the readers still see the ring
+	EXPECT_TRUE(::access(sPathName.c_str(), F_OK) != 0);
+	EXPECT_TRUE(oNewReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_CLOSED);
+	return 0;
+}
+int testLag()
+{
+	const std::string sPathName = getTestRingPathName();
+	ShmRing oRing;
+	ShmRing::Config oConfig;
+	oConfig.m_nTotSlots = 5; // rounded up to 8
+	EXPECT_TRUE(oRing.create(sPathName, oConfig, 0).empty());
+	ShmRingReader oReader;
+	EXPECT_TRUE(oReader.open(sPathName, false).empty());
+	for (int32_t nCount = 0; nCount < 20; ++nCount) {
+		oRing.publish(makeEvent(nCount), "/tmp/f" + std::to_string(nCount), nullptr);
+	}
+	LiveBinary::Event oEvent;
+	std::string sPath;
+	std::string sOtherPath;
+	EXPECT_TRUE(oReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_LAGGED);
+	EXPECT_TRUE(oReader.getTotLost() == 12);
+	for (int32_t nCount = 12; nCount < 20; ++nCount) {
+		EXPECT_TRUE(oReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_EVENT);
+		EXPECT_TRUE(oEvent.m_nTimeUsec == nCount);
+		EXPECT_TRUE(sPath == "/tmp/f" + std::to_string(nCount));
+	}
+	EXPECT_TRUE(oReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_NONE);
+	oRing.close();
+	return 0;
+}
+int testTruncated()
+{
+	const std::string sPathName = getTestRingPathName();
+	ShmRing oRing;
+	ShmRing::Config oConfig;
+	oConfig.m_nTotSlots = 4;
+	oConfig.m_nSlotSize = 128;
+	EXPECT_TRUE(oRing.create(sPathName, oConfig, 0).empty());
+	ShmRingReader oReader;
+	EXPECT_TRUE(oReader.open(sPathName, false).empty());
+	const std::string sLong(200, 'x');
+	oRing.publish(makeEvent(1), "/tmp/short", &sLong);
+	LiveBinary::Event oEvent;
+	std::string sPath;
+	std::string sOtherPath;
+	EXPECT_TRUE(oReader.next(oEvent, sPath, sOtherPath) == ShmRingReader::READ_RESULT_EVENT);
+	EXPECT_TRUE((oEvent.m_nFlags & ShmRing::LIVE_FLAG_TRUNCATED) != 0);
+	EXPECT_TRUE(sPath == "/tmp/short");
+	EXPECT_TRUE(sOtherPath.size() < sLong.size());
+	EXPECT_TRUE(sOtherPath == sLong.substr(0, sOtherPath.size()));
+	oRing.close();
+	return 0;
+}
+int testConcurrentReader()
+{
+	const std::string sPathName = getTestRingPathName();
+	ShmRing oRing;
+	ShmRing::Config oConfig;
+	oConfig.m_nTotSlots = 64;
+	EXPECT_TRUE(oRing.create(sPathName, oConfig, 0).empty());
+	ShmRingReader oReader;
+	EXPECT_TRUE(oReader.open(sPathName, false).empty());
+	const int32_t nTotEvents = 200000;
+	int64_t nTotRead = 0;
+	bool bInOrder = true;
+	std::thread oReaderThread([&]()
+	{
+		LiveBinary::Event oEvent;
+		std::string sPath;
+		std::string sOtherPath;
+		int64_t nLastTime = -1;
+		while (true) {
+			const auto eResult = oReader.next(oEvent, sPath, sOtherPath);
+			if (eResult == ShmRingReader::READ_RESULT_CLOSED) {
+				break; // while ----
+			}
+			if (eResult != ShmRingReader::READ_RESULT_EVENT) {
+				continue; // while ----
+			}
+			// a torn copy would mismatch
+			bInOrder = bInOrder && (oEvent.m_nTimeUsec > nLastTime) && (sPath == "/p" + std::to_string(oEvent.m_nTimeUsec));
+			nLastTime = oEvent.m_nTimeUsec;
+			++nTotRead;
+		}
+	});
+	for (int32_t nCount = 0; nCount < nTotEvents; ++nCount) {
+		oRing.publish(makeEvent(nCount), "/p" + std::to_string(nCount), nullptr);
+	}
+	oRing.close();
+	oReaderThread.join();
+	EXPECT_TRUE(bInOrder);
+	EXPECT_TRUE(nTotRead + oReader.getTotLost() == nTotEvents);
+	return 0;
+}
+int testErrors()
+{
+	ShmRingReader oReader;
+	EXPECT_TRUE(! oReader.open("/tmp/fofimon-testshmring-nonexistent/ring", false).empty());
+	ShmRing oRing;
+	EXPECT_TRUE(! oRing.create("/tmp/fofimon-testshmring-nonexistent/ring", ShmRing::Config{}, 0).empty());
+	EXPECT_TRUE(! oRing.isOpen());
+	// not open: ignored
+	oRing.publish(makeEvent(1), "/tmp/lost", nullptr);
+	EXPECT_TRUE(ShmRing::getPathName("fofimon") == "/dev/shm/fofimon");
+	EXPECT_TRUE(ShmRing::getPathName("/tmp/ring") == "/tmp/ring");
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "ShmRing Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testPublishAndRead());
+	EXECUTE_TEST(fofi::testing::testLag());
+	EXECUTE_TEST(fofi::testing::testTruncated());
+	EXECUTE_TEST(fofi::testing::testConcurrentReader());
+	EXECUTE_TEST(fofi::testing::testErrors());
+	//
+	std::cout << "ShmRing Tests successful!" << '\n';
+	return 0;
+}
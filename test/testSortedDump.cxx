@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testSortedDump.cxx
+ */
+
+#include "sorteddump.h"
+
+#include "testingcommon.h"
+#include "testingutil.h"
+#include "tempfiletreefixture.h"
+
+#include "fakesource.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+void sendEvent(FakeSource* p0Source, int32_t nTWDIdx, const std::string& sName, INotifierSource::FOFI_ACTION eAction, bool bIsDir)
+{
+	INotifierSource::FofiData oFD;
+	oFD.m_nTag = nTWDIdx;
+	oFD.m_sName = sName;
+	oFD.m_eAction = eAction;
+	oFD.m_bIsDir = bIsDir;
+	p0Source->callback(oFD);
+}
+// Returns what SortedDump::write() wrote
+std::string writeToString(SortedDump& oSortedDump)
+{
+	int nFD = -1;
+	const std::string sPathName = makeTempPathName("fofimon-testsorteddump-", nFD);
+	const auto sError = oSortedDump.write(nFD, 1000000);
+	assert(sError.empty());
+	::close(nFD);
+	const std::string sContent = readFile(sPathName);
+	::unlink(sPathName.c_str());
+	return sContent;
+}
+
+int testComparePaths()
+{
+	EXPECT_TRUE(SortedDump::comparePaths("/a/b", "/a/b") == 0);
+	EXPECT_TRUE(SortedDump::comparePaths("/a", "/a/b") < 0);
+	EXPECT_TRUE(SortedDump::comparePaths("/a/b/c", "/a/b.txt") < 0);
+	EXPECT_TRUE(SortedDump::comparePaths("/a/b.txt", "/a/b/c") > 0);
+	EXPECT_TRUE(SortedDump::comparePaths("/a/bc", "/a/b/z") > 0);
+	EXPECT_TRUE(SortedDump::comparePaths("/", "/a") < 0);
+	return 0;
+}
+int testGroups()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	oTempFileTreeFixture.createOrModifyRelFile("x.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/y.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/B/z.txt");
+	oTempFileTreeFixture.createOrModifyRelFile("A/B/a.txt");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 3;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	oFofiModel.start();
+
+	const int32_t nTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	const int32_t n_AB_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A/B");
+	EXPECT_TRUE((nTWDIdx >= 0) && (n_A_TWDIdx >= 0) && (n_AB_TWDIdx >= 0));
+
+	sendEvent(p0Source, n_AB_TWDIdx, "z.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, nTWDIdx, "x.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, n_A_TWDIdx, "y.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, n_AB_TWDIdx, "a.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+	sendEvent(p0Source, n_A_TWDIdx, "B", INotifierSource::FOFI_ACTION_ATTRIB, true);
+	sendEvent(p0Source, nTWDIdx, "A.txt", INotifierSource::FOFI_ACTION_MODIFY, false);
+
+	oFofiModel.stop();
+
+	SortedDump::Config oConfig;
+	oConfig.m_nTotThreads = 1;
+	SortedDump oSortedDump(oFofiModel, oConfig);
+	EXPECT_TRUE(oSortedDump.sort().empty());
+	EXPECT_TRUE(oSortedDump.getTotResults() == 6);
+	EXPECT_TRUE(oSortedDump.getTotGroups() == 3);
+	const std::string sExpected =
+			"Dir: " + sBasePath + "/  (results: 2, subtree: 6)\n"
+			"M " + sBasePath + "/A.txt\n"
+			"M " + sBasePath + "/x.txt\n"
+			"Dir: " + sBasePath + "/A/  (results: 2, subtree: 4)\n"
+			"M " + sBasePath + "/A/B/\n"
+			"M " + sBasePath + "/A/y.txt\n"
+			"Dir: " + sBasePath + "/A/B/  (results: 2, subtree: 2)\n"
+			"M " + sBasePath + "/A/B/a.txt\n"
+			"M " + sBasePath + "/A/B/z.txt\n";
+	EXPECT_TRUE(writeToString(oSortedDump) == sExpected);
+
+	oConfig.m_bJSon = true;
+	oConfig.m_bNDJSon = true;
+	SortedDump oJSonDump(oFofiModel, oConfig);
+	EXPECT_TRUE(oJSonDump.sort().empty());
+	std::istringstream oLines(writeToString(oJSonDump));
+	std::string sLine;
+	int32_t nTotLines = 0;
+	while (std::getline(oLines, sLine)) {
+		++nTotLines;
+		if (nTotLines == 1) {
+			EXPECT_TRUE(sLine.find("{\"Directory\":\"" + sBasePath + "\",\"Results\":[{") == 0);
+			EXPECT_TRUE(sLine.find("\"Subtree results\":6}") != std::string::npos);
+		}
+	}
+	EXPECT_TRUE(nTotLines == 3);
+	return 0;
+}
+int testParallel()
+{
+	TempFileTreeFixture oTempFileTreeFixture{};
+	const auto& sBasePath = oTempFileTreeFixture.m_sTestBasePath;
+	oTempFileTreeFixture.createRelDir("A");
+
+	FofiModel oFofiModel(std::make_unique<FakeSource>(0), 1000000, 1000000, false);
+	FakeSource* p0Source = static_cast<FakeSource*>(oFofiModel.getSource());
+
+	FofiModel::DirectoryZone oDZ1;
+	oDZ1.m_sPath = sBasePath;
+	oDZ1.m_nMaxDepth = 1;
+	auto sErr = oFofiModel.addDirectoryZone(std::move(oDZ1));
+	EXPECT_TRUE(sErr.empty());
+
+	oFofiModel.start();
+
+	const int32_t nTWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath);
+	const int32_t n_A_TWDIdx = oTempFileTreeFixture.findToWatchPath(oFofiModel, sBasePath + "/A");
+	EXPECT_TRUE((nTWDIdx >= 0) && (n_A_TWDIdx >= 0));
+	const int32_t nTotFiles = 40000;
+	for (int32_t nFile = 0; nFile < nTotFiles; ++nFile) {
+		// descending so that the insertion order isn't already sorted
+		const std::string sName = "f" + std::to_string(nTotFiles - nFile);
+		sendEvent(p0Source, (((nFile % 3) == 0) ? n_A_TWDIdx : nTWDIdx), sName, INotifierSource::FOFI_ACTION_CREATE, false);
+	}
+
+	oFofiModel.stop();
+
+	SortedDump::Config oConfig;
+	oConfig.m_nTotThreads = 1;
+	SortedDump oSerialDump(oFofiModel, oConfig);
+	EXPECT_TRUE(oSerialDump.sort().empty());
+	EXPECT_TRUE(oSerialDump.getTotResults() == nTotFiles);
+	const std::string sSerial = writeToString(oSerialDump);
+
+	oConfig.m_nTotThreads = 4;
+	SortedDump oParallelDump(oFofiModel, oConfig);
+	EXPECT_TRUE(oParallelDump.sort().empty());
+	EXPECT_TRUE(oParallelDump.getTotUsedThreads() == 4);
+	EXPECT_TRUE(oParallelDump.getTotGroups() == 2);
+	const std::string sParallel = writeToString(oParallelDump);
+	EXPECT_TRUE(sParallel == sSerial);
+
+	std::istringstream oLines(sParallel);
+	std::string sLine;
+	std::string sLastPath;
+	int32_t nTotLines = 0;
+	while (std::getline(oLines, sLine)) {
+		++nTotLines;
+		if (sLine.substr(0, 4) == "Dir:") {
+			sLastPath.clear();
+			continue; // while ---
+		}
+		const std::string sPath = sLine.substr(2);
+		EXPECT_TRUE(sLastPath < sPath);
+		sLastPath = sPath;
+	}
+	EXPECT_TRUE(nTotLines == nTotFiles + 2);
+
+	oConfig.m_bJSon = true;
+	SortedDump oJSonDump(oFofiModel, oConfig);
+	EXPECT_TRUE(oJSonDump.sort().empty());
+	const std::string sJSon = writeToString(oJSonDump);
+	// the chunks written by different threads form one array
+	EXPECT_TRUE(sJSon.substr(0, 2) == "[\n");
+	EXPECT_TRUE(sJSon.substr(sJSon.size() - 2) == "]\n");
+	EXPECT_TRUE(sJSon.find("}\n,\n{") != std::string::npos);
+	EXPECT_TRUE(sJSon.find("}\n{") == std::string::npos);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "SortedDump Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testComparePaths());
+	EXECUTE_TEST(fofi::testing::testGroups());
+	EXECUTE_TEST(fofi::testing::testParallel());
+	//
+	std::cout << "SortedDump Tests successful!" << '\n';
+	return 0;
+}
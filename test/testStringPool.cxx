@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testStringPool.cxx
+ */
+
+#include "stringpool.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testInternFind()
+{
+	StringPool oPool;
+	EXPECT_TRUE(oPool.size() == 0);
+	EXPECT_TRUE(oPool.find("A") == -1);
+	const int32_t nA = oPool.intern("A");
+	const int32_t nEmpty = oPool.intern("");
+	const int32_t nAB = oPool.intern("AB");
+	EXPECT_TRUE((nA >= 0) && (nEmpty >= 0) && (nAB >= 0));
+	EXPECT_TRUE((nA != nEmpty) && (nA != nAB) && (nEmpty != nAB));
+	EXPECT_TRUE(oPool.intern("A") == nA);
+	EXPECT_TRUE(oPool.intern("AB") == nAB);
+	EXPECT_TRUE(oPool.size() == 3);
+	EXPECT_TRUE(oPool.find("A") == nA);
+	EXPECT_TRUE(oPool.find("") == nEmpty);
+	EXPECT_TRUE(oPool.find("ABC") == -1);
+	EXPECT_TRUE(std::strcmp(oPool.get(nA), "A") == 0);
+	EXPECT_TRUE(std::strcmp(oPool.get(nEmpty), "") == 0);
+	EXPECT_TRUE(std::strcmp(oPool.get(nAB), "AB") == 0);
+	oPool.clear();
+	EXPECT_TRUE(oPool.size() == 0);
+	EXPECT_TRUE(oPool.find("A") == -1);
+	return 0;
+}
+int testManyStrings()
+{
+	StringPool oPool;
+	const int32_t nTot = 100000;
+	const char* p0First = oPool.get(oPool.intern("f0.txt"));
+	for (int32_t nIdx = 1; nIdx < nTot; ++nIdx) {
+		EXPECT_TRUE(oPool.intern("f" + std::to_string(nIdx) + ".txt") == nIdx);
+	}
+	// a string longer than an arena chunk
+	const std::string sLong(1024 * 1024, 'x');
+	const int32_t nLong = oPool.intern(sLong);
+	EXPECT_TRUE(oPool.get(nLong) == sLong);
+	EXPECT_TRUE(oPool.size() == nTot + 1);
+	for (int32_t nIdx = 0; nIdx < nTot; ++nIdx) {
+		const std::string sStr = "f" + std::to_string(nIdx) + ".txt";
+		EXPECT_TRUE(oPool.find(sStr) == nIdx);
+		EXPECT_TRUE(oPool.get(nIdx) == sStr);
+	}
+	// the strings are never moved
+	EXPECT_TRUE(oPool.get(0) == p0First);
+	EXPECT_TRUE(oPool.getAllocatedBytes() > static_cast<int64_t>(sLong.size()));
+	return 0;
+}
+int testRelease()
+{
+	StringPool oPool;
+	const int32_t nTot = 5000;
+	for (int32_t nIdx = 0; nIdx < nTot; ++nIdx) {
+		EXPECT_TRUE(oPool.intern("f" + std::to_string(nIdx) + ".txt") == nIdx);
+	}
+	const int64_t nAllocated = oPool.getAllocatedBytes();
+	// release every other string, the others must still be found
+	for (int32_t nIdx = 0; nIdx < nTot; nIdx += 2) {
+		oPool.release(nIdx);
+	}
+	EXPECT_TRUE(oPool.getTotReleased() == nTot / 2);
+	EXPECT_TRUE(oPool.size() == nTot);
+	for (int32_t nIdx = 0; nIdx < nTot; ++nIdx) {
+		const std::string sStr = "f" + std::to_string(nIdx) + ".txt";
+		if ((nIdx % 2) == 0) {
+			EXPECT_TRUE(oPool.isReleased(nIdx));
+			EXPECT_TRUE(oPool.find(sStr) == -1);
+			EXPECT_TRUE(std::strcmp(oPool.get(nIdx), "") == 0);
+		} else {
+			EXPECT_TRUE(! oPool.isReleased(nIdx));
+			EXPECT_TRUE(oPool.find(sStr) == nIdx);
+			EXPECT_TRUE(oPool.get(nIdx) == sStr);
+		}
+	}
+	// new strings of the same sizes reuse the ids and the bytes
+	for (int32_t nIdx = 0; nIdx < nTot; nIdx += 2) {
+		const int32_t nId = oPool.intern("g" + std::to_string(nIdx) + ".txt");
+		EXPECT_TRUE((nId < nTot) && ((nId % 2) == 0));
+	}
+	EXPECT_TRUE(oPool.getTotReleased() == 0);
+	EXPECT_TRUE(oPool.size() == nTot);
+	EXPECT_TRUE(oPool.getAllocatedBytes() <= nAllocated + static_cast<int64_t>(nTot * sizeof(int32_t)));
+	for (int32_t nIdx = 0; nIdx < nTot; nIdx += 2) {
+		const std::string sStr = "g" + std::to_string(nIdx) + ".txt";
+		const int32_t nId = oPool.find(sStr);
+		EXPECT_TRUE((nId >= 0) && (oPool.get(nId) == sStr));
+	}
+	// rebuilding a pool with the same ids
+	const int32_t nReleased = oPool.addReleased();
+	EXPECT_TRUE(nReleased == nTot);
+	EXPECT_TRUE(oPool.isReleased(nReleased));
+	EXPECT_TRUE(oPool.append("i.txt") == nTot + 1);
+	EXPECT_TRUE(oPool.append("i.txt") == nTot + 1);
+	EXPECT_TRUE(oPool.intern("h.txt") == nReleased);
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "StringPool Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testInternFind());
+	EXECUTE_TEST(fofi::testing::testManyStrings());
+	EXECUTE_TEST(fofi::testing::testRelease());
+	//
+	std::cout << "StringPool Tests successful!" << '\n';
+	return 0;
+}
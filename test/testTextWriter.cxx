@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testTextWriter.cxx
+ */
+
+#include "textwriter.h"
+
+#include "jsonwriter.h"
+#include "util.h"
+
+#include "testingcommon.h"
+
+#include <glibmm.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <cassert>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testLines()
+{
+	std::ostringstream oOut;
+	{
+		TextWriter oWriter(oOut);
+		oWriter.append("M ");
+		oWriter.appendPath("/tmp", "x.txt");
+		oWriter.endLine();
+		oWriter.append('C');
+		oWriter.append(std::string{" "});
+		oWriter.appendPath("/", "tmp");
+		oWriter.append('/');
+		oWriter.endLine();
+		oWriter.appendInt(std::numeric_limits<int64_t>::min());
+		oWriter.append(' ');
+		oWriter.appendInt(0);
+		oWriter.append(' ');
+		oWriter.appendTime(65000012, 100000000);
+		oWriter.endLine();
+		// not written until flushed
+		EXPECT_TRUE(oOut.str().empty());
+	}
+	const std::string sExpected =
+			"M /tmp/x.txt\n"
+			"C /tmp/\n"
+			"-9223372036854775808 0  65.000012\n";
+	EXPECT_TRUE(oOut.str() == sExpected);
+	return 0;
+}
+int testFlushThreshold()
+{
+	std::ostringstream oOut;
+	TextWriter oWriter(oOut);
+	const std::string sLine(1000, 'x');
+	for (int32_t nLine = 0; nLine < 100; ++nLine) {
+		oWriter.append(sLine);
+		oWriter.endLine();
+	}
+	// the buffer grew over the threshold
+	EXPECT_TRUE(! oOut.str().empty());
+	EXPECT_TRUE(oOut.str().size() % (sLine.size() + 1) == 0);
+	oWriter.flush();
+	EXPECT_TRUE(oOut.str().size() == 100 * (sLine.size() + 1));
+	return 0;
+}
+int testFileNames()
+{
+	std::ostringstream oOut;
+	{
+		TextWriter oWriter(oOut);
+		oWriter.appendPath("/tmp/d\xff", "y.txt");
+		oWriter.endLine();
+		oWriter.appendFileName("/tmp/Ünïcödé");
+		oWriter.endLine();
+		oWriter.appendPath("/tmp", "z\xff");
+		oWriter.endLine();
+	}
+	const std::string sOut = oOut.str();
+	// invalid sequences are replaced
+	EXPECT_TRUE(::g_utf8_validate(sOut.data(), sOut.size(), nullptr));
+	EXPECT_TRUE(sOut.find("/tmp/d") == 0);
+	EXPECT_TRUE(sOut.find("y.txt\n") != std::string::npos);
+	EXPECT_TRUE(sOut.find("\n/tmp/Ünïcödé\n") != std::string::npos);
+	EXPECT_TRUE(sOut.find("\n/tmp/z") != std::string::npos);
+	return 0;
+}
+int testJsonPathAndTime()
+{
+	std::ostringstream oOut;
+	{
+		JsonWriter oWriter(oOut, true);
+		oWriter.beginSequence();
+		oWriter.beginObject();
+		oWriter.key("Path");
+		oWriter.pathValue("/tmp", "a\"b");
+		oWriter.key("Root");
+		oWriter.pathValue("/", "tmp");
+		oWriter.key("Time");
+		oWriter.timeValue(1000000, 10000000);
+		oWriter.endObject();
+		oWriter.endSequence();
+	}
+	EXPECT_TRUE(oOut.str() == "{\"Path\":\"/tmp/a\\\"b\",\"Root\":\"/tmp\",\"Time\":\" 1.000000\"}\n");
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "TextWriter Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testLines());
+	EXECUTE_TEST(fofi::testing::testFlushThreshold());
+	EXECUTE_TEST(fofi::testing::testFileNames());
+	EXECUTE_TEST(fofi::testing::testJsonPathAndTime());
+	//
+	std::cout << "TextWriter Tests successful!" << '\n';
+	return 0;
+}
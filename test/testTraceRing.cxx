@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2020  Stefano Marsili, <stemars@gmx.ch>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+/*
+ * File:   testTraceRing.cxx
+ */
+
+#include "tracering.h"
+
+#include "testingcommon.h"
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+#include <unistd.h>
+
+namespace fofi
+{
+namespace testing
+{
+
+int testDisabled()
+{
+	TraceRing oRing;
+	EXPECT_TRUE(! oRing.isEnabled());
+	oRing.trace(TraceRing::TRACE_EVENT_START, -1, -1);
+	EXPECT_TRUE(oRing.getTotRecorded() == 0);
+	EXPECT_TRUE(oRing.getRecords().empty());
+	return 0;
+}
+int testWrapAround()
+{
+	TraceRing oRing;
+	oRing.setCapacity(5);
+	EXPECT_TRUE(oRing.isEnabled());
+	EXPECT_TRUE(oRing.getCapacity() == 8);
+	for (int32_t nIdx = 0; nIdx < 3; ++nIdx) {
+		oRing.trace(TraceRing::TRACE_EVENT_INOTIFY, nIdx, -1, 2, 0, 0);
+	}
+	auto aRecords = oRing.getRecords();
+	EXPECT_TRUE(aRecords.size() == 3);
+	EXPECT_TRUE(aRecords[0].m_nTag == 0);
+	EXPECT_TRUE(aRecords[2].m_nTag == 2);
+	for (int32_t nIdx = 3; nIdx < 20; ++nIdx) {
+		oRing.trace(TraceRing::TRACE_EVENT_INOTIFY, nIdx, -1, 2, 0, 0);
+	}
+	EXPECT_TRUE(oRing.getTotRecorded() == 20);
+	aRecords = oRing.getRecords();
+	// the oldest were overwritten
+	EXPECT_TRUE(aRecords.size() == 8);
+	for (int32_t nIdx = 0; nIdx < 8; ++nIdx) {
+		EXPECT_TRUE(aRecords[nIdx].m_nTag == 12 + nIdx);
+	}
+	EXPECT_TRUE(aRecords[0].m_nTimeNsec <= aRecords[7].m_nTimeNsec);
+
+	oRing.clear();
+	EXPECT_TRUE(oRing.getRecords().empty());
+	oRing.setCapacity(0);
+	EXPECT_TRUE(! oRing.isEnabled());
+	return 0;
+}
+int testSaveLoadPrint()
+{
+	TraceRing oRing;
+	oRing.setCapacity(16);
+	oRing.trace(TraceRing::TRACE_EVENT_START, -1, -1, 0);
+	oRing.trace(TraceRing::TRACE_EVENT_INOTIFY, 3, 7, 0, 0, 0);
+	oRing.trace(TraceRing::TRACE_EVENT_INCONSISTENT, 3, 7, 1, 0, 0);
+	oRing.trace(TraceRing::TRACE_EVENT_WATCH_FAILED, 4, -1, 13);
+
+	TraceRing::Dump oDump;
+	oDump.m_sReason = "Testing";
+	oDump.m_nDumpTimeNsec = oRing.getRecords().back().m_nTimeNsec + 1000;
+	oDump.m_nDumpWallTimeUsec = 1234;
+	oDump.m_nTotRecorded = oRing.getTotRecorded();
+	oDump.m_aRecords = oRing.getRecords();
+	oDump.m_oNames[7] = "xx.txt";
+	oDump.m_oDirPaths[3] = "/tmp/A";
+
+	const std::string sPathName = makeTempPathName("fofimon-testtracering-");
+	auto sError = TraceRing::save(sPathName, oDump);
+	EXPECT_TRUE(sError.empty());
+	TraceRing::Dump oLoaded;
+	sError = TraceRing::load(sPathName, oLoaded);
+	EXPECT_TRUE(sError.empty());
+	EXPECT_TRUE(oLoaded.m_sReason == "Testing");
+	EXPECT_TRUE(oLoaded.m_nDumpWallTimeUsec == 1234);
+	EXPECT_TRUE(oLoaded.m_nTotRecorded == 4);
+	EXPECT_TRUE(oLoaded.m_aRecords.size() == 4);
+	EXPECT_TRUE(oLoaded.m_aRecords[2].m_nEvent == TraceRing::TRACE_EVENT_INCONSISTENT);
+	EXPECT_TRUE(oLoaded.m_aRecords[3].m_aArgs[0] == 13);
+	EXPECT_TRUE(oLoaded.m_oNames == oDump.m_oNames);
+	EXPECT_TRUE(oLoaded.m_oDirPaths == oDump.m_oDirPaths);
+
+	std::ostringstream oOut;
+	TraceRing::print(oOut, oLoaded);
+	const std::string sOut = oOut.str();
+	EXPECT_TRUE(sOut.find("inconsistent") != std::string::npos);
+	EXPECT_TRUE(sOut.find("/tmp/A  xx.txt  created during=create") != std::string::npos);
+	// unresolved tag
+	EXPECT_TRUE(sOut.find("#4") != std::string::npos);
+
+	// truncated
+	EXPECT_TRUE(::truncate(sPathName.c_str(), 40) == 0);
+	sError = TraceRing::load(sPathName, oLoaded);
+	EXPECT_TRUE(! sError.empty());
+	EXPECT_TRUE(oLoaded.m_aRecords.empty());
+	::unlink(sPathName.c_str());
+	return 0;
+}
+
+} // namespace testing
+} // namespace fofi
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::cout << "TraceRing Tests:" << '\n';
+
+	EXECUTE_TEST(fofi::testing::testDisabled());
+	EXECUTE_TEST(fofi::testing::testWrapAround());
+	EXECUTE_TEST(fofi::testing::testSaveLoadPrint());
+	//
+	std::cout << "TraceRing Tests successful!" << '\n';
+	return 0;
+}
@@ -23,6 +23,8 @@
 #include "testingcommon.h"
 
 #include <memory>
+#include <string>
+#include <limits>
 #include <iostream>
 #include <cassert>
 
@@ -52,9 +54,38 @@ int testGetTimeString()
 	EXPECT_TRUE(Util::getTimeString(999999, 100000000) ==    "  0.999999");
 	EXPECT_TRUE(Util::getTimeString(9999999, 100000000) ==   "  9.999999");
 	EXPECT_TRUE(Util::getTimeString(100000000, 100000000) == "100.000000");
+	// only the last digits of times longer than the duration
+	EXPECT_TRUE(Util::getTimeString(123456789, 1000000) ==   "3.456789");
 	//
 	return 0;
 }
+int testFormatTime()
+{
+	char aTime[Util::s_nMaxTimeChars];
+	int32_t nSize = Util::formatTime(65000012, 100000000, aTime);
+	EXPECT_TRUE(std::string(aTime, nSize) == " 65.000012");
+	const int64_t nMax = std::numeric_limits<int64_t>::max();
+	nSize = Util::formatTime(nMax, nMax, aTime);
+	EXPECT_TRUE(nSize <= Util::s_nMaxTimeChars);
+	EXPECT_TRUE(std::string(aTime, nSize) == "9223372036854.775807");
+	nSize = Util::formatTime(-1, 1000000, aTime);
+	EXPECT_TRUE(std::string(aTime, nSize) == "0.000000");
+	return 0;
+}
+int testFormatInt()
+{
+	char aDigits[Util::s_nMaxIntChars];
+	int32_t nSize = Util::formatInt(0, aDigits);
+	EXPECT_TRUE(std::string(aDigits, nSize) == "0");
+	nSize = Util::formatInt(-4711, aDigits);
+	EXPECT_TRUE(std::string(aDigits, nSize) == "-4711");
+	nSize = Util::formatInt(std::numeric_limits<int64_t>::max(), aDigits);
+	EXPECT_TRUE(std::string(aDigits, nSize) == "9223372036854775807");
+	nSize = Util::formatInt(std::numeric_limits<int64_t>::min(), aDigits);
+	EXPECT_TRUE(nSize == Util::s_nMaxIntChars);
+	EXPECT_TRUE(std::string(aDigits, nSize) == "-9223372036854775808");
+	return 0;
+}
 
 int testAddValueToVectorUniquely()
 {
@@ -150,6 +181,8 @@ int main(int /*argc*/, char** /*argv*/)
 	std::cout << "Util Tests:" << '\n';
 
 	EXECUTE_TEST(fofi::testing::testGetTimeString());
+	EXECUTE_TEST(fofi::testing::testFormatTime());
+	EXECUTE_TEST(fofi::testing::testFormatInt());
 	EXECUTE_TEST(fofi::testing::testAddValueToVectorUniquely());
 	EXECUTE_TEST(fofi::testing::testAddVectorToVectorUniquely());
 	EXECUTE_TEST(fofi::testing::testAddValueToDequeUniquely());
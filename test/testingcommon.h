@@ -18,9 +18,73 @@
  * File:   testingcommon.h
  */
 
+#ifndef FOFIMON_TESTING_COMMON_H_
+#define FOFIMON_TESTING_COMMON_H_
+
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 /* from the fit library (github.com/pfultz2/Fit) */
 #define EXPECT_TRUE(...) if (!(__VA_ARGS__)) { std::cout << "***FAILED:  EXPECT_TRUE(" << #__VA_ARGS__ << ")\n     File: " << __FILE__ << ": " << __LINE__ << '\n'; return 1; }
 
 #define EXECUTE_TEST(...) if ((__VA_ARGS__) != 0) { return 1; } else { std::cout << "ok " << #__VA_ARGS__ << '\n'; }
+
+namespace fofi
+{
+namespace testing
+{
+
+/* Not in testingutil so that tests without glibmm can use them. */
+
+/** Create an empty temporary file and open it for writing.
+ * If the file cannot be created the test fails (the process exits).
+ * @param sPrefix The start of the name of the file in /tmp. Example: "fofimon-testx-".
+ * @param nFD Is set to the file descriptor. The caller must close it.
+ * @return The path name of the file. The caller should remove it.
+ */
+inline std::string makeTempPathName(const std::string& sPrefix, int& nFD)
+{
+	std::string sTemplate = "/tmp/" + sPrefix + "XXXXXX";
+	nFD = ::mkstemp(&sTemplate[0]);
+	if (nFD < 0) {
+		std::cout << "***FAILED:  mkstemp(" << sTemplate << "): " << ::strerror(errno) << '\n';
+		std::exit(1);
+	}
+	return sTemplate;
+}
+/** Create an empty temporary file.
+ * If the file cannot be created the test fails (the process exits).
+ * @param sPrefix The start of the name of the file in /tmp. Example: "fofimon-testx-".
+ * @return The path name of the file. The caller should remove it.
+ */
+inline std::string makeTempPathName(const std::string& sPrefix)
+{
+	int nFD = -1;
+	std::string sPathName = makeTempPathName(sPrefix, nFD);
+	::close(nFD);
+	return sPathName;
+}
+
+/** The content of a file.
+ * @param sPathName The file.
+ * @return The content or empty if it cannot be read.
+ */
+inline std::string readFile(const std::string& sPathName)
+{
+	std::ifstream oIn(sPathName, std::ios::binary);
+	std::ostringstream oContent;
+	oContent << oIn.rdbuf();
+	return oContent.str();
+}
+
+} // namespace testing
+} // namespace fofi
+
+#endif /* FOFIMON_TESTING_COMMON_H_ */
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <fstream>
 
 #include <errno.h>
 #include <sys/types.h>
@@ -128,5 +129,38 @@ std::vector<std::string> splitAbsolutePath(const std::string& sPath)
 	return aRes;
 }
 
+int64_t getResidentBytes()
+{
+	// the second field of statm is the number of resident pages
+	std::ifstream oStatm("/proc/self/statm");
+	int64_t nTotPages = 0;
+	int64_t nResidentPages = 0;
+	if (! (oStatm >> nTotPages >> nResidentPages)) {
+		return -1; //-----------------------------------------------------------
+	}
+	return nResidentPages * ::sysconf(_SC_PAGESIZE);
+}
+
+const FofiModel::WatchedResult* findResult(const FofiModel& oFofiModel, const std::string& sParentPath, const std::string& sName)
+{
+	for (const auto& oResult : oFofiModel.getWatchedResults()) {
+		if (oResult.isFree()) {
+			continue; // for ---
+		}
+		if ((oFofiModel.getWatchedResultName(oResult) == sName)
+				&& (oFofiModel.getWatchedResultParentPath(oResult) == sParentPath)) {
+			return &oResult; //-------------------------------------------------
+		}
+	}
+	return nullptr;
+}
+std::string addZone(FofiModel& oFofiModel, const std::string& sPath, int32_t nMaxDepth)
+{
+	FofiModel::DirectoryZone oDZ;
+	oDZ.m_sPath = sPath;
+	oDZ.m_nMaxDepth = nMaxDepth;
+	return oFofiModel.addDirectoryZone(std::move(oDZ));
+}
+
 } // namespace testing
 } // namespace fofi
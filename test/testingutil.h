@@ -21,11 +21,15 @@
 #ifndef FOFIMON_TESTING_UTIL_H_
 #define FOFIMON_TESTING_UTIL_H_
 
+#include "fofimodel.h"
+
 #include <string>
 #include <cassert>
 #include <iostream>
 #include <vector>
 
+#include <stdint.h>
+
 namespace fofi
 {
 namespace testing
@@ -49,6 +53,27 @@ void makePath(const std::string& sPath);
  */
 std::vector<std::string> splitAbsolutePath(const std::string& sPath);
 
+/** The resident set size of the process.
+ * @return The size in bytes or -1 if not available.
+ */
+int64_t getResidentBytes();
+
+/** Find a result by its path.
+ * @param oFofiModel The model.
+ * @param sParentPath The path of the parent directory.
+ * @param sName The name.
+ * @return The result or null if not found.
+ */
+const FofiModel::WatchedResult* findResult(const FofiModel& oFofiModel, const std::string& sParentPath, const std::string& sName);
+
+/** Add a directory zone.
+ * @param oFofiModel The model.
+ * @param sPath The path of the zone.
+ * @param nMaxDepth The max depth.
+ * @return Empty string or error.
+ */
+std::string addZone(FofiModel& oFofiModel, const std::string& sPath, int32_t nMaxDepth);
+
 } // namespace testing
 
 } // namespace fofi